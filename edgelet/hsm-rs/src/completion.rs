@@ -0,0 +1,219 @@
+// Copyright (c) Microsoft. All rights reserved.
+
+use std::os::raw::c_void;
+use std::ptr;
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError};
+
+use futures::task::{self, Task};
+use futures::{Async, Future, Poll};
+
+use super::*;
+use crate::error::{Error, ErrorKind};
+
+/// Runs slow HSM operations, such as creating a certificate or signing with
+/// the TPM identity, on threads of the HSM library so they do not hold a
+/// tokio worker thread. Operations are submitted through the `_async`
+/// functions of [`Crypto`] and [`Tpm`], which return a [`Completion`].
+///
+/// The library supports a single executor at a time. Its threads stop once
+/// the executor, its clones and every [`Completion`] it returned are dropped.
+#[derive(Clone, Debug)]
+pub struct AsyncExecutor {
+    inner: Arc<ExecutorThreads>,
+}
+
+#[derive(Debug)]
+struct ExecutorThreads;
+
+impl Drop for ExecutorThreads {
+    fn drop(&mut self) {
+        unsafe { hsm_async_deinit() };
+    }
+}
+
+impl AsyncExecutor {
+    /// Starts the threads that run operations, 0 for the library default.
+    /// The crypto or TPM interface must be initialized first.
+    pub fn new(num_threads: usize) -> Result<Self, Error> {
+        let result = unsafe { hsm_async_init(num_threads) as isize };
+        if result != 0 {
+            Err(result)?
+        }
+        Ok(AsyncExecutor {
+            inner: Arc::new(ExecutorThreads),
+        })
+    }
+
+    /// Submits an operation on `client` with `submit`, which is given the
+    /// callback and context to pass to the library. `convert` turns the
+    /// outcome of the operation into its output and releases whatever it does
+    /// not keep.
+    pub(crate) fn submit<K, T, S, C>(
+        &self,
+        client: Arc<K>,
+        submit: S,
+        convert: C,
+    ) -> Result<Completion<T>, Error>
+    where
+        K: Send + 'static,
+        S: FnOnce(HSM_ASYNC_CALLBACK, *mut c_void) -> HSM_ASYNC_TICKET,
+        C: Fn(HSM_ASYNC_RESULT) -> Result<T, Error> + Send + 'static,
+    {
+        let state = Arc::new(Mutex::new(CompletionState::default()));
+        // the callback owns the context, it is invoked once per submitted
+        // operation, cancelled or not
+        let context = Box::into_raw(Box::new(CompletionContext {
+            state: state.clone(),
+            _client: Box::new(ClientRef { _client: client }),
+        })) as *mut c_void;
+        let ticket = submit(Some(on_complete), context);
+        if ticket.is_null() {
+            unsafe { drop(Box::from_raw(context as *mut CompletionContext)) };
+            Err(ErrorKind::NullResponse)?
+        }
+        Ok(Completion {
+            ticket,
+            state,
+            convert: Box::new(convert),
+            _executor: self.inner.clone(),
+        })
+    }
+}
+
+#[derive(Debug, Default)]
+struct CompletionState {
+    complete: bool,
+    task: Option<Task>,
+}
+
+struct CompletionContext {
+    state: Arc<Mutex<CompletionState>>,
+    // keeps the client alive until the library no longer uses it
+    _client: Box<dyn Send>,
+}
+
+// The library thread only drops this reference, it never uses the client, so
+// the client need not be Sync.
+struct ClientRef<K> {
+    _client: Arc<K>,
+}
+
+unsafe impl<K: Send> Send for ClientRef<K> {}
+
+fn lock_state(state: &Mutex<CompletionState>) -> MutexGuard<'_, CompletionState> {
+    state.lock().unwrap_or_else(PoisonError::into_inner)
+}
+
+// The ticket is null when the operation was cancelled, the completion that
+// owned it is gone then and nobody polls the state.
+unsafe extern "C" fn on_complete(_ticket: HSM_ASYNC_TICKET, context: *mut c_void) {
+    let context = Box::from_raw(context as *mut CompletionContext);
+    let task = {
+        let mut state = lock_state(&context.state);
+        state.complete = true;
+        state.task.take()
+    };
+    if let Some(task) = task {
+        task.notify();
+    }
+}
+
+/// A future resolving to the output of an operation submitted to an
+/// [`AsyncExecutor`]. The task polling it is notified by the library thread
+/// that ran the operation.
+///
+/// The operation holds a reference to the client it was submitted on until
+/// the library is done with it. Dropping the completion before it resolves
+/// cancels the operation without waiting, its output is then released by the
+/// library.
+pub struct Completion<T> {
+    // null once the outcome has been taken
+    ticket: HSM_ASYNC_TICKET,
+    state: Arc<Mutex<CompletionState>>,
+    convert: Box<dyn Fn(HSM_ASYNC_RESULT) -> Result<T, Error> + Send>,
+    _executor: Arc<ExecutorThreads>,
+}
+
+// Tickets don't have thread-affinity
+unsafe impl<T> Send for Completion<T> {}
+
+impl<T> Completion<T> {
+    fn take_result(&mut self) -> Result<HSM_ASYNC_RESULT, Error> {
+        let mut result = HSM_ASYNC_RESULT {
+            result: 0,
+            output: SIZED_BUFFER {
+                buffer: ptr::null_mut(),
+                size: 0,
+            },
+            certificate: ptr::null_mut(),
+        };
+        // only called once the operation has completed, so this doesn't block
+        let status = unsafe { hsm_async_get_result(self.ticket, &mut result) };
+        self.ticket = ptr::null_mut();
+        match status {
+            0 => Ok(result),
+            r => Err(r)?,
+        }
+    }
+}
+
+impl<T> Future for Completion<T> {
+    type Item = T;
+    type Error = Error;
+
+    fn poll(&mut self) -> Poll<T, Error> {
+        if self.ticket.is_null() {
+            Err(ErrorKind::NullResponse)?
+        }
+        {
+            let mut state = lock_state(&self.state);
+            if !state.complete {
+                state.task = Some(task::current());
+                return Ok(Async::NotReady);
+            }
+        }
+        let result = self.take_result()?;
+        (self.convert)(result).map(Async::Ready)
+    }
+}
+
+impl<T> Drop for Completion<T> {
+    fn drop(&mut self) {
+        if !self.ticket.is_null() {
+            unsafe { hsm_async_cancel(self.ticket) };
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::os::raw::c_void;
+    use std::ptr;
+    use std::sync::{Arc, Mutex};
+
+    use super::{on_complete, AsyncExecutor, ClientRef, CompletionContext, CompletionState};
+
+    #[test]
+    fn executor_too_many_threads_fails() {
+        let result = AsyncExecutor::new(1000);
+        assert!(result.is_err());
+    }
+
+    #[test]
+    fn completion_callback_marks_complete_and_releases_client() {
+        let state = Arc::new(Mutex::new(CompletionState::default()));
+        let client = Arc::new(());
+        let context = Box::into_raw(Box::new(CompletionContext {
+            state: state.clone(),
+            _client: Box::new(ClientRef {
+                _client: client.clone(),
+            }),
+        })) as *mut c_void;
+
+        unsafe { on_complete(ptr::null_mut(), context) };
+
+        assert!(state.lock().unwrap().complete);
+        assert_eq!(1, Arc::strong_count(&state));
+        assert_eq!(1, Arc::strong_count(&client));
+    }
+}
@@ -7,8 +7,10 @@ use std::ops::{Deref, Drop};
 use std::os::raw::{c_char, c_uchar, c_void};
 use std::slice;
 use std::str;
+use std::sync::Arc;
 
 use super::*;
+use crate::completion::{AsyncExecutor, Completion};
 use crate::error::{Error, ErrorKind};
 
 /// Enumerator for [`CERTIFICATE_TYPE`]
@@ -83,6 +85,103 @@ impl Crypto {
                 .into_owned()
         }
     }
+
+    /// Same as [`CreateCertificate::create_certificate`], run on a thread of `executor`.
+    /// The operation holds a reference to this client until it completes.
+    pub fn create_certificate_async(
+        self: Arc<Self>,
+        executor: &AsyncExecutor,
+        properties: &CertificateProperties,
+    ) -> Result<Completion<HsmCertificate>, Error> {
+        let property_handle = make_certification_props(properties)?;
+        let handle = self.handle;
+        executor.submit(
+            self,
+            // the operation destroys the properties, even when it can't be submitted
+            |callback, context| unsafe {
+                hsm_async_create_certificate(handle, property_handle, callback, context)
+            },
+            |result| {
+                if result.result != 0 {
+                    Err(result.result)?
+                } else if result.certificate.is_null() {
+                    Err(ErrorKind::NullResponse)?
+                } else {
+                    Ok(HsmCertificate {
+                        cert_info_handle: result.certificate,
+                    })
+                }
+            },
+        )
+    }
+
+    /// Same as [`Encrypt::encrypt`], run on a thread of `executor`.
+    /// The operation holds a reference to this client until it completes.
+    pub fn encrypt_async(
+        self: Arc<Self>,
+        executor: &AsyncExecutor,
+        client_id: &[u8],
+        plaintext: &[u8],
+        initialization_vector: &[u8],
+    ) -> Result<Completion<Buffer>, Error> {
+        let interface = self.interface;
+        let handle = self.handle;
+        // the buffers are copied when the operation is submitted
+        executor.submit(
+            self,
+            |callback, context| unsafe {
+                hsm_async_encrypt_data(
+                    handle,
+                    &make_sized_buffer(client_id),
+                    &make_sized_buffer(plaintext),
+                    &make_sized_buffer(initialization_vector),
+                    callback,
+                    context,
+                )
+            },
+            move |result| match result.result {
+                0 => Ok(Buffer::new(interface, result.output)),
+                r => Err(r)?,
+            },
+        )
+    }
+
+    /// Same as [`Decrypt::decrypt`], run on a thread of `executor`.
+    /// The operation holds a reference to this client until it completes.
+    pub fn decrypt_async(
+        self: Arc<Self>,
+        executor: &AsyncExecutor,
+        client_id: &[u8],
+        ciphertext: &[u8],
+        initialization_vector: &[u8],
+    ) -> Result<Completion<Buffer>, Error> {
+        let interface = self.interface;
+        let handle = self.handle;
+        executor.submit(
+            self,
+            |callback, context| unsafe {
+                hsm_async_decrypt_data(
+                    handle,
+                    &make_sized_buffer(client_id),
+                    &make_sized_buffer(ciphertext),
+                    &make_sized_buffer(initialization_vector),
+                    callback,
+                    context,
+                )
+            },
+            move |result| match result.result {
+                0 => Ok(Buffer::new(interface, result.output)),
+                r => Err(r)?,
+            },
+        )
+    }
+}
+
+fn make_sized_buffer(data: &[u8]) -> SIZED_BUFFER {
+    SIZED_BUFFER {
+        buffer: data.as_ptr() as *mut c_uchar,
+        size: data.len(),
+    }
 }
 
 impl MakeRandom for Crypto {
@@ -567,6 +666,26 @@ impl HsmCertificate {
         Ok(private_key)
     }
 
+    pub fn get_der(&self) -> Result<&[u8], Error> {
+        let mut der_len: usize = 0;
+        let der = unsafe { certificate_info_get_der(self.cert_info_handle, &mut der_len) };
+        if der.is_null() || der_len == 0 {
+            Err(ErrorKind::NullResponse)?
+        }
+        Ok(unsafe { slice::from_raw_parts(der, der_len) })
+    }
+
+    pub fn get_thumbprint_sha256(&self) -> Result<&[u8], Error> {
+        let mut thumbprint_len: usize = 0;
+        let thumbprint = unsafe {
+            certificate_info_get_thumbprint_sha256(self.cert_info_handle, &mut thumbprint_len)
+        };
+        if thumbprint.is_null() || thumbprint_len == 0 {
+            Err(ErrorKind::NullResponse)?
+        }
+        Ok(unsafe { slice::from_raw_parts(thumbprint, thumbprint_len) })
+    }
+
     pub fn get_valid_to(&self) -> Result<DateTime<Utc>, Error> {
         let ts: i64 = unsafe { certificate_info_get_valid_to(self.cert_info_handle) };
         let naive_ts = NaiveDateTime::from_timestamp_opt(ts, 0);
@@ -12,11 +12,13 @@
 
 use hsm_sys::*;
 
+mod completion;
 mod crypto;
 mod error;
 pub mod tpm;
 mod x509;
 
+pub use crate::completion::{AsyncExecutor, Completion};
 pub use crate::crypto::{
     Buffer, CertificateProperties, CertificateType, Crypto, HsmCertificate, KeyBytes, PrivateKey,
 };
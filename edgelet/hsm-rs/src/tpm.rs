@@ -1,13 +1,16 @@
 // Copyright (c) Microsoft. All rights reserved.
 
 use std::convert::AsRef;
+use std::ffi::CString;
 use std::ops::{Deref, Drop};
 use std::os::raw::{c_uchar, c_void};
 use std::ptr;
 use std::slice;
+use std::sync::Arc;
 
 use super::*;
 use super::{ManageTpmKeys, SignWithTpm};
+use crate::completion::{AsyncExecutor, Completion};
 use crate::error::{Error, ErrorKind};
 
 /// Hsm for TPM
@@ -17,6 +20,7 @@ use crate::error::{Error, ErrorKind};
 pub struct Tpm {
     handle: HSM_CLIENT_HANDLE,
     interface: HSM_CLIENT_TPM_INTERFACE,
+    sas_key_interface: Option<HSM_CLIENT_TPM_SAS_KEY_INTERFACE>,
 }
 
 // Handles don't have thread-affinity
@@ -36,6 +40,53 @@ impl Drop for Tpm {
     }
 }
 
+// Debug builds link the library built from this tree statically, release
+// builds load a shared library which may predate the SAS key extension, so
+// its accessor is looked up at runtime rather than linked against.
+#[cfg(debug_assertions)]
+fn sas_key_interface() -> *const HSM_CLIENT_TPM_SAS_KEY_INTERFACE {
+    unsafe { hsm_client_tpm_sas_key_interface() }
+}
+
+#[cfg(not(debug_assertions))]
+const SAS_KEY_INTERFACE_SYMBOL: &[u8] = b"hsm_client_tpm_sas_key_interface\0";
+
+#[cfg(all(not(debug_assertions), unix))]
+fn sas_key_interface() -> *const HSM_CLIENT_TPM_SAS_KEY_INTERFACE {
+    let accessor = unsafe {
+        libc::dlsym(
+            libc::RTLD_DEFAULT,
+            SAS_KEY_INTERFACE_SYMBOL.as_ptr() as *const _,
+        )
+    };
+    call_sas_key_accessor(accessor as *const c_void)
+}
+
+#[cfg(all(not(debug_assertions), windows))]
+fn sas_key_interface() -> *const HSM_CLIENT_TPM_SAS_KEY_INTERFACE {
+    use winapi::um::libloaderapi::{GetModuleHandleA, GetProcAddress};
+
+    let module = unsafe { GetModuleHandleA(b"iothsm.dll\0".as_ptr() as *const _) };
+    if module.is_null() {
+        ptr::null()
+    } else {
+        let accessor =
+            unsafe { GetProcAddress(module, SAS_KEY_INTERFACE_SYMBOL.as_ptr() as *const _) };
+        call_sas_key_accessor(accessor as *const c_void)
+    }
+}
+
+#[cfg(not(debug_assertions))]
+fn call_sas_key_accessor(accessor: *const c_void) -> *const HSM_CLIENT_TPM_SAS_KEY_INTERFACE {
+    if accessor.is_null() {
+        ptr::null()
+    } else {
+        let accessor: unsafe extern "C" fn() -> *const HSM_CLIENT_TPM_SAS_KEY_INTERFACE =
+            unsafe { std::mem::transmute(accessor) };
+        unsafe { accessor() }
+    }
+}
+
 impl Tpm {
     /// Create a new TPM implementation for the HSM API.
     pub fn new() -> Result<Tpm, Error> {
@@ -49,17 +100,147 @@ impl Tpm {
             Err(ErrorKind::NullResponse)?
         }
         let interface = unsafe { *if_ptr };
+        // the SAS key extension is optional, its functions are reported as
+        // not implemented when the library does not provide it
+        let sas_key_ptr = sas_key_interface();
+        let sas_key_interface = if sas_key_ptr.is_null() {
+            None
+        } else {
+            Some(unsafe { *sas_key_ptr })
+                .filter(|i| i.version >= HSM_CLIENT_TPM_SAS_KEY_INTERFACE_VERSION)
+        };
         if let Some(handle) = interface.hsm_client_tpm_create.map(|f| unsafe { f() }) {
             if handle.is_null() {
                 unsafe { hsm_client_tpm_deinit() };
                 Err(ErrorKind::NullResponse)?
             }
-            Ok(Tpm { handle, interface })
+            Ok(Tpm {
+                handle,
+                interface,
+                sas_key_interface,
+            })
         } else {
             unsafe { hsm_client_tpm_deinit() };
             Err(ErrorKind::NullResponse)?
         }
     }
+
+    /// Imports a named SAS key, such as the key of a downstream device or
+    /// module, into the TPM key storage.
+    pub fn import_sas_key(&self, key_name: &str, key: &[u8]) -> Result<(), Error> {
+        let key_fn = self
+            .sas_key_interface
+            .and_then(|i| i.hsm_client_import_sas_key)
+            .ok_or(ErrorKind::NoneFn)?;
+        let c_key_name = CString::new(key_name).map_err(|_| ErrorKind::ToCStr)?;
+
+        let result = unsafe { key_fn(self.handle, c_key_name.as_ptr(), key.as_ptr(), key.len()) };
+        match result {
+            0 => Ok(()),
+            r => Err(r)?,
+        }
+    }
+
+    /// Removes a named SAS key previously imported with `import_sas_key`.
+    pub fn remove_sas_key(&self, key_name: &str) -> Result<(), Error> {
+        let key_fn = self
+            .sas_key_interface
+            .and_then(|i| i.hsm_client_remove_sas_key)
+            .ok_or(ErrorKind::NoneFn)?;
+        let c_key_name = CString::new(key_name).map_err(|_| ErrorKind::ToCStr)?;
+
+        let result = unsafe { key_fn(self.handle, c_key_name.as_ptr()) };
+        match result {
+            0 => Ok(()),
+            r => Err(r)?,
+        }
+    }
+
+    /// Hashes the parameter data with a named SAS key stored in the TPM and returns the value
+    pub fn sign_with_sas_key(&self, key_name: &str, data: &[u8]) -> Result<TpmDigest, Error> {
+        let mut key_ln: usize = 0;
+        let mut ptr = ptr::null_mut();
+
+        let key_fn = self
+            .sas_key_interface
+            .and_then(|i| i.hsm_client_sign_with_sas_key)
+            .ok_or(ErrorKind::NoneFn)?;
+        let c_key_name = CString::new(key_name).map_err(|_| ErrorKind::ToCStr)?;
+        let result = unsafe {
+            key_fn(
+                self.handle,
+                c_key_name.as_ptr(),
+                data.as_ptr(),
+                data.len(),
+                &mut ptr,
+                &mut key_ln,
+            )
+        };
+        match result {
+            0 => Ok(TpmDigest::new(self.interface, ptr as *const _, key_ln)),
+            r => Err(r)?,
+        }
+    }
+
+    /// Same as [`SignWithTpm::sign_with_identity`], run on a thread of `executor`.
+    /// The operation holds a reference to this client until it completes.
+    pub fn sign_with_identity_async(
+        self: Arc<Self>,
+        executor: &AsyncExecutor,
+        data: &[u8],
+    ) -> Result<Completion<TpmDigest>, Error> {
+        let interface = self.interface;
+        let handle = self.handle;
+        // the data is copied when the operation is submitted
+        executor.submit(
+            self,
+            |callback, context| unsafe {
+                hsm_async_sign_with_identity(handle, data.as_ptr(), data.len(), callback, context)
+            },
+            move |result| match result.result {
+                0 => Ok(TpmDigest::new(
+                    interface,
+                    result.output.buffer as *const _,
+                    result.output.size,
+                )),
+                r => Err(r)?,
+            },
+        )
+    }
+
+    /// Same as [`SignWithTpm::derive_and_sign_with_identity`], run on a thread of `executor`.
+    /// The operation holds a reference to this client until it completes.
+    pub fn derive_and_sign_with_identity_async(
+        self: Arc<Self>,
+        executor: &AsyncExecutor,
+        data: &[u8],
+        identity: &[u8],
+    ) -> Result<Completion<TpmDigest>, Error> {
+        let interface = self.interface;
+        let handle = self.handle;
+        executor.submit(
+            self,
+            |callback, context| unsafe {
+                hsm_async_derive_and_sign_with_identity(
+                    handle,
+                    data.as_ptr(),
+                    data.len(),
+                    identity.as_ptr(),
+                    identity.len(),
+                    callback,
+                    context,
+                )
+            },
+            move |result| match result.result {
+                0 => Ok(TpmDigest::new(
+                    interface,
+                    result.output.buffer as *const _,
+                    result.output.size,
+                )),
+                r => Err(r)?,
+            },
+        )
+    }
 }
 
 impl ManageTpmKeys for Tpm {
@@ -206,7 +387,7 @@ impl AsRef<[u8]> for TpmBuffer {
 
 #[cfg(test)]
 mod tests {
-    use std::os::raw::{c_int, c_uchar, c_void};
+    use std::os::raw::{c_char, c_int, c_uchar, c_void};
     use std::ptr;
 
     use super::super::{ManageTpmKeys, SignWithTpm};
@@ -357,6 +538,50 @@ mod tests {
         }
     }
 
+    unsafe extern "C" fn fake_import_sas_key(
+        handle: HSM_CLIENT_HANDLE,
+        _key_name: *const c_char,
+        _key: *const c_uchar,
+        _key_size: usize,
+    ) -> c_int {
+        let n = handle as isize;
+        if n == 0 {
+            0
+        } else {
+            1
+        }
+    }
+
+    unsafe extern "C" fn fake_remove_sas_key(
+        handle: HSM_CLIENT_HANDLE,
+        _key_name: *const c_char,
+    ) -> c_int {
+        let n = handle as isize;
+        if n == 0 {
+            0
+        } else {
+            1
+        }
+    }
+
+    unsafe extern "C" fn fake_sign_with_sas_key(
+        handle: HSM_CLIENT_HANDLE,
+        _key_name: *const c_char,
+        _data_to_be_signed: *const c_uchar,
+        _data_to_be_signed_size: usize,
+        digest: *mut *mut c_uchar,
+        digest_size: *mut usize,
+    ) -> c_int {
+        let n = handle as isize;
+        if n == 0 {
+            *digest = malloc(DEFAULT_KEY_LEN) as *mut c_uchar;
+            *digest_size = DEFAULT_KEY_LEN;
+            0
+        } else {
+            1
+        }
+    }
+
     fn fake_no_if_tpm_hsm() -> Tpm {
         Tpm {
             handle: unsafe { fake_handle_create_good() },
@@ -365,6 +590,7 @@ mod tests {
                 hsm_client_tpm_destroy: Some(fake_handle_destroy),
                 ..HSM_CLIENT_TPM_INTERFACE_TAG::default()
             },
+            sas_key_interface: None,
         }
     }
 
@@ -414,6 +640,24 @@ mod tests {
         println!("You should never see this print {:?}", result);
     }
 
+    #[test]
+    #[should_panic(expected = "HSM API Not Implemented")]
+    fn tpm_no_import_sas_key_function_fail() {
+        let hsm_tpm = fake_no_if_tpm_hsm();
+        let key = b"key data";
+        hsm_tpm.import_sas_key("module1", key).unwrap();
+        println!("You should never see this print");
+    }
+
+    #[test]
+    #[should_panic(expected = "HSM API Not Implemented")]
+    fn tpm_no_sign_with_sas_key_function_fail() {
+        let hsm_tpm = fake_no_if_tpm_hsm();
+        let data = b"data";
+        let result = hsm_tpm.sign_with_sas_key("module1", data).unwrap();
+        println!("You should never see this print {:?}", result);
+    }
+
     fn fake_good_tpm_hsm() -> Tpm {
         Tpm {
             handle: unsafe { fake_handle_create_good() },
@@ -427,6 +671,12 @@ mod tests {
                 hsm_client_derive_and_sign_with_identity: Some(fake_derive_and_sign),
                 hsm_client_free_buffer: Some(fake_buffer_destroy),
             },
+            sas_key_interface: Some(HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG {
+                hsm_client_import_sas_key: Some(fake_import_sas_key),
+                hsm_client_remove_sas_key: Some(fake_remove_sas_key),
+                hsm_client_sign_with_sas_key: Some(fake_sign_with_sas_key),
+                ..HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG::default()
+            }),
         }
     }
 
@@ -456,6 +706,25 @@ mod tests {
         let result5 = hsm_tpm.derive_and_sign_with_identity(k3, identity).unwrap();
         let buf5 = &result5;
         assert_eq!(buf5.len(), DEFAULT_KEY_LEN);
+
+        let k4 = b"A fake module key";
+        let _result6: () = hsm_tpm.import_sas_key("module1", k4).unwrap();
+
+        let k5 = b"a buffer";
+        let result7 = hsm_tpm.sign_with_sas_key("module1", k5).unwrap();
+        let buf7 = &result7;
+        assert_eq!(buf7.len(), DEFAULT_KEY_LEN);
+
+        let _result8: () = hsm_tpm.remove_sas_key("module1").unwrap();
+    }
+
+    #[test]
+    #[should_panic(expected = "Could not convert parameter to c string")]
+    fn tpm_sas_key_name_with_nul_fails() {
+        let hsm_tpm = fake_good_tpm_hsm();
+        let k1 = b"A fake key";
+        hsm_tpm.import_sas_key("module\01", k1).unwrap();
+        println!("You should never see this print");
     }
 
     fn fake_bad_tpm_hsm() -> Tpm {
@@ -471,6 +740,12 @@ mod tests {
                 hsm_client_derive_and_sign_with_identity: Some(fake_derive_and_sign),
                 hsm_client_free_buffer: Some(fake_buffer_destroy),
             },
+            sas_key_interface: Some(HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG {
+                hsm_client_import_sas_key: Some(fake_import_sas_key),
+                hsm_client_remove_sas_key: Some(fake_remove_sas_key),
+                hsm_client_sign_with_sas_key: Some(fake_sign_with_sas_key),
+                ..HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG::default()
+            }),
         }
     }
 
@@ -518,4 +793,29 @@ mod tests {
         println!("You should never see this print {:?}", result);
     }
 
+    #[test]
+    #[should_panic(expected = "HSM API failure occurred")]
+    fn tpm_import_sas_key_errors() {
+        let hsm_tpm = fake_bad_tpm_hsm();
+        let k1 = b"A fake key";
+        hsm_tpm.import_sas_key("module1", k1).unwrap();
+        println!("You should never see this print");
+    }
+
+    #[test]
+    #[should_panic(expected = "HSM API failure occurred")]
+    fn tpm_remove_sas_key_errors() {
+        let hsm_tpm = fake_bad_tpm_hsm();
+        hsm_tpm.remove_sas_key("module1").unwrap();
+        println!("You should never see this print");
+    }
+
+    #[test]
+    #[should_panic(expected = "HSM API failure occurred")]
+    fn tpm_sign_with_sas_key_errors() {
+        let hsm_tpm = fake_bad_tpm_hsm();
+        let k1 = b"A fake buffer";
+        let result = hsm_tpm.sign_with_sas_key("module1", k1).unwrap();
+        println!("You should never see this print {:?}", result);
+    }
 }
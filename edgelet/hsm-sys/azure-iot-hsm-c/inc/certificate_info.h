@@ -37,7 +37,48 @@ typedef enum PRIVATE_KEY_TYPE_TAG
 extern CERT_INFO_HANDLE certificate_info_create(const char* certificate, const void* private_key, size_t priv_key_len, PRIVATE_KEY_TYPE pk_type);
 
 /**
-* @brief            Frees all resources associated with this object
+* @brief            Creates the certificate information object from a PEM buffer that
+*                   need not be null terminated, such as a mapped file
+*
+* @param certificate        The certificate in PEM format
+* @param certificate_size   The size of the certificate buffer
+* @param private_key        A value or reference to the certificate private key
+* @param pk_len             The length of the private key
+* @param pk_type            Indicates the type of the private key either the value or reference
+*
+* @return           On success a valid CERT_INFO_HANDLE or NULL on failure
+*/
+extern CERT_INFO_HANDLE certificate_info_create_from_buffer(const void* certificate, size_t certificate_size, const void* private_key, size_t priv_key_len, PRIVATE_KEY_TYPE pk_type);
+
+/**
+* @brief            Creates a new certificate information object holding the certificate
+*                   of handle followed by the appended PEM buffer. Only the appended
+*                   certificate is parsed; the leaf certificate of the new object is
+*                   the one of handle, which is left unchanged.
+*
+* @param handle             The handle of a certificate without a private key
+* @param certificate        The certificate in PEM format to append
+* @param certificate_size   The size of the certificate buffer
+*
+* @return           On success a valid CERT_INFO_HANDLE or NULL on failure
+*/
+extern CERT_INFO_HANDLE certificate_info_append_from_buffer(CERT_INFO_HANDLE handle, const void* certificate, size_t certificate_size);
+
+/**
+* @brief            Obtains a new handle to the certificate information object.
+*                   The certificate data is immutable and is shared by all clones;
+*                   every handle must be released with certificate_info_destroy.
+*
+* @param handle     The handle created in certificate_info_create
+*
+* @return           On success a valid CERT_INFO_HANDLE or NULL on failure
+*/
+extern CERT_INFO_HANDLE certificate_info_clone(CERT_INFO_HANDLE handle);
+
+/**
+* @brief            Releases the handle; all resources associated with this object
+*                   are freed once the last handle obtained from certificate_info_create
+*                   or certificate_info_clone is released
 *
 * @param handle     The handle created in certificate_info_create
 *
@@ -99,6 +140,30 @@ extern PRIVATE_KEY_TYPE certificate_info_private_key_type(CERT_INFO_HANDLE handl
 */
 extern const char* certificate_info_get_leaf_certificate(CERT_INFO_HANDLE handle);
 
+/**
+* @brief            Retrieves the DER encoding of the leaf certificate associated with this object.
+*                   The buffer is decoded once during certificate_info_create and is owned by
+*                   the handle; it remains valid until certificate_info_destroy is called.
+*
+* @param handle     The handle created in certificate_info_create
+* @param der_len    The length of the returned DER buffer
+*
+* @return           On success the DER encoded leaf certificate or NULL on failure
+*/
+extern const unsigned char* certificate_info_get_der(CERT_INFO_HANDLE handle, size_t* der_len);
+
+/**
+* @brief            Retrieves the SHA-256 thumbprint of the DER encoded leaf certificate.
+*                   The buffer is owned by the handle and remains valid until
+*                   certificate_info_destroy is called.
+*
+* @param handle             The handle created in certificate_info_create
+* @param thumbprint_len     The length of the returned thumbprint (32 bytes)
+*
+* @return           On success the thumbprint bytes or NULL on failure
+*/
+extern const unsigned char* certificate_info_get_thumbprint_sha256(CERT_INFO_HANDLE handle, size_t* thumbprint_len);
+
 extern const char* certificate_info_get_chain(CERT_INFO_HANDLE handle);
 extern const char* certificate_info_get_issuer(CERT_INFO_HANDLE handle);
 extern const char* certificate_info_get_common_name(CERT_INFO_HANDLE handle);
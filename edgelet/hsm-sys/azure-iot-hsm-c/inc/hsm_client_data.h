@@ -6,10 +6,12 @@
 
 #ifdef __cplusplus
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 extern "C" {
 #else
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #endif /* __cplusplus */
 
@@ -125,6 +127,46 @@ typedef int (*HSM_CLIENT_SIGN_WITH_IDENTITY)(HSM_CLIENT_HANDLE handle, const uns
 */
 typedef int (*HSM_CLIENT_DERIVE_AND_SIGN_WITH_IDENTITY)(HSM_CLIENT_HANDLE handle, const unsigned char* data, size_t data_size, const unsigned char* identity, size_t identity_size, unsigned char** digest, size_t* digest_size);
 
+/**
+* @brief            Imports a named SAS key, such as the key of a downstream device
+*                   or module, into the TPM key storage. Importing a key under a
+*                   name that is already in use replaces the previous key.
+*
+* @param handle     The ::HSM_CLIENT_HANDLE that was created by the ::HSM_CLIENT_CREATE call
+* @param key_name   Name of the key. The identity key name is reserved for
+*                   ::HSM_CLIENT_ACTIVATE_IDENTITY_KEY
+* @param key        The key that needs to be imported to the TPM
+* @param key_size   The size of the key
+*
+* @return           On success 0 on. Non-zero on failure
+*/
+typedef int (*HSM_CLIENT_IMPORT_SAS_KEY)(HSM_CLIENT_HANDLE handle, const char* key_name, const unsigned char* key, size_t key_size);
+
+/**
+* @brief            Removes a named SAS key imported with ::HSM_CLIENT_IMPORT_SAS_KEY
+*
+* @param handle     The ::HSM_CLIENT_HANDLE that was created by the ::HSM_CLIENT_CREATE call
+* @param key_name   Name of the key
+*
+* @return           On success 0 on. Non-zero on failure
+*/
+typedef int (*HSM_CLIENT_REMOVE_SAS_KEY)(HSM_CLIENT_HANDLE handle, const char* key_name);
+
+/**
+* @brief                    Hashes the data with a named SAS key stored in the TPM
+*
+* @param handle             ::HSM_CLIENT_HANDLE that was created by the ::HSM_CLIENT_CREATE call
+* @param key_name           Name of a key imported with ::HSM_CLIENT_IMPORT_SAS_KEY
+* @param data               Data that will need to be hashed
+* @param data_size          The size of the data parameter
+* @param[out] digest        The returned digest. This function allocates memory for a buffer
+*                           which must be freed by a call to ::HSM_CLIENT_FREE_BUFFER.
+* @param[out] digest_size   The size of the returned digest
+*
+* @return                   On success 0 on. Non-zero on failure
+*/
+typedef int (*HSM_CLIENT_SIGN_WITH_SAS_KEY)(HSM_CLIENT_HANDLE handle, const char* key_name, const unsigned char* data, size_t data_size, unsigned char** digest, size_t* digest_size);
+
 // x509
 /**
 * @brief        Retrieves the certificate to be used for x509 communication. This value is
@@ -272,6 +314,25 @@ typedef struct HSM_CLIENT_TPM_INTERFACE_TAG
     HSM_CLIENT_FREE_BUFFER hsm_client_free_buffer;
 } HSM_CLIENT_TPM_INTERFACE;
 
+#define HSM_CLIENT_TPM_SAS_KEY_INTERFACE_VERSION 1
+
+/**
+* @brief    Optional extension of the TPM interface to manage named SAS keys.
+*           Its functions take handles created by the TPM interface and their
+*           buffers are freed by its ::HSM_CLIENT_FREE_BUFFER. Fields are only
+*           ever appended, a caller must check that version is at least the
+*           one that introduced the fields it uses.
+*/
+typedef struct HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG
+{
+    uint32_t version;
+
+    // version 1
+    HSM_CLIENT_IMPORT_SAS_KEY hsm_client_import_sas_key;
+    HSM_CLIENT_REMOVE_SAS_KEY hsm_client_remove_sas_key;
+    HSM_CLIENT_SIGN_WITH_SAS_KEY hsm_client_sign_with_sas_key;
+} HSM_CLIENT_TPM_SAS_KEY_INTERFACE;
+
 typedef struct HSM_CLIENT_X509_INTERFACE_TAG
 {
     HSM_CLIENT_CREATE hsm_client_x509_create;
@@ -299,7 +360,287 @@ typedef struct HSM_CLIENT_CRYPTO_INTERFACE_TAG
     HSM_CLIENT_FREE_BUFFER hsm_client_free_buffer;
 } HSM_CLIENT_CRYPTO_INTERFACE;
 
+/**
+* Number of buckets of every latency histogram. Bucket boundaries grow
+* exponentially with four linear sub-buckets between powers of two, so a
+* latency is known to within 25% of its value, up to about 68 seconds.
+*/
+#define HSM_METRICS_NUM_BUCKETS 140
+
+/**
+* Calls made to one function of an HSM interface, or to one internal
+* operation, since the library was loaded. Latencies are in nanoseconds.
+* Allocations are only counted when the library is built with allocation
+* accounting, otherwise they stay 0. They cover the blocks the library and
+* its shared utilities allocate on the calling thread, including nested
+* operations; peak bytes is the most memory held above what was held when
+* a single call began.
+*/
+typedef struct HSM_OPERATION_METRICS_TAG
+{
+    const char* name;
+    uint64_t count;
+    uint64_t errors;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t buckets[HSM_METRICS_NUM_BUCKETS];
+    uint64_t allocations;
+    uint64_t allocated_bytes;
+    uint64_t max_peak_bytes;
+} HSM_OPERATION_METRICS;
+
+typedef struct HSM_CACHE_METRICS_TAG
+{
+    const char* name;
+    uint64_t hits;
+    uint64_t misses;
+} HSM_CACHE_METRICS;
+
+/**
+* Time spent waiting for one internal lock. Only counted when the library
+* is built with lock profiling, otherwise every count stays 0. An
+* acquisition is contended when the lock was held by another thread.
+*/
+typedef struct HSM_LOCK_METRICS_TAG
+{
+    const char* name;
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t total_wait_ns;
+    uint64_t max_wait_ns;
+    uint64_t buckets[HSM_METRICS_NUM_BUCKETS];
+} HSM_LOCK_METRICS;
+
+typedef struct HSM_METRICS_TAG
+{
+    size_t num_operations;
+    HSM_OPERATION_METRICS* operations;
+    size_t num_caches;
+    HSM_CACHE_METRICS* caches;
+    size_t num_locks;
+    HSM_LOCK_METRICS* locks;
+} HSM_METRICS;
+
+/**
+* @brief    Takes a snapshot of the counters and latency histograms of every
+*           function of the crypto, TPM and store interfaces. Counters are kept
+*           per thread and merged here so recording them never contends.
+*
+* @return   A snapshot to be released with ::hsm_free_metrics, NULL on error
+*/
+extern HSM_METRICS* hsm_get_metrics(void);
+
+/**
+* @brief    Releases a snapshot returned by ::hsm_get_metrics.
+*
+* @param metrics    The snapshot, may be NULL
+*/
+extern void hsm_free_metrics(HSM_METRICS* metrics);
+
+/**
+* @brief    Returns the largest latency in nanoseconds counted in a histogram bucket.
+*
+* @param bucket     Index of the bucket, less than ::HSM_METRICS_NUM_BUCKETS
+*
+* @return   The upper bound of the bucket, UINT64_MAX for the last bucket
+*/
+extern uint64_t hsm_metrics_bucket_upper_bound(size_t bucket);
+
+/**
+* @brief    Estimates a latency percentile from the histogram of an operation.
+*
+* @param operation      Metrics of an operation in a snapshot
+* @param percentile     Percentile between 0 and 100, for example 99.9
+*
+* @return   The upper bound in nanoseconds of the bucket holding the percentile,
+*           0 when the operation was never called
+*/
+extern uint64_t hsm_metrics_percentile(const HSM_OPERATION_METRICS* operation, double percentile);
+
+/**
+* @brief    Estimates a wait time percentile from the histogram of a lock.
+*
+* @param lock           Metrics of a lock in a snapshot
+* @param percentile     Percentile between 0 and 100, for example 99.9
+*
+* @return   The upper bound in nanoseconds of the bucket holding the percentile,
+*           0 when the lock was never acquired
+*/
+extern uint64_t hsm_metrics_lock_percentile(const HSM_LOCK_METRICS* lock, double percentile);
+
+/**
+* An operation reported to the callbacks set with ::hsm_set_trace_callbacks.
+* Operations made on behalf of another one, such as reading a file while
+* opening a key, have that operation as their parent.
+*/
+typedef struct HSM_TRACE_SPAN_TAG
+{
+    uint64_t id;
+    /* 0 when the operation is not part of another one */
+    uint64_t parent_id;
+    const char* name;
+    /* Alias, key name, file or hash of the identity the operation is for, may be NULL */
+    const char* target;
+    size_t input_size;
+    /* Only set when the operation ends */
+    size_t output_size;
+    /* Only set when the operation ends, 0 on success */
+    int result;
+} HSM_TRACE_SPAN;
+
+typedef void (*HSM_TRACE_CALLBACK)(const HSM_TRACE_SPAN* span, void* context);
+
+/**
+* @brief    Sets the callbacks invoked when a traced operation begins and when
+*           it ends. Both are invoked on the thread doing the operation, which
+*           may be a thread of the library. Tracing costs a single check per
+*           operation while no callbacks are set. The callbacks should be set
+*           before any other call to the library and only be changed or
+*           cleared while no other call is in progress.
+*
+* @param on_begin   Callback invoked when an operation begins
+* @param on_end     Callback invoked when an operation ends
+* @param context    Passed to both callbacks
+*
+* @return   0 on success, non-zero when only one of the callbacks is NULL
+*/
+extern int hsm_set_trace_callbacks(HSM_TRACE_CALLBACK on_begin, HSM_TRACE_CALLBACK on_end, void* context);
+
+/**
+* A slow operation submitted to the asynchronous API. Every ticket must be
+* passed once to either ::hsm_async_get_result or ::hsm_async_cancel.
+*/
+typedef struct HSM_ASYNC_TICKET_TAG* HSM_ASYNC_TICKET;
+
+/**
+* Outcome of an operation submitted to the asynchronous API.
+*/
+typedef struct HSM_ASYNC_RESULT_TAG
+{
+    /* 0 on success */
+    int result;
+    /* Ciphertext, plaintext or digest, to be freed with the ::HSM_CLIENT_FREE_BUFFER
+       of the interface that made it */
+    SIZED_BUFFER output;
+    /* Certificate made by ::hsm_async_create_certificate, to be released with
+       certificate_info_destroy */
+    CERT_INFO_HANDLE certificate;
+} HSM_ASYNC_RESULT;
+
+/**
+* Invoked once per submitted operation, on a thread of the library, when the
+* operation completes. The ticket may be passed to ::hsm_async_get_result from
+* the callback. It is NULL when the operation was cancelled before completing,
+* in which case the client is no longer used by the operation.
+*/
+typedef void (*HSM_ASYNC_CALLBACK)(HSM_ASYNC_TICKET ticket, void* context);
+
+/**
+* @brief    Starts the threads that run operations submitted to the asynchronous
+*           API, so that callers driven by an event loop do not block on key
+*           generation or TPM commands. The crypto and TPM interfaces must be
+*           initialized before operations on them are submitted.
+*
+* @param num_threads    Number of operations run at once, 0 for the default of 4,
+*                       at most 16. Submitted operations beyond that are queued.
+*
+* @return   0 on success, non-zero otherwise
+*/
+extern int hsm_async_init(size_t num_threads);
+
+/**
+* @brief    Waits for the operations already submitted to complete and stops the
+*           threads started by ::hsm_async_init. Every ticket must have been
+*           passed to ::hsm_async_get_result or ::hsm_async_cancel before.
+*/
+extern void hsm_async_deinit(void);
+
+/**
+* @brief    Returns an eventfd whose counter is incremented every time an
+*           operation completes, to be polled by an event loop. Operations
+*           cancelled before completing are counted too.
+*
+* @return   The eventfd, owned by the library, or -1 where eventfd is not
+*           available, in which case callers are notified by callbacks only
+*/
+extern int hsm_async_get_event_fd(void);
+
+/**
+* @brief    Submits ::HSM_CLIENT_CREATE_CERTIFICATE on a crypto client.
+*
+* @param handle             A valid crypto client handle
+* @param certificate_props  Certificate properties, owned by the operation from now on
+*                           and destroyed once it ends, even when submitting fails
+* @param callback           Invoked when the operation completes, may be NULL
+* @param context            Passed to the callback
+*
+* @return   A ticket for the operation, NULL on error
+*/
+extern HSM_ASYNC_TICKET hsm_async_create_certificate(HSM_CLIENT_HANDLE handle, CERT_PROPS_HANDLE certificate_props, HSM_ASYNC_CALLBACK callback, void* context);
+
+/**
+* @brief    Submits ::HSM_CLIENT_ENCRYPT_DATA on a crypto client. The buffers are
+*           copied, they need not outlive this call.
+*
+* @return   A ticket for the operation, NULL on error
+*/
+extern HSM_ASYNC_TICKET hsm_async_encrypt_data(HSM_CLIENT_HANDLE handle, const SIZED_BUFFER* identity, const SIZED_BUFFER* plaintext, const SIZED_BUFFER* init_vector, HSM_ASYNC_CALLBACK callback, void* context);
+
+/**
+* @brief    Submits ::HSM_CLIENT_DECRYPT_DATA on a crypto client. The buffers are
+*           copied, they need not outlive this call.
+*
+* @return   A ticket for the operation, NULL on error
+*/
+extern HSM_ASYNC_TICKET hsm_async_decrypt_data(HSM_CLIENT_HANDLE handle, const SIZED_BUFFER* identity, const SIZED_BUFFER* ciphertext, const SIZED_BUFFER* init_vector, HSM_ASYNC_CALLBACK callback, void* context);
+
+/**
+* @brief    Submits ::HSM_CLIENT_SIGN_WITH_IDENTITY on a TPM client. The data is
+*           copied, it need not outlive this call.
+*
+* @return   A ticket for the operation, NULL on error
+*/
+extern HSM_ASYNC_TICKET hsm_async_sign_with_identity(HSM_CLIENT_HANDLE handle, const unsigned char* data, size_t data_size, HSM_ASYNC_CALLBACK callback, void* context);
+
+/**
+* @brief    Submits ::HSM_CLIENT_DERIVE_AND_SIGN_WITH_IDENTITY on a TPM client.
+*           The data and identity are copied, they need not outlive this call.
+*
+* @return   A ticket for the operation, NULL on error
+*/
+extern HSM_ASYNC_TICKET hsm_async_derive_and_sign_with_identity(HSM_CLIENT_HANDLE handle, const unsigned char* data, size_t data_size, const unsigned char* identity, size_t identity_size, HSM_ASYNC_CALLBACK callback, void* context);
+
+/**
+* @brief    Tells whether an operation has completed, without waiting for it.
+*
+* @return   Non-zero once the operation has completed, 0 otherwise
+*/
+extern int hsm_async_is_complete(HSM_ASYNC_TICKET ticket);
+
+/**
+* @brief    Waits for an operation to complete, moves its outcome to result and
+*           releases the ticket.
+*
+* @param ticket         A ticket returned by one of the hsm_async functions
+* @param[out] result    The outcome of the operation, whose outputs the caller owns
+*
+* @return   0 when the ticket was released, non-zero on invalid parameters
+*/
+extern int hsm_async_get_result(HSM_ASYNC_TICKET ticket, HSM_ASYNC_RESULT* result);
+
+/**
+* @brief    Releases a ticket without waiting. An operation that has not started
+*           is dropped, the outputs of one that is running are freed when it
+*           completes. Either way its callback is invoked with a NULL ticket.
+*/
+extern void hsm_async_cancel(HSM_ASYNC_TICKET ticket);
+
 extern const HSM_CLIENT_TPM_INTERFACE* hsm_client_tpm_interface();
+/**
+* @brief    Returns the SAS key extension of the TPM interface, or NULL when the
+*           TPM does not support named SAS keys.
+*/
+extern const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* hsm_client_tpm_sas_key_interface();
 extern const HSM_CLIENT_X509_INTERFACE* hsm_client_x509_interface();
 extern const HSM_CLIENT_CRYPTO_INTERFACE* hsm_client_crypto_interface();
 
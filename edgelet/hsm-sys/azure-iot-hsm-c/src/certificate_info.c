@@ -9,8 +9,11 @@
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/base64.h"
 #include "azure_c_shared_utility/buffer_.h"
+#include "azure_c_shared_utility/sha.h"
 #include "azure_c_shared_utility/xlogging.h"
 
+#include "hsm_atomic.h"
+
 typedef struct CERT_DATA_INFO_TAG
 {
     char* certificate_pem;
@@ -26,6 +29,9 @@ typedef struct CERT_DATA_INFO_TAG
     const char* first_cert_start;
     const char* first_cert_end;
     char* first_certificate;
+    BUFFER_HANDLE der_certificate;
+    unsigned char thumbprint_sha256[SHA256HashSize];
+    HSM_ATOMIC_LONG ref_count;
 } CERT_DATA_INFO;
 
 typedef enum X509_ASN1_STATE_TAG
@@ -467,6 +473,40 @@ static int parse_asn1_data(unsigned char* section, size_t len, X509_ASN1_STATE s
     return result;
 }
 
+static int compute_thumbprint(const unsigned char* der, size_t der_len, unsigned char* thumbprint)
+{
+    int result;
+    USHAContext ctx;
+    uint8_t digest[USHAMaxHashSize];
+
+    if (der_len > UINT32_MAX)
+    {
+        LogError("Certificate too large to compute thumbprint");
+        result = __LINE__;
+    }
+    else if (USHAReset(&ctx, SHA256) != shaSuccess)
+    {
+        LogError("Failure initializing SHA256 context");
+        result = __LINE__;
+    }
+    else if (USHAInput(&ctx, der, (unsigned int)der_len) != shaSuccess)
+    {
+        LogError("Failure computing SHA256 of the certificate");
+        result = __LINE__;
+    }
+    else if (USHAResult(&ctx, digest) != shaSuccess)
+    {
+        LogError("Failure obtaining SHA256 result");
+        result = __LINE__;
+    }
+    else
+    {
+        memcpy(thumbprint, digest, SHA256HashSize);
+        result = 0;
+    }
+    return result;
+}
+
 static int parse_certificate(CERT_DATA_INFO* cert_info)
 {
     int result;
@@ -483,28 +523,38 @@ static int parse_certificate(CERT_DATA_INFO* cert_info)
         if (parse_asn1_data(cert_buffer, cert_buff_len, STATE_INITIAL, cert_info) != 0)
         {
             LogError("Failure parsing asn1 data field");
+            BUFFER_delete(cert_bin);
+            result = __LINE__;
+        }
+        else if (compute_thumbprint(cert_buffer, cert_buff_len, cert_info->thumbprint_sha256) != 0)
+        {
+            LogError("Failure computing certificate thumbprint");
+            BUFFER_delete(cert_bin);
             result = __LINE__;
         }
         else
         {
+            // keep the decoded leaf around so callers needing
+            // the DER bytes do not have to decode the PEM again
+            cert_info->der_certificate = cert_bin;
             result = 0;
         }
-        BUFFER_delete(cert_bin);
     }
     return result;
 }
 
-CERT_INFO_HANDLE certificate_info_create(const char* certificate, const void* private_key, size_t priv_key_len, PRIVATE_KEY_TYPE pk_type)
+static CERT_DATA_INFO* create_certificate_info
+(
+    const char* certificate,
+    size_t cert_len,
+    const void* private_key,
+    size_t priv_key_len,
+    PRIVATE_KEY_TYPE pk_type
+)
 {
     CERT_DATA_INFO* result;
-    size_t cert_len;
 
-    if (certificate == NULL)
-    {
-        LogError("Invalid certificate parameter specified");
-        result = NULL;
-    }
-    else if ((cert_len = strlen(certificate)) == 0)
+    if (cert_len == 0)
     {
         LogError("Empty certificate string provided");
         result = NULL;
@@ -538,6 +588,7 @@ CERT_INFO_HANDLE certificate_info_create(const char* certificate, const void* pr
     else
     {
         memset(result, 0, sizeof(CERT_DATA_INFO));
+        result->ref_count = 1;
 
         if (cert_len == 0 || (result->certificate_pem = (char*)malloc(cert_len + 1)) == NULL)
         {
@@ -563,6 +614,7 @@ CERT_INFO_HANDLE certificate_info_create(const char* certificate, const void* pr
                 if ((result->first_certificate = (char*)malloc(num_bytes_first_cert + 1)) == NULL)
                 {
                     LogError("Failure allocating memory to hold the main certificate");
+                    BUFFER_delete(result->der_certificate);
                     free(result->certificate_pem);
                     free(result);
                     result = NULL;
@@ -577,6 +629,7 @@ CERT_INFO_HANDLE certificate_info_create(const char* certificate, const void* pr
                         if ((result->private_key = malloc(priv_key_len)) == NULL)
                         {
                             LogError("Failure allocating private key");
+                            BUFFER_delete(result->der_certificate);
                             free(result->first_certificate);
                             free(result->certificate_pem);
                             free(result);
@@ -596,11 +649,159 @@ CERT_INFO_HANDLE certificate_info_create(const char* certificate, const void* pr
     return result;
 }
 
+CERT_INFO_HANDLE certificate_info_create(const char* certificate, const void* private_key, size_t priv_key_len, PRIVATE_KEY_TYPE pk_type)
+{
+    CERT_DATA_INFO* result;
+
+    if (certificate == NULL)
+    {
+        LogError("Invalid certificate parameter specified");
+        result = NULL;
+    }
+    else
+    {
+        result = create_certificate_info(certificate, strlen(certificate), private_key, priv_key_len, pk_type);
+    }
+
+    return result;
+}
+
+CERT_INFO_HANDLE certificate_info_create_from_buffer(const void* certificate, size_t certificate_size, const void* private_key, size_t priv_key_len, PRIVATE_KEY_TYPE pk_type)
+{
+    CERT_DATA_INFO* result;
+
+    if (certificate == NULL)
+    {
+        LogError("Invalid certificate parameter specified");
+        result = NULL;
+    }
+    else
+    {
+        // the PEM ends at the first null character if the buffer has one
+        const char* null_char = (const char*)memchr(certificate, 0, certificate_size);
+        size_t cert_len = (null_char != NULL) ? (size_t)(null_char - (const char*)certificate) : certificate_size;
+        result = create_certificate_info((const char*)certificate, cert_len, private_key, priv_key_len, pk_type);
+    }
+
+    return result;
+}
+
+CERT_INFO_HANDLE certificate_info_append_from_buffer(CERT_INFO_HANDLE handle, const void* certificate, size_t certificate_size)
+{
+    CERT_DATA_INFO* result;
+    CERT_DATA_INFO* appended;
+
+    if ((handle == NULL) || (certificate == NULL))
+    {
+        LogError("Invalid parameter specified");
+        result = NULL;
+    }
+    else if (handle->private_key != NULL)
+    {
+        LogError("Certificates can only be appended to a certificate without a private key");
+        result = NULL;
+    }
+    // only the appended certificate is parsed, which also validates it
+    else if ((appended = certificate_info_create_from_buffer(certificate, certificate_size, NULL, 0, PRIVATE_KEY_UNKNOWN)) == NULL)
+    {
+        LogError("Failure parsing the appended certificate");
+        result = NULL;
+    }
+    else
+    {
+        size_t current_len = strlen(handle->certificate_pem);
+        size_t appended_len = strlen(appended->certificate_pem);
+        size_t total_len = current_len + appended_len;
+
+        if ((total_len < current_len) || (total_len + 1 < total_len))
+        {
+            LogError("Certificate too large to append");
+            result = NULL;
+        }
+        else if ((result = (CERT_DATA_INFO*)malloc(sizeof(CERT_DATA_INFO))) == NULL)
+        {
+            LogError("Failure allocating certificate info");
+        }
+        else
+        {
+            // the leaf of the new object is the leaf of handle, which was
+            // parsed when handle was created, so its fields are carried over
+            memcpy(result, handle, sizeof(CERT_DATA_INFO));
+            result->ref_count = 1;
+            result->first_certificate = NULL;
+            result->der_certificate = NULL;
+
+            if ((result->certificate_pem = (char*)malloc(total_len + 1)) == NULL)
+            {
+                LogError("Failure allocating certificate");
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                size_t first_cert_len = strlen(handle->first_certificate);
+                size_t chain_offset = (handle->cert_chain != NULL) ?
+                                      (size_t)(handle->cert_chain - handle->certificate_pem) :
+                                      (size_t)(handle->first_cert_end - handle->certificate_pem) + 1;
+
+                memcpy(result->certificate_pem, handle->certificate_pem, current_len);
+                memcpy(result->certificate_pem + current_len, appended->certificate_pem, appended_len + 1);
+                result->first_cert_start = result->certificate_pem + (handle->first_cert_start - handle->certificate_pem);
+                result->first_cert_end = result->certificate_pem + (handle->first_cert_end - handle->certificate_pem);
+                result->cert_chain = (chain_offset < total_len) ? result->certificate_pem + chain_offset : NULL;
+
+                if ((result->first_certificate = (char*)malloc(first_cert_len + 1)) == NULL)
+                {
+                    LogError("Failure allocating memory to hold the main certificate");
+                    free(result->certificate_pem);
+                    free(result);
+                    result = NULL;
+                }
+                else if ((result->der_certificate = BUFFER_create(BUFFER_u_char(handle->der_certificate), BUFFER_length(handle->der_certificate))) == NULL)
+                {
+                    LogError("Failure allocating memory to hold the DER certificate");
+                    free(result->first_certificate);
+                    free(result->certificate_pem);
+                    free(result);
+                    result = NULL;
+                }
+                else
+                {
+                    memcpy(result->first_certificate, handle->first_certificate, first_cert_len + 1);
+                }
+            }
+        }
+        certificate_info_destroy(appended);
+    }
+
+    return result;
+}
+
+CERT_INFO_HANDLE certificate_info_clone(CERT_INFO_HANDLE handle)
+{
+    CERT_INFO_HANDLE result;
+    if (handle == NULL)
+    {
+        LogError("Invalid parameter specified");
+        result = NULL;
+    }
+    else
+    {
+        // the certificate data is immutable once created so
+        // a clone only needs to share it with the new owner
+        (void)hsm_atomic_inc(&handle->ref_count);
+        result = handle;
+    }
+    return result;
+}
+
 void certificate_info_destroy(CERT_INFO_HANDLE handle)
 {
     CERT_DATA_INFO* cert_info = (CERT_DATA_INFO*)handle;
-    if (cert_info != NULL)
+    if ((cert_info != NULL) && (hsm_atomic_dec(&cert_info->ref_count) == 0))
     {
+        BUFFER_delete(cert_info->der_certificate);
+        cert_info->der_certificate = NULL;
         free(cert_info->first_certificate);
         cert_info->first_certificate = NULL;
         free(cert_info->certificate_pem);
@@ -629,6 +830,38 @@ const char* certificate_info_get_leaf_certificate(CERT_INFO_HANDLE handle)
     return result;
 }
 
+const unsigned char* certificate_info_get_der(CERT_INFO_HANDLE handle, size_t* der_len)
+{
+    const unsigned char* result;
+    if (handle == NULL || der_len == NULL)
+    {
+        LogError("Invalid parameter specified");
+        result = NULL;
+    }
+    else
+    {
+        result = BUFFER_u_char(handle->der_certificate);
+        *der_len = BUFFER_length(handle->der_certificate);
+    }
+    return result;
+}
+
+const unsigned char* certificate_info_get_thumbprint_sha256(CERT_INFO_HANDLE handle, size_t* thumbprint_len)
+{
+    const unsigned char* result;
+    if (handle == NULL || thumbprint_len == NULL)
+    {
+        LogError("Invalid parameter specified");
+        result = NULL;
+    }
+    else
+    {
+        result = handle->thumbprint_sha256;
+        *thumbprint_len = sizeof(handle->thumbprint_sha256);
+    }
+    return result;
+}
+
 const char* certificate_info_get_certificate(CERT_INFO_HANDLE handle)
 {
     const char* result;
@@ -8,6 +8,10 @@ const char* const ENV_DEVICE_PK_PATH = "IOTEDGE_DEVICE_CA_PK";
 const char* const ENV_TRUSTED_CA_CERTS_PATH = "IOTEDGE_TRUSTED_CA_CERTS";
 const char* const ENV_TPM_SELECT = "IOTEDGE_USE_TPM_DEVICE";
 
+/* HSM C env variables */
+const char* const ENV_STORE_BACKEND = "IOTEDGE_HSM_STORE_BACKEND";
+const char* const ENV_WATCH_CERTS = "IOTEDGE_HSM_WATCH_CERTS";
+
 /* HSM directory name under IOTEDGE_HOMEDIR */
 const char* const DEFAULT_EDGE_HOME_DIR_UNIX = "/var/lib/iotedge"; // note MacOS is included
 const char* const DEFAULT_EDGE_BASE_DIR_ENV_WIN = "ProgramData";
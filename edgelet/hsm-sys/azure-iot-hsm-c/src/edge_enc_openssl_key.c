@@ -5,6 +5,7 @@
 
 #include "azure_c_shared_utility/gballoc.h"
 #include "hsm_client_store.h"
+#include "hsm_key_mem.h"
 #include "hsm_log.h"
 #include "edge_openssl_common.h"
 
@@ -551,9 +552,9 @@ static void enc_key_destroy(KEY_HANDLE key_handle)
     {
         if (enc_key->key != NULL)
         {
-            free(enc_key->key);
+            hsm_key_mem_free(enc_key->key, enc_key->key_size);
         }
-        free(enc_key);
+        hsm_key_mem_free(enc_key, sizeof(ENC_KEY));
     }
 }
 
@@ -568,15 +569,15 @@ KEY_HANDLE create_encryption_key(const unsigned char *key, size_t key_size)
     }
     else
     {
-        enc_key = (ENC_KEY*)malloc(sizeof(ENC_KEY));
+        enc_key = (ENC_KEY*)hsm_key_mem_alloc(sizeof(ENC_KEY));
         if (enc_key == NULL)
         {
             LOG_ERROR("Could not allocate memory for ENC_KEY");
         }
-        else if ((enc_key->key = (unsigned char*)malloc(key_size)) == NULL)
+        else if ((enc_key->key = (unsigned char*)hsm_key_mem_alloc(key_size)) == NULL)
         {
             LOG_ERROR("Could not allocate memory for encryption key creation");
-            free(enc_key);
+            hsm_key_mem_free(enc_key, sizeof(ENC_KEY));
             enc_key = NULL;
         }
         else
@@ -1,7 +1,6 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 #include <stdbool.h>
 
 #include "azure_c_shared_utility/gballoc.h"
@@ -9,6 +8,8 @@
 #include "hsm_client_store.h"
 #include "hsm_log.h"
 #include "hsm_constants.h"
+#include "hsm_metrics.h"
+#include "hsm_random.h"
 
 struct EDGE_CRYPTO_TAG
 {
@@ -48,7 +49,6 @@ int hsm_client_crypto_init(void)
             g_is_crypto_initialized = true;
             g_hsm_store_if = store_if;
             g_hsm_key_if = key_if;
-			srand((unsigned int)time(NULL));
             result = 0;
         }
     }
@@ -77,6 +77,7 @@ void hsm_client_crypto_deinit(void)
         g_hsm_key_if = NULL;
         g_is_crypto_initialized = false;
     }
+    log_shutdown();
 }
 
 static void edge_hsm_crypto_free_buffer(void * buffer)
@@ -156,14 +157,13 @@ static int edge_hsm_client_get_random_bytes(HSM_CLIENT_HANDLE handle, unsigned c
         LOG_ERROR("Invalid number of bytes specified");
         result = __FAILURE__;
     }
+    else if (hsm_random_bytes(rand_buffer, num_bytes) != 0)
+    {
+        LOG_ERROR("Could not generate random bytes");
+        result = __FAILURE__;
+    }
     else
     {
-        // todo use OpenSSL RAND_BUFFER and CNG rand API
-        size_t count;
-        for (count = 0; count < num_bytes; count++)
-        {
-            *rand_buffer++ = rand() % 256;
-        }
         result = 0;
     }
     return result;
@@ -539,5 +539,5 @@ static const HSM_CLIENT_CRYPTO_INTERFACE edge_hsm_crypto_interface =
 
 const HSM_CLIENT_CRYPTO_INTERFACE* hsm_client_crypto_interface(void)
 {
-    return &edge_hsm_crypto_interface;
+    return hsm_metrics_crypto_interface(&edge_hsm_crypto_interface);
 }
@@ -1,18 +1,35 @@
 #include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/base64.h"
 #include "azure_c_shared_utility/buffer_.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/lock.h"
 #include "azure_c_shared_utility/strings.h"
 #include "azure_c_shared_utility/singlylinkedlist.h"
 #include "azure_c_shared_utility/sha.h"
 
+#include "hsm_atomic.h"
 #include "hsm_client_data.h"
 #include "hsm_client_store.h"
 #include "hsm_constants.h"
+#include "hsm_fault.h"
+#include "hsm_file_watch.h"
 #include "hsm_key.h"
+#include "hsm_key_mem.h"
+#include "hsm_lock.h"
 #include "hsm_log.h"
+#include "hsm_metrics.h"
+#include "hsm_random.h"
+#include "hsm_rcu.h"
+#include "hsm_slab.h"
+#include "hsm_store_index.h"
+#include "hsm_store_log.h"
+#include "hsm_trace.h"
 #include "hsm_utils.h"
 
 //##############################################################################
@@ -29,10 +46,15 @@
 // local normalized file storage defines
 #define NUM_NORMALIZED_ALIAS_CHARS  32
 
+// number of key entries carved out of each key slab page
+#define KEY_ENTRIES_PER_SLAB_PAGE 64
+
 struct STORE_ENTRY_KEY_TAG
 {
     STRING_HANDLE id;
-    BUFFER_HANDLE key;
+    // allocated from key memory so the key is never in swappable heap
+    unsigned char *key;
+    size_t key_size;
 };
 typedef struct STORE_ENTRY_KEY_TAG STORE_ENTRY_KEY;
 
@@ -52,30 +74,67 @@ struct STORE_ENTRY_PKI_TRUSTED_CERT_TAG
 };
 typedef struct STORE_ENTRY_PKI_TRUSTED_CERT_TAG STORE_ENTRY_PKI_TRUSTED_CERT;
 
+typedef enum STORE_SNAPSHOT_INDEX_TAG
+{
+    SNAPSHOT_SAS_KEYS = 0,
+    SNAPSHOT_ENC_KEYS,
+    SNAPSHOT_PKI_CERTS,
+    SNAPSHOT_NUM_INDEXES
+} STORE_SNAPSHOT_INDEX;
+
+// keys and certs indexed by alias along with the trusted certs bundle, a
+// published snapshot is never modified
+struct STORE_SNAPSHOT_TAG
+{
+    STORE_INDEX_HANDLE indexes[SNAPSHOT_NUM_INDEXES];
+    CERT_INFO_HANDLE pki_trusted_certs_bundle;
+};
+typedef struct STORE_SNAPSHOT_TAG STORE_SNAPSHOT;
+
 struct CRYPTO_STORE_ENTRY_TAG
 {
-    SINGLYLINKEDLIST_HANDLE sas_keys;
-    SINGLYLINKEDLIST_HANDLE sym_enc_keys;
-    SINGLYLINKEDLIST_HANDLE pki_certs;
+    STORE_SNAPSHOT * volatile snapshot;
+    HSM_RCU_HANDLE rcu;
+    LOCK_HANDLE writer_lock;
+#if defined(HSM_LOCK_PROFILING)
+    // threads holding or waiting for the writer lock
+    HSM_ATOMIC_LONG writers;
+#endif
+    // trusted certs are kept in a list since the trusted certs bundle is
+    // built in insert order, the list and its index are only used by writers
     SINGLYLINKEDLIST_HANDLE pki_trusted_certs;
+    STORE_INDEX_HANDLE pki_trusted_certs_index;
+    // backing memory for the SAS and encryption key entries
+    HSM_SLAB_HANDLE key_entries;
+    // persists encryption keys when the log backend is selected, NULL when
+    // each key is persisted in its own file
+    HSM_STORE_LOG_HANDLE enc_keys_log;
+    // watches externally provisioned certificates when enabled, else NULL
+    HSM_FILE_WATCH_HANDLE cert_watch;
 };
 typedef struct CRYPTO_STORE_ENTRY_TAG CRYPTO_STORE_ENTRY;
 
 struct CRYPTO_STORE_TAG
 {
     STRING_HANDLE id;
+    // directory holding the certificates and keys of this store only
+    STRING_HANDLE base_dir;
     CRYPTO_STORE_ENTRY* store_entry;
+    // creators of the store, it stays provisioned until the last one destroys it
+    int create_count;
+    // references held by the registry while provisioned and by each open handle
     int ref_count;
+    // cleared when the store is destroyed, handles still open then fail
+    // every operation but close
+    HSM_ATOMIC_LONG provisioned;
+    // set while its creator provisions the store without holding the registry
+    // lock, other callers for the same store wait until it is cleared
+    bool provisioning;
+    // next store in the registry
+    struct CRYPTO_STORE_TAG *next;
 };
 typedef struct CRYPTO_STORE_TAG CRYPTO_STORE;
 
-typedef enum HSM_STATE_TAG_T
-{
-    HSM_STATE_UNPROVISIONED = 0,
-    HSM_STATE_PROVISIONED,
-    HSM_STATE_PROVISIONING_ERROR
-} HSM_STATE_T;
-
 #if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
     static const char *SLASH = "\\";
 #else
@@ -88,11 +147,30 @@ static const char *ENC_KEYS_DIR     = "enc_keys";
 static const char *CERT_FILE_EXT    = ".cert.pem";
 static const char *PK_FILE_EXT      = ".key.pem";
 static const char *ENC_KEY_FILE_EXT = ".enc.key";
-
-static HSM_STATE_T g_hsm_state = HSM_STATE_UNPROVISIONED;
-
-static CRYPTO_STORE* g_crypto_store = NULL;
-static int g_store_ref_count = 0;
+static const char *VERIFIED_MANIFEST_FILE = "verified_certs.manifest";
+static const char *ENC_KEYS_LOG_FILE = "enc_keys.log";
+// stores other than the edge store live in a sub dir of this dir
+static const char *STORES_DIR       = "stores";
+
+// values of ENV_STORE_BACKEND
+static const char *STORE_BACKEND_FILES = "files";
+static const char *STORE_BACKEND_LOG   = "log";
+
+// values of ENV_WATCH_CERTS
+static const char *WATCH_CERTS_ON  = "on";
+static const char *WATCH_CERTS_OFF = "off";
+
+// certificates expiring within this many seconds are always fully verified
+#define VERIFIED_MANIFEST_MIN_VALIDITY_SECS (24 * 60 * 60)
+
+// stores which are provisioned or still open, guarded by the registry lock
+static CRYPTO_STORE* g_crypto_stores = NULL;
+// created on first use since the store interface has no global init
+static LOCK_HANDLE volatile g_registry_lock = NULL;
+// posted once per waiter when a store is done provisioning, created on first
+// wait and guarded by the registry lock like the waiter count
+static COND_HANDLE g_registry_cond = NULL;
+static int g_registry_waiters = 0;
 
 //##############################################################################
 // Forward declarations
@@ -130,119 +208,249 @@ static int verify_certificate_helper
     bool *verification_status
 );
 
-static const char* get_base_dir(void);
 //##############################################################################
-// STORE_ENTRY_KEY helpers
+// Store snapshots
 //##############################################################################
-static bool find_key_cb(LIST_ITEM_HANDLE list_item, const void *match_context)
+/**
+ * Readers look up keys, certificates and the trusted certs bundle through
+ * the current snapshot inside an RCU read section without taking any lock,
+ * so signing and encryption never wait on writers such as a certificate
+ * being generated. Writers are serialized by the writer lock. They copy the
+ * index they modify, publish a new snapshot sharing everything else with
+ * the current one, and wait for the readers of the previous snapshot before
+ * releasing whatever only it referred to. Entries found through a snapshot
+ * are only valid until the read section ends.
+ */
+static const STORE_SNAPSHOT* begin_store_read(const CRYPTO_STORE *store, HSM_RCU_READER *reader)
+{
+    *reader = hsm_rcu_read_lock(store->store_entry->rcu);
+    return (const STORE_SNAPSHOT*)hsm_atomic_load_ptr((void * volatile *)&store->store_entry->snapshot);
+}
+
+static void end_store_read(const CRYPTO_STORE *store, HSM_RCU_READER reader)
+{
+    hsm_rcu_read_unlock(store->store_entry->rcu, reader);
+}
+
+static int lock_store_writer(const CRYPTO_STORE *store)
+{
+    int result;
+#if defined(HSM_LOCK_PROFILING)
+    bool contended = (hsm_atomic_inc(&store->store_entry->writers) > 1);
+    uint64_t start = contended ? hsm_metrics_now() : 0;
+#endif
+
+    if (Lock(store->store_entry->writer_lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not acquire the store writer lock");
+#if defined(HSM_LOCK_PROFILING)
+        (void)hsm_atomic_dec(&store->store_entry->writers);
+#endif
+        result = __FAILURE__;
+    }
+    else
+    {
+#if defined(HSM_LOCK_PROFILING)
+        hsm_metrics_lock_wait(HSM_METRICS_LOCK_STORE_WRITER, start, contended);
+#endif
+        result = 0;
+    }
+
+    return result;
+}
+
+static void unlock_store_writer(const CRYPTO_STORE *store)
+{
+    if (Unlock(store->store_entry->writer_lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not release the store writer lock");
+    }
+#if defined(HSM_LOCK_PROFILING)
+    (void)hsm_atomic_dec(&store->store_entry->writers);
+#endif
+}
+
+// writers may read the current snapshot directly while holding the writer lock
+static STORE_SNAPSHOT* get_current_snapshot(const CRYPTO_STORE *store)
+{
+    return store->store_entry->snapshot;
+}
+
+static STORE_SNAPSHOT* create_snapshot(void)
 {
-    bool result;
+    STORE_SNAPSHOT *result;
 
-    STORE_ENTRY_KEY *key = (STORE_ENTRY_KEY*)singlylinkedlist_item_get_value(list_item);
-    if (strcmp(STRING_c_str(key->id), (const char*)match_context) == 0)
+    if ((result = (STORE_SNAPSHOT*)calloc(1, sizeof(STORE_SNAPSHOT))) == NULL)
     {
-        result = true;
+        LOG_ERROR("Could not allocate memory for store snapshot");
     }
     else
     {
-        result = false;
+        int idx;
+        for (idx = 0; idx < SNAPSHOT_NUM_INDEXES; idx++)
+        {
+            if ((result->indexes[idx] = store_index_create()) == NULL)
+            {
+                LOG_ERROR("Could not allocate store snapshot index");
+                while (idx-- > 0)
+                {
+                    store_index_destroy(result->indexes[idx], NULL);
+                }
+                free(result);
+                result = NULL;
+                break;
+            }
+        }
     }
 
     return result;
 }
 
+// releases the snapshot along with the indexes and bundle it does not
+// share with the other snapshot, the indexed entries are left untouched
+static void release_snapshot(STORE_SNAPSHOT *snapshot, const STORE_SNAPSHOT *other)
+{
+    int idx;
+
+    for (idx = 0; idx < SNAPSHOT_NUM_INDEXES; idx++)
+    {
+        if ((other == NULL) || (snapshot->indexes[idx] != other->indexes[idx]))
+        {
+            store_index_destroy(snapshot->indexes[idx], NULL);
+        }
+    }
+    if ((snapshot->pki_trusted_certs_bundle != NULL) &&
+        ((other == NULL) || (snapshot->pki_trusted_certs_bundle != other->pki_trusted_certs_bundle)))
+    {
+        certificate_info_destroy(snapshot->pki_trusted_certs_bundle);
+    }
+    free(snapshot);
+}
 
-static STORE_ENTRY_KEY* get_key(const CRYPTO_STORE *store, HSM_KEY_T key_type, const char *key_name)
+// copies the current snapshot along with the index that is about to be
+// modified, SNAPSHOT_NUM_INDEXES copies none of the indexes
+static STORE_SNAPSHOT* begin_snapshot_update(const CRYPTO_STORE *store, STORE_SNAPSHOT_INDEX index)
 {
-    STORE_ENTRY_KEY *result = NULL;
-    SINGLYLINKEDLIST_HANDLE key_list = (key_type == HSM_KEY_SAS) ? store->store_entry->sas_keys :
-                                                                   store->store_entry->sym_enc_keys;
-    LIST_ITEM_HANDLE list_item = singlylinkedlist_find(key_list, find_key_cb, key_name);
-    if (list_item != NULL)
+    STORE_SNAPSHOT *result;
+    const STORE_SNAPSHOT *current = get_current_snapshot(store);
+
+    if ((result = (STORE_SNAPSHOT*)malloc(sizeof(STORE_SNAPSHOT))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for store snapshot");
+    }
+    else
     {
-        result = (STORE_ENTRY_KEY*)singlylinkedlist_item_get_value(list_item);
+        *result = *current;
+        if ((index != SNAPSHOT_NUM_INDEXES) &&
+            ((result->indexes[index] = store_index_clone(current->indexes[index])) == NULL))
+        {
+            LOG_ERROR("Could not copy store snapshot index");
+            free(result);
+            result = NULL;
+        }
     }
 
     return result;
 }
 
+static void discard_snapshot_update(const CRYPTO_STORE *store, STORE_SNAPSHOT *snapshot)
+{
+    release_snapshot(snapshot, get_current_snapshot(store));
+}
+
+static void publish_snapshot(CRYPTO_STORE *store, STORE_SNAPSHOT *snapshot)
+{
+    STORE_SNAPSHOT *previous = get_current_snapshot(store);
+
+    hsm_atomic_store_ptr((void * volatile *)&store->store_entry->snapshot, snapshot);
+    // once this returns no reader can still be using the previous snapshot
+    // or any entry that was removed from it
+#if defined(HSM_LOCK_PROFILING)
+    uint64_t start = hsm_metrics_now();
+    hsm_rcu_synchronize(store->store_entry->rcu);
+    // readers are not tracked, every wait is counted as uncontended
+    hsm_metrics_lock_wait(HSM_METRICS_LOCK_STORE_RCU_SYNCHRONIZE, start, false);
+#else
+    hsm_rcu_synchronize(store->store_entry->rcu);
+#endif
+    release_snapshot(previous, snapshot);
+}
+
+//##############################################################################
+// STORE_ENTRY_KEY helpers
+//##############################################################################
+static STORE_SNAPSHOT_INDEX get_key_index(HSM_KEY_T key_type)
+{
+    return (key_type == HSM_KEY_SAS) ? SNAPSHOT_SAS_KEYS : SNAPSHOT_ENC_KEYS;
+}
+
+static STORE_ENTRY_KEY* get_key(const STORE_SNAPSHOT *snapshot, HSM_KEY_T key_type, const char *key_name)
+{
+    return (STORE_ENTRY_KEY*)store_index_find(snapshot->indexes[get_key_index(key_type)], key_name);
+}
+
 static bool key_exists(const CRYPTO_STORE *store, HSM_KEY_T key_type, const char *key_name)
 {
-    STORE_ENTRY_KEY *entry = get_key(store, key_type, key_name);
+    HSM_RCU_READER reader;
+    const STORE_SNAPSHOT *snapshot = begin_store_read(store, &reader);
+    STORE_ENTRY_KEY *entry = get_key(snapshot, key_type, key_name);
+    end_store_read(store, reader);
     return (entry != NULL) ? true : false;
 }
 
 static STORE_ENTRY_KEY* create_key_entry
 (
+    const CRYPTO_STORE *store,
     const char *key_name,
     const unsigned char* key,
     size_t key_size
 )
 {
     STORE_ENTRY_KEY *result;
+    HSM_SLAB_HANDLE key_entries = store->store_entry->key_entries;
 
-    if ((result = malloc(sizeof(STORE_ENTRY_KEY))) == NULL)
+    if ((result = (STORE_ENTRY_KEY*)hsm_slab_alloc(key_entries)) == NULL)
     {
         LOG_ERROR("Could not allocate memory to store the key %s", key_name);
     }
     else if ((result->id = STRING_construct(key_name)) == NULL)
     {
         LOG_ERROR("Could not allocate string handle for key %s", key_name);
-        free(result);
+        hsm_slab_free(key_entries, result);
         result = NULL;
     }
-    else if ((result->key = BUFFER_create(key, key_size)) == NULL)
+    else if ((result->key = (unsigned char*)hsm_key_mem_alloc(key_size)) == NULL)
     {
-        LOG_ERROR("Could not allocate buffer for key %s", key_name);
+        LOG_ERROR("Could not allocate key memory for key %s", key_name);
         STRING_delete(result->id);
-        free(result);
+        hsm_slab_free(key_entries, result);
         result = NULL;
     }
+    else
+    {
+        memcpy(result->key, key, key_size);
+        result->key_size = key_size;
+    }
 
     return result;
 }
 
-static void destroy_key(STORE_ENTRY_KEY *key)
+static void destroy_key_contents(STORE_ENTRY_KEY *key)
 {
     STRING_delete(key->id);
-    BUFFER_delete(key->key);
-    free(key);
+    hsm_key_mem_free(key->key, key->key_size);
 }
 
-static void destroy_keys(SINGLYLINKEDLIST_HANDLE keys)
+static void destroy_key(const CRYPTO_STORE *store, STORE_ENTRY_KEY *key)
 {
-    LIST_ITEM_HANDLE list_item;
-    while ((list_item = singlylinkedlist_get_head_item(keys)) != NULL)
-    {
-        STORE_ENTRY_KEY *key_entry = (STORE_ENTRY_KEY*)singlylinkedlist_item_get_value(list_item);
-        destroy_key(key_entry);
-        singlylinkedlist_remove(keys, list_item);
-    }
+    destroy_key_contents(key);
+    hsm_slab_free(store->store_entry->key_entries, key);
 }
 
-static bool remove_key_entry_cb
-(
-    const void *item,
-    const void *match_context,
-    bool *continue_processing
-)
+static void destroy_key_entry_cb(void *value)
 {
-    bool result;
-    STORE_ENTRY_KEY* key = (STORE_ENTRY_KEY*)item;
-
-    if (strcmp(STRING_c_str(key->id), (const char*)match_context) == 0)
-    {
-        destroy_key(key);
-        *continue_processing = false;
-        result = true;
-    }
-    else
-    {
-        *continue_processing = true;
-        result = false;
-    }
-
-    return result;
+    // the entry itself is released along with the key slab
+    destroy_key_contents((STORE_ENTRY_KEY*)value);
 }
 
 static int put_key
@@ -255,24 +463,46 @@ static int put_key
 )
 {
     int result;
-    STORE_ENTRY_KEY *key_entry;
-    SINGLYLINKEDLIST_HANDLE key_list = (key_type == HSM_KEY_SAS) ? store->store_entry->sas_keys :
-                                                                   store->store_entry->sym_enc_keys;
-    (void)singlylinkedlist_remove_if(key_list, remove_key_entry_cb, key_name);
-    if ((key_entry = create_key_entry(key_name, key, key_size)) == NULL)
-    {
-        LOG_ERROR("Could not allocate memory to store key %s", key_name);
-        result = __FAILURE__;
-    }
-    else if (singlylinkedlist_add(key_list, key_entry) == NULL)
+    STORE_SNAPSHOT_INDEX index = get_key_index(key_type);
+
+    if (lock_store_writer(store) != 0)
     {
-        LOG_ERROR("Could not insert key in the key store");
-        destroy_key(key_entry);
         result = __FAILURE__;
     }
     else
     {
-        result = 0;
+        STORE_ENTRY_KEY *key_entry;
+        STORE_SNAPSHOT *update;
+        void *replaced_entry = NULL;
+
+        if ((key_entry = create_key_entry(store, key_name, key, key_size)) == NULL)
+        {
+            LOG_ERROR("Could not allocate memory to store key %s", key_name);
+            result = __FAILURE__;
+        }
+        else if ((update = begin_snapshot_update(store, index)) == NULL)
+        {
+            LOG_ERROR("Could not update the key store");
+            destroy_key(store, key_entry);
+            result = __FAILURE__;
+        }
+        else if (store_index_put(update->indexes[index], STRING_c_str(key_entry->id), key_entry, &replaced_entry) != 0)
+        {
+            LOG_ERROR("Could not insert key in the key store");
+            discard_snapshot_update(store, update);
+            destroy_key(store, key_entry);
+            result = __FAILURE__;
+        }
+        else
+        {
+            publish_snapshot(store, update);
+            if (replaced_entry != NULL)
+            {
+                destroy_key(store, (STORE_ENTRY_KEY*)replaced_entry);
+            }
+            result = 0;
+        }
+        unlock_store_writer(store);
     }
 
     return result;
@@ -286,20 +516,35 @@ static int remove_key
 )
 {
     int result;
-    SINGLYLINKEDLIST_HANDLE key_list = (key_type == HSM_KEY_SAS) ? store->store_entry->sas_keys :
-                                                                   store->store_entry->sym_enc_keys;
-    LIST_ITEM_HANDLE list_item = singlylinkedlist_find(key_list, find_key_cb, key_name);
-    if (list_item == NULL)
+    STORE_SNAPSHOT_INDEX index = get_key_index(key_type);
+
+    if (lock_store_writer(store) != 0)
     {
-        LOG_DEBUG("Key not found %s", key_name);
         result = __FAILURE__;
     }
     else
     {
-        STORE_ENTRY_KEY *key_entry = (STORE_ENTRY_KEY*)singlylinkedlist_item_get_value(list_item);
-        destroy_key(key_entry);
-        singlylinkedlist_remove(key_list, list_item);
-        result = 0;
+        STORE_ENTRY_KEY *key_entry;
+        STORE_SNAPSHOT *update;
+
+        if (store_index_find(get_current_snapshot(store)->indexes[index], key_name) == NULL)
+        {
+            LOG_DEBUG("Key not found %s", key_name);
+            result = __FAILURE__;
+        }
+        else if ((update = begin_snapshot_update(store, index)) == NULL)
+        {
+            LOG_ERROR("Could not update the key store");
+            result = __FAILURE__;
+        }
+        else
+        {
+            key_entry = (STORE_ENTRY_KEY*)store_index_remove(update->indexes[index], key_name);
+            publish_snapshot(store, update);
+            destroy_key(store, key_entry);
+            result = 0;
+        }
+        unlock_store_writer(store);
     }
 
     return result;
@@ -308,37 +553,60 @@ static int remove_key
 //##############################################################################
 // STORE_ENTRY_PKI_CERT helpers
 //##############################################################################
-static bool find_pki_cert_cb(LIST_ITEM_HANDLE list_item, const void *match_context)
+static STORE_ENTRY_PKI_CERT* get_pki_cert
+(
+    const STORE_SNAPSHOT *snapshot,
+    const char *cert_alias
+)
 {
-    bool result;
-    STORE_ENTRY_PKI_CERT *cert = (STORE_ENTRY_PKI_CERT*)singlylinkedlist_item_get_value(list_item);
-    if (strcmp(STRING_c_str(cert->id), (const char*)match_context) == 0)
-    {
-        result = true;
-    }
-    else
-    {
-        result = false;
-    }
-
-    return result;
+    return (STORE_ENTRY_PKI_CERT*)store_index_find(snapshot->indexes[SNAPSHOT_PKI_CERTS], cert_alias);
 }
 
-static STORE_ENTRY_PKI_CERT* get_pki_cert
+// copies the file paths of a certificate so that they remain valid after the
+// read section ends, the private key file path is only copied if requested
+static int get_pki_cert_paths
 (
     const CRYPTO_STORE *store,
-    const char *cert_alias
+    const char *cert_alias,
+    STRING_HANDLE *cert_file,
+    STRING_HANDLE *private_key_file
 )
 {
-    STORE_ENTRY_PKI_CERT *result = NULL;
-    SINGLYLINKEDLIST_HANDLE certs_list = store->store_entry->pki_certs;
-    LIST_ITEM_HANDLE list_item = singlylinkedlist_find(certs_list,
-                                                       find_pki_cert_cb,
-                                                       cert_alias);
-    if (list_item != NULL)
+    int result;
+    HSM_RCU_READER reader;
+    STORE_ENTRY_PKI_CERT *cert_entry;
+    const STORE_SNAPSHOT *snapshot = begin_store_read(store, &reader);
+
+    *cert_file = NULL;
+    if (private_key_file != NULL)
+    {
+        *private_key_file = NULL;
+    }
+
+    if ((cert_entry = get_pki_cert(snapshot, cert_alias)) == NULL)
+    {
+        LOG_DEBUG("Certificate not found %s", cert_alias);
+        result = __FAILURE__;
+    }
+    else if ((*cert_file = STRING_clone(cert_entry->cert_file)) == NULL)
     {
-        result = (STORE_ENTRY_PKI_CERT*)singlylinkedlist_item_get_value(list_item);
+        LOG_ERROR("Could not copy certificate file path for %s", cert_alias);
+        result = __FAILURE__;
+    }
+    else if ((private_key_file != NULL) &&
+             ((*private_key_file = STRING_clone(cert_entry->private_key_file)) == NULL))
+    {
+        LOG_ERROR("Could not copy private key file path for %s", cert_alias);
+        STRING_delete(*cert_file);
+        *cert_file = NULL;
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
     }
+    end_store_read(store, reader);
+
     return result;
 }
 
@@ -376,6 +644,39 @@ static int make_new_dir_relative_to_dir(const char *relative_dir, const char *ne
     return result;
 }
 
+static int make_store_dirs(const char *store_dir)
+{
+    int result;
+
+    if (make_dir(store_dir) != 0)
+    {
+        LOG_ERROR("Could not make HSM dir %s", store_dir);
+        result = __FAILURE__;
+    }
+    // make the certs and keys dirs
+    else if (make_new_dir_relative_to_dir(store_dir, CERTS_DIR) != 0)
+    {
+        LOG_ERROR("Could not make HSM certs dir under %s", store_dir);
+        result = __FAILURE__;
+    }
+    else if (make_new_dir_relative_to_dir(store_dir, CERT_KEYS_DIR) != 0)
+    {
+        LOG_ERROR("Could not make HSM cert keys dir under %s", store_dir);
+        result = __FAILURE__;
+    }
+    else if (make_new_dir_relative_to_dir(store_dir, ENC_KEYS_DIR) != 0)
+    {
+        LOG_ERROR("Could not make HSM encryption keys dir under %s", store_dir);
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
 static const char* obtain_default_platform_base_dir(void)
 {
     const char *result;
@@ -526,34 +827,11 @@ static const char* get_base_dir(void)
                 else
                 {
                     result = STRING_c_str(base_dir_path);
-                    if (make_dir(result) != 0)
+                    if (make_store_dirs(result) != 0)
                     {
-                        LOG_ERROR("Could not make HSM dir %s", result);
                         status = __FAILURE__;
                         result = NULL;
                     }
-                    else
-                    {
-                        // make the certs and keys dirs
-                        if (make_new_dir_relative_to_dir(result, CERTS_DIR) != 0)
-                        {
-                            LOG_ERROR("Could not make HSM certs dir under %s", result);
-                            status = __FAILURE__;
-                            result = NULL;
-                        }
-                        else if (make_new_dir_relative_to_dir(result, CERT_KEYS_DIR) != 0)
-                        {
-                            LOG_ERROR("Could not make HSM cert keys dir under %s", result);
-                            status = __FAILURE__;
-                            result = NULL;
-                        }
-                        else if (make_new_dir_relative_to_dir(result, ENC_KEYS_DIR) != 0)
-                        {
-                            LOG_ERROR("Could not make HSM encryption keys dir under %s", result);
-                            status = __FAILURE__;
-                            result = NULL;
-                        }
-                    }
                 }
             }
         }
@@ -678,10 +956,57 @@ static STRING_HANDLE normalize_alias_file_path(const char *alias)
     return result;
 }
 
-static int build_cert_file_paths(const char *alias, STRING_HANDLE cert_file, STRING_HANDLE pk_file)
+static STRING_HANDLE build_store_base_dir(const char *store_name)
+{
+    STRING_HANDLE result;
+    STRING_HANDLE normalized_name = NULL;
+    const char *hsm_dir;
+
+    if ((hsm_dir = get_base_dir()) == NULL)
+    {
+        LOG_ERROR("HSM base directory does not exist. "
+                  "Set environment variable IOTEDGE_HOMEDIR to a valid path.");
+        result = NULL;
+    }
+    else if ((result = STRING_construct(hsm_dir)) == NULL)
+    {
+        LOG_ERROR("Could not allocate base dir for store %s", store_name);
+    }
+    else if (strcmp(store_name, EDGE_STORE_NAME) == 0)
+    {
+        // the edge store is kept directly in the HSM dir
+    }
+    else if (((normalized_name = normalize_alias_file_path(store_name)) == NULL) ||
+             (STRING_concat(result, SLASH) != 0) ||
+             (STRING_concat(result, STORES_DIR) != 0) ||
+             (make_dir(STRING_c_str(result)) != 0) ||
+             (STRING_concat(result, SLASH) != 0) ||
+             (STRING_concat_with_STRING(result, normalized_name) != 0) ||
+             (make_store_dirs(STRING_c_str(result)) != 0))
+    {
+        LOG_ERROR("Could not create base dir for store %s", store_name);
+        STRING_delete(result);
+        result = NULL;
+    }
+
+    if (normalized_name != NULL)
+    {
+        STRING_delete(normalized_name);
+    }
+
+    return result;
+}
+
+static int build_cert_file_paths
+(
+    const CRYPTO_STORE *store,
+    const char *alias,
+    STRING_HANDLE cert_file,
+    STRING_HANDLE pk_file
+)
 {
     int result;
-    const char *base_dir_path = get_base_dir();
+    const char *base_dir_path = STRING_c_str(store->base_dir);
     STRING_HANDLE normalized_alias;
 
     if ((normalized_alias = normalize_alias_file_path(alias)) == NULL)
@@ -722,10 +1047,15 @@ static int build_cert_file_paths(const char *alias, STRING_HANDLE cert_file, STR
     return result;
 }
 
-static int build_enc_key_file_path(const char *key_name, STRING_HANDLE key_file)
+static int build_enc_key_file_path
+(
+    const CRYPTO_STORE *store,
+    const char *key_name,
+    STRING_HANDLE key_file
+)
 {
     int result;
-    const char *base_dir_path = get_base_dir();
+    const char *base_dir_path = STRING_c_str(store->base_dir);
     STRING_HANDLE normalized_alias;
 
     if ((normalized_alias = normalize_alias_file_path(key_name)) == NULL)
@@ -755,19 +1085,39 @@ static int build_enc_key_file_path(const char *key_name, STRING_HANDLE key_file)
     return result;
 }
 
-static int save_encryption_key_to_file(const char *key_name, unsigned char *key, size_t key_size)
+static int save_encryption_key_to_file
+(
+    CRYPTO_STORE *store,
+    const char *key_name,
+    unsigned char *key,
+    size_t key_size
+)
 {
     int result;
     STRING_HANDLE key_file_handle;
+    HSM_STORE_LOG_HANDLE enc_keys_log = store->store_entry->enc_keys_log;
 
-    if ((key_file_handle = STRING_new()) == NULL)
+    if (enc_keys_log != NULL)
+    {
+        if (hsm_store_log_put(enc_keys_log, key_name, key, key_size) != 0)
+        {
+            LOG_ERROR("Could not write key to store log");
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+    else if ((key_file_handle = STRING_new()) == NULL)
     {
         LOG_ERROR("Could not create string handle");
         result = __FAILURE__;
     }
+    else
     {
         const char *key_file;
-        if (build_enc_key_file_path(key_name, key_file_handle) != 0)
+        if (build_enc_key_file_path(store, key_name, key_file_handle) != 0)
         {
             LOG_ERROR("Could not construct path to key");
             result = __FAILURE__;
@@ -796,8 +1146,17 @@ static int load_encryption_key_from_file(CRYPTO_STORE* store, const char *key_na
 {
     int result;
     STRING_HANDLE key_file_handle;
+    HSM_STORE_LOG_HANDLE enc_keys_log = store->store_entry->enc_keys_log;
+    unsigned char *log_key;
+    size_t log_key_size = 0;
 
-    if ((key_file_handle = STRING_new()) == NULL)
+    if ((enc_keys_log != NULL) &&
+        ((log_key = hsm_store_log_get(enc_keys_log, key_name, &log_key_size)) != NULL))
+    {
+        result = put_key(store, HSM_KEY_ENCRYPTION, key_name, log_key, log_key_size);
+        hsm_key_mem_free(log_key, log_key_size);
+    }
+    else if ((key_file_handle = STRING_new()) == NULL)
     {
         LOG_ERROR("Could not create string handle");
         result = __FAILURE__;
@@ -808,7 +1167,7 @@ static int load_encryption_key_from_file(CRYPTO_STORE* store, const char *key_na
         unsigned char *key = NULL;
         size_t key_size = 0;
 
-        if (build_enc_key_file_path(key_name, key_file_handle) != 0)
+        if (build_enc_key_file_path(store, key_name, key_file_handle) != 0)
         {
             LOG_ERROR("Could not construct path to key");
             result = __FAILURE__;
@@ -824,9 +1183,26 @@ static int load_encryption_key_from_file(CRYPTO_STORE* store, const char *key_na
             LOG_ERROR("Could not read key from file. Key size %zu", key_size);
             result = __FAILURE__;
         }
+        else if (put_key(store, HSM_KEY_ENCRYPTION, key_name, key, key_size) != 0)
+        {
+            result = __FAILURE__;
+        }
+        else if (enc_keys_log == NULL)
+        {
+            result = 0;
+        }
         else
         {
-            result = put_key(store, HSM_KEY_ENCRYPTION, key_name, key, key_size);
+            // key persisted before the log backend was selected, migrate it
+            if (hsm_store_log_put(enc_keys_log, key_name, key, key_size) != 0)
+            {
+                LOG_ERROR("Could not migrate key %s to store log", key_name);
+            }
+            else if (delete_file(key_file) != 0)
+            {
+                LOG_ERROR("Could not delete migrated key file for %s", key_name);
+            }
+            result = 0;
         }
 
         if (key != NULL)
@@ -839,20 +1215,29 @@ static int load_encryption_key_from_file(CRYPTO_STORE* store, const char *key_na
     return result;
 }
 
-static int delete_encryption_key_file(const char *key_name)
+static int delete_encryption_key_file(CRYPTO_STORE *store, const char *key_name)
 {
     int result;
     STRING_HANDLE key_file_handle;
+    HSM_STORE_LOG_HANDLE enc_keys_log = store->store_entry->enc_keys_log;
 
-    if ((key_file_handle = STRING_new()) == NULL)
+    // legacy key files are removed as well in case the key was never migrated
+    if ((enc_keys_log != NULL) &&
+        hsm_store_log_contains(enc_keys_log, key_name) &&
+        (hsm_store_log_remove(enc_keys_log, key_name) != 0))
     {
-        LOG_ERROR("Could not create string handle");
+        LOG_ERROR("Could not remove key from store log");
+        result = __FAILURE__;
+    }
+    else if ((key_file_handle = STRING_new()) == NULL)
+    {
+        LOG_ERROR("Could not create string handle");
         result = __FAILURE__;
     }
     else
     {
         const char *key_file;
-        if (build_enc_key_file_path(key_name, key_file_handle) != 0)
+        if (build_enc_key_file_path(store, key_name, key_file_handle) != 0)
         {
             LOG_ERROR("Could not construct path to key");
             result = __FAILURE__;
@@ -879,18 +1264,17 @@ static int delete_encryption_key_file(const char *key_name)
 
 static CERT_INFO_HANDLE prepare_cert_info_handle
 (
-    const CRYPTO_STORE *store,
-    STORE_ENTRY_PKI_CERT *cert_entry
+    STRING_HANDLE cert_file_handle,
+    STRING_HANDLE pk_file_handle
 )
 {
-    (void)store;
     CERT_INFO_HANDLE result;
     char *cert_contents = NULL, *private_key_contents = NULL;
     size_t private_key_size = 0;
     const char *cert_file;
     const char *pk_file;
 
-    if ((pk_file = STRING_c_str(cert_entry->private_key_file)) == NULL)
+    if ((pk_file = STRING_c_str(pk_file_handle)) == NULL)
     {
         LOG_ERROR("Private key file path is NULL");
         result = NULL;
@@ -900,7 +1284,7 @@ static CERT_INFO_HANDLE prepare_cert_info_handle
         LOG_ERROR("Could not load private key into buffer %s", pk_file);
         result = NULL;
     }
-    else if ((cert_file = STRING_c_str(cert_entry->cert_file)) == NULL)
+    else if ((cert_file = STRING_c_str(cert_file_handle)) == NULL)
     {
         LOG_ERROR("Certificate file path NULL");
         result = NULL;
@@ -988,28 +1372,9 @@ static void destroy_pki_cert(STORE_ENTRY_PKI_CERT *pki_cert)
     free(pki_cert);
 }
 
-static bool remove_cert_entry_cb
-(
-    const void *item,
-    const void *match_context,
-    bool *continue_processing
-)
+static void destroy_pki_cert_entry_cb(void *value)
 {
-    bool result;
-    STORE_ENTRY_PKI_CERT *pki_cert = (STORE_ENTRY_PKI_CERT*)item;
-    if (strcmp(STRING_c_str(pki_cert->id), (const char*)match_context) == 0)
-    {
-        destroy_pki_cert(pki_cert);
-        *continue_processing = false;
-        result = true;
-    }
-    else
-    {
-        *continue_processing = true;
-        result = false;
-    }
-
-    return result;
+    destroy_pki_cert((STORE_ENTRY_PKI_CERT*)value);
 }
 
 static int put_pki_cert
@@ -1022,86 +1387,91 @@ static int put_pki_cert
 )
 {
     int result;
-    STORE_ENTRY_PKI_CERT *cert_entry;
 
-    cert_entry = create_pki_cert_entry(alias, issuer_alias, certificate_file, private_key_file);
-    if (cert_entry == NULL)
+    if (lock_store_writer(store) != 0)
     {
-        LOG_ERROR("Could not allocate memory to store certificate and or key for %s", alias);
         result = __FAILURE__;
     }
     else
     {
-        SINGLYLINKEDLIST_HANDLE cert_list = store->store_entry->pki_certs;
-        (void)singlylinkedlist_remove_if(cert_list, remove_cert_entry_cb, alias);
-        if (singlylinkedlist_add(cert_list, cert_entry) == NULL)
+        STORE_ENTRY_PKI_CERT *cert_entry;
+        STORE_SNAPSHOT *update;
+        void *replaced_entry = NULL;
+
+        cert_entry = create_pki_cert_entry(alias, issuer_alias, certificate_file, private_key_file);
+        if (cert_entry == NULL)
+        {
+            LOG_ERROR("Could not allocate memory to store certificate and or key for %s", alias);
+            result = __FAILURE__;
+        }
+        else if ((update = begin_snapshot_update(store, SNAPSHOT_PKI_CERTS)) == NULL)
+        {
+            LOG_ERROR("Could not update the certificate store");
+            destroy_pki_cert(cert_entry);
+            result = __FAILURE__;
+        }
+        else if (store_index_put(update->indexes[SNAPSHOT_PKI_CERTS], STRING_c_str(cert_entry->id),
+                                 cert_entry, &replaced_entry) != 0)
         {
             LOG_ERROR("Could not insert cert and key in the store");
+            discard_snapshot_update(store, update);
             destroy_pki_cert(cert_entry);
             result = __FAILURE__;
         }
         else
         {
+            publish_snapshot(store, update);
+            if (replaced_entry != NULL)
+            {
+                destroy_pki_cert((STORE_ENTRY_PKI_CERT*)replaced_entry);
+            }
             result = 0;
         }
+        unlock_store_writer(store);
     }
+
     return result;
 }
 
 static int remove_pki_cert(CRYPTO_STORE *store, const char *alias)
 {
     int result;
-    SINGLYLINKEDLIST_HANDLE certs_list = store->store_entry->pki_certs;
-    LIST_ITEM_HANDLE list_item = singlylinkedlist_find(certs_list, find_pki_cert_cb, alias);
-    if (list_item == NULL)
+
+    if (lock_store_writer(store) != 0)
     {
-        LOG_DEBUG("Certificate not found %s", alias);
         result = __FAILURE__;
     }
     else
     {
         STORE_ENTRY_PKI_CERT *pki_cert;
-        pki_cert = (STORE_ENTRY_PKI_CERT*)singlylinkedlist_item_get_value(list_item);
-        destroy_pki_cert(pki_cert);
-        singlylinkedlist_remove(certs_list, list_item);
-        result = 0;
+        STORE_SNAPSHOT *update;
+
+        if (get_pki_cert(get_current_snapshot(store), alias) == NULL)
+        {
+            LOG_DEBUG("Certificate not found %s", alias);
+            result = __FAILURE__;
+        }
+        else if ((update = begin_snapshot_update(store, SNAPSHOT_PKI_CERTS)) == NULL)
+        {
+            LOG_ERROR("Could not update the certificate store");
+            result = __FAILURE__;
+        }
+        else
+        {
+            pki_cert = (STORE_ENTRY_PKI_CERT*)store_index_remove(update->indexes[SNAPSHOT_PKI_CERTS], alias);
+            publish_snapshot(store, update);
+            destroy_pki_cert(pki_cert);
+            result = 0;
+        }
+        unlock_store_writer(store);
     }
 
     return result;
 }
 
-static void destroy_pki_certs(SINGLYLINKEDLIST_HANDLE certs)
-{
-    LIST_ITEM_HANDLE list_item;
-    while ((list_item = singlylinkedlist_get_head_item(certs)) != NULL)
-    {
-        STORE_ENTRY_PKI_CERT *pki_cert;
-        pki_cert = (STORE_ENTRY_PKI_CERT*)singlylinkedlist_item_get_value(list_item);
-        destroy_pki_cert(pki_cert);
-        singlylinkedlist_remove(certs, list_item);
-    }
-}
-
 //##############################################################################
 // STORE_ENTRY_PKI_TRUSTED_CERT helpers
 //##############################################################################
-
-static bool find_pki_trusted_cert_cb(LIST_ITEM_HANDLE list_item, const void *match_context)
-{
-    bool result;
-    STORE_ENTRY_PKI_CERT *cert = (STORE_ENTRY_PKI_CERT*)singlylinkedlist_item_get_value(list_item);
-    if (strcmp(STRING_c_str(cert->id), (const char*)match_context) == 0)
-    {
-        result = true;
-    }
-    else
-    {
-        result = false;
-    }
-
-    return result;
-}
-
 static STORE_ENTRY_PKI_TRUSTED_CERT* create_pki_trusted_cert_entry
 (
     const char *name,
@@ -1138,82 +1508,240 @@ static void destroy_trusted_cert(STORE_ENTRY_PKI_TRUSTED_CERT *trusted_cert)
     free(trusted_cert);
 }
 
-static bool remove_trusted_cert_entry_cb
+/**
+ * Certificates in the store's certs directory are written only by the HSM,
+ * which replaces them with a rename and never truncates them in place, so
+ * they are parsed from a mapped view. Any other file, such as a trusted cert
+ * managed by the operator, is read into memory since truncating it while it
+ * is mapped would fault the process.
+ */
+static bool is_store_cert_file(const CRYPTO_STORE *store, const char *file_path)
+{
+    bool result = false;
+    const char *base_dir_path = STRING_c_str(store->base_dir);
+    size_t base_dir_len = strlen(base_dir_path);
+    size_t certs_dir_len = strlen(CERTS_DIR);
+
+    if ((strncmp(file_path, base_dir_path, base_dir_len) == 0) &&
+        (strncmp(file_path + base_dir_len, SLASH, strlen(SLASH)) == 0))
+    {
+        const char *rest = file_path + base_dir_len + strlen(SLASH);
+        result = (strncmp(rest, CERTS_DIR, certs_dir_len) == 0) &&
+                 (strncmp(rest + certs_dir_len, SLASH, strlen(SLASH)) == 0) &&
+                 (strstr(rest, "..") == NULL);
+    }
+
+    return result;
+}
+
+static const void* load_cert_file
 (
-    const void* item,
-    const void* match_context,
-    bool* continue_processing
+    const CRYPTO_STORE *store,
+    const char *cert_file,
+    size_t *cert_size,
+    bool *is_view
 )
 {
-    bool result;
-    STORE_ENTRY_PKI_TRUSTED_CERT* trusted_cert = (STORE_ENTRY_PKI_TRUSTED_CERT*)item;
-    if (strcmp(STRING_c_str(trusted_cert->id), (const char*)match_context) == 0)
+    const void *result;
+
+    *is_view = is_store_cert_file(store, cert_file);
+    if (*is_view)
     {
-        destroy_trusted_cert(trusted_cert);
-        *continue_processing = false;
-        result = true;
+        result = map_file_into_view(cert_file, cert_size);
     }
     else
     {
-        *continue_processing = true;
-        result = false;
+        result = read_file_into_buffer(cert_file, cert_size);
     }
 
     return result;
 }
 
-static CERT_INFO_HANDLE prepare_trusted_certs_info(CRYPTO_STORE *store)
+static void release_cert_file(const void *contents, size_t cert_size, bool is_view)
 {
-    CERT_INFO_HANDLE result;
+    if (is_view)
+    {
+        unmap_file_view(contents, cert_size);
+    }
+    else
+    {
+        free((void*)contents);
+    }
+}
+
+// takes ownership of the bundle, which is released if it cannot be published
+static int set_trusted_certs_bundle(CRYPTO_STORE *store, CERT_INFO_HANDLE bundle)
+{
+    int result;
+    STORE_SNAPSHOT *update;
+
+    if ((update = begin_snapshot_update(store, SNAPSHOT_NUM_INDEXES)) == NULL)
+    {
+        LOG_ERROR("Could not update the trusted certs bundle");
+        if (bundle != NULL)
+        {
+            certificate_info_destroy(bundle);
+        }
+        result = __FAILURE__;
+    }
+    else
+    {
+        update->pki_trusted_certs_bundle = bundle;
+        publish_snapshot(store, update);
+        result = 0;
+    }
+
+    return result;
+}
+
+static int append_trusted_certs_bundle(CRYPTO_STORE *store, const char *cert_file)
+{
+    int result;
+    const void *cert_contents;
+    size_t cert_size = 0;
+    bool is_view = false;
+
+    if ((cert_contents = load_cert_file(store, cert_file, &cert_size, &is_view)) == NULL)
+    {
+        LOG_ERROR("Could not read trusted certificate file %s", cert_file);
+        result = __FAILURE__;
+    }
+    else
+    {
+        CERT_INFO_HANDLE bundle;
+        CERT_INFO_HANDLE current = get_current_snapshot(store)->pki_trusted_certs_bundle;
+
+        if (current == NULL)
+        {
+            bundle = certificate_info_create_from_buffer(cert_contents, cert_size, NULL, 0, PRIVATE_KEY_UNKNOWN);
+        }
+        else
+        {
+            // only the new file is parsed, the rest of the bundle is taken
+            // from the current one without re-reading the other cert files
+            bundle = certificate_info_append_from_buffer(current, cert_contents, cert_size);
+        }
+
+        if (bundle == NULL)
+        {
+            LOG_ERROR("Could not create the trusted certs bundle");
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = set_trusted_certs_bundle(store, bundle);
+        }
+        release_cert_file(cert_contents, cert_size, is_view);
+    }
+
+    return result;
+}
+
+// reads all the trusted cert files into a new bundle, NULL when there are none
+static int create_trusted_certs_bundle(CRYPTO_STORE *store, CERT_INFO_HANDLE *bundle)
+{
+    int result;
+    size_t num_certs = 0;
+    const char **cert_files;
     LIST_ITEM_HANDLE list_item;
     SINGLYLINKEDLIST_HANDLE cert_list = store->store_entry->pki_trusted_certs;
-    int list_count = 0;
 
-    list_item = singlylinkedlist_get_head_item(cert_list);
-    while (list_item != NULL)
+    for (list_item = singlylinkedlist_get_head_item(cert_list);
+         list_item != NULL;
+         list_item = singlylinkedlist_get_next_item(list_item))
     {
-        list_count++;
-        list_item = singlylinkedlist_get_next_item(list_item);
+        num_certs++;
     }
 
-    if (list_count > 0)
+    *bundle = NULL;
+    if (num_certs == 0)
+    {
+        result = 0;
+    }
+    else if (num_certs > INT_MAX)
     {
-        char **trusted_files;
-        int index = 0;
-        if ((trusted_files = (char **)calloc(list_count, sizeof(const char*))) == NULL)
+        LOG_ERROR("Too many trusted certificates %zu", num_certs);
+        result = __FAILURE__;
+    }
+    else if ((cert_files = (const char**)calloc(num_certs, sizeof(const char*))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory to build the trusted certs bundle");
+        result = __FAILURE__;
+    }
+    else
+    {
+        size_t idx = 0;
+        char *all_certs;
+
+        for (list_item = singlylinkedlist_get_head_item(cert_list);
+             list_item != NULL;
+             list_item = singlylinkedlist_get_next_item(list_item))
         {
-            LOG_ERROR("Could not allocate memory to store list of trusted cert files");
-            result = NULL;
+            STORE_ENTRY_PKI_TRUSTED_CERT *trusted_cert;
+            trusted_cert = (STORE_ENTRY_PKI_TRUSTED_CERT*)singlylinkedlist_item_get_value(list_item);
+            cert_files[idx++] = STRING_c_str(trusted_cert->cert_file);
+        }
+
+        // the files are read into a single buffer sized up front
+        if ((all_certs = concat_files_to_cstring(cert_files, (int)num_certs)) == NULL)
+        {
+            LOG_ERROR("Could not read the trusted certificate files");
+            result = __FAILURE__;
         }
         else
         {
-            char *all_certs;
-            list_item = singlylinkedlist_get_head_item(cert_list);
-            while (list_item != NULL)
-            {
-                STORE_ENTRY_PKI_TRUSTED_CERT *trusted_cert;
-                trusted_cert = (STORE_ENTRY_PKI_TRUSTED_CERT*)singlylinkedlist_item_get_value(list_item);
-                trusted_files[index] = (char*)STRING_c_str(trusted_cert->cert_file);
-                index++;
-                list_item = singlylinkedlist_get_next_item(list_item);
-            }
-            if ((all_certs = concat_files_to_cstring((const char**)trusted_files, list_count)) == NULL)
+            if ((*bundle = certificate_info_create(all_certs, NULL, 0, PRIVATE_KEY_UNKNOWN)) == NULL)
             {
-                LOG_ERROR("Could not concat all the trusted cert files");
-                result = NULL;
+                LOG_ERROR("Could not create the trusted certs bundle");
+                result = __FAILURE__;
             }
             else
             {
-                result = certificate_info_create(all_certs, NULL, 0, PRIVATE_KEY_UNKNOWN);
-                free(all_certs);
+                result = 0;
             }
-            free(trusted_files);
+            free(all_certs);
         }
+        free(cert_files);
+    }
+
+    return result;
+}
+
+static int rebuild_trusted_certs_bundle(CRYPTO_STORE *store)
+{
+    int result;
+    CERT_INFO_HANDLE bundle;
+
+    if (create_trusted_certs_bundle(store, &bundle) != 0)
+    {
+        result = __FAILURE__;
     }
     else
+    {
+        result = set_trusted_certs_bundle(store, bundle);
+    }
+
+    return result;
+}
+
+static CERT_INFO_HANDLE prepare_trusted_certs_info(CRYPTO_STORE *store)
+{
+    CERT_INFO_HANDLE result;
+    HSM_RCU_READER reader;
+    const STORE_SNAPSHOT *snapshot = begin_store_read(store, &reader);
+    CERT_INFO_HANDLE bundle = snapshot->pki_trusted_certs_bundle;
+
+    if (bundle == NULL)
     {
         result = NULL;
     }
+    else
+    {
+        // bundle is maintained by put/remove_pki_trusted_cert so the caller
+        // is simply handed a reference to it, which outlives the snapshot
+        result = certificate_info_clone(bundle);
+    }
+    end_store_read(store, reader);
 
     return result;
 }
@@ -1230,7 +1758,7 @@ static void destroy_pki_trusted_certs(SINGLYLINKEDLIST_HANDLE trusted_certs)
     }
 }
 
-static int put_pki_trusted_cert
+static int insert_pki_trusted_cert_entry
 (
     CRYPTO_STORE *store,
     const char *alias,
@@ -1240,7 +1768,15 @@ static int put_pki_trusted_cert
     int result;
     STORE_ENTRY_PKI_TRUSTED_CERT *trusted_cert_entry;
     SINGLYLINKEDLIST_HANDLE cert_list = store->store_entry->pki_trusted_certs;
-    (void)singlylinkedlist_remove_if(cert_list, remove_trusted_cert_entry_cb, alias);
+    STORE_INDEX_HANDLE cert_index = store->store_entry->pki_trusted_certs_index;
+    LIST_ITEM_HANDLE list_item;
+    LIST_ITEM_HANDLE replaced_item = (LIST_ITEM_HANDLE)store_index_remove(cert_index, alias);
+    bool replaced = (replaced_item != NULL);
+    if (replaced)
+    {
+        destroy_trusted_cert((STORE_ENTRY_PKI_TRUSTED_CERT*)singlylinkedlist_item_get_value(replaced_item));
+        singlylinkedlist_remove(cert_list, replaced_item);
+    }
     trusted_cert_entry = create_pki_trusted_cert_entry(alias, certificate_file);
     if (trusted_cert_entry == NULL)
     {
@@ -1249,26 +1785,56 @@ static int put_pki_trusted_cert
     }
     else
     {
-        if (singlylinkedlist_add(cert_list, trusted_cert_entry) == NULL)
+        if ((list_item = singlylinkedlist_add(cert_list, trusted_cert_entry)) == NULL)
         {
             LOG_ERROR("Could not insert cert and key in the store");
             destroy_trusted_cert(trusted_cert_entry);
             result = __FAILURE__;
         }
+        else if (store_index_put(cert_index, STRING_c_str(trusted_cert_entry->id), list_item, NULL) != 0)
+        {
+            LOG_ERROR("Could not index trusted certificate for %s", alias);
+            singlylinkedlist_remove(cert_list, list_item);
+            destroy_trusted_cert(trusted_cert_entry);
+            result = __FAILURE__;
+        }
         else
         {
             result = 0;
         }
     }
+
+    if (result == 0)
+    {
+        // a replaced alias may be anywhere in the bundle so it is rebuilt,
+        // a new alias is always added to the end and can simply be appended
+        result = (replaced) ? rebuild_trusted_certs_bundle(store) :
+                              append_trusted_certs_bundle(store, certificate_file);
+        if (result != 0)
+        {
+            LOG_ERROR("Could not update the trusted certs bundle for %s", alias);
+            (void)store_index_remove(cert_index, alias);
+            destroy_trusted_cert(trusted_cert_entry);
+            singlylinkedlist_remove(cert_list, list_item);
+        }
+    }
+
+    if ((result != 0) && (replaced))
+    {
+        // the previous entry has already been removed so keep
+        // the bundle consistent with the remaining entries
+        (void)rebuild_trusted_certs_bundle(store);
+    }
+
     return result;
 }
 
-static int remove_pki_trusted_cert(CRYPTO_STORE *store, const char *alias)
+static int delete_pki_trusted_cert_entry(CRYPTO_STORE *store, const char *alias)
 {
     int result;
     SINGLYLINKEDLIST_HANDLE certs_list = store->store_entry->pki_trusted_certs;
-    LIST_ITEM_HANDLE list_item = singlylinkedlist_find(certs_list, find_pki_trusted_cert_cb, alias);
-    if (list_item == NULL)
+    LIST_ITEM_HANDLE list_item;
+    if ((list_item = (LIST_ITEM_HANDLE)store_index_remove(store->store_entry->pki_trusted_certs_index, alias)) == NULL)
     {
         LOG_ERROR("Trusted certificate not found %s", alias);
         result = __FAILURE__;
@@ -1279,7 +1845,54 @@ static int remove_pki_trusted_cert(CRYPTO_STORE *store, const char *alias)
         pki_cert = (STORE_ENTRY_PKI_TRUSTED_CERT*)singlylinkedlist_item_get_value(list_item);
         destroy_trusted_cert(pki_cert);
         singlylinkedlist_remove(certs_list, list_item);
-        result = 0;
+        if (rebuild_trusted_certs_bundle(store) != 0)
+        {
+            LOG_ERROR("Could not rebuild the trusted certs bundle after removing %s", alias);
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int put_pki_trusted_cert
+(
+    CRYPTO_STORE *store,
+    const char *alias,
+    const char *certificate_file
+)
+{
+    int result;
+
+    if (lock_store_writer(store) != 0)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = insert_pki_trusted_cert_entry(store, alias, certificate_file);
+        unlock_store_writer(store);
+    }
+
+    return result;
+}
+
+static int remove_pki_trusted_cert(CRYPTO_STORE *store, const char *alias)
+{
+    int result;
+
+    if (lock_store_writer(store) != 0)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = delete_pki_trusted_cert_entry(store, alias);
+        unlock_store_writer(store);
     }
 
     return result;
@@ -1292,6 +1905,7 @@ static CRYPTO_STORE* create_store(const char *store_name)
 {
     CRYPTO_STORE_ENTRY *store_entry;
     STRING_HANDLE store_id;
+    STRING_HANDLE base_dir;
     CRYPTO_STORE *result;
 
     if ((result = (CRYPTO_STORE*)malloc(sizeof(CRYPTO_STORE))) == NULL)
@@ -1304,36 +1918,60 @@ static CRYPTO_STORE* create_store(const char *store_name)
         free(result);
         result = NULL;
     }
-    else if ((store_entry->sas_keys = singlylinkedlist_create()) == NULL)
+    else if ((store_entry->snapshot = create_snapshot()) == NULL)
     {
-        LOG_ERROR("Could not allocate SAS keys list");
+        LOG_ERROR("Could not allocate store snapshot");
         free(store_entry);
         free(result);
         result = NULL;
     }
-    else if ((store_entry->sym_enc_keys = singlylinkedlist_create()) == NULL)
+    else if ((store_entry->pki_trusted_certs = singlylinkedlist_create()) == NULL)
     {
-        LOG_ERROR("Could not allocate encryption keys list");
-        singlylinkedlist_destroy(store_entry->sas_keys);
+        LOG_ERROR("Could not allocate trusted certs list");
+        release_snapshot(store_entry->snapshot, NULL);
         free(store_entry);
         free(result);
         result = NULL;
     }
-    else if ((store_entry->pki_certs = singlylinkedlist_create()) == NULL)
+    else if ((store_entry->pki_trusted_certs_index = store_index_create()) == NULL)
     {
-        LOG_ERROR("Could not allocate certs list");
-        singlylinkedlist_destroy(store_entry->sym_enc_keys);
-        singlylinkedlist_destroy(store_entry->sas_keys);
+        LOG_ERROR("Could not allocate trusted certs index");
+        singlylinkedlist_destroy(store_entry->pki_trusted_certs);
+        release_snapshot(store_entry->snapshot, NULL);
         free(store_entry);
         free(result);
         result = NULL;
     }
-    else if ((store_entry->pki_trusted_certs = singlylinkedlist_create()) == NULL)
+    else if ((store_entry->key_entries = hsm_slab_create(sizeof(STORE_ENTRY_KEY),
+                                                         KEY_ENTRIES_PER_SLAB_PAGE)) == NULL)
     {
-        LOG_ERROR("Could not allocate trusted certs list");
-        singlylinkedlist_destroy(store_entry->pki_certs);
-        singlylinkedlist_destroy(store_entry->sym_enc_keys);
-        singlylinkedlist_destroy(store_entry->sas_keys);
+        LOG_ERROR("Could not allocate key entries slab");
+        store_index_destroy(store_entry->pki_trusted_certs_index, NULL);
+        singlylinkedlist_destroy(store_entry->pki_trusted_certs);
+        release_snapshot(store_entry->snapshot, NULL);
+        free(store_entry);
+        free(result);
+        result = NULL;
+    }
+    else if ((store_entry->rcu = hsm_rcu_create()) == NULL)
+    {
+        LOG_ERROR("Could not allocate store readers");
+        hsm_slab_destroy(store_entry->key_entries);
+        store_index_destroy(store_entry->pki_trusted_certs_index, NULL);
+        singlylinkedlist_destroy(store_entry->pki_trusted_certs);
+        release_snapshot(store_entry->snapshot, NULL);
+        free(store_entry);
+        free(result);
+        result = NULL;
+    }
+    else if ((store_entry->writer_lock = Lock_Init()) == NULL)
+    {
+        LOG_ERROR("Could not allocate store writer lock");
+        hsm_rcu_destroy(store_entry->rcu);
+        hsm_slab_destroy(store_entry->key_entries);
+        store_index_destroy(store_entry->pki_trusted_certs_index, NULL);
+        singlylinkedlist_destroy(store_entry->pki_trusted_certs);
+        release_snapshot(store_entry->snapshot, NULL);
         free(store_entry);
         free(result);
         result = NULL;
@@ -1341,19 +1979,44 @@ static CRYPTO_STORE* create_store(const char *store_name)
     else if ((store_id = STRING_construct(store_name)) == NULL)
     {
         LOG_ERROR("Could not allocate store id");
+        (void)Lock_Deinit(store_entry->writer_lock);
+        hsm_rcu_destroy(store_entry->rcu);
+        hsm_slab_destroy(store_entry->key_entries);
+        store_index_destroy(store_entry->pki_trusted_certs_index, NULL);
         singlylinkedlist_destroy(store_entry->pki_trusted_certs);
-        singlylinkedlist_destroy(store_entry->pki_certs);
-        singlylinkedlist_destroy(store_entry->sym_enc_keys);
-        singlylinkedlist_destroy(store_entry->sas_keys);
+        release_snapshot(store_entry->snapshot, NULL);
+        free(store_entry);
+        free(result);
+        result = NULL;
+    }
+    else if ((base_dir = build_store_base_dir(store_name)) == NULL)
+    {
+        STRING_delete(store_id);
+        (void)Lock_Deinit(store_entry->writer_lock);
+        hsm_rcu_destroy(store_entry->rcu);
+        hsm_slab_destroy(store_entry->key_entries);
+        store_index_destroy(store_entry->pki_trusted_certs_index, NULL);
+        singlylinkedlist_destroy(store_entry->pki_trusted_certs);
+        release_snapshot(store_entry->snapshot, NULL);
         free(store_entry);
         free(result);
         result = NULL;
     }
     else
     {
+        store_entry->enc_keys_log = NULL;
+        store_entry->cert_watch = NULL;
+#if defined(HSM_LOCK_PROFILING)
+        store_entry->writers = 0;
+#endif
+        result->create_count = 1;
         result->ref_count = 1;
+        result->provisioned = 1;
+        result->provisioning = false;
         result->store_entry = store_entry;
         result->id = store_id;
+        result->base_dir = base_dir;
+        result->next = NULL;
     }
 
     return result;
@@ -1361,21 +2024,501 @@ static CRYPTO_STORE* create_store(const char *store_name)
 
 static void destroy_store(CRYPTO_STORE *store)
 {
+    // there are no readers left once the last reference is closed
+    STORE_SNAPSHOT *snapshot = get_current_snapshot(store);
     STRING_delete(store->id);
+    STRING_delete(store->base_dir);
+    store_index_destroy(store->store_entry->pki_trusted_certs_index, NULL);
     destroy_pki_trusted_certs(store->store_entry->pki_trusted_certs);
     singlylinkedlist_destroy(store->store_entry->pki_trusted_certs);
-    destroy_pki_certs(store->store_entry->pki_certs);
-    singlylinkedlist_destroy(store->store_entry->pki_certs);
-    destroy_keys(store->store_entry->sym_enc_keys);
-    singlylinkedlist_destroy(store->store_entry->sym_enc_keys);
-    destroy_keys(store->store_entry->sas_keys);
-    singlylinkedlist_destroy(store->store_entry->sas_keys);
+    store_index_destroy(snapshot->indexes[SNAPSHOT_PKI_CERTS], destroy_pki_cert_entry_cb);
+    store_index_destroy(snapshot->indexes[SNAPSHOT_ENC_KEYS], destroy_key_entry_cb);
+    store_index_destroy(snapshot->indexes[SNAPSHOT_SAS_KEYS], destroy_key_entry_cb);
+    snapshot->indexes[SNAPSHOT_PKI_CERTS] = NULL;
+    snapshot->indexes[SNAPSHOT_ENC_KEYS] = NULL;
+    snapshot->indexes[SNAPSHOT_SAS_KEYS] = NULL;
+    release_snapshot(snapshot, NULL);
+    hsm_slab_destroy(store->store_entry->key_entries);
+    hsm_store_log_close(store->store_entry->enc_keys_log);
+    hsm_rcu_destroy(store->store_entry->rcu);
+    (void)Lock_Deinit(store->store_entry->writer_lock);
     free(store->store_entry);
     free(store);
 }
 
 //##############################################################################
-// HSM certificate provisioning
+// Verified certificate manifest
+//##############################################################################
+/**
+ * The manifest persists one line per certificate alias that passed a full
+ * verification:
+ *
+ *   <normalized alias> <cert digest> <key digest> <issuer digest> <not after>
+ *
+ * Digests are URL safe base64 SHA-256 of the file contents and "not after" is
+ * the certificate expiration in seconds since the epoch. A certificate whose
+ * certificate, key and issuer files are unchanged since it was last verified,
+ * and which is not close to expiring, need not be verified again.
+ */
+static int build_manifest_file_path(const CRYPTO_STORE *store, STRING_HANDLE manifest_file)
+{
+    int result;
+    const char *base_dir_path = STRING_c_str(store->base_dir);
+
+    if ((STRING_concat(manifest_file, base_dir_path) != 0) ||
+        (STRING_concat(manifest_file, SLASH)  != 0) ||
+        (STRING_concat(manifest_file, CERTS_DIR)  != 0) ||
+        (STRING_concat(manifest_file, SLASH)  != 0) ||
+        (STRING_concat(manifest_file, VERIFIED_MANIFEST_FILE) != 0))
+    {
+        LOG_ERROR("Could not construct path to verified certificates manifest");
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static int compute_file_digest_cb
+(
+    size_t index,
+    const unsigned char *data,
+    size_t data_size,
+    void *context
+)
+{
+    int result;
+    STRING_HANDLE *digests = (STRING_HANDLE*)context;
+
+    if ((digests[index] = compute_b64_sha_digest_string(data, data_size)) == NULL)
+    {
+        LOG_ERROR("Could not compute file digest");
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+/**
+ * Computes the digests of the certificate and key files of a set of
+ * certificates and of their issuer. All files are read by a single bulk read
+ * as this runs for every certificate at boot. The certificate digests are
+ * stored first, followed by the key digests and then the issuer digest,
+ * unless the issuer is one of the certificates.
+ */
+static int compute_manifest_file_digests
+(
+    const char * const *cert_file_paths,
+    const char * const *key_file_paths,
+    size_t num_certificates,
+    const char *issuer_cert_path,
+    STRING_HANDLE *digests,
+    size_t *issuer_index
+)
+{
+    int result;
+    const char **file_paths;
+    size_t num_files = 2 * num_certificates;
+    size_t idx;
+
+    *issuer_index = num_files;
+    for (idx = 0; idx < num_certificates; idx++)
+    {
+        if (strcmp(cert_file_paths[idx], issuer_cert_path) == 0)
+        {
+            *issuer_index = idx;
+            break;
+        }
+    }
+    if (*issuer_index == num_files)
+    {
+        num_files++;
+    }
+
+    if ((file_paths = (const char**)calloc(num_files, sizeof(const char*))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory to read %zu files", num_files);
+        result = __FAILURE__;
+    }
+    else
+    {
+        for (idx = 0; idx < num_certificates; idx++)
+        {
+            file_paths[idx] = cert_file_paths[idx];
+            file_paths[num_certificates + idx] = key_file_paths[idx];
+        }
+        file_paths[*issuer_index] = issuer_cert_path;
+
+        if (read_files_into_buffers(file_paths, num_files, compute_file_digest_cb, digests) != 0)
+        {
+            LOG_ERROR("Could not compute digests of certificates issued by %s", issuer_cert_path);
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+        free(file_paths);
+    }
+
+    return result;
+}
+
+/**
+ * Builds the manifest line for a certificate up to and excluding the
+ * expiration field. The normalized alias is the first field so the prefix
+ * up to the first space identifies the alias the line belongs to.
+ */
+static STRING_HANDLE build_manifest_entry_prefix
+(
+    const char *alias,
+    STRING_HANDLE cert_digest,
+    STRING_HANDLE key_digest,
+    STRING_HANDLE issuer_digest
+)
+{
+    STRING_HANDLE result;
+
+    if ((result = normalize_alias_file_path(alias)) == NULL)
+    {
+        LOG_ERROR("Could not normalize alias %s", alias);
+    }
+    else if ((STRING_concat(result, " ") != 0) ||
+             (STRING_concat_with_STRING(result, cert_digest) != 0) ||
+             (STRING_concat(result, " ") != 0) ||
+             (STRING_concat_with_STRING(result, key_digest) != 0) ||
+             (STRING_concat(result, " ") != 0) ||
+             (STRING_concat_with_STRING(result, issuer_digest) != 0) ||
+             (STRING_concat(result, " ") != 0))
+    {
+        LOG_ERROR("Could not construct manifest entry for alias %s", alias);
+        STRING_delete(result);
+        result = NULL;
+    }
+
+    return result;
+}
+
+static bool is_manifest_entry_current(const char *manifest, const char *entry_prefix)
+{
+    bool result = false;
+    size_t prefix_len = strlen(entry_prefix);
+    const char *line = manifest;
+
+    while ((line != NULL) && (*line != '\0'))
+    {
+        if (strncmp(line, entry_prefix, prefix_len) == 0)
+        {
+            char *end = NULL;
+            long long not_after = strtoll(line + prefix_len, &end, 10);
+            if ((end != line + prefix_len) &&
+                (difftime((time_t)not_after, time(NULL)) > VERIFIED_MANIFEST_MIN_VALIDITY_SECS))
+            {
+                result = true;
+            }
+            break;
+        }
+        if ((line = strchr(line, '\n')) != NULL)
+        {
+            line++;
+        }
+    }
+
+    return result;
+}
+
+static int get_certificate_expiration
+(
+    const CRYPTO_STORE *store,
+    const char *cert_file_path,
+    int64_t *not_after
+)
+{
+    int result;
+    const void *cert_data;
+    size_t cert_size = 0;
+    bool is_view = false;
+    CERT_INFO_HANDLE cert_info;
+
+    if ((cert_data = load_cert_file(store, cert_file_path, &cert_size, &is_view)) == NULL)
+    {
+        LOG_ERROR("Could not read certificate %s", cert_file_path);
+        result = __FAILURE__;
+    }
+    else
+    {
+        if ((cert_info = certificate_info_create_from_buffer(cert_data, cert_size, NULL, 0,
+                                                             PRIVATE_KEY_UNKNOWN)) == NULL)
+        {
+            LOG_ERROR("Could not parse certificate %s", cert_file_path);
+            result = __FAILURE__;
+        }
+        else
+        {
+            *not_after = certificate_info_get_valid_to(cert_info);
+            certificate_info_destroy(cert_info);
+            result = 0;
+        }
+        release_cert_file(cert_data, cert_size, is_view);
+    }
+
+    return result;
+}
+
+static int record_manifest_entry
+(
+    const CRYPTO_STORE *store,
+    const char *manifest_file,
+    const char *entry_prefix,
+    const char *cert_file_path
+)
+{
+    int result;
+    int64_t not_after = 0;
+    char not_after_str[32];
+    char *manifest = NULL;
+    char *new_manifest = NULL;
+    size_t alias_len = (size_t)(strchr(entry_prefix, ' ') - entry_prefix) + 1;
+    size_t prefix_len = strlen(entry_prefix);
+
+    if (get_certificate_expiration(store, cert_file_path, &not_after) != 0)
+    {
+        LOG_ERROR("Could not determine expiration of certificate %s", cert_file_path);
+        result = __FAILURE__;
+    }
+    else
+    {
+        size_t manifest_len, not_after_len, new_manifest_len = 0;
+
+        (void)snprintf(not_after_str, sizeof(not_after_str), "%lld\n", (long long)not_after);
+        not_after_len = strlen(not_after_str);
+        if (is_file_valid(manifest_file))
+        {
+            manifest = read_file_into_cstring(manifest_file, NULL);
+        }
+        manifest_len = (manifest != NULL) ? strlen(manifest) : 0;
+
+        if ((new_manifest = (char*)malloc(manifest_len + prefix_len + not_after_len + 1)) == NULL)
+        {
+            LOG_ERROR("Could not allocate memory for verified certificates manifest");
+            result = __FAILURE__;
+        }
+        else
+        {
+            const char *line = manifest;
+
+            // keep the lines of every other alias, replace the line of this one
+            while ((line != NULL) && (*line != '\0'))
+            {
+                const char *next = strchr(line, '\n');
+                size_t line_len = (next != NULL) ? (size_t)(next - line) + 1 : strlen(line);
+                if ((strncmp(line, entry_prefix, alias_len) != 0) && (next != NULL))
+                {
+                    memcpy(new_manifest + new_manifest_len, line, line_len);
+                    new_manifest_len += line_len;
+                }
+                line = (next != NULL) ? next + 1 : NULL;
+            }
+            memcpy(new_manifest + new_manifest_len, entry_prefix, prefix_len);
+            new_manifest_len += prefix_len;
+            memcpy(new_manifest + new_manifest_len, not_after_str, not_after_len);
+            new_manifest_len += not_after_len;
+            new_manifest[new_manifest_len] = '\0';
+
+            if (write_buffer_to_file(manifest_file, (unsigned char*)new_manifest,
+                                     new_manifest_len, true) != 0)
+            {
+                LOG_ERROR("Could not write verified certificates manifest %s", manifest_file);
+                result = __FAILURE__;
+            }
+            else
+            {
+                result = 0;
+            }
+            free(new_manifest);
+        }
+
+        if (manifest != NULL)
+        {
+            free(manifest);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Verifies certificates issued by the same issuer, skipping those the
+ * manifest shows were successfully verified before with the exact same
+ * certificate, key and issuer files and that are not about to expire. The
+ * others are verified together by verify_certificates. Successful
+ * verifications are recorded in the manifest, failing to record them is not
+ * an error.
+ */
+static int verify_certificates_with_manifest
+(
+    const CRYPTO_STORE *store,
+    const char * const *aliases,
+    const char * const *cert_file_paths,
+    const char * const *key_file_paths,
+    size_t num_certificates,
+    const char *issuer_cert_path,
+    bool *cert_verified
+)
+{
+    int result;
+    STRING_HANDLE manifest_file = NULL;
+    STRING_HANDLE *entry_prefixes = NULL;
+    STRING_HANDLE *digests = NULL;
+    const char **pending_files = NULL;
+    size_t *pending_index = NULL;
+    bool *pending_verified = NULL;
+    char *manifest = NULL;
+    bool has_manifest_file;
+    size_t num_pending = 0;
+    size_t issuer_index = 0;
+    size_t idx;
+
+    if (((entry_prefixes = (STRING_HANDLE*)calloc(num_certificates, sizeof(STRING_HANDLE))) == NULL) ||
+        ((digests = (STRING_HANDLE*)calloc(2 * num_certificates + 1, sizeof(STRING_HANDLE))) == NULL) ||
+        ((pending_files = (const char**)calloc(2 * num_certificates, sizeof(const char*))) == NULL) ||
+        ((pending_index = (size_t*)calloc(num_certificates, sizeof(size_t))) == NULL) ||
+        ((pending_verified = (bool*)calloc(num_certificates, sizeof(bool))) == NULL))
+    {
+        LOG_ERROR("Could not allocate memory to verify %zu certificates", num_certificates);
+        result = __FAILURE__;
+    }
+    else
+    {
+        has_manifest_file = ((manifest_file = STRING_new()) != NULL) &&
+                            (build_manifest_file_path(store, manifest_file) == 0);
+        if (has_manifest_file && is_file_valid(STRING_c_str(manifest_file)))
+        {
+            manifest = read_file_into_cstring(STRING_c_str(manifest_file), NULL);
+        }
+        has_manifest_file = has_manifest_file &&
+                            (compute_manifest_file_digests(cert_file_paths, key_file_paths,
+                                                           num_certificates, issuer_cert_path,
+                                                           digests, &issuer_index) == 0);
+
+        for (idx = 0; idx < num_certificates; idx++)
+        {
+            bool is_current;
+
+            cert_verified[idx] = false;
+            if (!has_manifest_file ||
+                ((entry_prefixes[idx] = build_manifest_entry_prefix(aliases[idx], digests[idx],
+                                                                    digests[num_certificates + idx],
+                                                                    digests[issuer_index])) == NULL))
+            {
+                LOG_INFO("Verified certificates manifest unavailable for alias %s", aliases[idx]);
+            }
+
+            is_current = (manifest != NULL) && (entry_prefixes[idx] != NULL) &&
+                         is_manifest_entry_current(manifest, STRING_c_str(entry_prefixes[idx]));
+            hsm_metrics_cache_access(HSM_METRICS_CACHE_VERIFIED_MANIFEST, is_current);
+            if (is_current)
+            {
+                LOG_DEBUG("Certificate for alias %s unchanged since last verification", aliases[idx]);
+                cert_verified[idx] = true;
+            }
+            else
+            {
+                // certificates and keys are kept in two halves of the same array
+                pending_files[num_pending] = cert_file_paths[idx];
+                pending_files[num_certificates + num_pending] = key_file_paths[idx];
+                pending_index[num_pending] = idx;
+                num_pending++;
+            }
+        }
+
+        if (num_pending == 0)
+        {
+            result = 0;
+        }
+        else if (verify_certificates(pending_files, pending_files + num_certificates, num_pending,
+                                     issuer_cert_path, pending_verified, num_pending) != 0)
+        {
+            LOG_ERROR("Error trying to verify certificates issued by %s", issuer_cert_path);
+            result = __FAILURE__;
+        }
+        else
+        {
+            for (idx = 0; idx < num_pending; idx++)
+            {
+                size_t cert_idx = pending_index[idx];
+
+                cert_verified[cert_idx] = pending_verified[idx];
+                if (pending_verified[idx] && (entry_prefixes[cert_idx] != NULL) &&
+                    (record_manifest_entry(store, STRING_c_str(manifest_file),
+                                           STRING_c_str(entry_prefixes[cert_idx]),
+                                           cert_file_paths[cert_idx]) != 0))
+                {
+                    LOG_INFO("Could not record verification of certificate for alias %s",
+                             aliases[cert_idx]);
+                }
+            }
+            result = 0;
+        }
+    }
+
+    if (manifest != NULL)
+    {
+        free(manifest);
+    }
+    if (entry_prefixes != NULL)
+    {
+        for (idx = 0; idx < num_certificates; idx++)
+        {
+            if (entry_prefixes[idx] != NULL)
+            {
+                STRING_delete(entry_prefixes[idx]);
+            }
+        }
+        free(entry_prefixes);
+    }
+    if (digests != NULL)
+    {
+        for (idx = 0; idx < 2 * num_certificates + 1; idx++)
+        {
+            STRING_delete(digests[idx]);
+        }
+        free(digests);
+    }
+    if (manifest_file != NULL)
+    {
+        STRING_delete(manifest_file);
+    }
+    free(pending_files);
+    free(pending_index);
+    free(pending_verified);
+
+    return result;
+}
+
+static int verify_certificate_with_manifest
+(
+    const CRYPTO_STORE *store,
+    const char *alias,
+    const char *cert_file_path,
+    const char *key_file_path,
+    const char *issuer_cert_path,
+    bool *cert_verified
+)
+{
+    return verify_certificates_with_manifest(store, &alias, &cert_file_path, &key_file_path, 1,
+                                             issuer_cert_path, cert_verified);
+}
+
+//##############################################################################
+// HSM certificate provisioning
 //##############################################################################
 static CERT_PROPS_HANDLE create_ca_certificate_properties
 (
@@ -1443,7 +2586,7 @@ static int remove_if_cert_and_key_exist_by_alias
         LOG_ERROR("Could not allocate string handles for storing certificate and key paths");
         result = __FAILURE__;
     }
-    else if (build_cert_file_paths(alias, alias_cert_handle, alias_pk_handle) != 0)
+    else if (build_cert_file_paths(store, alias, alias_cert_handle, alias_pk_handle) != 0)
     {
         LOG_ERROR("Could not create file paths to the certificate and private key for alias %s", alias);
         result = __FAILURE__;
@@ -1502,6 +2645,7 @@ static int load_if_cert_and_key_exist_by_alias
 )
 {
     int result;
+    CRYPTO_STORE *store = (CRYPTO_STORE*)handle;
 
     STRING_HANDLE alias_cert_handle = NULL;
     STRING_HANDLE alias_pk_handle = NULL;
@@ -1512,7 +2656,7 @@ static int load_if_cert_and_key_exist_by_alias
         LOG_ERROR("Could not allocate string handles for storing certificate and key paths");
         result = LOAD_ERR_FAILED;
     }
-    else if (build_cert_file_paths(alias, alias_cert_handle, alias_pk_handle) != 0)
+    else if (build_cert_file_paths(store, alias, alias_cert_handle, alias_pk_handle) != 0)
     {
         LOG_ERROR("Could not create file paths to the certificate and private key for alias %s", alias);
         result = LOAD_ERR_FAILED;
@@ -1571,7 +2715,7 @@ static int load_if_cert_and_key_exist_by_alias
     return result;
 }
 
-static int create_owner_ca_cert(void)
+static int create_owner_ca_cert(CRYPTO_STORE *store)
 {
     int result;
     CERT_PROPS_HANDLE ca_props;
@@ -1587,7 +2731,7 @@ static int create_owner_ca_cert(void)
     }
     else
     {
-        result = edge_hsm_client_store_create_pki_cert_internal(g_crypto_store, ca_props,
+        result = edge_hsm_client_store_create_pki_cert_internal(store, ca_props,
                                                                 OWNER_CA_PATHLEN);
         cert_properties_destroy(ca_props);
     }
@@ -1595,7 +2739,7 @@ static int create_owner_ca_cert(void)
     return result;
 }
 
-static int create_device_ca_cert(void)
+static int create_device_ca_cert(CRYPTO_STORE *store)
 {
     int result;
     CERT_PROPS_HANDLE ca_props;
@@ -1611,7 +2755,7 @@ static int create_device_ca_cert(void)
     }
     else
     {
-        result = edge_hsm_client_store_create_pki_cert_internal(g_crypto_store,
+        result = edge_hsm_client_store_create_pki_cert_internal(store,
                                                                 ca_props,
                                                                 DEVICE_CA_PATHLEN);
         cert_properties_destroy(ca_props);
@@ -1620,68 +2764,112 @@ static int create_device_ca_cert(void)
     return result;
 }
 
+#define EDGE_CA_NUM_CERTS 2
+
 /**
  * Generate the Owner CA and Device CA certificate in order to enable the quick start scenario.
- * Validate each certificate since it might have expired or the issuer certificate has been
- * modified.
+ * Validate each certificate since it might have expired, its private key might have been
+ * replaced or the issuer certificate has been modified. Both certificates are issued by the
+ * owner CA and are verified together.
  */
-static int generate_edge_hsm_certificates_if_needed(void)
+static int generate_edge_hsm_certificates_if_needed(CRYPTO_STORE *store)
 {
     int result;
+    const char *aliases[EDGE_CA_NUM_CERTS] = { OWNER_CA_ALIAS, hsm_get_device_ca_alias() };
+    STRING_HANDLE cert_handles[EDGE_CA_NUM_CERTS] = { NULL, NULL };
+    STRING_HANDLE pk_handles[EDGE_CA_NUM_CERTS] = { NULL, NULL };
+    const char *cert_file_paths[EDGE_CA_NUM_CERTS];
+    const char *key_file_paths[EDGE_CA_NUM_CERTS];
+    bool cert_verified[EDGE_CA_NUM_CERTS] = { false, false };
+    size_t num_existing = 0;
+    size_t idx;
+
+    result = 0;
+    for (idx = 0; (result == 0) && (idx < EDGE_CA_NUM_CERTS); idx++)
+    {
+        if (((cert_handles[idx] = STRING_new()) == NULL) ||
+            ((pk_handles[idx] = STRING_new()) == NULL))
+        {
+            LOG_ERROR("Could not allocate string handles for storing certificate and key paths");
+            result = __FAILURE__;
+        }
+        else if (build_cert_file_paths(store, aliases[idx], cert_handles[idx], pk_handles[idx]) != 0)
+        {
+            LOG_ERROR("Could not create file paths to the certificate and private key for alias %s",
+                      aliases[idx]);
+            result = __FAILURE__;
+        }
+        else
+        {
+            cert_file_paths[idx] = STRING_c_str(cert_handles[idx]);
+            key_file_paths[idx] = STRING_c_str(pk_handles[idx]);
+            // the device CA is only worth verifying when the owner CA exists
+            if ((num_existing == idx) &&
+                is_file_valid(cert_file_paths[idx]) && is_file_valid(key_file_paths[idx]))
+            {
+                num_existing++;
+            }
+        }
+    }
 
-    int load_status = load_if_cert_and_key_exist_by_alias(g_crypto_store,
-                                                          OWNER_CA_ALIAS,
-                                                          OWNER_CA_ALIAS);
-
-    if (load_status == LOAD_ERR_FAILED)
+    if (result != 0)
+    {
+        LOG_ERROR("Could not check and load owner and device CA certificates and keys");
+    }
+    else if ((num_existing > 0) &&
+             (verify_certificates_with_manifest(store, aliases, cert_file_paths, key_file_paths,
+                                                num_existing, cert_file_paths[0],
+                                                cert_verified) != 0))
     {
-        LOG_ERROR("Could not check and load owner CA certificate and key");
+        LOG_ERROR("Failure when verifying owner and device CA certificates");
         result = __FAILURE__;
     }
-    else if ((load_status == LOAD_ERR_VERIFICATION_FAILED) ||
-             (load_status == LOAD_ERR_NOT_FOUND))
+    else if (!cert_verified[0])
     {
-        LOG_INFO("Load status %d. Regenerating owner and device CA certs and keys", load_status);
-        if (create_owner_ca_cert() != 0)
+        LOG_INFO("Owner CA certificate missing or invalid. Regenerating owner and device CA certs and keys");
+        if (create_owner_ca_cert(store) != 0)
         {
             result = __FAILURE__;
         }
-        else if (create_device_ca_cert() != 0)
+        else if (create_device_ca_cert(store) != 0)
         {
             result = __FAILURE__;
         }
-        else
-        {
-            result = 0;
-        }
     }
-    else
+    else if (edge_hsm_client_store_insert_pki_cert(store, OWNER_CA_ALIAS, OWNER_CA_ALIAS,
+                                                   cert_file_paths[0], key_file_paths[0]) != 0)
     {
-        // owner ca was successfully created, now load/create the device CA cert
-        load_status = load_if_cert_and_key_exist_by_alias(g_crypto_store,
-                                                          hsm_get_device_ca_alias(),
-                                                          OWNER_CA_ALIAS);
-        if (load_status == LOAD_ERR_FAILED)
+        LOG_ERROR("Could not load certificates into store for alias %s", OWNER_CA_ALIAS);
+        result = __FAILURE__;
+    }
+    else if (!cert_verified[1])
+    {
+        LOG_DEBUG("Device CA certificate missing or invalid. Generating device CA cert and key");
+        if (create_device_ca_cert(store) != 0)
         {
-            LOG_ERROR("Could not check and load device CA certificate and key");
             result = __FAILURE__;
         }
-        else if ((load_status == LOAD_ERR_VERIFICATION_FAILED) ||
-                 (load_status == LOAD_ERR_NOT_FOUND))
+    }
+    else if (edge_hsm_client_store_insert_pki_cert(store, aliases[1], OWNER_CA_ALIAS,
+                                                   cert_file_paths[1], key_file_paths[1]) != 0)
+    {
+        LOG_ERROR("Could not load certificates into store for alias %s", aliases[1]);
+        result = __FAILURE__;
+    }
+    else
+    {
+        LOG_DEBUG("Successfully loaded pre-existing owner and device CA certificates");
+    }
+
+    for (idx = 0; idx < EDGE_CA_NUM_CERTS; idx++)
+    {
+        if (cert_handles[idx] != NULL)
         {
-            LOG_DEBUG("Load status %d. Generating device CA cert and key", load_status);
-            if (create_device_ca_cert() != 0)
-            {
-                result = __FAILURE__;
-            }
-            else
-            {
-                result = 0;
-            }
+            STRING_delete(cert_handles[idx]);
         }
-        else
+        if (pk_handles[idx] != NULL)
         {
-            result = 0;
+            STRING_delete(pk_handles[idx]);
         }
     }
 
@@ -1715,7 +2903,7 @@ static int get_tg_env_vars(char **trusted_certs_path, char **device_ca_path, cha
     return result;
 }
 
-static int hsm_provision_edge_certificates(void)
+static int hsm_provision_edge_certificates(CRYPTO_STORE *store)
 {
     int result;
     unsigned int mask = 0, i = 0;
@@ -1791,141 +2979,636 @@ static int hsm_provision_edge_certificates(void)
 
         LOG_DEBUG("Transparent gateway setup mask 0x%02x", mask);
 
-        if (env_set && (mask != 0x7))
-        {
-            LOG_ERROR("To operate Edge as a transparent gateway, set "
-                      "env variables with valid values:\n  %s\n  %s\n  %s",
-                      ENV_TRUSTED_CA_CERTS_PATH, ENV_DEVICE_CA_PATH, ENV_DEVICE_PK_PATH);
-            result = __FAILURE__;
-        }
-        // none of the certificate files were provided so generate them if needed
-        else if (!env_set && (generate_edge_hsm_certificates_if_needed() != 0))
-        {
-            LOG_ERROR("Failure generating required HSM certificates");
-            result = __FAILURE__;
-        }
-        else if (env_set && (edge_hsm_client_store_insert_pki_cert(g_crypto_store,
-                                                                hsm_get_device_ca_alias(),
-                                                                hsm_get_device_ca_alias(), // since we don't know the issuer, we treat this certificate as the issuer
-                                                                device_ca_path,
-                                                                device_pk_path) != 0))
+        if (env_set && (mask != 0x7))
+        {
+            LOG_ERROR("To operate Edge as a transparent gateway, set "
+                      "env variables with valid values:\n  %s\n  %s\n  %s",
+                      ENV_TRUSTED_CA_CERTS_PATH, ENV_DEVICE_CA_PATH, ENV_DEVICE_PK_PATH);
+            result = __FAILURE__;
+        }
+        // none of the certificate files were provided so generate them if needed
+        else if (!env_set && (generate_edge_hsm_certificates_if_needed(store) != 0))
+        {
+            LOG_ERROR("Failure generating required HSM certificates");
+            result = __FAILURE__;
+        }
+        else if (env_set && (edge_hsm_client_store_insert_pki_cert(store,
+                                                                hsm_get_device_ca_alias(),
+                                                                hsm_get_device_ca_alias(), // since we don't know the issuer, we treat this certificate as the issuer
+                                                                device_ca_path,
+                                                                device_pk_path) != 0))
+        {
+            LOG_ERROR("Failure inserting device CA certificate and key into the HSM store`");
+            result = __FAILURE__;
+        }
+        else
+        {
+            const char *trusted_ca;
+            STRING_HANDLE owner_ca_file = NULL;
+            // all required certificate files are available/generated now setup the trust bundle
+            if (trusted_certs_path == NULL)
+            {
+                // certificates were generated so set the Owner CA as the trusted CA cert
+                trusted_ca = NULL;
+                if (get_pki_cert_paths(store, OWNER_CA_ALIAS, &owner_ca_file, NULL) != 0)
+                {
+                    LOG_ERROR("Failure obtaining owner CA certificate entry");
+                }
+                else if ((trusted_ca = STRING_c_str(owner_ca_file)) == NULL)
+                {
+                    LOG_ERROR("Failure obtaining owner CA certificate path");
+                }
+            }
+            else
+            {
+                trusted_ca = trusted_certs_path;
+            }
+
+            if (trusted_ca == NULL)
+            {
+                result = __FAILURE__;
+            }
+            else
+            {
+                result = put_pki_trusted_cert(store, DEFAULT_TRUSTED_CA_ALIAS, trusted_ca);
+            }
+            if (owner_ca_file != NULL)
+            {
+                STRING_delete(owner_ca_file);
+            }
+        }
+        if (trusted_certs_path != NULL)
+        {
+            free(trusted_certs_path);
+        }
+        if (device_ca_path != NULL)
+        {
+            free(device_ca_path);
+        }
+        if (device_pk_path != NULL)
+        {
+            free(device_pk_path);
+        }
+    }
+
+    return result;
+}
+
+static int hsm_provision(CRYPTO_STORE *store)
+{
+    int result;
+
+    // the edge certificates only belong in the edge store
+    if (strcmp(STRING_c_str(store->id), EDGE_STORE_NAME) == 0)
+    {
+        result = hsm_provision_edge_certificates(store);
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Externally provisioned certificate reload
+//##############################################################################
+/**
+ * When ENV_WATCH_CERTS is set to "on" and the device CA certificate, its
+ * private key and the trusted CA certs are provided through env variables,
+ * those files are watched so that operators can rotate them without
+ * restarting. Once a rotation settles the device CA certificate is verified
+ * again and, if it passes, the device CA entry and the trusted certs bundle
+ * rebuilt from the rotated files are published together in a single
+ * snapshot, so readers never observe the new device CA along with the old
+ * bundle. A rotation that fails verification is logged and the current
+ * snapshot is kept. Reloads run on the watch thread.
+ */
+static int replace_edge_certificates
+(
+    CRYPTO_STORE *store,
+    const char *device_ca_path,
+    const char *device_pk_path
+)
+{
+    int result;
+
+    if (lock_store_writer(store) != 0)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        CERT_INFO_HANDLE bundle = NULL;
+        STORE_ENTRY_PKI_CERT *cert_entry = NULL;
+        STORE_SNAPSHOT *update;
+        void *replaced_entry = NULL;
+
+        if (create_trusted_certs_bundle(store, &bundle) != 0)
+        {
+            LOG_ERROR("Could not rebuild the trusted certs bundle");
+            result = __FAILURE__;
+        }
+        else if ((cert_entry = create_pki_cert_entry(hsm_get_device_ca_alias(),
+                                                     hsm_get_device_ca_alias(),
+                                                     device_ca_path,
+                                                     device_pk_path)) == NULL)
+        {
+            LOG_ERROR("Could not allocate memory to store the device CA certificate");
+            result = __FAILURE__;
+        }
+        else if ((update = begin_snapshot_update(store, SNAPSHOT_PKI_CERTS)) == NULL)
+        {
+            LOG_ERROR("Could not update the certificate store");
+            result = __FAILURE__;
+        }
+        else if (store_index_put(update->indexes[SNAPSHOT_PKI_CERTS], STRING_c_str(cert_entry->id),
+                                 cert_entry, &replaced_entry) != 0)
+        {
+            LOG_ERROR("Could not insert the device CA certificate in the store");
+            discard_snapshot_update(store, update);
+            result = __FAILURE__;
+        }
+        else
+        {
+            update->pki_trusted_certs_bundle = bundle;
+            publish_snapshot(store, update);
+            if (replaced_entry != NULL)
+            {
+                destroy_pki_cert((STORE_ENTRY_PKI_CERT*)replaced_entry);
+            }
+            // now owned by the published snapshot
+            bundle = NULL;
+            cert_entry = NULL;
+            result = 0;
+        }
+
+        if (cert_entry != NULL)
+        {
+            destroy_pki_cert(cert_entry);
+        }
+        if (bundle != NULL)
+        {
+            certificate_info_destroy(bundle);
+        }
+        unlock_store_writer(store);
+    }
+
+    return result;
+}
+
+static void reload_edge_certificates_cb(void *context)
+{
+    CRYPTO_STORE *store = (CRYPTO_STORE*)context;
+    char *trusted_certs_path = NULL;
+    char *device_ca_path = NULL;
+    char *device_pk_path = NULL;
+    bool verified = false;
+
+    LOG_INFO("Externally provisioned certificates changed, reloading them");
+    if (get_tg_env_vars(&trusted_certs_path, &device_ca_path, &device_pk_path) != 0)
+    {
+        LOG_ERROR("Could not reload the externally provisioned certificates");
+    }
+    else if ((trusted_certs_path == NULL) || !is_file_valid(trusted_certs_path) ||
+             (device_ca_path == NULL) || !is_file_valid(device_ca_path) ||
+             (device_pk_path == NULL) || !is_file_valid(device_pk_path))
+    {
+        LOG_ERROR("Rotated certificate files cannot be accessed, keeping the current certificates");
+    }
+    // like at provisioning the device CA certificate is treated as its own issuer
+    else if ((verify_certificate(device_ca_path, device_pk_path, device_ca_path, &verified) != 0) ||
+             !verified)
+    {
+        LOG_ERROR("Rotated device CA certificate %s failed verification, keeping the current certificates",
+                  device_ca_path);
+    }
+    else if (replace_edge_certificates(store, device_ca_path, device_pk_path) != 0)
+    {
+        LOG_ERROR("Could not replace the device CA certificate and trusted certs bundle");
+    }
+    else
+    {
+        LOG_INFO("Reloaded device CA certificate %s and trusted CA certs %s",
+                 device_ca_path, trusted_certs_path);
+    }
+
+    if (trusted_certs_path != NULL)
+    {
+        free(trusted_certs_path);
+    }
+    if (device_ca_path != NULL)
+    {
+        free(device_ca_path);
+    }
+    if (device_pk_path != NULL)
+    {
+        free(device_pk_path);
+    }
+}
+
+static void start_edge_certificates_watch(CRYPTO_STORE *store)
+{
+    char *watch_certs = NULL;
+    char *trusted_certs_path = NULL;
+    char *device_ca_path = NULL;
+    char *device_pk_path = NULL;
+
+    if (hsm_get_env(ENV_WATCH_CERTS, &watch_certs) != 0)
+    {
+        LOG_ERROR("Could not lookup env variable %s", ENV_WATCH_CERTS);
+    }
+    else if ((watch_certs == NULL) || (strlen(watch_certs) == 0) ||
+             (strcmp(watch_certs, WATCH_CERTS_OFF) == 0))
+    {
+        LOG_DEBUG("Externally provisioned certificates are not watched");
+    }
+    else if (strcmp(watch_certs, WATCH_CERTS_ON) != 0)
+    {
+        LOG_ERROR("Unknown value %s set in env variable %s, certificates are not watched",
+                  watch_certs, ENV_WATCH_CERTS);
+    }
+    else if (get_tg_env_vars(&trusted_certs_path, &device_ca_path, &device_pk_path) != 0)
+    {
+        LOG_ERROR("Could not lookup the externally provisioned certificates to watch");
+    }
+    else if ((trusted_certs_path == NULL) || (device_ca_path == NULL) || (device_pk_path == NULL))
+    {
+        LOG_INFO("Env variable %s is set but the certificates were not provided "
+                 "through env variables, there is nothing to watch", ENV_WATCH_CERTS);
+    }
+    else
+    {
+        const char *files[3];
+        files[0] = trusted_certs_path;
+        files[1] = device_ca_path;
+        files[2] = device_pk_path;
+        if ((store->store_entry->cert_watch = hsm_file_watch_start(files, 3, reload_edge_certificates_cb,
+                                                                   store)) == NULL)
+        {
+            LOG_ERROR("Could not watch the externally provisioned certificates, "
+                      "rotating them requires a restart");
+        }
+        else
+        {
+            LOG_INFO("Watching device CA certificate %s and trusted CA certs %s for changes",
+                     device_ca_path, trusted_certs_path);
+        }
+    }
+
+    if (watch_certs != NULL)
+    {
+        free(watch_certs);
+    }
+    if (trusted_certs_path != NULL)
+    {
+        free(trusted_certs_path);
+    }
+    if (device_ca_path != NULL)
+    {
+        free(device_ca_path);
+    }
+    if (device_pk_path != NULL)
+    {
+        free(device_pk_path);
+    }
+}
+
+static void stop_edge_certificates_watch(CRYPTO_STORE *store)
+{
+    if (store->store_entry->cert_watch != NULL)
+    {
+        // waits for a reload in progress to complete
+        hsm_file_watch_stop(store->store_entry->cert_watch);
+        store->store_entry->cert_watch = NULL;
+    }
+}
+
+static int open_store_backend(CRYPTO_STORE *store)
+{
+    int result;
+    char *backend = NULL;
+
+    if (hsm_get_env(ENV_STORE_BACKEND, &backend) != 0)
+    {
+        LOG_ERROR("Could not lookup env variable %s", ENV_STORE_BACKEND);
+        result = __FAILURE__;
+    }
+    else if ((backend == NULL) || (strlen(backend) == 0) ||
+             (strcmp(backend, STORE_BACKEND_FILES) == 0))
+    {
+        result = 0;
+    }
+    else if (strcmp(backend, STORE_BACKEND_LOG) != 0)
+    {
+        LOG_ERROR("Unknown store backend %s set in env variable %s, using %s",
+                  backend, ENV_STORE_BACKEND, STORE_BACKEND_FILES);
+        result = 0;
+    }
+    else
+    {
+        STRING_HANDLE log_file;
+
+        if ((log_file = STRING_clone(store->base_dir)) == NULL)
         {
-            LOG_ERROR("Failure inserting device CA certificate and key into the HSM store`");
+            LOG_ERROR("Could not create string handle");
             result = __FAILURE__;
         }
         else
         {
-            const char *trusted_ca;
-            // all required certificate files are available/generated now setup the trust bundle
-            if (trusted_certs_path == NULL)
-            {
-                // certificates were generated so set the Owner CA as the trusted CA cert
-                STORE_ENTRY_PKI_CERT *store_entry;
-                trusted_ca = NULL;
-                if ((store_entry = get_pki_cert(g_crypto_store, OWNER_CA_ALIAS)) == NULL)
-                {
-                    LOG_ERROR("Failure obtaining owner CA certificate entry");
-                }
-                else if ((trusted_ca = STRING_c_str(store_entry->cert_file)) == NULL)
-                {
-                    LOG_ERROR("Failure obtaining owner CA certificate path");
-                }
-            }
-            else
+            if ((STRING_concat(log_file, SLASH) != 0) ||
+                (STRING_concat(log_file, ENC_KEYS_DIR) != 0) ||
+                (STRING_concat(log_file, SLASH) != 0) ||
+                (STRING_concat(log_file, ENC_KEYS_LOG_FILE) != 0))
             {
-                trusted_ca = trusted_certs_path;
+                LOG_ERROR("Could not construct path to encryption keys store log");
+                result = __FAILURE__;
             }
-
-            if (trusted_ca == NULL)
+            else if ((store->store_entry->enc_keys_log =
+                        hsm_store_log_open(STRING_c_str(log_file))) == NULL)
             {
+                LOG_ERROR("Could not open encryption keys store log");
                 result = __FAILURE__;
             }
             else
             {
-                result = put_pki_trusted_cert(g_crypto_store, DEFAULT_TRUSTED_CA_ALIAS, trusted_ca);
+                LOG_INFO("Encryption keys are persisted in store log %s", STRING_c_str(log_file));
+                result = 0;
             }
+            STRING_delete(log_file);
         }
-        if (trusted_certs_path != NULL)
-        {
-            free(trusted_certs_path);
-        }
-        if (device_ca_path != NULL)
-        {
-            free(device_ca_path);
-        }
-        if (device_pk_path != NULL)
-        {
-            free(device_pk_path);
-        }
+    }
+
+    if (backend != NULL)
+    {
+        free(backend);
     }
 
     return result;
 }
 
-static int hsm_provision(void)
+static int hsm_deprovision(void)
+{
+    return 0;
+}
+
+//##############################################################################
+// Store registry
+//##############################################################################
+/**
+ * Each store name maps to its own provisioned store with its own base dir,
+ * snapshot, readers and writer lock, so operations on one store never wait
+ * on another. The registry lock guards the list of stores and their counts
+ * and is only held briefly. A new store is registered as provisioning and its
+ * creator provisions it without the registry lock, so that provisioning one
+ * store, which reads and verifies certificates, does not block the others.
+ * Create, destroy and open of a store which is provisioning wait until it is
+ * done, so a store is provisioned only once. Each open handle holds a
+ * reference to its store, which is released once the store has been
+ * destroyed and its last handle closed.
+ */
+static int lock_registry(void)
 {
     int result;
+    LOCK_HANDLE lock = hsm_lock_get(&g_registry_lock);
 
-    if (get_base_dir() == NULL)
+    if (lock == NULL)
     {
-        LOG_ERROR("HSM base directory does not exist. "
-                  "Set environment variable IOTEDGE_HOMEDIR to a valid path.");
+        LOG_ERROR("Could not create the store registry lock");
+        result = __FAILURE__;
+    }
+    else if (Lock(lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not acquire the store registry lock");
         result = __FAILURE__;
     }
     else
     {
-        result = hsm_provision_edge_certificates();
+        result = 0;
     }
 
     return result;
 }
 
-static int hsm_deprovision(void)
+static void unlock_registry(void)
 {
-    return 0;
+    if (Unlock(g_registry_lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not release the store registry lock");
+    }
+}
+
+// the registry lock must be held
+static CRYPTO_STORE* find_store(const char *store_name)
+{
+    CRYPTO_STORE *result = g_crypto_stores;
+
+    while ((result != NULL) &&
+           (!result->provisioned || result->provisioning ||
+            (strcmp(STRING_c_str(result->id), store_name) != 0)))
+    {
+        result = result->next;
+    }
+
+    return result;
+}
+
+// the registry lock must be held
+static bool is_store_provisioning(const char *store_name)
+{
+    const CRYPTO_STORE *current = g_crypto_stores;
+
+    while ((current != NULL) &&
+           (!current->provisioning || (strcmp(STRING_c_str(current->id), store_name) != 0)))
+    {
+        current = current->next;
+    }
+
+    return (current != NULL);
+}
+
+// the registry lock must be held, it is released while waiting
+static int wait_for_store_provisioning(const char *store_name)
+{
+    int result = 0;
+
+    while ((result == 0) && is_store_provisioning(store_name))
+    {
+        if ((g_registry_cond == NULL) && ((g_registry_cond = Condition_Init()) == NULL))
+        {
+            LOG_ERROR("Could not create the store registry condition");
+            result = __FAILURE__;
+        }
+        else
+        {
+            g_registry_waiters++;
+            if (Condition_Wait(g_registry_cond, g_registry_lock, 0) != COND_OK)
+            {
+                LOG_ERROR("Could not wait for HSM store %s to be provisioned", store_name);
+                result = __FAILURE__;
+            }
+            g_registry_waiters--;
+        }
+    }
+
+    return result;
+}
+
+// the registry lock must be held, waiters recheck their own store when woken
+static void end_store_provisioning(CRYPTO_STORE *store)
+{
+    int idx;
+
+    store->provisioning = false;
+    for (idx = 0; idx < g_registry_waiters; idx++)
+    {
+        (void)Condition_Post(g_registry_cond);
+    }
+}
+
+// unlinks a store which failed to provision, the registry lock must be held
+static void unregister_store(CRYPTO_STORE *store)
+{
+    CRYPTO_STORE **link = &g_crypto_stores;
+
+    while ((*link != NULL) && (*link != store))
+    {
+        link = &(*link)->next;
+    }
+    if (*link != NULL)
+    {
+        *link = store->next;
+    }
+}
+
+// the registry lock must be held
+static bool is_store_registered(const CRYPTO_STORE *store)
+{
+    const CRYPTO_STORE *current = g_crypto_stores;
+
+    while ((current != NULL) && (current != store))
+    {
+        current = current->next;
+    }
+
+    return (current != NULL);
+}
+
+// handles passed to store operations are referenced by open, so the store
+// cannot go away under the caller and only its state needs checking
+static bool is_store_provisioned(const CRYPTO_STORE *store)
+{
+    return (hsm_atomic_load((HSM_ATOMIC_LONG*)&store->provisioned) != 0);
+}
+
+// drops a reference with the registry lock held, the store is unlinked and
+// returned once unreferenced so that the caller destroys it after unlocking
+static CRYPTO_STORE* release_store(CRYPTO_STORE *store)
+{
+    CRYPTO_STORE *result = NULL;
+
+    store->ref_count--;
+    if (store->ref_count == 0)
+    {
+        unregister_store(store);
+        result = store;
+    }
+
+    return result;
 }
 
 //##############################################################################
 // Store interface implementation
 //##############################################################################
+static int provision_store(CRYPTO_STORE *store)
+{
+    int result;
+
+    if ((hsm_provision(store) != 0) || (open_store_backend(store) != 0))
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        if (strcmp(STRING_c_str(store->id), EDGE_STORE_NAME) == 0)
+        {
+            start_edge_certificates_watch(store);
+        }
+        result = 0;
+    }
+
+    return result;
+}
+
 static int edge_hsm_client_store_create(const char* store_name)
 {
     int result;
+    CRYPTO_STORE *store = NULL;
+    CRYPTO_STORE *failed = NULL;
 
     if ((store_name == NULL) || (strlen(store_name) == 0))
     {
         result = __FAILURE__;
     }
-    else if ((g_hsm_state == HSM_STATE_UNPROVISIONED) ||
-             (g_hsm_state == HSM_STATE_PROVISIONING_ERROR))
+    else if (lock_registry() != 0)
+    {
+        result = __FAILURE__;
+    }
+    else
     {
-        g_crypto_store = create_store(store_name);
-        if (g_crypto_store == NULL)
+        bool is_locked = true;
+
+        if (wait_for_store_provisioning(store_name) != 0)
+        {
+            result = __FAILURE__;
+        }
+        else if ((store = find_store(store_name)) != NULL)
+        {
+            store->create_count++;
+            result = 0;
+        }
+        else if ((store = create_store(store_name)) == NULL)
         {
-            LOG_ERROR("Could not create HSM store");
+            LOG_ERROR("Could not create HSM store %s", store_name);
             result = __FAILURE__;
         }
         else
         {
-            if (hsm_provision() != 0)
+            store->provisioning = true;
+            store->next = g_crypto_stores;
+            g_crypto_stores = store;
+            unlock_registry();
+
+            result = provision_store(store);
+
+            if (lock_registry() != 0)
             {
-                destroy_store(g_crypto_store);
-                g_crypto_store = NULL;
-                g_hsm_state = HSM_STATE_PROVISIONING_ERROR;
+                // the registry is unusable, the store is left provisioning
+                LOG_ERROR("Could not complete provisioning of HSM store %s", store_name);
+                is_locked = false;
                 result = __FAILURE__;
             }
             else
             {
-                g_store_ref_count = 1;
-                g_hsm_state = HSM_STATE_PROVISIONED;
-                result = 0;
+                if (result != 0)
+                {
+                    unregister_store(store);
+                    failed = store;
+                }
+                end_store_provisioning(store);
             }
         }
+
+        if (is_locked)
+        {
+            unlock_registry();
+        }
     }
-    else
+
+    if (failed != NULL)
     {
-        g_store_ref_count++;
-        result = 0;
+        destroy_store(failed);
     }
 
     return result;
@@ -1934,31 +3617,51 @@ static int edge_hsm_client_store_create(const char* store_name)
 static int edge_hsm_client_store_destroy(const char* store_name)
 {
     int result;
+    CRYPTO_STORE *store;
+    CRYPTO_STORE *unreferenced = NULL;
 
     if ((store_name == NULL) || (strlen(store_name) == 0))
     {
         LOG_ERROR("Invald store name parameter");
         result = __FAILURE__;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (lock_registry() != 0)
     {
-        LOG_ERROR("HSM store has not been provisioned");
         result = __FAILURE__;
     }
     else
     {
-        g_store_ref_count--;
-        if (g_store_ref_count == 0)
+        if (wait_for_store_provisioning(store_name) != 0)
+        {
+            result = __FAILURE__;
+        }
+        else if ((store = find_store(store_name)) == NULL)
         {
-            result = hsm_deprovision();
-            destroy_store(g_crypto_store);
-            g_hsm_state = HSM_STATE_UNPROVISIONED;
-            g_crypto_store = NULL;
+            LOG_ERROR("HSM store %s has not been provisioned", store_name);
+            result = __FAILURE__;
         }
         else
         {
-            result = 0;
+            store->create_count--;
+            if (store->create_count == 0)
+            {
+                hsm_atomic_store(&store->provisioned, 0);
+                stop_edge_certificates_watch(store);
+                result = hsm_deprovision();
+                clear_certificate_verification_cache();
+                unreferenced = release_store(store);
+            }
+            else
+            {
+                result = 0;
+            }
         }
+        unlock_registry();
+    }
+
+    if (unreferenced != NULL)
+    {
+        destroy_store(unreferenced);
     }
 
     return result;
@@ -1967,21 +3670,39 @@ static int edge_hsm_client_store_destroy(const char* store_name)
 static HSM_CLIENT_STORE_HANDLE edge_hsm_client_store_open(const char* store_name)
 {
     HSM_CLIENT_STORE_HANDLE result;
+    HSM_TRACE_SCOPE trace;
 
+    HSM_TRACE_BEGIN(&trace, "store.open", store_name, 0);
     if ((store_name == NULL) || (strlen(store_name) == 0))
     {
         LOG_ERROR("Invald store name parameter");
         result = NULL;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (lock_registry() != 0)
     {
-        LOG_ERROR("HSM store has not been provisioned");
         result = NULL;
     }
     else
     {
-        result = (HSM_CLIENT_STORE_HANDLE)g_crypto_store;
+        CRYPTO_STORE *store;
+
+        if (wait_for_store_provisioning(store_name) != 0)
+        {
+            result = NULL;
+        }
+        else if ((store = find_store(store_name)) == NULL)
+        {
+            LOG_ERROR("HSM store %s has not been provisioned", store_name);
+            result = NULL;
+        }
+        else
+        {
+            store->ref_count++;
+            result = (HSM_CLIENT_STORE_HANDLE)store;
+        }
+        unlock_registry();
     }
+    HSM_TRACE_END(&trace, 0, (result != NULL) ? 0 : __FAILURE__);
 
     return result;
 }
@@ -1989,20 +3710,35 @@ static HSM_CLIENT_STORE_HANDLE edge_hsm_client_store_open(const char* store_name
 static int edge_hsm_client_store_close(HSM_CLIENT_STORE_HANDLE handle)
 {
     int result;
+    CRYPTO_STORE *unreferenced = NULL;
 
     if (handle == NULL)
     {
         LOG_ERROR("Invald store name parameter");
         result = __FAILURE__;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (lock_registry() != 0)
     {
-        LOG_ERROR("HSM store has not been provisioned");
         result = __FAILURE__;
     }
     else
     {
-        result = 0;
+        if (!is_store_registered((CRYPTO_STORE*)handle))
+        {
+            LOG_ERROR("HSM store has not been opened");
+            result = __FAILURE__;
+        }
+        else
+        {
+            unreferenced = release_store((CRYPTO_STORE*)handle);
+            result = 0;
+        }
+        unlock_registry();
+    }
+
+    if (unreferenced != NULL)
+    {
+        destroy_store(unreferenced);
     }
 
     return result;
@@ -2033,14 +3769,18 @@ static int edge_hsm_client_store_insert_sas_key
         LOG_ERROR("Invalid key parameters");
         result = __FAILURE__;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (!is_store_provisioned((CRYPTO_STORE*)handle))
     {
         LOG_ERROR("HSM store has not been provisioned");
         result = __FAILURE__;
     }
     else
     {
+        HSM_TRACE_SCOPE trace;
+
+        HSM_TRACE_BEGIN(&trace, "store.insert_sas_key", key_name, key_size);
         result = put_key((CRYPTO_STORE*)handle, HSM_KEY_SAS, key_name, key, key_size);
+        HSM_TRACE_END(&trace, 0, result);
     }
 
     return result;
@@ -2070,7 +3810,7 @@ static int edge_hsm_client_store_remove_key
         LOG_ERROR("Invalid key name parameter");
         result = __FAILURE__;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (!is_store_provisioned((CRYPTO_STORE*)handle))
     {
         LOG_ERROR("HSM store has not been provisioned");
         result = __FAILURE__;
@@ -2084,7 +3824,7 @@ static int edge_hsm_client_store_remove_key
             {
                 LOG_DEBUG("Encryption key not loaded in HSM store %s", key_name);
             }
-            result = delete_encryption_key_file(key_name);
+            result = delete_encryption_key_file((CRYPTO_STORE*)handle, key_name);
         }
         else
         {
@@ -2111,7 +3851,10 @@ static KEY_HANDLE edge_hsm_client_open_key
 )
 {
     KEY_HANDLE result;
+    size_t buffer_size = 0;
+    HSM_TRACE_SCOPE trace;
 
+    HSM_TRACE_BEGIN(&trace, "store.open_key", key_name, 0);
     if (handle == NULL)
     {
         LOG_ERROR("Invalid handle parameter");
@@ -2127,7 +3870,7 @@ static KEY_HANDLE edge_hsm_client_open_key
         LOG_ERROR("Invalid key name parameter");
         result = NULL;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (!is_store_provisioned((CRYPTO_STORE*)handle))
     {
         LOG_ERROR("HSM store has not been provisioned");
         result = NULL;
@@ -2154,33 +3897,31 @@ static KEY_HANDLE edge_hsm_client_open_key
         else
         {
             STORE_ENTRY_KEY* key_entry;
-            size_t buffer_size = 0;
-            const unsigned char *buffer_ptr = NULL;
-            if ((key_entry = get_key(store, key_type, key_name)) == NULL)
+            HSM_RCU_READER reader;
+            // the key handle holds its own copy of the key so the
+            // entry is only needed until the handle is created
+            const STORE_SNAPSHOT *snapshot = begin_store_read(store, &reader);
+            if ((key_entry = get_key(snapshot, key_type, key_name)) == NULL)
             {
                 LOG_ERROR("Could not find key name %s", key_name);
                 result = NULL;
             }
-            else if (((buffer_ptr = BUFFER_u_char(key_entry->key)) == NULL) ||
-                     (BUFFER_size(key_entry->key, &buffer_size) != 0) ||
-                     (buffer_size == 0))
-            {
-                LOG_ERROR("Invalid key buffer for %s", key_name);
-                result = NULL;
-            }
             else
             {
+                buffer_size = key_entry->key_size;
                 if (key_type == HSM_KEY_ENCRYPTION)
                 {
-                    result = create_encryption_key(buffer_ptr, buffer_size);
+                    result = create_encryption_key(key_entry->key, buffer_size);
                 }
                 else
                 {
-                    result = create_sas_key(buffer_ptr, buffer_size);
+                    result = create_sas_key(key_entry->key, buffer_size);
                 }
             }
+            end_store_read(store, reader);
         }
     }
+    HSM_TRACE_END(&trace, (result != NULL) ? buffer_size : 0, (result != NULL) ? 0 : __FAILURE__);
 
     return result;
 }
@@ -2199,7 +3940,7 @@ static int edge_hsm_client_close_key(HSM_CLIENT_STORE_HANDLE handle, KEY_HANDLE
         LOG_ERROR("Invalid key handle parameter");
         result = __FAILURE__;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (!is_store_provisioned((CRYPTO_STORE*)handle))
     {
         LOG_ERROR("HSM store has not been provisioned");
         result = __FAILURE__;
@@ -2227,23 +3968,27 @@ static CERT_INFO_HANDLE get_cert_info_by_alias(HSM_CLIENT_STORE_HANDLE handle, c
         LOG_ERROR("Invalid alias value");
         result = NULL;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (!is_store_provisioned((CRYPTO_STORE*)handle))
     {
         LOG_ERROR("HSM store has not been provisioned");
         result = NULL;
     }
     else
     {
-        STORE_ENTRY_PKI_CERT *cert_entry;
+        STRING_HANDLE cert_file;
+        STRING_HANDLE pk_file;
         CRYPTO_STORE *store = (CRYPTO_STORE*)handle;
-        if ((cert_entry = get_pki_cert(store, alias)) == NULL)
+        // the files are read outside of the read section
+        if (get_pki_cert_paths(store, alias, &cert_file, &pk_file) != 0)
         {
             LOG_ERROR("Could not find certificate for %s", alias);
             result = NULL;
         }
         else
         {
-            result = prepare_cert_info_handle(store, cert_entry);
+            result = prepare_cert_info_handle(cert_file, pk_file);
+            STRING_delete(cert_file);
+            STRING_delete(pk_file);
         }
     }
 
@@ -2263,7 +4008,7 @@ static int remove_cert_by_alias(HSM_CLIENT_STORE_HANDLE handle, const char* alia
         LOG_ERROR("Invalid alias value");
         result = __FAILURE__;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (!is_store_provisioned((CRYPTO_STORE*)handle))
     {
         LOG_ERROR("HSM store has not been provisioned");
         result = __FAILURE__;
@@ -2282,12 +4027,15 @@ static CERT_INFO_HANDLE edge_hsm_client_store_get_pki_cert
     const char* alias
 )
 {
-    CERT_INFO_HANDLE result = get_cert_info_by_alias(handle, alias);
+    CERT_INFO_HANDLE result;
+    HSM_TRACE_SCOPE trace;
 
-    if (result == NULL)
+    HSM_TRACE_BEGIN(&trace, "store.get_pki_cert", alias, 0);
+    if ((result = get_cert_info_by_alias(handle, alias)) == NULL)
     {
         LOG_ERROR("Could not obtain certificate info handle for alias: %s", alias);
     }
+    HSM_TRACE_END(&trace, 0, (result != NULL) ? 0 : __FAILURE__);
 
     return result;
 }
@@ -2309,22 +4057,22 @@ static int verify_certificate_helper
 {
     int result;
     int cmp = strcmp(alias, issuer_alias);
+    CRYPTO_STORE *store = (CRYPTO_STORE*)handle;
 
     if (cmp == 0)
     {
-        result = verify_certificate(cert_file_path, key_file_path, cert_file_path, cert_verified);
+        result = verify_certificate_with_manifest(store, alias, cert_file_path, key_file_path,
+                                                  cert_file_path, cert_verified);
     }
     else
     {
         STRING_HANDLE issuer_cert_path_handle = NULL;
-        CRYPTO_STORE *store = (CRYPTO_STORE*)handle;
-        STORE_ENTRY_PKI_CERT *cert_entry;
 
         const char *issuer_cert_path = NULL;
-        if ((cert_entry = get_pki_cert(store, issuer_alias)) != NULL)
+        if (get_pki_cert_paths(store, issuer_alias, &issuer_cert_path_handle, NULL) == 0)
         {
             LOG_DEBUG("Certificate already loaded in store for alias %s", issuer_alias);
-            issuer_cert_path = STRING_c_str(cert_entry->cert_file);
+            issuer_cert_path = STRING_c_str(issuer_cert_path_handle);
         }
         else
         {
@@ -2332,7 +4080,7 @@ static int verify_certificate_helper
             {
                 LOG_ERROR("Could not construct string handle to hold the certificate");
             }
-            else if (build_cert_file_paths(issuer_alias, issuer_cert_path_handle, NULL) != 0)
+            else if (build_cert_file_paths(store, issuer_alias, issuer_cert_path_handle, NULL) != 0)
             {
                 LOG_ERROR("Could not create file paths to issuer certificate alias %s", issuer_alias);
             }
@@ -2347,7 +4095,8 @@ static int verify_certificate_helper
             LOG_ERROR("Could not find issuer certificate file %s", issuer_cert_path);
             result = __FAILURE__;
         }
-        else if (verify_certificate(cert_file_path, key_file_path, issuer_cert_path, cert_verified) != 0)
+        else if (verify_certificate_with_manifest(store, alias, cert_file_path, key_file_path,
+                                                  issuer_cert_path, cert_verified) != 0)
         {
             LOG_ERROR("Error trying to verify certificate %s for alias %s", cert_file_path, alias);
             result = __FAILURE__;
@@ -2385,6 +4134,31 @@ static int edge_hsm_client_store_insert_pki_cert
     return result;
 }
 
+// certificate serial numbers are positive and unpredictable
+static int generate_serial_number(int *serial_number)
+{
+    int result;
+    unsigned char random_bytes[sizeof(unsigned int)];
+
+    if (hsm_random_bytes(random_bytes, sizeof(random_bytes)) != 0)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        unsigned int value;
+        memcpy(&value, random_bytes, sizeof(value));
+        *serial_number = (int)(value & INT_MAX);
+        if (*serial_number == 0)
+        {
+            *serial_number = 1;
+        }
+        result = 0;
+    }
+
+    return result;
+}
+
 static int edge_hsm_client_store_create_pki_cert_internal
 (
     HSM_CLIENT_STORE_HANDLE handle,
@@ -2395,6 +4169,7 @@ static int edge_hsm_client_store_create_pki_cert_internal
     int result;
     const char* alias;
     const char* issuer_alias;
+    CRYPTO_STORE *store = (CRYPTO_STORE*)handle;
 
     if ((alias = get_alias(cert_props_handle)) == NULL)
     {
@@ -2410,6 +4185,8 @@ static int edge_hsm_client_store_create_pki_cert_internal
     {
         STRING_HANDLE alias_cert_handle = NULL;
         STRING_HANDLE alias_pk_handle = NULL;
+        STRING_HANDLE issuer_cert_handle = NULL;
+        STRING_HANDLE issuer_pk_handle = NULL;
 
         if (((alias_cert_handle = STRING_new()) == NULL) ||
             ((alias_pk_handle = STRING_new()) == NULL))
@@ -2417,32 +4194,32 @@ static int edge_hsm_client_store_create_pki_cert_internal
             LOG_ERROR("Could not allocate string handles for storing certificate and key paths");
             result = __FAILURE__;
         }
-        else if (build_cert_file_paths(alias, alias_cert_handle, alias_pk_handle) != 0)
+        else if (build_cert_file_paths(store, alias, alias_cert_handle, alias_pk_handle) != 0)
         {
             LOG_ERROR("Could not create file paths to the certificate and private key for alias %s", alias);
             result = __FAILURE__;
         }
         else
         {
-            CRYPTO_STORE *store = (CRYPTO_STORE*)handle;
             const char *issuer_pk_path = NULL;
             const char *issuer_cert_path = NULL;
+            int serial_number = 0;
             const char *alias_pk_path = STRING_c_str(alias_pk_handle);
             const char *alias_cert_path = STRING_c_str(alias_cert_handle);
             result = 0;
             if (strcmp(alias, issuer_alias) != 0)
             {
-                // not a self signed certificate request
-                STORE_ENTRY_PKI_CERT *issuer_cert_entry;
-                if ((issuer_cert_entry = get_pki_cert(store, issuer_alias)) == NULL)
+                // not a self signed certificate request, the issuer paths are copied
+                // since generating the certificate can take a long while
+                if (get_pki_cert_paths(store, issuer_alias, &issuer_cert_handle, &issuer_pk_handle) != 0)
                 {
                     LOG_ERROR("Could not get certificate entry for issuer %s", issuer_alias);
                     result = __FAILURE__;
                 }
                 else
                 {
-                    issuer_cert_path = STRING_c_str(issuer_cert_entry->cert_file);
-                    issuer_pk_path = STRING_c_str(issuer_cert_entry->private_key_file);
+                    issuer_cert_path = STRING_c_str(issuer_cert_handle);
+                    issuer_pk_path = STRING_c_str(issuer_pk_handle);
                     if ((issuer_pk_path == NULL) || (issuer_cert_path == NULL))
                     {
                         LOG_ERROR("Unexpected NULL file paths found for issuer %s", issuer_alias);
@@ -2450,12 +4227,17 @@ static int edge_hsm_client_store_create_pki_cert_internal
                     }
                 }
             }
+            if ((result == 0) && (generate_serial_number(&serial_number) != 0))
+            {
+                LOG_ERROR("Could not generate a serial number for alias %s", alias);
+                result = __FAILURE__;
+            }
             if (result == 0)
             {
                 // @note this will overwrite the older the certificate and private key
                 // files for the requested alias
                 result = generate_pki_cert_and_key(cert_props_handle,
-                                                   rand(), // todo check if rand is okay or if we need something stronger like a SHA1
+                                                   serial_number,
                                                    ca_path_len,
                                                    alias_pk_path,
                                                    alias_cert_path,
@@ -2484,6 +4266,14 @@ static int edge_hsm_client_store_create_pki_cert_internal
         {
             STRING_delete(alias_pk_handle);
         }
+        if (issuer_cert_handle)
+        {
+            STRING_delete(issuer_cert_handle);
+        }
+        if (issuer_pk_handle)
+        {
+            STRING_delete(issuer_pk_handle);
+        }
     }
     return result;
 }
@@ -2518,14 +4308,18 @@ static int edge_hsm_client_store_create_pki_cert
         LOG_ERROR("Invalid certificate alias value");
         result = __FAILURE__;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (!is_store_provisioned((CRYPTO_STORE*)handle))
     {
         LOG_ERROR("HSM store has not been provisioned");
         result = __FAILURE__;
     }
     else
     {
-        int load_status = load_if_cert_and_key_exist_by_alias(handle, alias, issuer_alias);
+        HSM_TRACE_SCOPE trace;
+        int load_status;
+
+        HSM_TRACE_BEGIN(&trace, "store.create_pki_cert", alias, 0);
+        load_status = load_if_cert_and_key_exist_by_alias(handle, alias, issuer_alias);
         if (load_status == LOAD_ERR_FAILED)
         {
             LOG_ERROR("Could not check and load certificate and key for alias %s", alias);
@@ -2553,6 +4347,7 @@ static int edge_hsm_client_store_create_pki_cert
         {
             result = 0;
         }
+        HSM_TRACE_END(&trace, 0, result);
     }
 
     return result;
@@ -2581,7 +4376,7 @@ static int edge_hsm_client_store_insert_pki_trusted_cert
         LOG_ERROR("Invalid certificate file name %s", cert_file_name);
         result = __FAILURE__;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (!is_store_provisioned((CRYPTO_STORE*)handle))
     {
         LOG_ERROR("HSM store has not been provisioned");
         result = __FAILURE__;
@@ -2605,14 +4400,18 @@ static CERT_INFO_HANDLE edge_hsm_client_store_get_pki_trusted_certs
         LOG_ERROR("Invalid handle value");
         result = NULL;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (!is_store_provisioned((CRYPTO_STORE*)handle))
     {
         LOG_ERROR("HSM store has not been provisioned");
         result = NULL;
     }
     else
     {
+        HSM_TRACE_SCOPE trace;
+
+        HSM_TRACE_BEGIN(&trace, "store.get_pki_trusted_certs", NULL, 0);
         result = prepare_trusted_certs_info((CRYPTO_STORE*)handle);
+        HSM_TRACE_END(&trace, 0, (result != NULL) ? 0 : __FAILURE__);
     }
     return result;
 }
@@ -2635,7 +4434,7 @@ static int edge_hsm_client_store_remove_pki_trusted_cert
         LOG_ERROR("Invalid handle alias value");
         result = __FAILURE__;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (!is_store_provisioned((CRYPTO_STORE*)handle))
     {
         LOG_ERROR("HSM store has not been provisioned");
         result = __FAILURE__;
@@ -2666,7 +4465,7 @@ static int edge_hsm_client_store_insert_encryption_key
         LOG_ERROR("Invalid handle alias value");
         result = __FAILURE__;
     }
-    else if (g_hsm_state != HSM_STATE_PROVISIONED)
+    else if (!is_store_provisioned((CRYPTO_STORE*)handle))
     {
         LOG_ERROR("HSM store has not been provisioned");
         result = __FAILURE__;
@@ -2680,6 +4479,9 @@ static int edge_hsm_client_store_insert_encryption_key
     {
         size_t key_size = 0;
         unsigned char *key = NULL;
+        HSM_TRACE_SCOPE trace;
+
+        HSM_TRACE_BEGIN(&trace, "store.insert_encryption_key", key_name, 0);
         if (generate_encryption_key(&key, &key_size) != 0)
         {
             LOG_ERROR("Could not create encryption key for %s", key_name);
@@ -2687,7 +4489,7 @@ static int edge_hsm_client_store_insert_encryption_key
         }
         else
         {
-            if (save_encryption_key_to_file(key_name, key, key_size) != 0)
+            if (save_encryption_key_to_file((CRYPTO_STORE*)handle, key_name, key, key_size) != 0)
             {
                 LOG_ERROR("Could not persist encryption key %s to file", key_name);
                 result = __FAILURE__;
@@ -2698,6 +4500,7 @@ static int edge_hsm_client_store_insert_encryption_key
             }
             free(key);
         }
+        HSM_TRACE_END(&trace, key_size, result);
     }
 
     return result;
@@ -2724,5 +4527,9 @@ static const HSM_CLIENT_STORE_INTERFACE edge_hsm_client_store_interface =
 
 const HSM_CLIENT_STORE_INTERFACE* hsm_client_store_interface(void)
 {
-    return &edge_hsm_client_store_interface;
+#if defined(HSM_FAULT_INJECTION)
+    return hsm_metrics_store_interface(hsm_fault_store_interface(&edge_hsm_client_store_interface));
+#else
+    return hsm_metrics_store_interface(&edge_hsm_client_store_interface);
+#endif
 }
@@ -16,6 +16,7 @@ int hsm_client_x509_init()
 
 void hsm_client_x509_deinit()
 {
+    log_shutdown();
 }
 
 void iothub_hsm_free_buffer(void * buffer)
@@ -1,1765 +1,2413 @@
-#include <fcntl.h>
-#include <inttypes.h>
-#include <limits.h>
-#include <stdbool.h>
-#include <stdlib.h>
-#include <stdint.h>
-#include <string.h>
-#include <sys/stat.h>
-#include <time.h>
-
-#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
-    #include <io.h>
-#else
-    #include <unistd.h>
-#endif
-
-#include <openssl/asn1.h>
-#include <openssl/bio.h>
-#include <openssl/err.h>
-#include <openssl/ec.h>
-#include <openssl/pem.h>
-#include <openssl/x509.h>
-#include <openssl/x509v3.h>
-
-#include "azure_c_shared_utility/gballoc.h"
-#include "azure_c_shared_utility/buffer_.h"
-#include "azure_c_shared_utility/hmacsha256.h"
-#include "edge_openssl_common.h"
-
-#include "hsm_key.h"
-#include "hsm_log.h"
-#include "hsm_utils.h"
-
-//#################################################################################################
-// Data type definations
-//#################################################################################################
-// all X.509 certificates created will be v3 for which the version value is 2
-#define X509_VERSION 0x2
-
-// RSA key length for CA certificates
-#define RSA_KEY_LEN_CA 4096
-// RSA key length for server and client certificates
-#define RSA_KEY_LEN_NON_CA RSA_KEY_LEN_CA >> 1
-
-#define MAX_SUBJECT_FIELD_SIZE 3
-// per RFC3280 state and locality have lengths of 128, +1 for null term
-#define MAX_SUBJECT_VALUE_SIZE 129
-
-#define DEFAULT_EC_CURVE_NAME "secp256k1"
-
-// openssl ASN1 time format defines
-#define ASN1_TIME_STRING_UTC_FORMAT 0x17
-#define ASN1_TIME_STRING_UTC_LEN 13
-
-struct SUBJECT_FIELD_OFFSET_TAG
-{
-    char field[MAX_SUBJECT_FIELD_SIZE];
-    int offset;
-};
-typedef struct SUBJECT_FIELD_OFFSET_TAG SUBJECT_FIELD_OFFSET;
-
-static const SUBJECT_FIELD_OFFSET subj_offsets[] =
-{
-    { "CN", NID_commonName },
-    { "C", NID_countryName },
-    { "L", NID_localityName },
-    { "ST", NID_stateOrProvinceName },
-    { "O", NID_organizationName },
-    { "OU", NID_organizationalUnitName }
-};
-
-struct CERT_KEY_TAG
-{
-    HSM_CLIENT_KEY_INTERFACE interface;
-    EVP_PKEY* evp_key;
-};
-typedef struct CERT_KEY_TAG CERT_KEY;
-
-//#################################################################################################
-// Forward Declarations
-//#################################################################################################
-
-static void destroy_evp_key(EVP_PKEY *evp_key);
-
-//#################################################################################################
-// Utilities
-//#################################################################################################
-#if !defined(OPEN_HELPER) && !defined(CLOSE_HELPER)
-    #if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
-        #define OPEN_HELPER(fname) _open((fname), _O_CREAT|_O_WRONLY|_O_TRUNC, _S_IREAD|_S_IWRITE)
-        #define CLOSE_HELPER(fd) _close(fd)
-    #else
-        #define OPEN_HELPER(fname) open((fname), O_CREAT|O_WRONLY|O_TRUNC, S_IRUSR|S_IWUSR)
-        #define CLOSE_HELPER(fd) close(fd)
-    #endif
-#endif
-
-#if !defined(X509V3_EXT_conf_nid_HELPER)
-    #define X509V3_EXT_conf_nid_HELPER(conf, ctx, nid, value) \
-        X509V3_EXT_conf_nid((conf), (ctx), (nid), (value))
-#endif
-
-extern time_t get_utc_time_from_asn_string(const unsigned char *time_value, size_t length);
-
-//#################################################################################################
-// PKI key operations
-//#################################################################################################
-static int cert_key_sign
-(
-    KEY_HANDLE key_handle,
-    const unsigned char* data_to_be_signed,
-    size_t data_to_be_signed_size,
-    unsigned char** digest,
-    size_t* digest_size
-)
-{
-    (void)key_handle;
-    (void)data_to_be_signed;
-    (void)data_to_be_signed_size;
-
-    LOG_ERROR("Sign for cert keys is not supported");
-    if (digest != NULL)
-    {
-        *digest = NULL;
-    }
-    if (digest_size != NULL)
-    {
-        *digest_size = 0;
-    }
-    return __FAILURE__;
-}
-
-int cert_key_derive_and_sign
-(
-    KEY_HANDLE key_handle,
-    const unsigned char* data_to_be_signed,
-    size_t data_to_be_signed_size,
-    const unsigned char* identity,
-    size_t identity_size,
-    unsigned char** digest,
-    size_t* digest_size
-)
-{
-    (void)key_handle;
-    (void)data_to_be_signed;
-    (void)data_to_be_signed_size;
-    (void)identity;
-    (void)identity_size;
-
-    LOG_ERROR("Derive and sign for cert keys is not supported");
-    if (digest != NULL)
-    {
-        *digest = NULL;
-    }
-    if (digest_size != NULL)
-    {
-        *digest_size = 0;
-    }
-    return __FAILURE__;
-}
-
-static int cert_key_encrypt
-(
-    KEY_HANDLE key_handle,
-    const SIZED_BUFFER *identity,
-    const SIZED_BUFFER *plaintext,
-    const SIZED_BUFFER *initialization_vector,
-    SIZED_BUFFER *ciphertext
-)
-{
-    (void)key_handle;
-    (void)identity;
-    (void)plaintext;
-    (void)initialization_vector;
-
-    LOG_ERROR("Cert key encrypt operation not supported");
-    ciphertext->buffer = NULL;
-    ciphertext->size = 0;
-    return __FAILURE__;
-}
-
-static int cert_key_decrypt
-(
-    KEY_HANDLE key_handle,
-    const SIZED_BUFFER *identity,
-    const SIZED_BUFFER *ciphertext,
-    const SIZED_BUFFER *initialization_vector,
-    SIZED_BUFFER *plaintext
-)
-{
-    (void)key_handle;
-    (void)identity;
-    (void)ciphertext;
-    (void)initialization_vector;
-
-    LOG_ERROR("Cert key decrypt operation not supported");
-    plaintext->buffer = NULL;
-    plaintext->size = 0;
-    return __FAILURE__;
-}
-
-static void cert_key_destroy(KEY_HANDLE key_handle)
-{
-    CERT_KEY *cert_key = (CERT_KEY*)key_handle;
-    if (cert_key != NULL)
-    {
-        destroy_evp_key(cert_key->evp_key);
-        free(cert_key);
-    }
-}
-
-//#################################################################################################
-// PKI key generation
-//#################################################################################################
-static EVP_PKEY* generate_rsa_key(CERTIFICATE_TYPE cert_type)
-{
-    int status;
-    BIGNUM *bne;
-    EVP_PKEY *pkey;
-    RSA *rsa;
-
-    size_t key_len = (cert_type == CERTIFICATE_TYPE_CA) ? RSA_KEY_LEN_CA : RSA_KEY_LEN_NON_CA;
-    LOG_INFO("Generating RSA key of length %zu", key_len);
-    if ((pkey = EVP_PKEY_new()) == NULL)
-    {
-        LOG_ERROR("Unable to create EVP_PKEY structure");
-    }
-    else if ((bne = BN_new()) == NULL)
-    {
-        LOG_ERROR("Could not allocate new big num object");
-        EVP_PKEY_free(pkey);
-        pkey = NULL;
-    }
-    else if ((status = BN_set_word(bne, RSA_F4)) != 1)
-    {
-        LOG_ERROR("Unable to set big num word");
-        BN_free(bne);
-        EVP_PKEY_free(pkey);
-        pkey = NULL;
-    }
-    else if ((rsa = RSA_new()) == NULL)
-    {
-        LOG_ERROR("Could not allocate new RSA object");
-        BN_free(bne);
-        EVP_PKEY_free(pkey);
-        pkey = NULL;
-    }
-    else if ((status = RSA_generate_key_ex(rsa, (int)key_len, bne, NULL)) != 1)
-    {
-        LOG_ERROR("Unable to generate RSA key");
-        RSA_free(rsa);
-        BN_free(bne);
-        EVP_PKEY_free(pkey);
-        pkey = NULL;
-    }
-    else if ((status = EVP_PKEY_set1_RSA(pkey, rsa)) != 1)
-    {
-        LOG_ERROR("Unable to assign RSA key.");
-        RSA_free(rsa);
-        BN_free(bne);
-        EVP_PKEY_free(pkey);
-        pkey = NULL;
-    }
-    else
-    {
-        RSA_free(rsa);
-        BN_free(bne);
-    }
-
-    return pkey;
-}
-
-static EVP_PKEY* generate_ecc_key(const char *ecc_type)
-{
-    EC_KEY* ecc_key;
-    EVP_PKEY *evp_key;
-
-    int ecc_group = OBJ_txt2nid(ecc_type);
-
-    if ((ecc_key = EC_KEY_new_by_curve_name(ecc_group)) == NULL)
-    {
-        LOG_ERROR("Failure getting curve name");
-        evp_key = NULL;
-    }
-    else
-    {
-        EC_KEY_set_asn1_flag(ecc_key, OPENSSL_EC_NAMED_CURVE);
-        if (!EC_KEY_generate_key(ecc_key))
-        {
-            LOG_ERROR("Error generating ECC key");
-            evp_key = NULL;
-        }
-        else if ((evp_key = EVP_PKEY_new()) == NULL)
-        {
-            LOG_ERROR("Unable to create EVP_PKEY structure");
-        }
-        else if (!EVP_PKEY_set1_EC_KEY(evp_key, ecc_key))
-        {
-            LOG_ERROR("Error assigning ECC key to EVP_PKEY structure");
-            EVP_PKEY_free(evp_key);
-            evp_key = NULL;
-        }
-        EC_KEY_free(ecc_key);
-    }
-
-    return evp_key;
-}
-
-static EVP_PKEY* generate_evp_key
-(
-    CERTIFICATE_TYPE cert_type,
-    X509* issuer_cert,
-    const PKI_KEY_PROPS *key_props
-)
-{
-    EVP_PKEY *evp_key;
-
-    if (issuer_cert == NULL)
-    {
-        if ((key_props != NULL) && (key_props->key_type == HSM_PKI_KEY_EC))
-        {
-            const char *curve = (key_props->ec_curve_name != NULL) ? key_props->ec_curve_name :
-                                                                     DEFAULT_EC_CURVE_NAME;
-            evp_key = generate_ecc_key(curve);
-        }
-        else
-        {
-            // by default use RSA keys if no issuer cert or key properties was provided
-            evp_key = generate_rsa_key(cert_type);
-        }
-    }
-    else
-    {
-        EVP_PKEY *evp_pub_key = NULL;
-        // read the public key from the issuer certificate and determine the type
-        // of key used and then generate the appropriate type of key
-        if ((evp_pub_key = X509_get_pubkey(issuer_cert)) == NULL)
-        {
-            LOG_ERROR("Error getting public key from issuer certificate");
-            evp_key = NULL;
-        }
-        else
-        {
-            int key_type = EVP_PKEY_base_id(evp_pub_key);
-            switch (key_type)
-            {
-                case EVP_PKEY_RSA:
-                {
-                    evp_key = generate_rsa_key(cert_type);
-                }
-                break;
-
-                case EVP_PKEY_EC:
-                {
-                    EC_KEY *ecc_key = EVP_PKEY_get1_EC_KEY(evp_pub_key);
-                    const EC_GROUP* ecgrp = EC_KEY_get0_group(ecc_key);
-                    const char *curve_name = OBJ_nid2sn(EC_GROUP_get_curve_name(ecgrp));
-                    LOG_INFO("Generating ECC Key size: %d bits. ECC Key type: %s",
-                             EVP_PKEY_bits(evp_pub_key), curve_name);
-                    evp_key = generate_ecc_key(curve_name);
-                    EC_KEY_free(ecc_key);
-                }
-                break;
-
-                default:
-                    LOG_ERROR("Unsupported key type %d", key_type);
-                    evp_key = NULL;
-            };
-            EVP_PKEY_free(evp_pub_key);
-        }
-    }
-
-    return evp_key;
-}
-
-static void destroy_evp_key(EVP_PKEY *evp_key)
-{
-    if (evp_key != NULL)
-    {
-        EVP_PKEY_free(evp_key);
-    }
-}
-
-//#################################################################################################
-// PKI file IO
-//#################################################################################################
-static X509* load_certificate_file(const char* cert_file_name)
-{
-    X509* x509_cert;
-    BIO* cert_file = BIO_new_file(cert_file_name, "r");
-    if (cert_file == NULL)
-    {
-        LOG_ERROR("Failure to open certificate file %s", cert_file_name);
-        x509_cert = NULL;
-    }
-    else
-    {
-        x509_cert = PEM_read_bio_X509(cert_file, NULL, NULL, NULL);
-        if (x509_cert == NULL)
-        {
-            LOG_ERROR("Failure PEM_read_bio_X509 for cert %s", cert_file_name);
-        }
-        BIO_free_all(cert_file);
-    }
-
-    return x509_cert;
-}
-
-static int bio_chain_cert_helper(BIO *cert_file, const char *issuer_cert_file_name)
-{
-    int result;
-    size_t issuer_buf_size = 0;
-
-    void *issuer_cert = read_file_into_buffer(issuer_cert_file_name, &issuer_buf_size);
-    if (issuer_cert == NULL)
-    {
-        LOG_ERROR("Could not read issuer certificate file %s", issuer_cert_file_name);
-        result = __FAILURE__;
-    }
-    else
-    {
-        if (issuer_buf_size == 0)
-        {
-            LOG_ERROR("Read zero bytes from issuer certificate file %s", issuer_cert_file_name);
-            result = __FAILURE__;
-        }
-        else if (issuer_buf_size > INT_MAX)
-        {
-            LOG_ERROR("Issuer certificate file too large %s", issuer_cert_file_name);
-            result = __FAILURE__;
-        }
-        else
-        {
-            int len = BIO_write(cert_file, issuer_cert, (int)issuer_buf_size);
-            if (len != (int)issuer_buf_size)
-            {
-                LOG_ERROR("BIO_write returned %d expected %zu", len, issuer_buf_size);
-                result = __FAILURE__;
-            }
-            else
-            {
-                result = 0;
-            }
-        }
-        free(issuer_cert);
-    }
-
-    return result;
-}
-
-static int write_certificate_file
-(
-    X509 *x509_cert,
-    const char *cert_file_name,
-    const char *issuer_certificate_file
-)
-{
-    int result;
-
-#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
-    BIO* cert_file = BIO_new_file(cert_file_name, "w");
-    if (cert_file == NULL)
-    {
-        LOG_ERROR("Failure opening cert file for writing for %s", cert_file_name);
-        result = __FAILURE__;
-    }
-    else
-    {
-        if (!PEM_write_bio_X509(cert_file, x509_cert))
-        {
-            LOG_ERROR("Unable to write certificate to file %s", cert_file_name);
-            result = __FAILURE__;
-        }
-        else if ((issuer_certificate_file != NULL) &&
-                 (bio_chain_cert_helper(cert_file, issuer_certificate_file) != 0))
-        {
-            result = __FAILURE__;
-        }
-        else
-        {
-            result = 0;
-        }
-        BIO_free_all(cert_file);
-    }
-#else
-    int fd = OPEN_HELPER(cert_file_name);
-    if (fd == -1)
-    {
-        LOG_ERROR("Failure opening cert file for writing for %s", cert_file_name);
-        result = __FAILURE__;
-    }
-    else
-    {
-        BIO *cert_file;
-        if ((cert_file = BIO_new_fd(fd, 0)) == NULL)
-        {
-            LOG_ERROR("Failure creating new BIO handle for %s", cert_file_name);
-            result = __FAILURE__;
-        }
-        else
-        {
-            if (!PEM_write_bio_X509(cert_file, x509_cert))
-            {
-                LOG_ERROR("Unable to write certificate to file %s", cert_file_name);
-                result = __FAILURE__;
-            }
-            else if ((issuer_certificate_file != NULL) &&
-                     (bio_chain_cert_helper(cert_file, issuer_certificate_file) != 0))
-            {
-                result = __FAILURE__;
-            }
-            else
-            {
-                result = 0;
-            }
-            BIO_free_all(cert_file);
-        }
-        (void)CLOSE_HELPER(fd);
-    }
-#endif
-
-    return result;
-}
-
-static EVP_PKEY* load_private_key_file(const char* key_file_name)
-{
-    EVP_PKEY* evp_key;
-    BIO* key_file = BIO_new_file(key_file_name, "r");
-    if (key_file == NULL)
-    {
-        LOG_ERROR("Failure to open key file %s", key_file_name);
-        evp_key = NULL;
-    }
-    else
-    {
-        evp_key = PEM_read_bio_PrivateKey(key_file, NULL, NULL, NULL);
-        if (evp_key == NULL)
-        {
-            LOG_ERROR("Failure PEM_read_bio_PrivateKey for %s", key_file_name);
-        }
-        BIO_free_all(key_file);
-    }
-
-    return evp_key;
-}
-
-static int write_private_key_file(EVP_PKEY* evp_key, const char* key_file_name)
-{
-    int result;
-
-#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
-    BIO* key_file = BIO_new_file(key_file_name, "w");
-    if (key_file == NULL)
-    {
-        LOG_ERROR("Failure opening key file for writing for %s", key_file_name);
-        result = __FAILURE__;
-    }
-    else
-    {
-        if (!PEM_write_bio_PrivateKey(key_file, evp_key, NULL, NULL, 0, NULL, NULL))
-        {
-            LOG_ERROR("Unable to write private key to file %s", key_file_name);
-            result = __FAILURE__;
-        }
-        else
-        {
-            result = 0;
-        }
-        BIO_free_all(key_file);
-    }
-#else
-    int fd = OPEN_HELPER(key_file_name);
-    if (fd == -1)
-    {
-        LOG_ERROR("Failure opening key file for writing for %s. Errno %d, %s",
-                  key_file_name, errno, strerror(errno));
-        result = __FAILURE__;
-    }
-    else
-    {
-        BIO *key_file;
-        if ((key_file = BIO_new_fd(fd, 0)) == NULL)
-        {
-            LOG_ERROR("Failure creating new BIO handle for %s", key_file_name);
-            result = __FAILURE__;
-        }
-        else if (!PEM_write_bio_PrivateKey(key_file, evp_key, NULL, NULL, 0, NULL, NULL))
-        {
-            LOG_ERROR("Unable to write private key to file %s", key_file_name);
-            result = __FAILURE__;
-        }
-        else
-        {
-            result = 0;
-        }
-        BIO_free_all(key_file);
-        (void)CLOSE_HELPER(fd);
-    }
-#endif
-
-    return result;
-}
-
-//#################################################################################################
-// PKI certificate generation
-//#################################################################################################
-static int cert_set_core_properties
-(
-    X509* x509_cert,
-    KEY_HANDLE key,
-    CERT_PROPS_HANDLE cert_props_handle,
-    int serial_num
-)
-{
-    (void)cert_props_handle;
-    int result;
-
-    if (!X509_set_version(x509_cert, X509_VERSION))
-    {
-        LOG_ERROR("Failure setting the certificate version");
-        result = __FAILURE__;
-    }
-    else if (!ASN1_INTEGER_set(X509_get_serialNumber(x509_cert), serial_num))
-    {
-        LOG_ERROR("Failure setting serial number");
-        result = __FAILURE__;
-    }
-    else if (!X509_set_pubkey(x509_cert, key))
-    {
-        LOG_ERROR("Failure setting public key");
-        result = __FAILURE__;
-    }
-    else
-    {
-        LOG_DEBUG("Core certificate properties set");
-        result = 0;
-    }
-    return result;
-}
-
-static int validate_subject_keyid(X509 *x509_cert)
-{
-    int result;
-
-    if (X509_get_ext_by_NID(x509_cert, NID_subject_key_identifier, -1) == -1)
-    {
-        LOG_ERROR("X.509 V3 extension NID_subject_key_identifier does not exist");
-        result = __FAILURE__;
-    }
-    else
-    {
-        result = 0;
-    }
-
-    return result;
-}
-
-static int validate_certificate_expiration
-(
-    X509* x509_cert,
-    double *exp_seconds_left,
-    bool *is_expired
-)
-{
-    int result;
-    time_t exp_time;
-    double seconds_left = 0;
-
-    *is_expired = true;
-    time_t now = time(NULL);
-    ASN1_TIME *exp_asn1 = X509_get_notAfter(x509_cert);
-    if ((exp_asn1->type != ASN1_TIME_STRING_UTC_FORMAT) &&
-        (exp_asn1->length != ASN1_TIME_STRING_UTC_LEN))
-    {
-        LOG_ERROR("Unsupported time format in certificate");
-        result = __FAILURE__;
-    }
-    else if ((exp_time = get_utc_time_from_asn_string(exp_asn1->data, exp_asn1->length)) == 0)
-    {
-        LOG_ERROR("Could not parse expiration date from certificate");
-        result = __FAILURE__;
-    }
-    else
-    {
-        if ((seconds_left = difftime(exp_time, now)) <= 0)
-        {
-            LOG_ERROR("Certificate has expired");
-        }
-        else
-        {
-            *is_expired = false;
-        }
-        result = 0;
-    }
-
-    *exp_seconds_left = seconds_left;
-    return result;
-}
-
-static int cert_set_expiration
-(
-    X509* x509_cert,
-    uint64_t requested_validity,
-    X509* issuer_cert
-)
-{
-    int result;
-
-    if (!X509_gmtime_adj(X509_get_notBefore(x509_cert), 0))
-    {
-        LOG_ERROR("Failure setting not before time");
-        result = __FAILURE__;
-    }
-    else
-    {
-        // compute the MIN of seconds between:
-        //    - UTC now() and the issuer certificate expiration timestamp and
-        //    - Requested certificate expiration time expressed in UTC seconds from now()
-        if (issuer_cert != NULL)
-        {
-            // determine max validity in seconds of issuer
-            double exp_seconds_left_from_now = 0;
-            bool is_expired = true;
-            int status = validate_certificate_expiration(issuer_cert,
-                                                         &exp_seconds_left_from_now,
-                                                         &is_expired);
-            if ((status != 0) || (is_expired))
-            {
-                LOG_ERROR("Issuer certificate expiration failure. Status %d, verify status: %d",
-                          status, is_expired);
-                result = __FAILURE__;
-            }
-            else
-            {
-                uint64_t number_seconds_left = (uint64_t)exp_seconds_left_from_now;
-                LOG_DEBUG("Issuer expiration seconds left: %" PRIu64 ", Request validity:%" PRIu64,
-                          number_seconds_left, requested_validity);
-                requested_validity = (requested_validity == 0) ?
-                                        number_seconds_left :
-                                        ((requested_validity < number_seconds_left) ?
-                                            requested_validity :
-                                            number_seconds_left);
-                result = 0;
-            }
-        }
-        else
-        {
-            result = 0;
-        }
-
-        if (result == 0)
-        {
-            if (requested_validity == 0)
-            {
-                LOG_ERROR("Invalid expiration time in seconds %" PRIu64, requested_validity);
-                result = __FAILURE__;
-            }
-            else if (!X509_gmtime_adj(X509_get_notAfter(x509_cert), (long)requested_validity))
-            {
-                LOG_ERROR("Failure setting not after time %" PRIu64, requested_validity);
-                result = __FAILURE__;
-            }
-        }
-    }
-
-    return result;
-}
-
-static int set_basic_constraints(X509 *x509_cert, CERTIFICATE_TYPE cert_type, int ca_path_len)
-{
-    int result;
-    BASIC_CONSTRAINTS *bc;
-
-    if ((bc = BASIC_CONSTRAINTS_new()) == NULL)
-    {
-        LOG_ERROR("Could not allocate basic constraint");
-        result = __FAILURE__;
-    }
-    else
-    {
-        bool is_pathlen_failure;
-        int is_critical = 0;
-        bc->ca = 0;
-        if (cert_type == CERTIFICATE_TYPE_CA)
-        {
-            is_critical = 1;
-            bc->ca = 1;
-            bc->pathlen = ASN1_INTEGER_new();
-            if (bc->pathlen == NULL)
-            {
-                LOG_ERROR("Could not path length integer");
-                is_pathlen_failure = true;
-            }
-            else if (ASN1_INTEGER_set(bc->pathlen, ca_path_len) != 1)
-            {
-                LOG_ERROR("Setting path len failed");
-                is_pathlen_failure = true;
-            }
-            else
-            {
-                is_pathlen_failure = false;
-            }
-        }
-        else
-        {
-            is_pathlen_failure = false;
-        }
-
-
-        if (is_pathlen_failure)
-        {
-            result = __FAILURE__;
-        }
-        else if (X509_add1_ext_i2d(x509_cert, NID_basic_constraints,
-                                   bc, is_critical, X509V3_ADD_DEFAULT) != 1)
-        {
-            LOG_ERROR("Could not add basic constraint extension to certificate");
-            result = __FAILURE__;
-        }
-        else
-        {
-            result = 0;
-        }
-        BASIC_CONSTRAINTS_free(bc);
-    }
-
-    return result;
-}
-
-static int add_ext
-(
-    X509 *x509_cert,
-    X509V3_CTX *ctx,
-    int nid,
-    const char *value,
-    const char* nid_diagnostic
-)
-{
-    int result;
-    X509_EXTENSION *ex;
-
-    // openssl API requires a non const value be passed in
-    if ((ex = X509V3_EXT_conf_nid_HELPER(NULL, ctx, nid, (char*)value)) == NULL)
-    {
-        LOG_ERROR("Could not obtain V3 extension by NID %#x, %s", nid, nid_diagnostic);
-        result = __FAILURE__;
-    }
-    else
-    {
-        if (X509_add_ext(x509_cert, ex, -1) == 0)
-        {
-            LOG_ERROR("Could not add V3 extension by NID %#x, %s. Value %s",
-                      nid, nid_diagnostic, value);
-            result = __FAILURE__;
-        }
-        else
-        {
-            result = 0;
-        }
-        X509_EXTENSION_free(ex);
-    }
-
-    return result;
-}
-
-static int set_key_usage
-(
-    X509 *x509_cert,
-    CERTIFICATE_TYPE cert_type
-)
-{
-    int result;
-    char *usage, *ext_usage;
-
-    if (cert_type == CERTIFICATE_TYPE_CA)
-    {
-        usage = "critical, digitalSignature, keyCertSign";
-        ext_usage = NULL;
-    }
-    else if (cert_type == CERTIFICATE_TYPE_CLIENT)
-    {
-        usage = "critical, nonRepudiation, digitalSignature, keyEncipherment, dataEncipherment";
-        ext_usage = "clientAuth";
-    }
-    else
-    {
-        usage = "critical, nonRepudiation, digitalSignature, keyEncipherment, dataEncipherment, "
-                "keyAgreement";
-        ext_usage = "serverAuth";
-    }
-
-    if (add_ext(x509_cert, NULL, NID_key_usage, usage, "NID_key_usage") != 0)
-    {
-        result = __FAILURE__;
-    }
-    else
-    {
-        if ((ext_usage != NULL) &&
-            (add_ext(x509_cert, NULL, NID_ext_key_usage, ext_usage, "NID_ext_key_usage") != 0))
-        {
-            result = __FAILURE__;
-        }
-        else
-        {
-            result = 0;
-        }
-    }
-
-    return result;
-}
-
-static int set_key_identifier_extension
-(
-    X509 *x509_cert,
-    X509 *issuer_cert,
-    int nid,
-    const char *nid_diagnostic,
-    char *value
-)
-{
-    int result;
-    X509V3_CTX ctx;
-    X509V3_set_ctx(&ctx, issuer_cert, x509_cert, NULL, NULL, 0);
-
-    if (add_ext(x509_cert, &ctx, nid, value, nid_diagnostic) != 0)
-    {
-        result = __FAILURE__;
-    }
-    else
-    {
-        result = 0;
-    }
-
-    return result;
-}
-
-static int cert_set_key_id_extensions
-(
-    X509 *x509_cert,
-    X509 *issuer_cert
-)
-{
-    int result;
-
-    if (set_key_identifier_extension(x509_cert, NULL, NID_subject_key_identifier,
-                                     "NID_subject_key_identifier", "hash") != 0)
-    {
-        result = __FAILURE__;
-    }
-    else
-    {
-        char *auth_value = "issuer:always,keyid:always";
-        issuer_cert = (issuer_cert != NULL) ? issuer_cert : x509_cert;
-        if (set_key_identifier_extension(x509_cert, issuer_cert, NID_authority_key_identifier,
-                                         "NID_authority_key_identifier", auth_value) != 0)
-        {
-            result = __FAILURE__;
-        }
-        else
-        {
-            result = 0;
-        }
-    }
-
-    return result;
-}
-
-static int set_san
-(
-    X509 *x509_cert,
-    CERT_PROPS_HANDLE cert_props_handle
-)
-{
-    size_t num_entries = 0, idx;
-    bool fail_flag = false;
-    const char * const* sans = get_san_entries(cert_props_handle, &num_entries);
-
-    if (sans != NULL)
-    {
-        for (idx = 0; idx < num_entries; idx++)
-        {
-            if ((sans[idx] != NULL) &&
-                (add_ext(x509_cert, NULL, NID_subject_alt_name,
-                         sans[idx], "NID_subject_alt_name") != 0))
-            {
-                fail_flag = true;
-                break;
-            }
-        }
-    }
-
-    return (fail_flag) ? __FAILURE__ : 0;
-}
-
-static int cert_set_extensions
-(
-    X509 *x509_cert,
-    CERTIFICATE_TYPE cert_type,
-    X509* issuer_cert,
-    int ca_path_len,
-    CERT_PROPS_HANDLE cert_props_handle
-)
-{
-    (void)issuer_cert;
-    int result;
-
-    if ((set_basic_constraints(x509_cert, cert_type, ca_path_len) != 0) ||
-        (set_key_usage(x509_cert, cert_type) != 0) ||
-        (set_san(x509_cert, cert_props_handle) != 0))
-    {
-        LOG_ERROR("Failure setting certificate extensions");
-        result = __FAILURE__;
-    }
-    else
-    {
-        result = 0;
-    }
-
-    return result;
-}
-
-static int cert_set_subject_field
-(
-    X509_NAME* name,
-    X509_NAME* issuer_name,
-    const char* field,
-    const char* value
-)
-{
-    static char issuer_name_field[MAX_SUBJECT_VALUE_SIZE];
-    const char* value_to_set = NULL;
-    int result = 0;
-
-    if (value != NULL)
-    {
-        value_to_set = value;
-    }
-    else
-    {
-        if (issuer_name != NULL)
-        {
-            size_t index, found = 0;
-            for (index = 0; index < sizeof(subj_offsets)/sizeof(subj_offsets[0]); index++)
-            {
-                if (strcmp(field, subj_offsets[index].field) == 0)
-                {
-                    found = 1;
-                    break;
-                }
-            }
-            if (found == 1)
-            {
-                int status;
-                memset(issuer_name_field, 0 , sizeof(issuer_name_field));
-                status = X509_NAME_get_text_by_NID(issuer_name,
-                                                   subj_offsets[index].offset,
-                                                   issuer_name_field,
-                                                   sizeof(issuer_name_field));
-                if (status == -1)
-                {
-                    LOG_DEBUG("Failure X509_NAME_get_text_by_NID for field: %s", field);
-                }
-                else
-                {
-                    value_to_set = issuer_name_field;
-                    LOG_DEBUG("From issuer cert for field: %s got value: %s", field, value_to_set);
-                }
-            }
-        }
-    }
-
-    if (value_to_set != NULL)
-    {
-        if (X509_NAME_add_entry_by_txt(name, field, MBSTRING_ASC,
-                                       (unsigned char *)value_to_set, -1, -1, 0) != 1)
-        {
-            LOG_ERROR("Failure X509_NAME_add_entry_by_txt for field: %s using value: %s",
-                      field, value_to_set);
-            result = __FAILURE__;
-        }
-    }
-
-    return result;
-}
-
-static int cert_set_subject_fields_and_issuer
-(
-    X509* x509_cert,
-    const char *common_name,
-    X509* issuer_certificate,
-    CERT_PROPS_HANDLE cert_props_handle
-)
-{
-    int result;
-    /*const*/ X509_NAME* issuer_subj_name = NULL;
-    if ((issuer_certificate != NULL) &&
-        ((issuer_subj_name = X509_get_subject_name(issuer_certificate)) == NULL))
-    {
-        LOG_ERROR("Failure obtaining issuer subject name");
-        result = __FAILURE__;
-    }
-    else
-    {
-        X509_NAME* name = X509_get_subject_name(x509_cert);
-        if (name == NULL)
-        {
-            LOG_ERROR("Failure get subject name");
-            result = __FAILURE__;
-        }
-        else
-        {
-            const char *value;
-            result = 0;
-            value = get_country_name(cert_props_handle);
-            result = cert_set_subject_field(name, issuer_subj_name, "C", value);
-            if (result == 0)
-            {
-                value = get_state_name(cert_props_handle);
-                result = cert_set_subject_field(name, issuer_subj_name, "ST", value);
-            }
-            if (result == 0)
-            {
-                value = get_locality(cert_props_handle);
-                result = cert_set_subject_field(name, issuer_subj_name, "L", value);
-            }
-            if (result == 0)
-            {
-                value = get_organization_name(cert_props_handle);
-                result = cert_set_subject_field(name, issuer_subj_name, "O", value);
-            }
-            if (result == 0)
-            {
-                value = get_organization_unit(cert_props_handle);
-                result = cert_set_subject_field(name, issuer_subj_name, "OU", value);
-            }
-            if (result == 0)
-            {
-                //always use value provided in cert_props_handle
-                result = cert_set_subject_field(name, NULL, "CN", common_name);
-            }
-            if (result == 0)
-            {
-                LOG_DEBUG("Certificate subject fields set");
-                issuer_subj_name = (issuer_subj_name == NULL) ? name : issuer_subj_name;
-                if (!X509_set_issuer_name(x509_cert, issuer_subj_name))
-                {
-                    LOG_ERROR("Failure setting issuer name");
-                    result = __FAILURE__;
-                }
-                else
-                {
-                    LOG_DEBUG("Certificate issuer set successfully");
-                }
-            }
-        }
-    }
-    return result;
-}
-
-static int generate_cert_key
-(
-    CERTIFICATE_TYPE cert_type,
-    X509* issuer_certificate,
-    const char *key_file_name,
-    EVP_PKEY **result_evp_key,
-    const PKI_KEY_PROPS *key_props
-)
-{
-    int result;
-    EVP_PKEY* evp_key;
-    *result_evp_key = NULL;
-
-    if ((evp_key = generate_evp_key(cert_type, issuer_certificate, key_props)) == NULL)
-    {
-        LOG_ERROR("Error generating EVP key in %s", key_file_name);
-        result = __FAILURE__;
-    }
-    else if (write_private_key_file(evp_key, key_file_name) != 0)
-    {
-        LOG_ERROR("Error writing private key to file %s", key_file_name);
-        result = __FAILURE__;
-        destroy_evp_key(evp_key);
-    }
-    else
-    {
-        LOG_DEBUG("Generated private key at file %s", key_file_name);
-        result = 0;
-        *result_evp_key = evp_key;
-    }
-
-    return result;
-}
-
-static int generate_evp_certificate
-(
-    EVP_PKEY* evp_key,
-    CERTIFICATE_TYPE cert_type,
-    const char *common_name,
-    uint64_t requested_validity,
-    EVP_PKEY* issuer_evp_key,
-    X509* issuer_certificate,
-    const char *issuer_certificate_file,
-    CERT_PROPS_HANDLE cert_props_handle,
-    int serial_num,
-    int ca_path_len,
-    const char *cert_file_name,
-    X509** result_cert
-)
-{
-    int result;
-    X509* x509_cert;
-    *result_cert = NULL;
-    if ((x509_cert = X509_new()) == NULL)
-    {
-        LOG_ERROR("Failure creating the x509 cert");
-        result = __FAILURE__;
-    }
-    else
-    {
-        result = 0;
-        if (cert_set_core_properties(x509_cert, evp_key, cert_props_handle, serial_num) != 0)
-        {
-            LOG_ERROR("Failure setting core certificate properties");
-            result = __FAILURE__;
-        }
-        else if (cert_set_expiration(x509_cert, requested_validity, issuer_certificate) != 0)
-        {
-            LOG_ERROR("Failure setting certificate validity period");
-            result = __FAILURE__;
-        }
-        else if (cert_set_extensions(x509_cert,
-                                     cert_type,
-                                     issuer_certificate,
-                                     ca_path_len,
-                                     cert_props_handle) != 0)
-        {
-            LOG_ERROR("Failure setting certificate extensions");
-            result = __FAILURE__;
-        }
-        else if (cert_set_subject_fields_and_issuer(x509_cert,
-                                                    common_name,
-                                                    issuer_certificate,
-                                                    cert_props_handle) != 0)
-        {
-            LOG_ERROR("Failure setting certificate subject fields");
-            result = __FAILURE__;
-        }
-        else if (cert_set_key_id_extensions(x509_cert, issuer_certificate) != 0)
-        {
-            LOG_ERROR("Failure setting certificate subject auth key id extensions");
-            result = __FAILURE__;
-        }
-        else
-        {
-            issuer_evp_key = (issuer_evp_key == NULL) ? evp_key : issuer_evp_key;
-            if (!X509_sign(x509_cert, issuer_evp_key, EVP_sha256()))
-            {
-                LOG_ERROR("Failure signing x509");
-                result = __FAILURE__;
-            }
-            else if (write_certificate_file(x509_cert, cert_file_name,
-                                            issuer_certificate_file) != 0)
-            {
-                LOG_ERROR("Failure saving x509 certificate");
-                result = __FAILURE__;
-            }
-            else
-            {
-                *result_cert = x509_cert;
-            }
-        }
-        if (result != 0)
-        {
-            X509_free(x509_cert);
-        }
-    }
-
-    return result;
-}
-
-static int generate_pki_cert_and_key_helper
-(
-    CERT_PROPS_HANDLE cert_props_handle,
-    int serial_number,
-    int ca_path_len,
-    const char* key_file_name,
-    const char* cert_file_name,
-    const char* issuer_key_file,
-    const char* issuer_certificate_file,
-    const PKI_KEY_PROPS *key_props
-)
-{
-    int result;
-    uint64_t requested_validity;
-    const char* common_name_prop_value;
-    X509* issuer_certificate = NULL;
-    EVP_PKEY* issuer_evp_key = NULL;
-
-    initialize_openssl();
-    if (cert_props_handle == NULL)
-    {
-        LOG_ERROR("Failure saving x509 certificate");
-        result = __FAILURE__;
-    }
-    else if (key_file_name == NULL)
-    {
-        LOG_ERROR("Invalid key file path");
-        result = __FAILURE__;
-    }
-    else if (cert_file_name == NULL)
-    {
-        LOG_ERROR("Invalid key file path");
-        result = __FAILURE__;
-    }
-    else if (((issuer_certificate_file == NULL) && (issuer_key_file != NULL)) ||
-             ((issuer_certificate_file != NULL) && (issuer_key_file == NULL)))
-    {
-        LOG_ERROR("Invalid issuer certificate and key file provided");
-        result = __FAILURE__;
-    }
-    else if (ca_path_len < 0)
-    {
-        LOG_ERROR("Invalid CA path len %d", ca_path_len);
-        result = __FAILURE__;
-    }
-    else if ((requested_validity = get_validity_seconds(cert_props_handle)) == 0)
-    {
-        LOG_ERROR("Validity in seconds cannot be 0");
-        result = __FAILURE__;
-    }
-    else if (requested_validity > LONG_MAX)
-    {
-        LOG_ERROR("Number of seconds too large %" PRIu64, requested_validity);
-        result = __FAILURE__;
-    }
-    else if ((common_name_prop_value = get_common_name(cert_props_handle)) == NULL)
-    {
-        LOG_ERROR("Common name value cannot be NULL");
-        result = __FAILURE__;
-    }
-    else if (strlen(common_name_prop_value) == 0)
-    {
-        LOG_ERROR("Common name value cannot be empty");
-        result = __FAILURE__;
-    }
-    else
-    {
-        CERTIFICATE_TYPE cert_type = get_certificate_type(cert_props_handle);
-        if ((cert_type != CERTIFICATE_TYPE_CLIENT) &&
-            (cert_type != CERTIFICATE_TYPE_SERVER) &&
-            (cert_type != CERTIFICATE_TYPE_CA))
-        {
-            LOG_ERROR("Error invalid certificate type %d", cert_type);
-            result = __FAILURE__;
-        }
-        else if ((cert_type != CERTIFICATE_TYPE_CA) && (ca_path_len != 0))
-        {
-            LOG_ERROR("Invalid path len argument provided for a non CA certificate request");
-            result = __FAILURE__;
-        }
-        else
-        {
-            bool perform_cert_gen;
-            if (issuer_certificate_file)
-            {
-                if ((issuer_certificate = load_certificate_file(issuer_certificate_file)) == NULL)
-                {
-                    LOG_ERROR("Could not load issuer certificate file");
-                    perform_cert_gen = false;
-                }
-                else if ((issuer_evp_key = load_private_key_file(issuer_key_file)) == NULL)
-                {
-                    LOG_ERROR("Could not load issuer private key file");
-                    perform_cert_gen = false;
-                }
-                else
-                {
-                    perform_cert_gen = true;
-                }
-            }
-            else
-            {
-                perform_cert_gen = true;
-            }
-
-            if (!perform_cert_gen)
-            {
-                result = __FAILURE__;
-            }
-            else
-            {
-                X509* x509_cert = NULL;
-                EVP_PKEY* evp_key = NULL;
-                if (generate_cert_key(cert_type, issuer_certificate,
-                                      key_file_name, &evp_key, key_props) != 0)
-                {
-                    LOG_ERROR("Could not generate private key for certificate create request");
-                    result = __FAILURE__;
-                }
-                else if (generate_evp_certificate(evp_key, cert_type, common_name_prop_value,
-                                                  requested_validity, issuer_evp_key,
-                                                  issuer_certificate, issuer_certificate_file,
-                                                  cert_props_handle, serial_number, ca_path_len,
-                                                  cert_file_name, &x509_cert) != 0)
-                {
-                    LOG_ERROR("Could not generate certificate create request");
-                    result = __FAILURE__;
-                }
-                else
-                {
-                    result = 0;
-                }
-
-                if (x509_cert != NULL)
-                {
-                    X509_free(x509_cert);
-                }
-                if (evp_key != NULL)
-                {
-                    destroy_evp_key(evp_key);
-                }
-            }
-        }
-    }
-
-    if (issuer_certificate != NULL)
-    {
-        X509_free(issuer_certificate);
-    }
-    if (issuer_evp_key != NULL)
-    {
-        destroy_evp_key(issuer_evp_key);
-    }
-
-    return result;
-}
-
-int generate_pki_cert_and_key_with_props
-(
-    CERT_PROPS_HANDLE cert_props_handle,
-    int serial_number,
-    int ca_path_len,
-    const char* key_file_name,
-    const char* cert_file_name,
-    const PKI_KEY_PROPS *key_props
-)
-{
-    int result;
-
-    if ((key_props == NULL) ||
-        ((key_props->key_type != HSM_PKI_KEY_EC) &&
-         (key_props->key_type != HSM_PKI_KEY_RSA)))
-    {
-        LOG_ERROR("Invalid PKI key properties");
-        result = __FAILURE__;
-    }
-    else
-    {
-        result = generate_pki_cert_and_key_helper(cert_props_handle,
-                                                  serial_number,
-                                                  ca_path_len,
-                                                  key_file_name,
-                                                  cert_file_name,
-                                                  NULL,
-                                                  NULL,
-                                                  key_props);
-    }
-
-    return result;
-}
-
-int generate_pki_cert_and_key
-(
-    CERT_PROPS_HANDLE cert_props_handle,
-    int serial_number,
-    int ca_path_len,
-    const char* key_file_name,
-    const char* cert_file_name,
-    const char* issuer_key_file,
-    const char* issuer_certificate_file
-)
-{
-    return generate_pki_cert_and_key_helper(cert_props_handle,
-                                            serial_number,
-                                            ca_path_len,
-                                            key_file_name,
-                                            cert_file_name,
-                                            issuer_key_file,
-                                            issuer_certificate_file,
-                                            NULL);
-}
-
-KEY_HANDLE create_cert_key(const char* key_file_name)
-{
-    KEY_HANDLE result;
-    EVP_PKEY* evp_key;
-    CERT_KEY *cert_key;
-
-    if (key_file_name == NULL)
-    {
-        LOG_ERROR("Key file name cannot be NULL");
-        result = NULL;
-    }
-    else if ((evp_key = load_private_key_file(key_file_name)) == NULL)
-    {
-        LOG_ERROR("Could not load private key file %s", key_file_name);
-        result = NULL;
-    }
-    else if ((cert_key = (CERT_KEY*)malloc(sizeof(CERT_KEY))) == NULL)
-    {
-        LOG_ERROR("Could not allocate memory for SAS_KEY");
-        destroy_evp_key(evp_key);
-        result = NULL;
-    }
-    else
-    {
-        cert_key->interface.hsm_client_key_sign = cert_key_sign;
-        cert_key->interface.hsm_client_key_derive_and_sign = cert_key_derive_and_sign;
-        cert_key->interface.hsm_client_key_encrypt = cert_key_encrypt;
-        cert_key->interface.hsm_client_key_decrypt = cert_key_decrypt;
-        cert_key->interface.hsm_client_key_destroy = cert_key_destroy;
-        cert_key->evp_key = evp_key;
-        result = (KEY_HANDLE)cert_key;
-    }
-    return result;
-}
-
-static int validate_cert_chain
-(
-    const char *cert_file,
-    const char *issuer_cert_file,
-    bool *verify_status
-)
-{
-    int result;
-    char *cert_data = NULL;
-    char *issuer_data = NULL;
-
-    *verify_status = false;
-    if ((cert_data = read_file_into_cstring(cert_file, NULL)) == NULL)
-    {
-        LOG_ERROR("Could not read certificate %s", cert_file);
-        result = __FAILURE__;
-    }
-    else if ((issuer_data = read_file_into_cstring(issuer_cert_file, NULL)) == NULL)
-    {
-        LOG_ERROR("Could not read issuer certificate %s", issuer_cert_file);
-        result = __FAILURE__;
-    }
-    else
-    {
-        if (strstr(cert_data, issuer_data) == NULL)
-        {
-            LOG_ERROR("Did not find issuer certificate in certificate %s", cert_file);
-        }
-        else
-        {
-            *verify_status = true;
-        }
-        result = 0;
-    }
-
-    if (cert_data != NULL)
-    {
-        free(cert_data);
-    }
-
-    if (issuer_data != NULL)
-    {
-        free(issuer_data);
-    }
-
-    return result;
-}
-
-static int check_certificates
-(
-    X509_STORE *store,
-    const char *cert_file,
-    const char *issuer_cert_file,
-    bool *verify_status
-)
-{
-    int result;
-    X509_STORE_CTX *store_ctxt = NULL;
-    X509* x509_cert = NULL;
-
-    if ((x509_cert = load_certificate_file(cert_file)) == NULL)
-    {
-        LOG_ERROR("Could not create X509 to verify certificate %s", cert_file);
-        result = __FAILURE__;
-    }
-    else if ((store_ctxt = X509_STORE_CTX_new()) == NULL)
-    {
-        LOG_ERROR("Could not create X509 store context");
-        X509_free(x509_cert);
-        result = __FAILURE__;
-    }
-    else
-    {
-        X509_STORE_set_flags(store, X509_V_FLAG_X509_STRICT |
-                                    X509_V_FLAG_CHECK_SS_SIGNATURE |
-                                    X509_V_FLAG_POLICY_CHECK);
-        if(!X509_STORE_CTX_init(store_ctxt, store, x509_cert, 0))
-        {
-            LOG_ERROR("Could not initialize X509 store context");
-            result = __FAILURE__;
-        }
-        else
-        {
-            double exp_seconds = 0;
-            int status;
-            bool is_expired = true;
-
-            status = validate_certificate_expiration(x509_cert, &exp_seconds, &is_expired);
-            if (status != 0)
-            {
-                LOG_ERROR("Verifying certificate expiration failed for %s", cert_file);
-                result = __FAILURE__;
-            }
-            else
-            {
-                if (is_expired)
-                {
-                    LOG_INFO("Certificate file has expired %s", cert_file);
-                }
-                else if (validate_subject_keyid(x509_cert) != 0)
-                {
-                    // This check was added to ensure that all certificates and in particular CA
-                    // certificates contain the X509 V3 extension "Subject Key Identifier" (SKID).
-                    // As part of cert hardening, we ensure that all certificates when created have
-                    // the X509 V3 ext Authority Key Identifier (AKID) added. AKID requires
-                    // the SKID to be present or cert generation will fail.
-                    // This check essentially would fail any CA certs generated via quickstart
-                    // or transparent gateway that do not have a SKID set.
-                    LOG_ERROR("Certificate should contain a Subject Key Identifier extension %s",
-                              cert_file);
-                }
-                else if ((status = X509_verify_cert(store_ctxt)) <= 0)
-                {
-                    const char *msg;
-                    int err_code = X509_STORE_CTX_get_error(store_ctxt);
-                    msg = X509_verify_cert_error_string(err_code);
-                    if (msg == NULL)
-                    {
-                        msg = "";
-                    }
-                    LOG_ERROR("Could not verify certificate %s using issuer certificate %s.",
-                              cert_file, issuer_cert_file);
-                    LOG_ERROR("Verification status: %d, Error: %d, Msg: '%s'",
-                              status, err_code, msg);
-                }
-                else
-                {
-                    LOG_DEBUG("Certificate validated %s", cert_file);
-                    *verify_status = true;
-                }
-                result = 0;
-            }
-        }
-        X509_STORE_CTX_free(store_ctxt);
-        X509_free(x509_cert);
-    }
-
-    return result;
-}
-
-static int verify_certificate_internal
-(
-    const char *certificate,
-    const char *issuer_certificate,
-    bool *verify_status
-)
-{
-    int result;
-    X509_LOOKUP *lookup = NULL;
-    X509_STORE *store = NULL;
-    bool check_chain = false;
-
-    initialize_openssl();
-
-    if (validate_cert_chain(certificate, issuer_certificate, &check_chain) != 0)
-    {
-        LOG_ERROR("Failed verifying if issuer is contained in certificate file %s", certificate);
-        result = __FAILURE__;
-    }
-    else if (!check_chain)
-    {
-        LOG_ERROR("Certificate file does not contain issuer certificate %s", certificate);
-        result = 0;
-    }
-    else if ((store = X509_STORE_new()) == NULL)
-    {
-        LOG_ERROR("API X509_STORE_new failed");
-        result = __FAILURE__;
-    }
-    else if ((lookup = X509_STORE_add_lookup(store, X509_LOOKUP_file())) == NULL)
-    {
-        LOG_ERROR("X509 add lookup failed");
-        result = __FAILURE__;
-    }
-    else if (!X509_LOOKUP_load_file(lookup, issuer_certificate, X509_FILETYPE_PEM))
-    {
-        LOG_ERROR("Loading issuer certificate failed");
-        result = __FAILURE__;
-    }
-    else if ((lookup = X509_STORE_add_lookup(store, X509_LOOKUP_hash_dir())) == NULL)
-    {
-        LOG_ERROR("Setting up store lookup failed");
-        result = __FAILURE__;
-    }
-    else if (!X509_LOOKUP_add_dir(lookup, NULL, X509_FILETYPE_DEFAULT))
-    {
-        LOG_ERROR("Setting up store lookup failed");
-        result = __FAILURE__;
-    }
-    else
-    {
-        LOG_DEBUG("Verifying %s using %s", certificate, issuer_certificate);
-        result = check_certificates(store, certificate, issuer_certificate, verify_status);
-    }
-
-    if (store != NULL)
-    {
-        X509_STORE_free(store);
-    }
-
-    return result;
-}
-
-int verify_certificate
-(
-    const char *certificate_file_path,
-    const char *key_file_path,
-    const char *issuer_certificate_file_path,
-    bool *verify_status
-)
-{
-    int result;
-
-    if (verify_status == NULL)
-    {
-        LOG_ERROR("Invalid verify_status parameter");
-        result = __FAILURE__;
-    }
-    else
-    {
-        *verify_status = false;
-        if ((certificate_file_path == NULL) ||
-            (key_file_path == NULL) ||
-            (issuer_certificate_file_path == NULL))
-        {
-            LOG_ERROR("Invalid parameters");
-            result = __FAILURE__;
-        }
-        else
-        {
-            result = verify_certificate_internal(certificate_file_path,
-                                                 issuer_certificate_file_path,
-                                                 verify_status);
-        }
-    }
-
-    return result;
-}
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <openssl/asn1.h>
+#include <openssl/bio.h>
+#include <openssl/buffer.h>
+#include <openssl/err.h>
+#include <openssl/ec.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/buffer_.h"
+#include "azure_c_shared_utility/hmacsha256.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "edge_openssl_common.h"
+
+#include "hsm_atomic.h"
+#include "hsm_key.h"
+#include "hsm_lock.h"
+#include "hsm_log.h"
+#include "hsm_metrics.h"
+#include "hsm_trace.h"
+#include "hsm_utils.h"
+
+//#################################################################################################
+// Data type definations
+//#################################################################################################
+// all X.509 certificates created will be v3 for which the version value is 2
+#define X509_VERSION 0x2
+
+// RSA key length for CA certificates
+#define RSA_KEY_LEN_CA 4096
+// RSA key length for server and client certificates
+#define RSA_KEY_LEN_NON_CA RSA_KEY_LEN_CA >> 1
+
+#define MAX_SUBJECT_FIELD_SIZE 3
+// per RFC3280 state and locality have lengths of 128, +1 for null term
+#define MAX_SUBJECT_VALUE_SIZE 129
+
+#define DEFAULT_EC_CURVE_NAME "secp256k1"
+
+// openssl ASN1 time format defines
+#define ASN1_TIME_STRING_UTC_FORMAT 0x17
+#define ASN1_TIME_STRING_UTC_LEN 13
+
+struct SUBJECT_FIELD_OFFSET_TAG
+{
+    char field[MAX_SUBJECT_FIELD_SIZE];
+    int offset;
+};
+typedef struct SUBJECT_FIELD_OFFSET_TAG SUBJECT_FIELD_OFFSET;
+
+static const SUBJECT_FIELD_OFFSET subj_offsets[] =
+{
+    { "CN", NID_commonName },
+    { "C", NID_countryName },
+    { "L", NID_localityName },
+    { "ST", NID_stateOrProvinceName },
+    { "O", NID_organizationName },
+    { "OU", NID_organizationalUnitName }
+};
+
+struct CERT_KEY_TAG
+{
+    HSM_CLIENT_KEY_INTERFACE interface;
+    EVP_PKEY* evp_key;
+};
+typedef struct CERT_KEY_TAG CERT_KEY;
+
+// maximum number of issuer certificate chains whose X509 stores are cached for verification
+#define MAX_VERIFICATION_STORES 8
+
+// verification policy applied to every cached X509 store
+#define VERIFICATION_STORE_FLAGS (X509_V_FLAG_X509_STRICT | \
+                                  X509_V_FLAG_CHECK_SS_SIGNATURE | \
+                                  X509_V_FLAG_POLICY_CHECK)
+
+struct VERIFICATION_STORE_TAG
+{
+    char *issuer_data;
+    size_t issuer_data_size;
+    X509_STORE *store;
+    uint64_t last_used;
+};
+typedef struct VERIFICATION_STORE_TAG VERIFICATION_STORE;
+
+static VERIFICATION_STORE g_verification_stores[MAX_VERIFICATION_STORES];
+static uint64_t g_verification_store_tick = 0;
+// guards the cache entries, stores are handed out with a reference of their own
+// so the lock is only held to look up and insert entries, not to verify. It is
+// created on first use since verification has no global init.
+static LOCK_HANDLE volatile g_verification_cache_lock = NULL;
+#if defined(HSM_LOCK_PROFILING)
+static HSM_ATOMIC_LONG g_verification_cache_users = 0;
+#endif
+
+// upper bound on the number of threads used to verify a batch of certificates
+#define MAX_VERIFICATION_THREADS 16
+
+struct VERIFICATION_BATCH_TAG
+{
+    X509_STORE *store;
+    const char * const *certificate_files;
+    const char * const *key_files;
+    size_t num_certificates;
+    const char *issuer_certificate;
+    const char *issuer_data;
+    // certificates are only required to embed issuers which form a single chain
+    bool issuer_is_chain;
+    bool *verify_status;
+    HSM_ATOMIC_LONG next_index;
+    HSM_ATOMIC_LONG num_errors;
+    // operation the workers verify certificates for
+    uint64_t trace_parent;
+};
+typedef struct VERIFICATION_BATCH_TAG VERIFICATION_BATCH;
+
+//#################################################################################################
+// Forward Declarations
+//#################################################################################################
+
+static void destroy_evp_key(EVP_PKEY *evp_key);
+
+//#################################################################################################
+// Utilities
+//#################################################################################################
+#if !defined(X509V3_EXT_conf_nid_HELPER)
+    #define X509V3_EXT_conf_nid_HELPER(conf, ctx, nid, value) \
+        X509V3_EXT_conf_nid((conf), (ctx), (nid), (value))
+#endif
+
+extern time_t get_utc_time_from_asn_string(const unsigned char *time_value, size_t length);
+
+//#################################################################################################
+// PKI key operations
+//#################################################################################################
+static int cert_key_sign
+(
+    KEY_HANDLE key_handle,
+    const unsigned char* data_to_be_signed,
+    size_t data_to_be_signed_size,
+    unsigned char** digest,
+    size_t* digest_size
+)
+{
+    (void)key_handle;
+    (void)data_to_be_signed;
+    (void)data_to_be_signed_size;
+
+    LOG_ERROR("Sign for cert keys is not supported");
+    if (digest != NULL)
+    {
+        *digest = NULL;
+    }
+    if (digest_size != NULL)
+    {
+        *digest_size = 0;
+    }
+    return __FAILURE__;
+}
+
+int cert_key_derive_and_sign
+(
+    KEY_HANDLE key_handle,
+    const unsigned char* data_to_be_signed,
+    size_t data_to_be_signed_size,
+    const unsigned char* identity,
+    size_t identity_size,
+    unsigned char** digest,
+    size_t* digest_size
+)
+{
+    (void)key_handle;
+    (void)data_to_be_signed;
+    (void)data_to_be_signed_size;
+    (void)identity;
+    (void)identity_size;
+
+    LOG_ERROR("Derive and sign for cert keys is not supported");
+    if (digest != NULL)
+    {
+        *digest = NULL;
+    }
+    if (digest_size != NULL)
+    {
+        *digest_size = 0;
+    }
+    return __FAILURE__;
+}
+
+static int cert_key_encrypt
+(
+    KEY_HANDLE key_handle,
+    const SIZED_BUFFER *identity,
+    const SIZED_BUFFER *plaintext,
+    const SIZED_BUFFER *initialization_vector,
+    SIZED_BUFFER *ciphertext
+)
+{
+    (void)key_handle;
+    (void)identity;
+    (void)plaintext;
+    (void)initialization_vector;
+
+    LOG_ERROR("Cert key encrypt operation not supported");
+    ciphertext->buffer = NULL;
+    ciphertext->size = 0;
+    return __FAILURE__;
+}
+
+static int cert_key_decrypt
+(
+    KEY_HANDLE key_handle,
+    const SIZED_BUFFER *identity,
+    const SIZED_BUFFER *ciphertext,
+    const SIZED_BUFFER *initialization_vector,
+    SIZED_BUFFER *plaintext
+)
+{
+    (void)key_handle;
+    (void)identity;
+    (void)ciphertext;
+    (void)initialization_vector;
+
+    LOG_ERROR("Cert key decrypt operation not supported");
+    plaintext->buffer = NULL;
+    plaintext->size = 0;
+    return __FAILURE__;
+}
+
+static void cert_key_destroy(KEY_HANDLE key_handle)
+{
+    CERT_KEY *cert_key = (CERT_KEY*)key_handle;
+    if (cert_key != NULL)
+    {
+        destroy_evp_key(cert_key->evp_key);
+        free(cert_key);
+    }
+}
+
+//#################################################################################################
+// PKI key generation
+//#################################################################################################
+static EVP_PKEY* generate_rsa_key(CERTIFICATE_TYPE cert_type)
+{
+    int status;
+    BIGNUM *bne;
+    EVP_PKEY *pkey;
+    RSA *rsa;
+
+    size_t key_len = (cert_type == CERTIFICATE_TYPE_CA) ? RSA_KEY_LEN_CA : RSA_KEY_LEN_NON_CA;
+    LOG_INFO("Generating RSA key of length %zu", key_len);
+    if ((pkey = EVP_PKEY_new()) == NULL)
+    {
+        LOG_ERROR("Unable to create EVP_PKEY structure");
+    }
+    else if ((bne = BN_new()) == NULL)
+    {
+        LOG_ERROR("Could not allocate new big num object");
+        EVP_PKEY_free(pkey);
+        pkey = NULL;
+    }
+    else if ((status = BN_set_word(bne, RSA_F4)) != 1)
+    {
+        LOG_ERROR("Unable to set big num word");
+        BN_free(bne);
+        EVP_PKEY_free(pkey);
+        pkey = NULL;
+    }
+    else if ((rsa = RSA_new()) == NULL)
+    {
+        LOG_ERROR("Could not allocate new RSA object");
+        BN_free(bne);
+        EVP_PKEY_free(pkey);
+        pkey = NULL;
+    }
+    else if ((status = RSA_generate_key_ex(rsa, (int)key_len, bne, NULL)) != 1)
+    {
+        LOG_ERROR("Unable to generate RSA key");
+        RSA_free(rsa);
+        BN_free(bne);
+        EVP_PKEY_free(pkey);
+        pkey = NULL;
+    }
+    else if ((status = EVP_PKEY_set1_RSA(pkey, rsa)) != 1)
+    {
+        LOG_ERROR("Unable to assign RSA key.");
+        RSA_free(rsa);
+        BN_free(bne);
+        EVP_PKEY_free(pkey);
+        pkey = NULL;
+    }
+    else
+    {
+        RSA_free(rsa);
+        BN_free(bne);
+    }
+
+    return pkey;
+}
+
+static EVP_PKEY* generate_ecc_key(const char *ecc_type)
+{
+    EC_KEY* ecc_key;
+    EVP_PKEY *evp_key;
+
+    int ecc_group = OBJ_txt2nid(ecc_type);
+
+    if ((ecc_key = EC_KEY_new_by_curve_name(ecc_group)) == NULL)
+    {
+        LOG_ERROR("Failure getting curve name");
+        evp_key = NULL;
+    }
+    else
+    {
+        EC_KEY_set_asn1_flag(ecc_key, OPENSSL_EC_NAMED_CURVE);
+        if (!EC_KEY_generate_key(ecc_key))
+        {
+            LOG_ERROR("Error generating ECC key");
+            evp_key = NULL;
+        }
+        else if ((evp_key = EVP_PKEY_new()) == NULL)
+        {
+            LOG_ERROR("Unable to create EVP_PKEY structure");
+        }
+        else if (!EVP_PKEY_set1_EC_KEY(evp_key, ecc_key))
+        {
+            LOG_ERROR("Error assigning ECC key to EVP_PKEY structure");
+            EVP_PKEY_free(evp_key);
+            evp_key = NULL;
+        }
+        EC_KEY_free(ecc_key);
+    }
+
+    return evp_key;
+}
+
+static EVP_PKEY* generate_evp_key
+(
+    CERTIFICATE_TYPE cert_type,
+    X509* issuer_cert,
+    const PKI_KEY_PROPS *key_props
+)
+{
+    EVP_PKEY *evp_key;
+    uint64_t start = hsm_metrics_start();
+    HSM_TRACE_SCOPE trace;
+
+    HSM_TRACE_BEGIN(&trace, "pki.generate_key", NULL, 0);
+    if (issuer_cert == NULL)
+    {
+        if ((key_props != NULL) && (key_props->key_type == HSM_PKI_KEY_EC))
+        {
+            const char *curve = (key_props->ec_curve_name != NULL) ? key_props->ec_curve_name :
+                                                                     DEFAULT_EC_CURVE_NAME;
+            evp_key = generate_ecc_key(curve);
+        }
+        else
+        {
+            // by default use RSA keys if no issuer cert or key properties was provided
+            evp_key = generate_rsa_key(cert_type);
+        }
+    }
+    else
+    {
+        EVP_PKEY *evp_pub_key = NULL;
+        // read the public key from the issuer certificate and determine the type
+        // of key used and then generate the appropriate type of key
+        if ((evp_pub_key = X509_get_pubkey(issuer_cert)) == NULL)
+        {
+            LOG_ERROR("Error getting public key from issuer certificate");
+            evp_key = NULL;
+        }
+        else
+        {
+            int key_type = EVP_PKEY_base_id(evp_pub_key);
+            switch (key_type)
+            {
+                case EVP_PKEY_RSA:
+                {
+                    evp_key = generate_rsa_key(cert_type);
+                }
+                break;
+
+                case EVP_PKEY_EC:
+                {
+                    EC_KEY *ecc_key = EVP_PKEY_get1_EC_KEY(evp_pub_key);
+                    const EC_GROUP* ecgrp = EC_KEY_get0_group(ecc_key);
+                    const char *curve_name = OBJ_nid2sn(EC_GROUP_get_curve_name(ecgrp));
+                    LOG_INFO("Generating ECC Key size: %d bits. ECC Key type: %s",
+                             EVP_PKEY_bits(evp_pub_key), curve_name);
+                    evp_key = generate_ecc_key(curve_name);
+                    EC_KEY_free(ecc_key);
+                }
+                break;
+
+                default:
+                    LOG_ERROR("Unsupported key type %d", key_type);
+                    evp_key = NULL;
+            };
+            EVP_PKEY_free(evp_pub_key);
+        }
+    }
+    hsm_metrics_record(HSM_METRICS_PKI_GENERATE_KEY, start, evp_key == NULL);
+    HSM_TRACE_END(&trace, 0, (evp_key != NULL) ? 0 : __FAILURE__);
+
+    return evp_key;
+}
+
+static void destroy_evp_key(EVP_PKEY *evp_key)
+{
+    if (evp_key != NULL)
+    {
+        EVP_PKEY_free(evp_key);
+    }
+}
+
+//#################################################################################################
+// PKI file IO
+//#################################################################################################
+static X509* load_certificate_file(const char* cert_file_name)
+{
+    X509* x509_cert;
+    BIO* cert_file = BIO_new_file(cert_file_name, "r");
+    if (cert_file == NULL)
+    {
+        LOG_ERROR("Failure to open certificate file %s", cert_file_name);
+        x509_cert = NULL;
+    }
+    else
+    {
+        x509_cert = PEM_read_bio_X509(cert_file, NULL, NULL, NULL);
+        if (x509_cert == NULL)
+        {
+            LOG_ERROR("Failure PEM_read_bio_X509 for cert %s", cert_file_name);
+        }
+        BIO_free_all(cert_file);
+    }
+
+    return x509_cert;
+}
+
+static int bio_chain_cert_helper(BIO *cert_file, const char *issuer_cert_file_name)
+{
+    int result;
+    size_t issuer_buf_size = 0;
+
+    void *issuer_cert = read_file_into_buffer(issuer_cert_file_name, &issuer_buf_size);
+    if (issuer_cert == NULL)
+    {
+        LOG_ERROR("Could not read issuer certificate file %s", issuer_cert_file_name);
+        result = __FAILURE__;
+    }
+    else
+    {
+        if (issuer_buf_size == 0)
+        {
+            LOG_ERROR("Read zero bytes from issuer certificate file %s", issuer_cert_file_name);
+            result = __FAILURE__;
+        }
+        else if (issuer_buf_size > INT_MAX)
+        {
+            LOG_ERROR("Issuer certificate file too large %s", issuer_cert_file_name);
+            result = __FAILURE__;
+        }
+        else
+        {
+            int len = BIO_write(cert_file, issuer_cert, (int)issuer_buf_size);
+            if (len != (int)issuer_buf_size)
+            {
+                LOG_ERROR("BIO_write returned %d expected %zu", len, issuer_buf_size);
+                result = __FAILURE__;
+            }
+            else
+            {
+                result = 0;
+            }
+        }
+        free(issuer_cert);
+    }
+
+    return result;
+}
+
+static int add_pem_bio_to_batch
+(
+    BIO *pem_bio,
+    HSM_FILE_BATCH_HANDLE batch,
+    const char *file_name,
+    bool cleanse
+)
+{
+    int result;
+    BUF_MEM *pem_data = NULL;
+
+    (void)BIO_get_mem_ptr(pem_bio, &pem_data);
+    if ((pem_data == NULL) || (pem_data->data == NULL) || (pem_data->length == 0))
+    {
+        LOG_ERROR("No PEM data was serialized for %s", file_name);
+        result = __FAILURE__;
+    }
+    else
+    {
+        // keys and certificates are only readable by their owner
+        if (file_batch_add_buffer(batch, file_name, (const unsigned char*)pem_data->data,
+                                  pem_data->length, true) != 0)
+        {
+            LOG_ERROR("Could not add %s to the file batch", file_name);
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+
+        if (cleanse)
+        {
+            OPENSSL_cleanse(pem_data->data, pem_data->length);
+        }
+    }
+
+    return result;
+}
+
+static int write_certificate_file
+(
+    X509 *x509_cert,
+    const char *cert_file_name,
+    const char *issuer_certificate_file,
+    HSM_FILE_BATCH_HANDLE batch
+)
+{
+    int result;
+    BIO *cert_bio;
+
+    // the certificate is serialized in memory and only replaces the file on
+    // disk once the batch it is added to is committed
+    if ((cert_bio = BIO_new(BIO_s_mem())) == NULL)
+    {
+        LOG_ERROR("Failure creating new BIO handle for %s", cert_file_name);
+        result = __FAILURE__;
+    }
+    else
+    {
+        if (!PEM_write_bio_X509(cert_bio, x509_cert))
+        {
+            LOG_ERROR("Unable to write certificate to file %s", cert_file_name);
+            result = __FAILURE__;
+        }
+        else if ((issuer_certificate_file != NULL) &&
+                 (bio_chain_cert_helper(cert_bio, issuer_certificate_file) != 0))
+        {
+            result = __FAILURE__;
+        }
+        else if (add_pem_bio_to_batch(cert_bio, batch, cert_file_name, false) != 0)
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+        BIO_free_all(cert_bio);
+    }
+
+    return result;
+}
+
+static EVP_PKEY* load_private_key_file(const char* key_file_name)
+{
+    EVP_PKEY* evp_key;
+    BIO* key_file = BIO_new_file(key_file_name, "r");
+    if (key_file == NULL)
+    {
+        LOG_ERROR("Failure to open key file %s", key_file_name);
+        evp_key = NULL;
+    }
+    else
+    {
+        evp_key = PEM_read_bio_PrivateKey(key_file, NULL, NULL, NULL);
+        if (evp_key == NULL)
+        {
+            LOG_ERROR("Failure PEM_read_bio_PrivateKey for %s", key_file_name);
+        }
+        BIO_free_all(key_file);
+    }
+
+    return evp_key;
+}
+
+static int write_private_key_file
+(
+    EVP_PKEY* evp_key,
+    const char* key_file_name,
+    HSM_FILE_BATCH_HANDLE batch
+)
+{
+    int result;
+    BIO *key_bio;
+
+    if ((key_bio = BIO_new(BIO_s_mem())) == NULL)
+    {
+        LOG_ERROR("Failure creating new BIO handle for %s", key_file_name);
+        result = __FAILURE__;
+    }
+    else
+    {
+        if (!PEM_write_bio_PrivateKey(key_bio, evp_key, NULL, NULL, 0, NULL, NULL))
+        {
+            LOG_ERROR("Unable to write private key to file %s", key_file_name);
+            result = __FAILURE__;
+        }
+        else if (add_pem_bio_to_batch(key_bio, batch, key_file_name, true) != 0)
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+        BIO_free_all(key_bio);
+    }
+
+    return result;
+}
+
+//#################################################################################################
+// PKI certificate generation
+//#################################################################################################
+static int cert_set_core_properties
+(
+    X509* x509_cert,
+    KEY_HANDLE key,
+    CERT_PROPS_HANDLE cert_props_handle,
+    int serial_num
+)
+{
+    (void)cert_props_handle;
+    int result;
+
+    if (!X509_set_version(x509_cert, X509_VERSION))
+    {
+        LOG_ERROR("Failure setting the certificate version");
+        result = __FAILURE__;
+    }
+    else if (!ASN1_INTEGER_set(X509_get_serialNumber(x509_cert), serial_num))
+    {
+        LOG_ERROR("Failure setting serial number");
+        result = __FAILURE__;
+    }
+    else if (!X509_set_pubkey(x509_cert, key))
+    {
+        LOG_ERROR("Failure setting public key");
+        result = __FAILURE__;
+    }
+    else
+    {
+        LOG_DEBUG("Core certificate properties set");
+        result = 0;
+    }
+    return result;
+}
+
+static int validate_subject_keyid(X509 *x509_cert)
+{
+    int result;
+
+    if (X509_get_ext_by_NID(x509_cert, NID_subject_key_identifier, -1) == -1)
+    {
+        LOG_ERROR("X.509 V3 extension NID_subject_key_identifier does not exist");
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static int validate_certificate_expiration
+(
+    X509* x509_cert,
+    double *exp_seconds_left,
+    bool *is_expired
+)
+{
+    int result;
+    time_t exp_time;
+    double seconds_left = 0;
+
+    *is_expired = true;
+    time_t now = time(NULL);
+    ASN1_TIME *exp_asn1 = X509_get_notAfter(x509_cert);
+    if ((exp_asn1->type != ASN1_TIME_STRING_UTC_FORMAT) &&
+        (exp_asn1->length != ASN1_TIME_STRING_UTC_LEN))
+    {
+        LOG_ERROR("Unsupported time format in certificate");
+        result = __FAILURE__;
+    }
+    else if ((exp_time = get_utc_time_from_asn_string(exp_asn1->data, exp_asn1->length)) == 0)
+    {
+        LOG_ERROR("Could not parse expiration date from certificate");
+        result = __FAILURE__;
+    }
+    else
+    {
+        if ((seconds_left = difftime(exp_time, now)) <= 0)
+        {
+            LOG_ERROR("Certificate has expired");
+        }
+        else
+        {
+            *is_expired = false;
+        }
+        result = 0;
+    }
+
+    *exp_seconds_left = seconds_left;
+    return result;
+}
+
+static int cert_set_expiration
+(
+    X509* x509_cert,
+    uint64_t requested_validity,
+    X509* issuer_cert
+)
+{
+    int result;
+
+    if (!X509_gmtime_adj(X509_get_notBefore(x509_cert), 0))
+    {
+        LOG_ERROR("Failure setting not before time");
+        result = __FAILURE__;
+    }
+    else
+    {
+        // compute the MIN of seconds between:
+        //    - UTC now() and the issuer certificate expiration timestamp and
+        //    - Requested certificate expiration time expressed in UTC seconds from now()
+        if (issuer_cert != NULL)
+        {
+            // determine max validity in seconds of issuer
+            double exp_seconds_left_from_now = 0;
+            bool is_expired = true;
+            int status = validate_certificate_expiration(issuer_cert,
+                                                         &exp_seconds_left_from_now,
+                                                         &is_expired);
+            if ((status != 0) || (is_expired))
+            {
+                LOG_ERROR("Issuer certificate expiration failure. Status %d, verify status: %d",
+                          status, is_expired);
+                result = __FAILURE__;
+            }
+            else
+            {
+                uint64_t number_seconds_left = (uint64_t)exp_seconds_left_from_now;
+                LOG_DEBUG("Issuer expiration seconds left: %" PRIu64 ", Request validity:%" PRIu64,
+                          number_seconds_left, requested_validity);
+                requested_validity = (requested_validity == 0) ?
+                                        number_seconds_left :
+                                        ((requested_validity < number_seconds_left) ?
+                                            requested_validity :
+                                            number_seconds_left);
+                result = 0;
+            }
+        }
+        else
+        {
+            result = 0;
+        }
+
+        if (result == 0)
+        {
+            if (requested_validity == 0)
+            {
+                LOG_ERROR("Invalid expiration time in seconds %" PRIu64, requested_validity);
+                result = __FAILURE__;
+            }
+            else if (!X509_gmtime_adj(X509_get_notAfter(x509_cert), (long)requested_validity))
+            {
+                LOG_ERROR("Failure setting not after time %" PRIu64, requested_validity);
+                result = __FAILURE__;
+            }
+        }
+    }
+
+    return result;
+}
+
+static int set_basic_constraints(X509 *x509_cert, CERTIFICATE_TYPE cert_type, int ca_path_len)
+{
+    int result;
+    BASIC_CONSTRAINTS *bc;
+
+    if ((bc = BASIC_CONSTRAINTS_new()) == NULL)
+    {
+        LOG_ERROR("Could not allocate basic constraint");
+        result = __FAILURE__;
+    }
+    else
+    {
+        bool is_pathlen_failure;
+        int is_critical = 0;
+        bc->ca = 0;
+        if (cert_type == CERTIFICATE_TYPE_CA)
+        {
+            is_critical = 1;
+            bc->ca = 1;
+            bc->pathlen = ASN1_INTEGER_new();
+            if (bc->pathlen == NULL)
+            {
+                LOG_ERROR("Could not path length integer");
+                is_pathlen_failure = true;
+            }
+            else if (ASN1_INTEGER_set(bc->pathlen, ca_path_len) != 1)
+            {
+                LOG_ERROR("Setting path len failed");
+                is_pathlen_failure = true;
+            }
+            else
+            {
+                is_pathlen_failure = false;
+            }
+        }
+        else
+        {
+            is_pathlen_failure = false;
+        }
+
+
+        if (is_pathlen_failure)
+        {
+            result = __FAILURE__;
+        }
+        else if (X509_add1_ext_i2d(x509_cert, NID_basic_constraints,
+                                   bc, is_critical, X509V3_ADD_DEFAULT) != 1)
+        {
+            LOG_ERROR("Could not add basic constraint extension to certificate");
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+        BASIC_CONSTRAINTS_free(bc);
+    }
+
+    return result;
+}
+
+static int add_ext
+(
+    X509 *x509_cert,
+    X509V3_CTX *ctx,
+    int nid,
+    const char *value,
+    const char* nid_diagnostic
+)
+{
+    int result;
+    X509_EXTENSION *ex;
+
+    // openssl API requires a non const value be passed in
+    if ((ex = X509V3_EXT_conf_nid_HELPER(NULL, ctx, nid, (char*)value)) == NULL)
+    {
+        LOG_ERROR("Could not obtain V3 extension by NID %#x, %s", nid, nid_diagnostic);
+        result = __FAILURE__;
+    }
+    else
+    {
+        if (X509_add_ext(x509_cert, ex, -1) == 0)
+        {
+            LOG_ERROR("Could not add V3 extension by NID %#x, %s. Value %s",
+                      nid, nid_diagnostic, value);
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+        X509_EXTENSION_free(ex);
+    }
+
+    return result;
+}
+
+static int set_key_usage
+(
+    X509 *x509_cert,
+    CERTIFICATE_TYPE cert_type
+)
+{
+    int result;
+    char *usage, *ext_usage;
+
+    if (cert_type == CERTIFICATE_TYPE_CA)
+    {
+        usage = "critical, digitalSignature, keyCertSign";
+        ext_usage = NULL;
+    }
+    else if (cert_type == CERTIFICATE_TYPE_CLIENT)
+    {
+        usage = "critical, nonRepudiation, digitalSignature, keyEncipherment, dataEncipherment";
+        ext_usage = "clientAuth";
+    }
+    else
+    {
+        usage = "critical, nonRepudiation, digitalSignature, keyEncipherment, dataEncipherment, "
+                "keyAgreement";
+        ext_usage = "serverAuth";
+    }
+
+    if (add_ext(x509_cert, NULL, NID_key_usage, usage, "NID_key_usage") != 0)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        if ((ext_usage != NULL) &&
+            (add_ext(x509_cert, NULL, NID_ext_key_usage, ext_usage, "NID_ext_key_usage") != 0))
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int set_key_identifier_extension
+(
+    X509 *x509_cert,
+    X509 *issuer_cert,
+    int nid,
+    const char *nid_diagnostic,
+    char *value
+)
+{
+    int result;
+    X509V3_CTX ctx;
+    X509V3_set_ctx(&ctx, issuer_cert, x509_cert, NULL, NULL, 0);
+
+    if (add_ext(x509_cert, &ctx, nid, value, nid_diagnostic) != 0)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static int cert_set_key_id_extensions
+(
+    X509 *x509_cert,
+    X509 *issuer_cert
+)
+{
+    int result;
+
+    if (set_key_identifier_extension(x509_cert, NULL, NID_subject_key_identifier,
+                                     "NID_subject_key_identifier", "hash") != 0)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        char *auth_value = "issuer:always,keyid:always";
+        issuer_cert = (issuer_cert != NULL) ? issuer_cert : x509_cert;
+        if (set_key_identifier_extension(x509_cert, issuer_cert, NID_authority_key_identifier,
+                                         "NID_authority_key_identifier", auth_value) != 0)
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int set_san
+(
+    X509 *x509_cert,
+    CERT_PROPS_HANDLE cert_props_handle
+)
+{
+    size_t num_entries = 0, idx;
+    bool fail_flag = false;
+    const char * const* sans = get_san_entries(cert_props_handle, &num_entries);
+
+    if (sans != NULL)
+    {
+        for (idx = 0; idx < num_entries; idx++)
+        {
+            if ((sans[idx] != NULL) &&
+                (add_ext(x509_cert, NULL, NID_subject_alt_name,
+                         sans[idx], "NID_subject_alt_name") != 0))
+            {
+                fail_flag = true;
+                break;
+            }
+        }
+    }
+
+    return (fail_flag) ? __FAILURE__ : 0;
+}
+
+static int cert_set_extensions
+(
+    X509 *x509_cert,
+    CERTIFICATE_TYPE cert_type,
+    X509* issuer_cert,
+    int ca_path_len,
+    CERT_PROPS_HANDLE cert_props_handle
+)
+{
+    (void)issuer_cert;
+    int result;
+
+    if ((set_basic_constraints(x509_cert, cert_type, ca_path_len) != 0) ||
+        (set_key_usage(x509_cert, cert_type) != 0) ||
+        (set_san(x509_cert, cert_props_handle) != 0))
+    {
+        LOG_ERROR("Failure setting certificate extensions");
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static int cert_set_subject_field
+(
+    X509_NAME* name,
+    X509_NAME* issuer_name,
+    const char* field,
+    const char* value
+)
+{
+    static char issuer_name_field[MAX_SUBJECT_VALUE_SIZE];
+    const char* value_to_set = NULL;
+    int result = 0;
+
+    if (value != NULL)
+    {
+        value_to_set = value;
+    }
+    else
+    {
+        if (issuer_name != NULL)
+        {
+            size_t index, found = 0;
+            for (index = 0; index < sizeof(subj_offsets)/sizeof(subj_offsets[0]); index++)
+            {
+                if (strcmp(field, subj_offsets[index].field) == 0)
+                {
+                    found = 1;
+                    break;
+                }
+            }
+            if (found == 1)
+            {
+                int status;
+                memset(issuer_name_field, 0 , sizeof(issuer_name_field));
+                status = X509_NAME_get_text_by_NID(issuer_name,
+                                                   subj_offsets[index].offset,
+                                                   issuer_name_field,
+                                                   sizeof(issuer_name_field));
+                if (status == -1)
+                {
+                    LOG_DEBUG("Failure X509_NAME_get_text_by_NID for field: %s", field);
+                }
+                else
+                {
+                    value_to_set = issuer_name_field;
+                    LOG_DEBUG("From issuer cert for field: %s got value: %s", field, value_to_set);
+                }
+            }
+        }
+    }
+
+    if (value_to_set != NULL)
+    {
+        if (X509_NAME_add_entry_by_txt(name, field, MBSTRING_ASC,
+                                       (unsigned char *)value_to_set, -1, -1, 0) != 1)
+        {
+            LOG_ERROR("Failure X509_NAME_add_entry_by_txt for field: %s using value: %s",
+                      field, value_to_set);
+            result = __FAILURE__;
+        }
+    }
+
+    return result;
+}
+
+static int cert_set_subject_fields_and_issuer
+(
+    X509* x509_cert,
+    const char *common_name,
+    X509* issuer_certificate,
+    CERT_PROPS_HANDLE cert_props_handle
+)
+{
+    int result;
+    /*const*/ X509_NAME* issuer_subj_name = NULL;
+    if ((issuer_certificate != NULL) &&
+        ((issuer_subj_name = X509_get_subject_name(issuer_certificate)) == NULL))
+    {
+        LOG_ERROR("Failure obtaining issuer subject name");
+        result = __FAILURE__;
+    }
+    else
+    {
+        X509_NAME* name = X509_get_subject_name(x509_cert);
+        if (name == NULL)
+        {
+            LOG_ERROR("Failure get subject name");
+            result = __FAILURE__;
+        }
+        else
+        {
+            const char *value;
+            result = 0;
+            value = get_country_name(cert_props_handle);
+            result = cert_set_subject_field(name, issuer_subj_name, "C", value);
+            if (result == 0)
+            {
+                value = get_state_name(cert_props_handle);
+                result = cert_set_subject_field(name, issuer_subj_name, "ST", value);
+            }
+            if (result == 0)
+            {
+                value = get_locality(cert_props_handle);
+                result = cert_set_subject_field(name, issuer_subj_name, "L", value);
+            }
+            if (result == 0)
+            {
+                value = get_organization_name(cert_props_handle);
+                result = cert_set_subject_field(name, issuer_subj_name, "O", value);
+            }
+            if (result == 0)
+            {
+                value = get_organization_unit(cert_props_handle);
+                result = cert_set_subject_field(name, issuer_subj_name, "OU", value);
+            }
+            if (result == 0)
+            {
+                //always use value provided in cert_props_handle
+                result = cert_set_subject_field(name, NULL, "CN", common_name);
+            }
+            if (result == 0)
+            {
+                LOG_DEBUG("Certificate subject fields set");
+                issuer_subj_name = (issuer_subj_name == NULL) ? name : issuer_subj_name;
+                if (!X509_set_issuer_name(x509_cert, issuer_subj_name))
+                {
+                    LOG_ERROR("Failure setting issuer name");
+                    result = __FAILURE__;
+                }
+                else
+                {
+                    LOG_DEBUG("Certificate issuer set successfully");
+                }
+            }
+        }
+    }
+    return result;
+}
+
+static int generate_cert_key
+(
+    CERTIFICATE_TYPE cert_type,
+    X509* issuer_certificate,
+    const char *key_file_name,
+    EVP_PKEY **result_evp_key,
+    const PKI_KEY_PROPS *key_props,
+    HSM_FILE_BATCH_HANDLE batch
+)
+{
+    int result;
+    EVP_PKEY* evp_key;
+    *result_evp_key = NULL;
+
+    if ((evp_key = generate_evp_key(cert_type, issuer_certificate, key_props)) == NULL)
+    {
+        LOG_ERROR("Error generating EVP key in %s", key_file_name);
+        result = __FAILURE__;
+    }
+    else if (write_private_key_file(evp_key, key_file_name, batch) != 0)
+    {
+        LOG_ERROR("Error writing private key to file %s", key_file_name);
+        result = __FAILURE__;
+        destroy_evp_key(evp_key);
+    }
+    else
+    {
+        LOG_DEBUG("Generated private key at file %s", key_file_name);
+        result = 0;
+        *result_evp_key = evp_key;
+    }
+
+    return result;
+}
+
+static int generate_evp_certificate
+(
+    EVP_PKEY* evp_key,
+    CERTIFICATE_TYPE cert_type,
+    const char *common_name,
+    uint64_t requested_validity,
+    EVP_PKEY* issuer_evp_key,
+    X509* issuer_certificate,
+    const char *issuer_certificate_file,
+    CERT_PROPS_HANDLE cert_props_handle,
+    int serial_num,
+    int ca_path_len,
+    const char *cert_file_name,
+    HSM_FILE_BATCH_HANDLE batch,
+    X509** result_cert
+)
+{
+    int result;
+    X509* x509_cert;
+    *result_cert = NULL;
+    if ((x509_cert = X509_new()) == NULL)
+    {
+        LOG_ERROR("Failure creating the x509 cert");
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+        if (cert_set_core_properties(x509_cert, evp_key, cert_props_handle, serial_num) != 0)
+        {
+            LOG_ERROR("Failure setting core certificate properties");
+            result = __FAILURE__;
+        }
+        else if (cert_set_expiration(x509_cert, requested_validity, issuer_certificate) != 0)
+        {
+            LOG_ERROR("Failure setting certificate validity period");
+            result = __FAILURE__;
+        }
+        else if (cert_set_extensions(x509_cert,
+                                     cert_type,
+                                     issuer_certificate,
+                                     ca_path_len,
+                                     cert_props_handle) != 0)
+        {
+            LOG_ERROR("Failure setting certificate extensions");
+            result = __FAILURE__;
+        }
+        else if (cert_set_subject_fields_and_issuer(x509_cert,
+                                                    common_name,
+                                                    issuer_certificate,
+                                                    cert_props_handle) != 0)
+        {
+            LOG_ERROR("Failure setting certificate subject fields");
+            result = __FAILURE__;
+        }
+        else if (cert_set_key_id_extensions(x509_cert, issuer_certificate) != 0)
+        {
+            LOG_ERROR("Failure setting certificate subject auth key id extensions");
+            result = __FAILURE__;
+        }
+        else
+        {
+            HSM_TRACE_SCOPE trace;
+            int sign_size;
+
+            issuer_evp_key = (issuer_evp_key == NULL) ? evp_key : issuer_evp_key;
+            HSM_TRACE_BEGIN(&trace, "pki.sign_certificate", common_name, 0);
+            sign_size = X509_sign(x509_cert, issuer_evp_key, EVP_sha256());
+            HSM_TRACE_END(&trace, (sign_size > 0) ? (size_t)sign_size : 0, (sign_size != 0) ? 0 : __FAILURE__);
+            if (sign_size == 0)
+            {
+                LOG_ERROR("Failure signing x509");
+                result = __FAILURE__;
+            }
+            else if (write_certificate_file(x509_cert, cert_file_name,
+                                            issuer_certificate_file, batch) != 0)
+            {
+                LOG_ERROR("Failure saving x509 certificate");
+                result = __FAILURE__;
+            }
+            else
+            {
+                *result_cert = x509_cert;
+            }
+        }
+        if (result != 0)
+        {
+            X509_free(x509_cert);
+        }
+    }
+
+    return result;
+}
+
+static int generate_pki_cert_and_key_helper
+(
+    CERT_PROPS_HANDLE cert_props_handle,
+    int serial_number,
+    int ca_path_len,
+    const char* key_file_name,
+    const char* cert_file_name,
+    const char* issuer_key_file,
+    const char* issuer_certificate_file,
+    const PKI_KEY_PROPS *key_props
+)
+{
+    int result;
+    uint64_t requested_validity;
+    const char* common_name_prop_value;
+    X509* issuer_certificate = NULL;
+    EVP_PKEY* issuer_evp_key = NULL;
+    HSM_FILE_BATCH_HANDLE batch;
+
+    initialize_openssl();
+    if (cert_props_handle == NULL)
+    {
+        LOG_ERROR("Failure saving x509 certificate");
+        result = __FAILURE__;
+    }
+    else if (key_file_name == NULL)
+    {
+        LOG_ERROR("Invalid key file path");
+        result = __FAILURE__;
+    }
+    else if (cert_file_name == NULL)
+    {
+        LOG_ERROR("Invalid key file path");
+        result = __FAILURE__;
+    }
+    else if (((issuer_certificate_file == NULL) && (issuer_key_file != NULL)) ||
+             ((issuer_certificate_file != NULL) && (issuer_key_file == NULL)))
+    {
+        LOG_ERROR("Invalid issuer certificate and key file provided");
+        result = __FAILURE__;
+    }
+    else if (ca_path_len < 0)
+    {
+        LOG_ERROR("Invalid CA path len %d", ca_path_len);
+        result = __FAILURE__;
+    }
+    else if ((requested_validity = get_validity_seconds(cert_props_handle)) == 0)
+    {
+        LOG_ERROR("Validity in seconds cannot be 0");
+        result = __FAILURE__;
+    }
+    else if (requested_validity > LONG_MAX)
+    {
+        LOG_ERROR("Number of seconds too large %" PRIu64, requested_validity);
+        result = __FAILURE__;
+    }
+    else if ((common_name_prop_value = get_common_name(cert_props_handle)) == NULL)
+    {
+        LOG_ERROR("Common name value cannot be NULL");
+        result = __FAILURE__;
+    }
+    else if (strlen(common_name_prop_value) == 0)
+    {
+        LOG_ERROR("Common name value cannot be empty");
+        result = __FAILURE__;
+    }
+    else
+    {
+        CERTIFICATE_TYPE cert_type = get_certificate_type(cert_props_handle);
+        if ((cert_type != CERTIFICATE_TYPE_CLIENT) &&
+            (cert_type != CERTIFICATE_TYPE_SERVER) &&
+            (cert_type != CERTIFICATE_TYPE_CA))
+        {
+            LOG_ERROR("Error invalid certificate type %d", cert_type);
+            result = __FAILURE__;
+        }
+        else if ((cert_type != CERTIFICATE_TYPE_CA) && (ca_path_len != 0))
+        {
+            LOG_ERROR("Invalid path len argument provided for a non CA certificate request");
+            result = __FAILURE__;
+        }
+        else
+        {
+            bool perform_cert_gen;
+            if (issuer_certificate_file)
+            {
+                if ((issuer_certificate = load_certificate_file(issuer_certificate_file)) == NULL)
+                {
+                    LOG_ERROR("Could not load issuer certificate file");
+                    perform_cert_gen = false;
+                }
+                else if ((issuer_evp_key = load_private_key_file(issuer_key_file)) == NULL)
+                {
+                    LOG_ERROR("Could not load issuer private key file");
+                    perform_cert_gen = false;
+                }
+                else
+                {
+                    perform_cert_gen = true;
+                }
+            }
+            else
+            {
+                perform_cert_gen = true;
+            }
+
+            if (!perform_cert_gen)
+            {
+                result = __FAILURE__;
+            }
+            else if ((batch = file_batch_create()) == NULL)
+            {
+                LOG_ERROR("Could not create a file batch for the certificate and key");
+                result = __FAILURE__;
+            }
+            else
+            {
+                // the key and certificate files are replaced together, so a
+                // failure or a crash never leaves a key paired with a stale
+                // certificate or a partially written file
+                X509* x509_cert = NULL;
+                EVP_PKEY* evp_key = NULL;
+                if (generate_cert_key(cert_type, issuer_certificate,
+                                      key_file_name, &evp_key, key_props, batch) != 0)
+                {
+                    LOG_ERROR("Could not generate private key for certificate create request");
+                    result = __FAILURE__;
+                }
+                else if (generate_evp_certificate(evp_key, cert_type, common_name_prop_value,
+                                                  requested_validity, issuer_evp_key,
+                                                  issuer_certificate, issuer_certificate_file,
+                                                  cert_props_handle, serial_number, ca_path_len,
+                                                  cert_file_name, batch, &x509_cert) != 0)
+                {
+                    LOG_ERROR("Could not generate certificate create request");
+                    result = __FAILURE__;
+                }
+                else if (file_batch_commit(batch) != 0)
+                {
+                    LOG_ERROR("Could not save the certificate and private key files");
+                    result = __FAILURE__;
+                }
+                else
+                {
+                    result = 0;
+                }
+
+                if (x509_cert != NULL)
+                {
+                    X509_free(x509_cert);
+                }
+                if (evp_key != NULL)
+                {
+                    destroy_evp_key(evp_key);
+                }
+                file_batch_destroy(batch);
+            }
+        }
+    }
+
+    if (issuer_certificate != NULL)
+    {
+        X509_free(issuer_certificate);
+    }
+    if (issuer_evp_key != NULL)
+    {
+        destroy_evp_key(issuer_evp_key);
+    }
+
+    return result;
+}
+
+int generate_pki_cert_and_key_with_props
+(
+    CERT_PROPS_HANDLE cert_props_handle,
+    int serial_number,
+    int ca_path_len,
+    const char* key_file_name,
+    const char* cert_file_name,
+    const PKI_KEY_PROPS *key_props
+)
+{
+    int result;
+
+    if ((key_props == NULL) ||
+        ((key_props->key_type != HSM_PKI_KEY_EC) &&
+         (key_props->key_type != HSM_PKI_KEY_RSA)))
+    {
+        LOG_ERROR("Invalid PKI key properties");
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = generate_pki_cert_and_key_helper(cert_props_handle,
+                                                  serial_number,
+                                                  ca_path_len,
+                                                  key_file_name,
+                                                  cert_file_name,
+                                                  NULL,
+                                                  NULL,
+                                                  key_props);
+    }
+
+    return result;
+}
+
+int generate_pki_cert_and_key
+(
+    CERT_PROPS_HANDLE cert_props_handle,
+    int serial_number,
+    int ca_path_len,
+    const char* key_file_name,
+    const char* cert_file_name,
+    const char* issuer_key_file,
+    const char* issuer_certificate_file
+)
+{
+    return generate_pki_cert_and_key_helper(cert_props_handle,
+                                            serial_number,
+                                            ca_path_len,
+                                            key_file_name,
+                                            cert_file_name,
+                                            issuer_key_file,
+                                            issuer_certificate_file,
+                                            NULL);
+}
+
+KEY_HANDLE create_cert_key(const char* key_file_name)
+{
+    KEY_HANDLE result;
+    EVP_PKEY* evp_key;
+    CERT_KEY *cert_key;
+
+    if (key_file_name == NULL)
+    {
+        LOG_ERROR("Key file name cannot be NULL");
+        result = NULL;
+    }
+    else if ((evp_key = load_private_key_file(key_file_name)) == NULL)
+    {
+        LOG_ERROR("Could not load private key file %s", key_file_name);
+        result = NULL;
+    }
+    else if ((cert_key = (CERT_KEY*)malloc(sizeof(CERT_KEY))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for SAS_KEY");
+        destroy_evp_key(evp_key);
+        result = NULL;
+    }
+    else
+    {
+        cert_key->interface.hsm_client_key_sign = cert_key_sign;
+        cert_key->interface.hsm_client_key_derive_and_sign = cert_key_derive_and_sign;
+        cert_key->interface.hsm_client_key_encrypt = cert_key_encrypt;
+        cert_key->interface.hsm_client_key_decrypt = cert_key_decrypt;
+        cert_key->interface.hsm_client_key_destroy = cert_key_destroy;
+        cert_key->evp_key = evp_key;
+        result = (KEY_HANDLE)cert_key;
+    }
+    return result;
+}
+
+//#################################################################################################
+// PKI certificate verification
+//#################################################################################################
+static X509* load_certificate_buffer(const char *cert_data, size_t cert_data_size)
+{
+    X509* x509_cert;
+    BIO* cert_bio;
+
+    if (cert_data_size > INT_MAX)
+    {
+        LOG_ERROR("Certificate buffer too large");
+        x509_cert = NULL;
+    }
+    else if ((cert_bio = BIO_new_mem_buf((void*)cert_data, (int)cert_data_size)) == NULL)
+    {
+        LOG_ERROR("Failure to create BIO for certificate buffer");
+        x509_cert = NULL;
+    }
+    else
+    {
+        x509_cert = PEM_read_bio_X509(cert_bio, NULL, NULL, NULL);
+        if (x509_cert == NULL)
+        {
+            LOG_ERROR("Failure PEM_read_bio_X509 for certificate buffer");
+        }
+        BIO_free_all(cert_bio);
+    }
+
+    return x509_cert;
+}
+
+static X509_STORE* create_verification_store(const char *issuer_data, size_t issuer_data_size)
+{
+    X509_STORE *result;
+    BIO *issuer_bio;
+
+    if (issuer_data_size > INT_MAX)
+    {
+        LOG_ERROR("Issuer certificate buffer too large");
+        result = NULL;
+    }
+    else if ((result = X509_STORE_new()) == NULL)
+    {
+        LOG_ERROR("API X509_STORE_new failed");
+    }
+    else if ((issuer_bio = BIO_new_mem_buf((void*)issuer_data, (int)issuer_data_size)) == NULL)
+    {
+        LOG_ERROR("Failure to create BIO for issuer certificate buffer");
+        X509_STORE_free(result);
+        result = NULL;
+    }
+    else
+    {
+        X509 *issuer_cert;
+        size_t num_certs = 0;
+        bool add_failed = false;
+
+        while (!add_failed &&
+               ((issuer_cert = PEM_read_bio_X509(issuer_bio, NULL, NULL, NULL)) != NULL))
+        {
+            if (!X509_STORE_add_cert(result, issuer_cert))
+            {
+                LOG_ERROR("Could not add issuer certificate to X509 store");
+                add_failed = true;
+            }
+            else
+            {
+                num_certs++;
+            }
+            X509_free(issuer_cert);
+        }
+        // reading past the last PEM block queues a benign "no start line" error
+        ERR_clear_error();
+        BIO_free_all(issuer_bio);
+
+        if (add_failed)
+        {
+            X509_STORE_free(result);
+            result = NULL;
+        }
+        else if (num_certs == 0)
+        {
+            LOG_ERROR("No certificates found in issuer certificate buffer");
+            X509_STORE_free(result);
+            result = NULL;
+        }
+        else
+        {
+            X509_LOOKUP *lookup;
+
+            X509_STORE_set_flags(result, VERIFICATION_STORE_FLAGS);
+            // certificates missing from the issuer chain are looked up in the default CA directory
+            if ((lookup = X509_STORE_add_lookup(result, X509_LOOKUP_hash_dir())) == NULL)
+            {
+                LOG_ERROR("Setting up store lookup failed");
+                X509_STORE_free(result);
+                result = NULL;
+            }
+            else if (!X509_LOOKUP_add_dir(lookup, NULL, X509_FILETYPE_DEFAULT))
+            {
+                LOG_ERROR("Setting up store lookup failed");
+                X509_STORE_free(result);
+                result = NULL;
+            }
+        }
+    }
+
+    return result;
+}
+
+static int lock_verification_cache(void)
+{
+    int result;
+    LOCK_HANDLE lock = hsm_lock_get(&g_verification_cache_lock);
+#if defined(HSM_LOCK_PROFILING)
+    bool contended = (hsm_atomic_inc(&g_verification_cache_users) > 1);
+    uint64_t start = contended ? hsm_metrics_now() : 0;
+#endif
+
+    if (lock == NULL)
+    {
+        LOG_ERROR("Could not create the verification cache lock");
+        result = __FAILURE__;
+    }
+    else if (Lock(lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not acquire the verification cache lock");
+        result = __FAILURE__;
+    }
+    else
+    {
+#if defined(HSM_LOCK_PROFILING)
+        hsm_metrics_lock_wait(HSM_METRICS_LOCK_VERIFICATION_CACHE, start, contended);
+#endif
+        result = 0;
+    }
+
+#if defined(HSM_LOCK_PROFILING)
+    if (result != 0)
+    {
+        (void)hsm_atomic_dec(&g_verification_cache_users);
+    }
+#endif
+    return result;
+}
+
+static void unlock_verification_cache(void)
+{
+    if (Unlock(g_verification_cache_lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not release the verification cache lock");
+    }
+#if defined(HSM_LOCK_PROFILING)
+    (void)hsm_atomic_dec(&g_verification_cache_users);
+#endif
+}
+
+// returns a reference to the cached store for the issuer chain or NULL, the cache lock must be held
+static X509_STORE* find_verification_store(const char *issuer_data, size_t issuer_data_size)
+{
+    X509_STORE *result = NULL;
+    size_t idx;
+
+    for (idx = 0; idx < MAX_VERIFICATION_STORES; idx++)
+    {
+        VERIFICATION_STORE *entry = &g_verification_stores[idx];
+        if ((entry->store != NULL) &&
+            (entry->issuer_data_size == issuer_data_size) &&
+            (memcmp(entry->issuer_data, issuer_data, issuer_data_size) == 0))
+        {
+            if (!X509_STORE_up_ref(entry->store))
+            {
+                LOG_ERROR("Could not reference cached X509 store");
+            }
+            else
+            {
+                entry->last_used = ++g_verification_store_tick;
+                result = entry->store;
+            }
+            break;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Returns a reference to the cached X509 store built from the issuer certificate chain in
+ * issuer_data, building it on first use. The caller owns the reference and releases it with
+ * X509_STORE_free, so a store evicted by another thread stays usable until its last user is
+ * done with it. A change in the issuer chain contents results in a new store, the least
+ * recently used store is evicted when the cache is full.
+ */
+static X509_STORE* get_verification_store(const char *issuer_data, size_t issuer_data_size)
+{
+    X509_STORE *result;
+
+    // a cache which cannot be locked is treated as a miss
+    if (lock_verification_cache() != 0)
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = find_verification_store(issuer_data, issuer_data_size);
+        unlock_verification_cache();
+    }
+
+    hsm_metrics_cache_access(HSM_METRICS_CACHE_VERIFICATION_STORE, result != NULL);
+    if (result == NULL)
+    {
+        X509_STORE *store;
+        char *issuer_copy;
+
+        // the store is built without the lock held so that other verifications are not held up
+        if ((store = create_verification_store(issuer_data, issuer_data_size)) == NULL)
+        {
+            LOG_ERROR("Could not create X509 store for issuer certificate");
+        }
+        else if ((issuer_copy = (char*)malloc(issuer_data_size)) == NULL)
+        {
+            LOG_ERROR("Could not allocate memory to cache issuer certificate");
+            // the store is still good for this verification, it is just not cached
+            result = store;
+        }
+        else
+        {
+            X509_STORE *evicted_store = NULL;
+            char *evicted_data = NULL;
+
+            memcpy(issuer_copy, issuer_data, issuer_data_size);
+            if (lock_verification_cache() != 0)
+            {
+                // the store is still good for this verification, it is just not cached
+                free(issuer_copy);
+                result = store;
+            }
+            // another thread may have cached a store for the same chain in the meantime
+            else if ((result = find_verification_store(issuer_data, issuer_data_size)) != NULL)
+            {
+                evicted_store = store;
+                evicted_data = issuer_copy;
+                unlock_verification_cache();
+            }
+            else if (!X509_STORE_up_ref(store))
+            {
+                LOG_ERROR("Could not reference X509 store to cache it");
+                evicted_data = issuer_copy;
+                result = store;
+                unlock_verification_cache();
+            }
+            else
+            {
+                // pick an unused slot if there is one, else the least recently used one
+                VERIFICATION_STORE *entry = &g_verification_stores[0];
+                size_t idx;
+
+                for (idx = 1; (entry->store != NULL) && (idx < MAX_VERIFICATION_STORES); idx++)
+                {
+                    VERIFICATION_STORE *candidate = &g_verification_stores[idx];
+                    if ((candidate->store == NULL) || (candidate->last_used < entry->last_used))
+                    {
+                        entry = candidate;
+                    }
+                }
+                evicted_store = entry->store;
+                evicted_data = entry->issuer_data;
+                entry->issuer_data = issuer_copy;
+                entry->issuer_data_size = issuer_data_size;
+                entry->store = store;
+                entry->last_used = ++g_verification_store_tick;
+                result = store;
+                unlock_verification_cache();
+            }
+
+            // only the reference held by the cache is dropped, users of the store keep theirs
+            if (evicted_store != NULL)
+            {
+                X509_STORE_free(evicted_store);
+            }
+            if (evicted_data != NULL)
+            {
+                free(evicted_data);
+            }
+        }
+    }
+
+    return result;
+}
+
+static int check_certificates
+(
+    X509_STORE *store,
+    X509 *x509_cert,
+    const char *cert_desc,
+    const char *issuer_desc,
+    bool *verify_status
+)
+{
+    int result;
+    X509_STORE_CTX *store_ctxt = NULL;
+
+    if ((store_ctxt = X509_STORE_CTX_new()) == NULL)
+    {
+        LOG_ERROR("Could not create X509 store context");
+        result = __FAILURE__;
+    }
+    else
+    {
+        if(!X509_STORE_CTX_init(store_ctxt, store, x509_cert, 0))
+        {
+            LOG_ERROR("Could not initialize X509 store context");
+            result = __FAILURE__;
+        }
+        else
+        {
+            double exp_seconds = 0;
+            int status;
+            bool is_expired = true;
+
+            status = validate_certificate_expiration(x509_cert, &exp_seconds, &is_expired);
+            if (status != 0)
+            {
+                LOG_ERROR("Verifying certificate expiration failed for %s", cert_desc);
+                result = __FAILURE__;
+            }
+            else
+            {
+                if (is_expired)
+                {
+                    LOG_INFO("Certificate file has expired %s", cert_desc);
+                }
+                else if (validate_subject_keyid(x509_cert) != 0)
+                {
+                    // This check was added to ensure that all certificates and in particular CA
+                    // certificates contain the X509 V3 extension "Subject Key Identifier" (SKID).
+                    // As part of cert hardening, we ensure that all certificates when created have
+                    // the X509 V3 ext Authority Key Identifier (AKID) added. AKID requires
+                    // the SKID to be present or cert generation will fail.
+                    // This check essentially would fail any CA certs generated via quickstart
+                    // or transparent gateway that do not have a SKID set.
+                    LOG_ERROR("Certificate should contain a Subject Key Identifier extension %s",
+                              cert_desc);
+                }
+                else if ((status = X509_verify_cert(store_ctxt)) <= 0)
+                {
+                    const char *msg;
+                    int err_code = X509_STORE_CTX_get_error(store_ctxt);
+                    msg = X509_verify_cert_error_string(err_code);
+                    if (msg == NULL)
+                    {
+                        msg = "";
+                    }
+                    LOG_ERROR("Could not verify certificate %s using issuer certificate %s.",
+                              cert_desc, issuer_desc);
+                    LOG_ERROR("Verification status: %d, Error: %d, Msg: '%s'",
+                              status, err_code, msg);
+                }
+                else
+                {
+                    LOG_DEBUG("Certificate validated %s", cert_desc);
+                    *verify_status = true;
+                }
+                result = 0;
+            }
+        }
+        X509_STORE_CTX_free(store_ctxt);
+    }
+
+    return result;
+}
+
+static void check_private_key_match
+(
+    X509 *x509_cert,
+    const char *key_file,
+    const char *cert_desc,
+    bool *verify_status
+)
+{
+    EVP_PKEY *evp_key;
+
+    // a key that cannot be read or does not match fails the verification so
+    // that callers replace the certificate and key together
+    if ((evp_key = load_private_key_file(key_file)) == NULL)
+    {
+        LOG_ERROR("Could not load private key %s of certificate %s", key_file, cert_desc);
+        *verify_status = false;
+    }
+    else
+    {
+        if (X509_check_private_key(x509_cert, evp_key) != 1)
+        {
+            LOG_ERROR("Private key %s does not match certificate %s", key_file, cert_desc);
+            *verify_status = false;
+        }
+        EVP_PKEY_free(evp_key);
+    }
+}
+
+static int verify_certificate_with_store
+(
+    X509_STORE *store,
+    const char *cert_data,
+    size_t cert_data_size,
+    const char *key_file,
+    const char *cert_desc,
+    const char *issuer_desc,
+    bool *verify_status
+)
+{
+    int result;
+    X509 *x509_cert;
+
+    if ((x509_cert = load_certificate_buffer(cert_data, cert_data_size)) == NULL)
+    {
+        LOG_ERROR("Could not create X509 to verify certificate %s", cert_desc);
+        result = __FAILURE__;
+    }
+    else
+    {
+        LOG_DEBUG("Verifying %s using %s", cert_desc, issuer_desc);
+        result = check_certificates(store, x509_cert, cert_desc, issuer_desc, verify_status);
+        if ((result == 0) && *verify_status && (key_file != NULL))
+        {
+            check_private_key_match(x509_cert, key_file, cert_desc, verify_status);
+        }
+        X509_free(x509_cert);
+    }
+
+    return result;
+}
+
+static int verify_certificate_data
+(
+    const char *cert_data,
+    size_t cert_data_size,
+    const char *issuer_data,
+    size_t issuer_data_size,
+    const char *cert_desc,
+    const char *issuer_desc,
+    bool *verify_status
+)
+{
+    int result;
+    X509_STORE *store;
+    uint64_t start = hsm_metrics_start();
+    HSM_TRACE_SCOPE trace;
+
+    HSM_TRACE_BEGIN(&trace, "pki.verify_certificate", cert_desc, cert_data_size);
+    if ((store = get_verification_store(issuer_data, issuer_data_size)) == NULL)
+    {
+        LOG_ERROR("Could not obtain X509 store for issuer certificate %s", issuer_desc);
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = verify_certificate_with_store(store, cert_data, cert_data_size, NULL,
+                                               cert_desc, issuer_desc, verify_status);
+        X509_STORE_free(store);
+    }
+    hsm_metrics_record(HSM_METRICS_PKI_VERIFY_CERTIFICATE, start, result != 0);
+    HSM_TRACE_END(&trace, 0, result);
+
+    return result;
+}
+
+static int verify_certificate_internal
+(
+    const char *certificate,
+    const char *issuer_certificate,
+    bool *verify_status
+)
+{
+    int result;
+    char *cert_data = NULL;
+    char *issuer_data = NULL;
+
+    initialize_openssl();
+
+    if ((cert_data = read_file_into_cstring(certificate, NULL)) == NULL)
+    {
+        LOG_ERROR("Could not read certificate %s", certificate);
+        result = __FAILURE__;
+    }
+    else if ((issuer_data = read_file_into_cstring(issuer_certificate, NULL)) == NULL)
+    {
+        LOG_ERROR("Could not read issuer certificate %s", issuer_certificate);
+        result = __FAILURE__;
+    }
+    else if (strstr(cert_data, issuer_data) == NULL)
+    {
+        LOG_ERROR("Certificate file does not contain issuer certificate %s", certificate);
+        result = 0;
+    }
+    else
+    {
+        result = verify_certificate_data(cert_data, strlen(cert_data),
+                                         issuer_data, strlen(issuer_data),
+                                         certificate, issuer_certificate,
+                                         verify_status);
+    }
+
+    if (cert_data != NULL)
+    {
+        free(cert_data);
+    }
+
+    if (issuer_data != NULL)
+    {
+        free(issuer_data);
+    }
+
+    return result;
+}
+
+int verify_certificate
+(
+    const char *certificate_file_path,
+    const char *key_file_path,
+    const char *issuer_certificate_file_path,
+    bool *verify_status
+)
+{
+    int result;
+
+    if (verify_status == NULL)
+    {
+        LOG_ERROR("Invalid verify_status parameter");
+        result = __FAILURE__;
+    }
+    else
+    {
+        *verify_status = false;
+        if ((certificate_file_path == NULL) ||
+            (key_file_path == NULL) ||
+            (issuer_certificate_file_path == NULL))
+        {
+            LOG_ERROR("Invalid parameters");
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = verify_certificate_internal(certificate_file_path,
+                                                 issuer_certificate_file_path,
+                                                 verify_status);
+        }
+    }
+
+    return result;
+}
+
+int verify_certificate_buffer
+(
+    const char *certificate,
+    size_t certificate_size,
+    const char *issuer_certificate,
+    size_t issuer_certificate_size,
+    bool *verify_status
+)
+{
+    int result;
+
+    if (verify_status == NULL)
+    {
+        LOG_ERROR("Invalid verify_status parameter");
+        result = __FAILURE__;
+    }
+    else
+    {
+        *verify_status = false;
+        if ((certificate == NULL) ||
+            (certificate_size == 0) ||
+            (issuer_certificate == NULL) ||
+            (issuer_certificate_size == 0))
+        {
+            LOG_ERROR("Invalid parameters");
+            result = __FAILURE__;
+        }
+        else
+        {
+            initialize_openssl();
+            result = verify_certificate_data(certificate, certificate_size,
+                                             issuer_certificate, issuer_certificate_size,
+                                             "<certificate buffer>", "<issuer buffer>",
+                                             verify_status);
+        }
+    }
+
+    return result;
+}
+
+static bool is_certificate_chain(const char *issuer_data, size_t issuer_data_size)
+{
+    bool result = true;
+    BIO *issuer_bio;
+
+    // a chain lists each certificate before its issuer, a trust bundle holds
+    // unrelated roots; data which cannot be parsed is treated as a chain
+    if ((issuer_data_size <= INT_MAX) &&
+        ((issuer_bio = BIO_new_mem_buf((void*)issuer_data, (int)issuer_data_size)) != NULL))
+    {
+        X509 *previous = NULL;
+        X509 *issuer_cert;
+
+        while (result &&
+               ((issuer_cert = PEM_read_bio_X509(issuer_bio, NULL, NULL, NULL)) != NULL))
+        {
+            if (previous != NULL)
+            {
+                if (X509_check_issued(issuer_cert, previous) != X509_V_OK)
+                {
+                    result = false;
+                }
+                X509_free(previous);
+            }
+            previous = issuer_cert;
+        }
+        if (previous != NULL)
+        {
+            X509_free(previous);
+        }
+        // reading past the last PEM block queues a benign "no start line" error
+        ERR_clear_error();
+        BIO_free_all(issuer_bio);
+    }
+
+    return result;
+}
+
+static int verify_batch_certificate(VERIFICATION_BATCH *batch, size_t index)
+{
+    int result;
+    char *cert_data;
+    const char *cert_file = batch->certificate_files[index];
+    const char *key_file = (batch->key_files != NULL) ? batch->key_files[index] : NULL;
+
+    if (cert_file == NULL)
+    {
+        LOG_ERROR("Invalid certificate file at index %zu", index);
+        result = __FAILURE__;
+    }
+    else if ((cert_data = read_file_into_cstring(cert_file, NULL)) == NULL)
+    {
+        LOG_ERROR("Could not read certificate %s", cert_file);
+        result = __FAILURE__;
+    }
+    else
+    {
+        if (batch->issuer_is_chain && (strstr(cert_data, batch->issuer_data) == NULL))
+        {
+            LOG_ERROR("Certificate file does not contain issuer certificate %s", cert_file);
+            result = 0;
+        }
+        else
+        {
+            uint64_t start = hsm_metrics_start();
+            size_t cert_data_size = strlen(cert_data);
+            HSM_TRACE_SCOPE trace;
+
+            HSM_TRACE_BEGIN_CHILD(&trace, batch->trace_parent, "pki.verify_certificate", cert_file, cert_data_size);
+            result = verify_certificate_with_store(batch->store, cert_data, cert_data_size,
+                                                   key_file, cert_file, batch->issuer_certificate,
+                                                   &batch->verify_status[index]);
+            hsm_metrics_record(HSM_METRICS_PKI_VERIFY_CERTIFICATE, start, result != 0);
+            HSM_TRACE_END(&trace, 0, result);
+        }
+        free(cert_data);
+    }
+
+    return result;
+}
+
+static int verify_batch_worker(void *context)
+{
+    VERIFICATION_BATCH *batch = (VERIFICATION_BATCH*)context;
+    long index;
+
+    // workers claim certificates one at a time so that slow ones do not stall a whole thread
+    while ((index = hsm_atomic_inc(&batch->next_index) - 1) < (long)batch->num_certificates)
+    {
+        if (verify_batch_certificate(batch, (size_t)index) != 0)
+        {
+            (void)hsm_atomic_inc(&batch->num_errors);
+        }
+    }
+
+    return 0;
+}
+
+static void run_verification_batch(VERIFICATION_BATCH *batch, size_t max_threads)
+{
+    THREAD_HANDLE threads[MAX_VERIFICATION_THREADS - 1];
+    size_t num_threads = 0;
+    size_t num_workers = max_threads;
+    size_t idx;
+
+    if (num_workers > batch->num_certificates)
+    {
+        num_workers = batch->num_certificates;
+    }
+    if (num_workers > MAX_VERIFICATION_THREADS)
+    {
+        num_workers = MAX_VERIFICATION_THREADS;
+    }
+
+    // the calling thread is one of the workers, failing to start a helper thread
+    // only means the remaining work is shared by fewer threads
+    while (num_threads + 1 < num_workers)
+    {
+        if (ThreadAPI_Create(&threads[num_threads], verify_batch_worker, batch) != THREADAPI_OK)
+        {
+            LOG_ERROR("Could not create certificate verification thread");
+            break;
+        }
+        num_threads++;
+    }
+
+    (void)verify_batch_worker(batch);
+
+    for (idx = 0; idx < num_threads; idx++)
+    {
+        int thread_result;
+        if (ThreadAPI_Join(threads[idx], &thread_result) != THREADAPI_OK)
+        {
+            LOG_ERROR("Could not join certificate verification thread");
+        }
+    }
+}
+
+int verify_certificates
+(
+    const char * const *certificate_file_paths,
+    const char * const *key_file_paths,
+    size_t num_certificates,
+    const char *issuer_certificate_file_path,
+    bool *verify_status,
+    size_t max_threads
+)
+{
+    int result;
+    char *issuer_data;
+    X509_STORE *store;
+
+    if ((certificate_file_paths == NULL) ||
+        (num_certificates == 0) ||
+        (issuer_certificate_file_path == NULL) ||
+        (verify_status == NULL) ||
+        (max_threads == 0))
+    {
+        LOG_ERROR("Invalid parameters");
+        result = __FAILURE__;
+    }
+    else
+    {
+        memset(verify_status, 0, num_certificates * sizeof(bool));
+
+        initialize_openssl();
+
+        if ((issuer_data = read_file_into_cstring(issuer_certificate_file_path, NULL)) == NULL)
+        {
+            LOG_ERROR("Could not read issuer certificate %s", issuer_certificate_file_path);
+            result = __FAILURE__;
+        }
+        else
+        {
+            if ((store = get_verification_store(issuer_data, strlen(issuer_data))) == NULL)
+            {
+                LOG_ERROR("Could not obtain X509 store for issuer certificate %s",
+                          issuer_certificate_file_path);
+                result = __FAILURE__;
+            }
+            else
+            {
+                VERIFICATION_BATCH batch;
+
+                batch.store = store;
+                batch.certificate_files = certificate_file_paths;
+                batch.key_files = key_file_paths;
+                batch.num_certificates = num_certificates;
+                batch.issuer_certificate = issuer_certificate_file_path;
+                batch.issuer_data = issuer_data;
+                batch.issuer_is_chain = is_certificate_chain(issuer_data, strlen(issuer_data));
+                batch.verify_status = verify_status;
+                batch.next_index = 0;
+                batch.num_errors = 0;
+                batch.trace_parent = hsm_trace_current_span();
+
+                run_verification_batch(&batch, max_threads);
+                X509_STORE_free(store);
+
+                if (batch.num_errors != 0)
+                {
+                    LOG_ERROR("Failed verifying %ld of %zu certificates",
+                              (long)batch.num_errors, num_certificates);
+                    result = __FAILURE__;
+                }
+                else
+                {
+                    result = 0;
+                }
+            }
+            free(issuer_data);
+        }
+    }
+
+    return result;
+}
+
+void clear_certificate_verification_cache(void)
+{
+    VERIFICATION_STORE entries[MAX_VERIFICATION_STORES];
+    size_t idx;
+
+    // entries are detached under the lock and released after it, verifications
+    // still using one of the stores hold their own reference to it
+    if (lock_verification_cache() == 0)
+    {
+        memcpy(entries, g_verification_stores, sizeof(entries));
+        memset(g_verification_stores, 0, sizeof(g_verification_stores));
+        g_verification_store_tick = 0;
+        unlock_verification_cache();
+
+        for (idx = 0; idx < MAX_VERIFICATION_STORES; idx++)
+        {
+            if (entries[idx].store != NULL)
+            {
+                X509_STORE_free(entries[idx].store);
+                free(entries[idx].issuer_data);
+            }
+        }
+    }
+}
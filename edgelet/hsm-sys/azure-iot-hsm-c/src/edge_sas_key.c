@@ -3,6 +3,7 @@
 #include "azure_c_shared_utility/gballoc.h"
 #include "edge_sas_perform_sign_with_key.h"
 #include "hsm_key.h"
+#include "hsm_key_mem.h"
 #include "hsm_log.h"
 
 struct SAS_KEY_TAG
@@ -71,6 +72,7 @@ int sas_key_derive_and_sign
         {
             LOG_ERROR("Error signing payload for identity %s", identity);
         }
+        hsm_key_mem_cleanse(derived_key, derived_key_size);
         free(derived_key);
     }
     return result;
@@ -117,9 +119,9 @@ void sas_key_destroy(KEY_HANDLE key_handle)
     {
         if (sas_key->key != NULL)
         {
-            free(sas_key->key);
+            hsm_key_mem_free(sas_key->key, sas_key->key_len);
         }
-        free(sas_key);
+        hsm_key_mem_free(sas_key, sizeof(SAS_KEY));
     }
 }
 
@@ -133,15 +135,15 @@ KEY_HANDLE create_sas_key(const unsigned char* key, size_t key_len)
     }
     else
     {
-        sas_key = (SAS_KEY*)malloc(sizeof(SAS_KEY));
+        sas_key = (SAS_KEY*)hsm_key_mem_alloc(sizeof(SAS_KEY));
         if (sas_key == NULL)
         {
             LOG_ERROR("Could not allocate memory for SAS_KEY");
         }
-        else if ((sas_key->key = (unsigned char*)malloc(key_len)) == NULL)
+        else if ((sas_key->key = (unsigned char*)hsm_key_mem_alloc(key_len)) == NULL)
         {
             LOG_ERROR("Could not allocate memory for sas key creation");
-            free(sas_key);
+            hsm_key_mem_free(sas_key, sizeof(SAS_KEY));
             sas_key = NULL;
         }
         else
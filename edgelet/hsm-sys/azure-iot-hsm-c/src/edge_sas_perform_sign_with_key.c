@@ -5,7 +5,9 @@
 #include "azure_c_shared_utility/hmacsha256.h"
 #include "azure_c_shared_utility/macro_utils.h"
 
+#include "hsm_key_mem.h"
 #include "hsm_log.h"
+#include "hsm_trace.h"
 
 int perform_sign_with_key
 (
@@ -19,7 +21,9 @@ int perform_sign_with_key
 {
     int result;
     BUFFER_HANDLE signed_payload_handle;
+    HSM_TRACE_SCOPE trace;
 
+    HSM_TRACE_BEGIN(&trace, "key.sign", NULL, data_to_be_signed_size);
     if ((signed_payload_handle = BUFFER_new()) == NULL)
     {
         LOG_ERROR("Error allocating new buffer handle");
@@ -46,20 +50,26 @@ int perform_sign_with_key
             LOG_ERROR("Error obtaining underlying uchar buffer");
             result =  __FAILURE__;
         }
-        else if ((result_digest = (unsigned char*)malloc(signed_payload_size)) == NULL)
-        {
-            LOG_ERROR("Error allocating memory for digest");
-            result =  __FAILURE__;
-        }
         else
         {
-            memcpy(result_digest, src_digest, signed_payload_size);
-            *digest = result_digest;
-            *digest_size = signed_payload_size;
-            result = 0;
+            if ((result_digest = (unsigned char*)malloc(signed_payload_size)) == NULL)
+            {
+                LOG_ERROR("Error allocating memory for digest");
+                result =  __FAILURE__;
+            }
+            else
+            {
+                memcpy(result_digest, src_digest, signed_payload_size);
+                *digest = result_digest;
+                *digest_size = signed_payload_size;
+                result = 0;
+            }
+            // the signature may be a derived key
+            hsm_key_mem_cleanse(src_digest, signed_payload_size);
         }
         BUFFER_delete(signed_payload_handle);
     }
+    HSM_TRACE_END(&trace, (result == 0) ? *digest_size : 0, result);
     return result;
 }
 
@@ -0,0 +1,159 @@
+#if defined __linux__ && !defined _GNU_SOURCE
+    // for malloc_usable_size with strict C standard flags
+    #define _GNU_SOURCE
+#endif
+
+#include <malloc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "hsm_alloc.h"
+
+#define HSM_THREAD_LOCAL __thread
+
+//##############################################################################
+// Data types
+//##############################################################################
+// scopes nested deeper than this count nothing, their allocations are still
+// counted by the scopes enclosing them
+#define MAX_ALLOC_SCOPES 16
+
+// allocation state when a scope began
+struct ALLOC_SCOPE_TAG
+{
+    uint64_t allocations;
+    uint64_t allocated_bytes;
+    int64_t live_bytes;
+    int64_t enclosing_peak_bytes;
+};
+typedef struct ALLOC_SCOPE_TAG ALLOC_SCOPE;
+
+// allocations made by a single thread. Blocks freed by another thread than
+// the one that allocated them make live bytes drift, which does not change
+// how far they rise within a scope.
+struct ALLOC_STATE_TAG
+{
+    uint64_t allocations;
+    uint64_t allocated_bytes;
+    int64_t live_bytes;
+    int64_t peak_bytes;
+    size_t depth;
+    ALLOC_SCOPE scopes[MAX_ALLOC_SCOPES];
+};
+typedef struct ALLOC_STATE_TAG ALLOC_STATE;
+
+static HSM_THREAD_LOCAL ALLOC_STATE g_alloc_state;
+
+//##############################################################################
+// Wrapped allocator
+//##############################################################################
+extern void* __real_malloc(size_t size);
+extern void* __real_calloc(size_t num, size_t size);
+extern void* __real_realloc(void* ptr, size_t size);
+extern void __real_free(void* ptr);
+
+extern void* __wrap_malloc(size_t size);
+extern void* __wrap_calloc(size_t num, size_t size);
+extern void* __wrap_realloc(void* ptr, size_t size);
+extern void __wrap_free(void* ptr);
+
+static void count_allocation(void *ptr, size_t size)
+{
+    if (ptr != NULL)
+    {
+        ALLOC_STATE *state = &g_alloc_state;
+        state->allocations++;
+        state->allocated_bytes += size;
+        state->live_bytes += (int64_t)malloc_usable_size(ptr);
+        if (state->live_bytes > state->peak_bytes)
+        {
+            state->peak_bytes = state->live_bytes;
+        }
+    }
+}
+
+void* __wrap_malloc(size_t size)
+{
+    void *result = __real_malloc(size);
+    count_allocation(result, size);
+    return result;
+}
+
+void* __wrap_calloc(size_t num, size_t size)
+{
+    void *result = __real_calloc(num, size);
+    count_allocation(result, num * size);
+    return result;
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    int64_t previous = (ptr != NULL) ? (int64_t)malloc_usable_size(ptr) : 0;
+    void *result = __real_realloc(ptr, size);
+
+    // a failed realloc leaves the block as it was, unless it was resized to 0
+    if ((result != NULL) || (size == 0))
+    {
+        g_alloc_state.live_bytes -= previous;
+        count_allocation(result, size);
+    }
+    return result;
+}
+
+void __wrap_free(void* ptr)
+{
+    if (ptr != NULL)
+    {
+        g_alloc_state.live_bytes -= (int64_t)malloc_usable_size(ptr);
+    }
+    __real_free(ptr);
+}
+
+//##############################################################################
+// Scopes
+//##############################################################################
+void hsm_alloc_begin_scope(void)
+{
+    ALLOC_STATE *state = &g_alloc_state;
+
+    if (state->depth < MAX_ALLOC_SCOPES)
+    {
+        ALLOC_SCOPE *scope = &state->scopes[state->depth];
+        scope->allocations = state->allocations;
+        scope->allocated_bytes = state->allocated_bytes;
+        scope->live_bytes = state->live_bytes;
+        scope->enclosing_peak_bytes = state->peak_bytes;
+        // the peak of this scope starts from what is held now
+        state->peak_bytes = state->live_bytes;
+    }
+    state->depth++;
+}
+
+void hsm_alloc_end_scope(HSM_ALLOC_USAGE* usage)
+{
+    ALLOC_STATE *state = &g_alloc_state;
+
+    usage->allocations = 0;
+    usage->allocated_bytes = 0;
+    usage->peak_bytes = 0;
+    if (state->depth > 0)
+    {
+        state->depth--;
+        if (state->depth < MAX_ALLOC_SCOPES)
+        {
+            ALLOC_SCOPE *scope = &state->scopes[state->depth];
+            usage->allocations = state->allocations - scope->allocations;
+            usage->allocated_bytes = state->allocated_bytes - scope->allocated_bytes;
+            if (state->peak_bytes > scope->live_bytes)
+            {
+                usage->peak_bytes = (uint64_t)(state->peak_bytes - scope->live_bytes);
+            }
+            // the enclosing scope also saw the peak of this one
+            if (scope->enclosing_peak_bytes > state->peak_bytes)
+            {
+                state->peak_bytes = scope->enclosing_peak_bytes;
+            }
+        }
+    }
+}
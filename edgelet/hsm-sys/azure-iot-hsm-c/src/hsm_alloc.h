@@ -0,0 +1,39 @@
+#ifndef HSM_ALLOC_H
+#define HSM_ALLOC_H
+
+#ifdef __cplusplus
+#include <cstdint>
+extern "C" {
+#else
+#include <stdint.h>
+#endif
+
+/**
+ * Allocation accounting, only built on Linux with HSM_ALLOC_ACCOUNTING.
+ *
+ * The library is linked with --wrap for malloc, calloc, realloc and free so
+ * that every call the library and the shared utilities linked into it make
+ * to them is counted for the calling thread. Static consumers of the library
+ * must link with the same flags, otherwise nothing is counted.
+ *
+ * Scopes count the allocations made between their beginning and their end
+ * and nest, so allocations of an inner scope are also counted by the scopes
+ * enclosing it. Scopes must end on the thread that began them, in reverse
+ * order.
+ */
+typedef struct HSM_ALLOC_USAGE_TAG
+{
+    uint64_t allocations;
+    uint64_t allocated_bytes;
+    // the most memory held above what was held when the scope began
+    uint64_t peak_bytes;
+} HSM_ALLOC_USAGE;
+
+extern void hsm_alloc_begin_scope(void);
+extern void hsm_alloc_end_scope(HSM_ALLOC_USAGE* usage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_ALLOC_H
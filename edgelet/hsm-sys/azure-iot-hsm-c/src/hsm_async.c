@@ -0,0 +1,823 @@
+#if defined __linux__ && !defined _GNU_SOURCE
+    // for eventfd and write with strict C standard flags
+    #define _GNU_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "hsm_client_data.h"
+#include "hsm_log.h"
+
+#if defined __linux__
+    #include <sys/eventfd.h>
+    #include <unistd.h>
+#endif
+
+//##############################################################################
+// Data types
+//##############################################################################
+#define HSM_ASYNC_DEFAULT_THREADS 4
+#define HSM_ASYNC_MAX_THREADS 16
+
+typedef enum ASYNC_OPERATION_TAG
+{
+    ASYNC_CREATE_CERTIFICATE,
+    ASYNC_ENCRYPT_DATA,
+    ASYNC_DECRYPT_DATA,
+    ASYNC_SIGN_WITH_IDENTITY,
+    ASYNC_DERIVE_AND_SIGN_WITH_IDENTITY
+} ASYNC_OPERATION;
+
+typedef enum TICKET_STATE_TAG
+{
+    TICKET_QUEUED,
+    TICKET_RUNNING,
+    TICKET_COMPLETE
+} TICKET_STATE;
+
+struct HSM_ASYNC_TICKET_TAG
+{
+    ASYNC_OPERATION operation;
+    HSM_CLIENT_HANDLE handle;
+    CERT_PROPS_HANDLE certificate_props;
+    // copies of the inputs, stored right after the ticket
+    SIZED_BUFFER identity;
+    SIZED_BUFFER data;
+    SIZED_BUFFER init_vector;
+    HSM_ASYNC_CALLBACK callback;
+    void *context;
+    // the fields below are protected by the executor lock, the result is
+    // only written by the thread running the operation
+    TICKET_STATE state;
+    bool cancelled;
+    // set while the callback runs, a ticket released meanwhile is destroyed
+    // once the callback returns
+    bool notifying;
+    bool released;
+    // only created when a thread waits for the operation
+    COND_HANDLE complete_cond;
+    HSM_ASYNC_RESULT result;
+    struct HSM_ASYNC_TICKET_TAG *next;
+};
+
+typedef struct EXECUTOR_TAG
+{
+    bool initialized;
+    bool stopping;
+    LOCK_HANDLE lock;
+    COND_HANDLE work_cond;
+    // queued operations, run in submit order
+    HSM_ASYNC_TICKET head;
+    HSM_ASYNC_TICKET tail;
+    THREAD_HANDLE threads[HSM_ASYNC_MAX_THREADS];
+    size_t num_threads;
+    int event_fd;
+} EXECUTOR;
+
+static EXECUTOR g_executor = { false, false, NULL, NULL, NULL, NULL, { NULL }, 0, -1 };
+
+//##############################################################################
+// Tickets
+//##############################################################################
+static int add_input_size(size_t *total_size, const unsigned char *buffer, size_t size)
+{
+    int result;
+
+    if ((buffer == NULL) && (size != 0))
+    {
+        LOG_ERROR("Invalid input buffer");
+        result = __FAILURE__;
+    }
+    else if (size > SIZE_MAX - *total_size)
+    {
+        LOG_ERROR("Input sizes overflow");
+        result = __FAILURE__;
+    }
+    else
+    {
+        *total_size += size;
+        result = 0;
+    }
+
+    return result;
+}
+
+static void copy_input(SIZED_BUFFER *input, const unsigned char *buffer, size_t size, unsigned char **cursor)
+{
+    input->size = size;
+    if (buffer == NULL)
+    {
+        // left NULL so that the operation validates it as it would the caller's
+        input->buffer = NULL;
+    }
+    else
+    {
+        memcpy(*cursor, buffer, size);
+        input->buffer = *cursor;
+        *cursor += size;
+    }
+}
+
+static HSM_ASYNC_TICKET create_ticket
+(
+    ASYNC_OPERATION operation,
+    HSM_CLIENT_HANDLE handle,
+    const SIZED_BUFFER *identity,
+    const SIZED_BUFFER *data,
+    const SIZED_BUFFER *init_vector,
+    HSM_ASYNC_CALLBACK callback,
+    void *context
+)
+{
+    HSM_ASYNC_TICKET result;
+    size_t total_size = sizeof(*result);
+
+    if (handle == NULL)
+    {
+        LOG_ERROR("Invalid client handle");
+        result = NULL;
+    }
+    else if ((add_input_size(&total_size, identity->buffer, identity->size) != 0) ||
+             (add_input_size(&total_size, data->buffer, data->size) != 0) ||
+             (add_input_size(&total_size, init_vector->buffer, init_vector->size) != 0))
+    {
+        result = NULL;
+    }
+    else if ((result = (HSM_ASYNC_TICKET)calloc(1, total_size)) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for async operation");
+    }
+    else
+    {
+        unsigned char *cursor = (unsigned char*)(result + 1);
+
+        result->operation = operation;
+        result->handle = handle;
+        copy_input(&result->identity, identity->buffer, identity->size, &cursor);
+        copy_input(&result->data, data->buffer, data->size, &cursor);
+        copy_input(&result->init_vector, init_vector->buffer, init_vector->size, &cursor);
+        result->callback = callback;
+        result->context = context;
+        result->state = TICKET_QUEUED;
+    }
+
+    return result;
+}
+
+static bool is_crypto_operation(ASYNC_OPERATION operation)
+{
+    return (operation == ASYNC_CREATE_CERTIFICATE) ||
+           (operation == ASYNC_ENCRYPT_DATA) ||
+           (operation == ASYNC_DECRYPT_DATA);
+}
+
+static void free_outputs(HSM_ASYNC_TICKET ticket)
+{
+    if (ticket->result.certificate != NULL)
+    {
+        certificate_info_destroy(ticket->result.certificate);
+    }
+    if (ticket->result.output.buffer != NULL)
+    {
+        if (is_crypto_operation(ticket->operation))
+        {
+            hsm_client_crypto_interface()->hsm_client_free_buffer(ticket->result.output.buffer);
+        }
+        else
+        {
+            hsm_client_tpm_interface()->hsm_client_free_buffer(ticket->result.output.buffer);
+        }
+    }
+}
+
+static void destroy_ticket(HSM_ASYNC_TICKET ticket)
+{
+    if (ticket->certificate_props != NULL)
+    {
+        cert_properties_destroy(ticket->certificate_props);
+    }
+    if (ticket->complete_cond != NULL)
+    {
+        Condition_Deinit(ticket->complete_cond);
+    }
+    free(ticket);
+}
+
+static void run_ticket(HSM_ASYNC_TICKET ticket)
+{
+    HSM_ASYNC_RESULT *result = &ticket->result;
+
+    if (is_crypto_operation(ticket->operation))
+    {
+        const HSM_CLIENT_CRYPTO_INTERFACE *crypto_if = hsm_client_crypto_interface();
+
+        if (ticket->operation == ASYNC_CREATE_CERTIFICATE)
+        {
+            result->certificate = crypto_if->hsm_client_create_certificate(ticket->handle,
+                                                                          ticket->certificate_props);
+            result->result = (result->certificate != NULL) ? 0 : __FAILURE__;
+            cert_properties_destroy(ticket->certificate_props);
+            ticket->certificate_props = NULL;
+        }
+        else if (ticket->operation == ASYNC_ENCRYPT_DATA)
+        {
+            result->result = crypto_if->hsm_client_encrypt_data(ticket->handle, &ticket->identity, &ticket->data,
+                                                                &ticket->init_vector, &result->output);
+        }
+        else
+        {
+            result->result = crypto_if->hsm_client_decrypt_data(ticket->handle, &ticket->identity, &ticket->data,
+                                                                &ticket->init_vector, &result->output);
+        }
+    }
+    else
+    {
+        const HSM_CLIENT_TPM_INTERFACE *tpm_if = hsm_client_tpm_interface();
+
+        if (ticket->operation == ASYNC_SIGN_WITH_IDENTITY)
+        {
+            result->result = tpm_if->hsm_client_sign_with_identity(ticket->handle, ticket->data.buffer,
+                                                                   ticket->data.size, &result->output.buffer,
+                                                                   &result->output.size);
+        }
+        else
+        {
+            result->result = tpm_if->hsm_client_derive_and_sign_with_identity(ticket->handle, ticket->data.buffer,
+                                                                              ticket->data.size,
+                                                                              ticket->identity.buffer,
+                                                                              ticket->identity.size,
+                                                                              &result->output.buffer,
+                                                                              &result->output.size);
+        }
+    }
+}
+
+//##############################################################################
+// Executor
+//##############################################################################
+static void signal_completion(void)
+{
+#if defined __linux__
+    uint64_t count = 1;
+    if (write(g_executor.event_fd, &count, sizeof(count)) != (ssize_t)sizeof(count))
+    {
+        LOG_ERROR("Could not signal async completion");
+    }
+#endif
+}
+
+// returns the next queued operation, NULL once the executor is stopping and
+// every queued operation has been taken. Operations cancelled while queued are
+// returned too, with run set to false, so that they are completed like others.
+static HSM_ASYNC_TICKET take_ticket(bool *run)
+{
+    HSM_ASYNC_TICKET result = NULL;
+
+    if (Lock(g_executor.lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not acquire async executor lock");
+    }
+    else
+    {
+        bool done = false;
+
+        while (!done)
+        {
+            if (g_executor.head != NULL)
+            {
+                HSM_ASYNC_TICKET ticket = g_executor.head;
+
+                g_executor.head = ticket->next;
+                if (g_executor.head == NULL)
+                {
+                    g_executor.tail = NULL;
+                }
+                ticket->state = TICKET_RUNNING;
+                *run = !ticket->cancelled;
+                result = ticket;
+                done = true;
+            }
+            else if (g_executor.stopping)
+            {
+                done = true;
+            }
+            else if (Condition_Wait(g_executor.work_cond, g_executor.lock, 0) != COND_OK)
+            {
+                LOG_ERROR("Could not wait for async operations");
+                done = true;
+            }
+        }
+        (void)Unlock(g_executor.lock);
+    }
+
+    return result;
+}
+
+static void complete_ticket(HSM_ASYNC_TICKET ticket)
+{
+    bool cancelled = true;
+    HSM_ASYNC_CALLBACK callback = ticket->callback;
+    void *context = ticket->context;
+
+    if (Lock(g_executor.lock) != LOCK_OK)
+    {
+        // waiters would never wake up, so the operation is reported as is
+        LOG_ERROR("Could not acquire async executor lock");
+        ticket->state = TICKET_COMPLETE;
+        cancelled = false;
+        signal_completion();
+    }
+    else
+    {
+        cancelled = ticket->cancelled;
+        if (!cancelled)
+        {
+            ticket->state = TICKET_COMPLETE;
+            ticket->notifying = (callback != NULL);
+            if (ticket->complete_cond != NULL)
+            {
+                (void)Condition_Post(ticket->complete_cond);
+            }
+        }
+        // signalled under the lock, so that a completion is counted by the
+        // time a waiter sees it and is visible by the time a poller wakes up
+        signal_completion();
+        (void)Unlock(g_executor.lock);
+    }
+
+    // the ticket belongs to the caller again unless it was cancelled, the
+    // callback of a cancelled operation gets a NULL ticket so that its context
+    // can be released
+    if (cancelled)
+    {
+        free_outputs(ticket);
+        destroy_ticket(ticket);
+        if (callback != NULL)
+        {
+            callback(NULL, context);
+        }
+    }
+    else if (callback != NULL)
+    {
+        bool released = false;
+
+        callback(ticket, context);
+        if (Lock(g_executor.lock) != LOCK_OK)
+        {
+            LOG_ERROR("Could not acquire async executor lock");
+        }
+        else
+        {
+            ticket->notifying = false;
+            released = ticket->released;
+            cancelled = ticket->cancelled;
+            (void)Unlock(g_executor.lock);
+        }
+        if (released)
+        {
+            if (cancelled)
+            {
+                free_outputs(ticket);
+            }
+            destroy_ticket(ticket);
+        }
+    }
+}
+
+static int executor_thread(void *context)
+{
+    HSM_ASYNC_TICKET ticket;
+    bool run = false;
+
+    (void)context;
+    while ((ticket = take_ticket(&run)) != NULL)
+    {
+        if (run)
+        {
+            run_ticket(ticket);
+        }
+        complete_ticket(ticket);
+    }
+
+    return 0;
+}
+
+static HSM_ASYNC_TICKET submit_ticket(HSM_ASYNC_TICKET ticket)
+{
+    HSM_ASYNC_TICKET result;
+
+    if (!g_executor.initialized)
+    {
+        LOG_ERROR("hsm_async_init not called");
+        destroy_ticket(ticket);
+        result = NULL;
+    }
+    else if (Lock(g_executor.lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not acquire async executor lock");
+        destroy_ticket(ticket);
+        result = NULL;
+    }
+    else
+    {
+        if (g_executor.tail != NULL)
+        {
+            g_executor.tail->next = ticket;
+        }
+        else
+        {
+            g_executor.head = ticket;
+        }
+        g_executor.tail = ticket;
+        (void)Condition_Post(g_executor.work_cond);
+        (void)Unlock(g_executor.lock);
+        result = ticket;
+    }
+
+    return result;
+}
+
+static void stop_threads(void)
+{
+    size_t idx;
+
+    if (Lock(g_executor.lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not acquire async executor lock");
+    }
+    else
+    {
+        g_executor.stopping = true;
+        // a post wakes up a single thread, threads that are running an
+        // operation see the flag before waiting again
+        for (idx = 0; idx < g_executor.num_threads; idx++)
+        {
+            (void)Condition_Post(g_executor.work_cond);
+        }
+        (void)Unlock(g_executor.lock);
+    }
+
+    for (idx = 0; idx < g_executor.num_threads; idx++)
+    {
+        int thread_result;
+        if (ThreadAPI_Join(g_executor.threads[idx], &thread_result) != THREADAPI_OK)
+        {
+            LOG_ERROR("Could not join async executor thread");
+        }
+    }
+    g_executor.num_threads = 0;
+}
+
+static void destroy_executor(void)
+{
+#if defined __linux__
+    if (g_executor.event_fd != -1)
+    {
+        (void)close(g_executor.event_fd);
+    }
+#endif
+    if (g_executor.work_cond != NULL)
+    {
+        Condition_Deinit(g_executor.work_cond);
+    }
+    if (g_executor.lock != NULL)
+    {
+        (void)Lock_Deinit(g_executor.lock);
+    }
+    g_executor.event_fd = -1;
+    g_executor.work_cond = NULL;
+    g_executor.lock = NULL;
+    g_executor.head = NULL;
+    g_executor.tail = NULL;
+    g_executor.stopping = false;
+}
+
+int hsm_async_init(size_t num_threads)
+{
+    int result;
+
+    if (g_executor.initialized)
+    {
+        LOG_ERROR("Re-initializing async executor without de-initializing");
+        result = __FAILURE__;
+    }
+    else if (num_threads > HSM_ASYNC_MAX_THREADS)
+    {
+        LOG_ERROR("Invalid number of async threads %zu, at most %d are supported",
+                  num_threads, HSM_ASYNC_MAX_THREADS);
+        result = __FAILURE__;
+    }
+    else if ((g_executor.lock = Lock_Init()) == NULL)
+    {
+        LOG_ERROR("Could not create async executor lock");
+        result = __FAILURE__;
+    }
+    else if ((g_executor.work_cond = Condition_Init()) == NULL)
+    {
+        LOG_ERROR("Could not create async executor condition");
+        destroy_executor();
+        result = __FAILURE__;
+    }
+#if defined __linux__
+    else if ((g_executor.event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1)
+    {
+        LOG_ERROR("Could not create async completion eventfd");
+        destroy_executor();
+        result = __FAILURE__;
+    }
+#endif
+    else
+    {
+        size_t num_workers = (num_threads == 0) ? HSM_ASYNC_DEFAULT_THREADS : num_threads;
+
+        // failing to start a thread only means fewer operations run at once
+        while (g_executor.num_threads < num_workers)
+        {
+            if (ThreadAPI_Create(&g_executor.threads[g_executor.num_threads], executor_thread, NULL) != THREADAPI_OK)
+            {
+                LOG_ERROR("Could not create async executor thread");
+                break;
+            }
+            g_executor.num_threads++;
+        }
+
+        if (g_executor.num_threads == 0)
+        {
+            destroy_executor();
+            result = __FAILURE__;
+        }
+        else
+        {
+            g_executor.initialized = true;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+void hsm_async_deinit(void)
+{
+    if (!g_executor.initialized)
+    {
+        LOG_ERROR("hsm_async_init not called");
+    }
+    else
+    {
+        // queued operations are run before the threads exit
+        stop_threads();
+        destroy_executor();
+        g_executor.initialized = false;
+    }
+}
+
+int hsm_async_get_event_fd(void)
+{
+    return g_executor.event_fd;
+}
+
+//##############################################################################
+// Operations
+//##############################################################################
+static const SIZED_BUFFER EMPTY_INPUT = { NULL, 0 };
+
+HSM_ASYNC_TICKET hsm_async_create_certificate
+(
+    HSM_CLIENT_HANDLE handle,
+    CERT_PROPS_HANDLE certificate_props,
+    HSM_ASYNC_CALLBACK callback,
+    void *context
+)
+{
+    HSM_ASYNC_TICKET result;
+
+    if (certificate_props == NULL)
+    {
+        LOG_ERROR("Invalid certificate properties");
+        result = NULL;
+    }
+    else if ((result = create_ticket(ASYNC_CREATE_CERTIFICATE, handle, &EMPTY_INPUT, &EMPTY_INPUT,
+                                     &EMPTY_INPUT, callback, context)) == NULL)
+    {
+        cert_properties_destroy(certificate_props);
+    }
+    else
+    {
+        result->certificate_props = certificate_props;
+        result = submit_ticket(result);
+    }
+
+    return result;
+}
+
+static HSM_ASYNC_TICKET submit_cipher
+(
+    ASYNC_OPERATION operation,
+    HSM_CLIENT_HANDLE handle,
+    const SIZED_BUFFER *identity,
+    const SIZED_BUFFER *input,
+    const SIZED_BUFFER *init_vector,
+    HSM_ASYNC_CALLBACK callback,
+    void *context
+)
+{
+    HSM_ASYNC_TICKET result;
+
+    if ((identity == NULL) || (input == NULL) || (init_vector == NULL))
+    {
+        LOG_ERROR("Invalid parameters");
+        result = NULL;
+    }
+    else if ((result = create_ticket(operation, handle, identity, input, init_vector, callback, context)) != NULL)
+    {
+        result = submit_ticket(result);
+    }
+
+    return result;
+}
+
+HSM_ASYNC_TICKET hsm_async_encrypt_data
+(
+    HSM_CLIENT_HANDLE handle,
+    const SIZED_BUFFER *identity,
+    const SIZED_BUFFER *plaintext,
+    const SIZED_BUFFER *init_vector,
+    HSM_ASYNC_CALLBACK callback,
+    void *context
+)
+{
+    return submit_cipher(ASYNC_ENCRYPT_DATA, handle, identity, plaintext, init_vector, callback, context);
+}
+
+HSM_ASYNC_TICKET hsm_async_decrypt_data
+(
+    HSM_CLIENT_HANDLE handle,
+    const SIZED_BUFFER *identity,
+    const SIZED_BUFFER *ciphertext,
+    const SIZED_BUFFER *init_vector,
+    HSM_ASYNC_CALLBACK callback,
+    void *context
+)
+{
+    return submit_cipher(ASYNC_DECRYPT_DATA, handle, identity, ciphertext, init_vector, callback, context);
+}
+
+HSM_ASYNC_TICKET hsm_async_sign_with_identity
+(
+    HSM_CLIENT_HANDLE handle,
+    const unsigned char *data,
+    size_t data_size,
+    HSM_ASYNC_CALLBACK callback,
+    void *context
+)
+{
+    HSM_ASYNC_TICKET result;
+    SIZED_BUFFER data_input;
+
+    data_input.buffer = (unsigned char*)data;
+    data_input.size = data_size;
+    if ((result = create_ticket(ASYNC_SIGN_WITH_IDENTITY, handle, &EMPTY_INPUT, &data_input,
+                                &EMPTY_INPUT, callback, context)) != NULL)
+    {
+        result = submit_ticket(result);
+    }
+
+    return result;
+}
+
+HSM_ASYNC_TICKET hsm_async_derive_and_sign_with_identity
+(
+    HSM_CLIENT_HANDLE handle,
+    const unsigned char *data,
+    size_t data_size,
+    const unsigned char *identity,
+    size_t identity_size,
+    HSM_ASYNC_CALLBACK callback,
+    void *context
+)
+{
+    HSM_ASYNC_TICKET result;
+    SIZED_BUFFER data_input;
+    SIZED_BUFFER identity_input;
+
+    data_input.buffer = (unsigned char*)data;
+    data_input.size = data_size;
+    identity_input.buffer = (unsigned char*)identity;
+    identity_input.size = identity_size;
+    if ((result = create_ticket(ASYNC_DERIVE_AND_SIGN_WITH_IDENTITY, handle, &identity_input, &data_input,
+                                &EMPTY_INPUT, callback, context)) != NULL)
+    {
+        result = submit_ticket(result);
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Completion
+//##############################################################################
+int hsm_async_is_complete(HSM_ASYNC_TICKET ticket)
+{
+    int result;
+
+    if (ticket == NULL)
+    {
+        LOG_ERROR("Invalid ticket");
+        result = 0;
+    }
+    else if (Lock(g_executor.lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not acquire async executor lock");
+        result = 0;
+    }
+    else
+    {
+        result = (ticket->state == TICKET_COMPLETE) ? 1 : 0;
+        (void)Unlock(g_executor.lock);
+    }
+
+    return result;
+}
+
+int hsm_async_get_result(HSM_ASYNC_TICKET ticket, HSM_ASYNC_RESULT *result)
+{
+    int status;
+    bool release_now = false;
+
+    if ((ticket == NULL) || (result == NULL))
+    {
+        LOG_ERROR("Invalid parameters");
+        status = __FAILURE__;
+    }
+    else if (Lock(g_executor.lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not acquire async executor lock");
+        status = __FAILURE__;
+    }
+    else
+    {
+        status = 0;
+        while ((status == 0) && (ticket->state != TICKET_COMPLETE))
+        {
+            if ((ticket->complete_cond == NULL) && ((ticket->complete_cond = Condition_Init()) == NULL))
+            {
+                LOG_ERROR("Could not create async completion condition");
+                status = __FAILURE__;
+            }
+            else if (Condition_Wait(ticket->complete_cond, g_executor.lock, 0) != COND_OK)
+            {
+                LOG_ERROR("Could not wait for async operation");
+                status = __FAILURE__;
+            }
+        }
+        if (status == 0)
+        {
+            *result = ticket->result;
+            release_now = !ticket->notifying;
+            ticket->released = true;
+        }
+        (void)Unlock(g_executor.lock);
+
+        if (release_now)
+        {
+            destroy_ticket(ticket);
+        }
+    }
+
+    return status;
+}
+
+void hsm_async_cancel(HSM_ASYNC_TICKET ticket)
+{
+    if (ticket == NULL)
+    {
+        LOG_ERROR("Invalid ticket");
+    }
+    else if (Lock(g_executor.lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not acquire async executor lock");
+    }
+    else
+    {
+        // queued and running operations, and completed ones whose callback
+        // is running, are released by the executor
+        bool release_now = (ticket->state == TICKET_COMPLETE) && !ticket->notifying;
+
+        ticket->cancelled = true;
+        ticket->released = true;
+        (void)Unlock(g_executor.lock);
+
+        if (release_now)
+        {
+            free_outputs(ticket);
+            destroy_ticket(ticket);
+        }
+    }
+}
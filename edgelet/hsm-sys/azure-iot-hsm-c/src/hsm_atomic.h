@@ -0,0 +1,140 @@
+#ifndef HSM_ATOMIC_H
+#define HSM_ATOMIC_H
+
+#ifdef __cplusplus
+#include <cstdint>
+extern "C" {
+#else
+#include <stdint.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+
+typedef volatile long HSM_ATOMIC_LONG;
+
+static __inline long hsm_atomic_inc(HSM_ATOMIC_LONG *value)
+{
+    return _InterlockedIncrement(value);
+}
+
+static __inline long hsm_atomic_dec(HSM_ATOMIC_LONG *value)
+{
+    return _InterlockedDecrement(value);
+}
+
+static __inline long hsm_atomic_load(HSM_ATOMIC_LONG *value)
+{
+    return _InterlockedOr(value, 0);
+}
+
+static __inline int hsm_atomic_cas(HSM_ATOMIC_LONG *value, long expected, long desired)
+{
+    return _InterlockedCompareExchange(value, desired, expected) == expected;
+}
+
+static __inline void hsm_atomic_store(HSM_ATOMIC_LONG *value, long desired)
+{
+    (void)_InterlockedExchange(value, desired);
+}
+
+static __inline void* hsm_atomic_load_ptr(void * volatile *ptr)
+{
+    return _InterlockedCompareExchangePointer(ptr, NULL, NULL);
+}
+
+static __inline void hsm_atomic_store_ptr(void * volatile *ptr, void *value)
+{
+    (void)_InterlockedExchangePointer(ptr, value);
+}
+
+static __inline int hsm_atomic_cas_ptr(void * volatile *ptr, void *expected, void *desired)
+{
+    return _InterlockedCompareExchangePointer(ptr, desired, expected) == expected;
+}
+
+// counters written by a single thread and read by any
+typedef volatile uint64_t HSM_ATOMIC_COUNTER;
+
+static __inline void hsm_counter_add(HSM_ATOMIC_COUNTER *counter, uint64_t delta)
+{
+    *counter += delta;
+}
+
+static __inline void hsm_counter_store(HSM_ATOMIC_COUNTER *counter, uint64_t value)
+{
+    *counter = value;
+}
+
+static __inline uint64_t hsm_counter_load(HSM_ATOMIC_COUNTER *counter)
+{
+    return *counter;
+}
+#else
+typedef volatile long HSM_ATOMIC_LONG;
+
+static inline long hsm_atomic_inc(HSM_ATOMIC_LONG *value)
+{
+    return __atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline long hsm_atomic_dec(HSM_ATOMIC_LONG *value)
+{
+    return __atomic_sub_fetch(value, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline long hsm_atomic_load(HSM_ATOMIC_LONG *value)
+{
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+static inline int hsm_atomic_cas(HSM_ATOMIC_LONG *value, long expected, long desired)
+{
+    return __atomic_compare_exchange_n(value, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline void hsm_atomic_store(HSM_ATOMIC_LONG *value, long desired)
+{
+    __atomic_store_n(value, desired, __ATOMIC_SEQ_CST);
+}
+
+static inline void* hsm_atomic_load_ptr(void * volatile *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline void hsm_atomic_store_ptr(void * volatile *ptr, void *value)
+{
+    __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+static inline int hsm_atomic_cas_ptr(void * volatile *ptr, void *expected, void *desired)
+{
+    return __atomic_compare_exchange_n(ptr, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+// counters written by a single thread and read by any, so the owner needs
+// no read-modify-write instruction
+typedef volatile uint64_t HSM_ATOMIC_COUNTER;
+
+static inline void hsm_counter_add(HSM_ATOMIC_COUNTER *counter, uint64_t delta)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + delta, __ATOMIC_RELAXED);
+}
+
+static inline void hsm_counter_store(HSM_ATOMIC_COUNTER *counter, uint64_t value)
+{
+    __atomic_store_n(counter, value, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t hsm_counter_load(HSM_ATOMIC_COUNTER *counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_ATOMIC_H
@@ -13,6 +13,7 @@
 #include "azure_c_shared_utility/crt_abstractions.h"
 
 #include "hsm_client_data.h"
+#include "hsm_trace.h"
 #include "edge_sas_perform_sign_with_key.h"
 #include "azure_utpm_c/tpm_comm.h"
 #include "azure_utpm_c/tpm_codec.h"
@@ -336,6 +337,9 @@ static int hsm_client_tpm_activate_identity_key
     }
     else
     {
+        HSM_TRACE_SCOPE trace;
+
+        HSM_TRACE_BEGIN(&trace, "tpm.command", "import_identity_key", key_len);
         if (insert_key_in_tpm((HSM_CLIENT_INFO*)handle, key, key_len))
         {
             LOG_ERROR("Failure inserting key into tpm");
@@ -345,6 +349,7 @@ static int hsm_client_tpm_activate_identity_key
         {
             result = 0;
         }
+        HSM_TRACE_END(&trace, 0, result);
     }
     return result;
 }
@@ -467,10 +472,15 @@ static int hsm_client_tpm_sign_data
         BYTE data_signature[TPM_DATA_LENGTH];
         BYTE* data_copy = (unsigned char*)data_to_be_signed;
         HSM_CLIENT_INFO* hsm_client_info = (HSM_CLIENT_INFO*)handle;
+        HSM_TRACE_SCOPE trace, command_trace;
+        uint32_t sign_len;
 
-        uint32_t sign_len = SignData(&hsm_client_info->tpm_device,
+        HSM_TRACE_BEGIN(&trace, "tpm.sign", NULL, data_to_be_signed_size);
+        HSM_TRACE_BEGIN(&command_trace, "tpm.command", "SignData", data_to_be_signed_size);
+        sign_len = SignData(&hsm_client_info->tpm_device,
                         &NullPwSession, data_copy, (UINT32)data_to_be_signed_size,
                         data_signature, sizeof(data_signature) );
+        HSM_TRACE_END(&command_trace, sign_len, (sign_len != 0) ? 0 : __FAILURE__);
         if (sign_len == 0)
         {
             LOG_ERROR("Failure signing data from hash");
@@ -490,6 +500,7 @@ static int hsm_client_tpm_sign_data
                 result = 0;
             }
         }
+        HSM_TRACE_END(&trace, (result == 0) ? sign_len : 0, result);
     }
     return result;
 }
@@ -549,10 +560,15 @@ static int hsm_client_tpm_derive_and_sign_with_identity
         BYTE data_signature[TPM_DATA_LENGTH];
         BYTE* data_copy = (unsigned char*)identity;
         HSM_CLIENT_INFO* hsm_client_info = (HSM_CLIENT_INFO*)handle;
+        HSM_TRACE_SCOPE trace, command_trace;
+        uint32_t sign_len;
 
-        uint32_t sign_len = SignData(&hsm_client_info->tpm_device,
+        HSM_TRACE_BEGIN_IDENTITY(&trace, "tpm.derive_and_sign", identity, identity_size, data_to_be_signed_size);
+        HSM_TRACE_BEGIN(&command_trace, "tpm.command", "SignData", identity_size);
+        sign_len = SignData(&hsm_client_info->tpm_device,
                         &NullPwSession, data_copy, (UINT32)identity_size,
                         data_signature, sizeof(data_signature) );
+        HSM_TRACE_END(&command_trace, sign_len, (sign_len != 0) ? 0 : __FAILURE__);
         if (sign_len == 0)
         {
             LOG_ERROR("Failure signing derived key from hash");
@@ -576,6 +592,7 @@ static int hsm_client_tpm_derive_and_sign_with_identity
 
             memset(data_signature, 0, TPM_DATA_LENGTH);
         }
+        HSM_TRACE_END(&trace, *digest_size, result);
     }
     return result;
 }
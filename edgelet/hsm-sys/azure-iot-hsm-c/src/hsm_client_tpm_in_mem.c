@@ -9,6 +9,7 @@
 #include "hsm_client_store.h"
 #include "hsm_log.h"
 #include "hsm_constants.h"
+#include "hsm_trace.h"
 
 struct EDGE_TPM_TAG
 {
@@ -239,9 +240,118 @@ static int edge_hsm_client_get_srk
     return ek_srk_unsupported(handle, key, key_len);
 }
 
+static int edge_hsm_client_import_sas_key
+(
+    HSM_CLIENT_HANDLE handle,
+    const char* key_name,
+    const unsigned char* key,
+    size_t key_size
+)
+{
+    int result;
+    if (!g_is_tpm_initialized)
+    {
+        LOG_ERROR("hsm_client_tpm_init not called");
+        result = __FAILURE__;
+    }
+    else if (handle == NULL)
+    {
+        LOG_ERROR("Invalid handle value specified");
+        result = __FAILURE__;
+    }
+    else if ((key_name == NULL) || (key_name[0] == 0))
+    {
+        LOG_ERROR("Invalid key name specified");
+        result = __FAILURE__;
+    }
+    else if (strcmp(key_name, EDGELET_IDENTITY_SAS_KEY_NAME) == 0)
+    {
+        LOG_ERROR("Key name '%s' is reserved for the identity key", key_name);
+        result = __FAILURE__;
+    }
+    else if (key == NULL)
+    {
+        LOG_ERROR("Invalid key specified");
+        result = __FAILURE__;
+    }
+    else if (key_size == 0)
+    {
+        LOG_ERROR("Key len length cannot be 0");
+        result = __FAILURE__;
+    }
+    else
+    {
+        int status;
+        const HSM_CLIENT_STORE_INTERFACE *store_if = g_hsm_store_if;
+        EDGE_TPM *edge_tpm = (EDGE_TPM*)handle;
+        if ((status = store_if->hsm_client_store_insert_sas_key(edge_tpm->hsm_store_handle,
+                                                                key_name,
+                                                                key, key_size)) != 0)
+        {
+            LOG_ERROR("Could not insert SAS key '%s'. Error code %d", key_name, status);
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int edge_hsm_client_remove_sas_key
+(
+    HSM_CLIENT_HANDLE handle,
+    const char* key_name
+)
+{
+    int result;
+    if (!g_is_tpm_initialized)
+    {
+        LOG_ERROR("hsm_client_tpm_init not called");
+        result = __FAILURE__;
+    }
+    else if (handle == NULL)
+    {
+        LOG_ERROR("Invalid handle value specified");
+        result = __FAILURE__;
+    }
+    else if ((key_name == NULL) || (key_name[0] == 0))
+    {
+        LOG_ERROR("Invalid key name specified");
+        result = __FAILURE__;
+    }
+    else if (strcmp(key_name, EDGELET_IDENTITY_SAS_KEY_NAME) == 0)
+    {
+        LOG_ERROR("Key name '%s' is reserved for the identity key", key_name);
+        result = __FAILURE__;
+    }
+    else
+    {
+        int status;
+        const HSM_CLIENT_STORE_INTERFACE *store_if = g_hsm_store_if;
+        EDGE_TPM *edge_tpm = (EDGE_TPM*)handle;
+        if ((status = store_if->hsm_client_store_remove_key(edge_tpm->hsm_store_handle,
+                                                            HSM_KEY_SAS,
+                                                            key_name)) != 0)
+        {
+            LOG_ERROR("Could not remove SAS key '%s'. Error code %d", key_name, status);
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
 static int perform_sign
 (
     HSM_CLIENT_HANDLE handle,
+    const char* key_name,
     const unsigned char* data_to_be_signed,
     size_t data_to_be_signed_size,
     const unsigned char* identity,
@@ -282,6 +392,11 @@ static int perform_sign
             LOG_ERROR("Invalid handle value specified");
             result = __FAILURE__;
         }
+        else if ((key_name == NULL) || (key_name[0] == 0))
+        {
+            LOG_ERROR("Invalid key name specified");
+            result = __FAILURE__;
+        }
         else if (data_to_be_signed == NULL)
         {
             LOG_ERROR("Invalid data to be signed specified");
@@ -308,12 +423,22 @@ static int perform_sign
             const HSM_CLIENT_STORE_INTERFACE *store_if = g_hsm_store_if;
             const HSM_CLIENT_KEY_INTERFACE *key_if = g_hsm_key_if;
             EDGE_TPM* edge_tpm = (EDGE_TPM*)handle;
+            HSM_TRACE_SCOPE trace;
+
+            if (identity != NULL)
+            {
+                HSM_TRACE_BEGIN_IDENTITY(&trace, "tpm.derive_and_sign", identity, identity_size, data_to_be_signed_size);
+            }
+            else
+            {
+                HSM_TRACE_BEGIN(&trace, "tpm.sign", key_name, data_to_be_signed_size);
+            }
             key_handle = store_if->hsm_client_store_open_key(edge_tpm->hsm_store_handle,
                                                              HSM_KEY_SAS,
-                                                             EDGELET_IDENTITY_SAS_KEY_NAME);
+                                                             key_name);
             if (key_handle == NULL)
             {
-                LOG_ERROR("Could not get SAS key by name '%s'", EDGELET_IDENTITY_SAS_KEY_NAME);
+                LOG_ERROR("Could not get SAS key by name '%s'", key_name);
                 result = __FAILURE__;
             }
             else
@@ -340,7 +465,7 @@ static int perform_sign
 
                 if (status != 0)
                 {
-                    LOG_ERROR("Error computing signature using identity key. Error code %d", status);
+                    LOG_ERROR("Error computing signature using key '%s'. Error code %d", key_name, status);
                     result = __FAILURE__;
                 }
                 else
@@ -355,6 +480,7 @@ static int perform_sign
                     result = __FAILURE__;
                 }
             }
+            HSM_TRACE_END(&trace, *digest_size, result);
         }
     }
     return result;
@@ -369,7 +495,8 @@ static int edge_hsm_client_sign_with_identity
     size_t* digest_size
 )
 {
-    return perform_sign(handle, data_to_be_signed, data_to_be_signed_size,
+    return perform_sign(handle, EDGELET_IDENTITY_SAS_KEY_NAME,
+                        data_to_be_signed, data_to_be_signed_size,
                         NULL, 0, digest, digest_size, 0);
 }
 
@@ -384,10 +511,26 @@ static int edge_hsm_client_derive_and_sign_with_identity
     size_t* digest_size
 )
 {
-    return perform_sign(handle, data_to_be_signed, data_to_be_signed_size,
+    return perform_sign(handle, EDGELET_IDENTITY_SAS_KEY_NAME,
+                        data_to_be_signed, data_to_be_signed_size,
                         identity, identity_size, digest, digest_size, 1);
 }
 
+static int edge_hsm_client_sign_with_sas_key
+(
+    HSM_CLIENT_HANDLE handle,
+    const char* key_name,
+    const unsigned char* data_to_be_signed,
+    size_t data_to_be_signed_size,
+    unsigned char** digest,
+    size_t* digest_size
+)
+{
+    return perform_sign(handle, key_name,
+                        data_to_be_signed, data_to_be_signed_size,
+                        NULL, 0, digest, digest_size, 0);
+}
+
 static void edge_hsm_free_buffer(void *buffer)
 {
     if (buffer != NULL)
@@ -408,7 +551,20 @@ static const HSM_CLIENT_TPM_INTERFACE edge_tpm_interface =
     edge_hsm_free_buffer
 };
 
+static const HSM_CLIENT_TPM_SAS_KEY_INTERFACE edge_tpm_sas_key_interface =
+{
+    HSM_CLIENT_TPM_SAS_KEY_INTERFACE_VERSION,
+    edge_hsm_client_import_sas_key,
+    edge_hsm_client_remove_sas_key,
+    edge_hsm_client_sign_with_sas_key
+};
+
 const HSM_CLIENT_TPM_INTERFACE* hsm_client_tpm_store_interface()
 {
     return &edge_tpm_interface;
 }
+
+const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* hsm_client_tpm_store_sas_key_interface()
+{
+    return &edge_tpm_sas_key_interface;
+}
@@ -6,3 +6,4 @@
 extern int hsm_client_tpm_store_init(void);
 extern void hsm_client_tpm_store_deinit(void);
 extern const HSM_CLIENT_TPM_INTERFACE* hsm_client_tpm_store_interface();
+extern const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* hsm_client_tpm_store_sas_key_interface();
@@ -5,7 +5,9 @@
 #include <ctype.h>
 #include <stdbool.h>
 #include "hsm_utils.h"
+#include "hsm_fault.h"
 #include "hsm_log.h"
+#include "hsm_metrics.h"
 #include "hsm_client_tpm_device.h"
 #include "hsm_client_tpm_in_mem.h"
 
@@ -108,6 +110,7 @@ void hsm_client_tpm_deinit(void)
     {
         hsm_client_tpm_store_deinit();
     }
+    log_shutdown();
 }
 
 const HSM_CLIENT_TPM_INTERFACE* hsm_client_tpm_interface(void)
@@ -121,5 +124,27 @@ const HSM_CLIENT_TPM_INTERFACE* hsm_client_tpm_interface(void)
     {
         result = hsm_client_tpm_store_interface();
     }
+#if defined(HSM_FAULT_INJECTION)
+    result = hsm_fault_tpm_interface(result);
+#endif
+    return hsm_metrics_tpm_interface(result);
+}
+
+const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* hsm_client_tpm_sas_key_interface(void)
+{
+    const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* result;
+    if (g_use_tpm_device)
+    {
+        // named SAS keys are not supported by the TPM device
+        result = NULL;
+    }
+    else
+    {
+        result = hsm_client_tpm_store_sas_key_interface();
+#if defined(HSM_FAULT_INJECTION)
+        result = hsm_fault_tpm_sas_key_interface(result);
+#endif
+        result = hsm_metrics_tpm_sas_key_interface(result);
+    }
     return result;
 }
@@ -9,6 +9,10 @@ extern const char* const ENV_DEVICE_CA_PATH;
 extern const char* const ENV_DEVICE_PK_PATH;
 extern const char* const ENV_TRUSTED_CA_CERTS_PATH;
 
+/* HSM C env variables */
+extern const char* const ENV_STORE_BACKEND;
+extern const char* const ENV_WATCH_CERTS;
+
 /* HSM directory name under IOTEDGE_HOMEDIR */
 extern const char* const DEFAULT_EDGE_HOME_DIR_UNIX;
 extern const char* const DEFAULT_EDGE_BASE_DIR_ENV_WIN;
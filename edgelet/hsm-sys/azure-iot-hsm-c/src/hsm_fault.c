@@ -0,0 +1,722 @@
+#if defined __linux__ && !defined _GNU_SOURCE
+    // for nanosleep with strict C standard flags
+    #define _GNU_SOURCE
+#endif
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "azure_c_shared_utility/macro_utils.h"
+#include "hsm_atomic.h"
+#include "hsm_client_data.h"
+#include "hsm_client_store.h"
+#include "hsm_fault.h"
+#include "hsm_log.h"
+
+#if defined(_MSC_VER)
+    #include <windows.h>
+    #define HSM_THREAD_LOCAL __declspec(thread)
+#else
+    #define HSM_THREAD_LOCAL __thread
+#endif
+
+//##############################################################################
+// Data types
+//##############################################################################
+#define MAX_SETTING_SIZE 64
+
+#define ENV_STATE_UNREAD 0
+#define ENV_STATE_READING 1
+#define ENV_STATE_READ 2
+
+static const char* const ENV_FAULT_SEED = "IOTEDGE_HSM_FAULT_SEED";
+static const char* const ENV_FAULT_TARGETS[HSM_FAULT_NUM_TARGETS] =
+{
+    "IOTEDGE_HSM_FAULT_STORE",
+    "IOTEDGE_HSM_FAULT_TPM",
+    "IOTEDGE_HSM_FAULT_FILE_WRITE"
+};
+
+static HSM_FAULT_CONFIG g_configs[HSM_FAULT_NUM_TARGETS];
+static HSM_ATOMIC_LONG g_enabled[HSM_FAULT_NUM_TARGETS];
+static HSM_ATOMIC_LONG g_env_state = ENV_STATE_UNREAD;
+static uint64_t g_seed = 0;
+static HSM_ATOMIC_LONG g_seeded_threads = 0;
+static HSM_THREAD_LOCAL uint64_t g_random_state = 0;
+
+static void * volatile g_store_target = NULL;
+static void * volatile g_tpm_target = NULL;
+static void * volatile g_tpm_sas_key_target = NULL;
+
+//##############################################################################
+// Random draws
+//##############################################################################
+static uint64_t splitmix64(uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+static uint64_t next_random(void)
+{
+    uint64_t value;
+
+    if (g_random_state == 0)
+    {
+        // threads get distinct streams in the order they first draw
+        g_random_state = splitmix64(g_seed + (uint64_t)hsm_atomic_inc(&g_seeded_threads)) | 1;
+    }
+    // xorshift64*
+    g_random_state ^= g_random_state >> 12;
+    g_random_state ^= g_random_state << 25;
+    g_random_state ^= g_random_state >> 27;
+    value = g_random_state * 0x2545F4914F6CDD1DULL;
+
+    return value;
+}
+
+static bool draw(double rate)
+{
+    // 53 random bits make a double uniform in [0, 1)
+    return (rate > 0.0) && (((double)(next_random() >> 11) / 9007199254740992.0) < rate);
+}
+
+//##############################################################################
+// Settings
+//##############################################################################
+static int parse_uint32(const char* value, uint32_t* number, const char** end)
+{
+    int result;
+    char* number_end;
+    unsigned long parsed;
+
+    if (!isdigit((unsigned char)value[0]))
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        errno = 0;
+        parsed = strtoul(value, &number_end, 10);
+        if ((errno != 0) || (parsed > UINT32_MAX))
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            *number = (uint32_t)parsed;
+            *end = number_end;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int parse_rate(const char* value, double* rate)
+{
+    int result;
+    char* rate_end;
+    double parsed;
+
+    if (!isdigit((unsigned char)value[0]) && (value[0] != '.'))
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        parsed = strtod(value, &rate_end);
+        if ((*rate_end != '\0') || (parsed < 0.0) || (parsed > 1.0))
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            *rate = parsed;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int parse_setting(const char* setting, size_t setting_size, HSM_FAULT_CONFIG* config)
+{
+    int result;
+    char name[MAX_SETTING_SIZE];
+    char* value;
+    const char* end;
+
+    if (setting_size >= sizeof(name))
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        memcpy(name, setting, setting_size);
+        name[setting_size] = '\0';
+        if ((value = strchr(name, '=')) == NULL)
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            *value++ = '\0';
+            if (strcmp(name, "latency_us") == 0)
+            {
+                if (parse_uint32(value, &config->min_latency_us, &end) != 0)
+                {
+                    result = __FAILURE__;
+                }
+                else if (*end == '\0')
+                {
+                    config->max_latency_us = config->min_latency_us;
+                    result = 0;
+                }
+                else if ((*end != '-') ||
+                         (parse_uint32(end + 1, &config->max_latency_us, &end) != 0) ||
+                         (*end != '\0') ||
+                         (config->max_latency_us < config->min_latency_us))
+                {
+                    result = __FAILURE__;
+                }
+                else
+                {
+                    result = 0;
+                }
+            }
+            else if (strcmp(name, "tail_us") == 0)
+            {
+                result = ((parse_uint32(value, &config->tail_latency_us, &end) != 0) || (*end != '\0')) ?
+                         __FAILURE__ : 0;
+            }
+            else if (strcmp(name, "tail_rate") == 0)
+            {
+                result = parse_rate(value, &config->tail_rate);
+            }
+            else if (strcmp(name, "error_rate") == 0)
+            {
+                result = parse_rate(value, &config->error_rate);
+            }
+            else if (strcmp(name, "partial_write_rate") == 0)
+            {
+                result = parse_rate(value, &config->partial_write_rate);
+            }
+            else
+            {
+                result = __FAILURE__;
+            }
+        }
+    }
+
+    return result;
+}
+
+int hsm_fault_parse_config(const char* settings, HSM_FAULT_CONFIG* config)
+{
+    int result;
+
+    if ((settings == NULL) || (config == NULL))
+    {
+        LOG_ERROR("Invalid parameters");
+        result = __FAILURE__;
+    }
+    else
+    {
+        const char* setting = settings;
+
+        memset(config, 0, sizeof(*config));
+        result = 0;
+        while ((result == 0) && (*setting != '\0'))
+        {
+            const char* separator = strchr(setting, ',');
+            size_t setting_size = (separator != NULL) ? (size_t)(separator - setting) : strlen(setting);
+
+            if (parse_setting(setting, setting_size, config) != 0)
+            {
+                LOG_ERROR("Invalid fault setting %.*s", (int)setting_size, setting);
+                result = __FAILURE__;
+            }
+            setting += setting_size + ((separator != NULL) ? 1 : 0);
+        }
+    }
+
+    return result;
+}
+
+static void read_env(void)
+{
+    const char* seed = getenv(ENV_FAULT_SEED);
+    int target;
+
+    g_seed = (seed != NULL) ? (uint64_t)strtoull(seed, NULL, 10) : (uint64_t)time(NULL);
+    for (target = 0; target < HSM_FAULT_NUM_TARGETS; target++)
+    {
+        const char* settings = getenv(ENV_FAULT_TARGETS[target]);
+
+        if (settings != NULL)
+        {
+            if (hsm_fault_parse_config(settings, &g_configs[target]) != 0)
+            {
+                LOG_ERROR("Ignoring env variable %s", ENV_FAULT_TARGETS[target]);
+            }
+            else
+            {
+                hsm_atomic_store(&g_enabled[target], 1);
+            }
+        }
+    }
+}
+
+static void read_env_once(void)
+{
+    if (hsm_atomic_load(&g_env_state) != ENV_STATE_READ)
+    {
+        if (hsm_atomic_cas(&g_env_state, ENV_STATE_UNREAD, ENV_STATE_READING))
+        {
+            read_env();
+            hsm_atomic_store(&g_env_state, ENV_STATE_READ);
+        }
+        else
+        {
+            while (hsm_atomic_load(&g_env_state) != ENV_STATE_READ)
+            {
+                // another thread is reading the env, which takes microseconds
+            }
+        }
+    }
+}
+
+int hsm_fault_configure(HSM_FAULT_TARGET target, const HSM_FAULT_CONFIG* config)
+{
+    int result;
+
+    if (((int)target < 0) || (target >= HSM_FAULT_NUM_TARGETS))
+    {
+        LOG_ERROR("Invalid fault target %d", (int)target);
+        result = __FAILURE__;
+    }
+    else if ((config != NULL) && (config->max_latency_us < config->min_latency_us))
+    {
+        LOG_ERROR("Invalid fault latency range");
+        result = __FAILURE__;
+    }
+    else
+    {
+        // settings made here are not overridden by the env later on
+        read_env_once();
+        hsm_atomic_store(&g_enabled[target], 0);
+        if (config != NULL)
+        {
+            g_configs[target] = *config;
+            hsm_atomic_store(&g_enabled[target], 1);
+        }
+        result = 0;
+    }
+
+    return result;
+}
+
+void hsm_fault_reset(void)
+{
+    int target;
+
+    for (target = 0; target < HSM_FAULT_NUM_TARGETS; target++)
+    {
+        hsm_atomic_store(&g_enabled[target], 0);
+    }
+    hsm_atomic_store(&g_env_state, ENV_STATE_UNREAD);
+}
+
+//##############################################################################
+// Injection
+//##############################################################################
+static void sleep_us(uint32_t latency_us)
+{
+#if defined(_MSC_VER)
+    Sleep((latency_us + 999) / 1000);
+#else
+    struct timespec remaining;
+
+    remaining.tv_sec = (time_t)(latency_us / 1000000);
+    remaining.tv_nsec = (long)(latency_us % 1000000) * 1000;
+    while ((nanosleep(&remaining, &remaining) != 0) && (errno == EINTR))
+    {
+    }
+#endif
+}
+
+// delays the call and returns whether it must fail
+static bool inject_fault(HSM_FAULT_TARGET target, bool can_fail, HSM_FAULT_CONFIG* config)
+{
+    bool result = false;
+
+    read_env_once();
+    if (hsm_atomic_load(&g_enabled[target]) != 0)
+    {
+        uint32_t latency_us;
+
+        *config = g_configs[target];
+        if (draw(config->tail_rate))
+        {
+            latency_us = config->tail_latency_us;
+        }
+        else
+        {
+            latency_us = config->min_latency_us;
+            if (config->max_latency_us > config->min_latency_us)
+            {
+                latency_us += (uint32_t)(next_random() %
+                              ((uint64_t)config->max_latency_us - config->min_latency_us + 1));
+            }
+        }
+        if (latency_us != 0)
+        {
+            sleep_us(latency_us);
+        }
+        result = can_fail && draw(config->error_rate);
+    }
+    else
+    {
+        memset(config, 0, sizeof(*config));
+    }
+
+    return result;
+}
+
+#define FAULT(target) inject_fault((target), true, &config)
+#define DELAY(target) (void)inject_fault((target), false, &config)
+
+int hsm_fault_file_write(size_t* write_size)
+{
+    int result;
+    HSM_FAULT_CONFIG config;
+
+    if (FAULT(HSM_FAULT_FILE_WRITE))
+    {
+        *write_size = 0;
+        result = __FAILURE__;
+    }
+    else if ((*write_size > 0) && draw(config.partial_write_rate))
+    {
+        *write_size = (size_t)(next_random() % *write_size);
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Faulty TPM interface
+//##############################################################################
+#define TPM_TARGET ((const HSM_CLIENT_TPM_INTERFACE*)hsm_atomic_load_ptr(&g_tpm_target))
+
+static HSM_CLIENT_HANDLE faulty_tpm_create(void)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_TPM) ? NULL : TPM_TARGET->hsm_client_tpm_create();
+}
+
+static void faulty_tpm_destroy(HSM_CLIENT_HANDLE handle)
+{
+    HSM_FAULT_CONFIG config;
+    DELAY(HSM_FAULT_TPM);
+    TPM_TARGET->hsm_client_tpm_destroy(handle);
+}
+
+static int faulty_tpm_activate_identity_key(HSM_CLIENT_HANDLE handle, const unsigned char* key, size_t key_size)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_TPM) ? __FAILURE__ :
+           TPM_TARGET->hsm_client_activate_identity_key(handle, key, key_size);
+}
+
+static int faulty_tpm_get_ek(HSM_CLIENT_HANDLE handle, unsigned char** key, size_t* key_size)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_TPM) ? __FAILURE__ : TPM_TARGET->hsm_client_get_ek(handle, key, key_size);
+}
+
+static int faulty_tpm_get_srk(HSM_CLIENT_HANDLE handle, unsigned char** key, size_t* key_size)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_TPM) ? __FAILURE__ : TPM_TARGET->hsm_client_get_srk(handle, key, key_size);
+}
+
+static int faulty_tpm_sign_with_identity
+(
+    HSM_CLIENT_HANDLE handle,
+    const unsigned char* data,
+    size_t data_size,
+    unsigned char** digest,
+    size_t* digest_size
+)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_TPM) ? __FAILURE__ :
+           TPM_TARGET->hsm_client_sign_with_identity(handle, data, data_size, digest, digest_size);
+}
+
+static int faulty_tpm_derive_and_sign_with_identity
+(
+    HSM_CLIENT_HANDLE handle,
+    const unsigned char* data,
+    size_t data_size,
+    const unsigned char* identity,
+    size_t identity_size,
+    unsigned char** digest,
+    size_t* digest_size
+)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_TPM) ? __FAILURE__ :
+           TPM_TARGET->hsm_client_derive_and_sign_with_identity(handle, data, data_size, identity,
+                                                                identity_size, digest, digest_size);
+}
+
+static void faulty_tpm_free_buffer(void* buffer)
+{
+    // freeing memory does not reach the TPM, so it is neither delayed nor failed
+    TPM_TARGET->hsm_client_free_buffer(buffer);
+}
+
+static const HSM_CLIENT_TPM_INTERFACE faulty_tpm_interface =
+{
+    faulty_tpm_create,
+    faulty_tpm_destroy,
+    faulty_tpm_activate_identity_key,
+    faulty_tpm_get_ek,
+    faulty_tpm_get_srk,
+    faulty_tpm_sign_with_identity,
+    faulty_tpm_derive_and_sign_with_identity,
+    faulty_tpm_free_buffer
+};
+
+const HSM_CLIENT_TPM_INTERFACE* hsm_fault_tpm_interface(const HSM_CLIENT_TPM_INTERFACE* target)
+{
+    const HSM_CLIENT_TPM_INTERFACE* result;
+
+    if (target == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        hsm_atomic_store_ptr(&g_tpm_target, (void*)target);
+        result = &faulty_tpm_interface;
+    }
+
+    return result;
+}
+
+#define TPM_SAS_KEY_TARGET ((const HSM_CLIENT_TPM_SAS_KEY_INTERFACE*)hsm_atomic_load_ptr(&g_tpm_sas_key_target))
+
+static int faulty_tpm_import_sas_key(HSM_CLIENT_HANDLE handle, const char* key_name, const unsigned char* key, size_t key_size)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_TPM) ? __FAILURE__ :
+           TPM_SAS_KEY_TARGET->hsm_client_import_sas_key(handle, key_name, key, key_size);
+}
+
+static int faulty_tpm_remove_sas_key(HSM_CLIENT_HANDLE handle, const char* key_name)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_TPM) ? __FAILURE__ : TPM_SAS_KEY_TARGET->hsm_client_remove_sas_key(handle, key_name);
+}
+
+static int faulty_tpm_sign_with_sas_key
+(
+    HSM_CLIENT_HANDLE handle,
+    const char* key_name,
+    const unsigned char* data,
+    size_t data_size,
+    unsigned char** digest,
+    size_t* digest_size
+)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_TPM) ? __FAILURE__ :
+           TPM_SAS_KEY_TARGET->hsm_client_sign_with_sas_key(handle, key_name, data, data_size, digest, digest_size);
+}
+
+static const HSM_CLIENT_TPM_SAS_KEY_INTERFACE faulty_tpm_sas_key_interface =
+{
+    HSM_CLIENT_TPM_SAS_KEY_INTERFACE_VERSION,
+    faulty_tpm_import_sas_key,
+    faulty_tpm_remove_sas_key,
+    faulty_tpm_sign_with_sas_key
+};
+
+const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* hsm_fault_tpm_sas_key_interface(const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* target)
+{
+    const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* result;
+
+    if (target == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        hsm_atomic_store_ptr(&g_tpm_sas_key_target, (void*)target);
+        result = &faulty_tpm_sas_key_interface;
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Faulty store interface
+//##############################################################################
+#define STORE_TARGET ((const HSM_CLIENT_STORE_INTERFACE*)hsm_atomic_load_ptr(&g_store_target))
+
+static int faulty_store_create(const char* store_name)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_STORE) ? __FAILURE__ : STORE_TARGET->hsm_client_store_create(store_name);
+}
+
+static int faulty_store_destroy(const char* store_name)
+{
+    HSM_FAULT_CONFIG config;
+    DELAY(HSM_FAULT_STORE);
+    return STORE_TARGET->hsm_client_store_destroy(store_name);
+}
+
+static HSM_CLIENT_STORE_HANDLE faulty_store_open(const char* store_name)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_STORE) ? NULL : STORE_TARGET->hsm_client_store_open(store_name);
+}
+
+static int faulty_store_close(HSM_CLIENT_STORE_HANDLE handle)
+{
+    HSM_FAULT_CONFIG config;
+    DELAY(HSM_FAULT_STORE);
+    return STORE_TARGET->hsm_client_store_close(handle);
+}
+
+static KEY_HANDLE faulty_store_open_key(HSM_CLIENT_STORE_HANDLE handle, HSM_KEY_T key_type, const char* key_name)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_STORE) ? NULL : STORE_TARGET->hsm_client_store_open_key(handle, key_type, key_name);
+}
+
+static int faulty_store_close_key(HSM_CLIENT_STORE_HANDLE handle, KEY_HANDLE key_handle)
+{
+    HSM_FAULT_CONFIG config;
+    DELAY(HSM_FAULT_STORE);
+    return STORE_TARGET->hsm_client_store_close_key(handle, key_handle);
+}
+
+static int faulty_store_remove_key(HSM_CLIENT_STORE_HANDLE handle, HSM_KEY_T key_type, const char* key_name)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_STORE) ? __FAILURE__ :
+           STORE_TARGET->hsm_client_store_remove_key(handle, key_type, key_name);
+}
+
+static int faulty_store_insert_sas_key
+(
+    HSM_CLIENT_STORE_HANDLE handle,
+    const char* key_name,
+    const unsigned char* key,
+    size_t key_len
+)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_STORE) ? __FAILURE__ :
+           STORE_TARGET->hsm_client_store_insert_sas_key(handle, key_name, key, key_len);
+}
+
+static int faulty_store_insert_encryption_key(HSM_CLIENT_STORE_HANDLE handle, const char* key_name)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_STORE) ? __FAILURE__ :
+           STORE_TARGET->hsm_client_store_insert_encryption_key(handle, key_name);
+}
+
+static int faulty_store_create_pki_cert(HSM_CLIENT_STORE_HANDLE handle, CERT_PROPS_HANDLE cert_props_handle)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_STORE) ? __FAILURE__ :
+           STORE_TARGET->hsm_client_store_create_pki_cert(handle, cert_props_handle);
+}
+
+static CERT_INFO_HANDLE faulty_store_get_pki_cert(HSM_CLIENT_STORE_HANDLE handle, const char* alias)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_STORE) ? NULL : STORE_TARGET->hsm_client_store_get_pki_cert(handle, alias);
+}
+
+static int faulty_store_remove_pki_cert(HSM_CLIENT_STORE_HANDLE handle, const char* alias)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_STORE) ? __FAILURE__ : STORE_TARGET->hsm_client_store_remove_pki_cert(handle, alias);
+}
+
+static int faulty_store_insert_pki_trusted_cert(HSM_CLIENT_STORE_HANDLE handle, const char* alias, const char* file_name)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_STORE) ? __FAILURE__ :
+           STORE_TARGET->hsm_client_store_insert_pki_trusted_cert(handle, alias, file_name);
+}
+
+static CERT_INFO_HANDLE faulty_store_get_pki_trusted_certs(HSM_CLIENT_STORE_HANDLE handle)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_STORE) ? NULL : STORE_TARGET->hsm_client_store_get_pki_trusted_certs(handle);
+}
+
+static int faulty_store_remove_pki_trusted_cert(HSM_CLIENT_STORE_HANDLE handle, const char* alias)
+{
+    HSM_FAULT_CONFIG config;
+    return FAULT(HSM_FAULT_STORE) ? __FAILURE__ :
+           STORE_TARGET->hsm_client_store_remove_pki_trusted_cert(handle, alias);
+}
+
+static const HSM_CLIENT_STORE_INTERFACE faulty_store_interface =
+{
+    faulty_store_create,
+    faulty_store_destroy,
+    faulty_store_open,
+    faulty_store_close,
+    faulty_store_open_key,
+    faulty_store_close_key,
+    faulty_store_remove_key,
+    faulty_store_insert_sas_key,
+    faulty_store_insert_encryption_key,
+    faulty_store_create_pki_cert,
+    faulty_store_get_pki_cert,
+    faulty_store_remove_pki_cert,
+    faulty_store_insert_pki_trusted_cert,
+    faulty_store_get_pki_trusted_certs,
+    faulty_store_remove_pki_trusted_cert
+};
+
+const HSM_CLIENT_STORE_INTERFACE* hsm_fault_store_interface(const HSM_CLIENT_STORE_INTERFACE* target)
+{
+    const HSM_CLIENT_STORE_INTERFACE* result;
+
+    if (target == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        hsm_atomic_store_ptr(&g_store_target, (void*)target);
+        result = &faulty_store_interface;
+    }
+
+    return result;
+}
@@ -0,0 +1,95 @@
+#ifndef HSM_FAULT_H
+#define HSM_FAULT_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C" {
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+#include "hsm_client_data.h"
+#include "hsm_client_store.h"
+
+/**
+ * Fault injection, only built with HSM_FAULT_INJECTION for testing.
+ *
+ * The store and TPM interfaces are wrapped by tables that delay their calls
+ * and fail some of them before they reach the backend, and the writes of the
+ * store files can be made to fail or to stop partway. Faults are configured
+ * per target from the env variables IOTEDGE_HSM_FAULT_STORE,
+ * IOTEDGE_HSM_FAULT_TPM and IOTEDGE_HSM_FAULT_FILE_WRITE, read the first time
+ * any fault function is called, or with hsm_fault_configure. Both take the
+ * comma separated settings of hsm_fault_parse_config, for instance
+ * "latency_us=200-800,tail_rate=0.01,tail_us=50000,error_rate=0.001".
+ *
+ * Draws are made from a per thread generator seeded from
+ * IOTEDGE_HSM_FAULT_SEED when it is set, so a single threaded run injects the
+ * same faults every time.
+ */
+typedef enum HSM_FAULT_TARGET_TAG
+{
+    HSM_FAULT_STORE,
+    HSM_FAULT_TPM,
+    HSM_FAULT_FILE_WRITE,
+    HSM_FAULT_NUM_TARGETS
+} HSM_FAULT_TARGET;
+
+/**
+ * Faults injected into the calls to a target. Rates are shares of calls
+ * between 0 and 1. Calls that release a handle or a buffer are delayed but
+ * never failed so that faults do not leak what the caller holds.
+ */
+typedef struct HSM_FAULT_CONFIG_TAG
+{
+    // every call is delayed by a time drawn uniformly from this range
+    uint32_t min_latency_us;
+    uint32_t max_latency_us;
+    // share of calls delayed by tail_latency_us instead, to model stalls
+    double tail_rate;
+    uint32_t tail_latency_us;
+    // share of calls that fail without reaching the backend
+    double error_rate;
+    // share of file writes that write part of their data and then fail
+    double partial_write_rate;
+} HSM_FAULT_CONFIG;
+
+/**
+ * Parses settings of the form "name=value,name=value" into config, with
+ * names latency_us (a single value or a "min-max" range), tail_rate,
+ * tail_us, error_rate and partial_write_rate. Settings that are not given
+ * are 0. Returns 0 on success.
+ */
+extern int hsm_fault_parse_config(const char* settings, HSM_FAULT_CONFIG* config);
+
+/**
+ * Replaces the faults injected into target, NULL stops injecting faults.
+ * Meant to be called between workloads, calls made meanwhile may see a mix
+ * of the previous and the new faults.
+ */
+extern int hsm_fault_configure(HSM_FAULT_TARGET target, const HSM_FAULT_CONFIG* config);
+
+/**
+ * Stops injecting faults into every target and forgets the env variables,
+ * which are read again on the next call.
+ */
+extern void hsm_fault_reset(void);
+
+extern const HSM_CLIENT_STORE_INTERFACE* hsm_fault_store_interface(const HSM_CLIENT_STORE_INTERFACE* target);
+extern const HSM_CLIENT_TPM_INTERFACE* hsm_fault_tpm_interface(const HSM_CLIENT_TPM_INTERFACE* target);
+extern const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* hsm_fault_tpm_sas_key_interface(const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* target);
+
+/**
+ * Called by the store file writers before writing write_size bytes. Delays
+ * the write and returns 0 when it may go ahead, otherwise returns non zero
+ * and sets write_size to the number of bytes to write before failing.
+ */
+extern int hsm_fault_file_write(size_t* write_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_FAULT_H
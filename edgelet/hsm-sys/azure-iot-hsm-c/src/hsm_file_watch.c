@@ -0,0 +1,351 @@
+#if defined __linux__ && !defined _GNU_SOURCE
+    // for clock_gettime and pipe with strict C standard flags
+    #define _GNU_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "hsm_file_watch.h"
+#include "hsm_log.h"
+
+#if defined __linux__
+    #include <errno.h>
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <time.h>
+    #include <unistd.h>
+    #include "azure_c_shared_utility/threadapi.h"
+#endif
+
+#if defined __linux__
+//##############################################################################
+// Data types
+//##############################################################################
+// time without further changes to the watched files before the callback runs
+#define FILE_WATCH_SETTLE_MS 500
+#define FILE_WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_ATTRIB)
+#define FILE_WATCH_EVENT_BUFFER_SIZE 4096
+
+struct WATCHED_FILE_TAG
+{
+    int wd;
+    char *dir;
+    const char *name;
+};
+typedef struct WATCHED_FILE_TAG WATCHED_FILE;
+
+struct HSM_FILE_WATCH_TAG
+{
+    int inotify_fd;
+    // written to by hsm_file_watch_stop to wake up the watch thread
+    int stop_fds[2];
+    WATCHED_FILE *files;
+    size_t num_files;
+    HSM_FILE_WATCH_CALLBACK on_change;
+    void *context;
+    THREAD_HANDLE thread;
+};
+typedef struct HSM_FILE_WATCH_TAG HSM_FILE_WATCH;
+
+//##############################################################################
+// File watch helpers
+//##############################################################################
+static long long get_monotonic_ms(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((long long)now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+static void destroy_watch(HSM_FILE_WATCH *watch)
+{
+    size_t idx;
+
+    for (idx = 0; idx < watch->num_files; idx++)
+    {
+        free(watch->files[idx].dir);
+    }
+    free(watch->files);
+    if (watch->stop_fds[0] >= 0)
+    {
+        (void)close(watch->stop_fds[0]);
+        (void)close(watch->stop_fds[1]);
+    }
+    if (watch->inotify_fd >= 0)
+    {
+        (void)close(watch->inotify_fd);
+    }
+    free(watch);
+}
+
+static int add_watched_file(HSM_FILE_WATCH *watch, WATCHED_FILE *file, const char *file_path)
+{
+    int result;
+    const char *slash = strrchr(file_path, '/');
+    const char *name = (slash == NULL) ? file_path : slash + 1;
+    size_t dir_len = (slash == NULL) ? 1 : (slash == file_path) ? 1 : (size_t)(slash - file_path);
+    size_t name_len = strlen(name);
+
+    // the directory and the file name are kept in a single allocation
+    if ((file->dir = (char*)malloc(dir_len + name_len + 2)) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory to watch file %s", file_path);
+        result = __FAILURE__;
+    }
+    else
+    {
+        memcpy(file->dir, (slash == NULL) ? "." : file_path, dir_len);
+        file->dir[dir_len] = '\0';
+        file->name = file->dir + dir_len + 1;
+        memcpy(file->dir + dir_len + 1, name, name_len + 1);
+        // watching the same directory again returns the same descriptor
+        if ((file->wd = inotify_add_watch(watch->inotify_fd, file->dir, FILE_WATCH_EVENTS)) < 0)
+        {
+            LOG_ERROR("Could not watch directory %s. Errno %d '%s'", file->dir, errno, strerror(errno));
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static bool is_watched_file(const HSM_FILE_WATCH *watch, const struct inotify_event *event)
+{
+    bool result = false;
+    size_t idx;
+
+    for (idx = 0; (idx < watch->num_files) && !result; idx++)
+    {
+        result = (event->wd == watch->files[idx].wd) && (event->len != 0) &&
+                 (strcmp(event->name, watch->files[idx].name) == 0);
+    }
+
+    return result;
+}
+
+// drains the queued events and reports whether any of them was for a watched file
+static bool read_watch_events(HSM_FILE_WATCH *watch)
+{
+    bool result = false;
+    union
+    {
+        struct inotify_event event;
+        char data[FILE_WATCH_EVENT_BUFFER_SIZE];
+    } buffer;
+    ssize_t length;
+
+    while ((length = read(watch->inotify_fd, buffer.data, sizeof(buffer.data))) > 0)
+    {
+        ssize_t offset = 0;
+        while (offset < length)
+        {
+            const struct inotify_event *event = (const struct inotify_event*)(buffer.data + offset);
+            if ((event->mask & IN_Q_OVERFLOW) != 0)
+            {
+                // events were lost so any of the files may have changed
+                result = true;
+            }
+            else if ((event->mask & IN_IGNORED) != 0)
+            {
+                LOG_ERROR("A directory of the watched files was removed, changes are no longer detected");
+            }
+            else if (is_watched_file(watch, event))
+            {
+                result = true;
+            }
+            offset += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    return result;
+}
+
+static int file_watch_thread(void *context)
+{
+    HSM_FILE_WATCH *watch = (HSM_FILE_WATCH*)context;
+    long long settle_deadline = -1;
+    bool stop = false;
+
+    while (!stop)
+    {
+        struct pollfd fds[2];
+        int timeout = -1;
+        int status;
+
+        if (settle_deadline >= 0)
+        {
+            long long remaining = settle_deadline - get_monotonic_ms();
+            timeout = (remaining > 0) ? (int)remaining : 0;
+        }
+        fds[0].fd = watch->inotify_fd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = watch->stop_fds[0];
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+
+        if ((status = poll(fds, 2, timeout)) < 0)
+        {
+            if (errno != EINTR)
+            {
+                LOG_ERROR("Could not wait for file changes. Errno %d '%s'", errno, strerror(errno));
+                stop = true;
+            }
+        }
+        else if (fds[1].revents != 0)
+        {
+            stop = true;
+        }
+        else if (status == 0)
+        {
+            settle_deadline = -1;
+            watch->on_change(watch->context);
+        }
+        else if (read_watch_events(watch))
+        {
+            // every change to a watched file restarts the settle period
+            settle_deadline = get_monotonic_ms() + FILE_WATCH_SETTLE_MS;
+        }
+    }
+
+    return 0;
+}
+
+//##############################################################################
+// File watch API
+//##############################################################################
+HSM_FILE_WATCH_HANDLE hsm_file_watch_start
+(
+    const char * const *file_paths,
+    size_t num_files,
+    HSM_FILE_WATCH_CALLBACK on_change,
+    void *context
+)
+{
+    HSM_FILE_WATCH *result;
+    size_t idx;
+
+    if ((file_paths == NULL) || (num_files == 0) || (on_change == NULL))
+    {
+        LOG_ERROR("Invalid parameters");
+        result = NULL;
+    }
+    else if ((result = (HSM_FILE_WATCH*)calloc(1, sizeof(HSM_FILE_WATCH))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory to watch files");
+    }
+    else
+    {
+        result->stop_fds[0] = -1;
+        result->stop_fds[1] = -1;
+        result->on_change = on_change;
+        result->context = context;
+        if ((result->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0)
+        {
+            LOG_ERROR("Could not initialize inotify. Errno %d '%s'", errno, strerror(errno));
+            destroy_watch(result);
+            result = NULL;
+        }
+        else if (pipe(result->stop_fds) != 0)
+        {
+            LOG_ERROR("Could not create file watch stop pipe. Errno %d '%s'", errno, strerror(errno));
+            destroy_watch(result);
+            result = NULL;
+        }
+        else if ((result->files = (WATCHED_FILE*)calloc(num_files, sizeof(WATCHED_FILE))) == NULL)
+        {
+            LOG_ERROR("Could not allocate memory to watch files");
+            destroy_watch(result);
+            result = NULL;
+        }
+        else
+        {
+            int status = 0;
+            for (idx = 0; (idx < num_files) && (status == 0); idx++)
+            {
+                if ((file_paths[idx] == NULL) || (file_paths[idx][0] == '\0'))
+                {
+                    LOG_ERROR("Invalid file path at index %zu", idx);
+                    status = __FAILURE__;
+                }
+                else
+                {
+                    // counted first so a partially initialized file is released
+                    result->num_files++;
+                    status = add_watched_file(result, &result->files[idx], file_paths[idx]);
+                }
+            }
+
+            if (status != 0)
+            {
+                destroy_watch(result);
+                result = NULL;
+            }
+            else if (ThreadAPI_Create(&result->thread, file_watch_thread, result) != THREADAPI_OK)
+            {
+                LOG_ERROR("Could not create file watch thread");
+                destroy_watch(result);
+                result = NULL;
+            }
+        }
+    }
+
+    return result;
+}
+
+void hsm_file_watch_stop(HSM_FILE_WATCH_HANDLE watch)
+{
+    if (watch == NULL)
+    {
+        LOG_ERROR("Invalid file watch handle");
+    }
+    else
+    {
+        int thread_result;
+        const char stop = 0;
+        if (write(watch->stop_fds[1], &stop, 1) != 1)
+        {
+            LOG_ERROR("Could not signal the file watch thread to stop. Errno %d '%s'", errno, strerror(errno));
+        }
+        else if (ThreadAPI_Join(watch->thread, &thread_result) != THREADAPI_OK)
+        {
+            LOG_ERROR("Could not join the file watch thread");
+        }
+        else
+        {
+            destroy_watch(watch);
+        }
+    }
+}
+#else
+//##############################################################################
+// File watch API
+//##############################################################################
+HSM_FILE_WATCH_HANDLE hsm_file_watch_start
+(
+    const char * const *file_paths,
+    size_t num_files,
+    HSM_FILE_WATCH_CALLBACK on_change,
+    void *context
+)
+{
+    (void)file_paths;
+    (void)num_files;
+    (void)on_change;
+    (void)context;
+    LOG_INFO("Watching files for changes is not supported on this platform");
+    return NULL;
+}
+
+void hsm_file_watch_stop(HSM_FILE_WATCH_HANDLE watch)
+{
+    (void)watch;
+}
+#endif
@@ -0,0 +1,39 @@
+#ifndef HSM_FILE_WATCH_H
+#define HSM_FILE_WATCH_H
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stddef.h>
+#endif
+
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+/**
+ * File change watcher.
+ *
+ * Watches a set of files from a dedicated thread and invokes the callback on
+ * that thread once the files have changed and then stayed unchanged for a
+ * short settle period, so that a rotation touching several of the files
+ * results in a single callback. The directories holding the files are what
+ * is actually watched, which means that files replaced by a rename are
+ * picked up as well as files rewritten in place.
+ *
+ * Watching is only supported on Linux where it is done with inotify without
+ * any polling. Elsewhere hsm_file_watch_start returns NULL.
+ *
+ * hsm_file_watch_stop waits for a callback that is in progress to return
+ * and must not be called from the callback.
+ */
+typedef struct HSM_FILE_WATCH_TAG* HSM_FILE_WATCH_HANDLE;
+typedef void (*HSM_FILE_WATCH_CALLBACK)(void *context);
+
+MOCKABLE_FUNCTION(, HSM_FILE_WATCH_HANDLE, hsm_file_watch_start, const char* const*, file_paths, size_t, num_files, HSM_FILE_WATCH_CALLBACK, on_change, void*, context);
+MOCKABLE_FUNCTION(, void, hsm_file_watch_stop, HSM_FILE_WATCH_HANDLE, watch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_FILE_WATCH_H
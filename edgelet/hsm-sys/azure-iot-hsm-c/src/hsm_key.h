@@ -41,6 +41,9 @@ MOCKABLE_FUNCTION(, int, generate_pki_cert_and_key_with_props, CERT_PROPS_HANDLE
                     const PKI_KEY_PROPS*, key_props);
 MOCKABLE_FUNCTION(, int, generate_encryption_key, unsigned char**, key, size_t*, key_size);
 MOCKABLE_FUNCTION(, int, verify_certificate, const char*, certificate, const char*, certificate_key, const char*, issuer_certificate, bool*, verify_status);
+MOCKABLE_FUNCTION(, int, verify_certificates, const char* const*, certificates, const char* const*, certificate_keys, size_t, num_certificates, const char*, issuer_certificate, bool*, verify_status, size_t, max_threads);
+MOCKABLE_FUNCTION(, int, verify_certificate_buffer, const char*, certificate, size_t, certificate_size, const char*, issuer_certificate, size_t, issuer_certificate_size, bool*, verify_status);
+MOCKABLE_FUNCTION(, void, clear_certificate_verification_cache);
 
 #ifdef __cplusplus
 }
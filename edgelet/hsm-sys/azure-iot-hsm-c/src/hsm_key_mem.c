@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "hsm_atomic.h"
+#include "hsm_key_mem.h"
+#include "hsm_lock.h"
+#include "hsm_log.h"
+#include "hsm_metrics.h"
+#include "hsm_slab.h"
+
+//##############################################################################
+// Data types
+//##############################################################################
+// object sizes of the size classes, key handles and symmetric keys fit in
+// the smaller classes and larger classes cover longer SAS keys
+static const size_t KEY_MEM_CLASS_SIZES[] = { 32, 64, 128, 256 };
+#define KEY_MEM_NUM_CLASSES (sizeof(KEY_MEM_CLASS_SIZES) / sizeof(KEY_MEM_CLASS_SIZES[0]))
+// secure slabs round this up to whole system pages
+#define KEY_MEM_OBJECTS_PER_PAGE 16
+
+// each size class has its own lock, created on first use like its slab
+struct KEY_MEM_CLASS_TAG
+{
+    LOCK_HANDLE volatile lock;
+    HSM_SLAB_HANDLE slab;
+#if defined(HSM_LOCK_PROFILING)
+    HSM_ATOMIC_LONG users;
+#endif
+};
+typedef struct KEY_MEM_CLASS_TAG KEY_MEM_CLASS;
+
+// slabs are created on first use and live for the lifetime of the process
+static KEY_MEM_CLASS g_key_mem_classes[KEY_MEM_NUM_CLASSES];
+
+// memset through a volatile pointer so that zeroizing memory which is
+// about to be released cannot be optimized away
+static void* (* const volatile g_zeroize)(void*, int, size_t) = memset;
+
+//##############################################################################
+// Key memory helpers
+//##############################################################################
+static int lock_class(KEY_MEM_CLASS *mem_class)
+{
+    int result;
+    LOCK_HANDLE lock = hsm_lock_get(&mem_class->lock);
+#if defined(HSM_LOCK_PROFILING)
+    bool contended = (hsm_atomic_inc(&mem_class->users) > 1);
+    uint64_t start = contended ? hsm_metrics_now() : 0;
+#endif
+
+    if (lock == NULL)
+    {
+        LOG_ERROR("Could not create the key memory lock");
+        result = __FAILURE__;
+    }
+    else if (Lock(lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not acquire the key memory lock");
+        result = __FAILURE__;
+    }
+    else
+    {
+#if defined(HSM_LOCK_PROFILING)
+        hsm_metrics_lock_wait(HSM_METRICS_LOCK_KEY_MEM_CLASS, start, contended);
+#endif
+        result = 0;
+    }
+
+#if defined(HSM_LOCK_PROFILING)
+    if (result != 0)
+    {
+        (void)hsm_atomic_dec(&mem_class->users);
+    }
+#endif
+    return result;
+}
+
+static void unlock_class(KEY_MEM_CLASS *mem_class)
+{
+    if (Unlock(mem_class->lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not release the key memory lock");
+    }
+#if defined(HSM_LOCK_PROFILING)
+    (void)hsm_atomic_dec(&mem_class->users);
+#endif
+}
+
+static KEY_MEM_CLASS* get_size_class(size_t size, size_t *class_size)
+{
+    KEY_MEM_CLASS *result = NULL;
+    size_t idx;
+
+    for (idx = 0; idx < KEY_MEM_NUM_CLASSES; idx++)
+    {
+        if (size <= KEY_MEM_CLASS_SIZES[idx])
+        {
+            result = &g_key_mem_classes[idx];
+            *class_size = KEY_MEM_CLASS_SIZES[idx];
+            break;
+        }
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Key memory API
+//##############################################################################
+void* hsm_key_mem_alloc(size_t size)
+{
+    void *result;
+    size_t class_size = 0;
+    KEY_MEM_CLASS *mem_class;
+
+    if (size == 0)
+    {
+        LOG_ERROR("Invalid key memory size");
+        result = NULL;
+    }
+    else if ((mem_class = get_size_class(size, &class_size)) == NULL)
+    {
+        if ((result = malloc(size)) == NULL)
+        {
+            LOG_ERROR("Could not allocate %zu bytes of key memory", size);
+        }
+    }
+    else if (lock_class(mem_class) != 0)
+    {
+        result = NULL;
+    }
+    else
+    {
+        if ((mem_class->slab == NULL) &&
+            ((mem_class->slab = hsm_slab_create_secure(class_size, KEY_MEM_OBJECTS_PER_PAGE)) == NULL))
+        {
+            LOG_ERROR("Could not create key memory slab for size %zu", class_size);
+            result = NULL;
+        }
+        else if ((result = hsm_slab_alloc(mem_class->slab)) == NULL)
+        {
+            LOG_ERROR("Could not allocate %zu bytes of key memory", size);
+        }
+        unlock_class(mem_class);
+    }
+
+    return result;
+}
+
+void hsm_key_mem_free(void *ptr, size_t size)
+{
+    size_t class_size = 0;
+    KEY_MEM_CLASS *mem_class;
+
+    if (ptr == NULL)
+    {
+        LOG_ERROR("Invalid parameters");
+    }
+    else if ((mem_class = get_size_class(size, &class_size)) == NULL)
+    {
+        hsm_key_mem_cleanse(ptr, size);
+        free(ptr);
+    }
+    else if (lock_class(mem_class) != 0)
+    {
+        // the object cannot be returned to its slab, it is only zeroized
+        hsm_key_mem_cleanse(ptr, size);
+    }
+    else
+    {
+        // the slab zeroizes the object
+        hsm_slab_free(mem_class->slab, ptr);
+        unlock_class(mem_class);
+    }
+}
+
+void hsm_key_mem_cleanse(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+    {
+        LOG_ERROR("Invalid parameters");
+    }
+    else
+    {
+        (void)g_zeroize(ptr, 0, size);
+    }
+}
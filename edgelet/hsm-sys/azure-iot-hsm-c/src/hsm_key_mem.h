@@ -0,0 +1,39 @@
+#ifndef HSM_KEY_MEM_H
+#define HSM_KEY_MEM_H
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stddef.h>
+#endif
+
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+/**
+ * Key material allocator.
+ *
+ * Small allocations holding keys or key handles are served from a set of
+ * process wide secure slabs, one per size class, so that creating a key per
+ * sign or encrypt call does not go to the heap and key material is kept in
+ * memory that is locked and zeroized when released. Allocations larger than
+ * the biggest size class fall back to the heap and are still zeroized.
+ *
+ * Memory must be released with hsm_key_mem_free using the size it was
+ * allocated with. Both calls are thread safe and memory may be released by
+ * a thread other than the one that allocated it.
+ *
+ * hsm_key_mem_cleanse zeroizes memory that holds key material in a way the
+ * compiler cannot optimize away. It is the one zeroizing helper of the
+ * library and also serves memory owned by other allocators, such as a
+ * derived key returned by a sign call or the state of a random generator.
+ */
+MOCKABLE_FUNCTION(, void*, hsm_key_mem_alloc, size_t, size);
+MOCKABLE_FUNCTION(, void, hsm_key_mem_free, void*, ptr, size_t, size);
+MOCKABLE_FUNCTION(, void, hsm_key_mem_cleanse, void*, ptr, size_t, size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_KEY_MEM_H
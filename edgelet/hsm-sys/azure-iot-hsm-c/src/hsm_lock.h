@@ -0,0 +1,51 @@
+#ifndef HSM_LOCK_H
+#define HSM_LOCK_H
+
+#include "azure_c_shared_utility/lock.h"
+#include "hsm_atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_MSC_VER)
+#define HSM_LOCK_INLINE __inline
+#else
+#define HSM_LOCK_INLINE inline
+#endif
+
+/**
+ * Returns the lock stored in lock, creating it on first use, or NULL if it
+ * could not be created. This is meant for the static locks of modules which
+ * have no global init, such locks live for the lifetime of the process.
+ */
+static HSM_LOCK_INLINE LOCK_HANDLE hsm_lock_get(LOCK_HANDLE volatile *lock)
+{
+    LOCK_HANDLE result = (LOCK_HANDLE)hsm_atomic_load_ptr((void * volatile *)lock);
+
+    if (result == NULL)
+    {
+        LOCK_HANDLE created;
+        if ((created = Lock_Init()) != NULL)
+        {
+            if (hsm_atomic_cas_ptr((void * volatile *)lock, NULL, created))
+            {
+                result = created;
+            }
+            else
+            {
+                // another thread created the lock first
+                (void)Lock_Deinit(created);
+                result = (LOCK_HANDLE)hsm_atomic_load_ptr((void * volatile *)lock);
+            }
+        }
+    }
+
+    return result;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_LOCK_H
@@ -1,34 +1,401 @@
+#if defined __linux__ && !defined _GNU_SOURCE
+    // for gmtime_r with strict C standard flags
+    #define _GNU_SOURCE
+#endif
+
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 
+#include "hsm_atomic.h"
 #include "hsm_log.h"
+
+#if !defined(_MSC_VER)
+    #include <pthread.h>
+    #define HSM_THREAD_LOCAL __thread
+#endif
+
 #define MAX_LOG_SIZE 256
+// room for the prefix of a log line in front of the message
+#define MAX_LOG_LINE_SIZE (MAX_LOG_SIZE + 512)
 
-static int log_level = LVL_ERROR;
+struct LOG_RECORD_TAG
+{
+    int level;
+    const char *file;
+    const char *function;
+    int line;
+    time_t timestamp;
+    char message[MAX_LOG_SIZE];
+};
+typedef struct LOG_RECORD_TAG LOG_RECORD;
 
-void set_log_level(int level)
+int hsm_log_level = LVL_ERROR;
+
+static LOG_CALLBACK g_log_callback = NULL;
+static void *g_log_callback_context = NULL;
+
+static void format_record(LOG_RECORD *record, int level, const char* file, const char* function, int line, const char* fmt_str, va_list args)
 {
-    if ((LVL_DEBUG <= level) && (level <= LVL_ERROR)) {
-        log_level = level;
+    record->level = level;
+    record->file = file;
+    record->function = function;
+    record->line = line;
+    record->timestamp = time(NULL);
+    (void)vsnprintf(record->message, MAX_LOG_SIZE, fmt_str, args);
+}
+
+static void write_record(const LOG_RECORD *record)
+{
+    static const char levels[3][5] = {"DBUG", "INFO", "ERR!"};
+    static const int  syslog_levels[3] = { 7, 6, 3 };
+    char time_buf[sizeof("2018-05-24T00:00:00Z")];
+    struct tm now;
+
+#if defined(_MSC_VER)
+    if ((gmtime_s(&now, &record->timestamp) != 0) ||
+#else
+    if ((gmtime_r(&record->timestamp, &now) == NULL) ||
+#endif
+        (strftime(time_buf, sizeof(time_buf), "%FT%TZ", &now) == 0))
+    {
+        time_buf[0] = '\0';
+    }
+
+    if (g_log_callback != NULL)
+    {
+        char line[MAX_LOG_LINE_SIZE];
+        (void)snprintf(line, sizeof(line), "<%d>%s [%s] (%s:%s:%d) %s", syslog_levels[record->level], time_buf,
+                       levels[record->level], record->file, record->function, record->line, record->message);
+        g_log_callback(record->level, line, g_log_callback_context);
+    }
+    else
+    {
+        printf("<%d>%s [%s] (%s:%s:%d) %s\r\n", syslog_levels[record->level], time_buf,
+               levels[record->level], record->file, record->function, record->line, record->message);
+    }
+}
+
+#if !defined(_MSC_VER)
+//##############################################################################
+// Background logging
+//##############################################################################
+// must be a power of 2
+#define LOG_RING_SLOTS 128
+
+#define DRAIN_NOT_STARTED 0
+#define DRAIN_STARTING 1
+#define DRAIN_RUNNING 2
+#define DRAIN_STOPPING 3
+#define DRAIN_FAILED 4
+
+// written to by a single thread and read by whichever thread holds the drain lock
+struct LOG_RING_TAG
+{
+    // next record written by the owning thread
+    HSM_ATOMIC_LONG head;
+    // next record to be written out
+    HSM_ATOMIC_LONG tail;
+    HSM_ATOMIC_LONG dropped;
+    long dropped_reported;
+    // cleared when the owning thread exits so another thread can take the ring
+    HSM_ATOMIC_LONG in_use;
+    struct LOG_RING_TAG *next;
+    LOG_RECORD records[LOG_RING_SLOTS];
+};
+typedef struct LOG_RING_TAG LOG_RING;
+
+// rings are only ever added, at the head, and are reused rather than freed
+static void * volatile g_rings = NULL;
+static pthread_mutex_t g_rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+// the drain thread sleeps on the condition until a message is logged or it is stopped
+static pthread_mutex_t g_wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_wake_cond = PTHREAD_COND_INITIALIZER;
+static HSM_ATOMIC_LONG g_wake_pending = 0;
+static bool g_stop_drain = false;
+static pthread_t g_drain_thread;
+static pthread_key_t g_ring_key;
+static bool g_ring_key_created = false;
+static HSM_ATOMIC_LONG g_drain_state = DRAIN_NOT_STARTED;
+static bool g_exit_flush_registered = false;
+static HSM_THREAD_LOCAL LOG_RING *g_thread_ring = NULL;
+// set while the thread holds the drain lock, the callback may log as well
+static HSM_THREAD_LOCAL bool g_draining = false;
+
+static void release_ring(void *value)
+{
+    LOG_RING *ring = (LOG_RING*)value;
+    g_thread_ring = NULL;
+    hsm_atomic_store(&ring->in_use, 0);
+}
+
+static void drain_rings(void)
+{
+    LOG_RING *ring;
+
+    for (ring = (LOG_RING*)hsm_atomic_load_ptr(&g_rings); ring != NULL; ring = ring->next)
+    {
+        long tail = hsm_atomic_load(&ring->tail);
+        long head = hsm_atomic_load(&ring->head);
+        long dropped = hsm_atomic_load(&ring->dropped);
+
+        while (tail != head)
+        {
+            write_record(&ring->records[(unsigned long)tail & (LOG_RING_SLOTS - 1)]);
+            hsm_atomic_store(&ring->tail, ++tail);
+        }
+
+        if (dropped != ring->dropped_reported)
+        {
+            LOG_RECORD notice;
+            notice.level = LVL_ERROR;
+            notice.file = __FILE__;
+            notice.function = __func__;
+            notice.line = __LINE__;
+            notice.timestamp = time(NULL);
+            (void)snprintf(notice.message, sizeof(notice.message), "%ld log messages were dropped", dropped - ring->dropped_reported);
+            write_record(&notice);
+            ring->dropped_reported = dropped;
+        }
+    }
+    (void)fflush(stdout);
+}
+
+static void* drain_thread(void *context)
+{
+    bool stopping = false;
+    (void)context;
+
+    while (!stopping)
+    {
+        (void)pthread_mutex_lock(&g_wake_lock);
+        while ((hsm_atomic_load(&g_wake_pending) == 0) && !g_stop_drain)
+        {
+            (void)pthread_cond_wait(&g_wake_cond, &g_wake_lock);
+        }
+        stopping = g_stop_drain;
+        // cleared before draining so a message logged meanwhile wakes the thread again
+        hsm_atomic_store(&g_wake_pending, 0);
+        (void)pthread_mutex_unlock(&g_wake_lock);
+        log_flush();
+    }
+
+    return NULL;
+}
+
+// only the first message logged since the drain thread last woke up signals it
+static void wake_drain_thread(void)
+{
+    if ((hsm_atomic_load(&g_wake_pending) == 0) && hsm_atomic_cas(&g_wake_pending, 0, 1))
+    {
+        (void)pthread_mutex_lock(&g_wake_lock);
+        (void)pthread_cond_signal(&g_wake_cond);
+        (void)pthread_mutex_unlock(&g_wake_lock);
+    }
+}
+
+// hosts that exit without calling a deinit function still get queued messages
+static void flush_at_exit(void)
+{
+    log_flush();
+}
+
+static bool start_drain_thread(void)
+{
+    if ((hsm_atomic_load(&g_drain_state) == DRAIN_NOT_STARTED) &&
+        hsm_atomic_cas(&g_drain_state, DRAIN_NOT_STARTED, DRAIN_STARTING))
+    {
+        if (!g_exit_flush_registered)
+        {
+            g_exit_flush_registered = (atexit(flush_at_exit) == 0);
+        }
+
+        if (!g_ring_key_created)
+        {
+            g_ring_key_created = (pthread_key_create(&g_ring_key, release_ring) == 0);
+        }
+
+        if ((!g_ring_key_created) || (pthread_create(&g_drain_thread, NULL, drain_thread, NULL) != 0))
+        {
+            hsm_atomic_store(&g_drain_state, DRAIN_FAILED);
+        }
+        else
+        {
+            hsm_atomic_store(&g_drain_state, DRAIN_RUNNING);
+        }
+    }
+
+    return hsm_atomic_load(&g_drain_state) == DRAIN_RUNNING;
+}
+
+static LOG_RING* get_thread_ring(void)
+{
+    LOG_RING *ring = g_thread_ring;
+
+    if (ring == NULL)
+    {
+        // take over the ring of a thread that has exited before adding one
+        for (ring = (LOG_RING*)hsm_atomic_load_ptr(&g_rings);
+             (ring != NULL) && !hsm_atomic_cas(&ring->in_use, 0, 1);
+             ring = ring->next)
+        {
+        }
+
+        if ((ring == NULL) && ((ring = (LOG_RING*)calloc(1, sizeof(LOG_RING))) != NULL))
+        {
+            ring->in_use = 1;
+            (void)pthread_mutex_lock(&g_rings_lock);
+            ring->next = (LOG_RING*)g_rings;
+            hsm_atomic_store_ptr(&g_rings, ring);
+            (void)pthread_mutex_unlock(&g_rings_lock);
+        }
+
+        if (ring != NULL)
+        {
+            g_thread_ring = ring;
+            (void)pthread_setspecific(g_ring_key, ring);
+        }
+    }
+
+    return ring;
+}
+
+void set_log_callback(LOG_CALLBACK callback, void* context)
+{
+    // messages logged so far go to the previous callback
+    log_flush();
+    if (g_draining)
+    {
+        g_log_callback = callback;
+        g_log_callback_context = context;
+    }
+    else
+    {
+        (void)pthread_mutex_lock(&g_drain_lock);
+        g_log_callback = callback;
+        g_log_callback_context = context;
+        (void)pthread_mutex_unlock(&g_drain_lock);
+    }
+}
+
+void log_flush(void)
+{
+    if (!g_draining)
+    {
+        (void)pthread_mutex_lock(&g_drain_lock);
+        g_draining = true;
+        drain_rings();
+        g_draining = false;
+        (void)pthread_mutex_unlock(&g_drain_lock);
+    }
+}
+
+void log_shutdown(void)
+{
+    if ((hsm_atomic_load(&g_drain_state) == DRAIN_RUNNING) &&
+        hsm_atomic_cas(&g_drain_state, DRAIN_RUNNING, DRAIN_STOPPING))
+    {
+        (void)pthread_mutex_lock(&g_wake_lock);
+        g_stop_drain = true;
+        (void)pthread_cond_signal(&g_wake_cond);
+        (void)pthread_mutex_unlock(&g_wake_lock);
+        (void)pthread_join(g_drain_thread, NULL);
+        g_stop_drain = false;
+
+        // rings of threads that exit from now on are not released for reuse
+        (void)pthread_key_delete(g_ring_key);
+        g_ring_key_created = false;
+        hsm_atomic_store(&g_drain_state, DRAIN_NOT_STARTED);
     }
+    log_flush();
+}
+
+static bool is_ring_full(LOG_RING *ring)
+{
+    return (unsigned long)(hsm_atomic_load(&ring->head) - hsm_atomic_load(&ring->tail)) >= LOG_RING_SLOTS;
 }
 
 void log_msg(int level, const char* file, const char* function, int line, const char* fmt_str, ...)
 {
-    static char levels[3][5] = {"DBUG", "INFO", "ERR!"};
-    static int  syslog_levels[3] = { 7, 6, 3 };
+    if ((LVL_DEBUG <= level) && (level <= LVL_ERROR) && (level >= hsm_log_level)) {
+        // errors are written out before returning, they are often the last
+        // thing logged before the process aborts
+        LOG_RING *ring = ((level < LVL_ERROR) && start_drain_thread()) ? get_thread_ring() : NULL;
+        va_list args;
+        va_start (args, fmt_str);
+        if (ring == NULL) {
+            LOG_RECORD record;
+            format_record(&record, level, file, function, line, fmt_str, args);
+            if (g_draining) {
+                write_record(&record);
+            }
+            else {
+                // messages still in the rings, while the drain thread is
+                // stopping, are written out first to keep them in order
+                (void)pthread_mutex_lock(&g_drain_lock);
+                g_draining = true;
+                drain_rings();
+                write_record(&record);
+                (void)fflush(stdout);
+                g_draining = false;
+                (void)pthread_mutex_unlock(&g_drain_lock);
+            }
+        }
+        else {
+            // a thread logging faster than the drain thread keeps up writes
+            // out the backlog itself rather than losing messages
+            if (is_ring_full(ring)) {
+                log_flush();
+            }
+            if (is_ring_full(ring)) {
+                (void)hsm_atomic_inc(&ring->dropped);
+            }
+            else {
+                long head = hsm_atomic_load(&ring->head);
+                format_record(&ring->records[(unsigned long)head & (LOG_RING_SLOTS - 1)], level, file, function, line, fmt_str, args);
+                hsm_atomic_store(&ring->head, head + 1);
+                wake_drain_thread();
+            }
+        }
+        va_end (args);
+    }
+}
+#else
+void set_log_callback(LOG_CALLBACK callback, void* context)
+{
+    g_log_callback = callback;
+    g_log_callback_context = context;
+}
+
+void log_flush(void)
+{
+    (void)fflush(stdout);
+}
+
+void log_shutdown(void)
+{
+    log_flush();
+}
 
-    if (level >= log_level) {
-        time_t now;
-        char buffer[MAX_LOG_SIZE];
-        char time_buf[sizeof("2018-05-24T00:00:00Z")];
-        time(&now);
-        strftime(time_buf, sizeof(time_buf), "%FT%TZ", gmtime(&now));
+void log_msg(int level, const char* file, const char* function, int line, const char* fmt_str, ...)
+{
+    if ((LVL_DEBUG <= level) && (level <= LVL_ERROR) && (level >= hsm_log_level)) {
+        LOG_RECORD record;
         va_list args;
         va_start (args, fmt_str);
-        vsnprintf(buffer, MAX_LOG_SIZE, fmt_str, args);
-        printf("<%d>%s [%s] (%s:%s:%d) %s\r\n", syslog_levels[level], time_buf, levels[level], file, function, line, buffer);
+        format_record(&record, level, file, function, line, fmt_str, args);
+        write_record(&record);
         va_end (args);
     }
 }
+#endif
+
+void set_log_level(int level)
+{
+    if ((LVL_DEBUG <= level) && (level <= LVL_ERROR)) {
+        hsm_log_level = level;
+    }
+}
@@ -5,11 +5,53 @@
 #define LVL_INFO 1
 #define LVL_ERROR 2
 
-#define LOG_ERROR(fmt, ...) log_msg(LVL_ERROR, __FILE__, __func__, __LINE__, fmt, ##__VA_ARGS__)
-#define LOG_DEBUG(fmt, ...) log_msg(LVL_DEBUG, __FILE__, __func__, __LINE__, fmt, ##__VA_ARGS__)
-#define LOG_INFO(fmt, ...)  log_msg(LVL_INFO, __FILE__, __func__, __LINE__, fmt, ##__VA_ARGS__)
+/**
+ * The level is checked before the call so the arguments of filtered
+ * messages are never evaluated or formatted.
+ */
+#define LOG_ERROR(fmt, ...) do { if (LVL_ERROR >= hsm_log_level) { log_msg(LVL_ERROR, __FILE__, __func__, __LINE__, fmt, ##__VA_ARGS__); } } while (0)
+#define LOG_DEBUG(fmt, ...) do { if (LVL_DEBUG >= hsm_log_level) { log_msg(LVL_DEBUG, __FILE__, __func__, __LINE__, fmt, ##__VA_ARGS__); } } while (0)
+#define LOG_INFO(fmt, ...)  do { if (LVL_INFO >= hsm_log_level) { log_msg(LVL_INFO, __FILE__, __func__, __LINE__, fmt, ##__VA_ARGS__); } } while (0)
+
+/**
+ * Receives each log line, without a line terminator, in place of stdout.
+ */
+typedef void (*LOG_CALLBACK)(int level, const char* line, void* context);
+
+extern int hsm_log_level;
 
 extern void set_log_level(int level);
+
+/**
+ * Messages are formatted into a ring buffer owned by the logging thread
+ * and written out by a background thread, so logging does not wait for
+ * stdout or the callback unless the thread fills its ring, in which case
+ * it writes out the backlog itself. Messages from different threads may
+ * be written out of order. Error messages, and all messages where
+ * background logging is not supported, are written out synchronously
+ * after the messages queued before them. Messages still queued when the
+ * process exits are written out by an exit handler.
+ *
+ * The callback is usually invoked from the background thread. Messages it
+ * logs itself are dropped once its thread's ring is full and the number
+ * dropped is reported.
+ */
+extern void set_log_callback(LOG_CALLBACK callback, void* context);
+
+/**
+ * Writes out every message logged so far.
+ */
+extern void log_flush(void);
+
+/**
+ * Stops the background thread and writes out every message logged so far.
+ * The deinit functions of the interfaces call it, so the thread does not
+ * outlive the library. A message logged afterwards starts the thread again.
+ * A child process forked while the thread runs only writes out its messages
+ * when its ring fills up or log_flush is called.
+ */
+extern void log_shutdown(void);
+
 extern void log_msg(int level, const char* file, const char* function, int line, const char* fmt_str, ...)
 #if defined(__GNUC__) || defined(__clang__)
     __attribute__ ((format (printf, 5, 6)));
@@ -0,0 +1,995 @@
+#if defined __linux__ && !defined _GNU_SOURCE
+    // for clock_gettime with strict C standard flags
+    #define _GNU_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hsm_alloc.h"
+#include "hsm_atomic.h"
+#include "hsm_client_data.h"
+#include "hsm_client_store.h"
+#include "hsm_log.h"
+#include "hsm_metrics.h"
+
+#if defined(_MSC_VER)
+    #include <windows.h>
+    #define HSM_THREAD_LOCAL __declspec(thread)
+#else
+    #include <pthread.h>
+    #include <time.h>
+    #define HSM_THREAD_LOCAL __thread
+#endif
+
+//##############################################################################
+// Data types
+//##############################################################################
+// latencies below 2^HISTOGRAM_SUB_BUCKET_BITS ns have a bucket each, above
+// that every power of 2 is split into 2^HISTOGRAM_SUB_BUCKET_BITS buckets
+#define HISTOGRAM_SUB_BUCKET_BITS 2
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+
+struct OPERATION_COUNTERS_TAG
+{
+    HSM_ATOMIC_COUNTER count;
+    HSM_ATOMIC_COUNTER errors;
+    HSM_ATOMIC_COUNTER total_ns;
+    HSM_ATOMIC_COUNTER max_ns;
+    HSM_ATOMIC_COUNTER buckets[HSM_METRICS_NUM_BUCKETS];
+    HSM_ATOMIC_COUNTER allocations;
+    HSM_ATOMIC_COUNTER allocated_bytes;
+    HSM_ATOMIC_COUNTER max_peak_bytes;
+};
+typedef struct OPERATION_COUNTERS_TAG OPERATION_COUNTERS;
+
+struct CACHE_COUNTERS_TAG
+{
+    HSM_ATOMIC_COUNTER hits;
+    HSM_ATOMIC_COUNTER misses;
+};
+typedef struct CACHE_COUNTERS_TAG CACHE_COUNTERS;
+
+struct LOCK_COUNTERS_TAG
+{
+    HSM_ATOMIC_COUNTER acquisitions;
+    HSM_ATOMIC_COUNTER contended;
+    HSM_ATOMIC_COUNTER total_wait_ns;
+    HSM_ATOMIC_COUNTER max_wait_ns;
+    HSM_ATOMIC_COUNTER buckets[HSM_METRICS_NUM_BUCKETS];
+};
+typedef struct LOCK_COUNTERS_TAG LOCK_COUNTERS;
+
+// counters of a single thread, only that thread writes to them
+struct METRICS_BLOCK_TAG
+{
+    // cleared when the owning thread exits so another thread can take the
+    // block over, counts are never reset
+    HSM_ATOMIC_LONG in_use;
+    struct METRICS_BLOCK_TAG *next;
+    OPERATION_COUNTERS operations[HSM_METRICS_NUM_OPERATIONS];
+    CACHE_COUNTERS caches[HSM_METRICS_NUM_CACHES];
+    LOCK_COUNTERS locks[HSM_METRICS_NUM_LOCKS];
+};
+typedef struct METRICS_BLOCK_TAG METRICS_BLOCK;
+
+static const char* const OPERATION_NAMES[] =
+{
+    "crypto.create",
+    "crypto.destroy",
+    "crypto.get_random_bytes",
+    "crypto.create_master_encryption_key",
+    "crypto.destroy_master_encryption_key",
+    "crypto.create_certificate",
+    "crypto.destroy_certificate",
+    "crypto.encrypt_data",
+    "crypto.decrypt_data",
+    "crypto.get_trust_bundle",
+    "crypto.free_buffer",
+    "tpm.create",
+    "tpm.destroy",
+    "tpm.activate_identity_key",
+    "tpm.get_ek",
+    "tpm.get_srk",
+    "tpm.sign_with_identity",
+    "tpm.derive_and_sign_with_identity",
+    "tpm.free_buffer",
+    "tpm.import_sas_key",
+    "tpm.remove_sas_key",
+    "tpm.sign_with_sas_key",
+    "store.create",
+    "store.destroy",
+    "store.open",
+    "store.close",
+    "store.open_key",
+    "store.close_key",
+    "store.remove_key",
+    "store.insert_sas_key",
+    "store.insert_encryption_key",
+    "store.create_pki_cert",
+    "store.get_pki_cert",
+    "store.remove_pki_cert",
+    "store.insert_pki_trusted_cert",
+    "store.get_pki_trusted_certs",
+    "store.remove_pki_trusted_cert",
+    "pki.generate_key",
+    "pki.verify_certificate"
+};
+typedef char OPERATION_NAMES_CHECK[(sizeof(OPERATION_NAMES) / sizeof(OPERATION_NAMES[0]) == HSM_METRICS_NUM_OPERATIONS) ? 1 : -1];
+
+static const char* const CACHE_NAMES[] =
+{
+    "pki.verification_store",
+    "store.verified_manifest"
+};
+typedef char CACHE_NAMES_CHECK[(sizeof(CACHE_NAMES) / sizeof(CACHE_NAMES[0]) == HSM_METRICS_NUM_CACHES) ? 1 : -1];
+
+static const char* const LOCK_NAMES[] =
+{
+    "store.writer",
+    "store.rcu_synchronize",
+    "pki.verification_cache",
+    "key_mem.size_class",
+    "store.log"
+};
+typedef char LOCK_NAMES_CHECK[(sizeof(LOCK_NAMES) / sizeof(LOCK_NAMES[0]) == HSM_METRICS_NUM_LOCKS) ? 1 : -1];
+
+// blocks are only ever added, at the head, and are reused rather than freed
+static void * volatile g_blocks = NULL;
+static HSM_THREAD_LOCAL METRICS_BLOCK *g_thread_block = NULL;
+
+#if !defined(_MSC_VER)
+static pthread_once_t g_block_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_block_key;
+static bool g_block_key_created = false;
+#endif
+
+// interfaces whose calls are forwarded to by the timed interfaces
+static void * volatile g_crypto_target = NULL;
+static void * volatile g_tpm_target = NULL;
+static void * volatile g_tpm_sas_key_target = NULL;
+static void * volatile g_store_target = NULL;
+
+//##############################################################################
+// Metrics helpers
+//##############################################################################
+static uint64_t get_time_ns(void)
+{
+#if defined(_MSC_VER)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+    if (frequency.QuadPart == 0)
+    {
+        (void)QueryPerformanceFrequency(&frequency);
+    }
+    (void)QueryPerformanceCounter(&now);
+    return (uint64_t)((now.QuadPart / frequency.QuadPart) * 1000000000) +
+           (uint64_t)(((now.QuadPart % frequency.QuadPart) * 1000000000) / frequency.QuadPart);
+#else
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000) + (uint64_t)now.tv_nsec;
+#endif
+}
+
+static size_t get_bucket(uint64_t value)
+{
+    size_t result;
+
+    if (value < HISTOGRAM_SUB_BUCKETS)
+    {
+        result = (size_t)value;
+    }
+    else
+    {
+        unsigned int msb = 0;
+        uint64_t remaining = value;
+        while ((remaining >>= 1) != 0)
+        {
+            msb++;
+        }
+        result = HISTOGRAM_SUB_BUCKETS +
+                 ((msb - HISTOGRAM_SUB_BUCKET_BITS) * HISTOGRAM_SUB_BUCKETS) +
+                 (size_t)((value >> (msb - HISTOGRAM_SUB_BUCKET_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1));
+        if (result >= HSM_METRICS_NUM_BUCKETS)
+        {
+            result = HSM_METRICS_NUM_BUCKETS - 1;
+        }
+    }
+
+    return result;
+}
+
+#if !defined(_MSC_VER)
+static void release_block(void *value)
+{
+    METRICS_BLOCK *block = (METRICS_BLOCK*)value;
+    g_thread_block = NULL;
+    hsm_atomic_store(&block->in_use, 0);
+}
+
+static void create_block_key(void)
+{
+    g_block_key_created = (pthread_key_create(&g_block_key, release_block) == 0);
+}
+#endif
+
+static METRICS_BLOCK* get_thread_block(void)
+{
+    METRICS_BLOCK *block = g_thread_block;
+
+    if (block == NULL)
+    {
+        // take over the block of a thread that has exited before adding one
+        for (block = (METRICS_BLOCK*)hsm_atomic_load_ptr(&g_blocks);
+             (block != NULL) && !hsm_atomic_cas(&block->in_use, 0, 1);
+             block = block->next)
+        {
+        }
+
+        if ((block == NULL) && ((block = (METRICS_BLOCK*)calloc(1, sizeof(METRICS_BLOCK))) != NULL))
+        {
+            void *head;
+            block->in_use = 1;
+            do
+            {
+                head = hsm_atomic_load_ptr(&g_blocks);
+                block->next = (METRICS_BLOCK*)head;
+            } while (!hsm_atomic_cas_ptr(&g_blocks, head, block));
+        }
+
+        if (block != NULL)
+        {
+            g_thread_block = block;
+#if !defined(_MSC_VER)
+            // without a key the block stays with this thread after it exits
+            (void)pthread_once(&g_block_key_once, create_block_key);
+            if (g_block_key_created)
+            {
+                (void)pthread_setspecific(g_block_key, block);
+            }
+#endif
+        }
+    }
+
+    return block;
+}
+
+//##############################################################################
+// Recording API
+//##############################################################################
+uint64_t hsm_metrics_start(void)
+{
+#if defined(HSM_ALLOC_ACCOUNTING)
+    hsm_alloc_begin_scope();
+#endif
+    return get_time_ns();
+}
+
+uint64_t hsm_metrics_now(void)
+{
+    return get_time_ns();
+}
+
+void hsm_metrics_record(HSM_METRICS_OPERATION operation, uint64_t start, bool failed)
+{
+    METRICS_BLOCK *block;
+    uint64_t elapsed = get_time_ns() - start;
+#if defined(HSM_ALLOC_ACCOUNTING)
+    HSM_ALLOC_USAGE usage;
+
+    // ended even when the call is not counted so that scopes stay balanced
+    hsm_alloc_end_scope(&usage);
+#endif
+
+    if (((unsigned int)operation < HSM_METRICS_NUM_OPERATIONS) && ((block = get_thread_block()) != NULL))
+    {
+        OPERATION_COUNTERS *counters = &block->operations[operation];
+
+        hsm_counter_add(&counters->count, 1);
+        if (failed)
+        {
+            hsm_counter_add(&counters->errors, 1);
+        }
+        hsm_counter_add(&counters->total_ns, elapsed);
+        if (elapsed > hsm_counter_load(&counters->max_ns))
+        {
+            hsm_counter_store(&counters->max_ns, elapsed);
+        }
+        hsm_counter_add(&counters->buckets[get_bucket(elapsed)], 1);
+#if defined(HSM_ALLOC_ACCOUNTING)
+        hsm_counter_add(&counters->allocations, usage.allocations);
+        hsm_counter_add(&counters->allocated_bytes, usage.allocated_bytes);
+        if (usage.peak_bytes > hsm_counter_load(&counters->max_peak_bytes))
+        {
+            hsm_counter_store(&counters->max_peak_bytes, usage.peak_bytes);
+        }
+#endif
+    }
+}
+
+void hsm_metrics_cache_access(HSM_METRICS_CACHE cache, bool hit)
+{
+    METRICS_BLOCK *block;
+
+    if (((unsigned int)cache < HSM_METRICS_NUM_CACHES) && ((block = get_thread_block()) != NULL))
+    {
+        hsm_counter_add(hit ? &block->caches[cache].hits : &block->caches[cache].misses, 1);
+    }
+}
+
+void hsm_metrics_lock_wait(HSM_METRICS_LOCK lock, uint64_t start, bool contended)
+{
+    METRICS_BLOCK *block;
+
+    if (((unsigned int)lock < HSM_METRICS_NUM_LOCKS) && ((block = get_thread_block()) != NULL))
+    {
+        uint64_t elapsed = (start != 0) ? get_time_ns() - start : 0;
+        LOCK_COUNTERS *counters = &block->locks[lock];
+
+        hsm_counter_add(&counters->acquisitions, 1);
+        if (contended)
+        {
+            hsm_counter_add(&counters->contended, 1);
+        }
+        hsm_counter_add(&counters->total_wait_ns, elapsed);
+        if (elapsed > hsm_counter_load(&counters->max_wait_ns))
+        {
+            hsm_counter_store(&counters->max_wait_ns, elapsed);
+        }
+        hsm_counter_add(&counters->buckets[get_bucket(elapsed)], 1);
+    }
+}
+
+//##############################################################################
+// Snapshot API
+//##############################################################################
+HSM_METRICS* hsm_get_metrics(void)
+{
+    HSM_METRICS *result;
+
+    // the snapshot and its arrays are a single allocation
+    if ((result = (HSM_METRICS*)calloc(1, sizeof(HSM_METRICS) +
+                                          (HSM_METRICS_NUM_OPERATIONS * sizeof(HSM_OPERATION_METRICS)) +
+                                          (HSM_METRICS_NUM_CACHES * sizeof(HSM_CACHE_METRICS)) +
+                                          (HSM_METRICS_NUM_LOCKS * sizeof(HSM_LOCK_METRICS)))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for metrics");
+    }
+    else
+    {
+        METRICS_BLOCK *block;
+        size_t idx, bucket;
+
+        result->num_operations = HSM_METRICS_NUM_OPERATIONS;
+        result->operations = (HSM_OPERATION_METRICS*)(result + 1);
+        result->num_caches = HSM_METRICS_NUM_CACHES;
+        result->caches = (HSM_CACHE_METRICS*)(result->operations + HSM_METRICS_NUM_OPERATIONS);
+        result->num_locks = HSM_METRICS_NUM_LOCKS;
+        result->locks = (HSM_LOCK_METRICS*)(result->caches + HSM_METRICS_NUM_CACHES);
+        for (idx = 0; idx < HSM_METRICS_NUM_OPERATIONS; idx++)
+        {
+            result->operations[idx].name = OPERATION_NAMES[idx];
+        }
+        for (idx = 0; idx < HSM_METRICS_NUM_CACHES; idx++)
+        {
+            result->caches[idx].name = CACHE_NAMES[idx];
+        }
+        for (idx = 0; idx < HSM_METRICS_NUM_LOCKS; idx++)
+        {
+            result->locks[idx].name = LOCK_NAMES[idx];
+        }
+
+        for (block = (METRICS_BLOCK*)hsm_atomic_load_ptr(&g_blocks); block != NULL; block = block->next)
+        {
+            for (idx = 0; idx < HSM_METRICS_NUM_OPERATIONS; idx++)
+            {
+                OPERATION_COUNTERS *counters = &block->operations[idx];
+                HSM_OPERATION_METRICS *operation = &result->operations[idx];
+                uint64_t max_ns = hsm_counter_load(&counters->max_ns);
+                uint64_t max_peak_bytes = hsm_counter_load(&counters->max_peak_bytes);
+
+                operation->count += hsm_counter_load(&counters->count);
+                operation->errors += hsm_counter_load(&counters->errors);
+                operation->total_ns += hsm_counter_load(&counters->total_ns);
+                if (max_ns > operation->max_ns)
+                {
+                    operation->max_ns = max_ns;
+                }
+                for (bucket = 0; bucket < HSM_METRICS_NUM_BUCKETS; bucket++)
+                {
+                    operation->buckets[bucket] += hsm_counter_load(&counters->buckets[bucket]);
+                }
+                operation->allocations += hsm_counter_load(&counters->allocations);
+                operation->allocated_bytes += hsm_counter_load(&counters->allocated_bytes);
+                if (max_peak_bytes > operation->max_peak_bytes)
+                {
+                    operation->max_peak_bytes = max_peak_bytes;
+                }
+            }
+            for (idx = 0; idx < HSM_METRICS_NUM_CACHES; idx++)
+            {
+                result->caches[idx].hits += hsm_counter_load(&block->caches[idx].hits);
+                result->caches[idx].misses += hsm_counter_load(&block->caches[idx].misses);
+            }
+            for (idx = 0; idx < HSM_METRICS_NUM_LOCKS; idx++)
+            {
+                LOCK_COUNTERS *counters = &block->locks[idx];
+                HSM_LOCK_METRICS *lock = &result->locks[idx];
+                uint64_t max_wait_ns = hsm_counter_load(&counters->max_wait_ns);
+
+                lock->acquisitions += hsm_counter_load(&counters->acquisitions);
+                lock->contended += hsm_counter_load(&counters->contended);
+                lock->total_wait_ns += hsm_counter_load(&counters->total_wait_ns);
+                if (max_wait_ns > lock->max_wait_ns)
+                {
+                    lock->max_wait_ns = max_wait_ns;
+                }
+                for (bucket = 0; bucket < HSM_METRICS_NUM_BUCKETS; bucket++)
+                {
+                    lock->buckets[bucket] += hsm_counter_load(&counters->buckets[bucket]);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+void hsm_free_metrics(HSM_METRICS* metrics)
+{
+    free(metrics);
+}
+
+uint64_t hsm_metrics_bucket_upper_bound(size_t bucket)
+{
+    uint64_t result;
+
+    if (bucket >= HSM_METRICS_NUM_BUCKETS - 1)
+    {
+        result = UINT64_MAX;
+    }
+    else if (bucket < HISTOGRAM_SUB_BUCKETS)
+    {
+        result = (uint64_t)bucket;
+    }
+    else
+    {
+        size_t shift = (bucket - HISTOGRAM_SUB_BUCKETS) / HISTOGRAM_SUB_BUCKETS;
+        size_t sub_bucket = (bucket - HISTOGRAM_SUB_BUCKETS) % HISTOGRAM_SUB_BUCKETS;
+        result = ((uint64_t)(HISTOGRAM_SUB_BUCKETS + sub_bucket + 1) << shift) - 1;
+    }
+
+    return result;
+}
+
+static uint64_t get_percentile(const uint64_t *buckets, uint64_t max_ns, double percentile)
+{
+    uint64_t result, total = 0, target;
+    size_t bucket;
+
+    for (bucket = 0; bucket < HSM_METRICS_NUM_BUCKETS; bucket++)
+    {
+        total += buckets[bucket];
+    }
+    percentile = (percentile < 0) ? 0 : (percentile > 100) ? 100 : percentile;
+    target = (uint64_t)((percentile / 100.0) * (double)total);
+    target = (target == 0) ? 1 : target;
+
+    for (bucket = 0, total = 0; (bucket < HSM_METRICS_NUM_BUCKETS) && (total < target); bucket++)
+    {
+        total += buckets[bucket];
+    }
+    result = hsm_metrics_bucket_upper_bound(bucket - 1);
+    // the true value cannot be above the largest one seen
+    return (result > max_ns) ? max_ns : result;
+}
+
+uint64_t hsm_metrics_percentile(const HSM_OPERATION_METRICS* operation, double percentile)
+{
+    uint64_t result = 0;
+
+    if (operation == NULL)
+    {
+        LOG_ERROR("Invalid parameters");
+    }
+    else if (operation->count != 0)
+    {
+        result = get_percentile(operation->buckets, operation->max_ns, percentile);
+    }
+
+    return result;
+}
+
+uint64_t hsm_metrics_lock_percentile(const HSM_LOCK_METRICS* lock, double percentile)
+{
+    uint64_t result = 0;
+
+    if (lock == NULL)
+    {
+        LOG_ERROR("Invalid parameters");
+    }
+    else if (lock->acquisitions != 0)
+    {
+        result = get_percentile(lock->buckets, lock->max_wait_ns, percentile);
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Timed crypto interface
+//##############################################################################
+#define CRYPTO_TARGET ((const HSM_CLIENT_CRYPTO_INTERFACE*)hsm_atomic_load_ptr(&g_crypto_target))
+
+static HSM_CLIENT_HANDLE timed_crypto_create(void)
+{
+    uint64_t start = hsm_metrics_start();
+    HSM_CLIENT_HANDLE result = CRYPTO_TARGET->hsm_client_crypto_create();
+    hsm_metrics_record(HSM_METRICS_CRYPTO_CREATE, start, result == NULL);
+    return result;
+}
+
+static void timed_crypto_destroy(HSM_CLIENT_HANDLE handle)
+{
+    uint64_t start = hsm_metrics_start();
+    CRYPTO_TARGET->hsm_client_crypto_destroy(handle);
+    hsm_metrics_record(HSM_METRICS_CRYPTO_DESTROY, start, false);
+}
+
+static int timed_crypto_get_random_bytes(HSM_CLIENT_HANDLE handle, unsigned char* buffer, size_t num)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = CRYPTO_TARGET->hsm_client_get_random_bytes(handle, buffer, num);
+    hsm_metrics_record(HSM_METRICS_CRYPTO_GET_RANDOM_BYTES, start, result != 0);
+    return result;
+}
+
+static int timed_crypto_create_master_encryption_key(HSM_CLIENT_HANDLE handle)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = CRYPTO_TARGET->hsm_client_create_master_encryption_key(handle);
+    hsm_metrics_record(HSM_METRICS_CRYPTO_CREATE_MASTER_ENCRYPTION_KEY, start, result != 0);
+    return result;
+}
+
+static int timed_crypto_destroy_master_encryption_key(HSM_CLIENT_HANDLE handle)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = CRYPTO_TARGET->hsm_client_destroy_master_encryption_key(handle);
+    hsm_metrics_record(HSM_METRICS_CRYPTO_DESTROY_MASTER_ENCRYPTION_KEY, start, result != 0);
+    return result;
+}
+
+static CERT_INFO_HANDLE timed_crypto_create_certificate(HSM_CLIENT_HANDLE handle, CERT_PROPS_HANDLE certificate_props)
+{
+    uint64_t start = hsm_metrics_start();
+    CERT_INFO_HANDLE result = CRYPTO_TARGET->hsm_client_create_certificate(handle, certificate_props);
+    hsm_metrics_record(HSM_METRICS_CRYPTO_CREATE_CERTIFICATE, start, result == NULL);
+    return result;
+}
+
+static void timed_crypto_destroy_certificate(HSM_CLIENT_HANDLE handle, const char* alias)
+{
+    uint64_t start = hsm_metrics_start();
+    CRYPTO_TARGET->hsm_client_destroy_certificate(handle, alias);
+    hsm_metrics_record(HSM_METRICS_CRYPTO_DESTROY_CERTIFICATE, start, false);
+}
+
+static int timed_crypto_encrypt_data
+(
+    HSM_CLIENT_HANDLE handle,
+    const SIZED_BUFFER* identity,
+    const SIZED_BUFFER* plaintext,
+    const SIZED_BUFFER* init_vector,
+    SIZED_BUFFER* ciphertext
+)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = CRYPTO_TARGET->hsm_client_encrypt_data(handle, identity, plaintext, init_vector, ciphertext);
+    hsm_metrics_record(HSM_METRICS_CRYPTO_ENCRYPT_DATA, start, result != 0);
+    return result;
+}
+
+static int timed_crypto_decrypt_data
+(
+    HSM_CLIENT_HANDLE handle,
+    const SIZED_BUFFER* identity,
+    const SIZED_BUFFER* ciphertext,
+    const SIZED_BUFFER* init_vector,
+    SIZED_BUFFER* plaintext
+)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = CRYPTO_TARGET->hsm_client_decrypt_data(handle, identity, ciphertext, init_vector, plaintext);
+    hsm_metrics_record(HSM_METRICS_CRYPTO_DECRYPT_DATA, start, result != 0);
+    return result;
+}
+
+static CERT_INFO_HANDLE timed_crypto_get_trust_bundle(HSM_CLIENT_HANDLE handle)
+{
+    uint64_t start = hsm_metrics_start();
+    CERT_INFO_HANDLE result = CRYPTO_TARGET->hsm_client_get_trust_bundle(handle);
+    hsm_metrics_record(HSM_METRICS_CRYPTO_GET_TRUST_BUNDLE, start, result == NULL);
+    return result;
+}
+
+static void timed_crypto_free_buffer(void* buffer)
+{
+    uint64_t start = hsm_metrics_start();
+    CRYPTO_TARGET->hsm_client_free_buffer(buffer);
+    hsm_metrics_record(HSM_METRICS_CRYPTO_FREE_BUFFER, start, false);
+}
+
+static const HSM_CLIENT_CRYPTO_INTERFACE timed_crypto_interface =
+{
+    timed_crypto_create,
+    timed_crypto_destroy,
+    timed_crypto_get_random_bytes,
+    timed_crypto_create_master_encryption_key,
+    timed_crypto_destroy_master_encryption_key,
+    timed_crypto_create_certificate,
+    timed_crypto_destroy_certificate,
+    timed_crypto_encrypt_data,
+    timed_crypto_decrypt_data,
+    timed_crypto_get_trust_bundle,
+    timed_crypto_free_buffer
+};
+
+const HSM_CLIENT_CRYPTO_INTERFACE* hsm_metrics_crypto_interface(const HSM_CLIENT_CRYPTO_INTERFACE* target)
+{
+    const HSM_CLIENT_CRYPTO_INTERFACE* result;
+
+    if (target == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        hsm_atomic_store_ptr(&g_crypto_target, (void*)target);
+        result = &timed_crypto_interface;
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Timed TPM interface
+//##############################################################################
+#define TPM_TARGET ((const HSM_CLIENT_TPM_INTERFACE*)hsm_atomic_load_ptr(&g_tpm_target))
+
+static HSM_CLIENT_HANDLE timed_tpm_create(void)
+{
+    uint64_t start = hsm_metrics_start();
+    HSM_CLIENT_HANDLE result = TPM_TARGET->hsm_client_tpm_create();
+    hsm_metrics_record(HSM_METRICS_TPM_CREATE, start, result == NULL);
+    return result;
+}
+
+static void timed_tpm_destroy(HSM_CLIENT_HANDLE handle)
+{
+    uint64_t start = hsm_metrics_start();
+    TPM_TARGET->hsm_client_tpm_destroy(handle);
+    hsm_metrics_record(HSM_METRICS_TPM_DESTROY, start, false);
+}
+
+static int timed_tpm_activate_identity_key(HSM_CLIENT_HANDLE handle, const unsigned char* key, size_t key_size)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = TPM_TARGET->hsm_client_activate_identity_key(handle, key, key_size);
+    hsm_metrics_record(HSM_METRICS_TPM_ACTIVATE_IDENTITY_KEY, start, result != 0);
+    return result;
+}
+
+static int timed_tpm_get_ek(HSM_CLIENT_HANDLE handle, unsigned char** key, size_t* key_size)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = TPM_TARGET->hsm_client_get_ek(handle, key, key_size);
+    hsm_metrics_record(HSM_METRICS_TPM_GET_EK, start, result != 0);
+    return result;
+}
+
+static int timed_tpm_get_srk(HSM_CLIENT_HANDLE handle, unsigned char** key, size_t* key_size)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = TPM_TARGET->hsm_client_get_srk(handle, key, key_size);
+    hsm_metrics_record(HSM_METRICS_TPM_GET_SRK, start, result != 0);
+    return result;
+}
+
+static int timed_tpm_sign_with_identity
+(
+    HSM_CLIENT_HANDLE handle,
+    const unsigned char* data,
+    size_t data_size,
+    unsigned char** digest,
+    size_t* digest_size
+)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = TPM_TARGET->hsm_client_sign_with_identity(handle, data, data_size, digest, digest_size);
+    hsm_metrics_record(HSM_METRICS_TPM_SIGN_WITH_IDENTITY, start, result != 0);
+    return result;
+}
+
+static int timed_tpm_derive_and_sign_with_identity
+(
+    HSM_CLIENT_HANDLE handle,
+    const unsigned char* data,
+    size_t data_size,
+    const unsigned char* identity,
+    size_t identity_size,
+    unsigned char** digest,
+    size_t* digest_size
+)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = TPM_TARGET->hsm_client_derive_and_sign_with_identity(handle, data, data_size, identity,
+                                                                      identity_size, digest, digest_size);
+    hsm_metrics_record(HSM_METRICS_TPM_DERIVE_AND_SIGN_WITH_IDENTITY, start, result != 0);
+    return result;
+}
+
+static void timed_tpm_free_buffer(void* buffer)
+{
+    uint64_t start = hsm_metrics_start();
+    TPM_TARGET->hsm_client_free_buffer(buffer);
+    hsm_metrics_record(HSM_METRICS_TPM_FREE_BUFFER, start, false);
+}
+
+static const HSM_CLIENT_TPM_INTERFACE timed_tpm_interface =
+{
+    timed_tpm_create,
+    timed_tpm_destroy,
+    timed_tpm_activate_identity_key,
+    timed_tpm_get_ek,
+    timed_tpm_get_srk,
+    timed_tpm_sign_with_identity,
+    timed_tpm_derive_and_sign_with_identity,
+    timed_tpm_free_buffer
+};
+
+const HSM_CLIENT_TPM_INTERFACE* hsm_metrics_tpm_interface(const HSM_CLIENT_TPM_INTERFACE* target)
+{
+    const HSM_CLIENT_TPM_INTERFACE* result;
+
+    if (target == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        hsm_atomic_store_ptr(&g_tpm_target, (void*)target);
+        result = &timed_tpm_interface;
+    }
+
+    return result;
+}
+
+#define TPM_SAS_KEY_TARGET ((const HSM_CLIENT_TPM_SAS_KEY_INTERFACE*)hsm_atomic_load_ptr(&g_tpm_sas_key_target))
+
+static int timed_tpm_import_sas_key(HSM_CLIENT_HANDLE handle, const char* key_name, const unsigned char* key, size_t key_size)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = TPM_SAS_KEY_TARGET->hsm_client_import_sas_key(handle, key_name, key, key_size);
+    hsm_metrics_record(HSM_METRICS_TPM_IMPORT_SAS_KEY, start, result != 0);
+    return result;
+}
+
+static int timed_tpm_remove_sas_key(HSM_CLIENT_HANDLE handle, const char* key_name)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = TPM_SAS_KEY_TARGET->hsm_client_remove_sas_key(handle, key_name);
+    hsm_metrics_record(HSM_METRICS_TPM_REMOVE_SAS_KEY, start, result != 0);
+    return result;
+}
+
+static int timed_tpm_sign_with_sas_key
+(
+    HSM_CLIENT_HANDLE handle,
+    const char* key_name,
+    const unsigned char* data,
+    size_t data_size,
+    unsigned char** digest,
+    size_t* digest_size
+)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = TPM_SAS_KEY_TARGET->hsm_client_sign_with_sas_key(handle, key_name, data, data_size, digest, digest_size);
+    hsm_metrics_record(HSM_METRICS_TPM_SIGN_WITH_SAS_KEY, start, result != 0);
+    return result;
+}
+
+static const HSM_CLIENT_TPM_SAS_KEY_INTERFACE timed_tpm_sas_key_interface =
+{
+    HSM_CLIENT_TPM_SAS_KEY_INTERFACE_VERSION,
+    timed_tpm_import_sas_key,
+    timed_tpm_remove_sas_key,
+    timed_tpm_sign_with_sas_key
+};
+
+const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* hsm_metrics_tpm_sas_key_interface(const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* target)
+{
+    const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* result;
+
+    if (target == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        hsm_atomic_store_ptr(&g_tpm_sas_key_target, (void*)target);
+        result = &timed_tpm_sas_key_interface;
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Timed store interface
+//##############################################################################
+#define STORE_TARGET ((const HSM_CLIENT_STORE_INTERFACE*)hsm_atomic_load_ptr(&g_store_target))
+
+static int timed_store_create(const char* store_name)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = STORE_TARGET->hsm_client_store_create(store_name);
+    hsm_metrics_record(HSM_METRICS_STORE_CREATE, start, result != 0);
+    return result;
+}
+
+static int timed_store_destroy(const char* store_name)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = STORE_TARGET->hsm_client_store_destroy(store_name);
+    hsm_metrics_record(HSM_METRICS_STORE_DESTROY, start, result != 0);
+    return result;
+}
+
+static HSM_CLIENT_STORE_HANDLE timed_store_open(const char* store_name)
+{
+    uint64_t start = hsm_metrics_start();
+    HSM_CLIENT_STORE_HANDLE result = STORE_TARGET->hsm_client_store_open(store_name);
+    hsm_metrics_record(HSM_METRICS_STORE_OPEN, start, result == NULL);
+    return result;
+}
+
+static int timed_store_close(HSM_CLIENT_STORE_HANDLE handle)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = STORE_TARGET->hsm_client_store_close(handle);
+    hsm_metrics_record(HSM_METRICS_STORE_CLOSE, start, result != 0);
+    return result;
+}
+
+static KEY_HANDLE timed_store_open_key(HSM_CLIENT_STORE_HANDLE handle, HSM_KEY_T key_type, const char* key_name)
+{
+    uint64_t start = hsm_metrics_start();
+    KEY_HANDLE result = STORE_TARGET->hsm_client_store_open_key(handle, key_type, key_name);
+    hsm_metrics_record(HSM_METRICS_STORE_OPEN_KEY, start, result == NULL);
+    return result;
+}
+
+static int timed_store_close_key(HSM_CLIENT_STORE_HANDLE handle, KEY_HANDLE key_handle)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = STORE_TARGET->hsm_client_store_close_key(handle, key_handle);
+    hsm_metrics_record(HSM_METRICS_STORE_CLOSE_KEY, start, result != 0);
+    return result;
+}
+
+static int timed_store_remove_key(HSM_CLIENT_STORE_HANDLE handle, HSM_KEY_T key_type, const char* key_name)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = STORE_TARGET->hsm_client_store_remove_key(handle, key_type, key_name);
+    hsm_metrics_record(HSM_METRICS_STORE_REMOVE_KEY, start, result != 0);
+    return result;
+}
+
+static int timed_store_insert_sas_key
+(
+    HSM_CLIENT_STORE_HANDLE handle,
+    const char* key_name,
+    const unsigned char* key,
+    size_t key_len
+)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = STORE_TARGET->hsm_client_store_insert_sas_key(handle, key_name, key, key_len);
+    hsm_metrics_record(HSM_METRICS_STORE_INSERT_SAS_KEY, start, result != 0);
+    return result;
+}
+
+static int timed_store_insert_encryption_key(HSM_CLIENT_STORE_HANDLE handle, const char* key_name)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = STORE_TARGET->hsm_client_store_insert_encryption_key(handle, key_name);
+    hsm_metrics_record(HSM_METRICS_STORE_INSERT_ENCRYPTION_KEY, start, result != 0);
+    return result;
+}
+
+static int timed_store_create_pki_cert(HSM_CLIENT_STORE_HANDLE handle, CERT_PROPS_HANDLE cert_props_handle)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = STORE_TARGET->hsm_client_store_create_pki_cert(handle, cert_props_handle);
+    hsm_metrics_record(HSM_METRICS_STORE_CREATE_PKI_CERT, start, result != 0);
+    return result;
+}
+
+static CERT_INFO_HANDLE timed_store_get_pki_cert(HSM_CLIENT_STORE_HANDLE handle, const char* alias)
+{
+    uint64_t start = hsm_metrics_start();
+    CERT_INFO_HANDLE result = STORE_TARGET->hsm_client_store_get_pki_cert(handle, alias);
+    hsm_metrics_record(HSM_METRICS_STORE_GET_PKI_CERT, start, result == NULL);
+    return result;
+}
+
+static int timed_store_remove_pki_cert(HSM_CLIENT_STORE_HANDLE handle, const char* alias)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = STORE_TARGET->hsm_client_store_remove_pki_cert(handle, alias);
+    hsm_metrics_record(HSM_METRICS_STORE_REMOVE_PKI_CERT, start, result != 0);
+    return result;
+}
+
+static int timed_store_insert_pki_trusted_cert(HSM_CLIENT_STORE_HANDLE handle, const char* alias, const char* file_name)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = STORE_TARGET->hsm_client_store_insert_pki_trusted_cert(handle, alias, file_name);
+    hsm_metrics_record(HSM_METRICS_STORE_INSERT_PKI_TRUSTED_CERT, start, result != 0);
+    return result;
+}
+
+static CERT_INFO_HANDLE timed_store_get_pki_trusted_certs(HSM_CLIENT_STORE_HANDLE handle)
+{
+    uint64_t start = hsm_metrics_start();
+    CERT_INFO_HANDLE result = STORE_TARGET->hsm_client_store_get_pki_trusted_certs(handle);
+    hsm_metrics_record(HSM_METRICS_STORE_GET_PKI_TRUSTED_CERTS, start, result == NULL);
+    return result;
+}
+
+static int timed_store_remove_pki_trusted_cert(HSM_CLIENT_STORE_HANDLE handle, const char* alias)
+{
+    uint64_t start = hsm_metrics_start();
+    int result = STORE_TARGET->hsm_client_store_remove_pki_trusted_cert(handle, alias);
+    hsm_metrics_record(HSM_METRICS_STORE_REMOVE_PKI_TRUSTED_CERT, start, result != 0);
+    return result;
+}
+
+static const HSM_CLIENT_STORE_INTERFACE timed_store_interface =
+{
+    timed_store_create,
+    timed_store_destroy,
+    timed_store_open,
+    timed_store_close,
+    timed_store_open_key,
+    timed_store_close_key,
+    timed_store_remove_key,
+    timed_store_insert_sas_key,
+    timed_store_insert_encryption_key,
+    timed_store_create_pki_cert,
+    timed_store_get_pki_cert,
+    timed_store_remove_pki_cert,
+    timed_store_insert_pki_trusted_cert,
+    timed_store_get_pki_trusted_certs,
+    timed_store_remove_pki_trusted_cert
+};
+
+const HSM_CLIENT_STORE_INTERFACE* hsm_metrics_store_interface(const HSM_CLIENT_STORE_INTERFACE* target)
+{
+    const HSM_CLIENT_STORE_INTERFACE* result;
+
+    if (target == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        hsm_atomic_store_ptr(&g_store_target, (void*)target);
+        result = &timed_store_interface;
+    }
+
+    return result;
+}
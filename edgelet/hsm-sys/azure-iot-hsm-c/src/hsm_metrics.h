@@ -0,0 +1,120 @@
+#ifndef HSM_METRICS_H
+#define HSM_METRICS_H
+
+#ifdef __cplusplus
+#include <cstdint>
+extern "C" {
+#else
+#include <stdbool.h>
+#include <stdint.h>
+#endif
+
+#include "hsm_client_data.h"
+#include "hsm_client_store.h"
+
+/**
+ * Operations whose calls are counted and timed. The interface functions are
+ * timed by the tables returned from hsm_metrics_*_interface, which forward
+ * every call to the table they wrap, so nested calls are timed at each level.
+ * Internal operations are timed where they happen to tell apart time spent
+ * in key generation from time spent in the store.
+ */
+typedef enum HSM_METRICS_OPERATION_TAG
+{
+    HSM_METRICS_CRYPTO_CREATE,
+    HSM_METRICS_CRYPTO_DESTROY,
+    HSM_METRICS_CRYPTO_GET_RANDOM_BYTES,
+    HSM_METRICS_CRYPTO_CREATE_MASTER_ENCRYPTION_KEY,
+    HSM_METRICS_CRYPTO_DESTROY_MASTER_ENCRYPTION_KEY,
+    HSM_METRICS_CRYPTO_CREATE_CERTIFICATE,
+    HSM_METRICS_CRYPTO_DESTROY_CERTIFICATE,
+    HSM_METRICS_CRYPTO_ENCRYPT_DATA,
+    HSM_METRICS_CRYPTO_DECRYPT_DATA,
+    HSM_METRICS_CRYPTO_GET_TRUST_BUNDLE,
+    HSM_METRICS_CRYPTO_FREE_BUFFER,
+    HSM_METRICS_TPM_CREATE,
+    HSM_METRICS_TPM_DESTROY,
+    HSM_METRICS_TPM_ACTIVATE_IDENTITY_KEY,
+    HSM_METRICS_TPM_GET_EK,
+    HSM_METRICS_TPM_GET_SRK,
+    HSM_METRICS_TPM_SIGN_WITH_IDENTITY,
+    HSM_METRICS_TPM_DERIVE_AND_SIGN_WITH_IDENTITY,
+    HSM_METRICS_TPM_FREE_BUFFER,
+    HSM_METRICS_TPM_IMPORT_SAS_KEY,
+    HSM_METRICS_TPM_REMOVE_SAS_KEY,
+    HSM_METRICS_TPM_SIGN_WITH_SAS_KEY,
+    HSM_METRICS_STORE_CREATE,
+    HSM_METRICS_STORE_DESTROY,
+    HSM_METRICS_STORE_OPEN,
+    HSM_METRICS_STORE_CLOSE,
+    HSM_METRICS_STORE_OPEN_KEY,
+    HSM_METRICS_STORE_CLOSE_KEY,
+    HSM_METRICS_STORE_REMOVE_KEY,
+    HSM_METRICS_STORE_INSERT_SAS_KEY,
+    HSM_METRICS_STORE_INSERT_ENCRYPTION_KEY,
+    HSM_METRICS_STORE_CREATE_PKI_CERT,
+    HSM_METRICS_STORE_GET_PKI_CERT,
+    HSM_METRICS_STORE_REMOVE_PKI_CERT,
+    HSM_METRICS_STORE_INSERT_PKI_TRUSTED_CERT,
+    HSM_METRICS_STORE_GET_PKI_TRUSTED_CERTS,
+    HSM_METRICS_STORE_REMOVE_PKI_TRUSTED_CERT,
+    HSM_METRICS_PKI_GENERATE_KEY,
+    HSM_METRICS_PKI_VERIFY_CERTIFICATE,
+    HSM_METRICS_NUM_OPERATIONS
+} HSM_METRICS_OPERATION;
+
+typedef enum HSM_METRICS_CACHE_TAG
+{
+    HSM_METRICS_CACHE_VERIFICATION_STORE,
+    HSM_METRICS_CACHE_VERIFIED_MANIFEST,
+    HSM_METRICS_NUM_CACHES
+} HSM_METRICS_CACHE;
+
+/**
+ * Internal locks whose waits are timed when the library is built with
+ * HSM_LOCK_PROFILING. Waiting for RCU readers to leave is counted as a lock
+ * as store writers block on it the same way.
+ */
+typedef enum HSM_METRICS_LOCK_TAG
+{
+    HSM_METRICS_LOCK_STORE_WRITER,
+    HSM_METRICS_LOCK_STORE_RCU_SYNCHRONIZE,
+    HSM_METRICS_LOCK_VERIFICATION_CACHE,
+    HSM_METRICS_LOCK_KEY_MEM_CLASS,
+    HSM_METRICS_LOCK_STORE_LOG,
+    HSM_METRICS_NUM_LOCKS
+} HSM_METRICS_LOCK;
+
+/**
+ * Begins an operation and returns the time to pass to hsm_metrics_record
+ * once it is done. Every call must be followed by hsm_metrics_record on the
+ * same thread, as builds with HSM_ALLOC_ACCOUNTING count the allocations
+ * made between the two.
+ */
+extern uint64_t hsm_metrics_start(void);
+extern void hsm_metrics_record(HSM_METRICS_OPERATION operation, uint64_t start, bool failed);
+
+/**
+ * Returns the current time in nanoseconds without beginning an operation.
+ */
+extern uint64_t hsm_metrics_now(void);
+
+extern void hsm_metrics_cache_access(HSM_METRICS_CACHE cache, bool hit);
+
+/**
+ * Records an acquisition of a lock whose wait began at start, as returned by
+ * hsm_metrics_now, and ended now. Locks acquired without waiting pass a
+ * start of 0 so that their fast path does not read the clock.
+ */
+extern void hsm_metrics_lock_wait(HSM_METRICS_LOCK lock, uint64_t start, bool contended);
+
+extern const HSM_CLIENT_CRYPTO_INTERFACE* hsm_metrics_crypto_interface(const HSM_CLIENT_CRYPTO_INTERFACE* target);
+extern const HSM_CLIENT_TPM_INTERFACE* hsm_metrics_tpm_interface(const HSM_CLIENT_TPM_INTERFACE* target);
+extern const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* hsm_metrics_tpm_sas_key_interface(const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* target);
+extern const HSM_CLIENT_STORE_INTERFACE* hsm_metrics_store_interface(const HSM_CLIENT_STORE_INTERFACE* target);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_METRICS_H
@@ -0,0 +1,338 @@
+#if defined __linux__ && !defined _GNU_SOURCE
+    // for syscall
+    #define _GNU_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/rand.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "hsm_atomic.h"
+#include "hsm_key_mem.h"
+#include "hsm_log.h"
+#include "hsm_random.h"
+
+#if defined(_MSC_VER)
+    #define HSM_THREAD_LOCAL __declspec(thread)
+#else
+    #include <errno.h>
+    #include <pthread.h>
+    #include <unistd.h>
+    #define HSM_THREAD_LOCAL __thread
+#endif
+
+#if defined __linux__
+    #include <sys/syscall.h>
+#endif
+
+//##############################################################################
+// Data types
+//##############################################################################
+#define CHACHA20_KEY_SIZE 32
+#define CHACHA20_BLOCK_SIZE 64
+#define CHACHA20_ROUNDS 20
+// keystream generated at once for small requests, the first key size bytes
+// of it become the next key
+#define RANDOM_BUFFER_BLOCKS 16
+#define RANDOM_BUFFER_SIZE (RANDOM_BUFFER_BLOCKS * CHACHA20_BLOCK_SIZE)
+// requests at least this large bypass the buffer
+#define RANDOM_BULK_THRESHOLD (RANDOM_BUFFER_SIZE / 2)
+// output after which a generator mixes in fresh entropy
+#define RANDOM_RESEED_BYTES (1024 * 1024)
+
+struct RANDOM_STATE_TAG
+{
+    uint32_t key[CHACHA20_KEY_SIZE / 4];
+    // unused keystream is at the end of the buffer
+    unsigned char buffer[RANDOM_BUFFER_SIZE];
+    size_t available;
+    size_t output_since_reseed;
+    long fork_generation;
+    bool seeded;
+};
+typedef struct RANDOM_STATE_TAG RANDOM_STATE;
+
+static HSM_THREAD_LOCAL RANDOM_STATE g_random_state;
+
+// incremented in the child after a fork so every generator reseeds there
+static HSM_ATOMIC_LONG g_fork_generation = 0;
+static HSM_ATOMIC_LONG g_fork_handler_registered = 0;
+
+//##############################################################################
+// ChaCha20
+//##############################################################################
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define QUARTER_ROUND(a, b, c, d) \
+    a += b; d ^= a; d = ROTL32(d, 16); \
+    c += d; b ^= c; b = ROTL32(b, 12); \
+    a += b; d ^= a; d = ROTL32(d, 8);  \
+    c += d; b ^= c; b = ROTL32(b, 7)
+
+static void store32_le(unsigned char *out, uint32_t value)
+{
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+static uint32_t load32_le(const unsigned char *in)
+{
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+           ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// writes the keystream blocks starting at counter, the nonce is always zero
+// since every key is only ever used for a single run of blocks
+static void chacha20_keystream(const uint32_t *key, uint64_t counter, unsigned char *out, size_t num_blocks)
+{
+    uint32_t input[16];
+    uint32_t x[16];
+    size_t block;
+    int idx;
+
+    input[0] = 0x61707865;
+    input[1] = 0x3320646e;
+    input[2] = 0x79622d32;
+    input[3] = 0x6b206574;
+    for (idx = 0; idx < 8; idx++)
+    {
+        input[4 + idx] = key[idx];
+    }
+    input[14] = 0;
+    input[15] = 0;
+
+    for (block = 0; block < num_blocks; block++, counter++)
+    {
+        input[12] = (uint32_t)counter;
+        input[13] = (uint32_t)(counter >> 32);
+        memcpy(x, input, sizeof(x));
+        for (idx = 0; idx < CHACHA20_ROUNDS; idx += 2)
+        {
+            QUARTER_ROUND(x[0], x[4], x[8],  x[12]);
+            QUARTER_ROUND(x[1], x[5], x[9],  x[13]);
+            QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+            QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+            QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+            QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+            QUARTER_ROUND(x[2], x[7], x[8],  x[13]);
+            QUARTER_ROUND(x[3], x[4], x[9],  x[14]);
+        }
+        for (idx = 0; idx < 16; idx++)
+        {
+            store32_le(out + (block * CHACHA20_BLOCK_SIZE) + (idx * 4), x[idx] + input[idx]);
+        }
+    }
+
+    hsm_key_mem_cleanse(input, sizeof(input));
+    hsm_key_mem_cleanse(x, sizeof(x));
+}
+
+//##############################################################################
+// Generator helpers
+//##############################################################################
+#if !defined(_MSC_VER)
+static void on_fork_child(void)
+{
+    (void)hsm_atomic_inc(&g_fork_generation);
+}
+#endif
+
+static void register_fork_handler(void)
+{
+#if !defined(_MSC_VER)
+    if ((hsm_atomic_load(&g_fork_handler_registered) == 0) &&
+        hsm_atomic_cas(&g_fork_handler_registered, 0, 1) &&
+        (pthread_atfork(NULL, NULL, on_fork_child) != 0))
+    {
+        LOG_ERROR("Could not register fork handler, generators are not reseeded after a fork");
+    }
+#endif
+}
+
+static int get_system_entropy(unsigned char *buffer, size_t num_bytes)
+{
+    int result;
+#if defined __linux__ && defined SYS_getrandom
+    size_t offset = 0;
+    long count = 0;
+
+    while ((offset < num_bytes) &&
+           (((count = syscall(SYS_getrandom, buffer + offset, num_bytes - offset, 0)) > 0) ||
+            ((count < 0) && (errno == EINTR))))
+    {
+        if (count > 0)
+        {
+            offset += (size_t)count;
+        }
+    }
+
+    if (offset == num_bytes)
+    {
+        result = 0;
+    }
+    else if ((count < 0) && (errno == ENOSYS) && (RAND_bytes(buffer, (int)num_bytes) == 1))
+    {
+        // kernels older than 3.17 do not have getrandom
+        result = 0;
+    }
+    else
+    {
+        LOG_ERROR("Could not obtain entropy from the system");
+        result = __FAILURE__;
+    }
+#else
+    if (RAND_bytes(buffer, (int)num_bytes) != 1)
+    {
+        LOG_ERROR("Could not obtain entropy from OpenSSL");
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+#endif
+    return result;
+}
+
+// generates a buffer of keystream and replaces the key with its first bytes,
+// so the new key cannot reproduce any of the buffered keystream
+static void refill_buffer(RANDOM_STATE *state)
+{
+    int idx;
+
+    chacha20_keystream(state->key, 0, state->buffer, RANDOM_BUFFER_BLOCKS);
+    for (idx = 0; idx < CHACHA20_KEY_SIZE / 4; idx++)
+    {
+        state->key[idx] = load32_le(state->buffer + (idx * 4));
+    }
+    hsm_key_mem_cleanse(state->buffer, CHACHA20_KEY_SIZE);
+    state->available = RANDOM_BUFFER_SIZE - CHACHA20_KEY_SIZE;
+}
+
+// mixes fresh entropy into the key and drops buffered keystream, which a
+// forked child would otherwise share with its parent
+static int reseed(RANDOM_STATE *state)
+{
+    int result;
+    unsigned char seed[CHACHA20_KEY_SIZE];
+
+    if (get_system_entropy(seed, sizeof(seed)) != 0)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        int idx;
+        for (idx = 0; idx < CHACHA20_KEY_SIZE / 4; idx++)
+        {
+            state->key[idx] ^= load32_le(seed + (idx * 4));
+        }
+        hsm_key_mem_cleanse(state->buffer, sizeof(state->buffer));
+        state->available = 0;
+        state->output_since_reseed = 0;
+        state->fork_generation = hsm_atomic_load(&g_fork_generation);
+        state->seeded = true;
+        result = 0;
+    }
+    hsm_key_mem_cleanse(seed, sizeof(seed));
+
+    return result;
+}
+
+static void generate_buffered(RANDOM_STATE *state, unsigned char *buffer, size_t num_bytes)
+{
+    while (num_bytes > 0)
+    {
+        size_t count;
+        unsigned char *keystream;
+
+        if (state->available == 0)
+        {
+            refill_buffer(state);
+        }
+        count = (num_bytes < state->available) ? num_bytes : state->available;
+        keystream = state->buffer + RANDOM_BUFFER_SIZE - state->available;
+        memcpy(buffer, keystream, count);
+        // handed out keystream must not stay behind
+        hsm_key_mem_cleanse(keystream, count);
+        state->available -= count;
+        buffer += count;
+        num_bytes -= count;
+    }
+}
+
+// block 0 of the current key becomes the next key and the following blocks
+// are written to the caller's buffer
+static void generate_bulk(RANDOM_STATE *state, unsigned char *buffer, size_t num_bytes)
+{
+    unsigned char block[CHACHA20_BLOCK_SIZE];
+    size_t num_blocks = num_bytes / CHACHA20_BLOCK_SIZE;
+    size_t tail = num_bytes % CHACHA20_BLOCK_SIZE;
+    int idx;
+
+    chacha20_keystream(state->key, 1, buffer, num_blocks);
+    if (tail != 0)
+    {
+        chacha20_keystream(state->key, 1 + num_blocks, block, 1);
+        memcpy(buffer + (num_blocks * CHACHA20_BLOCK_SIZE), block, tail);
+    }
+    chacha20_keystream(state->key, 0, block, 1);
+    for (idx = 0; idx < CHACHA20_KEY_SIZE / 4; idx++)
+    {
+        state->key[idx] = load32_le(block + (idx * 4));
+    }
+    hsm_key_mem_cleanse(block, sizeof(block));
+}
+
+//##############################################################################
+// Random API
+//##############################################################################
+int hsm_random_bytes(unsigned char *buffer, size_t num_bytes)
+{
+    int result;
+    RANDOM_STATE *state = &g_random_state;
+
+    if ((buffer == NULL) || (num_bytes == 0))
+    {
+        LOG_ERROR("Invalid parameters");
+        result = __FAILURE__;
+    }
+    else
+    {
+        register_fork_handler();
+        if ((!state->seeded) ||
+            (state->output_since_reseed >= RANDOM_RESEED_BYTES) ||
+            (state->fork_generation != hsm_atomic_load(&g_fork_generation)))
+        {
+            result = reseed(state);
+        }
+        else
+        {
+            result = 0;
+        }
+
+        if (result != 0)
+        {
+            LOG_ERROR("Could not seed the random generator");
+        }
+        else
+        {
+            if (num_bytes >= RANDOM_BULK_THRESHOLD)
+            {
+                generate_bulk(state, buffer, num_bytes);
+            }
+            else
+            {
+                generate_buffered(state, buffer, num_bytes);
+            }
+            state->output_since_reseed += num_bytes;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,33 @@
+#ifndef HSM_RANDOM_H
+#define HSM_RANDOM_H
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stddef.h>
+#endif
+
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+/**
+ * Cryptographically secure random bytes.
+ *
+ * Each thread has its own ChaCha20 based generator, seeded from the operating
+ * system (getrandom on Linux, else OpenSSL RAND_bytes), so callers never
+ * contend on a lock or make a system call per request. The generator key is
+ * replaced whenever keystream is generated and keystream is erased once handed
+ * out, which means a generator state leaked at any point does not reveal bytes
+ * handed out before it. Generators are reseeded after a fixed amount of output
+ * and in a child process after a fork.
+ *
+ * Small requests are served from a per thread buffer of keystream while large
+ * requests are written straight into the caller's buffer.
+ */
+MOCKABLE_FUNCTION(, int, hsm_random_bytes, unsigned char*, buffer, size_t, num_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_RANDOM_H
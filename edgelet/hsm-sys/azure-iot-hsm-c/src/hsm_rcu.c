@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "hsm_atomic.h"
+#include "hsm_log.h"
+#include "hsm_rcu.h"
+
+#if defined(_MSC_VER)
+    #include <windows.h>
+    #define HSM_THREAD_LOCAL __declspec(thread)
+#else
+    #include <sched.h>
+    #define HSM_THREAD_LOCAL __thread
+#endif
+
+//##############################################################################
+// Data types
+//##############################################################################
+// must be a power of 2, threads beyond this many share reader slots
+#define HSM_RCU_NUM_SLOTS 64
+#define HSM_RCU_CACHE_LINE_SIZE 64
+// busy waits for a reader to unlock before yielding the processor
+#define HSM_RCU_SPINS_BEFORE_YIELD 128
+
+// each slot sits on its own cache line so readers in different
+// slots never write to the same line
+struct HSM_RCU_SLOT_TAG
+{
+    // readers in this slot that locked during an even or odd epoch
+    HSM_ATOMIC_LONG readers[2];
+    unsigned char padding[HSM_RCU_CACHE_LINE_SIZE - (2 * sizeof(HSM_ATOMIC_LONG))];
+};
+typedef struct HSM_RCU_SLOT_TAG HSM_RCU_SLOT;
+
+struct HSM_RCU_TAG
+{
+    HSM_ATOMIC_LONG epoch;
+    HSM_RCU_SLOT *slots;
+};
+typedef struct HSM_RCU_TAG HSM_RCU;
+
+// threads are handed slots round robin the first time they lock
+static HSM_ATOMIC_LONG g_next_reader_slot = 0;
+static HSM_THREAD_LOCAL long g_reader_slot = -1;
+
+//##############################################################################
+// RCU helpers
+//##############################################################################
+static size_t get_reader_slot(void)
+{
+    if (g_reader_slot < 0)
+    {
+        g_reader_slot = (hsm_atomic_inc(&g_next_reader_slot) - 1) & (HSM_RCU_NUM_SLOTS - 1);
+    }
+
+    return (size_t)g_reader_slot;
+}
+
+static void yield_processor(void)
+{
+#if defined(_MSC_VER)
+    (void)SwitchToThread();
+#else
+    (void)sched_yield();
+#endif
+}
+
+static void wait_for_readers(HSM_RCU *rcu, long parity)
+{
+    size_t idx;
+
+    for (idx = 0; idx < HSM_RCU_NUM_SLOTS; idx++)
+    {
+        size_t spins = 0;
+        while (hsm_atomic_load(&rcu->slots[idx].readers[parity]) != 0)
+        {
+            if (++spins >= HSM_RCU_SPINS_BEFORE_YIELD)
+            {
+                yield_processor();
+                spins = 0;
+            }
+        }
+    }
+}
+
+//##############################################################################
+// RCU API
+//##############################################################################
+HSM_RCU_HANDLE hsm_rcu_create(void)
+{
+    HSM_RCU *result;
+
+    // room to align the slots to a cache line boundary
+    if ((result = (HSM_RCU*)malloc(sizeof(HSM_RCU) + HSM_RCU_CACHE_LINE_SIZE +
+                                   (HSM_RCU_NUM_SLOTS * sizeof(HSM_RCU_SLOT)))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for RCU reader slots");
+    }
+    else
+    {
+        uintptr_t slots = (uintptr_t)(result + 1);
+        slots = (slots + HSM_RCU_CACHE_LINE_SIZE - 1) & ~((uintptr_t)HSM_RCU_CACHE_LINE_SIZE - 1);
+        result->slots = (HSM_RCU_SLOT*)slots;
+        memset(result->slots, 0, HSM_RCU_NUM_SLOTS * sizeof(HSM_RCU_SLOT));
+        result->epoch = 0;
+    }
+
+    return result;
+}
+
+void hsm_rcu_destroy(HSM_RCU_HANDLE rcu)
+{
+    if (rcu != NULL)
+    {
+        free(rcu);
+    }
+}
+
+HSM_RCU_READER hsm_rcu_read_lock(HSM_RCU_HANDLE rcu)
+{
+    HSM_RCU_READER result;
+
+    if (rcu == NULL)
+    {
+        LOG_ERROR("Invalid RCU handle");
+        result = 0;
+    }
+    else
+    {
+        size_t slot = get_reader_slot();
+        long parity = hsm_atomic_load(&rcu->epoch) & 1;
+        // the increment is a full barrier so shared data read after
+        // it cannot be observed before the reader is counted
+        (void)hsm_atomic_inc(&rcu->slots[slot].readers[parity]);
+        result = (slot << 1) | (size_t)parity;
+    }
+
+    return result;
+}
+
+void hsm_rcu_read_unlock(HSM_RCU_HANDLE rcu, HSM_RCU_READER reader)
+{
+    if (rcu == NULL)
+    {
+        LOG_ERROR("Invalid RCU handle");
+    }
+    else
+    {
+        (void)hsm_atomic_dec(&rcu->slots[(reader >> 1) & (HSM_RCU_NUM_SLOTS - 1)].readers[reader & 1]);
+    }
+}
+
+void hsm_rcu_synchronize(HSM_RCU_HANDLE rcu)
+{
+    if (rcu == NULL)
+    {
+        LOG_ERROR("Invalid RCU handle");
+    }
+    else
+    {
+        int pass;
+        // a reader may sample the epoch, stall past a whole synchronize and
+        // then count itself under the parity that is about to be flipped
+        // back to, so both parities must drain once before returning
+        for (pass = 0; pass < 2; pass++)
+        {
+            long parity = (hsm_atomic_inc(&rcu->epoch) - 1) & 1;
+            wait_for_readers(rcu, parity);
+        }
+    }
+}
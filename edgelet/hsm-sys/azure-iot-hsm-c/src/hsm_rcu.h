@@ -0,0 +1,39 @@
+#ifndef HSM_RCU_H
+#define HSM_RCU_H
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stddef.h>
+#endif
+
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+/**
+ * Read copy update synchronization.
+ *
+ * Readers bracket their accesses to shared data with a read lock and unlock
+ * which never block and only touch a counter that the calling thread shares
+ * with few if any other threads, so readers do not contend with each other.
+ * Writers publish an updated copy of the data and then synchronize, which
+ * waits until every reader that could still observe the previous copy has
+ * unlocked, after which the previous copy can be released.
+ *
+ * Read sections may be nested but must not synchronize. Calls to synchronize
+ * must be serialized by the caller.
+ */
+typedef struct HSM_RCU_TAG* HSM_RCU_HANDLE;
+typedef size_t HSM_RCU_READER;
+
+MOCKABLE_FUNCTION(, HSM_RCU_HANDLE, hsm_rcu_create);
+MOCKABLE_FUNCTION(, void, hsm_rcu_destroy, HSM_RCU_HANDLE, rcu);
+MOCKABLE_FUNCTION(, HSM_RCU_READER, hsm_rcu_read_lock, HSM_RCU_HANDLE, rcu);
+MOCKABLE_FUNCTION(, void, hsm_rcu_read_unlock, HSM_RCU_HANDLE, rcu, HSM_RCU_READER, reader);
+MOCKABLE_FUNCTION(, void, hsm_rcu_synchronize, HSM_RCU_HANDLE, rcu);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_RCU_H
@@ -0,0 +1,296 @@
+#if defined __linux__ && !defined _GNU_SOURCE
+    // for MAP_ANONYMOUS and madvise with strict C standard flags
+    #define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "hsm_key_mem.h"
+#include "hsm_log.h"
+#include "hsm_slab.h"
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+//##############################################################################
+// Data types
+//##############################################################################
+// objects are aligned to this many bytes within a page
+#define HSM_SLAB_ALIGNMENT 16
+
+struct HSM_SLAB_PAGE_TAG
+{
+    struct HSM_SLAB_PAGE_TAG *next;
+    // pad the header so the first object in the page is suitably aligned
+    unsigned char padding[HSM_SLAB_ALIGNMENT - sizeof(void*)];
+};
+typedef struct HSM_SLAB_PAGE_TAG HSM_SLAB_PAGE;
+
+// released objects hold the free list link in their first bytes
+struct HSM_SLAB_FREE_OBJECT_TAG
+{
+    struct HSM_SLAB_FREE_OBJECT_TAG *next;
+};
+typedef struct HSM_SLAB_FREE_OBJECT_TAG HSM_SLAB_FREE_OBJECT;
+
+struct HSM_SLAB_TAG
+{
+    size_t object_size;
+    size_t objects_per_page;
+    // secure pages are locked in memory and objects are zeroized on release
+    bool secure;
+    size_t page_size;
+    HSM_SLAB_PAGE *pages;
+    HSM_SLAB_FREE_OBJECT *free_objects;
+    // objects in the newest page that have never been handed out
+    unsigned char *next_unused;
+    size_t num_unused;
+    size_t count;
+};
+typedef struct HSM_SLAB_TAG HSM_SLAB;
+
+//##############################################################################
+// Secure page helpers
+//##############################################################################
+static size_t get_system_page_size(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t)info.dwPageSize;
+#else
+    long page_size = sysconf(_SC_PAGESIZE);
+    return (page_size > 0) ? (size_t)page_size : 4096;
+#endif
+}
+
+static void* alloc_secure_page(size_t page_size)
+{
+    void *result;
+
+#if defined(_WIN32)
+    if ((result = VirtualAlloc(NULL, page_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE)) == NULL)
+    {
+        LOG_ERROR("Could not allocate secure slab page. Error %lu", GetLastError());
+    }
+    else if (!VirtualLock(result, page_size))
+    {
+        // still usable, objects are zeroized on release regardless
+        LOG_INFO("Could not lock secure slab page in memory. Error %lu", GetLastError());
+    }
+#else
+    if ((result = mmap(NULL, page_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+    {
+        LOG_ERROR("Could not allocate secure slab page. Errno %d", errno);
+        result = NULL;
+    }
+    else
+    {
+        if (mlock(result, page_size) != 0)
+        {
+            // typically RLIMIT_MEMLOCK, objects are zeroized on release regardless
+            LOG_INFO("Could not lock secure slab page in memory. Errno %d", errno);
+        }
+    #if defined(MADV_DONTDUMP)
+        (void)madvise(result, page_size, MADV_DONTDUMP);
+    #endif
+    }
+#endif
+
+    return result;
+}
+
+static void free_secure_page(void *page, size_t page_size)
+{
+    hsm_key_mem_cleanse(page, page_size);
+#if defined(_WIN32)
+    (void)VirtualUnlock(page, page_size);
+    (void)VirtualFree(page, 0, MEM_RELEASE);
+#else
+    (void)munlock(page, page_size);
+    (void)munmap(page, page_size);
+#endif
+}
+
+//##############################################################################
+// Slab helpers
+//##############################################################################
+static int add_page(HSM_SLAB *slab)
+{
+    int result;
+    HSM_SLAB_PAGE *page;
+
+    if (slab->secure)
+    {
+        page = (HSM_SLAB_PAGE*)alloc_secure_page(slab->page_size);
+    }
+    else
+    {
+        page = (HSM_SLAB_PAGE*)malloc(slab->page_size);
+    }
+
+    if (page == NULL)
+    {
+        LOG_ERROR("Could not allocate slab page for %zu objects", slab->objects_per_page);
+        result = __FAILURE__;
+    }
+    else
+    {
+        page->next = slab->pages;
+        slab->pages = page;
+        slab->next_unused = (unsigned char*)(page + 1);
+        slab->num_unused = slab->objects_per_page;
+        result = 0;
+    }
+
+    return result;
+}
+
+static HSM_SLAB* create_slab(size_t object_size, size_t objects_per_page, bool secure)
+{
+    HSM_SLAB *result;
+    // rounding up also guarantees room for the free list link
+    size_t aligned_size = (object_size + HSM_SLAB_ALIGNMENT - 1) & ~((size_t)HSM_SLAB_ALIGNMENT - 1);
+
+    if ((object_size == 0) || (aligned_size < object_size))
+    {
+        LOG_ERROR("Invalid object size %zu", object_size);
+        result = NULL;
+    }
+    else if ((objects_per_page == 0) ||
+             (objects_per_page > (SIZE_MAX - sizeof(HSM_SLAB_PAGE)) / aligned_size))
+    {
+        LOG_ERROR("Invalid objects per page %zu", objects_per_page);
+        result = NULL;
+    }
+    else if ((result = (HSM_SLAB*)malloc(sizeof(HSM_SLAB))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for slab");
+    }
+    else
+    {
+        size_t page_size = sizeof(HSM_SLAB_PAGE) + (aligned_size * objects_per_page);
+        if (secure)
+        {
+            // secure pages are mapped directly so use up the whole mapping
+            size_t system_page_size = get_system_page_size();
+            page_size = ((page_size + system_page_size - 1) / system_page_size) * system_page_size;
+            objects_per_page = (page_size - sizeof(HSM_SLAB_PAGE)) / aligned_size;
+        }
+        result->object_size = aligned_size;
+        result->objects_per_page = objects_per_page;
+        result->secure = secure;
+        result->page_size = page_size;
+        result->pages = NULL;
+        result->free_objects = NULL;
+        result->next_unused = NULL;
+        result->num_unused = 0;
+        result->count = 0;
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Slab API
+//##############################################################################
+HSM_SLAB_HANDLE hsm_slab_create(size_t object_size, size_t objects_per_page)
+{
+    return create_slab(object_size, objects_per_page, false);
+}
+
+HSM_SLAB_HANDLE hsm_slab_create_secure(size_t object_size, size_t objects_per_page)
+{
+    return create_slab(object_size, objects_per_page, true);
+}
+
+void hsm_slab_destroy(HSM_SLAB_HANDLE slab)
+{
+    if (slab != NULL)
+    {
+        HSM_SLAB_PAGE *page = slab->pages;
+        while (page != NULL)
+        {
+            HSM_SLAB_PAGE *next = page->next;
+            if (slab->secure)
+            {
+                free_secure_page(page, slab->page_size);
+            }
+            else
+            {
+                free(page);
+            }
+            page = next;
+        }
+        free(slab);
+    }
+}
+
+void* hsm_slab_alloc(HSM_SLAB_HANDLE slab)
+{
+    void *result;
+
+    if (slab == NULL)
+    {
+        LOG_ERROR("Invalid parameters");
+        result = NULL;
+    }
+    else if (slab->free_objects != NULL)
+    {
+        result = slab->free_objects;
+        slab->free_objects = slab->free_objects->next;
+        if (slab->secure)
+        {
+            // the rest of the object was zeroized when it was released
+            ((HSM_SLAB_FREE_OBJECT*)result)->next = NULL;
+        }
+        slab->count++;
+    }
+    else if ((slab->num_unused == 0) && (add_page(slab) != 0))
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = slab->next_unused;
+        slab->next_unused += slab->object_size;
+        slab->num_unused--;
+        slab->count++;
+    }
+
+    return result;
+}
+
+void hsm_slab_free(HSM_SLAB_HANDLE slab, void *object)
+{
+    if ((slab == NULL) || (object == NULL))
+    {
+        LOG_ERROR("Invalid parameters");
+    }
+    else
+    {
+        HSM_SLAB_FREE_OBJECT *free_object = (HSM_SLAB_FREE_OBJECT*)object;
+        if (slab->secure)
+        {
+            hsm_key_mem_cleanse(object, slab->object_size);
+        }
+        free_object->next = slab->free_objects;
+        slab->free_objects = free_object;
+        slab->count--;
+    }
+}
+
+size_t hsm_slab_count(HSM_SLAB_HANDLE slab)
+{
+    return (slab != NULL) ? slab->count : 0;
+}
@@ -0,0 +1,40 @@
+#ifndef HSM_SLAB_H
+#define HSM_SLAB_H
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stddef.h>
+#endif
+
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+/**
+ * Fixed size object allocator.
+ *
+ * Objects are carved out of pages that each hold a fixed number of objects
+ * so that stores holding thousands of small entries do not pay for one heap
+ * allocation per entry. Released objects are kept on a free list and reused
+ * by later allocations. Pages are only returned to the heap when the slab is
+ * destroyed, at which point every object allocated from it is invalidated.
+ *
+ * Secure slabs hold key material. Their pages are locked in memory where the
+ * platform allows it so they are never written to swap, objects are zeroized
+ * when released and pages are zeroized before being returned to the system.
+ * The number of objects per page is rounded up to fill whole system pages.
+ */
+typedef struct HSM_SLAB_TAG* HSM_SLAB_HANDLE;
+
+MOCKABLE_FUNCTION(, HSM_SLAB_HANDLE, hsm_slab_create, size_t, object_size, size_t, objects_per_page);
+MOCKABLE_FUNCTION(, HSM_SLAB_HANDLE, hsm_slab_create_secure, size_t, object_size, size_t, objects_per_page);
+MOCKABLE_FUNCTION(, void, hsm_slab_destroy, HSM_SLAB_HANDLE, slab);
+MOCKABLE_FUNCTION(, void*, hsm_slab_alloc, HSM_SLAB_HANDLE, slab);
+MOCKABLE_FUNCTION(, void, hsm_slab_free, HSM_SLAB_HANDLE, slab, void*, object);
+MOCKABLE_FUNCTION(, size_t, hsm_slab_count, HSM_SLAB_HANDLE, slab);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_SLAB_H
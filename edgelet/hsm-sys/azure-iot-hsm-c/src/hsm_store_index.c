@@ -0,0 +1,372 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "hsm_log.h"
+#include "hsm_store_index.h"
+
+//##############################################################################
+// Data types
+//##############################################################################
+// must be a power of 2 so that probing can mask instead of divide
+#define STORE_INDEX_MIN_CAPACITY 16
+
+struct STORE_INDEX_SLOT_TAG
+{
+    uint32_t hash;
+    const char *key;
+    void *value;
+};
+typedef struct STORE_INDEX_SLOT_TAG STORE_INDEX_SLOT;
+
+struct STORE_INDEX_TAG
+{
+    STORE_INDEX_SLOT *slots;
+    size_t capacity;
+    size_t count;
+    // count of slots holding either a live entry or a tombstone
+    size_t used;
+};
+typedef struct STORE_INDEX_TAG STORE_INDEX;
+
+// removed slots point their key here so probe sequences are not broken
+static const char STORE_INDEX_TOMBSTONE[] = "";
+
+//##############################################################################
+// Index helpers
+//##############################################################################
+static uint32_t compute_key_hash(const char *key)
+{
+    // 32 bit FNV-1a
+    uint32_t result = 2166136261U;
+
+    while (*key != '\0')
+    {
+        result ^= (unsigned char)*key++;
+        result *= 16777619U;
+    }
+
+    return result;
+}
+
+static STORE_INDEX_SLOT* lookup_slot
+(
+    const STORE_INDEX *index,
+    const char *key,
+    uint32_t hash,
+    STORE_INDEX_SLOT **free_slot
+)
+{
+    STORE_INDEX_SLOT *result = NULL;
+    STORE_INDEX_SLOT *first_free = NULL;
+    size_t mask = index->capacity - 1;
+    size_t pos = hash & mask;
+
+    // the index is never full so probing always reaches an empty slot
+    while (index->slots[pos].key != NULL)
+    {
+        STORE_INDEX_SLOT *slot = &index->slots[pos];
+        if (slot->key == STORE_INDEX_TOMBSTONE)
+        {
+            if (first_free == NULL)
+            {
+                first_free = slot;
+            }
+        }
+        else if ((slot->hash == hash) &&
+                 ((slot->key == key) || (strcmp(slot->key, key) == 0)))
+        {
+            result = slot;
+            break;
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    if (free_slot != NULL)
+    {
+        *free_slot = (first_free != NULL) ? first_free : &index->slots[pos];
+    }
+
+    return result;
+}
+
+static int resize_index(STORE_INDEX *index, size_t capacity)
+{
+    int result;
+    STORE_INDEX_SLOT *slots;
+
+    if ((slots = (STORE_INDEX_SLOT*)calloc(capacity, sizeof(STORE_INDEX_SLOT))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for %zu index slots", capacity);
+        result = __FAILURE__;
+    }
+    else
+    {
+        size_t idx;
+        size_t mask = capacity - 1;
+
+        for (idx = 0; idx < index->capacity; idx++)
+        {
+            STORE_INDEX_SLOT *slot = &index->slots[idx];
+            if ((slot->key != NULL) && (slot->key != STORE_INDEX_TOMBSTONE))
+            {
+                size_t pos = slot->hash & mask;
+                while (slots[pos].key != NULL)
+                {
+                    pos = (pos + 1) & mask;
+                }
+                slots[pos] = *slot;
+            }
+        }
+        free(index->slots);
+        index->slots = slots;
+        index->capacity = capacity;
+        index->used = index->count;
+        result = 0;
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Index API
+//##############################################################################
+STORE_INDEX_HANDLE store_index_create(void)
+{
+    STORE_INDEX *result;
+
+    if ((result = (STORE_INDEX*)malloc(sizeof(STORE_INDEX))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for store index");
+    }
+    else if ((result->slots = (STORE_INDEX_SLOT*)calloc(STORE_INDEX_MIN_CAPACITY,
+                                                        sizeof(STORE_INDEX_SLOT))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for store index slots");
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        result->capacity = STORE_INDEX_MIN_CAPACITY;
+        result->count = 0;
+        result->used = 0;
+    }
+
+    return result;
+}
+
+void store_index_destroy(STORE_INDEX_HANDLE index, STORE_INDEX_DESTROY_VALUE destroy_value)
+{
+    if (index != NULL)
+    {
+        if (destroy_value != NULL)
+        {
+            size_t idx;
+            for (idx = 0; idx < index->capacity; idx++)
+            {
+                STORE_INDEX_SLOT *slot = &index->slots[idx];
+                if ((slot->key != NULL) && (slot->key != STORE_INDEX_TOMBSTONE))
+                {
+                    destroy_value(slot->value);
+                }
+            }
+        }
+        free(index->slots);
+        free(index);
+    }
+}
+
+STORE_INDEX_HANDLE store_index_clone(STORE_INDEX_HANDLE index)
+{
+    STORE_INDEX *result;
+
+    if (index == NULL)
+    {
+        LOG_ERROR("Invalid parameters");
+        result = NULL;
+    }
+    else if ((result = (STORE_INDEX*)malloc(sizeof(STORE_INDEX))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for store index");
+    }
+    else if ((result->slots = (STORE_INDEX_SLOT*)malloc(index->capacity * sizeof(STORE_INDEX_SLOT))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for %zu index slots", index->capacity);
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        // tombstones are copied as is and still compare equal to STORE_INDEX_TOMBSTONE
+        memcpy(result->slots, index->slots, index->capacity * sizeof(STORE_INDEX_SLOT));
+        result->capacity = index->capacity;
+        result->count = index->count;
+        result->used = index->used;
+    }
+
+    return result;
+}
+
+void* store_index_find(STORE_INDEX_HANDLE index, const char *key)
+{
+    void *result;
+
+    if ((index == NULL) || (key == NULL))
+    {
+        LOG_ERROR("Invalid parameters");
+        result = NULL;
+    }
+    else
+    {
+        STORE_INDEX_SLOT *slot = lookup_slot(index, key, compute_key_hash(key), NULL);
+        result = (slot != NULL) ? slot->value : NULL;
+    }
+
+    return result;
+}
+
+int store_index_put
+(
+    STORE_INDEX_HANDLE index,
+    const char *key,
+    void *value,
+    void **replaced_value
+)
+{
+    int result;
+
+    if ((index == NULL) || (key == NULL) || (value == NULL))
+    {
+        LOG_ERROR("Invalid parameters");
+        result = __FAILURE__;
+    }
+    else
+    {
+        uint32_t hash = compute_key_hash(key);
+        STORE_INDEX_SLOT *free_slot = NULL;
+        STORE_INDEX_SLOT *slot = lookup_slot(index, key, hash, &free_slot);
+
+        if (slot != NULL)
+        {
+            // the new entry owns the key from now on
+            if (replaced_value != NULL)
+            {
+                *replaced_value = slot->value;
+            }
+            slot->key = key;
+            slot->value = value;
+            result = 0;
+        }
+        else
+        {
+            // keep at most 3/4 of the slots in use, a rebuild also drops tombstones
+            if ((free_slot->key == NULL) && (4 * (index->used + 1) > 3 * index->capacity))
+            {
+                size_t capacity = index->capacity;
+                while ((2 * (index->count + 1) > capacity) && (capacity <= SIZE_MAX / 2))
+                {
+                    capacity *= 2;
+                }
+                if (resize_index(index, capacity) != 0)
+                {
+                    LOG_ERROR("Could not grow store index");
+                    free_slot = NULL;
+                }
+                else
+                {
+                    (void)lookup_slot(index, key, hash, &free_slot);
+                }
+            }
+
+            if (free_slot == NULL)
+            {
+                result = __FAILURE__;
+            }
+            else
+            {
+                if (free_slot->key == NULL)
+                {
+                    index->used++;
+                }
+                free_slot->hash = hash;
+                free_slot->key = key;
+                free_slot->value = value;
+                index->count++;
+                if (replaced_value != NULL)
+                {
+                    *replaced_value = NULL;
+                }
+                result = 0;
+            }
+        }
+    }
+
+    return result;
+}
+
+void* store_index_remove(STORE_INDEX_HANDLE index, const char *key)
+{
+    void *result;
+
+    if ((index == NULL) || (key == NULL))
+    {
+        LOG_ERROR("Invalid parameters");
+        result = NULL;
+    }
+    else
+    {
+        STORE_INDEX_SLOT *slot = lookup_slot(index, key, compute_key_hash(key), NULL);
+        if (slot == NULL)
+        {
+            result = NULL;
+        }
+        else
+        {
+            result = slot->value;
+            slot->key = STORE_INDEX_TOMBSTONE;
+            slot->value = NULL;
+            index->count--;
+            if (index->count == 0)
+            {
+                // nothing left to probe past so all tombstones can be cleared
+                memset(index->slots, 0, index->capacity * sizeof(STORE_INDEX_SLOT));
+                index->used = 0;
+            }
+        }
+    }
+
+    return result;
+}
+
+size_t store_index_count(STORE_INDEX_HANDLE index)
+{
+    return (index != NULL) ? index->count : 0;
+}
+
+int store_index_foreach(STORE_INDEX_HANDLE index, STORE_INDEX_VISIT_VALUE visit_value, void *context)
+{
+    int result;
+
+    if ((index == NULL) || (visit_value == NULL))
+    {
+        LOG_ERROR("Invalid parameters");
+        result = __FAILURE__;
+    }
+    else
+    {
+        size_t idx;
+        result = 0;
+        for (idx = 0; (idx < index->capacity) && (result == 0); idx++)
+        {
+            STORE_INDEX_SLOT *slot = &index->slots[idx];
+            if ((slot->key != NULL) && (slot->key != STORE_INDEX_TOMBSTONE))
+            {
+                result = visit_value(slot->value, context);
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,41 @@
+#ifndef HSM_STORE_INDEX_H
+#define HSM_STORE_INDEX_H
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stddef.h>
+#endif
+
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+/**
+ * Open addressing hash index mapping store aliases to values.
+ *
+ * Keys are not copied. The index refers to the alias string owned by the
+ * indexed entry, which must remain valid for as long as it is indexed.
+ * Hashes are computed once on insertion and cached alongside each key so
+ * probing and growing the index never re-hash an alias.
+ */
+typedef struct STORE_INDEX_TAG* STORE_INDEX_HANDLE;
+
+typedef void (*STORE_INDEX_DESTROY_VALUE)(void *value);
+// returning non zero stops the iteration
+typedef int (*STORE_INDEX_VISIT_VALUE)(void *value, void *context);
+
+MOCKABLE_FUNCTION(, STORE_INDEX_HANDLE, store_index_create);
+MOCKABLE_FUNCTION(, void, store_index_destroy, STORE_INDEX_HANDLE, index, STORE_INDEX_DESTROY_VALUE, destroy_value);
+// the copy refers to the same keys and values as the original
+MOCKABLE_FUNCTION(, STORE_INDEX_HANDLE, store_index_clone, STORE_INDEX_HANDLE, index);
+MOCKABLE_FUNCTION(, void*, store_index_find, STORE_INDEX_HANDLE, index, const char*, key);
+MOCKABLE_FUNCTION(, int, store_index_put, STORE_INDEX_HANDLE, index, const char*, key, void*, value, void**, replaced_value);
+MOCKABLE_FUNCTION(, void*, store_index_remove, STORE_INDEX_HANDLE, index, const char*, key);
+MOCKABLE_FUNCTION(, size_t, store_index_count, STORE_INDEX_HANDLE, index);
+MOCKABLE_FUNCTION(, int, store_index_foreach, STORE_INDEX_HANDLE, index, STORE_INDEX_VISIT_VALUE, visit_value, void*, context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_STORE_INDEX_H
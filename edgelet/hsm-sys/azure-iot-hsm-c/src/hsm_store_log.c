@@ -0,0 +1,1171 @@
+#if defined __linux__ && !defined _GNU_SOURCE
+    // for O_CLOEXEC, pwrite, ftruncate and madvise with strict C standard flags
+    #define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/strings.h"
+#include "hsm_atomic.h"
+#include "hsm_fault.h"
+#include "hsm_key_mem.h"
+#include "hsm_log.h"
+#include "hsm_metrics.h"
+#include "hsm_store_index.h"
+#include "hsm_store_log.h"
+
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    #include <io.h>
+    #include <windows.h>
+#else
+    #include <libgen.h>
+    #include <sys/file.h>
+    #include <sys/mman.h>
+    #include <sys/types.h>
+    #include <unistd.h>
+#endif
+
+//##############################################################################
+// Data types
+//##############################################################################
+/**
+ * Log layout, all integers are little endian:
+ *
+ *   header: "HSMLOG01"
+ *   record: magic (4) | type (4) | key size (4) | value size (4) |
+ *           key | value | CRC-32 of type through value (4)
+ */
+static const char HSM_STORE_LOG_HEADER[] = "HSMLOG01";
+#define HSM_STORE_LOG_HEADER_SIZE (sizeof(HSM_STORE_LOG_HEADER) - 1)
+
+#define HSM_STORE_LOG_RECORD_MAGIC 0x5253534CU
+#define HSM_STORE_LOG_RECORD_PUT 1U
+#define HSM_STORE_LOG_RECORD_REMOVE 2U
+#define HSM_STORE_LOG_RECORD_HEADER_SIZE 16
+#define HSM_STORE_LOG_RECORD_TRAILER_SIZE 4
+
+#define HSM_STORE_LOG_MAX_KEY_SIZE 1024
+#define HSM_STORE_LOG_MAX_VALUE_SIZE (1024 * 1024)
+
+// superseded records are only compacted away once they take up this much space
+#define HSM_STORE_LOG_COMPACT_MIN_BYTES (64 * 1024)
+
+static const char *COMPACT_FILE_EXT = ".compact";
+
+// values are typically key material and are kept in key memory
+struct HSM_STORE_LOG_ENTRY_TAG
+{
+    char *key;
+    unsigned char *value;
+    size_t value_size;
+    // size of the record holding the current value
+    size_t record_size;
+};
+typedef struct HSM_STORE_LOG_ENTRY_TAG HSM_STORE_LOG_ENTRY;
+
+// the lock serializes every operation on the log, including the index
+struct HSM_STORE_LOG_TAG
+{
+    LOCK_HANDLE lock;
+#if defined(HSM_LOCK_PROFILING)
+    HSM_ATOMIC_LONG users;
+#endif
+    STRING_HANDLE file_path;
+    int fd;
+    STORE_INDEX_HANDLE index;
+    uint64_t end_offset;
+    // bytes taken up by records holding current values and by superseded ones
+    uint64_t live_bytes;
+    uint64_t dead_bytes;
+};
+typedef struct HSM_STORE_LOG_TAG HSM_STORE_LOG;
+
+struct COMPACT_CONTEXT_TAG
+{
+    int fd;
+    uint64_t offset;
+};
+typedef struct COMPACT_CONTEXT_TAG COMPACT_CONTEXT;
+
+//##############################################################################
+// Platform file helpers
+//##############################################################################
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+static int open_log_file(const char *file_path, bool truncate)
+{
+    int flags = _O_RDWR | _O_CREAT | _O_BINARY | _O_NOINHERIT | (truncate ? _O_TRUNC : 0);
+    return _open(file_path, flags, _S_IREAD | _S_IWRITE);
+}
+
+static int write_log_file(int fd, const void *data, size_t data_size, uint64_t offset)
+{
+    int result;
+#if defined(HSM_FAULT_INJECTION)
+    // an injected fault writes part of the record at most and then fails
+    bool fault = (hsm_fault_file_write(&data_size) != 0);
+#endif
+
+    if ((data_size > INT_MAX) || (_lseeki64(fd, (__int64)offset, SEEK_SET) < 0) ||
+        (_write(fd, data, (unsigned int)data_size) != (int)data_size))
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+#if defined(HSM_FAULT_INJECTION)
+    if (fault)
+    {
+        result = __FAILURE__;
+    }
+#endif
+
+    return result;
+}
+
+static int sync_log_file(int fd)
+{
+    return (_commit(fd) == 0) ? 0 : __FAILURE__;
+}
+
+static int truncate_log_file(int fd, uint64_t size)
+{
+    return (_chsize_s(fd, (__int64)size) == 0) ? 0 : __FAILURE__;
+}
+
+static int replace_log_file(const char *from_path, const char *to_path)
+{
+    return MoveFileExA(from_path, to_path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ?
+           0 : __FAILURE__;
+}
+
+static unsigned char* map_log_file(int fd, size_t size)
+{
+    unsigned char *result;
+
+    if ((result = (unsigned char*)malloc(size)) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory to read the store log");
+    }
+    else if ((size > INT_MAX) || (_lseeki64(fd, 0, SEEK_SET) < 0) ||
+             (_read(fd, result, (unsigned int)size) != (int)size))
+    {
+        LOG_ERROR("Could not read the store log");
+        free(result);
+        result = NULL;
+    }
+
+    return result;
+}
+
+static void unmap_log_file(unsigned char *data, size_t size)
+{
+    (void)size;
+    free(data);
+}
+
+#define close_log_file(fd) (void)_close(fd)
+#define LOG_FILE_STAT_T struct _stat64
+#define stat_log_file(fd, st) _fstat64((fd), (st))
+#else
+static int open_log_file(const char *file_path, bool truncate)
+{
+    int flags = O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+    int fd = open(file_path, flags, S_IRUSR | S_IWUSR);
+
+    // the log is mapped while it is replayed and a mapping faults with SIGBUS
+    // if its file is truncated, so no other process may use the log meanwhile
+    if ((fd >= 0) && (flock(fd, LOCK_EX | LOCK_NB) != 0))
+    {
+        LOG_ERROR("Store log %s is in use by another process. Errno: %s.", file_path, strerror(errno));
+        (void)close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+static int write_log_file(int fd, const void *data, size_t data_size, uint64_t offset)
+{
+    int result = 0;
+    const unsigned char *ptr = (const unsigned char*)data;
+#if defined(HSM_FAULT_INJECTION)
+    // an injected fault writes part of the record at most and then fails
+    bool fault = (hsm_fault_file_write(&data_size) != 0);
+#endif
+
+    while ((result == 0) && (data_size > 0))
+    {
+        ssize_t num_written = pwrite(fd, ptr, data_size, (off_t)offset);
+        if (num_written < 0)
+        {
+            if (errno != EINTR)
+            {
+                result = __FAILURE__;
+            }
+        }
+        else
+        {
+            ptr += num_written;
+            data_size -= (size_t)num_written;
+            offset += (uint64_t)num_written;
+        }
+    }
+#if defined(HSM_FAULT_INJECTION)
+    if (fault)
+    {
+        result = __FAILURE__;
+    }
+#endif
+
+    return result;
+}
+
+static int sync_log_file(int fd)
+{
+    return (fsync(fd) == 0) ? 0 : __FAILURE__;
+}
+
+static int truncate_log_file(int fd, uint64_t size)
+{
+    return (ftruncate(fd, (off_t)size) == 0) ? 0 : __FAILURE__;
+}
+
+static int sync_parent_dir(const char *file_path)
+{
+    int result;
+    char *path_copy;
+
+    if ((path_copy = (char*)malloc(strlen(file_path) + 1)) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for the store log path");
+        result = __FAILURE__;
+    }
+    else
+    {
+        int dir_fd;
+        strcpy(path_copy, file_path);
+        // dirname may modify its argument
+        if ((dir_fd = open(dirname(path_copy), O_RDONLY | O_CLOEXEC)) < 0)
+        {
+            LOG_ERROR("Could not open the store log directory. Errno: %s.", strerror(errno));
+            result = __FAILURE__;
+        }
+        else
+        {
+            if (fsync(dir_fd) != 0)
+            {
+                LOG_ERROR("Could not sync the store log directory. Errno: %s.", strerror(errno));
+                result = __FAILURE__;
+            }
+            else
+            {
+                result = 0;
+            }
+            (void)close(dir_fd);
+        }
+        free(path_copy);
+    }
+
+    return result;
+}
+
+static int replace_log_file(const char *from_path, const char *to_path)
+{
+    int result;
+
+    if (rename(from_path, to_path) != 0)
+    {
+        LOG_ERROR("Could not replace the store log. Errno: %s.", strerror(errno));
+        result = __FAILURE__;
+    }
+    else
+    {
+        // the rename is only durable once the directory entry is synced
+        result = sync_parent_dir(to_path);
+    }
+
+    return result;
+}
+
+static unsigned char* map_log_file(int fd, size_t size)
+{
+    unsigned char *result;
+    // private and read only, the log is only ever changed through its fd
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (data == MAP_FAILED)
+    {
+        LOG_ERROR("Could not map the store log. Errno: %s.", strerror(errno));
+        result = NULL;
+    }
+    else
+    {
+        // the log is replayed front to back exactly once
+        (void)madvise(data, size, MADV_SEQUENTIAL);
+        result = (unsigned char*)data;
+    }
+
+    return result;
+}
+
+static void unmap_log_file(unsigned char *data, size_t size)
+{
+    (void)munmap(data, size);
+}
+
+#define close_log_file(fd) (void)close(fd)
+#define LOG_FILE_STAT_T struct stat
+#define stat_log_file(fd, st) fstat((fd), (st))
+#endif
+
+//##############################################################################
+// Record encoding helpers
+//##############################################################################
+static uint32_t compute_crc32(const unsigned char *data, size_t data_size)
+{
+    // CRC-32 (IEEE 802.3) a nibble at a time to keep the table small
+    static const uint32_t CRC32_NIBBLE_TABLE[16] =
+    {
+        0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU,
+        0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+        0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU,
+        0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU
+    };
+    uint32_t result = 0xFFFFFFFFU;
+    size_t idx;
+
+    for (idx = 0; idx < data_size; idx++)
+    {
+        result ^= data[idx];
+        result = (result >> 4) ^ CRC32_NIBBLE_TABLE[result & 0x0F];
+        result = (result >> 4) ^ CRC32_NIBBLE_TABLE[result & 0x0F];
+    }
+
+    return ~result;
+}
+
+static void encode_uint32(unsigned char *buffer, uint32_t value)
+{
+    buffer[0] = (unsigned char)(value & 0xFF);
+    buffer[1] = (unsigned char)((value >> 8) & 0xFF);
+    buffer[2] = (unsigned char)((value >> 16) & 0xFF);
+    buffer[3] = (unsigned char)((value >> 24) & 0xFF);
+}
+
+static uint32_t decode_uint32(const unsigned char *buffer)
+{
+    return ((uint32_t)buffer[0]) |
+           ((uint32_t)buffer[1] << 8) |
+           ((uint32_t)buffer[2] << 16) |
+           ((uint32_t)buffer[3] << 24);
+}
+
+static size_t get_record_size(size_t key_size, size_t value_size)
+{
+    return HSM_STORE_LOG_RECORD_HEADER_SIZE + key_size + value_size +
+           HSM_STORE_LOG_RECORD_TRAILER_SIZE;
+}
+
+static unsigned char* encode_record
+(
+    uint32_t record_type,
+    const char *key,
+    size_t key_size,
+    const unsigned char *value,
+    size_t value_size,
+    size_t *record_size
+)
+{
+    unsigned char *result;
+    size_t size = get_record_size(key_size, value_size);
+
+    // records of put updates hold a copy of the value
+    if ((result = (unsigned char*)hsm_key_mem_alloc(size)) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for store log record");
+    }
+    else
+    {
+        unsigned char *ptr = result;
+        encode_uint32(ptr, HSM_STORE_LOG_RECORD_MAGIC);
+        encode_uint32(ptr + 4, record_type);
+        encode_uint32(ptr + 8, (uint32_t)key_size);
+        encode_uint32(ptr + 12, (uint32_t)value_size);
+        ptr += HSM_STORE_LOG_RECORD_HEADER_SIZE;
+        memcpy(ptr, key, key_size);
+        ptr += key_size;
+        if (value_size != 0)
+        {
+            memcpy(ptr, value, value_size);
+            ptr += value_size;
+        }
+        // the magic is excluded so that it can be used to resync on corruption
+        encode_uint32(ptr, compute_crc32(result + 4, (size_t)(ptr - result) - 4));
+        *record_size = size;
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Index helpers
+//##############################################################################
+static void destroy_entry(HSM_STORE_LOG_ENTRY *entry)
+{
+    hsm_key_mem_free(entry->value, entry->value_size);
+    free(entry->key);
+    free(entry);
+}
+
+static void destroy_entry_cb(void *value)
+{
+    destroy_entry((HSM_STORE_LOG_ENTRY*)value);
+}
+
+static char* copy_key(const char *key, size_t key_size)
+{
+    char *result;
+
+    if ((result = (char*)malloc(key_size + 1)) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for store log key");
+    }
+    else
+    {
+        memcpy(result, key, key_size);
+        result[key_size] = 0;
+    }
+
+    return result;
+}
+
+static int apply_put
+(
+    HSM_STORE_LOG *log,
+    const char *key,
+    size_t key_size,
+    const unsigned char *value,
+    size_t value_size,
+    size_t record_size
+)
+{
+    int result;
+    HSM_STORE_LOG_ENTRY *entry;
+    void *replaced = NULL;
+
+    if ((entry = (HSM_STORE_LOG_ENTRY*)malloc(sizeof(HSM_STORE_LOG_ENTRY))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for store log entry");
+        result = __FAILURE__;
+    }
+    else if ((entry->key = copy_key(key, key_size)) == NULL)
+    {
+        free(entry);
+        result = __FAILURE__;
+    }
+    else if ((entry->value = (unsigned char*)hsm_key_mem_alloc(value_size)) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for store log value");
+        free(entry->key);
+        free(entry);
+        result = __FAILURE__;
+    }
+    else
+    {
+        memcpy(entry->value, value, value_size);
+        entry->value_size = value_size;
+        entry->record_size = record_size;
+        if (store_index_put(log->index, entry->key, entry, &replaced) != 0)
+        {
+            LOG_ERROR("Could not index store log entry");
+            destroy_entry(entry);
+            result = __FAILURE__;
+        }
+        else
+        {
+            if (replaced != NULL)
+            {
+                HSM_STORE_LOG_ENTRY *replaced_entry = (HSM_STORE_LOG_ENTRY*)replaced;
+                log->live_bytes -= replaced_entry->record_size;
+                log->dead_bytes += replaced_entry->record_size;
+                destroy_entry(replaced_entry);
+            }
+            log->live_bytes += record_size;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int apply_remove(HSM_STORE_LOG *log, const char *key, size_t key_size, size_t record_size)
+{
+    int result;
+    char *key_copy;
+
+    if ((key_copy = copy_key(key, key_size)) == NULL)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        HSM_STORE_LOG_ENTRY *removed = (HSM_STORE_LOG_ENTRY*)store_index_remove(log->index, key_copy);
+        if (removed != NULL)
+        {
+            log->live_bytes -= removed->record_size;
+            log->dead_bytes += removed->record_size;
+            destroy_entry(removed);
+        }
+        // remove records are never needed after compaction
+        log->dead_bytes += record_size;
+        free(key_copy);
+        result = 0;
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Log helpers
+//##############################################################################
+// returns the size of the valid record at pos, 0 when there is none
+static size_t check_record(const unsigned char *data, size_t data_size, size_t pos)
+{
+    size_t result = 0;
+
+    if (data_size - pos >= get_record_size(0, 0))
+    {
+        const unsigned char *record = data + pos;
+        uint32_t record_type = decode_uint32(record + 4);
+        size_t key_size = decode_uint32(record + 8);
+        size_t value_size = decode_uint32(record + 12);
+        size_t record_size;
+
+        if ((decode_uint32(record) == HSM_STORE_LOG_RECORD_MAGIC) &&
+            ((record_type == HSM_STORE_LOG_RECORD_PUT) || (record_type == HSM_STORE_LOG_RECORD_REMOVE)) &&
+            (key_size != 0) && (key_size <= HSM_STORE_LOG_MAX_KEY_SIZE) &&
+            (value_size <= HSM_STORE_LOG_MAX_VALUE_SIZE) &&
+            ((record_type != HSM_STORE_LOG_RECORD_PUT) || (value_size != 0)) &&
+            ((record_type != HSM_STORE_LOG_RECORD_REMOVE) || (value_size == 0)) &&
+            ((record_size = get_record_size(key_size, value_size)) <= data_size - pos) &&
+            (compute_crc32(record + 4, record_size - HSM_STORE_LOG_RECORD_TRAILER_SIZE - 4) ==
+             decode_uint32(record + record_size - HSM_STORE_LOG_RECORD_TRAILER_SIZE)))
+        {
+            result = record_size;
+        }
+    }
+
+    return result;
+}
+
+// an interrupted append only damages the last record, so a valid record
+// after pos means that the log was corrupted in the middle
+static bool has_record_after(const unsigned char *data, size_t data_size, size_t pos)
+{
+    bool result = false;
+    size_t idx;
+
+    for (idx = pos + 1; !result && (data_size - idx >= get_record_size(0, 0)); idx++)
+    {
+        result = (check_record(data, data_size, idx) != 0);
+    }
+
+    return result;
+}
+
+static int replay_log(HSM_STORE_LOG *log, const unsigned char *data, size_t data_size, size_t *valid_size)
+{
+    int result = 0;
+    size_t pos = HSM_STORE_LOG_HEADER_SIZE;
+    size_t record_size;
+
+    while ((result == 0) && ((record_size = check_record(data, data_size, pos)) != 0))
+    {
+        const unsigned char *record = data + pos;
+        const char *key = (const char*)(record + HSM_STORE_LOG_RECORD_HEADER_SIZE);
+        size_t key_size = decode_uint32(record + 8);
+
+        if (decode_uint32(record + 4) == HSM_STORE_LOG_RECORD_PUT)
+        {
+            result = apply_put(log, key, key_size, (const unsigned char*)key + key_size,
+                               decode_uint32(record + 12), record_size);
+        }
+        else
+        {
+            result = apply_remove(log, key, key_size, record_size);
+        }
+        pos += record_size;
+    }
+
+    *valid_size = pos;
+
+    return result;
+}
+
+static int load_log(HSM_STORE_LOG *log)
+{
+    int result;
+    LOG_FILE_STAT_T file_stat;
+    const char *file_path = STRING_c_str(log->file_path);
+
+    if (stat_log_file(log->fd, &file_stat) != 0)
+    {
+        LOG_ERROR("Could not stat store log %s", file_path);
+        result = __FAILURE__;
+    }
+    else if (file_stat.st_size == 0)
+    {
+        if ((write_log_file(log->fd, HSM_STORE_LOG_HEADER, HSM_STORE_LOG_HEADER_SIZE, 0) != 0) ||
+            (sync_log_file(log->fd) != 0))
+        {
+            LOG_ERROR("Could not initialize store log %s", file_path);
+            result = __FAILURE__;
+        }
+        else
+        {
+            log->end_offset = HSM_STORE_LOG_HEADER_SIZE;
+            result = 0;
+        }
+    }
+    else if (((uint64_t)file_stat.st_size < HSM_STORE_LOG_HEADER_SIZE) ||
+             ((uint64_t)file_stat.st_size > SIZE_MAX))
+    {
+        LOG_ERROR("Invalid store log %s", file_path);
+        result = __FAILURE__;
+    }
+    else
+    {
+        size_t file_size = (size_t)file_stat.st_size;
+        unsigned char *data;
+
+        if ((data = map_log_file(log->fd, file_size)) == NULL)
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            size_t valid_size = 0;
+
+            if (memcmp(data, HSM_STORE_LOG_HEADER, HSM_STORE_LOG_HEADER_SIZE) != 0)
+            {
+                LOG_ERROR("Invalid store log header in %s", file_path);
+                result = __FAILURE__;
+            }
+            else if (replay_log(log, data, file_size, &valid_size) != 0)
+            {
+                LOG_ERROR("Could not replay store log %s", file_path);
+                result = __FAILURE__;
+            }
+            else if (valid_size == file_size)
+            {
+                log->end_offset = file_size;
+                result = 0;
+            }
+            else if (has_record_after(data, file_size, valid_size))
+            {
+                // keys written after the damage would be lost by truncating,
+                // the file is left as is so that it can be recovered
+                LOG_ERROR("Store log %s is corrupt at offset %zu, valid records follow",
+                          file_path, valid_size);
+                result = __FAILURE__;
+            }
+            else
+            {
+                // left behind by an interrupted append, none of it was acknowledged
+                LOG_ERROR("Discarding %zu bytes at the end of store log %s",
+                          file_size - valid_size, file_path);
+                if ((truncate_log_file(log->fd, valid_size) != 0) ||
+                    (sync_log_file(log->fd) != 0))
+                {
+                    LOG_ERROR("Could not truncate store log %s", file_path);
+                    result = __FAILURE__;
+                }
+                else
+                {
+                    log->end_offset = valid_size;
+                    result = 0;
+                }
+            }
+            unmap_log_file(data, file_size);
+        }
+    }
+
+    return result;
+}
+
+static int append_record(HSM_STORE_LOG *log, const unsigned char *record, size_t record_size)
+{
+    int result;
+
+    if ((write_log_file(log->fd, record, record_size, log->end_offset) != 0) ||
+        (sync_log_file(log->fd) != 0))
+    {
+        LOG_ERROR("Could not append to store log %s", STRING_c_str(log->file_path));
+        // drop whatever part of the record made it to the file
+        (void)truncate_log_file(log->fd, log->end_offset);
+        result = __FAILURE__;
+    }
+    else
+    {
+        log->end_offset += record_size;
+        result = 0;
+    }
+
+    return result;
+}
+
+static int write_compacted_entry(void *value, void *context)
+{
+    int result;
+    HSM_STORE_LOG_ENTRY *entry = (HSM_STORE_LOG_ENTRY*)value;
+    COMPACT_CONTEXT *compact_context = (COMPACT_CONTEXT*)context;
+    unsigned char *record;
+    size_t record_size = 0;
+
+    if ((record = encode_record(HSM_STORE_LOG_RECORD_PUT, entry->key, strlen(entry->key),
+                                entry->value, entry->value_size, &record_size)) == NULL)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        if (write_log_file(compact_context->fd, record, record_size, compact_context->offset) != 0)
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            compact_context->offset += record_size;
+            result = 0;
+        }
+        hsm_key_mem_free(record, record_size);
+    }
+
+    return result;
+}
+
+static bool should_compact(const HSM_STORE_LOG *log)
+{
+    return (log->dead_bytes >= HSM_STORE_LOG_COMPACT_MIN_BYTES) &&
+           (log->dead_bytes > log->live_bytes);
+}
+
+static int lock_log(HSM_STORE_LOG *log)
+{
+    int result;
+#if defined(HSM_LOCK_PROFILING)
+    bool contended = (hsm_atomic_inc(&log->users) > 1);
+    uint64_t start = contended ? hsm_metrics_now() : 0;
+#endif
+
+    if (Lock(log->lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not acquire the store log lock");
+#if defined(HSM_LOCK_PROFILING)
+        (void)hsm_atomic_dec(&log->users);
+#endif
+        result = __FAILURE__;
+    }
+    else
+    {
+#if defined(HSM_LOCK_PROFILING)
+        hsm_metrics_lock_wait(HSM_METRICS_LOCK_STORE_LOG, start, contended);
+#endif
+        result = 0;
+    }
+
+    return result;
+}
+
+static void unlock_log(HSM_STORE_LOG *log)
+{
+    if (Unlock(log->lock) != LOCK_OK)
+    {
+        LOG_ERROR("Could not release the store log lock");
+    }
+#if defined(HSM_LOCK_PROFILING)
+    (void)hsm_atomic_dec(&log->users);
+#endif
+}
+
+// the caller holds the log lock
+static int compact_log(HSM_STORE_LOG *log)
+{
+    int result;
+    STRING_HANDLE compact_path;
+
+    if (((compact_path = STRING_clone(log->file_path)) == NULL) ||
+        (STRING_concat(compact_path, COMPACT_FILE_EXT) != 0))
+    {
+        LOG_ERROR("Could not construct compacted store log path");
+        STRING_delete(compact_path);
+        result = __FAILURE__;
+    }
+    else
+    {
+        COMPACT_CONTEXT context;
+        const char *file_path = STRING_c_str(log->file_path);
+
+        if ((context.fd = open_log_file(STRING_c_str(compact_path), true)) < 0)
+        {
+            LOG_ERROR("Could not create compacted store log. Errno: %s.", strerror(errno));
+            result = __FAILURE__;
+        }
+        else
+        {
+            int fd;
+            context.offset = HSM_STORE_LOG_HEADER_SIZE;
+            if ((write_log_file(context.fd, HSM_STORE_LOG_HEADER, HSM_STORE_LOG_HEADER_SIZE, 0) != 0) ||
+                (store_index_foreach(log->index, write_compacted_entry, &context) != 0) ||
+                (sync_log_file(context.fd) != 0))
+            {
+                LOG_ERROR("Could not write compacted store log");
+                close_log_file(context.fd);
+                (void)remove(STRING_c_str(compact_path));
+                result = __FAILURE__;
+            }
+            else
+            {
+                // the old log must not be written to once it has been replaced
+                close_log_file(context.fd);
+                close_log_file(log->fd);
+                if (replace_log_file(STRING_c_str(compact_path), file_path) != 0)
+                {
+                    LOG_ERROR("Could not replace store log %s", file_path);
+                    (void)remove(STRING_c_str(compact_path));
+                    result = __FAILURE__;
+                }
+                else
+                {
+                    result = 0;
+                }
+
+                // either the compacted or the original log is in place now
+                if ((fd = open_log_file(file_path, false)) < 0)
+                {
+                    LOG_ERROR("Could not reopen store log %s. Errno: %s.", file_path, strerror(errno));
+                    log->fd = -1;
+                    result = __FAILURE__;
+                }
+                else
+                {
+                    log->fd = fd;
+                    if (result == 0)
+                    {
+                        log->end_offset = context.offset;
+                        log->live_bytes = context.offset - HSM_STORE_LOG_HEADER_SIZE;
+                        log->dead_bytes = 0;
+                    }
+                }
+            }
+        }
+        STRING_delete(compact_path);
+    }
+
+    return result;
+}
+
+static void compact_if_needed(HSM_STORE_LOG *log)
+{
+    if (should_compact(log) && (compact_log(log) != 0))
+    {
+        // the log is still consistent, compaction is retried on the next update
+        LOG_ERROR("Could not compact store log %s", STRING_c_str(log->file_path));
+    }
+}
+
+//##############################################################################
+// Store log API
+//##############################################################################
+HSM_STORE_LOG_HANDLE hsm_store_log_open(const char *file_path)
+{
+    HSM_STORE_LOG *result;
+
+    if ((file_path == NULL) || (strlen(file_path) == 0))
+    {
+        LOG_ERROR("Invalid store log path");
+        result = NULL;
+    }
+    else if ((result = (HSM_STORE_LOG*)calloc(1, sizeof(HSM_STORE_LOG))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for store log");
+    }
+    else if ((result->lock = Lock_Init()) == NULL)
+    {
+        LOG_ERROR("Could not create store log lock");
+        free(result);
+        result = NULL;
+    }
+    else if ((result->file_path = STRING_construct(file_path)) == NULL)
+    {
+        LOG_ERROR("Could not allocate store log path");
+        (void)Lock_Deinit(result->lock);
+        free(result);
+        result = NULL;
+    }
+    else if ((result->index = store_index_create()) == NULL)
+    {
+        LOG_ERROR("Could not allocate store log index");
+        STRING_delete(result->file_path);
+        (void)Lock_Deinit(result->lock);
+        free(result);
+        result = NULL;
+    }
+    else if ((result->fd = open_log_file(file_path, false)) < 0)
+    {
+        LOG_ERROR("Could not open store log %s. Errno: %s.", file_path, strerror(errno));
+        store_index_destroy(result->index, NULL);
+        STRING_delete(result->file_path);
+        (void)Lock_Deinit(result->lock);
+        free(result);
+        result = NULL;
+    }
+    else if (load_log(result) != 0)
+    {
+        close_log_file(result->fd);
+        store_index_destroy(result->index, destroy_entry_cb);
+        STRING_delete(result->file_path);
+        (void)Lock_Deinit(result->lock);
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        compact_if_needed(result);
+    }
+
+    return result;
+}
+
+void hsm_store_log_close(HSM_STORE_LOG_HANDLE log)
+{
+    if (log != NULL)
+    {
+        close_log_file(log->fd);
+        store_index_destroy(log->index, destroy_entry_cb);
+        STRING_delete(log->file_path);
+        (void)Lock_Deinit(log->lock);
+        free(log);
+    }
+}
+
+int hsm_store_log_put
+(
+    HSM_STORE_LOG_HANDLE log,
+    const char *key,
+    const unsigned char *value,
+    size_t value_size
+)
+{
+    int result;
+    size_t key_size;
+
+    if ((log == NULL) || (key == NULL) ||
+        ((key_size = strlen(key)) == 0) || (key_size > HSM_STORE_LOG_MAX_KEY_SIZE))
+    {
+        LOG_ERROR("Invalid store log key");
+        result = __FAILURE__;
+    }
+    else if ((value == NULL) || (value_size == 0) || (value_size > HSM_STORE_LOG_MAX_VALUE_SIZE))
+    {
+        LOG_ERROR("Invalid store log value");
+        result = __FAILURE__;
+    }
+    else
+    {
+        unsigned char *record;
+        size_t record_size = 0;
+
+        if ((record = encode_record(HSM_STORE_LOG_RECORD_PUT, key, key_size,
+                                    value, value_size, &record_size)) == NULL)
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            if (lock_log(log) != 0)
+            {
+                result = __FAILURE__;
+            }
+            else
+            {
+                if (append_record(log, record, record_size) != 0)
+                {
+                    result = __FAILURE__;
+                }
+                else if (apply_put(log, key, key_size, value, value_size, record_size) != 0)
+                {
+                    LOG_ERROR("Store log %s updated but could not update index",
+                              STRING_c_str(log->file_path));
+                    result = __FAILURE__;
+                }
+                else
+                {
+                    compact_if_needed(log);
+                    result = 0;
+                }
+                unlock_log(log);
+            }
+            hsm_key_mem_free(record, record_size);
+        }
+    }
+
+    return result;
+}
+
+int hsm_store_log_remove(HSM_STORE_LOG_HANDLE log, const char *key)
+{
+    int result;
+
+    if ((log == NULL) || (key == NULL) || (strlen(key) == 0))
+    {
+        LOG_ERROR("Invalid store log key");
+        result = __FAILURE__;
+    }
+    else if (lock_log(log) != 0)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        unsigned char *record;
+        size_t key_size = strlen(key);
+        size_t record_size = 0;
+
+        if (store_index_find(log->index, key) == NULL)
+        {
+            LOG_DEBUG("Key not found in store log %s", key);
+            result = __FAILURE__;
+        }
+        else if ((record = encode_record(HSM_STORE_LOG_RECORD_REMOVE, key, key_size,
+                                         NULL, 0, &record_size)) == NULL)
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            if ((append_record(log, record, record_size) != 0) ||
+                (apply_remove(log, key, key_size, record_size) != 0))
+            {
+                result = __FAILURE__;
+            }
+            else
+            {
+                compact_if_needed(log);
+                result = 0;
+            }
+            hsm_key_mem_free(record, record_size);
+        }
+        unlock_log(log);
+    }
+
+    return result;
+}
+
+unsigned char* hsm_store_log_get(HSM_STORE_LOG_HANDLE log, const char *key, size_t *value_size)
+{
+    unsigned char *result;
+
+    if (value_size != NULL)
+    {
+        *value_size = 0;
+    }
+
+    if ((log == NULL) || (key == NULL) || (value_size == NULL))
+    {
+        LOG_ERROR("Invalid parameters");
+        result = NULL;
+    }
+    else if (lock_log(log) != 0)
+    {
+        result = NULL;
+    }
+    else
+    {
+        HSM_STORE_LOG_ENTRY *entry = (HSM_STORE_LOG_ENTRY*)store_index_find(log->index, key);
+        if (entry == NULL)
+        {
+            result = NULL;
+        }
+        else if ((result = (unsigned char*)hsm_key_mem_alloc(entry->value_size)) == NULL)
+        {
+            LOG_ERROR("Could not allocate memory for store log value");
+        }
+        else
+        {
+            memcpy(result, entry->value, entry->value_size);
+            *value_size = entry->value_size;
+        }
+        unlock_log(log);
+    }
+
+    return result;
+}
+
+bool hsm_store_log_contains(HSM_STORE_LOG_HANDLE log, const char *key)
+{
+    bool result;
+
+    if ((log == NULL) || (key == NULL))
+    {
+        LOG_ERROR("Invalid parameters");
+        result = false;
+    }
+    else if (lock_log(log) != 0)
+    {
+        result = false;
+    }
+    else
+    {
+        result = (store_index_find(log->index, key) != NULL);
+        unlock_log(log);
+    }
+
+    return result;
+}
+
+int hsm_store_log_compact(HSM_STORE_LOG_HANDLE log)
+{
+    int result;
+
+    if (log == NULL)
+    {
+        LOG_ERROR("Invalid parameters");
+        result = __FAILURE__;
+    }
+    else if (lock_log(log) != 0)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = compact_log(log);
+        unlock_log(log);
+    }
+
+    return result;
+}
+
+size_t hsm_store_log_count(HSM_STORE_LOG_HANDLE log)
+{
+    size_t result = 0;
+
+    if ((log != NULL) && (lock_log(log) == 0))
+    {
+        result = store_index_count(log->index);
+        unlock_log(log);
+    }
+
+    return result;
+}
@@ -0,0 +1,48 @@
+#ifndef HSM_STORE_LOG_H
+#define HSM_STORE_LOG_H
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stdbool.h>
+#include <stddef.h>
+#endif
+
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+/**
+ * Single file, append only key value store.
+ *
+ * Every update is appended to the log as a checksummed record and synced
+ * before it is applied, so an update is either fully persisted or ignored
+ * when the log is replayed. Opening the log maps the file and replays it in
+ * one sequential pass into an in memory index. A torn record at the end of
+ * the log, left behind by a crash during an append, is truncated away.
+ *
+ * Superseded records are dropped by compaction, which rewrites the live
+ * records into a new file that atomically replaces the log. Compaction runs
+ * automatically once superseded records outweigh live ones.
+ *
+ * A log may be used from several threads, each operation holds the lock of
+ * the log. Values are kept in key memory. On POSIX the file is locked while
+ * the log is open, so that no other process truncates it while it is mapped,
+ * and opening a log which is already open fails.
+ */
+typedef struct HSM_STORE_LOG_TAG* HSM_STORE_LOG_HANDLE;
+
+MOCKABLE_FUNCTION(, HSM_STORE_LOG_HANDLE, hsm_store_log_open, const char*, file_path);
+MOCKABLE_FUNCTION(, void, hsm_store_log_close, HSM_STORE_LOG_HANDLE, log);
+MOCKABLE_FUNCTION(, int, hsm_store_log_put, HSM_STORE_LOG_HANDLE, log, const char*, key, const unsigned char*, value, size_t, value_size);
+MOCKABLE_FUNCTION(, int, hsm_store_log_remove, HSM_STORE_LOG_HANDLE, log, const char*, key);
+// returns a copy of the value which the caller releases with hsm_key_mem_free
+MOCKABLE_FUNCTION(, unsigned char*, hsm_store_log_get, HSM_STORE_LOG_HANDLE, log, const char*, key, size_t*, value_size);
+MOCKABLE_FUNCTION(, bool, hsm_store_log_contains, HSM_STORE_LOG_HANDLE, log, const char*, key);
+MOCKABLE_FUNCTION(, int, hsm_store_log_compact, HSM_STORE_LOG_HANDLE, log);
+MOCKABLE_FUNCTION(, size_t, hsm_store_log_count, HSM_STORE_LOG_HANDLE, log);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_STORE_LOG_H
@@ -0,0 +1,101 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "azure_c_shared_utility/macro_utils.h"
+#include "hsm_atomic.h"
+#include "hsm_client_data.h"
+#include "hsm_log.h"
+#include "hsm_trace.h"
+
+#if defined(_MSC_VER)
+    #define HSM_THREAD_LOCAL __declspec(thread)
+#else
+    #define HSM_THREAD_LOCAL __thread
+#endif
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+HSM_ATOMIC_LONG hsm_trace_enabled = 0;
+
+static HSM_TRACE_CALLBACK g_on_begin = NULL;
+static HSM_TRACE_CALLBACK g_on_end = NULL;
+static void *g_trace_context = NULL;
+static HSM_ATOMIC_LONG g_last_span_id = 0;
+static HSM_THREAD_LOCAL uint64_t g_current_span_id = 0;
+
+int hsm_set_trace_callbacks(HSM_TRACE_CALLBACK on_begin, HSM_TRACE_CALLBACK on_end, void* context)
+{
+    int result;
+
+    if ((on_begin == NULL) != (on_end == NULL))
+    {
+        LOG_ERROR("Invalid trace callbacks, both or neither must be set");
+        result = __FAILURE__;
+    }
+    else
+    {
+        // operations check the flag before reading the callbacks
+        hsm_atomic_store(&hsm_trace_enabled, 0);
+        g_on_begin = on_begin;
+        g_on_end = on_end;
+        g_trace_context = context;
+        hsm_atomic_store(&hsm_trace_enabled, (on_begin != NULL) ? 1 : 0);
+        result = 0;
+    }
+
+    return result;
+}
+
+void hsm_trace_begin(HSM_TRACE_SCOPE *scope, uint64_t parent_id, const char *name, const char *target, size_t input_size)
+{
+    HSM_TRACE_CALLBACK on_begin = g_on_begin;
+
+    if (on_begin != NULL)
+    {
+        // wraps around after 2^32 operations where long is 32 bits wide
+        scope->span.id = (uint64_t)(unsigned long)hsm_atomic_inc(&g_last_span_id);
+        scope->span.parent_id = (parent_id != 0) ? parent_id : g_current_span_id;
+        scope->span.name = name;
+        scope->span.target = target;
+        scope->span.input_size = input_size;
+        scope->span.output_size = 0;
+        scope->span.result = 0;
+        scope->on_end = g_on_end;
+        scope->context = g_trace_context;
+        scope->previous_id = g_current_span_id;
+        scope->active = true;
+        g_current_span_id = scope->span.id;
+        on_begin(&scope->span, scope->context);
+    }
+}
+
+void hsm_trace_begin_identity(HSM_TRACE_SCOPE *scope, const char *name, const unsigned char *identity, size_t identity_size, size_t input_size)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    size_t idx;
+
+    for (idx = 0; (identity != NULL) && (idx < identity_size); idx++)
+    {
+        hash = (hash ^ identity[idx]) * FNV_PRIME;
+    }
+    (void)snprintf(scope->target, sizeof(scope->target), "%08lx%08lx",
+                   (unsigned long)(hash >> 32), (unsigned long)(hash & 0xFFFFFFFF));
+    hsm_trace_begin(scope, 0, name, scope->target, input_size);
+}
+
+void hsm_trace_end(HSM_TRACE_SCOPE *scope, size_t output_size, int result)
+{
+    scope->active = false;
+    scope->span.output_size = output_size;
+    scope->span.result = result;
+    g_current_span_id = scope->previous_id;
+    scope->on_end(&scope->span, scope->context);
+}
+
+uint64_t hsm_trace_current_span(void)
+{
+    return g_current_span_id;
+}
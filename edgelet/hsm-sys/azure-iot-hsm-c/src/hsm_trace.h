@@ -0,0 +1,70 @@
+#ifndef HSM_TRACE_H
+#define HSM_TRACE_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C" {
+#else
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+#include "hsm_atomic.h"
+#include "hsm_client_data.h"
+
+// room for the hexadecimal hash of an identity
+#define HSM_TRACE_TARGET_SIZE 17
+
+/**
+ * A traced operation in progress, kept on the stack of the thread doing it.
+ * The callbacks are captured when the operation begins so that its end is
+ * always reported to the callback its beginning was reported to.
+ */
+typedef struct HSM_TRACE_SCOPE_TAG
+{
+    bool active;
+    HSM_TRACE_SPAN span;
+    HSM_TRACE_CALLBACK on_end;
+    void *context;
+    // span of the thread the operation is nested in
+    uint64_t previous_id;
+    char target[HSM_TRACE_TARGET_SIZE];
+} HSM_TRACE_SCOPE;
+
+extern HSM_ATOMIC_LONG hsm_trace_enabled;
+
+/**
+ * The callbacks are only checked for before the call so operations cost a
+ * single load and branch while tracing is off. HSM_TRACE_END must be reached
+ * for every HSM_TRACE_BEGIN on the same thread, in reverse order.
+ */
+#define HSM_TRACE_BEGIN(scope, name, target, input_size) do { (scope)->active = false; if (hsm_atomic_load(&hsm_trace_enabled)) { hsm_trace_begin((scope), 0, (name), (target), (input_size)); } } while (0)
+#define HSM_TRACE_BEGIN_CHILD(scope, parent_id, name, target, input_size) do { (scope)->active = false; if (hsm_atomic_load(&hsm_trace_enabled)) { hsm_trace_begin((scope), (parent_id), (name), (target), (input_size)); } } while (0)
+#define HSM_TRACE_BEGIN_IDENTITY(scope, name, identity, identity_size, input_size) do { (scope)->active = false; if (hsm_atomic_load(&hsm_trace_enabled)) { hsm_trace_begin_identity((scope), (name), (identity), (identity_size), (input_size)); } } while (0)
+#define HSM_TRACE_END(scope, output_size, result) do { if ((scope)->active) { hsm_trace_end((scope), (output_size), (result)); } } while (0)
+
+/**
+ * Operations begun with a parent_id of 0 are nested in the operation in
+ * progress on the calling thread, if any. A parent_id is only given for
+ * operations done on behalf of another thread.
+ */
+extern void hsm_trace_begin(HSM_TRACE_SCOPE *scope, uint64_t parent_id, const char *name, const char *target, size_t input_size);
+
+/**
+ * The identity is reported as a hash so that it is not copied outside the library.
+ */
+extern void hsm_trace_begin_identity(HSM_TRACE_SCOPE *scope, const char *name, const unsigned char *identity, size_t identity_size, size_t input_size);
+extern void hsm_trace_end(HSM_TRACE_SCOPE *scope, size_t output_size, int result);
+
+/**
+ * Returns the operation in progress on the calling thread, 0 if there is none.
+ */
+extern uint64_t hsm_trace_current_span(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //HSM_TRACE_H
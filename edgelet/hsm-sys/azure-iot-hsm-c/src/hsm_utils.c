@@ -1,13 +1,23 @@
+#if defined __linux__ && !defined _GNU_SOURCE
+    // for O_CLOEXEC and fsync with strict C standard flags
+    #define _GNU_SOURCE
+#endif
+
+#include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/crt_abstractions.h"
+#include "hsm_fault.h"
 #include "hsm_log.h"
+#include "hsm_trace.h"
 #include "hsm_utils.h"
 
 #define HSM_UTIL_SUCCESS 0
@@ -25,12 +35,19 @@
     #define HSM_MKDIR(dir_path) _mkdir(dir_path)
 #else
     #include <unistd.h>
+    #include <sys/mman.h>
     #include <sys/types.h>
 
     #ifndef SSIZE_MAX
         #define SSIZE_MAX INT_MAX
     #endif
 
+    #if defined USE_IO_URING
+        #include <linux/io_uring.h>
+        #include <sys/syscall.h>
+        #include <sys/uio.h>
+    #endif
+
     // equivalent to 755
     #define HSM_MKDIR(dir_path) mkdir(dir_path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)
 #endif
@@ -161,170 +178,1114 @@ static int read_file_into_buffer_impl
         *file_size_in_bytes = 0;
     }
 
-    if ((fd = open(file_name, O_RDONLY)) == -1)
-    {
-        LOG_ERROR("Could not open file for reading %s. Errno %d '%s'", file_name, errno, err_to_str());
-        result = HSM_UTIL_ERROR;
-    }
-    else
+    if ((fd = open(file_name, O_RDONLY)) == -1)
+    {
+        LOG_ERROR("Could not open file for reading %s. Errno %d '%s'", file_name, errno, err_to_str());
+        result = HSM_UTIL_ERROR;
+    }
+    else
+    {
+        if (fstat(fd, &stbuf) != 0)
+        {
+            LOG_ERROR("fstat returned error for file %s. Errno %d '%s'", file_name, errno, err_to_str());
+            result = HSM_UTIL_ERROR;
+        }
+        else if (!S_ISREG(stbuf.st_mode))
+        {
+            LOG_ERROR("File %s is not a regular file.", file_name);
+            result = HSM_UTIL_ERROR;
+        }
+        else
+        {
+            file_size = stbuf.st_size;
+            if (file_size < 0)
+            {
+                LOG_ERROR("File size invalid for %s", file_name);
+                result = HSM_UTIL_ERROR;
+            }
+            else if (file_size == 0)
+            {
+                LOG_ERROR("File size found to be zero for %s", file_name);
+                result = HSM_UTIL_EMPTY;
+            }
+            else
+            {
+                if (file_size_in_bytes != NULL)
+                {
+                    *file_size_in_bytes = file_size;
+                }
+                if (output_buffer != NULL)
+                {
+                    ssize_t num_bytes_read;
+                    size_t num_bytes_to_read = (output_buffer_size < (size_t)file_size) ?
+                                                output_buffer_size :
+                                                (size_t)file_size;
+                    if (num_bytes_to_read > SSIZE_MAX)
+                    {
+                        LOG_ERROR("Unsupported file read operation. File too large %s.", file_name);
+                        result = HSM_UTIL_ERROR;
+                    }
+                    else
+                    {
+                        num_bytes_read = read(fd, output_buffer, num_bytes_to_read);
+                        if (num_bytes_read < 0)
+                        {
+                            LOG_ERROR("File read failed for file %s. Errno %d '%s'", file_name, errno, err_to_str());
+                            result = HSM_UTIL_ERROR;
+                        }
+                        else
+                        {
+                            result = HSM_UTIL_SUCCESS;
+                        }
+                    }
+                }
+                else
+                {
+                    result = HSM_UTIL_SUCCESS;
+                }
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    return result;
+}
+
+//##############################################################################
+// Atomic file writes
+//##############################################################################
+/**
+ * Files are written to a temporary file next to the destination which then
+ * replaces the destination with a rename, so a crash leaves either the old or
+ * the new contents in place but never a partially written file. The parent
+ * directory is synced after the rename so that the rename itself survives a
+ * power loss.
+ *
+ * A batch defers syncing until it is committed so that the data of all its
+ * files can be flushed together and each parent directory is synced once.
+ */
+static const char *TEMP_FILE_EXT = ".tmp";
+
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    #define PATH_SEPARATORS "\\/"
+#else
+    #define PATH_SEPARATORS "/"
+#endif
+
+struct HSM_FILE_BATCH_ENTRY_TAG
+{
+    char *file_name;
+    char *temp_file_name;
+    // open until the batch is committed, the data is already synced on Windows
+    int fd;
+};
+typedef struct HSM_FILE_BATCH_ENTRY_TAG HSM_FILE_BATCH_ENTRY;
+
+struct HSM_FILE_BATCH_TAG
+{
+    HSM_FILE_BATCH_ENTRY *entries;
+    size_t count;
+    size_t capacity;
+};
+typedef struct HSM_FILE_BATCH_TAG HSM_FILE_BATCH;
+
+static char* concat_cstrings(const char *prefix, const char *suffix)
+{
+    char *result;
+    size_t prefix_size = strlen(prefix);
+    size_t suffix_size = strlen(suffix);
+
+    if ((result = (char*)malloc(prefix_size + suffix_size + 1)) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for file name");
+    }
+    else
+    {
+        memcpy(result, prefix, prefix_size);
+        memcpy(result + prefix_size, suffix, suffix_size + 1);
+    }
+
+    return result;
+}
+
+static char* get_parent_dir(const char *file_name)
+{
+    char *result;
+    size_t dir_size = strlen(file_name);
+
+    while ((dir_size > 0) && (strchr(PATH_SEPARATORS, file_name[dir_size - 1]) == NULL))
+    {
+        dir_size--;
+    }
+
+    if (dir_size == 0)
+    {
+        result = concat_cstrings(".", "");
+    }
+    else if ((result = (char*)malloc(dir_size + 1)) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for directory name");
+    }
+    else
+    {
+        // keep the separator of a root directory
+        dir_size = (dir_size > 1) ? dir_size - 1 : dir_size;
+        memcpy(result, file_name, dir_size);
+        result[dir_size] = 0;
+    }
+
+    return result;
+}
+
+static int write_temp_file
+(
+    const char *temp_file_name,
+    const void *input_buffer,
+    size_t input_buffer_size,
+    bool make_private,
+    int *fd_out
+)
+{
+    int result;
+#if defined(HSM_FAULT_INJECTION)
+    // an injected fault writes part of the file at most and then fails
+    bool fault = (hsm_fault_file_write(&input_buffer_size) != 0);
+#endif
+
+    *fd_out = -1;
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    (void)make_private;
+    FILE *file_handle;
+    if ((file_handle = fopen(temp_file_name, "wb")) == NULL)
+    {
+        LOG_ERROR("Could not open file for writing %s", temp_file_name);
+        result = HSM_UTIL_ERROR;
+    }
+    else
+    {
+        result = HSM_UTIL_SUCCESS;
+        if ((input_buffer_size != 0) &&
+            ((fwrite(input_buffer, 1, input_buffer_size, file_handle) != input_buffer_size) ||
+             (ferror(file_handle) != 0)))
+        {
+            LOG_ERROR("File write failed for file %s", temp_file_name);
+            result = HSM_UTIL_ERROR;
+        }
+        else if ((fflush(file_handle) != 0) || (_commit(_fileno(file_handle)) != 0))
+        {
+            LOG_ERROR("File sync failed for file %s", temp_file_name);
+            result = HSM_UTIL_ERROR;
+        }
+#if defined(HSM_FAULT_INJECTION)
+        if ((result == HSM_UTIL_SUCCESS) && fault)
+        {
+            LOG_ERROR("Injected write failure for file %s", temp_file_name);
+            result = HSM_UTIL_ERROR;
+        }
+#endif
+        (void)fclose(file_handle);
+    }
+#else
+    // without make_private the file mode is left to the umask as with fopen
+    mode_t mode = make_private ? (S_IRUSR | S_IWUSR) :
+                  (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+    int fd = open(temp_file_name, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, mode);
+    if (fd == -1)
+    {
+        LOG_ERROR("Could not open file for writing %s", temp_file_name);
+        result = HSM_UTIL_ERROR;
+    }
+    else
+    {
+        const unsigned char *ptr = (const unsigned char*)input_buffer;
+        result = HSM_UTIL_SUCCESS;
+        while ((result == HSM_UTIL_SUCCESS) && (input_buffer_size != 0))
+        {
+            ssize_t write_status = write(fd, ptr, input_buffer_size);
+            if (write_status < 0)
+            {
+                if (errno != EINTR)
+                {
+                    LOG_ERROR("File write failed for file %s", temp_file_name);
+                    result = HSM_UTIL_ERROR;
+                }
+            }
+            else
+            {
+                ptr += write_status;
+                input_buffer_size -= (size_t)write_status;
+            }
+        }
+#if defined(HSM_FAULT_INJECTION)
+        if ((result == HSM_UTIL_SUCCESS) && fault)
+        {
+            LOG_ERROR("Injected write failure for file %s", temp_file_name);
+            result = HSM_UTIL_ERROR;
+        }
+#endif
+
+        if (result == HSM_UTIL_SUCCESS)
+        {
+            *fd_out = fd;
+        }
+        else
+        {
+            (void)close(fd);
+        }
+    }
+#endif
+
+    if (result != HSM_UTIL_SUCCESS)
+    {
+        (void)remove(temp_file_name);
+    }
+
+    return result;
+}
+
+static int sync_batch_files(HSM_FILE_BATCH *batch)
+{
+    int result = HSM_UTIL_SUCCESS;
+
+#if !(defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows)
+    size_t idx;
+    // each file is flushed on its own, a filesystem wide flush would also wait
+    // on unrelated writers and cannot report errors for these files reliably
+    for (idx = 0; (idx < batch->count) && (result == HSM_UTIL_SUCCESS); idx++)
+    {
+        if (fsync(batch->entries[idx].fd) != 0)
+        {
+            LOG_ERROR("File sync failed for file %s", batch->entries[idx].temp_file_name);
+            result = HSM_UTIL_ERROR;
+        }
+    }
+#else
+    (void)batch;
+#endif
+
+    return result;
+}
+
+static int sync_dir(const char *dir_path)
+{
+    int result;
+
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    // MoveFileEx with MOVEFILE_WRITE_THROUGH already flushed the rename
+    (void)dir_path;
+    result = HSM_UTIL_SUCCESS;
+#else
+    int fd = open(dir_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        LOG_ERROR("Could not open directory %s. Errno: %s.", dir_path, err_to_str());
+        result = HSM_UTIL_ERROR;
+    }
+    else
+    {
+        if (fsync(fd) != 0)
+        {
+            LOG_ERROR("Directory sync failed for %s. Errno: %s.", dir_path, err_to_str());
+            result = HSM_UTIL_ERROR;
+        }
+        else
+        {
+            result = HSM_UTIL_SUCCESS;
+        }
+        (void)close(fd);
+    }
+#endif
+
+    return result;
+}
+
+static int rename_file(const char *from_file_name, const char *to_file_name)
+{
+    int result;
+
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    if (!MoveFileExA(from_file_name, to_file_name, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        LOG_ERROR("Could not replace file %s. GetLastError=%08x", to_file_name, GetLastError());
+        result = HSM_UTIL_ERROR;
+    }
+#else
+    if (rename(from_file_name, to_file_name) != 0)
+    {
+        LOG_ERROR("Could not replace file %s. Errno: %s.", to_file_name, err_to_str());
+        result = HSM_UTIL_ERROR;
+    }
+#endif
+    else
+    {
+        result = HSM_UTIL_SUCCESS;
+    }
+
+    return result;
+}
+
+static void release_batch_entries(HSM_FILE_BATCH *batch, bool remove_temp_files)
+{
+    size_t idx;
+
+    for (idx = 0; idx < batch->count; idx++)
+    {
+        HSM_FILE_BATCH_ENTRY *entry = &batch->entries[idx];
+#if !(defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows)
+        if (entry->fd != -1)
+        {
+            (void)close(entry->fd);
+        }
+#endif
+        if (remove_temp_files)
+        {
+            (void)remove(entry->temp_file_name);
+        }
+        free(entry->temp_file_name);
+        free(entry->file_name);
+    }
+    batch->count = 0;
+}
+
+static int sync_batch_dirs(const HSM_FILE_BATCH *batch, size_t num_renamed)
+{
+    int result = HSM_UTIL_SUCCESS;
+    size_t idx;
+
+    for (idx = 0; idx < num_renamed; idx++)
+    {
+        size_t prev;
+        char *dir_path;
+        bool dir_synced = false;
+
+        // batches are small so an earlier entry in the same directory is searched for linearly
+        if ((dir_path = get_parent_dir(batch->entries[idx].file_name)) == NULL)
+        {
+            result = HSM_UTIL_ERROR;
+        }
+        else
+        {
+            for (prev = 0; (prev < idx) && !dir_synced; prev++)
+            {
+                char *prev_dir_path = get_parent_dir(batch->entries[prev].file_name);
+                dir_synced = (prev_dir_path != NULL) && (strcmp(prev_dir_path, dir_path) == 0);
+                free(prev_dir_path);
+            }
+            if (!dir_synced && (sync_dir(dir_path) != HSM_UTIL_SUCCESS))
+            {
+                result = HSM_UTIL_ERROR;
+            }
+            free(dir_path);
+        }
+    }
+
+    return result;
+}
+
+static int commit_batch(HSM_FILE_BATCH *batch)
+{
+    int result;
+    size_t num_renamed = 0;
+
+    if ((result = sync_batch_files(batch)) == HSM_UTIL_SUCCESS)
+    {
+        for (num_renamed = 0; num_renamed < batch->count; num_renamed++)
+        {
+            HSM_FILE_BATCH_ENTRY *entry = &batch->entries[num_renamed];
+#if !(defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows)
+            (void)close(entry->fd);
+            entry->fd = -1;
+#endif
+            if (rename_file(entry->temp_file_name, entry->file_name) != HSM_UTIL_SUCCESS)
+            {
+                result = HSM_UTIL_ERROR;
+                break;
+            }
+        }
+
+        // files renamed before a failure are in place and need to be persisted regardless
+        if (sync_batch_dirs(batch, num_renamed) != HSM_UTIL_SUCCESS)
+        {
+            result = HSM_UTIL_ERROR;
+        }
+    }
+
+    release_batch_entries(batch, (result != HSM_UTIL_SUCCESS));
+
+    return result;
+}
+
+static int add_to_batch
+(
+    HSM_FILE_BATCH *batch,
+    const char *file_name,
+    const void *input_buffer,
+    size_t input_buffer_size,
+    bool make_private
+)
+{
+    int result;
+    size_t idx;
+
+    for (idx = 0; idx < batch->count; idx++)
+    {
+        if (strcmp(batch->entries[idx].file_name, file_name) == 0)
+        {
+            break;
+        }
+    }
+
+    if (idx < batch->count)
+    {
+        // a later write to the same file supersedes the pending one
+        HSM_FILE_BATCH_ENTRY *entry = &batch->entries[idx];
+#if !(defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows)
+        (void)close(entry->fd);
+#endif
+        result = write_temp_file(entry->temp_file_name, input_buffer,
+                                 input_buffer_size, make_private, &entry->fd);
+        if (result != HSM_UTIL_SUCCESS)
+        {
+            free(entry->temp_file_name);
+            free(entry->file_name);
+            batch->entries[idx] = batch->entries[--batch->count];
+        }
+    }
+    else
+    {
+        HSM_FILE_BATCH_ENTRY entry;
+
+        if (batch->count == batch->capacity)
+        {
+            size_t capacity = (batch->capacity == 0) ? 4 : 2 * batch->capacity;
+            HSM_FILE_BATCH_ENTRY *entries = (HSM_FILE_BATCH_ENTRY*)realloc(batch->entries,
+                                                capacity * sizeof(HSM_FILE_BATCH_ENTRY));
+            if (entries != NULL)
+            {
+                batch->entries = entries;
+                batch->capacity = capacity;
+            }
+        }
+
+        if (batch->count == batch->capacity)
+        {
+            LOG_ERROR("Could not allocate memory for file batch");
+            result = HSM_UTIL_ERROR;
+        }
+        else if ((entry.file_name = concat_cstrings(file_name, "")) == NULL)
+        {
+            result = HSM_UTIL_ERROR;
+        }
+        else if ((entry.temp_file_name = concat_cstrings(file_name, TEMP_FILE_EXT)) == NULL)
+        {
+            free(entry.file_name);
+            result = HSM_UTIL_ERROR;
+        }
+        else if ((result = write_temp_file(entry.temp_file_name, input_buffer, input_buffer_size,
+                                           make_private, &entry.fd)) != HSM_UTIL_SUCCESS)
+        {
+            free(entry.temp_file_name);
+            free(entry.file_name);
+        }
+        else
+        {
+            batch->entries[batch->count++] = entry;
+        }
+    }
+
+    return result;
+}
+
+static int write_buffer_into_file
+(
+    const char *file_name,
+    const void *input_buffer,
+    size_t input_buffer_size,
+    bool make_private
+)
+{
+    int result;
+    HSM_FILE_BATCH_ENTRY entry;
+    HSM_FILE_BATCH batch = { &entry, 0, 1 };
+
+    if ((result = add_to_batch(&batch, file_name, input_buffer,
+                               input_buffer_size, make_private)) == HSM_UTIL_SUCCESS)
+    {
+        result = commit_batch(&batch);
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Bulk file reads
+//##############################################################################
+/**
+ * Reading a set of files one after the other pays the full storage latency
+ * of every read in turn, which dominates on SD cards and eMMC. The bulk loader
+ * opens all files first and then has the reads of all of them in flight at
+ * once: with io_uring when built with USE_IO_URING and the kernel allows it,
+ * otherwise by asking the kernel to read ahead every file before they are
+ * read in order. A ring is set up once per call and all reads are submitted
+ * to it, so callers pass the whole set of files they need, such as every
+ * certificate and key the store loads, rather than a few files at a time.
+ */
+#define BULK_READ_MAX_IN_FLIGHT 64
+
+struct BULK_READ_FILE_TAG
+{
+    const char *file_name;
+    int fd;
+    unsigned char *data;
+    size_t data_size;
+    bool done;
+};
+typedef struct BULK_READ_FILE_TAG BULK_READ_FILE;
+
+static int deliver_bulk_read_file
+(
+    BULK_READ_FILE *files,
+    size_t index,
+    HSM_FILE_READ_CALLBACK on_file_read,
+    void *context
+)
+{
+    int result;
+    BULK_READ_FILE *file = &files[index];
+
+    file->done = true;
+    if (on_file_read(index, file->data, file->data_size, context) != 0)
+    {
+        LOG_ERROR("Could not process contents of file %s", file->file_name);
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+    free(file->data);
+    file->data = NULL;
+
+    return result;
+}
+
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+static int read_files_in_bulk
+(
+    BULK_READ_FILE *files,
+    size_t num_files,
+    HSM_FILE_READ_CALLBACK on_file_read,
+    void *context
+)
+{
+    int result = 0;
+    size_t idx;
+
+    for (idx = 0; (idx < num_files) && (result == 0); idx++)
+    {
+        if ((files[idx].data = (unsigned char*)read_file_into_buffer(files[idx].file_name,
+                                                                     &files[idx].data_size)) == NULL)
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = deliver_bulk_read_file(files, idx, on_file_read, context);
+        }
+    }
+
+    return result;
+}
+#else
+static int open_bulk_read_file(BULK_READ_FILE *file)
+{
+    int result;
+    struct stat stbuf;
+
+    if ((file->fd = open(file->file_name, O_RDONLY | O_CLOEXEC)) == -1)
+    {
+        LOG_ERROR("Could not open file for reading %s. Errno %d '%s'", file->file_name, errno, err_to_str());
+        result = __FAILURE__;
+    }
+    else if (fstat(file->fd, &stbuf) != 0)
+    {
+        LOG_ERROR("fstat returned error for file %s. Errno %d '%s'", file->file_name, errno, err_to_str());
+        result = __FAILURE__;
+    }
+    else if (!S_ISREG(stbuf.st_mode))
+    {
+        LOG_ERROR("File %s is not a regular file.", file->file_name);
+        result = __FAILURE__;
+    }
+    else if ((stbuf.st_size <= 0) || ((uint64_t)stbuf.st_size > (uint64_t)SSIZE_MAX))
+    {
+        LOG_ERROR("File size invalid for %s", file->file_name);
+        result = __FAILURE__;
+    }
+    else if ((file->data = (unsigned char*)malloc((size_t)stbuf.st_size)) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory to store the contents of the file %s", file->file_name);
+        result = __FAILURE__;
+    }
+    else
+    {
+        file->data_size = (size_t)stbuf.st_size;
+        result = 0;
+    }
+
+    return result;
+}
+
+static int read_bulk_read_file_from(BULK_READ_FILE *file, size_t offset)
+{
+    int result = 0;
+
+    while ((result == 0) && (offset < file->data_size))
+    {
+        ssize_t num_bytes_read = pread(file->fd, file->data + offset,
+                                       file->data_size - offset, (off_t)offset);
+        if (num_bytes_read < 0)
+        {
+            if (errno != EINTR)
+            {
+                LOG_ERROR("File read failed for file %s. Errno %d '%s'", file->file_name, errno, err_to_str());
+                result = __FAILURE__;
+            }
+        }
+        else if (num_bytes_read == 0)
+        {
+            LOG_ERROR("File %s was truncated while being read", file->file_name);
+            result = __FAILURE__;
+        }
+        else
+        {
+            offset += (size_t)num_bytes_read;
+        }
+    }
+
+    return result;
+}
+
+#if defined USE_IO_URING && defined __NR_io_uring_setup && defined __NR_io_uring_enter
+struct BULK_READ_RING_TAG
+{
+    int fd;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+};
+typedef struct BULK_READ_RING_TAG BULK_READ_RING;
+
+static void destroy_bulk_read_ring(BULK_READ_RING *ring)
+{
+    if (ring->sqes != NULL)
+    {
+        (void)munmap(ring->sqes, ring->sqes_size);
+    }
+    if ((ring->cq_ring != NULL) && (ring->cq_ring != ring->sq_ring))
+    {
+        (void)munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring != NULL)
+    {
+        (void)munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    (void)close(ring->fd);
+}
+
+static int create_bulk_read_ring(BULK_READ_RING *ring, unsigned entries)
+{
+    int result;
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(BULK_READ_RING));
+    memset(&params, 0, sizeof(params));
+    if ((ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params)) < 0)
+    {
+        // not built into the kernel or blocked by policy, this is not an error
+        LOG_DEBUG("io_uring is not available. Errno %d '%s'", errno, err_to_str());
+        result = __FAILURE__;
+    }
+    else
+    {
+        ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            if (ring->cq_ring_size > ring->sq_ring_size)
+            {
+                ring->sq_ring_size = ring->cq_ring_size;
+            }
+            ring->cq_ring_size = ring->sq_ring_size;
+        }
+
+        if ((ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  ring->fd, IORING_OFF_SQ_RING)) == MAP_FAILED)
+        {
+            ring->sq_ring = NULL;
+            result = __FAILURE__;
+        }
+        else if ((ring->cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? ring->sq_ring :
+                    mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_CQ_RING)) == MAP_FAILED)
+        {
+            ring->cq_ring = NULL;
+            result = __FAILURE__;
+        }
+        else if ((ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES)) == MAP_FAILED)
+        {
+            ring->sqes = NULL;
+            result = __FAILURE__;
+        }
+        else
+        {
+            unsigned char *sq_ring = (unsigned char*)ring->sq_ring;
+            unsigned char *cq_ring = (unsigned char*)ring->cq_ring;
+            ring->sq_tail = (unsigned*)(sq_ring + params.sq_off.tail);
+            ring->sq_mask = (unsigned*)(sq_ring + params.sq_off.ring_mask);
+            ring->sq_array = (unsigned*)(sq_ring + params.sq_off.array);
+            ring->cq_head = (unsigned*)(cq_ring + params.cq_off.head);
+            ring->cq_tail = (unsigned*)(cq_ring + params.cq_off.tail);
+            ring->cq_mask = (unsigned*)(cq_ring + params.cq_off.ring_mask);
+            ring->cqes = (struct io_uring_cqe*)(cq_ring + params.cq_off.cqes);
+            result = 0;
+        }
+
+        if (result != 0)
+        {
+            LOG_ERROR("Could not map io_uring. Errno %d '%s'", errno, err_to_str());
+            destroy_bulk_read_ring(ring);
+        }
+    }
+
+    return result;
+}
+
+static void queue_bulk_read(BULK_READ_RING *ring, BULK_READ_FILE *file, size_t index, struct iovec *iov)
+{
+    unsigned tail = *ring->sq_tail;
+    unsigned sq_index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[sq_index];
+
+    iov->iov_base = file->data;
+    iov->iov_len = file->data_size;
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    // IORING_OP_READV is the oldest read operation and so the most widely available
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = file->fd;
+    sqe->addr = (uint64_t)(uintptr_t)iov;
+    sqe->len = 1;
+    sqe->off = 0;
+    sqe->user_data = (uint64_t)index;
+    ring->sq_array[sq_index] = sq_index;
+    // the kernel must see the entry before it sees the new tail
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static int read_files_with_ring
+(
+    BULK_READ_RING *ring,
+    BULK_READ_FILE *files,
+    size_t num_files,
+    HSM_FILE_READ_CALLBACK on_file_read,
+    void *context
+)
+{
+    int result = 0;
+    size_t num_queued = 0;
+    size_t num_completed = 0;
+    unsigned to_submit = 0;
+    struct iovec *iovs;
+
+    // one vector per file as a vector must stay valid until its read completes
+    if ((iovs = (struct iovec*)calloc(num_files, sizeof(struct iovec))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory to read %zu files", num_files);
+        result = __FAILURE__;
+    }
+
+    while ((result == 0) && (num_completed < num_files))
+    {
+        long num_submitted;
+        unsigned head;
+        unsigned tail;
+
+        while ((num_queued < num_files) && (num_queued - num_completed < BULK_READ_MAX_IN_FLIGHT))
+        {
+            queue_bulk_read(ring, &files[num_queued], num_queued, &iovs[num_queued]);
+            num_queued++;
+            to_submit++;
+        }
+
+        if ((num_submitted = syscall(__NR_io_uring_enter, ring->fd, to_submit, 1,
+                                     IORING_ENTER_GETEVENTS, NULL, 0)) < 0)
+        {
+            if (errno != EINTR)
+            {
+                LOG_ERROR("io_uring_enter failed. Errno %d '%s'", errno, err_to_str());
+                result = __FAILURE__;
+            }
+            // entries not yet consumed by the kernel are submitted by the next call
+            continue;
+        }
+        to_submit -= (unsigned)num_submitted;
+
+        head = *ring->cq_head;
+        tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while ((head != tail) && (result == 0))
+        {
+            struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+            size_t index = (size_t)cqe->user_data;
+            BULK_READ_FILE *file = &files[index];
+
+            if (cqe->res < 0)
+            {
+                LOG_ERROR("File read failed for file %s. Errno %d", file->file_name, -cqe->res);
+                result = __FAILURE__;
+            }
+            // short reads are rare for regular files, the remainder is read directly
+            else if (read_bulk_read_file_from(file, (size_t)cqe->res) != 0)
+            {
+                result = __FAILURE__;
+            }
+            else
+            {
+                result = deliver_bulk_read_file(files, index, on_file_read, context);
+            }
+            num_completed++;
+            head++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    // buffers of reads still in flight must outlive them
+    while (num_completed + to_submit < num_queued)
+    {
+        unsigned head;
+        unsigned tail;
+
+        if ((syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0) &&
+            (errno != EINTR))
+        {
+            break;
+        }
+        head = *ring->cq_head;
+        tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        num_completed += tail - head;
+        __atomic_store_n(ring->cq_head, tail, __ATOMIC_RELEASE);
+    }
+    free(iovs);
+
+    return result;
+}
+#endif
+
+static int read_files_in_bulk
+(
+    BULK_READ_FILE *files,
+    size_t num_files,
+    HSM_FILE_READ_CALLBACK on_file_read,
+    void *context
+)
+{
+    int result = 0;
+    size_t idx;
+
+    for (idx = 0; (idx < num_files) && (result == 0); idx++)
+    {
+        result = open_bulk_read_file(&files[idx]);
+    }
+
+    if (result == 0)
+    {
+        bool use_fallback = true;
+#if defined USE_IO_URING && defined __NR_io_uring_setup && defined __NR_io_uring_enter
+        BULK_READ_RING ring;
+        unsigned entries = (num_files < BULK_READ_MAX_IN_FLIGHT) ? (unsigned)num_files : BULK_READ_MAX_IN_FLIGHT;
+        if ((num_files > 1) && (create_bulk_read_ring(&ring, entries) == 0))
+        {
+            use_fallback = false;
+            result = read_files_with_ring(&ring, files, num_files, on_file_read, context);
+            destroy_bulk_read_ring(&ring);
+        }
+#endif
+        if (use_fallback)
+        {
+            // queue read ahead of every file so the reads below mostly hit the page cache
+            for (idx = 0; idx < num_files; idx++)
+            {
+                (void)posix_fadvise(files[idx].fd, 0, 0, POSIX_FADV_WILLNEED);
+            }
+            for (idx = 0; (idx < num_files) && (result == 0); idx++)
+            {
+                if ((result = read_bulk_read_file_from(&files[idx], 0)) == 0)
+                {
+                    result = deliver_bulk_read_file(files, idx, on_file_read, context);
+                }
+            }
+        }
+    }
+
+    for (idx = 0; idx < num_files; idx++)
+    {
+        if (files[idx].fd != -1)
+        {
+            (void)close(files[idx].fd);
+        }
+    }
+
+    return result;
+}
+#endif
+
+//##############################################################################
+// Mapped file views
+//##############################################################################
+/**
+ * A view maps the file read only into the address space so that it can be
+ * parsed in place without being copied into a heap buffer first. The mapping
+ * keeps no handle to the file open and the view is not null terminated.
+ *
+ * On POSIX a mapping faults with SIGBUS when its file is truncated while the
+ * view is in use. Only files owned by the effective user and not writable by
+ * anyone else are mapped, which are the files the HSM writes itself, and the
+ * HSM always replaces such files with a rename rather than truncating them.
+ * Windows refuses to truncate a file while a view of it is mapped.
+ */
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+static const void* map_file_view_impl(const char *file_name, size_t *view_size)
+{
+    const void *result = NULL;
+    HANDLE file_handle;
+
+    if (create_file_handle_for_reading(file_name, &file_handle) == 0)
     {
-        if (fstat(fd, &stbuf) != 0)
+        LARGE_INTEGER file_size;
+        HANDLE mapping_handle;
+
+        if (!GetFileSizeEx(file_handle, &file_size))
         {
-            LOG_ERROR("fstat returned error for file %s. Errno %d '%s'", file_name, errno, err_to_str());
-            result = HSM_UTIL_ERROR;
+            LOG_ERROR("Could not get file size for %s. GetLastError=%08x", file_name, GetLastError());
         }
-        else if (!S_ISREG(stbuf.st_mode))
+        else if (file_size.QuadPart == 0)
         {
-            LOG_ERROR("File %s is not a regular file.", file_name);
-            result = HSM_UTIL_ERROR;
+            LOG_ERROR("File size found to be zero for %s", file_name);
+        }
+        else if ((ULONGLONG)file_size.QuadPart > (ULONGLONG)SIZE_MAX)
+        {
+            LOG_ERROR("File size too large, overflow detected for %s", file_name);
+        }
+        else if ((mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL)
+        {
+            LOG_ERROR("Could not create file mapping for %s. GetLastError=%08x", file_name, GetLastError());
         }
         else
         {
-            file_size = stbuf.st_size;
-            if (file_size < 0)
-            {
-                LOG_ERROR("File size invalid for %s", file_name);
-                result = HSM_UTIL_ERROR;
-            }
-            else if (file_size == 0)
+            if ((result = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0)) == NULL)
             {
-                LOG_ERROR("File size found to be zero for %s", file_name);
-                result = HSM_UTIL_EMPTY;
+                LOG_ERROR("Could not map view of file %s. GetLastError=%08x", file_name, GetLastError());
             }
             else
             {
-                if (file_size_in_bytes != NULL)
-                {
-                    *file_size_in_bytes = file_size;
-                }
-                if (output_buffer != NULL)
-                {
-                    ssize_t num_bytes_read;
-                    size_t num_bytes_to_read = (output_buffer_size < (size_t)file_size) ?
-                                                output_buffer_size :
-                                                (size_t)file_size;
-                    if (num_bytes_to_read > SSIZE_MAX)
-                    {
-                        LOG_ERROR("Unsupported file read operation. File too large %s.", file_name);
-                        result = HSM_UTIL_ERROR;
-                    }
-                    else
-                    {
-                        num_bytes_read = read(fd, output_buffer, num_bytes_to_read);
-                        if (num_bytes_read < 0)
-                        {
-                            LOG_ERROR("File read failed for file %s. Errno %d '%s'", file_name, errno, err_to_str());
-                            result = HSM_UTIL_ERROR;
-                        }
-                        else
-                        {
-                            result = HSM_UTIL_SUCCESS;
-                        }
-                    }
-                }
-                else
-                {
-                    result = HSM_UTIL_SUCCESS;
-                }
+                *view_size = (size_t)file_size.QuadPart;
             }
+            // the view keeps the mapping alive
+            CloseHandle(mapping_handle);
         }
-        close(fd);
+        CloseHandle(file_handle);
     }
-#endif
 
     return result;
 }
 
-static bool is_windows()
+static void unmap_file_view_impl(const void *view, size_t view_size)
 {
-    #if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
-        return true;
-    #else
-        return false;
-    #endif
+    (void)view_size;
+    if (!UnmapViewOfFile(view))
+    {
+        LOG_ERROR("Could not unmap file view. GetLastError=%08x", GetLastError());
+    }
 }
-
-static int write_buffer_into_file
-(
-    const char *file_name,
-    const void *input_buffer,
-    size_t input_buffer_size,
-    bool make_private
-)
+#else
+static const void* map_file_view_impl(const char *file_name, size_t *view_size)
 {
-    int result = HSM_UTIL_UNSUPPORTED;
+    const void *result = NULL;
+    int fd;
 
-    if (is_windows() || !make_private)
+    if ((fd = open(file_name, O_RDONLY | O_CLOEXEC)) == -1)
     {
-        FILE *file_handle;
-        if ((file_handle = fopen(file_name, "wb")) == NULL)
+        LOG_ERROR("Could not open file for reading %s. Errno %d '%s'", file_name, errno, err_to_str());
+    }
+    else
+    {
+        struct stat stbuf;
+        void *view;
+
+        if (fstat(fd, &stbuf) != 0)
         {
-            LOG_ERROR("Could not open file for writing %s", file_name);
-            result = HSM_UTIL_ERROR;
+            LOG_ERROR("fstat returned error for file %s. Errno %d '%s'", file_name, errno, err_to_str());
         }
-        else
+        else if (!S_ISREG(stbuf.st_mode))
         {
-            result = HSM_UTIL_SUCCESS;
-            if (input_buffer_size != 0)
-            {
-                size_t num_bytes_written;
-                num_bytes_written = fwrite(input_buffer, 1, input_buffer_size, file_handle);
-                if ((num_bytes_written != input_buffer_size) || (ferror(file_handle) != 0))
-                {
-                    LOG_ERROR("File write failed for file %s", file_name);
-                    result = HSM_UTIL_ERROR;
-                }
-                else
-                {
-                    (void)fflush(file_handle);
-                }
-            }
-            (void)fclose(file_handle);
+            LOG_ERROR("File %s is not a regular file.", file_name);
         }
-    }
-#if !(defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows)
-    else
-    {
-        int fd = open(file_name, O_CREAT|O_WRONLY|O_TRUNC, S_IRUSR|S_IWUSR);
-        if (fd == -1)
+        else if ((stbuf.st_uid != geteuid()) || ((stbuf.st_mode & (S_IWGRP | S_IWOTH)) != 0))
         {
-            LOG_ERROR("Could not open file for writing %s", file_name);
-            result = HSM_UTIL_ERROR;
+            LOG_ERROR("File %s may be modified by another user and is not mapped.", file_name);
+        }
+        else if (stbuf.st_size <= 0)
+        {
+            LOG_ERROR("File size found to be zero for %s", file_name);
+        }
+        else if ((uintmax_t)stbuf.st_size > (uintmax_t)SIZE_MAX)
+        {
+            LOG_ERROR("Unsupported file map operation. File too large %s.", file_name);
+        }
+        else if ((view = mmap(NULL, (size_t)stbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+        {
+            LOG_ERROR("Could not map file %s. Errno %d '%s'", file_name, errno, err_to_str());
         }
         else
         {
-            result = HSM_UTIL_SUCCESS;
-            if (input_buffer_size != 0)
-            {
-                ssize_t write_status = write(fd, input_buffer, input_buffer_size);
-                if ((write_status < 0) || ((size_t)write_status != input_buffer_size))
-                {
-                    LOG_ERROR("File write failed for file %s", file_name);
-                    result = HSM_UTIL_ERROR;
-                }
-                else if (fsync(fd) != 0)
-                {
-                    LOG_ERROR("File sync failed for file %s", file_name);
-                    result = HSM_UTIL_ERROR;
-                }
-            }
-            (void)close(fd);
+            result = view;
+            *view_size = (size_t)stbuf.st_size;
         }
+        // the mapping holds its own reference to the file
+        (void)close(fd);
     }
-#endif
 
-    if (result != HSM_UTIL_SUCCESS)
+    return result;
+}
+
+static void unmap_file_view_impl(const void *view, size_t view_size)
+{
+    if (munmap((void*)view, view_size) != 0)
     {
-        (void)delete_file(file_name);
+        LOG_ERROR("Could not unmap file view. Errno %d '%s'", errno, err_to_str());
     }
-    return result;
 }
+#endif
 
 void* read_file_into_buffer(const char* file_name, size_t *output_buffer_size)
 {
     void* result;
     size_t file_size_in_bytes = 0;
+    HSM_TRACE_SCOPE trace;
 
+    HSM_TRACE_BEGIN(&trace, "file.read", file_name, 0);
     if (output_buffer_size != NULL)
     {
         *output_buffer_size = 0;
@@ -356,6 +1317,7 @@ void* read_file_into_buffer(const char* file_name, size_t *output_buffer_size)
             *output_buffer_size = file_size_in_bytes;
         }
     }
+    HSM_TRACE_END(&trace, (result != NULL) ? file_size_in_bytes : 0, (result != NULL) ? 0 : __FAILURE__);
 
     return result;
 }
@@ -364,7 +1326,9 @@ char* read_file_into_cstring(const char* file_name, size_t *output_buffer_size)
 {
     char* result;
     size_t file_size_in_bytes = 0;
+    HSM_TRACE_SCOPE trace;
 
+    HSM_TRACE_BEGIN(&trace, "file.read", file_name, 0);
     if (output_buffer_size != NULL)
     {
         *output_buffer_size = 0;
@@ -406,9 +1370,46 @@ char* read_file_into_cstring(const char* file_name, size_t *output_buffer_size)
             }
         }
     }
+    HSM_TRACE_END(&trace, (result != NULL) ? file_size_in_bytes : 0, (result != NULL) ? 0 : __FAILURE__);
+
+    return result;
+}
+
+const void* map_file_into_view(const char* file_name, size_t *view_size)
+{
+    const void* result;
+
+    if (view_size != NULL)
+    {
+        *view_size = 0;
+    }
+
+    if ((file_name == NULL) || (strlen(file_name) == 0))
+    {
+        LOG_ERROR("Invalid file name");
+        result = NULL;
+    }
+    else if (view_size == NULL)
+    {
+        LOG_ERROR("Invalid view size parameter");
+        result = NULL;
+    }
+    else
+    {
+        result = map_file_view_impl(file_name, view_size);
+    }
+
     return result;
 }
 
+void unmap_file_view(const void* view, size_t view_size)
+{
+    if (view != NULL)
+    {
+        unmap_file_view_impl(view, view_size);
+    }
+}
+
 char* concat_files_to_cstring(const char **file_names, int num_files)
 {
     char *result;
@@ -468,23 +1469,25 @@ char* concat_files_to_cstring(const char **file_names, int num_files)
                 }
                 else
                 {
-                    bool concat_error = false;
+                    // each file is read straight into its place in the result
+                    size_t offset = 0;
                     memset(result, 0, accumulated_size);
                     index = 0;
-                    while ((index < num_files) && (!concat_error))
+                    while ((index < num_files) && (result != NULL))
                     {
-                        char *temp_result = read_file_into_cstring(file_names[index], NULL);
-                        if (temp_result != NULL)
+                        size_t file_size;
+                        size_t remaining = accumulated_size - 1 - offset;
+                        if (read_file_into_buffer_impl(file_names[index], result + offset,
+                                                       remaining, &file_size) == HSM_UTIL_ERROR)
+                        {
+                            LOG_ERROR("Error observed during concatenation");
+                            free(result);
+                            result = NULL;
+                        }
+                        else
                         {
-                            // todo optimize for inplace concat
-                            if (strcat_s(result, accumulated_size, temp_result) != 0)
-                            {
-                                LOG_ERROR("Error observed during concatenation");
-                                free(result);
-                                result = NULL;
-                                concat_error = true;
-                            }
-                            free(temp_result);
+                            // a file that grew since it was sized is truncated
+                            offset += (file_size < remaining) ? file_size : remaining;
                         }
                         index++;
                     }
@@ -642,6 +1645,144 @@ int make_dir(const char* dir_path)
     return result;
 }
 
+HSM_FILE_BATCH_HANDLE file_batch_create(void)
+{
+    HSM_FILE_BATCH *result;
+
+    if ((result = (HSM_FILE_BATCH*)calloc(1, sizeof(HSM_FILE_BATCH))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory for file batch");
+    }
+
+    return result;
+}
+
+void file_batch_destroy(HSM_FILE_BATCH_HANDLE batch)
+{
+    if (batch != NULL)
+    {
+        // files never committed are discarded
+        release_batch_entries(batch, true);
+        free(batch->entries);
+        free(batch);
+    }
+}
+
+int file_batch_add_buffer
+(
+    HSM_FILE_BATCH_HANDLE batch,
+    const char *file_name,
+    const unsigned char *data,
+    size_t data_size,
+    bool make_private
+)
+{
+    int result;
+
+    if (batch == NULL)
+    {
+        LOG_ERROR("Invalid batch parameter");
+        result = __FAILURE__;
+    }
+    else if ((file_name == NULL) || (strlen(file_name) == 0))
+    {
+        LOG_ERROR("Invalid file name parameter");
+        result = __FAILURE__;
+    }
+    else if ((data == NULL) || (data_size == 0))
+    {
+        LOG_ERROR("Invalid data parameter");
+        result = __FAILURE__;
+    }
+    else if (add_to_batch(batch, file_name, data, data_size, make_private) != HSM_UTIL_SUCCESS)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+int file_batch_commit(HSM_FILE_BATCH_HANDLE batch)
+{
+    int result;
+
+    if (batch == NULL)
+    {
+        LOG_ERROR("Invalid batch parameter");
+        result = __FAILURE__;
+    }
+    else if (commit_batch(batch) != HSM_UTIL_SUCCESS)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+int read_files_into_buffers
+(
+    const char **file_names,
+    size_t num_files,
+    HSM_FILE_READ_CALLBACK on_file_read,
+    void *context
+)
+{
+    int result;
+    size_t idx;
+    BULK_READ_FILE *files;
+
+    if ((file_names == NULL) || (num_files == 0))
+    {
+        LOG_ERROR("Invalid file names parameter");
+        result = __FAILURE__;
+    }
+    else if (on_file_read == NULL)
+    {
+        LOG_ERROR("Invalid callback parameter");
+        result = __FAILURE__;
+    }
+    else if ((files = (BULK_READ_FILE*)calloc(num_files, sizeof(BULK_READ_FILE))) == NULL)
+    {
+        LOG_ERROR("Could not allocate memory to read %zu files", num_files);
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+        for (idx = 0; idx < num_files; idx++)
+        {
+            files[idx].file_name = file_names[idx];
+            files[idx].fd = -1;
+            if ((file_names[idx] == NULL) || (strlen(file_names[idx]) == 0))
+            {
+                LOG_ERROR("Invalid file name at index %zu", idx);
+                result = __FAILURE__;
+            }
+        }
+
+        if ((result == 0) && (read_files_in_bulk(files, num_files, on_file_read, context) != 0))
+        {
+            result = __FAILURE__;
+        }
+
+        for (idx = 0; idx < num_files; idx++)
+        {
+            free(files[idx].data);
+        }
+        free(files);
+    }
+
+    return result;
+}
+
 #if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
 static int hsm_get_env_internal(const char *key, char **buffer)
 {
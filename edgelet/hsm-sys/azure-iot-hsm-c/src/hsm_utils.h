@@ -7,6 +7,10 @@
 MOCKABLE_FUNCTION(, char*, concat_files_to_cstring, const char **, file_names, int, num_files);
 MOCKABLE_FUNCTION(, char*, read_file_into_cstring, const char*, file_name, size_t*, output_buffer_size);
 MOCKABLE_FUNCTION(, void*, read_file_into_buffer, const char*, file_name, size_t*, output_buffer_size);
+// the view is read only, not null terminated and must be released with unmap_file_view,
+// only files owned by the process user and writable by no one else can be mapped
+MOCKABLE_FUNCTION(, const void*, map_file_into_view, const char*, file_name, size_t*, view_size);
+MOCKABLE_FUNCTION(, void, unmap_file_view, const void*, view, size_t, view_size);
 MOCKABLE_FUNCTION(, bool, is_file_valid, const char*, file_name);
 MOCKABLE_FUNCTION(, bool, is_directory_valid, const char*, dir_path);
 MOCKABLE_FUNCTION(, int, write_cstring_to_file, const char*, file_name, const char*, data);
@@ -15,4 +19,29 @@ MOCKABLE_FUNCTION(, int, delete_file, const char*, file_name);
 MOCKABLE_FUNCTION(, int, make_dir, const char*, dir_path);
 MOCKABLE_FUNCTION(, int, hsm_get_env, const char*, key, char**, output);
 
+/**
+ * Reads a set of files with the reads of all of them in flight at once,
+ * invoking the callback with the contents of each file as soon as it has
+ * been read. Files may complete in any order and the contents are only
+ * valid for the duration of the callback. Fails if any file cannot be
+ * read or is empty, or if a callback returns non zero, in which case no
+ * further callbacks are made.
+ */
+typedef int (*HSM_FILE_READ_CALLBACK)(size_t index, const unsigned char *data, size_t data_size, void *context);
+
+MOCKABLE_FUNCTION(, int, read_files_into_buffers, const char**, file_names, size_t, num_files, HSM_FILE_READ_CALLBACK, on_file_read, void*, context);
+
+/**
+ * Files added to a batch are written to temporary files and only replace
+ * their destinations once the batch is committed, which flushes each file
+ * and then each parent directory once. Destroying a batch discards any files
+ * that were not committed.
+ */
+typedef struct HSM_FILE_BATCH_TAG* HSM_FILE_BATCH_HANDLE;
+
+MOCKABLE_FUNCTION(, HSM_FILE_BATCH_HANDLE, file_batch_create);
+MOCKABLE_FUNCTION(, void, file_batch_destroy, HSM_FILE_BATCH_HANDLE, batch);
+MOCKABLE_FUNCTION(, int, file_batch_add_buffer, HSM_FILE_BATCH_HANDLE, batch, const char*, file_name, const unsigned char*, data, size_t, data_size, bool, make_private);
+MOCKABLE_FUNCTION(, int, file_batch_commit, HSM_FILE_BATCH_HANDLE, batch);
+
 #endif  //HSM_UTILS_H
@@ -126,6 +126,13 @@ static const char* EXPECTED_TEST_CERT_CHAIN_NIX_EOL =
 "MIIFuzCCA6OgAwIBAgICA+gwDQYJKoZIhvcNAQELBQAwgZUxCzAJBgNVBAYTAlVTMRcwFQYDVQQDDA5FZGdlIERldmljZSBDQTEQMA4GA1UEBwwHUmVkbW9uZDEiMCAGA1UECgwZRGVmYXVsdCBFZGdlIE9yZ2FuaXphdGlvbjETMBEGA1UECAwKV2FzaGluZ3RvbjEiMCAGA1UECwwZRGVmYXVsdCBFZGdlIE9yZ2FuaXphdGlvbjAeFw0xODA0MjQwMzU1NTdaFw0xOTA0MjQwMzU1NTdaMIGVMQswCQYDVQQGEwJVUzEXMBUGA1UEAwwORWRnZSBEZXZpY2UgQ0ExEDAOBgNVBAcMB1JlZG1vbmQxIjAgBgNVBAoMGURlZmF1bHQgRWRnZSBPcmdhbml6YXRpb24xEzARBgNVBAgMCldhc2hpbmd0b24xIjAgBgNVBAsMGURlZmF1bHQgRWRnZSBPcmdhbml6YXRpb24wggIiMA0GCSqGSIb3DQEBAQUAA4ICDwAwggIKAoICAQCxqFOTRC1in4Kjhgba62GYYTZnDLsFk/Y9YqyhHr0+VMLEyZrwLRMyKS5V2nmt7lFMZsMDuoU+uISo+i+Wvx8aNjyalF8vQfVwQtRfFbSAVEzmEZMfff80SMdo31uN9KcmjTqrn1ULLHBEhmiOgW+V+gizAkcmCpCHWEv1MexlQ2t5RSM0BF2AIwA4I3DyT0OuVyAtC3UUxPDQb5KqUChBGexej/Y1JxcLDo7evxEH5eZtepXeVIO/yzn2a7PaplxEh2vStLsZVUuso1e8bghjREVp4OzHmce2Fss46XFTlah7gCTlCe7f03OVQOBS7IOxrPnm1xizmI4aNECa+HqkPoM83/fLUzjAYi3DFzwY+Y8kzt5tIq1jt5oXSAu+W/K3t1w9EMDn0BcKjvEMoJKiX2ZAD/PhLT+0GgGzyYenqwXLv9a0oh245rv/dD3Q+uL5sSuS9U+UF4j8NYVqXxRmU340/WQdfDyrL/IiRDrp+oelm3ddKX6qQ9ZqrlK31H1FAJrJH/6mf0auOdkumAHoGwL+vIzaezW52CuQDtNmRi3IoDoObdzSfW0aTeKoljr9/fq3jri7BI5GwWAhDBM+tiYPaMCaSxBI547SAFlla1xScI22a04L5ec3KHZleb6Rsfvd1ybWlSOjXOGqHcnGz9uUCwM/cYHcLQpnsroHxQIDAQABoxMwETAPBgNVHRMBAf8EBTADAQH/MA0GCSqGSIb3DQEBCwUAA4ICAQBkNRKg/xeJ2/n/KckHxCXv9QsPnnEFQu0Z2w2nw5GPi0Y9cSQHgwL1EwPvAsjQ7WBbe2e44DkwssbGnLO4kE0CkLgbTVbBPybrWeOcl3Ei173CBSwPOQxJZ14voquSFxglaYoVABaLpmsME4ZYn9W1occhoLKaZ7jGZAbLo/ZsigO1u/mSf6ZgaBSd1GdBeTfzLxu1IdnorYlKWudi9pQ/6TW/yT+mNq3iuMWNeqUJps2sgWkaaaqzvHx4dAOb6rzBC/4vuxIc2X2z6NgSjdddr1V3yCyjpX54TgM/q/00BhSaRluqQAn/QHqIrDbeExUbGSFfb9Ma1aiUMNuxgYGiF/v72P7Nq+WhOLa9mucoO293abq0SOAup4RdqOj9QnyJ91s1Lwe07bn3huF1ScYkOAQxmzA3rS8JZ2z6snJigI/Kb70Ba2rVdFjVDRuNEC5xhK6hFkLsk+quPKubNpHOQLSkXHf7sVGFT714j0JSoBa8OKMY3HErWGP1qBdp8HtfV1rtrYzesWvfPj4sAqLpvgq9cd2GXhoDlxKjZam9RkbdkdIVi59125y/qhqMpQF5uRKyDFx6GWkY+MgOMk0BbvUSVjH9bSdZZzupUvYpRodI92fYZWnlKNavPxi0bbJ/WcFDb/rbn83UtaFt3xnejuutm6RjKPSbQGLceR7O4A==\n"
 "-----END CERTIFICATE-----\n";
 
+static const size_t TEST_RSA_CERT_DER_LEN = 680;
+static const unsigned char TEST_RSA_CERT_THUMBPRINT[] =
+{
+    0x03, 0xBB, 0x40, 0x1A, 0xB0, 0x09, 0x8F, 0xAA, 0xAC, 0x50, 0x5D, 0xBD, 0xBB, 0xF2, 0xA3, 0xAD,
+    0xE8, 0xAB, 0x96, 0xB7, 0xF6, 0x53, 0x5C, 0x0C, 0xDD, 0x3E, 0x08, 0xB6, 0x81, 0xBA, 0x21, 0xCB
+};
+
 static const unsigned char TEST_PRIVATE_KEY[] = { 0x32, 0x03, 0x33, 0x34, 0x35, 0x36 };
 static size_t TEST_PRIVATE_KEY_LEN = sizeof(TEST_PRIVATE_KEY)/sizeof(TEST_PRIVATE_KEY[0]);
 
@@ -235,7 +242,6 @@ BEGIN_TEST_SUITE(certificate_info_ut)
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG));
         // allocator for the first certificate which includes /r/n ending
         STRICT_EXPECTED_CALL(gballoc_malloc(cert_len));
         // allocator for the private key
@@ -505,6 +511,73 @@ BEGIN_TEST_SUITE(certificate_info_ut)
         certificate_info_destroy(cert_handle);
     }
 
+    TEST_FUNCTION(certificate_info_create_from_buffer_cert_NULL_fail)
+    {
+        //arrange
+
+        //act
+        CERT_INFO_HANDLE cert_handle = certificate_info_create_from_buffer(NULL, 10, TEST_PRIVATE_KEY, TEST_PRIVATE_KEY_LEN, PRIVATE_KEY_PAYLOAD);
+
+        //assert
+        ASSERT_IS_NULL(cert_handle);
+
+        //cleanup
+        certificate_info_destroy(cert_handle);
+    }
+
+    TEST_FUNCTION(certificate_info_create_from_buffer_cert_empty_fail)
+    {
+        //arrange
+
+        //act
+        CERT_INFO_HANDLE cert_handle_1 = certificate_info_create_from_buffer(TEST_RSA_CERT_NIX_EOL, 0, TEST_PRIVATE_KEY, TEST_PRIVATE_KEY_LEN, PRIVATE_KEY_PAYLOAD);
+        CERT_INFO_HANDLE cert_handle_2 = certificate_info_create_from_buffer("\0ABCD", 5, TEST_PRIVATE_KEY, TEST_PRIVATE_KEY_LEN, PRIVATE_KEY_PAYLOAD);
+
+        //assert
+        ASSERT_IS_NULL(cert_handle_1);
+        ASSERT_IS_NULL(cert_handle_2);
+
+        //cleanup
+        certificate_info_destroy(cert_handle_1);
+        certificate_info_destroy(cert_handle_2);
+    }
+
+    TEST_FUNCTION(certificate_info_create_from_buffer_without_null_terminator_succeed)
+    {
+        //arrange
+        size_t cert_len = strlen(TEST_RSA_CERT_NIX_EOL);
+        setup_parse_cert(cert_len + 1);
+
+        //act
+        CERT_INFO_HANDLE cert_handle = certificate_info_create_from_buffer(TEST_RSA_CERT_NIX_EOL, cert_len, TEST_PRIVATE_KEY, TEST_PRIVATE_KEY_LEN, PRIVATE_KEY_PAYLOAD);
+
+        //assert
+        ASSERT_IS_NOT_NULL(cert_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(char_ptr, TEST_RSA_CERT_NIX_EOL, certificate_info_get_certificate(cert_handle));
+
+        //cleanup
+        certificate_info_destroy(cert_handle);
+    }
+
+    TEST_FUNCTION(certificate_info_create_from_buffer_stops_at_null_terminator_succeed)
+    {
+        //arrange
+        size_t cert_len = strlen(TEST_ECC_CERT_WIN_EOL);
+        setup_parse_cert(cert_len + 1);
+
+        //act
+        CERT_INFO_HANDLE cert_handle = certificate_info_create_from_buffer(TEST_ECC_CERT_WIN_EOL, cert_len + 1, TEST_PRIVATE_KEY, TEST_PRIVATE_KEY_LEN, PRIVATE_KEY_PAYLOAD);
+
+        //assert
+        ASSERT_IS_NOT_NULL(cert_handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(char_ptr, TEST_ECC_CERT_WIN_EOL, certificate_info_get_certificate(cert_handle));
+
+        //cleanup
+        certificate_info_destroy(cert_handle);
+    }
+
     TEST_FUNCTION(certificate_info_create_invalid_cert_win_succeed)
     {
         //arrange
@@ -543,7 +616,7 @@ BEGIN_TEST_SUITE(certificate_info_ut)
 
         umock_c_negative_tests_snapshot();
 
-        size_t calls_cannot_fail[] = { 6, 7, 8, 9, 10 };
+        size_t calls_cannot_fail[] = { 6, 7, 8, 9 };
 
         //act
         size_t count = umock_c_negative_tests_call_count();
@@ -575,6 +648,7 @@ BEGIN_TEST_SUITE(certificate_info_ut)
         //arrange
         CERT_INFO_HANDLE cert_handle = certificate_info_create(TEST_RSA_CERT_WIN_EOL, TEST_PRIVATE_KEY, TEST_PRIVATE_KEY_LEN, PRIVATE_KEY_PAYLOAD);
         umock_c_reset_all_calls();
+        STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
@@ -594,6 +668,7 @@ BEGIN_TEST_SUITE(certificate_info_ut)
         //arrange
         CERT_INFO_HANDLE cert_handle = certificate_info_create(TEST_RSA_CERT_WIN_EOL, NULL, 0, PRIVATE_KEY_UNKNOWN);
         umock_c_reset_all_calls();
+        STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
@@ -729,6 +804,116 @@ BEGIN_TEST_SUITE(certificate_info_ut)
         certificate_info_destroy(cert_handle);
     }
 
+    TEST_FUNCTION(certificate_info_get_der_succeed)
+    {
+        //arrange
+        size_t der_len = 0;
+        CERT_INFO_HANDLE cert_handle = certificate_info_create(TEST_RSA_CERT_WIN_EOL, TEST_PRIVATE_KEY, TEST_PRIVATE_KEY_LEN, PRIVATE_KEY_PAYLOAD);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG));
+
+        //act
+        const unsigned char* der = certificate_info_get_der(cert_handle, &der_len);
+
+        //assert
+        ASSERT_IS_NOT_NULL(der);
+        ASSERT_ARE_EQUAL(size_t, TEST_RSA_CERT_DER_LEN, der_len);
+        ASSERT_ARE_EQUAL(int, 0x30, der[0]);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        certificate_info_destroy(cert_handle);
+    }
+
+    TEST_FUNCTION(certificate_info_get_der_handle_NULL_fail)
+    {
+        //arrange
+        size_t der_len = 123;
+
+        //act
+        const unsigned char* der = certificate_info_get_der(NULL, &der_len);
+
+        //assert
+        ASSERT_IS_NULL(der);
+        ASSERT_ARE_EQUAL(size_t, 123, der_len);
+
+        //cleanup
+    }
+
+    TEST_FUNCTION(certificate_info_get_der_length_NULL_fail)
+    {
+        //arrange
+        CERT_INFO_HANDLE cert_handle = certificate_info_create(TEST_RSA_CERT_WIN_EOL, TEST_PRIVATE_KEY, TEST_PRIVATE_KEY_LEN, PRIVATE_KEY_PAYLOAD);
+        umock_c_reset_all_calls();
+
+        //act
+        const unsigned char* der = certificate_info_get_der(cert_handle, NULL);
+
+        //assert
+        ASSERT_IS_NULL(der);
+
+        //cleanup
+        certificate_info_destroy(cert_handle);
+    }
+
+    TEST_FUNCTION(certificate_info_get_thumbprint_sha256_succeed)
+    {
+        //arrange
+        size_t thumbprint_len = 0;
+        CERT_INFO_HANDLE cert_handle = certificate_info_create(TEST_RSA_CERT_WIN_EOL, TEST_PRIVATE_KEY, TEST_PRIVATE_KEY_LEN, PRIVATE_KEY_PAYLOAD);
+        umock_c_reset_all_calls();
+
+        //act
+        const unsigned char* thumbprint = certificate_info_get_thumbprint_sha256(cert_handle, &thumbprint_len);
+
+        //assert
+        ASSERT_IS_NOT_NULL(thumbprint);
+        ASSERT_ARE_EQUAL(size_t, sizeof(TEST_RSA_CERT_THUMBPRINT), thumbprint_len);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(thumbprint, TEST_RSA_CERT_THUMBPRINT, sizeof(TEST_RSA_CERT_THUMBPRINT)));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        //cleanup
+        certificate_info_destroy(cert_handle);
+    }
+
+    TEST_FUNCTION(certificate_info_get_thumbprint_sha256_nix_matches_win_succeed)
+    {
+        //arrange
+        size_t win_len = 0, nix_len = 0;
+        CERT_INFO_HANDLE win_handle = certificate_info_create(TEST_RSA_CERT_WIN_EOL, NULL, 0, PRIVATE_KEY_UNKNOWN);
+        CERT_INFO_HANDLE nix_handle = certificate_info_create(TEST_RSA_CERT_NIX_EOL, NULL, 0, PRIVATE_KEY_UNKNOWN);
+        umock_c_reset_all_calls();
+
+        //act
+        const unsigned char* win_thumbprint = certificate_info_get_thumbprint_sha256(win_handle, &win_len);
+        const unsigned char* nix_thumbprint = certificate_info_get_thumbprint_sha256(nix_handle, &nix_len);
+
+        //assert
+        ASSERT_ARE_EQUAL(size_t, win_len, nix_len);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(win_thumbprint, nix_thumbprint, win_len));
+
+        //cleanup
+        certificate_info_destroy(win_handle);
+        certificate_info_destroy(nix_handle);
+    }
+
+    TEST_FUNCTION(certificate_info_get_thumbprint_sha256_handle_NULL_fail)
+    {
+        //arrange
+        size_t thumbprint_len = 123;
+
+        //act
+        const unsigned char* thumbprint = certificate_info_get_thumbprint_sha256(NULL, &thumbprint_len);
+
+        //assert
+        ASSERT_IS_NULL(thumbprint);
+        ASSERT_ARE_EQUAL(size_t, 123, thumbprint_len);
+
+        //cleanup
+    }
+
     TEST_FUNCTION(certificate_info_get_valid_from_success)
     {
         //arrange
@@ -899,6 +1084,111 @@ BEGIN_TEST_SUITE(certificate_info_ut)
         //cleanup
     }
 
+    TEST_FUNCTION(certificate_info_append_from_buffer_success)
+    {
+        //arrange
+        size_t der_len;
+        size_t expected_der_len;
+        size_t thumbprint_len;
+        size_t expected_len = strlen(TEST_RSA_CERT_NIX_EOL) + strlen(TEST_ECC_CERT_NIX_EOL);
+        CERT_INFO_HANDLE cert_handle = certificate_info_create(TEST_RSA_CERT_NIX_EOL, NULL, 0, PRIVATE_KEY_UNKNOWN);
+        umock_c_reset_all_calls();
+
+        //act
+        CERT_INFO_HANDLE bundle_handle = certificate_info_append_from_buffer(cert_handle, TEST_ECC_CERT_NIX_EOL, strlen(TEST_ECC_CERT_NIX_EOL));
+
+        //assert
+        ASSERT_IS_NOT_NULL(bundle_handle);
+        const char* certificate = certificate_info_get_certificate(bundle_handle);
+        ASSERT_ARE_EQUAL(size_t, expected_len, strlen(certificate));
+        ASSERT_ARE_EQUAL(int, 0, strncmp(certificate, TEST_RSA_CERT_NIX_EOL, strlen(TEST_RSA_CERT_NIX_EOL)));
+        ASSERT_ARE_EQUAL(char_ptr, TEST_ECC_CERT_NIX_EOL, certificate + strlen(TEST_RSA_CERT_NIX_EOL));
+        ASSERT_ARE_EQUAL(char_ptr, TEST_RSA_CERT_NIX_EOL, certificate_info_get_leaf_certificate(bundle_handle));
+        ASSERT_ARE_EQUAL(char_ptr, TEST_ECC_CERT_NIX_EOL, certificate_info_get_chain(bundle_handle));
+        ASSERT_ARE_EQUAL(int64_t, RSA_CERT_VALID_FROM_TIME, certificate_info_get_valid_from(bundle_handle));
+        ASSERT_ARE_EQUAL(int64_t, RSA_CERT_VALID_TO_TIME, certificate_info_get_valid_to(bundle_handle));
+        const unsigned char* der = certificate_info_get_der(bundle_handle, &der_len);
+        const unsigned char* expected_der = certificate_info_get_der(cert_handle, &expected_der_len);
+        ASSERT_ARE_EQUAL(size_t, expected_der_len, der_len);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(expected_der, der, der_len));
+        const unsigned char* thumbprint = certificate_info_get_thumbprint_sha256(bundle_handle, &thumbprint_len);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(TEST_RSA_CERT_THUMBPRINT, thumbprint, thumbprint_len));
+        ASSERT_ARE_EQUAL(char_ptr, TEST_RSA_CERT_NIX_EOL, certificate_info_get_certificate(cert_handle));
+        ASSERT_IS_NULL(certificate_info_get_chain(cert_handle));
+
+        //cleanup
+        certificate_info_destroy(bundle_handle);
+        certificate_info_destroy(cert_handle);
+    }
+
+    TEST_FUNCTION(certificate_info_append_from_buffer_to_chain_success)
+    {
+        //arrange
+        CERT_INFO_HANDLE cert_handle = certificate_info_create(TEST_CERT_CHAIN_WIN_EOL, NULL, 0, PRIVATE_KEY_UNKNOWN);
+        CERT_INFO_HANDLE bundle_handle = certificate_info_append_from_buffer(cert_handle, TEST_RSA_CERT_WIN_EOL, strlen(TEST_RSA_CERT_WIN_EOL));
+        size_t expected_len = strlen(EXPECTED_TEST_CERT_CHAIN_WIN_EOL) + strlen(TEST_RSA_CERT_WIN_EOL);
+        umock_c_reset_all_calls();
+
+        //act
+        const char* cert_chain = certificate_info_get_chain(bundle_handle);
+
+        //assert
+        ASSERT_IS_NOT_NULL(cert_chain);
+        ASSERT_ARE_EQUAL(size_t, expected_len, strlen(cert_chain));
+        ASSERT_ARE_EQUAL(int, 0, strncmp(cert_chain, EXPECTED_TEST_CERT_CHAIN_WIN_EOL, strlen(EXPECTED_TEST_CERT_CHAIN_WIN_EOL)));
+        ASSERT_ARE_EQUAL(char_ptr, certificate_info_get_leaf_certificate(cert_handle), certificate_info_get_leaf_certificate(bundle_handle));
+
+        //cleanup
+        certificate_info_destroy(bundle_handle);
+        certificate_info_destroy(cert_handle);
+    }
+
+    TEST_FUNCTION(certificate_info_append_from_buffer_invalid_cert_fail)
+    {
+        //arrange
+        CERT_INFO_HANDLE cert_handle = certificate_info_create(TEST_RSA_CERT_NIX_EOL, NULL, 0, PRIVATE_KEY_UNKNOWN);
+        umock_c_reset_all_calls();
+
+        //act
+        CERT_INFO_HANDLE bundle_handle = certificate_info_append_from_buffer(cert_handle, TEST_INVALID_CERT_NIX_EOL, strlen(TEST_INVALID_CERT_NIX_EOL));
+
+        //assert
+        ASSERT_IS_NULL(bundle_handle);
+        ASSERT_ARE_EQUAL(char_ptr, TEST_RSA_CERT_NIX_EOL, certificate_info_get_certificate(cert_handle));
+
+        //cleanup
+        certificate_info_destroy(cert_handle);
+    }
+
+    TEST_FUNCTION(certificate_info_append_from_buffer_with_private_key_fail)
+    {
+        //arrange
+        CERT_INFO_HANDLE cert_handle = certificate_info_create(TEST_RSA_CERT_NIX_EOL, TEST_PRIVATE_KEY, TEST_PRIVATE_KEY_LEN, PRIVATE_KEY_PAYLOAD);
+        umock_c_reset_all_calls();
+
+        //act
+        CERT_INFO_HANDLE bundle_handle = certificate_info_append_from_buffer(cert_handle, TEST_ECC_CERT_NIX_EOL, strlen(TEST_ECC_CERT_NIX_EOL));
+
+        //assert
+        ASSERT_IS_NULL(bundle_handle);
+
+        //cleanup
+        certificate_info_destroy(cert_handle);
+    }
+
+    TEST_FUNCTION(certificate_info_append_from_buffer_handle_NULL_fail)
+    {
+        //arrange
+
+        //act
+        CERT_INFO_HANDLE bundle_handle = certificate_info_append_from_buffer(NULL, TEST_ECC_CERT_NIX_EOL, strlen(TEST_ECC_CERT_NIX_EOL));
+
+        //assert
+        ASSERT_IS_NULL(bundle_handle);
+
+        //cleanup
+    }
+
     TEST_FUNCTION(get_utc_time_from_asn_string_invalid_smaller_len_test)
     {
         //arrange
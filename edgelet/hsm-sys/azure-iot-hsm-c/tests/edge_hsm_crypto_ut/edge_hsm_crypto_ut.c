@@ -40,6 +40,7 @@ static void test_hook_gballoc_free(void* ptr)
 
 #define ENABLE_MOCKS
 #include "hsm_client_store.h"
+#include "hsm_random.h"
 #include "azure_c_shared_utility/gballoc.h"
 
 // store mocks
@@ -359,6 +360,12 @@ static void test_hook_hsm_client_key_destroy(KEY_HANDLE key_handle)
     ASSERT_FAIL("API not expected to be called");
 }
 
+static int test_hook_hsm_random_bytes(unsigned char *buffer, size_t num_bytes)
+{
+    memset(buffer, 0xA5, num_bytes);
+    return 0;
+}
+
 static const char* test_hook_get_alias(CERT_PROPS_HANDLE handle)
 {
     (void)handle;
@@ -491,6 +498,9 @@ BEGIN_TEST_SUITE(edge_hsm_crypto_unittests)
             REGISTER_GLOBAL_MOCK_HOOK(certificate_info_create, test_hook_certificate_info_create);
             REGISTER_GLOBAL_MOCK_FAIL_RETURN(certificate_info_create, NULL);
 
+            REGISTER_GLOBAL_MOCK_HOOK(hsm_random_bytes, test_hook_hsm_random_bytes);
+            REGISTER_GLOBAL_MOCK_FAIL_RETURN(hsm_random_bytes, 1);
+
             REGISTER_GLOBAL_MOCK_HOOK(get_alias, test_hook_get_alias);
             REGISTER_GLOBAL_MOCK_FAIL_RETURN(get_alias, NULL);
 
@@ -915,6 +925,8 @@ BEGIN_TEST_SUITE(edge_hsm_crypto_unittests)
             unsigned char test_output[] = {'r', 'a', 'n' , 'd'};
             umock_c_reset_all_calls();
 
+            STRICT_EXPECTED_CALL(hsm_random_bytes(test_output, sizeof(test_output)));
+
             // act
             status = interface->hsm_client_get_random_bytes(hsm_handle, test_output, sizeof(test_output));
 
@@ -935,6 +947,37 @@ BEGIN_TEST_SUITE(edge_hsm_crypto_unittests)
             hsm_client_crypto_deinit();
         }
 
+        /**
+         * Test function for API
+         *   hsm_client_get_random_bytes
+        */
+        TEST_FUNCTION(edge_hsm_client_get_random_bytes_fails_when_generator_fails)
+        {
+            //arrange
+            int status;
+            status = hsm_client_crypto_init();
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            const HSM_CLIENT_CRYPTO_INTERFACE* interface = hsm_client_crypto_interface();
+            HSM_CLIENT_CREATE hsm_client_crypto_create = interface->hsm_client_crypto_create;
+            HSM_CLIENT_DESTROY hsm_client_crypto_destroy = interface->hsm_client_crypto_destroy;
+            HSM_CLIENT_HANDLE hsm_handle = hsm_client_crypto_create();
+            unsigned char test_output[] = {'r', 'a', 'n' , 'd'};
+            umock_c_reset_all_calls();
+
+            STRICT_EXPECTED_CALL(hsm_random_bytes(test_output, sizeof(test_output))).SetReturn(1);
+
+            // act
+            status = interface->hsm_client_get_random_bytes(hsm_handle, test_output, sizeof(test_output));
+
+            // assert
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+            //cleanup
+            hsm_client_crypto_destroy(hsm_handle);
+            hsm_client_crypto_deinit();
+        }
+
         /**
          * Test function for API
          *   hsm_client_create_master_encryption_key
@@ -29,6 +29,17 @@ static void test_hook_gballoc_free(void* ptr)
     free(ptr);
 }
 
+static void* test_hook_hsm_key_mem_alloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void test_hook_hsm_key_mem_free(void* ptr, size_t size)
+{
+    (void)size;
+    free(ptr);
+}
+
 #include "testrunnerswitcher.h"
 #include "umock_c.h"
 #include "umock_c_negative_tests.h"
@@ -43,6 +54,7 @@ static void test_hook_gballoc_free(void* ptr)
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/buffer_.h"
 #include "azure_c_shared_utility/hmacsha256.h"
+#include "hsm_key_mem.h"
 
 #undef ENABLE_MOCKS
 
@@ -179,6 +191,11 @@ BEGIN_TEST_SUITE(edge_hsm_key_interface_sas_key_unittests)
 
             REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, test_hook_gballoc_free);
 
+            REGISTER_GLOBAL_MOCK_HOOK(hsm_key_mem_alloc, test_hook_hsm_key_mem_alloc);
+            REGISTER_GLOBAL_MOCK_FAIL_RETURN(hsm_key_mem_alloc, NULL);
+
+            REGISTER_GLOBAL_MOCK_HOOK(hsm_key_mem_free, test_hook_hsm_key_mem_free);
+
             REGISTER_GLOBAL_MOCK_HOOK(BUFFER_length, test_hook_BUFFER_length);
             REGISTER_GLOBAL_MOCK_FAIL_RETURN(BUFFER_length, 0);
 
@@ -233,8 +250,8 @@ BEGIN_TEST_SUITE(edge_hsm_key_interface_sas_key_unittests)
         TEST_FUNCTION(hsm_client_key_interface_create_success)
         {
             // arrange
-            EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
-            STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(TEST_KEY_DATA)));
+            EXPECTED_CALL(hsm_key_mem_alloc(IGNORED_NUM_ARG));
+            STRICT_EXPECTED_CALL(hsm_key_mem_alloc(sizeof(TEST_KEY_DATA)));
 
             // act
             KEY_HANDLE key_handle = create_sas_key(TEST_KEY_DATA, sizeof(TEST_KEY_DATA));
@@ -253,8 +270,8 @@ BEGIN_TEST_SUITE(edge_hsm_key_interface_sas_key_unittests)
             int test_result = umock_c_negative_tests_init();
             ASSERT_ARE_EQUAL(int, 0, test_result);
 
-            EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
-            STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(TEST_KEY_DATA)));
+            EXPECTED_CALL(hsm_key_mem_alloc(IGNORED_NUM_ARG));
+            STRICT_EXPECTED_CALL(hsm_key_mem_alloc(sizeof(TEST_KEY_DATA)));
             umock_c_negative_tests_snapshot();
 
             for (size_t i = 0; i < umock_c_negative_tests_call_count(); i++)
@@ -309,8 +326,8 @@ BEGIN_TEST_SUITE(edge_hsm_key_interface_sas_key_unittests)
             KEY_HANDLE key_handle = test_helper_create_key(TEST_KEY_DATA, sizeof(TEST_KEY_DATA));
             umock_c_reset_all_calls();
 
-            EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
-            EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+            STRICT_EXPECTED_CALL(hsm_key_mem_free(IGNORED_PTR_ARG, sizeof(TEST_KEY_DATA)));
+            EXPECTED_CALL(hsm_key_mem_free(key_handle, IGNORED_NUM_ARG));
 
             // act
             key_if->hsm_client_key_destroy(key_handle);
@@ -386,6 +403,7 @@ BEGIN_TEST_SUITE(edge_hsm_key_interface_sas_key_unittests)
             STRICT_EXPECTED_CALL(BUFFER_length(TEST_BUFFER_HANDLE));
             STRICT_EXPECTED_CALL(BUFFER_u_char(TEST_BUFFER_HANDLE));
             STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(TEST_DIGEST_DATA)));
+            STRICT_EXPECTED_CALL(hsm_key_mem_cleanse(TEST_DIGEST_DATA, sizeof(TEST_DIGEST_DATA)));
             STRICT_EXPECTED_CALL(BUFFER_delete(TEST_BUFFER_HANDLE));
 
             // act
@@ -423,7 +441,7 @@ BEGIN_TEST_SUITE(edge_hsm_key_interface_sas_key_unittests)
             STRICT_EXPECTED_CALL(BUFFER_length(TEST_BUFFER_HANDLE));
             STRICT_EXPECTED_CALL(BUFFER_u_char(TEST_BUFFER_HANDLE));
             STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(TEST_DIGEST_DATA)));
-            // note BUFFER_delete does not fail
+            // note hsm_key_mem_cleanse and BUFFER_delete do not fail
             //STRICT_EXPECTED_CALL(BUFFER_delete(TEST_BUFFER_HANDLE));
 
             umock_c_negative_tests_snapshot();
@@ -528,6 +546,7 @@ BEGIN_TEST_SUITE(edge_hsm_key_interface_sas_key_unittests)
             STRICT_EXPECTED_CALL(BUFFER_length(TEST_BUFFER_HANDLE));
             STRICT_EXPECTED_CALL(BUFFER_u_char(TEST_BUFFER_HANDLE));
             STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(TEST_DIGEST_DATA)));
+            STRICT_EXPECTED_CALL(hsm_key_mem_cleanse(TEST_DIGEST_DATA, sizeof(TEST_DIGEST_DATA)));
             STRICT_EXPECTED_CALL(BUFFER_delete(TEST_BUFFER_HANDLE));
             EXPECTED_CALL(BUFFER_new())
                 .SetReturn(TEST_DERIVED_BUFFER_HANDLE);
@@ -535,7 +554,9 @@ BEGIN_TEST_SUITE(edge_hsm_key_interface_sas_key_unittests)
             STRICT_EXPECTED_CALL(BUFFER_length(TEST_DERIVED_BUFFER_HANDLE));
             STRICT_EXPECTED_CALL(BUFFER_u_char(TEST_DERIVED_BUFFER_HANDLE));
             STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(TEST_DERIVED_DIGEST_DATA)));
+            STRICT_EXPECTED_CALL(hsm_key_mem_cleanse(TEST_DERIVED_DIGEST_DATA, sizeof(TEST_DERIVED_DIGEST_DATA)));
             STRICT_EXPECTED_CALL(BUFFER_delete(TEST_DERIVED_BUFFER_HANDLE));
+            STRICT_EXPECTED_CALL(hsm_key_mem_cleanse(IGNORED_PTR_ARG, sizeof(TEST_DIGEST_DATA)));
             EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
             // act
@@ -582,6 +603,8 @@ BEGIN_TEST_SUITE(edge_hsm_key_interface_sas_key_unittests)
             failedFunctionBitmask |= ((uint64_t)1 << i++);
             STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(TEST_DIGEST_DATA)));
             failedFunctionBitmask |= ((uint64_t)1 << i++);
+            STRICT_EXPECTED_CALL(hsm_key_mem_cleanse(TEST_DIGEST_DATA, sizeof(TEST_DIGEST_DATA)));
+            i++;
             STRICT_EXPECTED_CALL(BUFFER_delete(TEST_BUFFER_HANDLE));
             i++;
             EXPECTED_CALL(BUFFER_new())
@@ -595,8 +618,12 @@ BEGIN_TEST_SUITE(edge_hsm_key_interface_sas_key_unittests)
             failedFunctionBitmask |= ((uint64_t)1 << i++);
             STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(TEST_DERIVED_DIGEST_DATA)));
             failedFunctionBitmask |= ((uint64_t)1 << i++);
+            STRICT_EXPECTED_CALL(hsm_key_mem_cleanse(TEST_DERIVED_DIGEST_DATA, sizeof(TEST_DERIVED_DIGEST_DATA)));
+            i++;
             STRICT_EXPECTED_CALL(BUFFER_delete(TEST_DERIVED_BUFFER_HANDLE));
             i++;
+            STRICT_EXPECTED_CALL(hsm_key_mem_cleanse(IGNORED_PTR_ARG, sizeof(TEST_DIGEST_DATA)));
+            i++;
             EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
             i++;
             umock_c_negative_tests_snapshot();
@@ -17,6 +17,7 @@
 #include "azure_c_shared_utility/buffer_.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/threadapi.h"
 #include "hsm_log.h"
 #include "hsm_utils.h"
 
@@ -29,9 +30,15 @@
 //#############################################################################
 // Test defines and data
 //#############################################################################
-#define EDGE_STORE_NAME "blah"
+#define EDGE_STORE_NAME "edgelet"
+#define TEST_TENANT_STORE_NAME "tenant"
 #define TEST_DATA_TO_BE_SIGNED "The quick brown fox jumped over the lazy dog"
 #define TEST_KEY_BASE64 "D7PuplFy7vIr0349blOugqCxyfMscyVZDoV9Ii0EFnA="
+#define TEST_OWNER_CA_ALIAS "edge_owner_ca"
+#define TEST_DEVICE_CA_ALIAS "device_ca_alias"
+#define TEST_NUM_CREATE_THREADS 4
+
+extern STRING_HANDLE compute_b64_sha_digest_string(const unsigned char* ip_buffer, size_t ip_buffer_size);
 
 static char* TEST_IOTEDGE_HOMEDIR = NULL;
 static char* TEST_IOTEDGE_HOMEDIR_GUID = NULL;
@@ -39,6 +46,12 @@ static char* TEST_IOTEDGE_HOMEDIR_GUID = NULL;
 static TEST_MUTEX_HANDLE g_testByTest;
 static TEST_MUTEX_HANDLE g_dllByDll;
 
+static int test_helper_create_edge_store_thread(void *context)
+{
+    const HSM_CLIENT_STORE_INTERFACE *store_if = (const HSM_CLIENT_STORE_INTERFACE*)context;
+    return store_if->hsm_client_store_create(EDGE_STORE_NAME);
+}
+
 //#############################################################################
 // Test helpers
 //#############################################################################
@@ -66,6 +79,28 @@ static void test_helper_teardown_homedir(void)
     }
 }
 
+// the store names files after the alias followed by the digest of the alias
+static STRING_HANDLE test_helper_build_store_file_path
+(
+    const char *dir,
+    const char *alias,
+    const char *extension
+)
+{
+    STRING_HANDLE alias_sha = compute_b64_sha_digest_string((const unsigned char*)alias, strlen(alias));
+    ASSERT_IS_NOT_NULL(alias_sha, "Line:" TOSTRING(__LINE__));
+    STRING_HANDLE result = STRING_construct(TEST_IOTEDGE_HOMEDIR);
+    ASSERT_IS_NOT_NULL(result, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, STRING_concat(result, "/hsm/"), "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, STRING_concat(result, dir), "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, STRING_concat(result, "/"), "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, STRING_concat(result, alias), "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, STRING_concat_with_STRING(result, alias_sha), "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, STRING_concat(result, extension), "Line:" TOSTRING(__LINE__));
+    STRING_delete(alias_sha);
+    return result;
+}
+
 static CERT_PROPS_HANDLE test_helper_create_certificate_props
 (
     const char *common_name,
@@ -353,6 +388,64 @@ BEGIN_TEST_SUITE(edge_hsm_store_int_tests)
         ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
     }
 
+    TEST_FUNCTION(insert_remove_trusted_cert_updates_bundle_smoke)
+    {
+        // arrange
+        int result;
+        const HSM_CLIENT_STORE_INTERFACE *store_if = hsm_client_store_interface();
+        ASSERT_IS_NOT_NULL(store_if, "Line:" TOSTRING(__LINE__));
+
+        result = store_if->hsm_client_store_create(EDGE_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+
+        HSM_CLIENT_STORE_HANDLE store_handle = store_if->hsm_client_store_open(EDGE_STORE_NAME);
+        ASSERT_IS_NOT_NULL(store_handle, "Line:" TOSTRING(__LINE__));
+
+        CERT_INFO_HANDLE default_bundle = store_if->hsm_client_store_get_pki_trusted_certs(store_handle);
+        ASSERT_IS_NOT_NULL(default_bundle, "Line:" TOSTRING(__LINE__));
+        const char *default_pem = certificate_info_get_certificate(default_bundle);
+        ASSERT_IS_NOT_NULL(default_pem, "Line:" TOSTRING(__LINE__));
+
+        STRING_HANDLE trusted_file = STRING_construct(TEST_IOTEDGE_HOMEDIR);
+        ASSERT_IS_NOT_NULL(trusted_file, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, STRING_concat(trusted_file, "/test_trusted_ca.pem"), "Line:" TOSTRING(__LINE__));
+        result = write_cstring_to_file(STRING_c_str(trusted_file), default_pem);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+
+        STRING_HANDLE expected_pem = STRING_construct(default_pem);
+        ASSERT_IS_NOT_NULL(expected_pem, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, STRING_concat(expected_pem, default_pem), "Line:" TOSTRING(__LINE__));
+
+        // act, assert
+        result = store_if->hsm_client_store_insert_pki_trusted_cert(store_handle, "test_trusted_alias", STRING_c_str(trusted_file));
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+
+        CERT_INFO_HANDLE updated_bundle = store_if->hsm_client_store_get_pki_trusted_certs(store_handle);
+        ASSERT_IS_NOT_NULL(updated_bundle, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, STRING_c_str(expected_pem), certificate_info_get_certificate(updated_bundle), "Line:" TOSTRING(__LINE__));
+
+        result = store_if->hsm_client_store_remove_pki_trusted_cert(store_handle, "test_trusted_alias");
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+
+        CERT_INFO_HANDLE reverted_bundle = store_if->hsm_client_store_get_pki_trusted_certs(store_handle);
+        ASSERT_IS_NOT_NULL(reverted_bundle, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, default_pem, certificate_info_get_certificate(reverted_bundle), "Line:" TOSTRING(__LINE__));
+        // previously obtained handles remain valid across updates
+        ASSERT_ARE_EQUAL(char_ptr, STRING_c_str(expected_pem), certificate_info_get_certificate(updated_bundle), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        certificate_info_destroy(reverted_bundle);
+        certificate_info_destroy(updated_bundle);
+        certificate_info_destroy(default_bundle);
+        (void)delete_file(STRING_c_str(trusted_file));
+        STRING_delete(expected_pem);
+        STRING_delete(trusted_file);
+        result = store_if->hsm_client_store_close(store_handle);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        result = store_if->hsm_client_store_destroy(EDGE_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+    }
+
     TEST_FUNCTION(insert_generated_cert_smoke)
     {
         // arrange
@@ -397,4 +490,168 @@ BEGIN_TEST_SUITE(edge_hsm_store_int_tests)
         ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
     }
 
+    TEST_FUNCTION(create_records_verified_certs_manifest_smoke)
+    {
+        // arrange
+        int result;
+        const HSM_CLIENT_STORE_INTERFACE *store_if = hsm_client_store_interface();
+        ASSERT_IS_NOT_NULL(store_if, "Line:" TOSTRING(__LINE__));
+        STRING_HANDLE manifest_file = STRING_construct(TEST_IOTEDGE_HOMEDIR);
+        ASSERT_IS_NOT_NULL(manifest_file, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, STRING_concat(manifest_file, "/hsm/certs/verified_certs.manifest"), "Line:" TOSTRING(__LINE__));
+
+        result = store_if->hsm_client_store_create(EDGE_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        result = store_if->hsm_client_store_destroy(EDGE_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        char *first_manifest = read_file_into_cstring(STRING_c_str(manifest_file), NULL);
+        ASSERT_IS_NOT_NULL(first_manifest, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE((strlen(first_manifest) > 0), "Line:" TOSTRING(__LINE__));
+
+        // act
+        result = store_if->hsm_client_store_create(EDGE_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        char *second_manifest = read_file_into_cstring(STRING_c_str(manifest_file), NULL);
+
+        // assert
+        ASSERT_IS_NOT_NULL(second_manifest, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, first_manifest, second_manifest, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        free(second_manifest);
+        free(first_manifest);
+        STRING_delete(manifest_file);
+        result = store_if->hsm_client_store_destroy(EDGE_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(create_regenerates_device_ca_with_mismatched_key_smoke)
+    {
+        // arrange
+        int result;
+        const HSM_CLIENT_STORE_INTERFACE *store_if = hsm_client_store_interface();
+        ASSERT_IS_NOT_NULL(store_if, "Line:" TOSTRING(__LINE__));
+        STRING_HANDLE owner_key_file = test_helper_build_store_file_path("cert_keys", TEST_OWNER_CA_ALIAS, ".key.pem");
+        STRING_HANDLE device_key_file = test_helper_build_store_file_path("cert_keys", TEST_DEVICE_CA_ALIAS, ".key.pem");
+        STRING_HANDLE device_cert_file = test_helper_build_store_file_path("certs", TEST_DEVICE_CA_ALIAS, ".cert.pem");
+
+        result = store_if->hsm_client_store_create(EDGE_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        result = store_if->hsm_client_store_destroy(EDGE_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        char *first_cert = read_file_into_cstring(STRING_c_str(device_cert_file), NULL);
+        ASSERT_IS_NOT_NULL(first_cert, "Line:" TOSTRING(__LINE__));
+        char *owner_key = read_file_into_cstring(STRING_c_str(owner_key_file), NULL);
+        ASSERT_IS_NOT_NULL(owner_key, "Line:" TOSTRING(__LINE__));
+        result = write_cstring_to_file(STRING_c_str(device_key_file), owner_key);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+
+        // act
+        result = store_if->hsm_client_store_create(EDGE_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        char *second_cert = read_file_into_cstring(STRING_c_str(device_cert_file), NULL);
+
+        // assert
+        ASSERT_IS_NOT_NULL(second_cert, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(char_ptr, first_cert, second_cert, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        free(second_cert);
+        free(owner_key);
+        free(first_cert);
+        STRING_delete(device_cert_file);
+        STRING_delete(device_key_file);
+        STRING_delete(owner_key_file);
+        result = store_if->hsm_client_store_destroy(EDGE_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(named_stores_are_independent_smoke)
+    {
+        // arrange
+        int result;
+        KEY_HANDLE key_handle;
+        const HSM_CLIENT_STORE_INTERFACE *store_if = hsm_client_store_interface();
+        ASSERT_IS_NOT_NULL(store_if, "Line:" TOSTRING(__LINE__));
+        STRING_HANDLE stores_dir = STRING_construct(TEST_IOTEDGE_HOMEDIR);
+        ASSERT_IS_NOT_NULL(stores_dir, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, STRING_concat(stores_dir, "/hsm/stores"), "Line:" TOSTRING(__LINE__));
+
+        // act
+        result = store_if->hsm_client_store_create(EDGE_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        result = store_if->hsm_client_store_create(TEST_TENANT_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        HSM_CLIENT_STORE_HANDLE edge_handle = store_if->hsm_client_store_open(EDGE_STORE_NAME);
+        ASSERT_IS_NOT_NULL(edge_handle, "Line:" TOSTRING(__LINE__));
+        HSM_CLIENT_STORE_HANDLE tenant_handle = store_if->hsm_client_store_open(TEST_TENANT_STORE_NAME);
+        ASSERT_IS_NOT_NULL(tenant_handle, "Line:" TOSTRING(__LINE__));
+        result = store_if->hsm_client_store_insert_sas_key(tenant_handle, "tenant_sas_key", (unsigned char*)"ABCD", 5);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+
+        // assert
+        ASSERT_ARE_NOT_EQUAL(void_ptr, edge_handle, tenant_handle, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(is_directory_valid(STRING_c_str(stores_dir)), "Line:" TOSTRING(__LINE__));
+        key_handle = store_if->hsm_client_store_open_key(edge_handle, HSM_KEY_SAS, "tenant_sas_key");
+        ASSERT_IS_NULL(key_handle, "Line:" TOSTRING(__LINE__));
+        key_handle = store_if->hsm_client_store_open_key(tenant_handle, HSM_KEY_SAS, "tenant_sas_key");
+        ASSERT_IS_NOT_NULL(key_handle, "Line:" TOSTRING(__LINE__));
+        result = store_if->hsm_client_store_close_key(tenant_handle, key_handle);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        CERT_INFO_HANDLE cert_info = store_if->hsm_client_store_get_pki_cert(edge_handle, TEST_OWNER_CA_ALIAS);
+        ASSERT_IS_NOT_NULL(cert_info, "Line:" TOSTRING(__LINE__));
+        certificate_info_destroy(cert_info);
+        ASSERT_IS_NULL(store_if->hsm_client_store_get_pki_cert(tenant_handle, TEST_OWNER_CA_ALIAS), "Line:" TOSTRING(__LINE__));
+        result = store_if->hsm_client_store_destroy(TEST_TENANT_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(store_if->hsm_client_store_open(TEST_TENANT_STORE_NAME), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NOT_NULL(store_if->hsm_client_store_open(EDGE_STORE_NAME), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        STRING_delete(stores_dir);
+        result = store_if->hsm_client_store_destroy(EDGE_STORE_NAME);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(concurrent_create_provisions_store_once_smoke)
+    {
+        // arrange
+        int result;
+        int idx;
+        THREAD_HANDLE threads[TEST_NUM_CREATE_THREADS];
+        const HSM_CLIENT_STORE_INTERFACE *store_if = hsm_client_store_interface();
+        ASSERT_IS_NOT_NULL(store_if, "Line:" TOSTRING(__LINE__));
+
+        // act
+        for (idx = 0; idx < TEST_NUM_CREATE_THREADS; idx++)
+        {
+            ASSERT_ARE_EQUAL(int, THREADAPI_OK, ThreadAPI_Create(&threads[idx], test_helper_create_edge_store_thread, (void*)store_if), "Line:" TOSTRING(__LINE__));
+        }
+        for (idx = 0; idx < TEST_NUM_CREATE_THREADS; idx++)
+        {
+            int thread_result = __LINE__;
+            ASSERT_ARE_EQUAL(int, THREADAPI_OK, ThreadAPI_Join(threads[idx], &thread_result), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, thread_result, "Line:" TOSTRING(__LINE__));
+        }
+
+        // assert
+        HSM_CLIENT_STORE_HANDLE store_handle = store_if->hsm_client_store_open(EDGE_STORE_NAME);
+        ASSERT_IS_NOT_NULL(store_handle, "Line:" TOSTRING(__LINE__));
+        CERT_INFO_HANDLE cert_info = store_if->hsm_client_store_get_pki_cert(store_handle, TEST_OWNER_CA_ALIAS);
+        ASSERT_IS_NOT_NULL(cert_info, "Line:" TOSTRING(__LINE__));
+        certificate_info_destroy(cert_info);
+        result = store_if->hsm_client_store_close(store_handle);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+
+        // cleanup, the store stays provisioned until its last creator destroys it
+        for (idx = 0; idx < TEST_NUM_CREATE_THREADS; idx++)
+        {
+            ASSERT_IS_NOT_NULL((store_handle = store_if->hsm_client_store_open(EDGE_STORE_NAME)), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, store_if->hsm_client_store_close(store_handle), "Line:" TOSTRING(__LINE__));
+            result = store_if->hsm_client_store_destroy(EDGE_STORE_NAME);
+            ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        }
+        ASSERT_IS_NULL(store_if->hsm_client_store_open(EDGE_STORE_NAME), "Line:" TOSTRING(__LINE__));
+    }
+
 END_TEST_SUITE(edge_hsm_store_int_tests)
@@ -52,6 +52,10 @@ static void test_hook_gballoc_free(void* ptr)
 #include "hsm_utils.h"
 
 MOCKABLE_FUNCTION(, CERT_INFO_HANDLE, certificate_info_create, const char*, certificate, const void*, private_key, size_t, priv_key_len, PRIVATE_KEY_TYPE, pk_type);
+MOCKABLE_FUNCTION(, CERT_INFO_HANDLE, certificate_info_create_from_buffer, const void*, certificate, size_t, certificate_size, const void*, private_key, size_t, priv_key_len, PRIVATE_KEY_TYPE, pk_type);
+MOCKABLE_FUNCTION(, CERT_INFO_HANDLE, certificate_info_clone, CERT_INFO_HANDLE, handle);
+MOCKABLE_FUNCTION(, void, certificate_info_destroy, CERT_INFO_HANDLE, handle);
+MOCKABLE_FUNCTION(, CERT_INFO_HANDLE, certificate_info_append_from_buffer, CERT_INFO_HANDLE, handle, const void*, certificate, size_t, certificate_size);
 MOCKABLE_FUNCTION(, const char*, get_alias, CERT_PROPS_HANDLE, handle);
 MOCKABLE_FUNCTION(, const char*, get_issuer_alias, CERT_PROPS_HANDLE, handle);
 //MOCKABLE_FUNCTION(, mocked_list_condition_function, const void*, item, const void*, match_context, bool*, continue_processing);
@@ -87,7 +91,6 @@ MOCKABLE_FUNCTION(, const char*, get_issuer_alias, CERT_PROPS_HANDLE, handle);
 
 #define TEST_SAS_KEY_NAME_1  "test_sas_name_1"
 #define TEST_SAS_KEY_VALUE_1 "ABCD"
-#define SAS_KEY_ID_1_BUFFER_HANDLE (BUFFER_HANDLE)0x6000
 #define SAS_KEY_ID_1_STRING_HANDLE (STRING_HANDLE)0x6001
 #define SAS_KEY_ID_1_LIST_ITEM_HANDLE (LIST_ITEM_HANDLE) 0x6002
 
@@ -170,7 +173,6 @@ void call_stack_helper_key_list_destroy(SINGLYLINKEDLIST_HANDLE list, int mocked
         STRICT_EXPECTED_CALL(singlylinkedlist_get_head_item(list)).SetReturn(list_item);
         STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(list_item)).SetReturn(real_mem);
         EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG));
-        EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(gballoc_free(real_mem));
         STRICT_EXPECTED_CALL(singlylinkedlist_remove(list, list_item));
     }
@@ -593,8 +595,6 @@ BEGIN_TEST_SUITE(edge_hsm_store_unittests)
             .CaptureReturn(&key_entry_1);
         STRICT_EXPECTED_CALL(STRING_construct(TEST_SAS_KEY_NAME_1))
             .SetReturn(SAS_KEY_ID_1_STRING_HANDLE);
-        STRICT_EXPECTED_CALL(BUFFER_create(TEST_SAS_KEY_VALUE_1, strlen(TEST_SAS_KEY_VALUE_1) + 1))
-            .SetReturn(SAS_KEY_ID_1_BUFFER_HANDLE);
         STRICT_EXPECTED_CALL(singlylinkedlist_add(SAS_KEYS_LIST_HANDLE, IGNORED_PTR_ARG))
             .SetReturn(SAS_KEY_ID_1_LIST_ITEM_HANDLE);
 
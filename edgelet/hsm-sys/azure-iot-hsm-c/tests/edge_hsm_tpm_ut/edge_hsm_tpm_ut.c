@@ -92,6 +92,7 @@ MOCKABLE_FUNCTION(, const HSM_CLIENT_KEY_INTERFACE*, hsm_client_key_interface);
 #define TEST_KEY_HANDLE (KEY_HANDLE)0x1001
 #define TEST_HSM_CLIENT_HANDLE (HSM_CLIENT_HANDLE)0x1002
 #define TEST_SAS_KEY_NAME "edgelet-identity"
+#define TEST_MODULE_SAS_KEY_NAME "edge-device/module1"
 #define TEST_OUTPUT_DIGEST_PTR (unsigned char*)0x5000
 
 DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
@@ -616,6 +617,28 @@ BEGIN_TEST_SUITE(edge_hsm_tpm_unittests)
             //cleanup
         }
 
+        /**
+         * Test function for API
+         *   hsm_client_tpm_store_sas_key_interface
+        */
+        TEST_FUNCTION(hsm_client_tpm_store_sas_key_interface_success)
+        {
+            //arrange
+
+            // act
+            const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* result = hsm_client_tpm_store_sas_key_interface();
+
+            // assert
+            ASSERT_IS_NOT_NULL(result, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, HSM_CLIENT_TPM_SAS_KEY_INTERFACE_VERSION, (int)result->version, "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NOT_NULL(result->hsm_client_import_sas_key, "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NOT_NULL(result->hsm_client_remove_sas_key, "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NOT_NULL(result->hsm_client_sign_with_sas_key, "Line:" TOSTRING(__LINE__));
+
+            //cleanup
+        }
+
         /**
          * Test function for API
          *   hsm_client_tpm_create
@@ -1409,4 +1432,340 @@ BEGIN_TEST_SUITE(edge_hsm_tpm_unittests)
             umock_c_negative_tests_deinit();
         }
 
+        /**
+         * Test function for API
+         *   hsm_client_import_sas_key
+        */
+        TEST_FUNCTION(edge_hsm_client_import_sas_key_does_nothing_when_tpm_not_initialized)
+        {
+            //arrange
+            int status;
+            const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* sas_key_interface = hsm_client_tpm_store_sas_key_interface();
+            HSM_CLIENT_IMPORT_SAS_KEY hsm_client_import_sas_key = sas_key_interface->hsm_client_import_sas_key;
+            unsigned char test_input[] = {'t', 'e', 's', 't'};
+
+            // act
+            status = hsm_client_import_sas_key(TEST_HSM_CLIENT_HANDLE, TEST_MODULE_SAS_KEY_NAME, test_input, sizeof(test_input));
+
+            // assert
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+            //cleanup
+        }
+
+        /**
+         * Test function for API
+         *   hsm_client_import_sas_key
+        */
+        TEST_FUNCTION(edge_hsm_client_import_sas_key_invalid_param_validation)
+        {
+            //arrange
+            int status;
+            status = hsm_client_tpm_store_init();
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            const HSM_CLIENT_TPM_INTERFACE* interface = hsm_client_tpm_store_interface();
+            const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* sas_key_interface = hsm_client_tpm_store_sas_key_interface();
+            HSM_CLIENT_CREATE hsm_client_tpm_create = interface->hsm_client_tpm_create;
+            HSM_CLIENT_DESTROY hsm_client_tpm_destroy = interface->hsm_client_tpm_destroy;
+            HSM_CLIENT_IMPORT_SAS_KEY hsm_client_import_sas_key = sas_key_interface->hsm_client_import_sas_key;
+            HSM_CLIENT_HANDLE hsm_handle = hsm_client_tpm_create();
+            unsigned char test_input[] = {'t', 'e', 's', 't'};
+            umock_c_reset_all_calls();
+
+            // act, assert
+            status = hsm_client_import_sas_key(NULL, TEST_MODULE_SAS_KEY_NAME, test_input, sizeof(test_input));
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            status = hsm_client_import_sas_key(hsm_handle, NULL, test_input, sizeof(test_input));
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            status = hsm_client_import_sas_key(hsm_handle, "", test_input, sizeof(test_input));
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            status = hsm_client_import_sas_key(hsm_handle, TEST_SAS_KEY_NAME, test_input, sizeof(test_input));
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            status = hsm_client_import_sas_key(hsm_handle, TEST_MODULE_SAS_KEY_NAME, NULL, sizeof(test_input));
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            status = hsm_client_import_sas_key(hsm_handle, TEST_MODULE_SAS_KEY_NAME, test_input, 0);
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+            //cleanup
+            hsm_client_tpm_destroy(hsm_handle);
+            hsm_client_tpm_store_deinit();
+        }
+
+        /**
+         * Test function for API
+         *   hsm_client_import_sas_key
+        */
+        TEST_FUNCTION(edge_hsm_client_import_sas_key_success)
+        {
+            //arrange
+            int status;
+            status = hsm_client_tpm_store_init();
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            const HSM_CLIENT_TPM_INTERFACE* interface = hsm_client_tpm_store_interface();
+            const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* sas_key_interface = hsm_client_tpm_store_sas_key_interface();
+            HSM_CLIENT_CREATE hsm_client_tpm_create = interface->hsm_client_tpm_create;
+            HSM_CLIENT_DESTROY hsm_client_tpm_destroy = interface->hsm_client_tpm_destroy;
+            HSM_CLIENT_IMPORT_SAS_KEY hsm_client_import_sas_key = sas_key_interface->hsm_client_import_sas_key;
+            HSM_CLIENT_HANDLE hsm_handle = hsm_client_tpm_create();
+            unsigned char test_input[] = {'t', 'e', 's', 't'};
+            umock_c_reset_all_calls();
+
+            STRICT_EXPECTED_CALL(mocked_hsm_client_store_insert_sas_key(TEST_HSM_STORE_HANDLE, TEST_MODULE_SAS_KEY_NAME, test_input, sizeof(test_input)));
+
+            // act
+            status = hsm_client_import_sas_key(hsm_handle, TEST_MODULE_SAS_KEY_NAME, test_input, sizeof(test_input));
+
+            // assert
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+            //cleanup
+            hsm_client_tpm_destroy(hsm_handle);
+            hsm_client_tpm_store_deinit();
+        }
+
+        /**
+         * Test function for API
+         *   hsm_client_import_sas_key
+        */
+        TEST_FUNCTION(edge_hsm_client_import_sas_key_negative)
+        {
+            //arrange
+            int status;
+            int test_result = umock_c_negative_tests_init();
+            ASSERT_ARE_EQUAL(int, 0, test_result);
+
+            status = hsm_client_tpm_store_init();
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            const HSM_CLIENT_TPM_INTERFACE* interface = hsm_client_tpm_store_interface();
+            const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* sas_key_interface = hsm_client_tpm_store_sas_key_interface();
+            HSM_CLIENT_CREATE hsm_client_tpm_create = interface->hsm_client_tpm_create;
+            HSM_CLIENT_DESTROY hsm_client_tpm_destroy = interface->hsm_client_tpm_destroy;
+            HSM_CLIENT_IMPORT_SAS_KEY hsm_client_import_sas_key = sas_key_interface->hsm_client_import_sas_key;
+            HSM_CLIENT_HANDLE hsm_handle = hsm_client_tpm_create();
+            unsigned char test_input[] = {'t', 'e', 's', 't'};
+            umock_c_reset_all_calls();
+
+            STRICT_EXPECTED_CALL(mocked_hsm_client_store_insert_sas_key(TEST_HSM_STORE_HANDLE, TEST_MODULE_SAS_KEY_NAME, test_input, sizeof(test_input)));
+
+            umock_c_negative_tests_snapshot();
+
+            for (size_t i = 0; i < umock_c_negative_tests_call_count(); i++)
+            {
+                umock_c_negative_tests_reset();
+                umock_c_negative_tests_fail_call(i);
+
+                // act
+                status = hsm_client_import_sas_key(hsm_handle, TEST_MODULE_SAS_KEY_NAME, test_input, sizeof(test_input));
+
+                // assert
+                ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            }
+
+            //cleanup
+            hsm_client_tpm_destroy(hsm_handle);
+            hsm_client_tpm_store_deinit();
+            umock_c_negative_tests_deinit();
+        }
+
+        /**
+         * Test function for API
+         *   hsm_client_remove_sas_key
+        */
+        TEST_FUNCTION(edge_hsm_client_remove_sas_key_invalid_param_validation)
+        {
+            //arrange
+            int status;
+            status = hsm_client_tpm_store_init();
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            const HSM_CLIENT_TPM_INTERFACE* interface = hsm_client_tpm_store_interface();
+            const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* sas_key_interface = hsm_client_tpm_store_sas_key_interface();
+            HSM_CLIENT_CREATE hsm_client_tpm_create = interface->hsm_client_tpm_create;
+            HSM_CLIENT_DESTROY hsm_client_tpm_destroy = interface->hsm_client_tpm_destroy;
+            HSM_CLIENT_REMOVE_SAS_KEY hsm_client_remove_sas_key = sas_key_interface->hsm_client_remove_sas_key;
+            HSM_CLIENT_HANDLE hsm_handle = hsm_client_tpm_create();
+            umock_c_reset_all_calls();
+
+            // act, assert
+            status = hsm_client_remove_sas_key(NULL, TEST_MODULE_SAS_KEY_NAME);
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            status = hsm_client_remove_sas_key(hsm_handle, NULL);
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            status = hsm_client_remove_sas_key(hsm_handle, "");
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            status = hsm_client_remove_sas_key(hsm_handle, TEST_SAS_KEY_NAME);
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+            //cleanup
+            hsm_client_tpm_destroy(hsm_handle);
+            hsm_client_tpm_store_deinit();
+        }
+
+        /**
+         * Test function for API
+         *   hsm_client_remove_sas_key
+        */
+        TEST_FUNCTION(edge_hsm_client_remove_sas_key_success)
+        {
+            //arrange
+            int status;
+            status = hsm_client_tpm_store_init();
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            const HSM_CLIENT_TPM_INTERFACE* interface = hsm_client_tpm_store_interface();
+            const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* sas_key_interface = hsm_client_tpm_store_sas_key_interface();
+            HSM_CLIENT_CREATE hsm_client_tpm_create = interface->hsm_client_tpm_create;
+            HSM_CLIENT_DESTROY hsm_client_tpm_destroy = interface->hsm_client_tpm_destroy;
+            HSM_CLIENT_REMOVE_SAS_KEY hsm_client_remove_sas_key = sas_key_interface->hsm_client_remove_sas_key;
+            HSM_CLIENT_HANDLE hsm_handle = hsm_client_tpm_create();
+            umock_c_reset_all_calls();
+
+            STRICT_EXPECTED_CALL(mocked_hsm_client_store_remove_key(TEST_HSM_STORE_HANDLE, HSM_KEY_SAS, TEST_MODULE_SAS_KEY_NAME));
+
+            // act
+            status = hsm_client_remove_sas_key(hsm_handle, TEST_MODULE_SAS_KEY_NAME);
+
+            // assert
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+            //cleanup
+            hsm_client_tpm_destroy(hsm_handle);
+            hsm_client_tpm_store_deinit();
+        }
+
+        /**
+         * Test function for API
+         *   hsm_client_sign_with_sas_key
+        */
+        TEST_FUNCTION(edge_hsm_client_sign_with_sas_key_invalid_param_validation)
+        {
+            //arrange
+            int status = hsm_client_tpm_store_init();
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            const HSM_CLIENT_TPM_INTERFACE* interface = hsm_client_tpm_store_interface();
+            const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* sas_key_interface = hsm_client_tpm_store_sas_key_interface();
+            HSM_CLIENT_CREATE hsm_client_tpm_create = interface->hsm_client_tpm_create;
+            HSM_CLIENT_DESTROY hsm_client_tpm_destroy = interface->hsm_client_tpm_destroy;
+            HSM_CLIENT_SIGN_WITH_SAS_KEY hsm_client_sign_with_sas_key = sas_key_interface->hsm_client_sign_with_sas_key;
+            HSM_CLIENT_HANDLE hsm_handle = hsm_client_tpm_create();
+            unsigned char test_input[] = {'t', 'e', 's', 't'};
+            unsigned char *test_output_buffer = TEST_OUTPUT_DIGEST_PTR;
+            size_t test_output_len = 10;
+            umock_c_reset_all_calls();
+
+            // act, assert
+            status = hsm_client_sign_with_sas_key(NULL, TEST_MODULE_SAS_KEY_NAME, test_input, sizeof(test_input), &test_output_buffer, &test_output_len);
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(test_output_buffer, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, 0, test_output_len, "Line:" TOSTRING(__LINE__));
+
+            status = hsm_client_sign_with_sas_key(hsm_handle, NULL, test_input, sizeof(test_input), &test_output_buffer, &test_output_len);
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+            status = hsm_client_sign_with_sas_key(hsm_handle, "", test_input, sizeof(test_input), &test_output_buffer, &test_output_len);
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+            status = hsm_client_sign_with_sas_key(hsm_handle, TEST_MODULE_SAS_KEY_NAME, NULL, sizeof(test_input), &test_output_buffer, &test_output_len);
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+            status = hsm_client_sign_with_sas_key(hsm_handle, TEST_MODULE_SAS_KEY_NAME, test_input, 0, &test_output_buffer, &test_output_len);
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+            status = hsm_client_sign_with_sas_key(hsm_handle, TEST_MODULE_SAS_KEY_NAME, test_input, sizeof(test_input), NULL, &test_output_len);
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+            status = hsm_client_sign_with_sas_key(hsm_handle, TEST_MODULE_SAS_KEY_NAME, test_input, sizeof(test_input), &test_output_buffer, NULL);
+            ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+            //cleanup
+            hsm_client_tpm_destroy(hsm_handle);
+            hsm_client_tpm_store_deinit();
+        }
+
+        /**
+         * Test function for API
+         *   hsm_client_sign_with_sas_key
+        */
+        TEST_FUNCTION(edge_hsm_client_sign_with_sas_key_success)
+        {
+            //arrange
+            int status = hsm_client_tpm_store_init();
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            const HSM_CLIENT_TPM_INTERFACE* interface = hsm_client_tpm_store_interface();
+            const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* sas_key_interface = hsm_client_tpm_store_sas_key_interface();
+            HSM_CLIENT_CREATE hsm_client_tpm_create = interface->hsm_client_tpm_create;
+            HSM_CLIENT_DESTROY hsm_client_tpm_destroy = interface->hsm_client_tpm_destroy;
+            HSM_CLIENT_SIGN_WITH_SAS_KEY hsm_client_sign_with_sas_key = sas_key_interface->hsm_client_sign_with_sas_key;
+            HSM_CLIENT_HANDLE hsm_handle = hsm_client_tpm_create();
+            unsigned char test_input[] = {'t', 'e', 's', 't'};
+            unsigned char *test_output_buffer = NULL;
+            size_t test_output_len = 0;
+            umock_c_reset_all_calls();
+
+            STRICT_EXPECTED_CALL(mocked_hsm_client_store_open_key(TEST_HSM_STORE_HANDLE, HSM_KEY_SAS, TEST_MODULE_SAS_KEY_NAME));
+            STRICT_EXPECTED_CALL(mocked_hsm_client_key_sign(TEST_KEY_HANDLE, test_input, sizeof(test_input), &test_output_buffer, &test_output_len));
+            STRICT_EXPECTED_CALL(mocked_hsm_client_store_close_key(TEST_HSM_STORE_HANDLE, TEST_KEY_HANDLE));
+
+            // act
+            status = hsm_client_sign_with_sas_key(hsm_handle, TEST_MODULE_SAS_KEY_NAME, test_input, sizeof(test_input), &test_output_buffer, &test_output_len);
+
+            // assert
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+            //cleanup
+            hsm_client_tpm_destroy(hsm_handle);
+            hsm_client_tpm_store_deinit();
+        }
+
+        /**
+         * Test function for API
+         *   hsm_client_sign_with_sas_key
+        */
+        TEST_FUNCTION(edge_hsm_client_sign_with_sas_key_negative)
+        {
+            //arrange
+            int test_result = umock_c_negative_tests_init();
+            ASSERT_ARE_EQUAL(int, 0, test_result);
+            int status = hsm_client_tpm_store_init();
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            const HSM_CLIENT_TPM_INTERFACE* interface = hsm_client_tpm_store_interface();
+            const HSM_CLIENT_TPM_SAS_KEY_INTERFACE* sas_key_interface = hsm_client_tpm_store_sas_key_interface();
+            HSM_CLIENT_CREATE hsm_client_tpm_create = interface->hsm_client_tpm_create;
+            HSM_CLIENT_DESTROY hsm_client_tpm_destroy = interface->hsm_client_tpm_destroy;
+            HSM_CLIENT_SIGN_WITH_SAS_KEY hsm_client_sign_with_sas_key = sas_key_interface->hsm_client_sign_with_sas_key;
+            HSM_CLIENT_HANDLE hsm_handle = hsm_client_tpm_create();
+            unsigned char test_input[] = {'t', 'e', 's', 't'};
+            unsigned char *test_output_buffer = NULL;
+            size_t test_output_len = 0;
+            umock_c_reset_all_calls();
+
+            STRICT_EXPECTED_CALL(mocked_hsm_client_store_open_key(TEST_HSM_STORE_HANDLE, HSM_KEY_SAS, TEST_MODULE_SAS_KEY_NAME));
+            STRICT_EXPECTED_CALL(mocked_hsm_client_key_sign(TEST_KEY_HANDLE, test_input, sizeof(test_input), &test_output_buffer, &test_output_len));
+            STRICT_EXPECTED_CALL(mocked_hsm_client_store_close_key(TEST_HSM_STORE_HANDLE, TEST_KEY_HANDLE));
+
+            umock_c_negative_tests_snapshot();
+
+            for (size_t i = 0; i < umock_c_negative_tests_call_count(); i++)
+            {
+                umock_c_negative_tests_reset();
+                umock_c_negative_tests_fail_call(i);
+
+                // act
+                status = hsm_client_sign_with_sas_key(hsm_handle, TEST_MODULE_SAS_KEY_NAME, test_input, sizeof(test_input), &test_output_buffer, &test_output_len);
+
+                // assert
+                ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+            }
+
+            //cleanup
+            hsm_client_tpm_destroy(hsm_handle);
+            hsm_client_tpm_store_deinit();
+            umock_c_negative_tests_deinit();
+        }
+
 END_TEST_SUITE(edge_hsm_tpm_unittests)
@@ -5,6 +5,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if !(defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows)
+#include <sys/stat.h>
+#endif
 
 #include "testrunnerswitcher.h"
 #include "test_utils.h"
@@ -119,6 +122,24 @@ static int test_helper_write_data_to_file
     return result;
 }
 
+static int test_helper_on_file_read
+(
+    size_t index,
+    const unsigned char *data,
+    size_t data_size,
+    void *context
+)
+{
+    unsigned char **outputs = (unsigned char**)context;
+    unsigned char *output = (unsigned char*)calloc(data_size + 1, 1);
+    ASSERT_IS_NOT_NULL(output, "Line:" TOSTRING(__LINE__));
+    ASSERT_IS_NULL(outputs[index], "Line:" TOSTRING(__LINE__));
+    memcpy(output, data, data_size);
+    outputs[index] = output;
+
+    return 0;
+}
+
 static void delete_file_if_exists(const char* file_name)
 {
     (void)remove(file_name);
@@ -648,6 +669,221 @@ BEGIN_TEST_SUITE(edge_hsm_util_int_tests)
             // cleanup
         }
 
+        TEST_FUNCTION(test_write_cstring_to_file_replaces_file_without_temp_file)
+        {
+            // arrange
+            const char *input_string = "NEWDATA";
+            size_t temp_file_size = 0;
+            char *temp_file = prepare_file_path(TEST_WRITE_FILE, ".tmp");
+            int status = write_cstring_to_file(TEST_WRITE_FILE, "OLDDATAOLDDATA");
+            ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+            // act
+            int output = write_cstring_to_file(TEST_WRITE_FILE, input_string);
+            size_t output_size = 0;
+            char *output_string = read_file_into_cstring(TEST_WRITE_FILE, &output_size);
+
+            // assert
+            ASSERT_ARE_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NOT_NULL(output_string);
+            ASSERT_ARE_EQUAL(int, 0, strcmp(input_string, output_string), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(read_file_into_buffer(temp_file, &temp_file_size), "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            free(output_string);
+            free(temp_file);
+        }
+
+        TEST_FUNCTION(test_file_batch_invalid_params)
+        {
+            // arrange
+            int output;
+            HSM_FILE_BATCH_HANDLE batch = file_batch_create();
+            ASSERT_IS_NOT_NULL(batch, "Line:" TOSTRING(__LINE__));
+
+            // act, assert
+            output = file_batch_add_buffer(NULL, TEST_WRITE_FILE, NUMERIC, sizeof(NUMERIC), false);
+            ASSERT_ARE_NOT_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+
+            output = file_batch_add_buffer(batch, NULL, NUMERIC, sizeof(NUMERIC), false);
+            ASSERT_ARE_NOT_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+
+            output = file_batch_add_buffer(batch, "", NUMERIC, sizeof(NUMERIC), false);
+            ASSERT_ARE_NOT_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+
+            output = file_batch_add_buffer(batch, TEST_WRITE_FILE, NULL, sizeof(NUMERIC), false);
+            ASSERT_ARE_NOT_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+
+            output = file_batch_add_buffer(batch, TEST_WRITE_FILE, NUMERIC, 0, false);
+            ASSERT_ARE_NOT_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+
+            output = file_batch_commit(NULL);
+            ASSERT_ARE_NOT_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            file_batch_destroy(batch);
+        }
+
+        TEST_FUNCTION(test_file_batch_commit_writes_all_files)
+        {
+            // arrange
+            size_t output_size = 0;
+            void *output_buffer;
+            (void)delete_file(TEST_WRITE_FILE);
+            (void)delete_file(TEST_WRITE_FILE_FOR_DELETE);
+            HSM_FILE_BATCH_HANDLE batch = file_batch_create();
+            ASSERT_IS_NOT_NULL(batch, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, file_batch_add_buffer(batch, TEST_WRITE_FILE, (unsigned char*)ALPHA, strlen(ALPHA), false), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, file_batch_add_buffer(batch, TEST_WRITE_FILE_FOR_DELETE, (unsigned char*)ALPHA, strlen(ALPHA), true), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, file_batch_add_buffer(batch, TEST_WRITE_FILE, NUMERIC, sizeof(NUMERIC), false), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_FALSE(is_file_valid(TEST_WRITE_FILE), "Line:" TOSTRING(__LINE__));
+
+            // act
+            int output = file_batch_commit(batch);
+
+            // assert
+            ASSERT_ARE_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+            output_buffer = read_file_into_buffer(TEST_WRITE_FILE, &output_size);
+            ASSERT_IS_NOT_NULL(output_buffer, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, sizeof(NUMERIC), output_size, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, memcmp(NUMERIC, output_buffer, output_size), "Line:" TOSTRING(__LINE__));
+            free(output_buffer);
+            output_buffer = read_file_into_buffer(TEST_WRITE_FILE_FOR_DELETE, &output_size);
+            ASSERT_IS_NOT_NULL(output_buffer, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, strlen(ALPHA), output_size, "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            free(output_buffer);
+            file_batch_destroy(batch);
+            (void)delete_file(TEST_WRITE_FILE_FOR_DELETE);
+        }
+
+        TEST_FUNCTION(test_file_batch_destroy_discards_uncommitted_files)
+        {
+            // arrange
+            (void)delete_file(TEST_WRITE_FILE);
+            HSM_FILE_BATCH_HANDLE batch = file_batch_create();
+            ASSERT_IS_NOT_NULL(batch, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, file_batch_add_buffer(batch, TEST_WRITE_FILE, NUMERIC, sizeof(NUMERIC), false), "Line:" TOSTRING(__LINE__));
+
+            // act
+            file_batch_destroy(batch);
+
+            // assert
+            ASSERT_IS_FALSE(is_file_valid(TEST_WRITE_FILE), "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+        }
+
+        TEST_FUNCTION(test_read_files_into_buffers_smoke)
+        {
+            // arrange
+            const char *file_names[] = { TEST_FILE_ALPHA, TEST_FILE_NUMERIC_NEWLINE, TEST_FILE_ALPHA_NEWLINE };
+            unsigned char *outputs[] = { NULL, NULL, NULL };
+
+            // act
+            int output = read_files_into_buffers(file_names, 3, test_helper_on_file_read, outputs);
+
+            // assert
+            ASSERT_ARE_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, strcmp(ALPHA, (char*)outputs[0]), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, memcmp(NUMERIC_NEWLINE, outputs[1], sizeof(NUMERIC_NEWLINE)), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, strcmp(ALPHA_NEWLINE, (char*)outputs[2]), "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            free(outputs[0]);
+            free(outputs[1]);
+            free(outputs[2]);
+        }
+
+        TEST_FUNCTION(test_read_files_into_buffers_invalid_files_fails)
+        {
+            // arrange
+            const char *missing_file_names[] = { TEST_FILE_ALPHA, TEST_FILE_BAD };
+            const char *empty_file_names[] = { TEST_FILE_EMPTY };
+            const char *invalid_file_names[] = { TEST_FILE_ALPHA, NULL };
+            unsigned char *outputs[] = { NULL, NULL };
+            int output;
+
+            // act, assert
+            output = read_files_into_buffers(NULL, 1, test_helper_on_file_read, outputs);
+            ASSERT_ARE_NOT_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+
+            output = read_files_into_buffers(missing_file_names, 0, test_helper_on_file_read, outputs);
+            ASSERT_ARE_NOT_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+
+            output = read_files_into_buffers(missing_file_names, 2, NULL, outputs);
+            ASSERT_ARE_NOT_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+
+            output = read_files_into_buffers(invalid_file_names, 2, test_helper_on_file_read, outputs);
+            ASSERT_ARE_NOT_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+
+            output = read_files_into_buffers(empty_file_names, 1, test_helper_on_file_read, outputs);
+            ASSERT_ARE_NOT_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+
+            output = read_files_into_buffers(missing_file_names, 2, test_helper_on_file_read, outputs);
+            ASSERT_ARE_NOT_EQUAL(int, 0, output, "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(outputs[1], "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            free(outputs[0]);
+        }
+
+        TEST_FUNCTION(test_map_file_into_view_smoke)
+        {
+            // arrange
+            size_t view_size = 0;
+
+            // act
+            const unsigned char *view = (const unsigned char*)map_file_into_view(TEST_FILE_NUMERIC_NEWLINE, &view_size);
+
+            // assert
+            ASSERT_IS_NOT_NULL(view, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, sizeof(NUMERIC_NEWLINE), view_size, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, memcmp(NUMERIC_NEWLINE, view, view_size), "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            unmap_file_view(view, view_size);
+        }
+
+        TEST_FUNCTION(test_map_file_into_view_invalid_files_fails)
+        {
+            // arrange
+            size_t view_size = 10;
+
+            // act, assert
+            ASSERT_IS_NULL(map_file_into_view(NULL, &view_size), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, 0, view_size, "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(map_file_into_view("", &view_size), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(map_file_into_view(TEST_FILE_ALPHA, NULL), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(map_file_into_view(TEST_FILE_EMPTY, &view_size), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(map_file_into_view(TEST_FILE_BAD, &view_size), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(map_file_into_view(TEST_TEMP_DIR, &view_size), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, 0, view_size, "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            unmap_file_view(NULL, 0);
+        }
+
+#if !(defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows)
+        TEST_FUNCTION(test_map_file_into_view_shared_writable_file_fails)
+        {
+            // arrange
+            size_t view_size = 10;
+            ASSERT_ARE_EQUAL(int, 0, chmod(TEST_FILE_NUMERIC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP), "Line:" TOSTRING(__LINE__));
+
+            // act
+            const void *view = map_file_into_view(TEST_FILE_NUMERIC, &view_size);
+
+            // assert
+            ASSERT_IS_NULL(view, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, 0, view_size, "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            ASSERT_ARE_EQUAL(int, 0, chmod(TEST_FILE_NUMERIC, S_IRUSR | S_IWUSR), "Line:" TOSTRING(__LINE__));
+        }
+#endif
+
         TEST_FUNCTION(test_delete_file_smoke)
         {
             // arrange
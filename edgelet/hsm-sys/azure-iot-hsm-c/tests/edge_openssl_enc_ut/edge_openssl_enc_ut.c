@@ -30,6 +30,17 @@ static void test_hook_gballoc_free(void* ptr)
     free(ptr);
 }
 
+static void* test_hook_hsm_key_mem_alloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void test_hook_hsm_key_mem_free(void* ptr, size_t size)
+{
+    (void)size;
+    free(ptr);
+}
+
 #include "testrunnerswitcher.h"
 #include "umock_c.h"
 #include "umock_c_negative_tests.h"
@@ -45,6 +56,7 @@ static void test_hook_gballoc_free(void* ptr)
 #define ENABLE_MOCKS
 #include "azure_c_shared_utility/gballoc.h"
 #include "edge_openssl_common.h"
+#include "hsm_key_mem.h"
 
 MOCKABLE_FUNCTION(, int, RAND_bytes, unsigned char*, buf, int, num);
 MOCKABLE_FUNCTION(, EVP_CIPHER_CTX*, EVP_CIPHER_CTX_new);
@@ -361,6 +373,11 @@ BEGIN_TEST_SUITE(edge_openssl_encryption_unittests)
 
         REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, test_hook_gballoc_free);
 
+        REGISTER_GLOBAL_MOCK_HOOK(hsm_key_mem_alloc, test_hook_hsm_key_mem_alloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(hsm_key_mem_alloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(hsm_key_mem_free, test_hook_hsm_key_mem_free);
+
         REGISTER_GLOBAL_MOCK_HOOK(initialize_openssl, test_hook_initialize_openssl);
 
         REGISTER_GLOBAL_MOCK_HOOK(RAND_bytes, test_hook_RAND_bytes);
@@ -546,8 +563,8 @@ BEGIN_TEST_SUITE(edge_openssl_encryption_unittests)
         // arrange
         KEY_HANDLE key_handle;
 
-        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
-        STRICT_EXPECTED_CALL(gballoc_malloc(ENCRYPTION_KEY_SIZE));
+        EXPECTED_CALL(hsm_key_mem_alloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(hsm_key_mem_alloc(ENCRYPTION_KEY_SIZE));
 
         // act
         key_handle = create_encryption_key(TEST_KEY, ENCRYPTION_KEY_SIZE);
@@ -570,8 +587,8 @@ BEGIN_TEST_SUITE(edge_openssl_encryption_unittests)
         int test_result = umock_c_negative_tests_init();
         ASSERT_ARE_EQUAL(int, 0, test_result);
 
-        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
-        STRICT_EXPECTED_CALL(gballoc_malloc(ENCRYPTION_KEY_SIZE));
+        EXPECTED_CALL(hsm_key_mem_alloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(hsm_key_mem_alloc(ENCRYPTION_KEY_SIZE));
 
         umock_c_negative_tests_snapshot();
 
@@ -604,8 +621,8 @@ BEGIN_TEST_SUITE(edge_openssl_encryption_unittests)
         ASSERT_IS_NOT_NULL(key_handle, "Line:" TOSTRING(__LINE__));
         umock_c_reset_all_calls();
 
-        EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(gballoc_free(key_handle));
+        STRICT_EXPECTED_CALL(hsm_key_mem_free(IGNORED_PTR_ARG, ENCRYPTION_KEY_SIZE));
+        STRICT_EXPECTED_CALL(hsm_key_mem_free(key_handle, IGNORED_NUM_ARG));
 
         // act
         key_destroy(key_handle);
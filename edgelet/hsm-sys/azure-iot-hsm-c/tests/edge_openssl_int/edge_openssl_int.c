@@ -301,8 +301,40 @@ void test_helper_server_chain_validator(const PKI_KEY_PROPS *key_props)
     ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
     ASSERT_IS_FALSE(cert_verified, "Line:" TOSTRING(__LINE__));
     ASSERT_ARE_EQUAL(int, 0, cert_verified, "Line:" TOSTRING(__LINE__));
+    size_t server_cert_size = 0, int_ca_cert_size = 0;
+    char *server_cert = read_file_into_cstring(TEST_SERVER_CERT_RSA_FILE_3, &server_cert_size);
+    ASSERT_IS_NOT_NULL(server_cert, "Line:" TOSTRING(__LINE__));
+    char *int_ca_cert = read_file_into_cstring(TEST_CA_CERT_RSA_FILE_2, &int_ca_cert_size);
+    ASSERT_IS_NOT_NULL(int_ca_cert, "Line:" TOSTRING(__LINE__));
+    cert_verified = false;
+    status = verify_certificate_buffer(server_cert, strlen(server_cert), int_ca_cert, strlen(int_ca_cert), &cert_verified);
+    ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+    ASSERT_IS_TRUE(cert_verified, "Line:" TOSTRING(__LINE__));
+    free(server_cert);
+    free(int_ca_cert);
+    const char *batch_certs[] = { TEST_SERVER_CERT_RSA_FILE_3, TEST_CA_CERT_RSA_FILE_2, TEST_SERVER_CERT_RSA_FILE_3 };
+    const char *batch_keys[] = { TEST_SERVER_PK_RSA_FILE_3, TEST_CA_PK_RSA_FILE_2, TEST_CA_PK_RSA_FILE_2 };
+    bool batch_verified[] = { false, false, true };
+    status = verify_certificates(batch_certs, batch_keys, 3, TEST_CA_CERT_RSA_FILE_2, batch_verified, 2);
+    ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+    ASSERT_IS_TRUE(batch_verified[0], "Line:" TOSTRING(__LINE__));
+    ASSERT_IS_TRUE(batch_verified[1], "Line:" TOSTRING(__LINE__));
+    ASSERT_IS_FALSE(batch_verified[2], "Line:" TOSTRING(__LINE__));
+    // the root followed by the intermediate CA chain is a bundle and not one chain,
+    // certificates are verified against it without having to embed it
+    const char *bundle_files[] = { TEST_CA_CERT_RSA_FILE_1, TEST_CA_CERT_RSA_FILE_2 };
+    char *bundle = concat_files_to_cstring(bundle_files, 2);
+    ASSERT_IS_NOT_NULL(bundle, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, write_cstring_to_file(TEST_CHAIN_FILE_PATH, bundle), "Line:" TOSTRING(__LINE__));
+    free(bundle);
+    bool bundle_verified[] = { false, false };
+    status = verify_certificates(batch_certs, NULL, 2, TEST_CHAIN_FILE_PATH, bundle_verified, 2);
+    ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+    ASSERT_IS_TRUE(bundle_verified[0], "Line:" TOSTRING(__LINE__));
+    ASSERT_IS_TRUE(bundle_verified[1], "Line:" TOSTRING(__LINE__));
 
     // cleanup
+    delete_file(TEST_CHAIN_FILE_PATH);
     delete_file(TEST_SERVER_PK_RSA_FILE_3);
     delete_file(TEST_SERVER_CERT_RSA_FILE_3);
     delete_file(TEST_CA_PK_RSA_FILE_2);
@@ -7,9 +7,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stddef.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#include <sys/types.h>
 
 //#############################################################################
 // Memory allocator test hooks
@@ -38,10 +35,12 @@ static void test_hook_gballoc_free(void* ptr)
 #include "testrunnerswitcher.h"
 #include "umock_c.h"
 #include "umock_c_negative_tests.h"
+#include "umocktypes_bool.h"
 #include "umocktypes_charptr.h"
 #include "umocktypes_stdint.h"
 #include <openssl/asn1.h>
 #include <openssl/bio.h>
+#include <openssl/buffer.h>
 #include <openssl/err.h>
 #include <openssl/ec.h>
 #include <openssl/pem.h>
@@ -54,18 +53,6 @@ static void test_hook_gballoc_free(void* ptr)
 // Declare and enable MOCK definitions
 //#############################################################################
 
-#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
-    #include <io.h>
-    typedef int MODE_T;
-    static int EXPECTED_CREATE_FLAGS = _O_CREAT|_O_WRONLY|_O_TRUNC;
-    static int EXPECTED_MODE_FLAGS = _S_IREAD|_S_IWRITE;
-#else
-    #include <unistd.h>
-    typedef mode_t MODE_T;
-    static int EXPECTED_CREATE_FLAGS = O_CREAT|O_WRONLY|O_TRUNC;
-    static int EXPECTED_MODE_FLAGS = S_IRUSR|S_IWUSR;
-#endif
-
 typedef void (*MOCKED_CALLBACK)(int,int,void *);
 
 //#############################################################################
@@ -80,8 +67,6 @@ static char *test_helper_strdup(const char *s);
 
 MOCKABLE_FUNCTION(, EVP_PKEY*, EVP_PKEY_new);
 MOCKABLE_FUNCTION(, void, EVP_PKEY_free, EVP_PKEY*, x);
-MOCKABLE_FUNCTION(, int, mocked_OPEN, const char*, path, int, flags, MODE_T, mode);
-MOCKABLE_FUNCTION(, int, mocked_CLOSE, int, fd);
 MOCKABLE_FUNCTION(, BIGNUM*, BN_new);
 MOCKABLE_FUNCTION(, void, BN_free, BIGNUM*, a);
 MOCKABLE_FUNCTION(, int, BN_set_word, BIGNUM*, a, BN_ULONG, w);
@@ -110,13 +95,22 @@ MOCKABLE_FUNCTION(, int, EC_GROUP_get_curve_name, const EC_GROUP*, group);
     MOCKABLE_FUNCTION(, int, EVP_PKEY_bits, const EVP_PKEY*, pkey);
     MOCKABLE_FUNCTION(, X509_NAME*, X509_get_subject_name, const X509*, a);
     MOCKABLE_FUNCTION(, int, X509_get_ext_by_NID, const X509*, x, int, nid, int, lastpos);
+    MOCKABLE_FUNCTION(, BIO*, BIO_new_mem_buf, const void*, buf, int, len);
+    MOCKABLE_FUNCTION(, const BIO_METHOD*, BIO_s_mem);
+    MOCKABLE_FUNCTION(, BIO*, BIO_new, const BIO_METHOD*, type);
+    MOCKABLE_FUNCTION(, int, X509_check_private_key, const X509*, x509, const EVP_PKEY*, pkey);
 #else
     MOCKABLE_FUNCTION(, int, EVP_PKEY_bits, EVP_PKEY*, pkey);
     MOCKABLE_FUNCTION(, X509_NAME*, X509_get_subject_name, X509*, a);
     MOCKABLE_FUNCTION(, int, X509_get_ext_by_NID, X509*, x, int, nid, int, lastpos);
+    MOCKABLE_FUNCTION(, BIO*, BIO_new_mem_buf, void*, buf, int, len);
+    MOCKABLE_FUNCTION(, BIO_METHOD*, BIO_s_mem);
+    MOCKABLE_FUNCTION(, BIO*, BIO_new, BIO_METHOD*, type);
+    MOCKABLE_FUNCTION(, int, X509_check_private_key, X509*, x509, EVP_PKEY*, pkey);
 #endif
 
 MOCKABLE_FUNCTION(, BIO*, BIO_new_file, const char*, filename, const char*, mode);
+MOCKABLE_FUNCTION(, int, X509_check_issued, X509*, issuer, X509*, subject);
 MOCKABLE_FUNCTION(, int, PEM_X509_INFO_write_bio, BIO*, bp, X509_INFO*, xi, EVP_CIPHER*, enc, unsigned char*, kstr, int, klen, pem_password_cb*, cb, void*, u);
 MOCKABLE_FUNCTION(, int, BIO_write, BIO*, b, const void*, in, int, inl);
 MOCKABLE_FUNCTION(, void, BIO_free_all, BIO*, bio);
@@ -128,7 +122,8 @@ MOCKABLE_FUNCTION(, ASN1_TIME*, mocked_X509_get_notBefore, X509*, x509_cert);
 MOCKABLE_FUNCTION(, ASN1_TIME*, mocked_X509_get_notAfter, X509*, x509_cert);
 MOCKABLE_FUNCTION(, ASN1_TIME*, X509_gmtime_adj, ASN1_TIME*, s, long, adj);
 MOCKABLE_FUNCTION(, time_t, get_utc_time_from_asn_string, const unsigned char*, time_value, size_t, length);
-MOCKABLE_FUNCTION(, BIO*, BIO_new_fd, int, fd, int, close_flag);
+MOCKABLE_FUNCTION(, long, BIO_ctrl, BIO*, bp, int, cmd, long, larg, void*, parg);
+MOCKABLE_FUNCTION(, void, OPENSSL_cleanse, void*, ptr, size_t, len);
 MOCKABLE_FUNCTION(, int, PEM_write_bio_PrivateKey, BIO*, bp, EVP_PKEY*, x, const EVP_CIPHER*, enc, unsigned char*, kstr, int, klen, pem_password_cb*, cb, void*, u);
 MOCKABLE_FUNCTION(, ASN1_INTEGER*, X509_get_serialNumber, X509*, a);
 MOCKABLE_FUNCTION(, BASIC_CONSTRAINTS*, BASIC_CONSTRAINTS_new);
@@ -142,6 +137,7 @@ MOCKABLE_FUNCTION(, X509*, X509_new);
 MOCKABLE_FUNCTION(, void, X509_free, X509*, a);
 MOCKABLE_FUNCTION(, X509_STORE*, X509_STORE_new);
 MOCKABLE_FUNCTION(, void, X509_STORE_free, X509_STORE*, a);
+MOCKABLE_FUNCTION(, int, X509_STORE_up_ref, X509_STORE*, v);
 MOCKABLE_FUNCTION(, const EVP_MD*, EVP_sha256);
 MOCKABLE_FUNCTION(, int, X509_sign, X509*, x, EVP_PKEY*, pkey, const EVP_MD*, md);
 MOCKABLE_FUNCTION(, int, X509_verify, X509*, a, EVP_PKEY*, r);
@@ -149,12 +145,13 @@ MOCKABLE_FUNCTION(, int, X509_verify_cert, X509_STORE_CTX*, ctx);
 MOCKABLE_FUNCTION(, X509_STORE_CTX*, X509_STORE_CTX_new);
 MOCKABLE_FUNCTION(, void, X509_STORE_CTX_free, X509_STORE_CTX*, ctx);
 MOCKABLE_FUNCTION(, int, X509_STORE_set_flags, X509_STORE*, ctx, unsigned long, flags);
-MOCKABLE_FUNCTION(, int, X509_STORE_CTX_get_error, X509_STORE_CTX*, ctx);
-MOCKABLE_FUNCTION(, const char*, X509_verify_cert_error_string, long, n);
-MOCKABLE_FUNCTION(, X509_LOOKUP_METHOD*, X509_LOOKUP_file);
 MOCKABLE_FUNCTION(, X509_LOOKUP*, X509_STORE_add_lookup, X509_STORE*, v, X509_LOOKUP_METHOD*, m);
 MOCKABLE_FUNCTION(, int, X509_LOOKUP_ctrl, X509_LOOKUP*, ctx, int, cmd, const char*, argc, long, argl, char**, ret);
 MOCKABLE_FUNCTION(, X509_LOOKUP_METHOD*, X509_LOOKUP_hash_dir);
+MOCKABLE_FUNCTION(, int, X509_STORE_CTX_get_error, X509_STORE_CTX*, ctx);
+MOCKABLE_FUNCTION(, const char*, X509_verify_cert_error_string, long, n);
+MOCKABLE_FUNCTION(, int, X509_STORE_add_cert, X509_STORE*, ctx, X509*, x);
+MOCKABLE_FUNCTION(, void, ERR_clear_error);
 MOCKABLE_FUNCTION(, X509*, PEM_read_bio_X509, BIO*, bp, X509**, x, pem_password_cb*, cb, void*, u);
 MOCKABLE_FUNCTION(, int, PEM_write_bio_X509, BIO*, bp, X509*, x);
 MOCKABLE_FUNCTION(, int, X509_STORE_CTX_init, X509_STORE_CTX*, ctx, X509_STORE*, store, X509*, x509, struct stack_st_X509*, chain);
@@ -243,7 +240,7 @@ static TEST_MUTEX_HANDLE g_dllByDll;
 #define TEST_BIO_WRITE_KEY (BIO*)0x2010
 #define TEST_BIO_WRITE_CERT (BIO*)0x2011
 #define TEST_ISSUER_EVP_KEY (EVP_PKEY*)0x2012
-#define TEST_FD_BIO (BIO*)0x2013
+#define TEST_BIO_METHOD_MEM (BIO_METHOD*)0x2013
 #define TEST_ASN1_SERIAL_NUM (ASN1_INTEGER*)0x2014
 #define TEST_ASN1_INTEGER (ASN1_INTEGER*)0x2015
 #define TEST_X509_SUBJECT_NAME (X509_NAME*)0x2016
@@ -254,14 +251,11 @@ static TEST_MUTEX_HANDLE g_dllByDll;
 #define TEST_X509_STORE (X509_STORE*)0x2021
 #define TEST_EVP_SHA256_MD (EVP_MD*)0x2022
 #define TEST_STORE_CTXT (X509_STORE_CTX*)0x2023
-#define TEST_X509_LOOKUP_METHOD_FILE (X509_LOOKUP_METHOD*)0x2024
 #define TEST_X509_LOOKUP_METHOD_HASH (X509_LOOKUP_METHOD*)0x2025
-#define TEST_X509_LOOKUP_LOAD_FILE (X509_LOOKUP*)0x2026
 #define TEST_X509_LOOKUP_LOAD_HASH (X509_LOOKUP*)0x2027
 #define TEST_X509_LOOKUP (X509_LOOKUP*)0x2028
 #define TEST_CERT_PROPS_HANDLE (CERT_PROPS_HANDLE)0x2029
-#define TEST_WRITE_PRIVATE_KEY_FD (int)0x2030
-#define TEST_WRITE_CERTIFICATE_FD (int)0x2031
+#define TEST_FILE_BATCH (HSM_FILE_BATCH_HANDLE)0x2030
 #define TEST_NID_EXTENSION (X509_EXTENSION*)0x2032
 #define TEST_UTC_TIME_FROM_ASN1 1000
 #define VALID_ASN1_TIME_STRING_UTC_FORMAT 0x17
@@ -277,6 +271,8 @@ typedef struct VERIFY_CERT_TEST_PARAMS_TAG
     bool force_set_verify_return_value;
     ASN1_TIME *force_set_asn1_time;
     bool skid_set;
+    bool store_cached;
+    bool key_matches;
 } VERIFY_CERT_TEST_PARAMS;
 
 struct SUBJECT_FIELDS_TAG
@@ -388,18 +384,37 @@ char* test_hook_read_file_into_cstring(const char* file_name, size_t *output_buf
     return result;
 }
 
-static int test_hook_mocked_OPEN(const char *pathname, int flags, MODE_T mode)
+static HSM_FILE_BATCH_HANDLE test_hook_file_batch_create(void)
 {
-    (void)pathname;
-    (void)flags;
-    (void)mode;
+    return TEST_FILE_BATCH;
+}
+
+static void test_hook_file_batch_destroy(HSM_FILE_BATCH_HANDLE batch)
+{
+    (void)batch;
+}
+
+static int test_hook_file_batch_add_buffer
+(
+    HSM_FILE_BATCH_HANDLE batch,
+    const char *file_name,
+    const unsigned char *data,
+    size_t data_size,
+    bool make_private
+)
+{
+    (void)batch;
+    (void)file_name;
+    (void)data;
+    (void)data_size;
+    (void)make_private;
 
-    return TEST_WRITE_PRIVATE_KEY_FD;
+    return 0;
 }
 
-static int test_hook_mocked_CLOSE(int fd)
+static int test_hook_file_batch_commit(HSM_FILE_BATCH_HANDLE batch)
 {
-    (void)fd;
+    (void)batch;
 
     return 0;
 }
@@ -571,6 +586,18 @@ static BIO* test_hook_BIO_new_file(const char *filename, const char *mode)
     return TEST_BIO;
 }
 
+#if ((OPENSSL_VERSION_NUMBER & 0xFFF00000L) >= 0x10100000L)
+static BIO* test_hook_BIO_new_mem_buf(const void *buf, int len)
+#else
+static BIO* test_hook_BIO_new_mem_buf(void *buf, int len)
+#endif
+{
+    (void)buf;
+    (void)len;
+
+    return TEST_BIO;
+}
+
 static int test_hook_PEM_X509_INFO_write_bio
 (
     BIO *bp,
@@ -705,12 +732,26 @@ static void* test_hook_read_file_into_buffer
     return data;
 }
 
-static BIO* test_hook_BIO_new_fd(int fd,int close_flag)
+static char g_test_pem_data[] = "-----BEGIN TEST-----";
+static BUF_MEM g_test_pem_buf_mem = { sizeof(g_test_pem_data) - 1, g_test_pem_data, sizeof(g_test_pem_data) };
+
+static long test_hook_BIO_ctrl(BIO *bp, int cmd, long larg, void *parg)
 {
-    (void)fd;
-    (void)close_flag;
+    (void)bp;
+    (void)larg;
 
-    return TEST_FD_BIO;
+    if (cmd == BIO_C_GET_BUF_MEM_PTR)
+    {
+        *(BUF_MEM**)parg = &g_test_pem_buf_mem;
+    }
+
+    return 1;
+}
+
+static void test_hook_OPENSSL_cleanse(void *ptr, size_t len)
+{
+    (void)ptr;
+    (void)len;
 }
 
 static int test_hook_PEM_write_bio_PrivateKey
@@ -882,6 +923,13 @@ static void test_hook_X509_STORE_free(X509_STORE *a)
     (void)a;
 }
 
+static int test_hook_X509_STORE_up_ref(X509_STORE *v)
+{
+    (void)v;
+
+    return 1;
+}
+
 static const EVP_MD* test_hook_EVP_sha256(void)
 {
     return TEST_EVP_SHA256_MD;
@@ -908,6 +956,24 @@ int test_hook_X509_verify_cert(X509_STORE_CTX *ctx)
     return 1;
 }
 
+#if ((OPENSSL_VERSION_NUMBER & 0xFFF00000L) >= 0x10100000L)
+static int test_hook_X509_check_private_key(const X509 *x509, const EVP_PKEY *pkey)
+#else
+static int test_hook_X509_check_private_key(X509 *x509, EVP_PKEY *pkey)
+#endif
+{
+    (void)x509;
+    (void)pkey;
+    return 1;
+}
+
+static int test_hook_X509_check_issued(X509 *issuer, X509 *subject)
+{
+    (void)issuer;
+    (void)subject;
+    return X509_V_OK;
+}
+
 X509_STORE_CTX* test_hook_X509_STORE_CTX_new(void)
 {
     return TEST_STORE_CTXT;
@@ -940,9 +1006,12 @@ static int test_hook_X509_STORE_CTX_get_error(X509_STORE_CTX *ctx)
     return TEST_ERROR_CODE;
 }
 
-static X509_LOOKUP_METHOD* test_hook_X509_LOOKUP_file(void)
+static int test_hook_X509_STORE_add_cert(X509_STORE *ctx, X509 *x)
 {
-    return TEST_X509_LOOKUP_METHOD_FILE;
+    (void)ctx;
+    (void)x;
+
+    return 1;
 }
 
 static X509_LOOKUP* test_hook_X509_STORE_add_lookup(X509_STORE *v, X509_LOOKUP_METHOD *m)
@@ -1137,15 +1206,6 @@ static int test_hook_X509_get_ext_by_NID(X509 *x, int nid, int lastpos)
 //#############################################################################
 // Test helpers
 //#############################################################################
-static bool test_helper_is_windows(void)
-{
-#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
-    return true;
-#else
-    return false;
-#endif
-}
-
 static char *test_helper_strdup(const char *s)
 {
     size_t len = strlen(s);
@@ -1329,7 +1389,14 @@ static void test_helper_cert_create_with_subject
         STRICT_EXPECTED_CALL(BIO_free_all(TEST_BIO));
         ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
         i++;
+    }
+
+    STRICT_EXPECTED_CALL(file_batch_create());
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    failed_function_list[i++] = 1;
 
+    if (!is_self_signed)
+    {
         STRICT_EXPECTED_CALL(X509_get_pubkey(TEST_ISSUER_X509)).SetReturn(TEST_ISSUER_PUB_KEY);
         ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
         failed_function_list[i++] = 1;
@@ -1355,37 +1422,33 @@ static void test_helper_cert_create_with_subject
         i++;
     }
 
-    if (test_helper_is_windows())
-    {
-        STRICT_EXPECTED_CALL(BIO_new_file(TEST_KEY_FILE, "w")).SetReturn(TEST_BIO_WRITE_KEY);
-        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-        failed_function_list[i++] = 1;
-    }
-    else
-    {
-        STRICT_EXPECTED_CALL(mocked_OPEN(TEST_KEY_FILE, EXPECTED_CREATE_FLAGS, EXPECTED_MODE_FLAGS)).SetReturn(TEST_WRITE_PRIVATE_KEY_FD);
-        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-        failed_function_list[i++] = 1;
+    STRICT_EXPECTED_CALL(BIO_s_mem());
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    i++;
 
-        STRICT_EXPECTED_CALL(BIO_new_fd(TEST_WRITE_PRIVATE_KEY_FD, 0)).SetReturn(TEST_BIO_WRITE_KEY);
-        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-        failed_function_list[i++] = 1;
-    }
+    STRICT_EXPECTED_CALL(BIO_new(TEST_BIO_METHOD_MEM)).SetReturn(TEST_BIO_WRITE_KEY);
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    failed_function_list[i++] = 1;
 
     STRICT_EXPECTED_CALL(PEM_write_bio_PrivateKey(TEST_BIO_WRITE_KEY, TEST_EVP_KEY, NULL, NULL, 0, NULL, NULL));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     failed_function_list[i++] = 1;
 
-    STRICT_EXPECTED_CALL(BIO_free_all(TEST_BIO_WRITE_KEY));
+    STRICT_EXPECTED_CALL(BIO_ctrl(TEST_BIO_WRITE_KEY, BIO_C_GET_BUF_MEM_PTR, 0, IGNORED_PTR_ARG));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     i++;
 
-    if (!test_helper_is_windows())
-    {
-        STRICT_EXPECTED_CALL(mocked_CLOSE(TEST_WRITE_PRIVATE_KEY_FD));
-        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-        i++;
-    }
+    STRICT_EXPECTED_CALL(file_batch_add_buffer(TEST_FILE_BATCH, TEST_KEY_FILE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, true));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    failed_function_list[i++] = 1;
+
+    EXPECTED_CALL(OPENSSL_cleanse(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    i++;
+
+    STRICT_EXPECTED_CALL(BIO_free_all(TEST_BIO_WRITE_KEY));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    i++;
 
     STRICT_EXPECTED_CALL(X509_new());
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
@@ -1734,22 +1797,13 @@ static void test_helper_cert_create_with_subject
         failed_function_list[i++] = 1;
     }
 
-    if (test_helper_is_windows())
-    {
-        STRICT_EXPECTED_CALL(BIO_new_file(TEST_CERT_FILE, "w")).SetReturn(TEST_BIO_WRITE_CERT);
-        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-        failed_function_list[i++] = 1;
-    }
-    else
-    {
-        STRICT_EXPECTED_CALL(mocked_OPEN(TEST_CERT_FILE, EXPECTED_CREATE_FLAGS, EXPECTED_MODE_FLAGS)).SetReturn(TEST_WRITE_CERTIFICATE_FD);
-        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-        failed_function_list[i++] = 1;
+    STRICT_EXPECTED_CALL(BIO_s_mem());
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    i++;
 
-        STRICT_EXPECTED_CALL(BIO_new_fd(TEST_WRITE_CERTIFICATE_FD, 0)).SetReturn(TEST_BIO_WRITE_CERT);
-        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-        failed_function_list[i++] = 1;
-    }
+    STRICT_EXPECTED_CALL(BIO_new(TEST_BIO_METHOD_MEM)).SetReturn(TEST_BIO_WRITE_CERT);
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    failed_function_list[i++] = 1;
 
     STRICT_EXPECTED_CALL(PEM_write_bio_X509(TEST_BIO_WRITE_CERT, TEST_X509));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
@@ -1771,16 +1825,21 @@ static void test_helper_cert_create_with_subject
         i++;
     }
 
+    STRICT_EXPECTED_CALL(BIO_ctrl(TEST_BIO_WRITE_CERT, BIO_C_GET_BUF_MEM_PTR, 0, IGNORED_PTR_ARG));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    i++;
+
+    STRICT_EXPECTED_CALL(file_batch_add_buffer(TEST_FILE_BATCH, TEST_CERT_FILE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, true));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    failed_function_list[i++] = 1;
+
     STRICT_EXPECTED_CALL(BIO_free_all(TEST_BIO_WRITE_CERT));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     i++;
 
-    if (!test_helper_is_windows())
-    {
-        STRICT_EXPECTED_CALL(mocked_CLOSE(TEST_WRITE_CERTIFICATE_FD));
-        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-        i++;
-    }
+    STRICT_EXPECTED_CALL(file_batch_commit(TEST_FILE_BATCH));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    failed_function_list[i++] = 1;
 
     STRICT_EXPECTED_CALL(X509_free(TEST_X509));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
@@ -1790,6 +1849,10 @@ static void test_helper_cert_create_with_subject
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     i++;
 
+    STRICT_EXPECTED_CALL(file_batch_destroy(TEST_FILE_BATCH));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    i++;
+
     if (!is_self_signed)
     {
         STRICT_EXPECTED_CALL(X509_free(TEST_ISSUER_X509));
@@ -1816,78 +1879,56 @@ static void test_helper_cert_create
                                          NULL, failed_function_list, failed_function_size);
 }
 
-static void test_helper_load_cert_file
+static void test_helper_create_verification_store
 (
-    const char *file,
-    X509 *set_return,
+    const char *issuer_data,
     size_t *index,
     char *failed_function_list,
     size_t failed_function_size
 )
 {
     size_t i = *index;
+    size_t issuer_data_size = strlen(issuer_data);
 
-    STRICT_EXPECTED_CALL(BIO_new_file(file, "r"));
+    STRICT_EXPECTED_CALL(X509_STORE_new());
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     failed_function_list[i++] = 1;
 
-    STRICT_EXPECTED_CALL(PEM_read_bio_X509(TEST_BIO, NULL, NULL, NULL)).SetReturn(set_return);
+    STRICT_EXPECTED_CALL(BIO_new_mem_buf(IGNORED_PTR_ARG, (int)issuer_data_size));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     failed_function_list[i++] = 1;
 
-    STRICT_EXPECTED_CALL(BIO_free_all(TEST_BIO));
-    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-    i++;
-
-    *index = i;
-}
-
-static void test_helper_verify_certificate
-(
-    VERIFY_CERT_TEST_PARAMS *params,
-    char *failed_function_list,
-    size_t failed_function_size
-)
-{
-    size_t i = 0;
-
-    umock_c_reset_all_calls();
-
-    EXPECTED_CALL(initialize_openssl());
-    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-    i++;
-
-    STRICT_EXPECTED_CALL(read_file_into_cstring(params->cert_file, NULL));
+    STRICT_EXPECTED_CALL(PEM_read_bio_X509(TEST_BIO, NULL, NULL, NULL)).SetReturn(TEST_ISSUER_X509);
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     failed_function_list[i++] = 1;
 
-    STRICT_EXPECTED_CALL(read_file_into_cstring(params->issuer_cert_file, NULL));
+    STRICT_EXPECTED_CALL(X509_STORE_add_cert(TEST_X509_STORE, TEST_ISSUER_X509));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     failed_function_list[i++] = 1;
 
-    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(X509_free(TEST_ISSUER_X509));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     i++;
 
-    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(PEM_read_bio_X509(TEST_BIO, NULL, NULL, NULL)).SetReturn(NULL);
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     i++;
 
-    STRICT_EXPECTED_CALL(X509_STORE_new());
+    STRICT_EXPECTED_CALL(ERR_clear_error());
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-    failed_function_list[i++] = 1;
+    i++;
 
-    EXPECTED_CALL(X509_LOOKUP_file());
+    STRICT_EXPECTED_CALL(BIO_free_all(TEST_BIO));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     i++;
 
-    STRICT_EXPECTED_CALL(X509_STORE_add_lookup(TEST_X509_STORE, TEST_X509_LOOKUP_METHOD_FILE)).SetReturn(TEST_X509_LOOKUP_LOAD_FILE);
-    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-    failed_function_list[i++] = 1;
+    unsigned long policy = X509_V_FLAG_X509_STRICT |
+                           X509_V_FLAG_CHECK_SS_SIGNATURE |
+                           X509_V_FLAG_POLICY_CHECK;
 
-    STRICT_EXPECTED_CALL(X509_LOOKUP_ctrl(TEST_X509_LOOKUP_LOAD_FILE, IGNORED_NUM_ARG, params->issuer_cert_file, X509_FILETYPE_PEM, NULL));
+    STRICT_EXPECTED_CALL(X509_STORE_set_flags(TEST_X509_STORE, policy));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
-    failed_function_list[i++] = 1;
+    i++;
 
     EXPECTED_CALL(X509_LOOKUP_hash_dir());
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
@@ -1901,20 +1942,118 @@ static void test_helper_verify_certificate
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     failed_function_list[i++] = 1;
 
-    test_helper_load_cert_file(TEST_CERT_FILE, TEST_X509, &i, failed_function_list, failed_function_size);
+    // failing to cache the store does not fail the verification
+    STRICT_EXPECTED_CALL(gballoc_malloc(issuer_data_size));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    i++;
 
-    STRICT_EXPECTED_CALL(X509_STORE_CTX_new());
+    STRICT_EXPECTED_CALL(X509_STORE_up_ref(TEST_X509_STORE));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    i++;
+
+    *index = i;
+}
+
+static void test_helper_check_issuer_chain
+(
+    const char *issuer_data,
+    bool is_bundle,
+    size_t *index
+)
+{
+    size_t i = *index;
+
+    STRICT_EXPECTED_CALL(BIO_new_mem_buf(IGNORED_PTR_ARG, (int)strlen(issuer_data)));
+    i++;
+
+    STRICT_EXPECTED_CALL(PEM_read_bio_X509(TEST_BIO, NULL, NULL, NULL)).SetReturn(TEST_ISSUER_X509);
+    i++;
+
+    if (is_bundle)
+    {
+        // the second root was not issued by the first one
+        STRICT_EXPECTED_CALL(PEM_read_bio_X509(TEST_BIO, NULL, NULL, NULL)).SetReturn(TEST_X509);
+        i++;
+
+        STRICT_EXPECTED_CALL(X509_check_issued(TEST_X509, TEST_ISSUER_X509)).SetReturn(X509_V_ERR_SUBJECT_ISSUER_MISMATCH);
+        i++;
+
+        STRICT_EXPECTED_CALL(X509_free(TEST_ISSUER_X509));
+        i++;
+
+        STRICT_EXPECTED_CALL(X509_free(TEST_X509));
+        i++;
+    }
+    else
+    {
+        STRICT_EXPECTED_CALL(PEM_read_bio_X509(TEST_BIO, NULL, NULL, NULL)).SetReturn(NULL);
+        i++;
+
+        STRICT_EXPECTED_CALL(X509_free(TEST_ISSUER_X509));
+        i++;
+    }
+
+    STRICT_EXPECTED_CALL(ERR_clear_error());
+    i++;
+
+    STRICT_EXPECTED_CALL(BIO_free_all(TEST_BIO));
+    i++;
+
+    *index = i;
+}
+
+static void test_helper_get_verification_store
+(
+    bool store_cached,
+    const char *issuer_data,
+    size_t *index,
+    char *failed_function_list,
+    size_t failed_function_size
+)
+{
+    size_t i = *index;
+
+    if (store_cached)
+    {
+        STRICT_EXPECTED_CALL(X509_STORE_up_ref(TEST_X509_STORE));
+        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+        i++;
+    }
+    else
+    {
+        test_helper_create_verification_store(issuer_data, &i, failed_function_list, failed_function_size);
+    }
+
+    *index = i;
+}
+
+static void test_helper_verify_certificate_with_store
+(
+    VERIFY_CERT_TEST_PARAMS *params,
+    const char *cert_data,
+    size_t *index,
+    char *failed_function_list,
+    size_t failed_function_size
+)
+{
+    size_t i = *index;
+
+    STRICT_EXPECTED_CALL(BIO_new_mem_buf(IGNORED_PTR_ARG, (int)strlen(cert_data)));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     failed_function_list[i++] = 1;
 
-    unsigned long policy = X509_V_FLAG_X509_STRICT |
-                           X509_V_FLAG_CHECK_SS_SIGNATURE |
-                           X509_V_FLAG_POLICY_CHECK;
+    STRICT_EXPECTED_CALL(PEM_read_bio_X509(TEST_BIO, NULL, NULL, NULL)).SetReturn(TEST_X509);
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    failed_function_list[i++] = 1;
 
-    STRICT_EXPECTED_CALL(X509_STORE_set_flags(TEST_X509_STORE, policy));
+    STRICT_EXPECTED_CALL(BIO_free_all(TEST_BIO));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     i++;
 
+    STRICT_EXPECTED_CALL(X509_STORE_CTX_new());
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    failed_function_list[i++] = 1;
+
     STRICT_EXPECTED_CALL(X509_STORE_CTX_init(TEST_STORE_CTXT, TEST_X509_STORE, TEST_X509, 0));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     failed_function_list[i++] = 1;
@@ -1953,13 +2092,100 @@ static void test_helper_verify_certificate
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     i++;
 
-    STRICT_EXPECTED_CALL(X509_free(TEST_X509));
+    // the private key is only checked once the certificate itself verified, a key
+    // that cannot be loaded fails the verification and not the call
+    if ((params->key_file != NULL) && params->force_set_verify_return_value)
+    {
+        STRICT_EXPECTED_CALL(BIO_new_file(params->key_file, "r"));
+        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+        i++;
+
+        STRICT_EXPECTED_CALL(PEM_read_bio_PrivateKey(TEST_BIO, NULL, NULL, NULL)).SetReturn(TEST_EVP_KEY);
+        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+        i++;
+
+        STRICT_EXPECTED_CALL(BIO_free_all(TEST_BIO));
+        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+        i++;
+
+        int key_match_value = (params->key_matches) ? 1 : 0;
+        STRICT_EXPECTED_CALL(X509_check_private_key(TEST_X509, TEST_EVP_KEY)).SetReturn(key_match_value);
+        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+        i++;
+
+        STRICT_EXPECTED_CALL(EVP_PKEY_free(TEST_EVP_KEY));
+        ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+        i++;
+    }
+
+    STRICT_EXPECTED_CALL(X509_free(TEST_X509));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     i++;
 
+    *index = i;
+}
+
+static void test_helper_verify_certificate_data
+(
+    VERIFY_CERT_TEST_PARAMS *params,
+    const char *cert_data,
+    const char *issuer_data,
+    size_t *index,
+    char *failed_function_list,
+    size_t failed_function_size
+)
+{
+    size_t i = *index;
+
+    test_helper_get_verification_store(params->store_cached, issuer_data, &i,
+                                       failed_function_list, failed_function_size);
+
+    test_helper_verify_certificate_with_store(params, cert_data, &i,
+                                              failed_function_list, failed_function_size);
+
     STRICT_EXPECTED_CALL(X509_STORE_free(TEST_X509_STORE));
     ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
     i++;
+
+    *index = i;
+}
+
+static void test_helper_verify_certificate
+(
+    VERIFY_CERT_TEST_PARAMS *params,
+    char *failed_function_list,
+    size_t failed_function_size
+)
+{
+    size_t i = 0;
+    // verify_certificate does not check the private key of the certificate
+    VERIFY_CERT_TEST_PARAMS store_params = *params;
+    store_params.key_file = NULL;
+
+    umock_c_reset_all_calls();
+
+    EXPECTED_CALL(initialize_openssl());
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    i++;
+
+    STRICT_EXPECTED_CALL(read_file_into_cstring(params->cert_file, NULL));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    failed_function_list[i++] = 1;
+
+    STRICT_EXPECTED_CALL(read_file_into_cstring(params->issuer_cert_file, NULL));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    failed_function_list[i++] = 1;
+
+    test_helper_verify_certificate_data(&store_params, TEST_VALID_CHAIN_CERT_DATA, TEST_ISSUER_CERT_DATA,
+                                        &i, failed_function_list, failed_function_size);
+
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    i++;
+
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    ASSERT_IS_TRUE((i < failed_function_size), "Line:" TOSTRING(__LINE__));
+    i++;
 }
 
 //#############################################################################
@@ -1975,13 +2201,14 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
         ASSERT_IS_NOT_NULL(g_testByTest);
 
         umock_c_init(test_hook_on_umock_c_error);
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_bool_register_types() );
         ASSERT_ARE_EQUAL(int, 0, umocktypes_charptr_register_types() );
         ASSERT_ARE_EQUAL(int, 0, umocktypes_stdint_register_types() );
 
         REGISTER_UMOCK_ALIAS_TYPE(KEY_HANDLE, void*);
         REGISTER_UMOCK_ALIAS_TYPE(CERT_PROPS_HANDLE, void*);
         REGISTER_UMOCK_ALIAS_TYPE(CERTIFICATE_TYPE, int);
-        REGISTER_UMOCK_ALIAS_TYPE(MODE_T, int);
+        REGISTER_UMOCK_ALIAS_TYPE(HSM_FILE_BATCH_HANDLE, void*);
 
         REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, test_hook_gballoc_malloc);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
@@ -1997,10 +2224,13 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
         REGISTER_GLOBAL_MOCK_HOOK(read_file_into_cstring, test_hook_read_file_into_cstring);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(read_file_into_cstring, NULL);
 
-        REGISTER_GLOBAL_MOCK_HOOK(mocked_OPEN, test_hook_mocked_OPEN);
-        REGISTER_GLOBAL_MOCK_FAIL_RETURN(mocked_OPEN, -1);
-        REGISTER_GLOBAL_MOCK_HOOK(mocked_CLOSE, test_hook_mocked_CLOSE);
-        REGISTER_GLOBAL_MOCK_FAIL_RETURN(mocked_CLOSE, -1);
+        REGISTER_GLOBAL_MOCK_HOOK(file_batch_create, test_hook_file_batch_create);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(file_batch_create, NULL);
+        REGISTER_GLOBAL_MOCK_HOOK(file_batch_destroy, test_hook_file_batch_destroy);
+        REGISTER_GLOBAL_MOCK_HOOK(file_batch_add_buffer, test_hook_file_batch_add_buffer);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(file_batch_add_buffer, 1);
+        REGISTER_GLOBAL_MOCK_HOOK(file_batch_commit, test_hook_file_batch_commit);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(file_batch_commit, 1);
 
         REGISTER_GLOBAL_MOCK_HOOK(EVP_PKEY_new, test_hook_EVP_PKEY_new);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(EVP_PKEY_new, NULL);
@@ -2063,8 +2293,15 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
         REGISTER_GLOBAL_MOCK_HOOK(BIO_new_file, test_hook_BIO_new_file);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(BIO_new_file, NULL);
 
-        REGISTER_GLOBAL_MOCK_HOOK(BIO_new_fd, test_hook_BIO_new_fd);
-        REGISTER_GLOBAL_MOCK_FAIL_RETURN(BIO_new_fd, NULL);
+        REGISTER_GLOBAL_MOCK_HOOK(BIO_new_mem_buf, test_hook_BIO_new_mem_buf);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(BIO_new_mem_buf, NULL);
+
+        REGISTER_GLOBAL_MOCK_RETURN(BIO_s_mem, TEST_BIO_METHOD_MEM);
+        REGISTER_GLOBAL_MOCK_RETURN(BIO_new, TEST_BIO);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(BIO_new, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(BIO_ctrl, test_hook_BIO_ctrl);
+        REGISTER_GLOBAL_MOCK_HOOK(OPENSSL_cleanse, test_hook_OPENSSL_cleanse);
 
         REGISTER_GLOBAL_MOCK_HOOK(PEM_X509_INFO_write_bio, test_hook_PEM_X509_INFO_write_bio);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(PEM_X509_INFO_write_bio, 0);
@@ -2131,6 +2368,8 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
         REGISTER_GLOBAL_MOCK_HOOK(X509_STORE_new, test_hook_X509_STORE_new);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(X509_STORE_new, NULL);
         REGISTER_GLOBAL_MOCK_HOOK(X509_STORE_free, test_hook_X509_STORE_free);
+        REGISTER_GLOBAL_MOCK_HOOK(X509_STORE_up_ref, test_hook_X509_STORE_up_ref);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(X509_STORE_up_ref, 0);
 
         REGISTER_GLOBAL_MOCK_HOOK(EVP_sha256, test_hook_EVP_sha256);
 
@@ -2143,6 +2382,12 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
         REGISTER_GLOBAL_MOCK_HOOK(X509_verify_cert, test_hook_X509_verify_cert);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(X509_verify_cert, 0);
 
+        REGISTER_GLOBAL_MOCK_HOOK(X509_check_private_key, test_hook_X509_check_private_key);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(X509_check_private_key, 0);
+
+        REGISTER_GLOBAL_MOCK_HOOK(X509_check_issued, test_hook_X509_check_issued);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(X509_check_issued, X509_V_ERR_SUBJECT_ISSUER_MISMATCH);
+
         REGISTER_GLOBAL_MOCK_HOOK(X509_STORE_CTX_new, test_hook_X509_STORE_CTX_new);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(X509_STORE_CTX_new, NULL);
         REGISTER_GLOBAL_MOCK_HOOK(X509_STORE_CTX_free, test_hook_X509_STORE_CTX_free);
@@ -2156,8 +2401,8 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
         REGISTER_GLOBAL_MOCK_HOOK(X509_STORE_CTX_get_error, test_hook_X509_STORE_CTX_get_error);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(X509_STORE_CTX_get_error, 0);
 
-        REGISTER_GLOBAL_MOCK_HOOK(X509_LOOKUP_file, test_hook_X509_LOOKUP_file);
-        REGISTER_GLOBAL_MOCK_FAIL_RETURN(X509_LOOKUP_file, NULL);
+        REGISTER_GLOBAL_MOCK_HOOK(X509_STORE_add_cert, test_hook_X509_STORE_add_cert);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(X509_STORE_add_cert, 0);
 
         REGISTER_GLOBAL_MOCK_HOOK(X509_STORE_add_lookup, test_hook_X509_STORE_add_lookup);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(X509_STORE_add_lookup, NULL);
@@ -2236,6 +2481,7 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
 
     TEST_FUNCTION_CLEANUP(TestMethodCleanup)
     {
+        clear_certificate_verification_cache();
         TEST_MUTEX_RELEASE(g_testByTest);
     }
 
@@ -3220,6 +3466,7 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
         params.force_set_verify_return_value = true;
         params.force_set_asn1_time = NULL;
         params.skid_set = true;
+        params.store_cached = false;
 
         test_helper_verify_certificate(&params, failed_function_list, failed_function_size);
         bool verify_status = true;
@@ -3279,6 +3526,7 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
         params.force_set_verify_return_value = false;
         params.force_set_asn1_time = NULL;
         params.skid_set = true;
+        params.store_cached = false;
 
         test_helper_verify_certificate(&params, failed_function_list, failed_function_size);
         bool verify_status = false;
@@ -3312,6 +3560,7 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
         params.force_set_verify_return_value = false;
         params.force_set_asn1_time = &TEST_ASN1_TIME_AFTER_EXPIRED;
         params.skid_set = true;
+        params.store_cached = false;
 
         test_helper_verify_certificate(&params, failed_function_list, failed_function_size);
         bool verify_status = true;
@@ -3344,6 +3593,7 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
         params.force_set_verify_return_value = false;
         params.force_set_asn1_time = NULL;
         params.skid_set = false;
+        params.store_cached = false;
 
         test_helper_verify_certificate(&params, failed_function_list, failed_function_size);
         bool verify_status = true;
@@ -3379,12 +3629,14 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
         params.force_set_verify_return_value = true;
         params.force_set_asn1_time = NULL;
         params.skid_set = true;
+        params.store_cached = false;
 
         test_helper_verify_certificate(&params, failed_function_list, failed_function_size);
         umock_c_negative_tests_snapshot();
 
         for (size_t i = 0; i < umock_c_negative_tests_call_count(); i++)
         {
+            clear_certificate_verification_cache();
             umock_c_negative_tests_reset();
             umock_c_negative_tests_fail_call(i);
 
@@ -3404,4 +3656,406 @@ BEGIN_TEST_SUITE(edge_openssl_pki_unittests)
         umock_c_negative_tests_deinit();
     }
 
+    /**
+     * Test function for API
+     *   verify_certificate
+    */
+    TEST_FUNCTION(verify_certificate_reuses_cached_issuer_store_success)
+    {
+        // arrange
+        size_t failed_function_size = MAX_FAILED_FUNCTION_LIST_SIZE;
+        char failed_function_list[MAX_FAILED_FUNCTION_LIST_SIZE];
+        memset(failed_function_list, 0, failed_function_size);
+        VERIFY_CERT_TEST_PARAMS params;
+
+        params.cert_file = TEST_CERT_FILE;
+        params.key_file = TEST_KEY_FILE;
+        params.issuer_cert_file = TEST_ISSUER_CERT_FILE;
+        params.force_set_verify_return_value = true;
+        params.force_set_asn1_time = NULL;
+        params.skid_set = true;
+        params.store_cached = false;
+        test_helper_verify_certificate(&params, failed_function_list, failed_function_size);
+        bool verify_status = false;
+        int status = verify_certificate(TEST_CERT_FILE, TEST_KEY_FILE, TEST_ISSUER_CERT_FILE, &verify_status);
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(verify_status, "Line:" TOSTRING(__LINE__));
+
+        params.store_cached = true;
+        test_helper_verify_certificate(&params, failed_function_list, failed_function_size);
+        verify_status = false;
+
+        // act
+        status = verify_certificate(TEST_CERT_FILE, TEST_KEY_FILE, TEST_ISSUER_CERT_FILE, &verify_status);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(verify_status, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+    }
+
+    /**
+     * Test function for API
+     *   verify_certificate_buffer
+    */
+    TEST_FUNCTION(verify_certificate_buffer_invalid_parameters_returns_error)
+    {
+        // arrange
+        bool verify_status;
+        int status;
+        size_t cert_size = strlen(TEST_VALID_CHAIN_CERT_DATA);
+        size_t issuer_size = strlen(TEST_ISSUER_CERT_DATA);
+
+        // act, assert
+        verify_status = true;
+        status = verify_certificate_buffer(NULL, cert_size, TEST_ISSUER_CERT_DATA, issuer_size, &verify_status);
+        ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_FALSE(verify_status, "Line:" TOSTRING(__LINE__));
+
+        verify_status = true;
+        status = verify_certificate_buffer(TEST_VALID_CHAIN_CERT_DATA, 0, TEST_ISSUER_CERT_DATA, issuer_size, &verify_status);
+        ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_FALSE(verify_status, "Line:" TOSTRING(__LINE__));
+
+        verify_status = true;
+        status = verify_certificate_buffer(TEST_VALID_CHAIN_CERT_DATA, cert_size, NULL, issuer_size, &verify_status);
+        ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_FALSE(verify_status, "Line:" TOSTRING(__LINE__));
+
+        verify_status = true;
+        status = verify_certificate_buffer(TEST_VALID_CHAIN_CERT_DATA, cert_size, TEST_ISSUER_CERT_DATA, 0, &verify_status);
+        ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_FALSE(verify_status, "Line:" TOSTRING(__LINE__));
+
+        status = verify_certificate_buffer(TEST_VALID_CHAIN_CERT_DATA, cert_size, TEST_ISSUER_CERT_DATA, issuer_size, NULL);
+        ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+    }
+
+    /**
+     * Test function for API
+     *   verify_certificate_buffer
+    */
+    TEST_FUNCTION(verify_certificate_buffer_verifies_true_and_returns_success)
+    {
+        // arrange
+        size_t i = 0;
+        size_t failed_function_size = MAX_FAILED_FUNCTION_LIST_SIZE;
+        char failed_function_list[MAX_FAILED_FUNCTION_LIST_SIZE];
+        memset(failed_function_list, 0, failed_function_size);
+        VERIFY_CERT_TEST_PARAMS params;
+
+        params.cert_file = NULL;
+        params.key_file = NULL;
+        params.issuer_cert_file = NULL;
+        params.force_set_verify_return_value = true;
+        params.force_set_asn1_time = NULL;
+        params.skid_set = true;
+        params.store_cached = false;
+
+        EXPECTED_CALL(initialize_openssl());
+        i++;
+        test_helper_verify_certificate_data(&params, TEST_VALID_CHAIN_CERT_DATA, TEST_ISSUER_CERT_DATA,
+                                            &i, failed_function_list, failed_function_size);
+        bool verify_status = false;
+
+        // act
+        int status = verify_certificate_buffer(TEST_VALID_CHAIN_CERT_DATA,
+                                               strlen(TEST_VALID_CHAIN_CERT_DATA),
+                                               TEST_ISSUER_CERT_DATA,
+                                               strlen(TEST_ISSUER_CERT_DATA),
+                                               &verify_status);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(verify_status, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+    }
+
+    /**
+     * Test function for API
+     *   verify_certificate_buffer
+    */
+    TEST_FUNCTION(verify_certificate_buffer_negative)
+    {
+        // arrange
+        int test_result = umock_c_negative_tests_init();
+        ASSERT_ARE_EQUAL(int, 0, test_result);
+
+        size_t i = 0;
+        size_t failed_function_size = MAX_FAILED_FUNCTION_LIST_SIZE;
+        char failed_function_list[MAX_FAILED_FUNCTION_LIST_SIZE];
+        memset(failed_function_list, 0, failed_function_size);
+        VERIFY_CERT_TEST_PARAMS params;
+
+        params.cert_file = NULL;
+        params.key_file = NULL;
+        params.issuer_cert_file = NULL;
+        params.force_set_verify_return_value = true;
+        params.force_set_asn1_time = NULL;
+        params.skid_set = true;
+        params.store_cached = false;
+
+        EXPECTED_CALL(initialize_openssl());
+        i++;
+        test_helper_verify_certificate_data(&params, TEST_VALID_CHAIN_CERT_DATA, TEST_ISSUER_CERT_DATA,
+                                            &i, failed_function_list, failed_function_size);
+        umock_c_negative_tests_snapshot();
+
+        for (i = 0; i < umock_c_negative_tests_call_count(); i++)
+        {
+            clear_certificate_verification_cache();
+            umock_c_negative_tests_reset();
+            umock_c_negative_tests_fail_call(i);
+
+            bool verify_status;
+            if (failed_function_list[i] == 1)
+            {
+                // act
+                int status = verify_certificate_buffer(TEST_VALID_CHAIN_CERT_DATA,
+                                                       strlen(TEST_VALID_CHAIN_CERT_DATA),
+                                                       TEST_ISSUER_CERT_DATA,
+                                                       strlen(TEST_ISSUER_CERT_DATA),
+                                                       &verify_status);
+
+                // assert
+                ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+                ASSERT_IS_FALSE(verify_status, "Line:" TOSTRING(__LINE__));
+            }
+        }
+
+        //cleanup
+        umock_c_negative_tests_deinit();
+    }
+
+    /**
+     * Test function for API
+     *   verify_certificates
+    */
+    TEST_FUNCTION(verify_certificates_invalid_parameters_returns_error)
+    {
+        // arrange
+        const char *cert_files[] = { TEST_CERT_FILE };
+        const char *key_files[] = { TEST_KEY_FILE };
+        bool verify_status[] = { true };
+        int status;
+
+        // act, assert
+        status = verify_certificates(NULL, key_files, 1, TEST_ISSUER_CERT_FILE, verify_status, 1);
+        ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+        status = verify_certificates(cert_files, key_files, 0, TEST_ISSUER_CERT_FILE, verify_status, 1);
+        ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+        status = verify_certificates(cert_files, key_files, 1, NULL, verify_status, 1);
+        ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+        status = verify_certificates(cert_files, key_files, 1, TEST_ISSUER_CERT_FILE, NULL, 1);
+        ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+        status = verify_certificates(cert_files, key_files, 1, TEST_ISSUER_CERT_FILE, verify_status, 0);
+        ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+    }
+
+    /**
+     * Test function for API
+     *   verify_certificates
+    */
+    TEST_FUNCTION(verify_certificates_builds_store_once_and_returns_success)
+    {
+        // arrange
+        size_t i = 0;
+        size_t failed_function_size = MAX_FAILED_FUNCTION_LIST_SIZE;
+        char failed_function_list[MAX_FAILED_FUNCTION_LIST_SIZE];
+        memset(failed_function_list, 0, failed_function_size);
+        const char *cert_files[] = { TEST_CERT_FILE, TEST_BAD_CHAIN_CERT_FILE, TEST_CERT_FILE };
+        const char *key_files[] = { TEST_KEY_FILE, TEST_KEY_FILE, TEST_KEY_FILE };
+        bool verify_status[] = { false, true, false };
+        VERIFY_CERT_TEST_PARAMS params;
+
+        params.cert_file = TEST_CERT_FILE;
+        params.key_file = TEST_KEY_FILE;
+        params.issuer_cert_file = TEST_ISSUER_CERT_FILE;
+        params.force_set_verify_return_value = true;
+        params.force_set_asn1_time = NULL;
+        params.skid_set = true;
+        params.key_matches = true;
+        params.store_cached = true;
+
+        EXPECTED_CALL(initialize_openssl());
+        i++;
+        STRICT_EXPECTED_CALL(read_file_into_cstring(TEST_ISSUER_CERT_FILE, NULL));
+        i++;
+        test_helper_get_verification_store(false, TEST_ISSUER_CERT_DATA, &i, failed_function_list, failed_function_size);
+        test_helper_check_issuer_chain(TEST_ISSUER_CERT_DATA, false, &i);
+
+        STRICT_EXPECTED_CALL(read_file_into_cstring(TEST_CERT_FILE, NULL));
+        i++;
+        test_helper_verify_certificate_with_store(&params, TEST_VALID_CHAIN_CERT_DATA,
+                                                  &i, failed_function_list, failed_function_size);
+        EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+        i++;
+
+        STRICT_EXPECTED_CALL(read_file_into_cstring(TEST_BAD_CHAIN_CERT_FILE, NULL));
+        i++;
+        EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+        i++;
+
+        STRICT_EXPECTED_CALL(read_file_into_cstring(TEST_CERT_FILE, NULL));
+        i++;
+        test_helper_verify_certificate_with_store(&params, TEST_VALID_CHAIN_CERT_DATA,
+                                                  &i, failed_function_list, failed_function_size);
+        EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+        i++;
+
+        STRICT_EXPECTED_CALL(X509_STORE_free(TEST_X509_STORE));
+        i++;
+
+        EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+        i++;
+
+        // act
+        int status = verify_certificates(cert_files, key_files, 3, TEST_ISSUER_CERT_FILE, verify_status, 1);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(verify_status[0], "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_FALSE(verify_status[1], "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(verify_status[2], "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+    }
+
+    /**
+     * Test function for API
+     *   verify_certificates
+    */
+    TEST_FUNCTION(verify_certificates_unreadable_certificate_returns_error)
+    {
+        // arrange
+        size_t i = 0;
+        size_t failed_function_size = MAX_FAILED_FUNCTION_LIST_SIZE;
+        char failed_function_list[MAX_FAILED_FUNCTION_LIST_SIZE];
+        memset(failed_function_list, 0, failed_function_size);
+        const char *cert_files[] = { TEST_CERT_FILE, "unknown_cert.pem" };
+        const char *key_files[] = { TEST_KEY_FILE, TEST_KEY_FILE };
+        bool verify_status[] = { false, true };
+        VERIFY_CERT_TEST_PARAMS params;
+
+        params.cert_file = TEST_CERT_FILE;
+        params.key_file = TEST_KEY_FILE;
+        params.issuer_cert_file = TEST_ISSUER_CERT_FILE;
+        params.force_set_verify_return_value = true;
+        params.force_set_asn1_time = NULL;
+        params.skid_set = true;
+        params.key_matches = true;
+        params.store_cached = false;
+
+        EXPECTED_CALL(initialize_openssl());
+        i++;
+        STRICT_EXPECTED_CALL(read_file_into_cstring(TEST_ISSUER_CERT_FILE, NULL));
+        i++;
+        test_helper_get_verification_store(false, TEST_ISSUER_CERT_DATA, &i, failed_function_list, failed_function_size);
+        test_helper_check_issuer_chain(TEST_ISSUER_CERT_DATA, false, &i);
+
+        STRICT_EXPECTED_CALL(read_file_into_cstring(TEST_CERT_FILE, NULL));
+        i++;
+        test_helper_verify_certificate_with_store(&params, TEST_VALID_CHAIN_CERT_DATA,
+                                                  &i, failed_function_list, failed_function_size);
+        EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+        i++;
+
+        STRICT_EXPECTED_CALL(read_file_into_cstring("unknown_cert.pem", NULL));
+        i++;
+
+        STRICT_EXPECTED_CALL(X509_STORE_free(TEST_X509_STORE));
+        i++;
+
+        EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+        i++;
+
+        // act
+        int status = verify_certificates(cert_files, key_files, 2, TEST_ISSUER_CERT_FILE, verify_status, 1);
+
+        // assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(verify_status[0], "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_FALSE(verify_status[1], "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+    }
+
+    /**
+     * Test function for API
+     *   verify_certificates
+    */
+    TEST_FUNCTION(verify_certificates_without_keys_against_bundle_returns_success)
+    {
+        // arrange
+        size_t i = 0;
+        size_t failed_function_size = MAX_FAILED_FUNCTION_LIST_SIZE;
+        char failed_function_list[MAX_FAILED_FUNCTION_LIST_SIZE];
+        memset(failed_function_list, 0, failed_function_size);
+        const char *cert_files[] = { TEST_CERT_FILE, TEST_BAD_CHAIN_CERT_FILE };
+        bool verify_status[] = { false, false };
+        VERIFY_CERT_TEST_PARAMS params;
+
+        params.cert_file = TEST_CERT_FILE;
+        params.key_file = NULL;
+        params.issuer_cert_file = TEST_ISSUER_CERT_FILE;
+        params.force_set_verify_return_value = true;
+        params.force_set_asn1_time = NULL;
+        params.skid_set = true;
+        params.key_matches = true;
+        params.store_cached = false;
+
+        EXPECTED_CALL(initialize_openssl());
+        i++;
+        STRICT_EXPECTED_CALL(read_file_into_cstring(TEST_ISSUER_CERT_FILE, NULL));
+        i++;
+        test_helper_get_verification_store(false, TEST_ISSUER_CERT_DATA, &i, failed_function_list, failed_function_size);
+        test_helper_check_issuer_chain(TEST_ISSUER_CERT_DATA, true, &i);
+
+        // certificates are not required to embed a trust bundle
+        STRICT_EXPECTED_CALL(read_file_into_cstring(TEST_CERT_FILE, NULL));
+        i++;
+        test_helper_verify_certificate_with_store(&params, TEST_VALID_CHAIN_CERT_DATA,
+                                                  &i, failed_function_list, failed_function_size);
+        EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+        i++;
+
+        STRICT_EXPECTED_CALL(read_file_into_cstring(TEST_BAD_CHAIN_CERT_FILE, NULL));
+        i++;
+        test_helper_verify_certificate_with_store(&params, TEST_INVALID_CHAIN_CERT_DATA,
+                                                  &i, failed_function_list, failed_function_size);
+        EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+        i++;
+
+        STRICT_EXPECTED_CALL(X509_STORE_free(TEST_X509_STORE));
+        i++;
+
+        EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+        i++;
+
+        // act
+        int status = verify_certificates(cert_files, NULL, 2, TEST_ISSUER_CERT_FILE, verify_status, 1);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(verify_status[0], "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(verify_status[1], "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+    }
+
 END_TEST_SUITE(edge_openssl_pki_unittests)
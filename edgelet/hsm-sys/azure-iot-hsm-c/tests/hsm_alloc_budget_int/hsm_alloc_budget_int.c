@@ -0,0 +1,341 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "test_utils.h"
+#include "azure_c_shared_utility/gballoc.h"
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+#include "hsm_client_data.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+// Allocations each call may make, counted for the library and the shared
+// utilities linked into it. OpenSSL allocates on its own and is not counted.
+// Lower these as allocations are removed from the hot paths, never raise
+// them without knowing why a call allocates more.
+
+// the returned digest, the HMAC output buffer and its handle
+#define SIGN_WITH_IDENTITY_BUDGET 3
+// a sign to derive the key and a sign with it
+#define DERIVE_AND_SIGN_WITH_IDENTITY_BUDGET 6
+// the returned ciphertext
+#define ENCRYPT_DATA_BUDGET 1
+// the returned plaintext
+#define DECRYPT_DATA_BUDGET 1
+#define GET_RANDOM_BYTES_BUDGET 0
+
+// calls measured by each test after a call that warms up caches
+#define TEST_CALLS 100
+
+#define TEST_DATA_TO_BE_SIGNED "The quick brown fox jumped over the lazy dog"
+#define TEST_DERIVED_IDENTITY "somehost.azure-devices.net/devices/some-device-id/modules/some-module-id/primary/1"
+
+static unsigned char TEST_KEY[] = {
+    0x0f, 0xb3, 0xee, 0xa6, 0x51, 0x72, 0xee, 0xf2, 0x2b, 0xd3, 0x7e, 0x3d, 0x6e, 0x53, 0xae, 0x82,
+    0xa0, 0xb1, 0xc9, 0xf3, 0x2c, 0x73, 0x25, 0x59, 0x0e, 0x85, 0x7d, 0x22, 0x2d, 0x04, 0x16, 0x70
+};
+
+static unsigned char TEST_ID[] = {'M', 'O', 'D', 'U', 'L', 'E', '1'};
+static unsigned char TEST_PLAINTEXT[] = {'P', 'L', 'A', 'I', 'N', 'T', 'E', 'X', 'T'};
+static unsigned char TEST_IV[] = {'A', 'B', 'C', 'D', 'E', 'F', 'G'};
+
+static char* TEST_IOTEDGE_HOMEDIR = NULL;
+static char* TEST_IOTEDGE_HOMEDIR_GUID = NULL;
+
+static HSM_CLIENT_HANDLE g_tpm_handle = NULL;
+static HSM_CLIENT_HANDLE g_crypto_handle = NULL;
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+typedef void (*TEST_CALL)(void);
+
+//#############################################################################
+// Test helpers
+//#############################################################################
+
+static void test_helper_setup_homedir(void)
+{
+    TEST_IOTEDGE_HOMEDIR = hsm_test_util_create_temp_dir(&TEST_IOTEDGE_HOMEDIR_GUID);
+    ASSERT_IS_NOT_NULL(TEST_IOTEDGE_HOMEDIR_GUID, "Line:" TOSTRING(__LINE__));
+    ASSERT_IS_NOT_NULL(TEST_IOTEDGE_HOMEDIR, "Line:" TOSTRING(__LINE__));
+
+    printf("Temp dir created: [%s]\r\n", TEST_IOTEDGE_HOMEDIR);
+    hsm_test_util_setenv("IOTEDGE_HOMEDIR", TEST_IOTEDGE_HOMEDIR);
+    printf("IoT Edge home dir set to %s\n", TEST_IOTEDGE_HOMEDIR);
+}
+
+static void test_helper_tear_down_homedir(void)
+{
+    if ((TEST_IOTEDGE_HOMEDIR != NULL) && (TEST_IOTEDGE_HOMEDIR_GUID != NULL))
+    {
+        hsm_test_util_delete_dir(TEST_IOTEDGE_HOMEDIR_GUID);
+        free(TEST_IOTEDGE_HOMEDIR);
+        TEST_IOTEDGE_HOMEDIR = NULL;
+        free(TEST_IOTEDGE_HOMEDIR_GUID);
+        TEST_IOTEDGE_HOMEDIR_GUID = NULL;
+    }
+}
+
+static void test_helper_provision(void)
+{
+    int status;
+
+    status = hsm_client_tpm_init();
+    ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+    g_tpm_handle = hsm_client_tpm_interface()->hsm_client_tpm_create();
+    ASSERT_IS_NOT_NULL(g_tpm_handle, "Line:" TOSTRING(__LINE__));
+    status = hsm_client_tpm_interface()->hsm_client_activate_identity_key(g_tpm_handle, TEST_KEY, sizeof(TEST_KEY));
+    ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+    status = hsm_client_crypto_init();
+    ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+    g_crypto_handle = hsm_client_crypto_interface()->hsm_client_crypto_create();
+    ASSERT_IS_NOT_NULL(g_crypto_handle, "Line:" TOSTRING(__LINE__));
+    status = hsm_client_crypto_interface()->hsm_client_create_master_encryption_key(g_crypto_handle);
+    ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+}
+
+static void test_helper_deprovision(void)
+{
+    (void)hsm_client_crypto_interface()->hsm_client_destroy_master_encryption_key(g_crypto_handle);
+    hsm_client_crypto_interface()->hsm_client_crypto_destroy(g_crypto_handle);
+    g_crypto_handle = NULL;
+    hsm_client_crypto_deinit();
+    hsm_client_tpm_interface()->hsm_client_tpm_destroy(g_tpm_handle);
+    g_tpm_handle = NULL;
+    hsm_client_tpm_deinit();
+}
+
+static uint64_t test_helper_get_allocations(const char* operation_name)
+{
+    uint64_t result = 0;
+    bool found = false;
+    size_t idx;
+    HSM_METRICS* metrics = hsm_get_metrics();
+    ASSERT_IS_NOT_NULL(metrics, "Line:" TOSTRING(__LINE__));
+
+    for (idx = 0; idx < metrics->num_operations; idx++)
+    {
+        if (strcmp(metrics->operations[idx].name, operation_name) == 0)
+        {
+            result = metrics->operations[idx].allocations;
+            found = true;
+        }
+    }
+    hsm_free_metrics(metrics);
+    ASSERT_IS_TRUE(found, "Line:" TOSTRING(__LINE__));
+
+    return result;
+}
+
+// returns the allocations operation_name made per call, rounded up
+static uint64_t test_helper_measure(const char* operation_name, TEST_CALL call)
+{
+    uint64_t before, after;
+    size_t idx;
+
+    call();
+    before = test_helper_get_allocations(operation_name);
+    for (idx = 0; idx < TEST_CALLS; idx++)
+    {
+        call();
+    }
+    after = test_helper_get_allocations(operation_name);
+    printf("%s allocates %.2f blocks per call\r\n", operation_name, (double)(after - before) / TEST_CALLS);
+
+    return (after - before + TEST_CALLS - 1) / TEST_CALLS;
+}
+
+static void test_helper_sign_with_identity(void)
+{
+    unsigned char data[] = TEST_DATA_TO_BE_SIGNED;
+    unsigned char *digest = NULL;
+    size_t digest_size = 0;
+
+    int status = hsm_client_tpm_interface()->hsm_client_sign_with_identity(g_tpm_handle, data, sizeof(data),
+                                                                            &digest, &digest_size);
+    ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+    free(digest);
+}
+
+static void test_helper_derive_and_sign_with_identity(void)
+{
+    unsigned char data[] = TEST_DATA_TO_BE_SIGNED;
+    char identity[] = TEST_DERIVED_IDENTITY;
+    unsigned char *digest = NULL;
+    size_t digest_size = 0;
+
+    int status = hsm_client_tpm_interface()->hsm_client_derive_and_sign_with_identity(g_tpm_handle, data, sizeof(data),
+                                                                                       (unsigned char*)identity, strlen(identity),
+                                                                                       &digest, &digest_size);
+    ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+    free(digest);
+}
+
+static void test_helper_encrypt_data(void)
+{
+    SIZED_BUFFER id = { TEST_ID, sizeof(TEST_ID) };
+    SIZED_BUFFER pt = { TEST_PLAINTEXT, sizeof(TEST_PLAINTEXT) };
+    SIZED_BUFFER iv = { TEST_IV, sizeof(TEST_IV) };
+    SIZED_BUFFER ciphertext = { NULL, 0 };
+
+    int status = hsm_client_crypto_interface()->hsm_client_encrypt_data(g_crypto_handle, &id, &pt, &iv, &ciphertext);
+    ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+    free(ciphertext.buffer);
+}
+
+static SIZED_BUFFER g_ciphertext = { NULL, 0 };
+
+static void test_helper_decrypt_data(void)
+{
+    SIZED_BUFFER id = { TEST_ID, sizeof(TEST_ID) };
+    SIZED_BUFFER iv = { TEST_IV, sizeof(TEST_IV) };
+    SIZED_BUFFER plaintext = { NULL, 0 };
+
+    int status = hsm_client_crypto_interface()->hsm_client_decrypt_data(g_crypto_handle, &id, &g_ciphertext, &iv, &plaintext);
+    ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+    free(plaintext.buffer);
+}
+
+static void test_helper_get_random_bytes(void)
+{
+    unsigned char buffer[32];
+
+    int status = hsm_client_crypto_interface()->hsm_client_get_random_bytes(g_crypto_handle, buffer, sizeof(buffer));
+    ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+}
+
+//#############################################################################
+// Test functions
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_alloc_budget_int_tests)
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+        test_helper_setup_homedir();
+        test_helper_provision();
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        test_helper_deprovision();
+        test_helper_tear_down_homedir();
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+        }
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(hsm_alloc_budget_sign_with_identity)
+    {
+        // act
+        uint64_t allocations = test_helper_measure("tpm.sign_with_identity", test_helper_sign_with_identity);
+
+        // assert
+        ASSERT_IS_TRUE(allocations > 0, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(allocations <= SIGN_WITH_IDENTITY_BUDGET, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_alloc_budget_derive_and_sign_with_identity)
+    {
+        // act
+        uint64_t allocations = test_helper_measure("tpm.derive_and_sign_with_identity", test_helper_derive_and_sign_with_identity);
+
+        // assert
+        ASSERT_IS_TRUE(allocations <= DERIVE_AND_SIGN_WITH_IDENTITY_BUDGET, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_alloc_budget_encrypt_data)
+    {
+        // act
+        uint64_t allocations = test_helper_measure("crypto.encrypt_data", test_helper_encrypt_data);
+
+        // assert
+        ASSERT_IS_TRUE(allocations <= ENCRYPT_DATA_BUDGET, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_alloc_budget_decrypt_data)
+    {
+        // arrange
+        SIZED_BUFFER id = { TEST_ID, sizeof(TEST_ID) };
+        SIZED_BUFFER pt = { TEST_PLAINTEXT, sizeof(TEST_PLAINTEXT) };
+        SIZED_BUFFER iv = { TEST_IV, sizeof(TEST_IV) };
+        int status = hsm_client_crypto_interface()->hsm_client_encrypt_data(g_crypto_handle, &id, &pt, &iv, &g_ciphertext);
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+
+        // act
+        uint64_t allocations = test_helper_measure("crypto.decrypt_data", test_helper_decrypt_data);
+
+        // assert
+        ASSERT_IS_TRUE(allocations <= DECRYPT_DATA_BUDGET, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        free(g_ciphertext.buffer);
+        g_ciphertext.buffer = NULL;
+        g_ciphertext.size = 0;
+    }
+
+    TEST_FUNCTION(hsm_alloc_budget_get_random_bytes)
+    {
+        // act
+        uint64_t allocations = test_helper_measure("crypto.get_random_bytes", test_helper_get_random_bytes);
+
+        // assert
+        ASSERT_IS_TRUE(allocations <= GET_RANDOM_BYTES_BUDGET, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_alloc_budget_reports_peak_bytes)
+    {
+        // arrange
+        size_t idx;
+        bool found = false;
+        HSM_METRICS* metrics;
+        test_helper_sign_with_identity();
+
+        // act
+        metrics = hsm_get_metrics();
+
+        // assert
+        ASSERT_IS_NOT_NULL(metrics, "Line:" TOSTRING(__LINE__));
+        for (idx = 0; idx < metrics->num_operations; idx++)
+        {
+            if (strcmp(metrics->operations[idx].name, "tpm.sign_with_identity") == 0)
+            {
+                // the digest is still held when the call returns
+                ASSERT_IS_TRUE(metrics->operations[idx].max_peak_bytes > 0, "Line:" TOSTRING(__LINE__));
+                ASSERT_IS_TRUE(metrics->operations[idx].allocated_bytes > 0, "Line:" TOSTRING(__LINE__));
+                found = true;
+            }
+        }
+        ASSERT_IS_TRUE(found, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_free_metrics(metrics);
+    }
+
+END_TEST_SUITE(hsm_alloc_budget_int_tests)
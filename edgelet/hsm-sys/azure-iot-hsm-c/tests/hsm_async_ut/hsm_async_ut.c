@@ -0,0 +1,751 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined __linux__
+    #include <unistd.h>
+#endif
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/threadapi.h"
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+
+#include "hsm_client_data.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static HSM_CLIENT_HANDLE TEST_HSM_CLIENT_HANDLE = (HSM_CLIENT_HANDLE)0x1000;
+static CERT_PROPS_HANDLE TEST_CERT_PROPS_HANDLE = (CERT_PROPS_HANDLE)0x1001;
+static CERT_INFO_HANDLE TEST_CERT_INFO_HANDLE = (CERT_INFO_HANDLE)0x1002;
+static unsigned char TEST_IDENTITY[] = { 'i', 'd' };
+static unsigned char TEST_DATA[] = { 'd', 'a', 't', 'a' };
+static unsigned char TEST_IV[] = { 'i', 'v' };
+
+// operations block on the gate while it is closed
+static LOCK_HANDLE g_gate_lock = NULL;
+static COND_HANDLE g_gate_cond = NULL;
+static bool g_gate_open = true;
+
+static CERT_INFO_HANDLE g_certificate_result = NULL;
+static size_t g_operation_calls = 0;
+static size_t g_props_destroyed = 0;
+static size_t g_certificates_destroyed = 0;
+static size_t g_buffers_freed = 0;
+static size_t g_callbacks = 0;
+static size_t g_cancelled_callbacks = 0;
+
+//#############################################################################
+// Mocked functions test hooks
+//#############################################################################
+
+static void test_hook_on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s",
+                   ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+static void pass_gate(void)
+{
+    (void)Lock(g_gate_lock);
+    g_operation_calls++;
+    while (!g_gate_open)
+    {
+        (void)Condition_Wait(g_gate_cond, g_gate_lock, 0);
+    }
+    (void)Unlock(g_gate_lock);
+}
+
+static void set_gate(bool open)
+{
+    (void)Lock(g_gate_lock);
+    g_gate_open = open;
+    (void)Condition_Post(g_gate_cond);
+    (void)Unlock(g_gate_lock);
+}
+
+static int make_output(const SIZED_BUFFER* input, unsigned char** output, size_t* output_size)
+{
+    int result;
+
+    if ((*output = (unsigned char*)malloc(input->size + 1)) == NULL)
+    {
+        result = 1;
+    }
+    else
+    {
+        // the first byte tells the outputs of the two operations apart
+        (*output)[0] = (unsigned char)input->size;
+        memcpy(*output + 1, input->buffer, input->size);
+        *output_size = input->size + 1;
+        result = 0;
+    }
+
+    return result;
+}
+
+static CERT_INFO_HANDLE test_hook_create_certificate(HSM_CLIENT_HANDLE handle, CERT_PROPS_HANDLE certificate_props)
+{
+    ASSERT_ARE_EQUAL(void_ptr, TEST_HSM_CLIENT_HANDLE, handle, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(void_ptr, TEST_CERT_PROPS_HANDLE, certificate_props, "Line:" TOSTRING(__LINE__));
+    pass_gate();
+    return g_certificate_result;
+}
+
+static int test_hook_encrypt_data
+(
+    HSM_CLIENT_HANDLE handle,
+    const SIZED_BUFFER* identity,
+    const SIZED_BUFFER* plaintext,
+    const SIZED_BUFFER* init_vector,
+    SIZED_BUFFER* ciphertext
+)
+{
+    ASSERT_ARE_EQUAL(void_ptr, TEST_HSM_CLIENT_HANDLE, handle, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(size_t, sizeof(TEST_IDENTITY), identity->size, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, memcmp(TEST_IDENTITY, identity->buffer, identity->size), "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(size_t, sizeof(TEST_IV), init_vector->size, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, memcmp(TEST_IV, init_vector->buffer, init_vector->size), "Line:" TOSTRING(__LINE__));
+    pass_gate();
+    return make_output(plaintext, &ciphertext->buffer, &ciphertext->size);
+}
+
+static int test_hook_decrypt_data
+(
+    HSM_CLIENT_HANDLE handle,
+    const SIZED_BUFFER* identity,
+    const SIZED_BUFFER* ciphertext,
+    const SIZED_BUFFER* init_vector,
+    SIZED_BUFFER* plaintext
+)
+{
+    (void)identity;
+    (void)ciphertext;
+    (void)init_vector;
+    (void)plaintext;
+    ASSERT_ARE_EQUAL(void_ptr, TEST_HSM_CLIENT_HANDLE, handle, "Line:" TOSTRING(__LINE__));
+    pass_gate();
+    return 1;
+}
+
+static int test_hook_sign_with_identity
+(
+    HSM_CLIENT_HANDLE handle,
+    const unsigned char* data,
+    size_t data_size,
+    unsigned char** digest,
+    size_t* digest_size
+)
+{
+    SIZED_BUFFER input = { (unsigned char*)data, data_size };
+    ASSERT_ARE_EQUAL(void_ptr, TEST_HSM_CLIENT_HANDLE, handle, "Line:" TOSTRING(__LINE__));
+    pass_gate();
+    return make_output(&input, digest, digest_size);
+}
+
+static int test_hook_derive_and_sign_with_identity
+(
+    HSM_CLIENT_HANDLE handle,
+    const unsigned char* data,
+    size_t data_size,
+    const unsigned char* identity,
+    size_t identity_size,
+    unsigned char** digest,
+    size_t* digest_size
+)
+{
+    SIZED_BUFFER input = { (unsigned char*)identity, identity_size };
+    ASSERT_ARE_EQUAL(void_ptr, TEST_HSM_CLIENT_HANDLE, handle, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(size_t, sizeof(TEST_DATA), data_size, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, memcmp(TEST_DATA, data, data_size), "Line:" TOSTRING(__LINE__));
+    pass_gate();
+    return make_output(&input, digest, digest_size);
+}
+
+static void test_hook_free_buffer(void* buffer)
+{
+    (void)Lock(g_gate_lock);
+    g_buffers_freed++;
+    (void)Unlock(g_gate_lock);
+    free(buffer);
+}
+
+static const HSM_CLIENT_CRYPTO_INTERFACE TEST_CRYPTO_INTERFACE =
+{
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    test_hook_create_certificate,
+    NULL,
+    test_hook_encrypt_data,
+    test_hook_decrypt_data,
+    NULL,
+    test_hook_free_buffer
+};
+
+static const HSM_CLIENT_TPM_INTERFACE TEST_TPM_INTERFACE =
+{
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    test_hook_sign_with_identity,
+    test_hook_derive_and_sign_with_identity,
+    test_hook_free_buffer
+};
+
+const HSM_CLIENT_CRYPTO_INTERFACE* hsm_client_crypto_interface(void)
+{
+    return &TEST_CRYPTO_INTERFACE;
+}
+
+const HSM_CLIENT_TPM_INTERFACE* hsm_client_tpm_interface(void)
+{
+    return &TEST_TPM_INTERFACE;
+}
+
+void cert_properties_destroy(CERT_PROPS_HANDLE handle)
+{
+    ASSERT_ARE_EQUAL(void_ptr, TEST_CERT_PROPS_HANDLE, handle, "Line:" TOSTRING(__LINE__));
+    (void)Lock(g_gate_lock);
+    g_props_destroyed++;
+    (void)Unlock(g_gate_lock);
+}
+
+void certificate_info_destroy(CERT_INFO_HANDLE handle)
+{
+    ASSERT_ARE_EQUAL(void_ptr, TEST_CERT_INFO_HANDLE, handle, "Line:" TOSTRING(__LINE__));
+    (void)Lock(g_gate_lock);
+    g_certificates_destroyed++;
+    (void)Unlock(g_gate_lock);
+}
+
+static void test_callback_count(HSM_ASYNC_TICKET ticket, void* context)
+{
+    (void)context;
+    (void)Lock(g_gate_lock);
+    g_callbacks++;
+    if (ticket == NULL)
+    {
+        g_cancelled_callbacks++;
+    }
+    (void)Unlock(g_gate_lock);
+}
+
+static void test_callback_get_result(HSM_ASYNC_TICKET ticket, void* context)
+{
+    HSM_ASYNC_RESULT* result = (HSM_ASYNC_RESULT*)context;
+    ASSERT_ARE_EQUAL(int, 1, hsm_async_is_complete(ticket), "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, hsm_async_get_result(ticket, result), "Line:" TOSTRING(__LINE__));
+    test_callback_count(ticket, NULL);
+}
+
+//#############################################################################
+// Test helpers
+//#############################################################################
+
+static HSM_ASYNC_TICKET submit_encrypt(HSM_ASYNC_CALLBACK callback, void* context)
+{
+    SIZED_BUFFER identity = { TEST_IDENTITY, sizeof(TEST_IDENTITY) };
+    SIZED_BUFFER plaintext = { TEST_DATA, sizeof(TEST_DATA) };
+    SIZED_BUFFER init_vector = { TEST_IV, sizeof(TEST_IV) };
+
+    return hsm_async_encrypt_data(TEST_HSM_CLIENT_HANDLE, &identity, &plaintext, &init_vector, callback, context);
+}
+
+static size_t read_counter(size_t* counter)
+{
+    size_t result;
+
+    (void)Lock(g_gate_lock);
+    result = *counter;
+    (void)Unlock(g_gate_lock);
+
+    return result;
+}
+
+static void wait_for_operation_calls(size_t expected)
+{
+    (void)Lock(g_gate_lock);
+    while (g_operation_calls < expected)
+    {
+        (void)Unlock(g_gate_lock);
+        ThreadAPI_Sleep(1);
+        (void)Lock(g_gate_lock);
+    }
+    (void)Unlock(g_gate_lock);
+}
+
+//#############################################################################
+// Test cases
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_async_ut)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(test_hook_on_umock_c_error);
+
+        g_gate_lock = Lock_Init();
+        ASSERT_IS_NOT_NULL(g_gate_lock);
+        g_gate_cond = Condition_Init();
+        ASSERT_IS_NOT_NULL(g_gate_cond);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        Condition_Deinit(g_gate_cond);
+        (void)Lock_Deinit(g_gate_lock);
+
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+        }
+
+        umock_c_reset_all_calls();
+        g_gate_open = true;
+        g_certificate_result = TEST_CERT_INFO_HANDLE;
+        g_operation_calls = 0;
+        g_props_destroyed = 0;
+        g_certificates_destroyed = 0;
+        g_buffers_freed = 0;
+        g_callbacks = 0;
+        g_cancelled_callbacks = 0;
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(hsm_async_init_twice_fails)
+    {
+        // arrange
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(1), "Line:" TOSTRING(__LINE__));
+
+        // act
+        int result = hsm_async_init(1);
+
+        // assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_async_deinit();
+    }
+
+    TEST_FUNCTION(hsm_async_init_too_many_threads_fails)
+    {
+        // arrange
+
+        // act
+        int result = hsm_async_init(17);
+
+        // assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, -1, hsm_async_get_event_fd(), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_async_submit_without_init_fails)
+    {
+        // arrange
+
+        // act
+        HSM_ASYNC_TICKET encrypt_ticket = submit_encrypt(NULL, NULL);
+        HSM_ASYNC_TICKET cert_ticket = hsm_async_create_certificate(TEST_HSM_CLIENT_HANDLE, TEST_CERT_PROPS_HANDLE,
+                                                                    NULL, NULL);
+
+        // assert
+        ASSERT_IS_NULL(encrypt_ticket, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(cert_ticket, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, g_props_destroyed, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 0, g_operation_calls, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_async_submit_invalid_params_fails)
+    {
+        // arrange
+        SIZED_BUFFER identity = { TEST_IDENTITY, sizeof(TEST_IDENTITY) };
+        SIZED_BUFFER null_buffer = { NULL, 1 };
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(1), "Line:" TOSTRING(__LINE__));
+
+        // act
+        HSM_ASYNC_TICKET null_handle = hsm_async_sign_with_identity(NULL, TEST_DATA, sizeof(TEST_DATA), NULL, NULL);
+        HSM_ASYNC_TICKET null_input = hsm_async_encrypt_data(TEST_HSM_CLIENT_HANDLE, &identity, NULL, &identity,
+                                                             NULL, NULL);
+        HSM_ASYNC_TICKET null_data = hsm_async_encrypt_data(TEST_HSM_CLIENT_HANDLE, &identity, &null_buffer,
+                                                            &identity, NULL, NULL);
+        HSM_ASYNC_TICKET null_props = hsm_async_create_certificate(TEST_HSM_CLIENT_HANDLE, NULL, NULL, NULL);
+
+        // assert
+        ASSERT_IS_NULL(null_handle, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(null_input, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(null_data, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(null_props, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, hsm_async_get_result(NULL, NULL), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_async_deinit();
+        ASSERT_ARE_EQUAL(size_t, 0, g_operation_calls, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_async_encrypt_data_copies_inputs)
+    {
+        // arrange
+        unsigned char plaintext_buffer[] = { 'a', 'b', 'c' };
+        SIZED_BUFFER identity = { TEST_IDENTITY, sizeof(TEST_IDENTITY) };
+        SIZED_BUFFER plaintext = { plaintext_buffer, sizeof(plaintext_buffer) };
+        SIZED_BUFFER init_vector = { TEST_IV, sizeof(TEST_IV) };
+        HSM_ASYNC_RESULT result;
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(1), "Line:" TOSTRING(__LINE__));
+        set_gate(false);
+
+        // act
+        HSM_ASYNC_TICKET ticket = hsm_async_encrypt_data(TEST_HSM_CLIENT_HANDLE, &identity, &plaintext,
+                                                         &init_vector, NULL, NULL);
+        memset(plaintext_buffer, 'x', sizeof(plaintext_buffer));
+        set_gate(true);
+        int status = hsm_async_get_result(ticket, &result);
+
+        // assert
+        ASSERT_IS_NOT_NULL(ticket, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, result.result, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(result.certificate, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 4, result.output.size, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, memcmp("\3abc", result.output.buffer, 4), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_async_deinit();
+        free(result.output.buffer);
+    }
+
+    TEST_FUNCTION(hsm_async_decrypt_data_failure_sets_result)
+    {
+        // arrange
+        SIZED_BUFFER input = { TEST_DATA, sizeof(TEST_DATA) };
+        HSM_ASYNC_RESULT result;
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(1), "Line:" TOSTRING(__LINE__));
+
+        // act
+        HSM_ASYNC_TICKET ticket = hsm_async_decrypt_data(TEST_HSM_CLIENT_HANDLE, &input, &input, &input,
+                                                         NULL, NULL);
+        int status = hsm_async_get_result(ticket, &result);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, result.result, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(result.output.buffer, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_async_deinit();
+    }
+
+    TEST_FUNCTION(hsm_async_sign_with_identity_uses_tpm_interface)
+    {
+        // arrange
+        HSM_ASYNC_RESULT result;
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(0), "Line:" TOSTRING(__LINE__));
+
+        // act
+        HSM_ASYNC_TICKET ticket = hsm_async_sign_with_identity(TEST_HSM_CLIENT_HANDLE, TEST_DATA, sizeof(TEST_DATA),
+                                                               NULL, NULL);
+        int status = hsm_async_get_result(ticket, &result);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, result.result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, sizeof(TEST_DATA) + 1, result.output.size, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, memcmp(TEST_DATA, result.output.buffer + 1, sizeof(TEST_DATA)), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_async_deinit();
+        free(result.output.buffer);
+    }
+
+    TEST_FUNCTION(hsm_async_derive_and_sign_with_identity_passes_identity)
+    {
+        // arrange
+        HSM_ASYNC_RESULT result;
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(0), "Line:" TOSTRING(__LINE__));
+
+        // act
+        HSM_ASYNC_TICKET ticket = hsm_async_derive_and_sign_with_identity(TEST_HSM_CLIENT_HANDLE,
+                                                                          TEST_DATA, sizeof(TEST_DATA),
+                                                                          TEST_IDENTITY, sizeof(TEST_IDENTITY),
+                                                                          NULL, NULL);
+        int status = hsm_async_get_result(ticket, &result);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, result.result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, sizeof(TEST_IDENTITY) + 1, result.output.size, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, memcmp(TEST_IDENTITY, result.output.buffer + 1, sizeof(TEST_IDENTITY)), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_async_deinit();
+        free(result.output.buffer);
+    }
+
+    TEST_FUNCTION(hsm_async_create_certificate_returns_certificate)
+    {
+        // arrange
+        HSM_ASYNC_RESULT result;
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(0), "Line:" TOSTRING(__LINE__));
+
+        // act
+        HSM_ASYNC_TICKET ticket = hsm_async_create_certificate(TEST_HSM_CLIENT_HANDLE, TEST_CERT_PROPS_HANDLE,
+                                                               NULL, NULL);
+        int status = hsm_async_get_result(ticket, &result);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, result.result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(void_ptr, TEST_CERT_INFO_HANDLE, result.certificate, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, g_props_destroyed, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_async_deinit();
+    }
+
+    TEST_FUNCTION(hsm_async_create_certificate_failure_sets_result)
+    {
+        // arrange
+        HSM_ASYNC_RESULT result;
+        g_certificate_result = NULL;
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(0), "Line:" TOSTRING(__LINE__));
+
+        // act
+        HSM_ASYNC_TICKET ticket = hsm_async_create_certificate(TEST_HSM_CLIENT_HANDLE, TEST_CERT_PROPS_HANDLE,
+                                                               NULL, NULL);
+        int status = hsm_async_get_result(ticket, &result);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, result.result, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(result.certificate, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, g_props_destroyed, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_async_deinit();
+    }
+
+    TEST_FUNCTION(hsm_async_callback_may_get_result)
+    {
+        // arrange
+        HSM_ASYNC_RESULT result;
+        memset(&result, 0, sizeof(result));
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(1), "Line:" TOSTRING(__LINE__));
+
+        // act
+        HSM_ASYNC_TICKET ticket = submit_encrypt(test_callback_get_result, &result);
+        hsm_async_deinit();
+
+        // assert
+        ASSERT_IS_NOT_NULL(ticket, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, g_callbacks, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, result.result, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NOT_NULL(result.output.buffer, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        free(result.output.buffer);
+    }
+
+#if defined __linux__
+    TEST_FUNCTION(hsm_async_event_fd_counts_completions)
+    {
+        // arrange
+        HSM_ASYNC_TICKET tickets[3];
+        HSM_ASYNC_RESULT result;
+        uint64_t count = 0;
+        size_t idx;
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(2), "Line:" TOSTRING(__LINE__));
+        int event_fd = hsm_async_get_event_fd();
+        ASSERT_ARE_NOT_EQUAL(int, -1, event_fd, "Line:" TOSTRING(__LINE__));
+
+        // act
+        for (idx = 0; idx < 3; idx++)
+        {
+            tickets[idx] = submit_encrypt(NULL, NULL);
+        }
+        for (idx = 0; idx < 3; idx++)
+        {
+            ASSERT_ARE_EQUAL(int, 0, hsm_async_get_result(tickets[idx], &result), "Line:" TOSTRING(__LINE__));
+            free(result.output.buffer);
+        }
+        ssize_t read_size = read(event_fd, &count, sizeof(count));
+
+        // assert
+        ASSERT_ARE_EQUAL(int, (int)sizeof(count), (int)read_size, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(count == 3, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_async_deinit();
+    }
+
+    TEST_FUNCTION(hsm_async_event_fd_counts_cancelled_operations)
+    {
+        // arrange
+        HSM_ASYNC_RESULT result;
+        uint64_t count = 0;
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(1), "Line:" TOSTRING(__LINE__));
+        int event_fd = hsm_async_get_event_fd();
+        set_gate(false);
+        HSM_ASYNC_TICKET running = submit_encrypt(NULL, NULL);
+        HSM_ASYNC_TICKET queued = submit_encrypt(test_callback_count, NULL);
+        wait_for_operation_calls(1);
+
+        // act
+        hsm_async_cancel(queued);
+        set_gate(true);
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_get_result(running, &result), "Line:" TOSTRING(__LINE__));
+        while (read_counter(&g_cancelled_callbacks) == 0)
+        {
+            ThreadAPI_Sleep(1);
+        }
+        ssize_t read_size = read(event_fd, &count, sizeof(count));
+
+        // assert
+        ASSERT_ARE_EQUAL(int, (int)sizeof(count), (int)read_size, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(count == 2, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, g_operation_calls, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        free(result.output.buffer);
+        hsm_async_deinit();
+    }
+#endif
+
+    TEST_FUNCTION(hsm_async_cancel_queued_operation_drops_it_and_notifies)
+    {
+        // arrange
+        HSM_ASYNC_RESULT result;
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(1), "Line:" TOSTRING(__LINE__));
+        set_gate(false);
+        HSM_ASYNC_TICKET running = submit_encrypt(test_callback_count, NULL);
+        HSM_ASYNC_TICKET queued = hsm_async_create_certificate(TEST_HSM_CLIENT_HANDLE, TEST_CERT_PROPS_HANDLE,
+                                                               test_callback_count, NULL);
+        wait_for_operation_calls(1);
+
+        // act
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_is_complete(queued), "Line:" TOSTRING(__LINE__));
+        hsm_async_cancel(queued);
+        set_gate(true);
+        int status = hsm_async_get_result(running, &result);
+        hsm_async_deinit();
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, status, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, g_operation_calls, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 2, g_callbacks, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, g_cancelled_callbacks, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, g_props_destroyed, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        free(result.output.buffer);
+    }
+
+    TEST_FUNCTION(hsm_async_cancel_running_operation_frees_outputs_and_notifies)
+    {
+        // arrange
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(1), "Line:" TOSTRING(__LINE__));
+        set_gate(false);
+        HSM_ASYNC_TICKET ticket = hsm_async_create_certificate(TEST_HSM_CLIENT_HANDLE, TEST_CERT_PROPS_HANDLE,
+                                                               test_callback_count, NULL);
+        wait_for_operation_calls(1);
+
+        // act
+        hsm_async_cancel(ticket);
+        set_gate(true);
+        hsm_async_deinit();
+
+        // assert
+        ASSERT_ARE_EQUAL(size_t, 1, g_callbacks, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, g_cancelled_callbacks, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, g_certificates_destroyed, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, g_props_destroyed, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_async_cancel_completed_operation_frees_outputs)
+    {
+        // arrange
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(1), "Line:" TOSTRING(__LINE__));
+        HSM_ASYNC_TICKET ticket = submit_encrypt(NULL, NULL);
+        while (!hsm_async_is_complete(ticket))
+        {
+            ThreadAPI_Sleep(1);
+        }
+
+        // act
+        hsm_async_cancel(ticket);
+
+        // assert
+        ASSERT_ARE_EQUAL(size_t, 1, read_counter(&g_buffers_freed), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_async_deinit();
+    }
+
+    TEST_FUNCTION(hsm_async_deinit_waits_for_cancelled_operations)
+    {
+        // arrange
+        HSM_ASYNC_RESULT result;
+        size_t idx;
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_init(2), "Line:" TOSTRING(__LINE__));
+        set_gate(false);
+        for (idx = 0; idx < 8; idx++)
+        {
+            HSM_ASYNC_TICKET ticket = submit_encrypt(test_callback_count, NULL);
+            ASSERT_IS_NOT_NULL(ticket, "Line:" TOSTRING(__LINE__));
+            hsm_async_cancel(ticket);
+        }
+        HSM_ASYNC_TICKET last = submit_encrypt(test_callback_count, NULL);
+        set_gate(true);
+        ASSERT_ARE_EQUAL(int, 0, hsm_async_get_result(last, &result), "Line:" TOSTRING(__LINE__));
+
+        // act
+        hsm_async_deinit();
+
+        // assert
+        ASSERT_ARE_EQUAL(size_t, 9, g_callbacks, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 8, g_cancelled_callbacks, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(g_operation_calls >= 1, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, g_operation_calls - 1, g_buffers_freed, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        free(result.output.buffer);
+    }
+
+END_TEST_SUITE(hsm_async_ut)
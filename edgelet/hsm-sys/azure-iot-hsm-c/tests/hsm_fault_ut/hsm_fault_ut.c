@@ -0,0 +1,473 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "test_utils.h"
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+
+#include "hsm_client_data.h"
+#include "hsm_client_store.h"
+#include "hsm_fault.h"
+#include "hsm_metrics.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+
+#define TEST_LATENCY_US 20000
+#define TEST_WRITE_SIZE 100
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static HSM_CLIENT_HANDLE TEST_HSM_CLIENT_HANDLE = (HSM_CLIENT_HANDLE)0x1000;
+static HSM_CLIENT_STORE_HANDLE TEST_STORE_HANDLE = (HSM_CLIENT_STORE_HANDLE)0x1001;
+static int g_target_calls = 0;
+
+//#############################################################################
+// Mocked functions test hooks
+//#############################################################################
+
+static void test_hook_on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s",
+                   ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+static int test_hook_sign_with_identity
+(
+    HSM_CLIENT_HANDLE handle,
+    const unsigned char* data,
+    size_t data_size,
+    unsigned char** digest,
+    size_t* digest_size
+)
+{
+    (void)data;
+    (void)data_size;
+    ASSERT_ARE_EQUAL(void_ptr, TEST_HSM_CLIENT_HANDLE, handle, "Line:" TOSTRING(__LINE__));
+    *digest = NULL;
+    *digest_size = 0;
+    g_target_calls++;
+    return 0;
+}
+
+static void test_hook_free_buffer(void* buffer)
+{
+    (void)buffer;
+    g_target_calls++;
+}
+
+static HSM_CLIENT_STORE_HANDLE test_hook_store_open(const char* store_name)
+{
+    (void)store_name;
+    g_target_calls++;
+    return TEST_STORE_HANDLE;
+}
+
+static int test_hook_store_close(HSM_CLIENT_STORE_HANDLE handle)
+{
+    ASSERT_ARE_EQUAL(void_ptr, TEST_STORE_HANDLE, handle, "Line:" TOSTRING(__LINE__));
+    g_target_calls++;
+    return 0;
+}
+
+static int test_hook_store_insert_encryption_key(HSM_CLIENT_STORE_HANDLE handle, const char* key_name)
+{
+    (void)key_name;
+    ASSERT_ARE_EQUAL(void_ptr, TEST_STORE_HANDLE, handle, "Line:" TOSTRING(__LINE__));
+    g_target_calls++;
+    return 0;
+}
+
+static const HSM_CLIENT_TPM_INTERFACE TEST_TPM_INTERFACE =
+{
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    test_hook_sign_with_identity,
+    NULL,
+    test_hook_free_buffer
+};
+
+static const HSM_CLIENT_STORE_INTERFACE TEST_STORE_INTERFACE =
+{
+    NULL,
+    NULL,
+    test_hook_store_open,
+    test_hook_store_close,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    test_hook_store_insert_encryption_key,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+//#############################################################################
+// Test helpers
+//#############################################################################
+
+static HSM_FAULT_CONFIG make_config(double error_rate, uint32_t latency_us, double partial_write_rate)
+{
+    HSM_FAULT_CONFIG config;
+
+    memset(&config, 0, sizeof(config));
+    config.error_rate = error_rate;
+    config.min_latency_us = latency_us;
+    config.max_latency_us = latency_us;
+    config.partial_write_rate = partial_write_rate;
+
+    return config;
+}
+
+//#############################################################################
+// Test cases
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_fault_ut)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(test_hook_on_umock_c_error);
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_charptr_register_types());
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+        }
+
+        umock_c_reset_all_calls();
+        hsm_test_util_unsetenv("IOTEDGE_HSM_FAULT_STORE");
+        hsm_test_util_unsetenv("IOTEDGE_HSM_FAULT_TPM");
+        hsm_test_util_unsetenv("IOTEDGE_HSM_FAULT_FILE_WRITE");
+        hsm_fault_reset();
+        g_target_calls = 0;
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        hsm_fault_reset();
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(hsm_fault_parse_config_reads_every_setting)
+    {
+        // arrange
+        HSM_FAULT_CONFIG config;
+
+        // act
+        int result = hsm_fault_parse_config("latency_us=200-800,tail_rate=0.01,tail_us=50000,"
+                                            "error_rate=0.5,partial_write_rate=.25", &config);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(uint32_t, 200, config.min_latency_us, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(uint32_t, 800, config.max_latency_us, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(uint32_t, 50000, config.tail_latency_us, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(config.tail_rate == 0.01, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(config.error_rate == 0.5, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(config.partial_write_rate == 0.25, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_parse_config_single_latency_is_fixed)
+    {
+        // arrange
+        HSM_FAULT_CONFIG config;
+
+        // act
+        int result = hsm_fault_parse_config("latency_us=300", &config);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(uint32_t, 300, config.min_latency_us, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(uint32_t, 300, config.max_latency_us, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(config.error_rate == 0.0, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_parse_config_rejects_invalid_settings)
+    {
+        // arrange
+        static const char* const invalid_settings[] =
+        {
+            "latency_us",
+            "latency_us=",
+            "latency_us=-1",
+            "latency_us=800-200",
+            "latency_us=100-",
+            "latency_us=4294967296",
+            "tail_us=10ms",
+            "error_rate=1.5",
+            "error_rate=-0.5",
+            "partial_write_rate=half",
+            "error_rate=0.1,,tail_rate=0.1",
+            "unknown=1"
+        };
+        HSM_FAULT_CONFIG config;
+        size_t idx;
+
+        for (idx = 0; idx < sizeof(invalid_settings) / sizeof(invalid_settings[0]); idx++)
+        {
+            // act
+            int result = hsm_fault_parse_config(invalid_settings[idx], &config);
+
+            // assert
+            ASSERT_ARE_NOT_EQUAL(int, 0, result, invalid_settings[idx]);
+        }
+        ASSERT_ARE_NOT_EQUAL(int, 0, hsm_fault_parse_config(NULL, &config), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, hsm_fault_parse_config("", NULL), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_configure_rejects_invalid_parameters)
+    {
+        // arrange
+        HSM_FAULT_CONFIG config = make_config(0.0, 10, 0.0);
+        config.min_latency_us = 20;
+
+        // act, assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, hsm_fault_configure(HSM_FAULT_NUM_TARGETS, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, hsm_fault_configure(HSM_FAULT_STORE, &config), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_interfaces_without_target_return_null)
+    {
+        // act, assert
+        ASSERT_IS_NULL(hsm_fault_tpm_interface(NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(hsm_fault_store_interface(NULL), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_without_faults_forwards_calls)
+    {
+        // arrange
+        const HSM_CLIENT_STORE_INTERFACE* store_if = hsm_fault_store_interface(&TEST_STORE_INTERFACE);
+        const HSM_CLIENT_TPM_INTERFACE* tpm_if = hsm_fault_tpm_interface(&TEST_TPM_INTERFACE);
+        unsigned char data[] = { 'a' };
+        unsigned char* digest;
+        size_t digest_size;
+        size_t write_size = TEST_WRITE_SIZE;
+        ASSERT_IS_NOT_NULL(store_if, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NOT_NULL(tpm_if, "Line:" TOSTRING(__LINE__));
+
+        // act
+        HSM_CLIENT_STORE_HANDLE store_handle = store_if->hsm_client_store_open("store");
+        int insert_result = store_if->hsm_client_store_insert_encryption_key(store_handle, "key");
+        int sign_result = tpm_if->hsm_client_sign_with_identity(TEST_HSM_CLIENT_HANDLE, data, sizeof(data),
+                                                                &digest, &digest_size);
+        int write_result = hsm_fault_file_write(&write_size);
+
+        // assert
+        ASSERT_ARE_EQUAL(void_ptr, TEST_STORE_HANDLE, store_handle, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, insert_result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, sign_result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, write_result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, TEST_WRITE_SIZE, write_size, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 3, g_target_calls, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_errors_fail_store_calls_before_the_backend)
+    {
+        // arrange
+        const HSM_CLIENT_STORE_INTERFACE* store_if = hsm_fault_store_interface(&TEST_STORE_INTERFACE);
+        HSM_FAULT_CONFIG config = make_config(1.0, 0, 0.0);
+        ASSERT_ARE_EQUAL(int, 0, hsm_fault_configure(HSM_FAULT_STORE, &config), "Line:" TOSTRING(__LINE__));
+
+        // act
+        HSM_CLIENT_STORE_HANDLE store_handle = store_if->hsm_client_store_open("store");
+        int insert_result = store_if->hsm_client_store_insert_encryption_key(TEST_STORE_HANDLE, "key");
+        int close_result = store_if->hsm_client_store_close(TEST_STORE_HANDLE);
+
+        // assert
+        ASSERT_IS_NULL(store_handle, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, insert_result, "Line:" TOSTRING(__LINE__));
+        // releasing a handle is never failed
+        ASSERT_ARE_EQUAL(int, 0, close_result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 1, g_target_calls, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_errors_fail_tpm_calls_before_the_backend)
+    {
+        // arrange
+        const HSM_CLIENT_TPM_INTERFACE* tpm_if = hsm_fault_tpm_interface(&TEST_TPM_INTERFACE);
+        HSM_FAULT_CONFIG config = make_config(1.0, 0, 0.0);
+        unsigned char data[] = { 'a' };
+        unsigned char* digest;
+        size_t digest_size;
+        ASSERT_ARE_EQUAL(int, 0, hsm_fault_configure(HSM_FAULT_TPM, &config), "Line:" TOSTRING(__LINE__));
+
+        // act
+        int sign_result = tpm_if->hsm_client_sign_with_identity(TEST_HSM_CLIENT_HANDLE, data, sizeof(data),
+                                                                &digest, &digest_size);
+        tpm_if->hsm_client_free_buffer(NULL);
+
+        // assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, sign_result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 1, g_target_calls, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_latency_delays_tpm_calls)
+    {
+        // arrange
+        const HSM_CLIENT_TPM_INTERFACE* tpm_if = hsm_fault_tpm_interface(&TEST_TPM_INTERFACE);
+        HSM_FAULT_CONFIG config = make_config(0.0, TEST_LATENCY_US, 0.0);
+        unsigned char data[] = { 'a' };
+        unsigned char* digest;
+        size_t digest_size;
+        uint64_t start;
+        ASSERT_ARE_EQUAL(int, 0, hsm_fault_configure(HSM_FAULT_TPM, &config), "Line:" TOSTRING(__LINE__));
+
+        // act
+        start = hsm_metrics_now();
+        int sign_result = tpm_if->hsm_client_sign_with_identity(TEST_HSM_CLIENT_HANDLE, data, sizeof(data),
+                                                                &digest, &digest_size);
+        uint64_t elapsed_ns = hsm_metrics_now() - start;
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, sign_result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 1, g_target_calls, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(elapsed_ns >= (uint64_t)TEST_LATENCY_US * 1000, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_tail_latency_replaces_the_latency_range)
+    {
+        // arrange
+        const HSM_CLIENT_STORE_INTERFACE* store_if = hsm_fault_store_interface(&TEST_STORE_INTERFACE);
+        HSM_FAULT_CONFIG config = make_config(0.0, 0, 0.0);
+        uint64_t start;
+        config.tail_rate = 1.0;
+        config.tail_latency_us = TEST_LATENCY_US;
+        ASSERT_ARE_EQUAL(int, 0, hsm_fault_configure(HSM_FAULT_STORE, &config), "Line:" TOSTRING(__LINE__));
+
+        // act
+        start = hsm_metrics_now();
+        int close_result = store_if->hsm_client_store_close(TEST_STORE_HANDLE);
+        uint64_t elapsed_ns = hsm_metrics_now() - start;
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, close_result, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(elapsed_ns >= (uint64_t)TEST_LATENCY_US * 1000, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_file_write_errors_write_nothing)
+    {
+        // arrange
+        HSM_FAULT_CONFIG config = make_config(1.0, 0, 0.0);
+        size_t write_size = TEST_WRITE_SIZE;
+        ASSERT_ARE_EQUAL(int, 0, hsm_fault_configure(HSM_FAULT_FILE_WRITE, &config), "Line:" TOSTRING(__LINE__));
+
+        // act
+        int result = hsm_fault_file_write(&write_size);
+
+        // assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 0, write_size, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_file_write_partial_writes_stop_partway)
+    {
+        // arrange
+        HSM_FAULT_CONFIG config = make_config(0.0, 0, 1.0);
+        int idx;
+        ASSERT_ARE_EQUAL(int, 0, hsm_fault_configure(HSM_FAULT_FILE_WRITE, &config), "Line:" TOSTRING(__LINE__));
+
+        for (idx = 0; idx < 100; idx++)
+        {
+            size_t write_size = TEST_WRITE_SIZE;
+
+            // act
+            int result = hsm_fault_file_write(&write_size);
+
+            // assert
+            ASSERT_ARE_NOT_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_TRUE(write_size < TEST_WRITE_SIZE, "Line:" TOSTRING(__LINE__));
+        }
+    }
+
+    TEST_FUNCTION(hsm_fault_configure_null_stops_faults)
+    {
+        // arrange
+        HSM_FAULT_CONFIG config = make_config(1.0, 0, 0.0);
+        size_t write_size = TEST_WRITE_SIZE;
+        ASSERT_ARE_EQUAL(int, 0, hsm_fault_configure(HSM_FAULT_FILE_WRITE, &config), "Line:" TOSTRING(__LINE__));
+
+        // act
+        int configure_result = hsm_fault_configure(HSM_FAULT_FILE_WRITE, NULL);
+        int write_result = hsm_fault_file_write(&write_size);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, configure_result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, write_result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, TEST_WRITE_SIZE, write_size, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_env_configures_faults)
+    {
+        // arrange
+        const HSM_CLIENT_STORE_INTERFACE* store_if = hsm_fault_store_interface(&TEST_STORE_INTERFACE);
+        size_t write_size = TEST_WRITE_SIZE;
+        hsm_test_util_setenv("IOTEDGE_HSM_FAULT_STORE", "error_rate=1");
+        hsm_test_util_setenv("IOTEDGE_HSM_FAULT_FILE_WRITE", "error_rate=bad");
+
+        // act
+        HSM_CLIENT_STORE_HANDLE store_handle = store_if->hsm_client_store_open("store");
+        int write_result = hsm_fault_file_write(&write_size);
+
+        // assert
+        ASSERT_IS_NULL(store_handle, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, g_target_calls, "Line:" TOSTRING(__LINE__));
+        // invalid settings are ignored
+        ASSERT_ARE_EQUAL(int, 0, write_result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, TEST_WRITE_SIZE, write_size, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_fault_configure_overrides_env)
+    {
+        // arrange
+        const HSM_CLIENT_STORE_INTERFACE* store_if = hsm_fault_store_interface(&TEST_STORE_INTERFACE);
+        hsm_test_util_setenv("IOTEDGE_HSM_FAULT_STORE", "error_rate=1");
+        ASSERT_ARE_EQUAL(int, 0, hsm_fault_configure(HSM_FAULT_STORE, NULL), "Line:" TOSTRING(__LINE__));
+
+        // act
+        HSM_CLIENT_STORE_HANDLE store_handle = store_if->hsm_client_store_open("store");
+
+        // assert
+        ASSERT_ARE_EQUAL(void_ptr, TEST_STORE_HANDLE, store_handle, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 1, g_target_calls, "Line:" TOSTRING(__LINE__));
+    }
+
+END_TEST_SUITE(hsm_fault_ut)
@@ -0,0 +1,248 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "test_utils.h"
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "hsm_atomic.h"
+#include "hsm_log.h"
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+
+#include "hsm_file_watch.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+
+#define TEST_CERT_FILE_NAME "test_cert.pem"
+#define TEST_KEY_FILE_NAME "test_key.pem"
+#define TEST_OTHER_FILE_NAME "test_other.pem"
+#define TEST_TEMP_FILE_NAME "test_cert.pem.tmp"
+static char *TEST_CERT_FILE = NULL;
+static char *TEST_KEY_FILE = NULL;
+static char *TEST_OTHER_FILE = NULL;
+static char *TEST_TEMP_FILE = NULL;
+
+// comfortably above the settle period of the watcher
+#define TEST_CHANGE_TIMEOUT_MS 5000
+#define TEST_NO_CHANGE_WAIT_MS 1500
+#define TEST_POLL_INTERVAL_MS 50
+
+static HSM_ATOMIC_LONG g_num_changes = 0;
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static char* TEST_TEMP_DIR = NULL;
+static char* TEST_TEMP_DIR_GUID = NULL;
+
+//#############################################################################
+// Test helpers
+//#############################################################################
+
+static void test_helper_setup_testdir(void)
+{
+    TEST_TEMP_DIR = hsm_test_util_create_temp_dir(&TEST_TEMP_DIR_GUID);
+    ASSERT_IS_NOT_NULL(TEST_TEMP_DIR_GUID, "Line:" TOSTRING(__LINE__));
+    ASSERT_IS_NOT_NULL(TEST_TEMP_DIR, "Line:" TOSTRING(__LINE__));
+    printf("Temp dir created: [%s]\r\n", TEST_TEMP_DIR);
+}
+
+static void test_helper_teardown_testdir(void)
+{
+    if ((TEST_TEMP_DIR != NULL) && (TEST_TEMP_DIR_GUID != NULL))
+    {
+        hsm_test_util_delete_dir(TEST_TEMP_DIR_GUID);
+        free(TEST_TEMP_DIR);
+        TEST_TEMP_DIR = NULL;
+        free(TEST_TEMP_DIR_GUID);
+        TEST_TEMP_DIR_GUID = NULL;
+    }
+}
+
+static char* prepare_file_path(const char* base_dir, const char* file_name)
+{
+    size_t path_size = get_max_file_path_size();
+    char *file_path = calloc(path_size, 1);
+    ASSERT_IS_NOT_NULL(file_path, "Line:" TOSTRING(__LINE__));
+    int status = snprintf(file_path, path_size, "%s%s", base_dir, file_name);
+    ASSERT_IS_TRUE(((status > 0) || (status < (int)path_size)), "Line:" TOSTRING(__LINE__));
+
+    return file_path;
+}
+
+static void test_helper_write_file(const char *file_name, const char *contents)
+{
+    FILE *file_handle = fopen(file_name, "wb");
+    ASSERT_IS_NOT_NULL(file_handle, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(size_t, strlen(contents), fwrite(contents, 1, strlen(contents), file_handle), "Line:" TOSTRING(__LINE__));
+    fclose(file_handle);
+}
+
+static void test_on_change(void *context)
+{
+    (void)hsm_atomic_inc((HSM_ATOMIC_LONG*)context);
+}
+
+static void test_helper_wait_for_changes(long expected_changes)
+{
+    int waited_ms = 0;
+    while ((hsm_atomic_load(&g_num_changes) < expected_changes) && (waited_ms < TEST_CHANGE_TIMEOUT_MS))
+    {
+        ThreadAPI_Sleep(TEST_POLL_INTERVAL_MS);
+        waited_ms += TEST_POLL_INTERVAL_MS;
+    }
+    ASSERT_ARE_EQUAL(long, expected_changes, hsm_atomic_load(&g_num_changes), "Line:" TOSTRING(__LINE__));
+}
+
+static HSM_FILE_WATCH_HANDLE test_helper_start_watch(void)
+{
+    const char *files[2];
+    files[0] = TEST_CERT_FILE;
+    files[1] = TEST_KEY_FILE;
+    HSM_FILE_WATCH_HANDLE watch = hsm_file_watch_start(files, 2, test_on_change, (void*)&g_num_changes);
+    ASSERT_IS_NOT_NULL(watch, "Line:" TOSTRING(__LINE__));
+
+    return watch;
+}
+
+//#############################################################################
+// Test cases
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_file_watch_int_tests)
+
+        TEST_SUITE_INITIALIZE(TestClassInitialize)
+        {
+            TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+            g_testByTest = TEST_MUTEX_CREATE();
+            ASSERT_IS_NOT_NULL(g_testByTest);
+
+            test_helper_setup_testdir();
+            TEST_CERT_FILE = prepare_file_path(TEST_TEMP_DIR, TEST_CERT_FILE_NAME);
+            TEST_KEY_FILE = prepare_file_path(TEST_TEMP_DIR, TEST_KEY_FILE_NAME);
+            TEST_OTHER_FILE = prepare_file_path(TEST_TEMP_DIR, TEST_OTHER_FILE_NAME);
+            TEST_TEMP_FILE = prepare_file_path(TEST_TEMP_DIR, TEST_TEMP_FILE_NAME);
+        }
+
+        TEST_SUITE_CLEANUP(TestClassCleanup)
+        {
+            free(TEST_TEMP_FILE); TEST_TEMP_FILE = NULL;
+            free(TEST_OTHER_FILE); TEST_OTHER_FILE = NULL;
+            free(TEST_KEY_FILE); TEST_KEY_FILE = NULL;
+            free(TEST_CERT_FILE); TEST_CERT_FILE = NULL;
+            test_helper_teardown_testdir();
+            TEST_MUTEX_DESTROY(g_testByTest);
+            TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        }
+
+        TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+        {
+            if (TEST_MUTEX_ACQUIRE(g_testByTest))
+            {
+                ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+            }
+            test_helper_write_file(TEST_CERT_FILE, "cert-1");
+            test_helper_write_file(TEST_KEY_FILE, "key-1");
+            g_num_changes = 0;
+        }
+
+        TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+        {
+            (void)remove(TEST_TEMP_FILE);
+            (void)remove(TEST_OTHER_FILE);
+            (void)remove(TEST_KEY_FILE);
+            (void)remove(TEST_CERT_FILE);
+            TEST_MUTEX_RELEASE(g_testByTest);
+        }
+
+        TEST_FUNCTION(hsm_file_watch_invalid_params)
+        {
+            // arrange
+            const char *files[2];
+            files[0] = TEST_CERT_FILE;
+            files[1] = NULL;
+
+            // act, assert
+            ASSERT_IS_NULL(hsm_file_watch_start(NULL, 1, test_on_change, NULL), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(hsm_file_watch_start(files, 0, test_on_change, NULL), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(hsm_file_watch_start(files, 1, NULL, NULL), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(hsm_file_watch_start(files, 2, test_on_change, NULL), "Line:" TOSTRING(__LINE__));
+            files[1] = "";
+            ASSERT_IS_NULL(hsm_file_watch_start(files, 2, test_on_change, NULL), "Line:" TOSTRING(__LINE__));
+        }
+
+        TEST_FUNCTION(hsm_file_watch_coalesces_rewrites_into_one_change)
+        {
+            // arrange
+            HSM_FILE_WATCH_HANDLE watch = test_helper_start_watch();
+
+            // act
+            test_helper_write_file(TEST_CERT_FILE, "cert-2");
+            test_helper_write_file(TEST_KEY_FILE, "key-2");
+
+            // assert
+            test_helper_wait_for_changes(1);
+            ThreadAPI_Sleep(TEST_NO_CHANGE_WAIT_MS);
+            ASSERT_ARE_EQUAL(long, 1, hsm_atomic_load(&g_num_changes), "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            hsm_file_watch_stop(watch);
+        }
+
+        TEST_FUNCTION(hsm_file_watch_detects_file_replaced_by_rename)
+        {
+            // arrange
+            HSM_FILE_WATCH_HANDLE watch = test_helper_start_watch();
+            test_helper_write_file(TEST_TEMP_FILE, "cert-2");
+
+            // act
+            ASSERT_ARE_EQUAL(int, 0, rename(TEST_TEMP_FILE, TEST_CERT_FILE), "Line:" TOSTRING(__LINE__));
+
+            // assert
+            test_helper_wait_for_changes(1);
+
+            // cleanup
+            hsm_file_watch_stop(watch);
+        }
+
+        TEST_FUNCTION(hsm_file_watch_ignores_other_files_in_dir)
+        {
+            // arrange
+            HSM_FILE_WATCH_HANDLE watch = test_helper_start_watch();
+
+            // act
+            test_helper_write_file(TEST_OTHER_FILE, "other");
+            ThreadAPI_Sleep(TEST_NO_CHANGE_WAIT_MS);
+
+            // assert
+            ASSERT_ARE_EQUAL(long, 0, hsm_atomic_load(&g_num_changes), "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            hsm_file_watch_stop(watch);
+        }
+
+        TEST_FUNCTION(hsm_file_watch_stop_before_settle_skips_change)
+        {
+            // arrange
+            HSM_FILE_WATCH_HANDLE watch = test_helper_start_watch();
+            test_helper_write_file(TEST_CERT_FILE, "cert-2");
+
+            // act
+            hsm_file_watch_stop(watch);
+            ThreadAPI_Sleep(TEST_NO_CHANGE_WAIT_MS);
+
+            // assert
+            ASSERT_ARE_EQUAL(long, 0, hsm_atomic_load(&g_num_changes), "Line:" TOSTRING(__LINE__));
+        }
+
+END_TEST_SUITE(hsm_file_watch_int_tests)
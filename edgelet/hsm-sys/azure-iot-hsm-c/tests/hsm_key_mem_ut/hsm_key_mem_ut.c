@@ -0,0 +1,198 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//#############################################################################
+// Memory allocator test hooks
+//#############################################################################
+
+static void* test_hook_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void* test_hook_gballoc_calloc(size_t num, size_t size)
+{
+    return calloc(num, size);
+}
+
+static void* test_hook_gballoc_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void test_hook_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umock_c_negative_tests.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+//#############################################################################
+// Declare and enable MOCK definitions
+//#############################################################################
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+
+#include "hsm_key_mem.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+
+#define TEST_SMALL_KEY_SIZE 32
+#define TEST_LARGE_KEY_SIZE 1024
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+//#############################################################################
+// Mocked functions test hooks
+//#############################################################################
+
+static void test_hook_on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s",
+                   ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+//#############################################################################
+// Test cases
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_key_mem_ut)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(test_hook_on_umock_c_error);
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_charptr_register_types());
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_stdint_register_types());
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, test_hook_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_calloc, test_hook_gballoc_calloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_calloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, test_hook_gballoc_realloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_realloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, test_hook_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+        }
+
+        umock_c_reset_all_calls();
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(hsm_key_mem_invalid_params)
+    {
+        // act, assert
+        ASSERT_IS_NULL(hsm_key_mem_alloc(0), "Line:" TOSTRING(__LINE__));
+        hsm_key_mem_free(NULL, TEST_SMALL_KEY_SIZE);
+        hsm_key_mem_cleanse(NULL, TEST_SMALL_KEY_SIZE);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_key_mem_free_zeroizes_and_reuses_memory)
+    {
+        // arrange
+        size_t idx;
+        unsigned char *key_1;
+        unsigned char *key_2;
+        // the size class slab is created by the first allocation
+        key_1 = (unsigned char*)hsm_key_mem_alloc(TEST_SMALL_KEY_SIZE);
+        ASSERT_IS_NOT_NULL(key_1, "Line:" TOSTRING(__LINE__));
+        memset(key_1, 0xA5, TEST_SMALL_KEY_SIZE);
+        umock_c_reset_all_calls();
+
+        // act
+        hsm_key_mem_free(key_1, TEST_SMALL_KEY_SIZE);
+        key_2 = (unsigned char*)hsm_key_mem_alloc(TEST_SMALL_KEY_SIZE);
+
+        // assert
+        ASSERT_ARE_EQUAL(void_ptr, key_1, key_2, "Line:" TOSTRING(__LINE__));
+        for (idx = 0; idx < TEST_SMALL_KEY_SIZE; idx++)
+        {
+            ASSERT_ARE_EQUAL(int, 0, (int)key_2[idx], "Line:" TOSTRING(__LINE__));
+        }
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_key_mem_free(key_2, TEST_SMALL_KEY_SIZE);
+    }
+
+    TEST_FUNCTION(hsm_key_mem_alloc_large_uses_heap)
+    {
+        // arrange
+        void *key;
+        STRICT_EXPECTED_CALL(gballoc_malloc(TEST_LARGE_KEY_SIZE));
+        EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+        // act
+        key = hsm_key_mem_alloc(TEST_LARGE_KEY_SIZE);
+        ASSERT_IS_NOT_NULL(key, "Line:" TOSTRING(__LINE__));
+        memset(key, 0xA5, TEST_LARGE_KEY_SIZE);
+        hsm_key_mem_free(key, TEST_LARGE_KEY_SIZE);
+
+        // assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_key_mem_cleanse_zeroizes)
+    {
+        // arrange
+        size_t idx;
+        unsigned char key[TEST_SMALL_KEY_SIZE];
+        memset(key, 0xA5, sizeof(key));
+
+        // act
+        hsm_key_mem_cleanse(key, sizeof(key));
+
+        // assert
+        for (idx = 0; idx < sizeof(key); idx++)
+        {
+            ASSERT_ARE_EQUAL(int, 0, (int)key[idx], "Line:" TOSTRING(__LINE__));
+        }
+    }
+
+END_TEST_SUITE(hsm_key_mem_ut)
@@ -0,0 +1,255 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+
+#include "hsm_log.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+
+#define TEST_MAX_LINES 1024
+#define TEST_LINE_SIZE 1024
+// more than fit in the ring of a single thread
+#define TEST_NUM_BURST_MESSAGES 1000
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+// only written to while the logger holds its drain lock, which log_flush takes
+static int g_num_lines = 0;
+static int g_line_levels[TEST_MAX_LINES];
+static char g_lines[TEST_MAX_LINES][TEST_LINE_SIZE];
+static int g_num_evaluations = 0;
+
+//#############################################################################
+// Mocked functions test hooks
+//#############################################################################
+
+static void test_hook_on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s",
+                   ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+static void test_hook_log_callback(int level, const char* line, void* context)
+{
+    (void)context;
+    if (g_num_lines < TEST_MAX_LINES)
+    {
+        g_line_levels[g_num_lines] = level;
+        (void)snprintf(g_lines[g_num_lines], TEST_LINE_SIZE, "%s", line);
+        g_num_lines++;
+    }
+}
+
+static int test_evaluate_argument(void)
+{
+    return ++g_num_evaluations;
+}
+
+//#############################################################################
+// Test cases
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_log_ut)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(test_hook_on_umock_c_error);
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_charptr_register_types());
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+        }
+
+        umock_c_reset_all_calls();
+        set_log_callback(test_hook_log_callback, NULL);
+        g_num_lines = 0;
+        g_num_evaluations = 0;
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        set_log_callback(NULL, NULL);
+        set_log_level(LVL_ERROR);
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(hsm_log_filtered_message_arguments_not_evaluated)
+    {
+        // arrange
+        set_log_level(LVL_INFO);
+
+        // act
+        LOG_DEBUG("filtered %d", test_evaluate_argument());
+        LOG_INFO("logged %d", test_evaluate_argument());
+        log_flush();
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 1, g_num_evaluations, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 1, g_num_lines, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NOT_NULL(strstr(g_lines[0], "logged 1"), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_log_set_log_level_ignores_invalid_levels)
+    {
+        // arrange
+        set_log_level(LVL_DEBUG);
+
+        // act
+        set_log_level(LVL_ERROR + 1);
+        set_log_level(LVL_DEBUG - 1);
+        LOG_DEBUG("still logged");
+        log_flush();
+
+        // assert
+        ASSERT_ARE_EQUAL(int, LVL_DEBUG, hsm_log_level, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 1, g_num_lines, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_log_callback_receives_formatted_line)
+    {
+        // act
+        LOG_ERROR("value %d name %s", 42, "test");
+        log_flush();
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 1, g_num_lines, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, LVL_ERROR, g_line_levels[0], "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, strncmp(g_lines[0], "<3>", 3), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NOT_NULL(strstr(g_lines[0], "[ERR!]"), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NOT_NULL(strstr(g_lines[0], "hsm_log_callback_receives_formatted_line"), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NOT_NULL(strstr(g_lines[0], "value 42 name test"), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(strchr(g_lines[0], '\n'), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_log_messages_written_in_order)
+    {
+        // arrange
+        int idx;
+        char expected[32];
+        set_log_level(LVL_INFO);
+
+        // act
+        for (idx = 0; idx < 10; idx++)
+        {
+            if ((idx % 3) == 0)
+            {
+                LOG_ERROR("message %d", idx);
+            }
+            else
+            {
+                LOG_INFO("message %d", idx);
+            }
+        }
+        log_flush();
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 10, g_num_lines, "Line:" TOSTRING(__LINE__));
+        for (idx = 0; idx < 10; idx++)
+        {
+            (void)snprintf(expected, sizeof(expected), "message %d", idx);
+            ASSERT_IS_NOT_NULL(strstr(g_lines[idx], expected), "Line:" TOSTRING(__LINE__));
+        }
+    }
+
+    TEST_FUNCTION(hsm_log_burst_messages_not_dropped)
+    {
+        // arrange
+        int idx;
+        int num_written = 0;
+        set_log_level(LVL_INFO);
+
+        // act
+        for (idx = 0; idx < TEST_NUM_BURST_MESSAGES; idx++)
+        {
+            LOG_INFO("burst %d", idx);
+        }
+        log_flush();
+
+        // assert
+        for (idx = 0; idx < g_num_lines; idx++)
+        {
+            ASSERT_IS_NULL(strstr(g_lines[idx], "log messages were dropped"), "Line:" TOSTRING(__LINE__));
+            if (strstr(g_lines[idx], "burst ") != NULL)
+            {
+                num_written++;
+            }
+        }
+        ASSERT_ARE_EQUAL(int, TEST_NUM_BURST_MESSAGES, num_written, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_log_error_written_before_returning)
+    {
+        // act
+        LOG_ERROR("written synchronously");
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 1, g_num_lines, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NOT_NULL(strstr(g_lines[0], "written synchronously"), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_log_shutdown_writes_out_pending_messages)
+    {
+        // arrange
+        set_log_level(LVL_INFO);
+
+        // act
+        LOG_INFO("before shutdown");
+        log_shutdown();
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 1, g_num_lines, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NOT_NULL(strstr(g_lines[0], "before shutdown"), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_log_messages_after_shutdown_written)
+    {
+        // arrange
+        LOG_ERROR("message 0");
+        log_shutdown();
+
+        // act
+        LOG_ERROR("message 1");
+        log_shutdown();
+        log_shutdown();
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 2, g_num_lines, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NOT_NULL(strstr(g_lines[0], "message 0"), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NOT_NULL(strstr(g_lines[1], "message 1"), "Line:" TOSTRING(__LINE__));
+    }
+
+END_TEST_SUITE(hsm_log_ut)
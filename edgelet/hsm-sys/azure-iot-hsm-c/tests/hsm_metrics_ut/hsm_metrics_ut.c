@@ -0,0 +1,367 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+
+#include "hsm_client_data.h"
+#include "hsm_metrics.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+
+#define TEST_RANDOM_BYTES_FAILURE 1
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static HSM_CLIENT_HANDLE TEST_HSM_CLIENT_HANDLE = (HSM_CLIENT_HANDLE)0x1000;
+static int g_random_bytes_calls = 0;
+static int g_random_bytes_result = 0;
+
+//#############################################################################
+// Mocked functions test hooks
+//#############################################################################
+
+static void test_hook_on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s",
+                   ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+static int test_hook_get_random_bytes(HSM_CLIENT_HANDLE handle, unsigned char* buffer, size_t num)
+{
+    ASSERT_ARE_EQUAL(void_ptr, TEST_HSM_CLIENT_HANDLE, handle, "Line:" TOSTRING(__LINE__));
+    memset(buffer, 0xA5, num);
+    g_random_bytes_calls++;
+    return g_random_bytes_result;
+}
+
+static const HSM_CLIENT_CRYPTO_INTERFACE TEST_CRYPTO_INTERFACE =
+{
+    NULL,
+    NULL,
+    test_hook_get_random_bytes,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+//#############################################################################
+// Test helpers
+//#############################################################################
+
+static const HSM_OPERATION_METRICS* find_operation(const HSM_METRICS *metrics, const char *name)
+{
+    const HSM_OPERATION_METRICS *result = NULL;
+    size_t idx;
+
+    for (idx = 0; (result == NULL) && (idx < metrics->num_operations); idx++)
+    {
+        if (strcmp(metrics->operations[idx].name, name) == 0)
+        {
+            result = &metrics->operations[idx];
+        }
+    }
+    ASSERT_IS_NOT_NULL(result, "Line:" TOSTRING(__LINE__));
+
+    return result;
+}
+
+static const HSM_CACHE_METRICS* find_cache(const HSM_METRICS *metrics, const char *name)
+{
+    const HSM_CACHE_METRICS *result = NULL;
+    size_t idx;
+
+    for (idx = 0; (result == NULL) && (idx < metrics->num_caches); idx++)
+    {
+        if (strcmp(metrics->caches[idx].name, name) == 0)
+        {
+            result = &metrics->caches[idx];
+        }
+    }
+    ASSERT_IS_NOT_NULL(result, "Line:" TOSTRING(__LINE__));
+
+    return result;
+}
+
+static const HSM_LOCK_METRICS* find_lock(const HSM_METRICS *metrics, const char *name)
+{
+    const HSM_LOCK_METRICS *result = NULL;
+    size_t idx;
+
+    for (idx = 0; (result == NULL) && (idx < metrics->num_locks); idx++)
+    {
+        if (strcmp(metrics->locks[idx].name, name) == 0)
+        {
+            result = &metrics->locks[idx];
+        }
+    }
+    ASSERT_IS_NOT_NULL(result, "Line:" TOSTRING(__LINE__));
+
+    return result;
+}
+
+static uint64_t sum_buckets(const HSM_OPERATION_METRICS *operation)
+{
+    uint64_t result = 0;
+    size_t idx;
+
+    for (idx = 0; idx < HSM_METRICS_NUM_BUCKETS; idx++)
+    {
+        result += operation->buckets[idx];
+    }
+
+    return result;
+}
+
+//#############################################################################
+// Test cases
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_metrics_ut)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(test_hook_on_umock_c_error);
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_charptr_register_types());
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+        }
+
+        umock_c_reset_all_calls();
+        g_random_bytes_calls = 0;
+        g_random_bytes_result = 0;
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(hsm_metrics_record_counts_calls_and_errors)
+    {
+        // arrange
+        HSM_METRICS *before = hsm_get_metrics();
+        HSM_METRICS *after;
+        const HSM_OPERATION_METRICS *operation_before, *operation_after;
+        ASSERT_IS_NOT_NULL(before, "Line:" TOSTRING(__LINE__));
+
+        // act
+        hsm_metrics_record(HSM_METRICS_PKI_GENERATE_KEY, hsm_metrics_start(), false);
+        hsm_metrics_record(HSM_METRICS_PKI_GENERATE_KEY, hsm_metrics_start(), true);
+        hsm_metrics_record(HSM_METRICS_PKI_GENERATE_KEY, hsm_metrics_start(), false);
+        hsm_metrics_record(HSM_METRICS_NUM_OPERATIONS, hsm_metrics_start(), false);
+        after = hsm_get_metrics();
+
+        // assert
+        ASSERT_IS_NOT_NULL(after, "Line:" TOSTRING(__LINE__));
+        operation_before = find_operation(before, "pki.generate_key");
+        operation_after = find_operation(after, "pki.generate_key");
+        ASSERT_ARE_EQUAL(size_t, (size_t)HSM_METRICS_NUM_OPERATIONS, after->num_operations, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE((operation_after->count - operation_before->count) == 3, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE((operation_after->errors - operation_before->errors) == 1, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(sum_buckets(operation_after) == operation_after->count, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(operation_after->total_ns >= operation_after->max_ns, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_free_metrics(after);
+        hsm_free_metrics(before);
+    }
+
+    TEST_FUNCTION(hsm_metrics_bucket_upper_bounds_increase)
+    {
+        // arrange
+        size_t idx;
+
+        // act, assert
+        ASSERT_IS_TRUE(hsm_metrics_bucket_upper_bound(0) == 0, "Line:" TOSTRING(__LINE__));
+        for (idx = 1; idx < HSM_METRICS_NUM_BUCKETS; idx++)
+        {
+            ASSERT_IS_TRUE(hsm_metrics_bucket_upper_bound(idx) > hsm_metrics_bucket_upper_bound(idx - 1), "Line:" TOSTRING(__LINE__));
+        }
+        ASSERT_IS_TRUE(hsm_metrics_bucket_upper_bound(HSM_METRICS_NUM_BUCKETS - 1) == UINT64_MAX, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(hsm_metrics_bucket_upper_bound(HSM_METRICS_NUM_BUCKETS) == UINT64_MAX, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_metrics_percentile_uses_bucket_bounds)
+    {
+        // arrange
+        HSM_OPERATION_METRICS *operation = (HSM_OPERATION_METRICS*)calloc(1, sizeof(HSM_OPERATION_METRICS));
+        ASSERT_IS_NOT_NULL(operation, "Line:" TOSTRING(__LINE__));
+        operation->count = 100;
+        operation->buckets[40] = 90;
+        operation->buckets[60] = 10;
+        operation->max_ns = hsm_metrics_bucket_upper_bound(60);
+
+        // act, assert
+        ASSERT_IS_TRUE(hsm_metrics_percentile(operation, 0) == hsm_metrics_bucket_upper_bound(40), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(hsm_metrics_percentile(operation, 50) == hsm_metrics_bucket_upper_bound(40), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(hsm_metrics_percentile(operation, 90) == hsm_metrics_bucket_upper_bound(40), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(hsm_metrics_percentile(operation, 99) == hsm_metrics_bucket_upper_bound(60), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(hsm_metrics_percentile(operation, 200) == hsm_metrics_bucket_upper_bound(60), "Line:" TOSTRING(__LINE__));
+
+        // the largest latency seen bounds the percentile within its bucket
+        operation->max_ns = hsm_metrics_bucket_upper_bound(59) + 1;
+        ASSERT_IS_TRUE(hsm_metrics_percentile(operation, 99) == operation->max_ns, "Line:" TOSTRING(__LINE__));
+
+        operation->count = 0;
+        ASSERT_IS_TRUE(hsm_metrics_percentile(operation, 99) == 0, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(hsm_metrics_percentile(NULL, 99) == 0, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        free(operation);
+    }
+
+    TEST_FUNCTION(hsm_metrics_cache_access_counts_hits_and_misses)
+    {
+        // arrange
+        HSM_METRICS *before = hsm_get_metrics();
+        HSM_METRICS *after;
+        const HSM_CACHE_METRICS *cache_before, *cache_after;
+        ASSERT_IS_NOT_NULL(before, "Line:" TOSTRING(__LINE__));
+
+        // act
+        hsm_metrics_cache_access(HSM_METRICS_CACHE_VERIFIED_MANIFEST, true);
+        hsm_metrics_cache_access(HSM_METRICS_CACHE_VERIFIED_MANIFEST, true);
+        hsm_metrics_cache_access(HSM_METRICS_CACHE_VERIFIED_MANIFEST, false);
+        hsm_metrics_cache_access(HSM_METRICS_NUM_CACHES, true);
+        after = hsm_get_metrics();
+
+        // assert
+        ASSERT_IS_NOT_NULL(after, "Line:" TOSTRING(__LINE__));
+        cache_before = find_cache(before, "store.verified_manifest");
+        cache_after = find_cache(after, "store.verified_manifest");
+        ASSERT_IS_TRUE((cache_after->hits - cache_before->hits) == 2, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE((cache_after->misses - cache_before->misses) == 1, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_free_metrics(after);
+        hsm_free_metrics(before);
+    }
+
+    TEST_FUNCTION(hsm_metrics_lock_wait_counts_acquisitions_and_contention)
+    {
+        // arrange
+        HSM_METRICS *before = hsm_get_metrics();
+        HSM_METRICS *after;
+        const HSM_LOCK_METRICS *lock_before, *lock_after;
+        uint64_t buckets = 0;
+        size_t idx;
+        ASSERT_IS_NOT_NULL(before, "Line:" TOSTRING(__LINE__));
+
+        // act
+        hsm_metrics_lock_wait(HSM_METRICS_LOCK_STORE_WRITER, hsm_metrics_now(), false);
+        hsm_metrics_lock_wait(HSM_METRICS_LOCK_STORE_WRITER, hsm_metrics_now(), true);
+        hsm_metrics_lock_wait(HSM_METRICS_NUM_LOCKS, hsm_metrics_now(), true);
+        after = hsm_get_metrics();
+
+        // assert
+        ASSERT_IS_NOT_NULL(after, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, (size_t)HSM_METRICS_NUM_LOCKS, after->num_locks, "Line:" TOSTRING(__LINE__));
+        lock_before = find_lock(before, "store.writer");
+        lock_after = find_lock(after, "store.writer");
+        ASSERT_IS_TRUE((lock_after->acquisitions - lock_before->acquisitions) == 2, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE((lock_after->contended - lock_before->contended) == 1, "Line:" TOSTRING(__LINE__));
+        for (idx = 0; idx < HSM_METRICS_NUM_BUCKETS; idx++)
+        {
+            buckets += lock_after->buckets[idx];
+        }
+        ASSERT_IS_TRUE(buckets == lock_after->acquisitions, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(hsm_metrics_lock_percentile(lock_after, 100) <= lock_after->max_wait_ns, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(hsm_metrics_lock_percentile(NULL, 99) == 0, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_free_metrics(after);
+        hsm_free_metrics(before);
+    }
+
+    TEST_FUNCTION(hsm_metrics_crypto_interface_forwards_and_counts_calls)
+    {
+        // arrange
+        unsigned char buffer[16];
+        const HSM_CLIENT_CRYPTO_INTERFACE *interface = hsm_metrics_crypto_interface(&TEST_CRYPTO_INTERFACE);
+        HSM_METRICS *before = hsm_get_metrics();
+        HSM_METRICS *after;
+        const HSM_OPERATION_METRICS *operation_before, *operation_after;
+        int status_success, status_failure;
+        ASSERT_IS_NOT_NULL(interface, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NOT_NULL(before, "Line:" TOSTRING(__LINE__));
+
+        // act
+        status_success = interface->hsm_client_get_random_bytes(TEST_HSM_CLIENT_HANDLE, buffer, sizeof(buffer));
+        g_random_bytes_result = TEST_RANDOM_BYTES_FAILURE;
+        status_failure = interface->hsm_client_get_random_bytes(TEST_HSM_CLIENT_HANDLE, buffer, sizeof(buffer));
+        after = hsm_get_metrics();
+
+        // assert
+        ASSERT_IS_NOT_NULL(after, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, status_success, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, TEST_RANDOM_BYTES_FAILURE, status_failure, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 2, g_random_bytes_calls, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0xA5, buffer[sizeof(buffer) - 1], "Line:" TOSTRING(__LINE__));
+        operation_before = find_operation(before, "crypto.get_random_bytes");
+        operation_after = find_operation(after, "crypto.get_random_bytes");
+        ASSERT_IS_TRUE((operation_after->count - operation_before->count) == 2, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE((operation_after->errors - operation_before->errors) == 1, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_free_metrics(after);
+        hsm_free_metrics(before);
+    }
+
+    TEST_FUNCTION(hsm_metrics_interfaces_without_target_return_null)
+    {
+        // act, assert
+        ASSERT_IS_NULL(hsm_metrics_crypto_interface(NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(hsm_metrics_tpm_interface(NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(hsm_metrics_store_interface(NULL), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_free_metrics_null_does_nothing)
+    {
+        // act
+        hsm_free_metrics(NULL);
+
+        // assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+    }
+
+END_TEST_SUITE(hsm_metrics_ut)
@@ -0,0 +1,285 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//#############################################################################
+// Memory allocator test hooks
+//#############################################################################
+
+static void* test_hook_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void* test_hook_gballoc_calloc(size_t num, size_t size)
+{
+    return calloc(num, size);
+}
+
+static void* test_hook_gballoc_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void test_hook_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umock_c_negative_tests.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+//#############################################################################
+// Declare and enable MOCK definitions
+//#############################################################################
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+
+#include "hsm_random.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+
+#define TEST_SMALL_REQUEST_SIZE 16
+// large enough to bypass the per thread buffer
+#define TEST_BULK_REQUEST_SIZE 4096
+#define TEST_CHUNK_SIZE (64 * 1024)
+// more than the output after which a generator is reseeded
+#define TEST_NUM_CHUNKS 40
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+//#############################################################################
+// Mocked functions test hooks
+//#############################################################################
+
+static void test_hook_on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s",
+                   ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+//#############################################################################
+// Test helpers
+//#############################################################################
+
+static bool is_all_zero(const unsigned char *buffer, size_t size)
+{
+    size_t idx;
+    bool result = true;
+
+    for (idx = 0; (idx < size) && result; idx++)
+    {
+        result = (buffer[idx] == 0);
+    }
+
+    return result;
+}
+
+// checks that no two blocks of the given size in the buffer are the same
+static bool has_repeated_block(const unsigned char *buffer, size_t size, size_t block_size)
+{
+    size_t i, j;
+    bool result = false;
+
+    for (i = 0; (i + block_size <= size) && !result; i += block_size)
+    {
+        for (j = i + block_size; (j + block_size <= size) && !result; j += block_size)
+        {
+            result = (memcmp(buffer + i, buffer + j, block_size) == 0);
+        }
+    }
+
+    return result;
+}
+
+//#############################################################################
+// Test cases
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_random_ut)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(test_hook_on_umock_c_error);
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_charptr_register_types());
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_stdint_register_types());
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, test_hook_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_calloc, test_hook_gballoc_calloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_calloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, test_hook_gballoc_realloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_realloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, test_hook_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+        }
+
+        umock_c_reset_all_calls();
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(hsm_random_bytes_invalid_params)
+    {
+        // arrange
+        unsigned char buffer[TEST_SMALL_REQUEST_SIZE];
+
+        // act, assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, hsm_random_bytes(NULL, sizeof(buffer)), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, hsm_random_bytes(buffer, 0), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_random_bytes_small_requests_differ)
+    {
+        // arrange
+        unsigned char first[TEST_SMALL_REQUEST_SIZE];
+        unsigned char second[TEST_SMALL_REQUEST_SIZE];
+        memset(first, 0, sizeof(first));
+        memset(second, 0, sizeof(second));
+
+        // act
+        int first_result = hsm_random_bytes(first, sizeof(first));
+        int second_result = hsm_random_bytes(second, sizeof(second));
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, first_result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, second_result, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_FALSE(is_all_zero(first, sizeof(first)), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_FALSE(is_all_zero(second, sizeof(second)), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, memcmp(first, second, sizeof(first)), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_random_bytes_odd_sizes_cross_buffer_refills)
+    {
+        // arrange
+        unsigned char buffer[TEST_BULK_REQUEST_SIZE];
+        size_t offset = 0;
+        size_t size = 1;
+        int result = 0;
+        memset(buffer, 0, sizeof(buffer));
+
+        // act
+        while ((result == 0) && (offset + size <= sizeof(buffer)))
+        {
+            result = hsm_random_bytes(buffer + offset, size);
+            offset += size;
+            size = (size % 61) + 7;
+        }
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_FALSE(has_repeated_block(buffer, offset, TEST_SMALL_REQUEST_SIZE), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_random_bytes_bulk_request_success)
+    {
+        // arrange
+        unsigned char buffer[TEST_BULK_REQUEST_SIZE + 5];
+        memset(buffer, 0, sizeof(buffer));
+
+        // act
+        int result = hsm_random_bytes(buffer, sizeof(buffer));
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_FALSE(is_all_zero(buffer + TEST_BULK_REQUEST_SIZE, 5), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_FALSE(has_repeated_block(buffer, sizeof(buffer), TEST_SMALL_REQUEST_SIZE), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_random_bytes_bulk_and_buffered_requests_differ)
+    {
+        // arrange
+        unsigned char buffer[4 * TEST_BULK_REQUEST_SIZE];
+        int results[4];
+        memset(buffer, 0, sizeof(buffer));
+
+        // act
+        results[0] = hsm_random_bytes(buffer, TEST_BULK_REQUEST_SIZE);
+        results[1] = hsm_random_bytes(buffer + TEST_BULK_REQUEST_SIZE, TEST_SMALL_REQUEST_SIZE);
+        results[2] = hsm_random_bytes(buffer + TEST_BULK_REQUEST_SIZE + TEST_SMALL_REQUEST_SIZE, TEST_BULK_REQUEST_SIZE);
+        results[3] = hsm_random_bytes(buffer + (2 * TEST_BULK_REQUEST_SIZE) + TEST_SMALL_REQUEST_SIZE, TEST_SMALL_REQUEST_SIZE);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, results[0], "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, results[1], "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, results[2], "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, results[3], "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_FALSE(has_repeated_block(buffer, (2 * TEST_BULK_REQUEST_SIZE) + (2 * TEST_SMALL_REQUEST_SIZE), TEST_SMALL_REQUEST_SIZE), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_random_bytes_continues_across_reseed)
+    {
+        // arrange
+        unsigned char *chunks = (unsigned char*)malloc(TEST_NUM_CHUNKS * TEST_CHUNK_SIZE);
+        size_t idx;
+        int result = 0;
+        ASSERT_IS_NOT_NULL(chunks, "Line:" TOSTRING(__LINE__));
+
+        // act
+        for (idx = 0; (idx < TEST_NUM_CHUNKS) && (result == 0); idx++)
+        {
+            result = hsm_random_bytes(chunks + (idx * TEST_CHUNK_SIZE), TEST_CHUNK_SIZE);
+        }
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        for (idx = 1; idx < TEST_NUM_CHUNKS; idx++)
+        {
+            ASSERT_ARE_NOT_EQUAL(int, 0, memcmp(chunks, chunks + (idx * TEST_CHUNK_SIZE), TEST_SMALL_REQUEST_SIZE), "Line:" TOSTRING(__LINE__));
+        }
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        free(chunks);
+    }
+
+END_TEST_SUITE(hsm_random_ut)
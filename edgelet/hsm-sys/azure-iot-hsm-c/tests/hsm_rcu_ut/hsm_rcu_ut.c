@@ -0,0 +1,225 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//#############################################################################
+// Memory allocator test hooks
+//#############################################################################
+
+static void* test_hook_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void* test_hook_gballoc_calloc(size_t num, size_t size)
+{
+    return calloc(num, size);
+}
+
+static void* test_hook_gballoc_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void test_hook_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umock_c_negative_tests.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+//#############################################################################
+// Declare and enable MOCK definitions
+//#############################################################################
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+
+#include "hsm_rcu.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+
+#define TEST_NUM_NESTED_READERS 3
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+//#############################################################################
+// Mocked functions test hooks
+//#############################################################################
+
+static void test_hook_on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s",
+                   ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+//#############################################################################
+// Test cases
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_rcu_ut)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(test_hook_on_umock_c_error);
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_charptr_register_types());
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_stdint_register_types());
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, test_hook_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_calloc, test_hook_gballoc_calloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_calloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, test_hook_gballoc_realloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_realloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, test_hook_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+        }
+
+        umock_c_reset_all_calls();
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(hsm_rcu_create_success)
+    {
+        // arrange
+        HSM_RCU_HANDLE rcu;
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+        // act
+        rcu = hsm_rcu_create();
+
+        // assert
+        ASSERT_IS_NOT_NULL(rcu, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_rcu_destroy(rcu);
+    }
+
+    TEST_FUNCTION(hsm_rcu_create_negative)
+    {
+        // arrange
+        HSM_RCU_HANDLE rcu;
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)).SetReturn(NULL);
+
+        // act
+        rcu = hsm_rcu_create();
+
+        // assert
+        ASSERT_IS_NULL(rcu, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_rcu_invalid_params)
+    {
+        // act, assert
+        ASSERT_ARE_EQUAL(size_t, 0, hsm_rcu_read_lock(NULL), "Line:" TOSTRING(__LINE__));
+        hsm_rcu_read_unlock(NULL, 0);
+        hsm_rcu_synchronize(NULL);
+        hsm_rcu_destroy(NULL);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_rcu_nested_readers_share_a_slot)
+    {
+        // arrange
+        size_t idx;
+        HSM_RCU_READER readers[TEST_NUM_NESTED_READERS];
+        HSM_RCU_HANDLE rcu = hsm_rcu_create();
+        ASSERT_IS_NOT_NULL(rcu, "Line:" TOSTRING(__LINE__));
+        umock_c_reset_all_calls();
+
+        // act
+        for (idx = 0; idx < TEST_NUM_NESTED_READERS; idx++)
+        {
+            readers[idx] = hsm_rcu_read_lock(rcu);
+        }
+        while (idx-- > 0)
+        {
+            hsm_rcu_read_unlock(rcu, readers[idx]);
+        }
+
+        // assert
+        for (idx = 1; idx < TEST_NUM_NESTED_READERS; idx++)
+        {
+            ASSERT_ARE_EQUAL(size_t, readers[0], readers[idx], "Line:" TOSTRING(__LINE__));
+        }
+        // locking and unlocking never allocates
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_rcu_destroy(rcu);
+    }
+
+    TEST_FUNCTION(hsm_rcu_synchronize_returns_once_readers_unlock)
+    {
+        // arrange
+        HSM_RCU_READER reader_1;
+        HSM_RCU_READER reader_2;
+        HSM_RCU_HANDLE rcu = hsm_rcu_create();
+        ASSERT_IS_NOT_NULL(rcu, "Line:" TOSTRING(__LINE__));
+        reader_1 = hsm_rcu_read_lock(rcu);
+        hsm_rcu_read_unlock(rcu, reader_1);
+        umock_c_reset_all_calls();
+
+        // act
+        hsm_rcu_synchronize(rcu);
+        hsm_rcu_synchronize(rcu);
+        reader_2 = hsm_rcu_read_lock(rcu);
+        hsm_rcu_read_unlock(rcu, reader_2);
+        hsm_rcu_synchronize(rcu);
+
+        // assert
+        // the calling thread keeps its slot across synchronizations
+        ASSERT_ARE_EQUAL(size_t, reader_1 >> 1, reader_2 >> 1, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_rcu_destroy(rcu);
+    }
+
+END_TEST_SUITE(hsm_rcu_ut)
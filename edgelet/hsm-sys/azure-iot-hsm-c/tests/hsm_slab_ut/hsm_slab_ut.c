@@ -0,0 +1,305 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//#############################################################################
+// Memory allocator test hooks
+//#############################################################################
+
+static void* test_hook_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void* test_hook_gballoc_calloc(size_t num, size_t size)
+{
+    return calloc(num, size);
+}
+
+static void* test_hook_gballoc_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void test_hook_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umock_c_negative_tests.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+//#############################################################################
+// Declare and enable MOCK definitions
+//#############################################################################
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+
+#include "hsm_slab.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+
+#define TEST_OBJECT_SIZE 20
+#define TEST_OBJECTS_PER_PAGE 4
+#define TEST_NUM_OBJECTS 10
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+//#############################################################################
+// Mocked functions test hooks
+//#############################################################################
+
+static void test_hook_on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s",
+                   ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+//#############################################################################
+// Test cases
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_slab_ut)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(test_hook_on_umock_c_error);
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_charptr_register_types());
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_stdint_register_types());
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, test_hook_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_calloc, test_hook_gballoc_calloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_calloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, test_hook_gballoc_realloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_realloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, test_hook_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+        }
+
+        umock_c_reset_all_calls();
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(hsm_slab_create_success)
+    {
+        // arrange
+        HSM_SLAB_HANDLE slab;
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+        // act
+        slab = hsm_slab_create(TEST_OBJECT_SIZE, TEST_OBJECTS_PER_PAGE);
+
+        // assert
+        ASSERT_IS_NOT_NULL(slab, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 0, hsm_slab_count(slab), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_slab_destroy(slab);
+    }
+
+    TEST_FUNCTION(hsm_slab_create_invalid_params)
+    {
+        // act, assert
+        ASSERT_IS_NULL(hsm_slab_create(0, TEST_OBJECTS_PER_PAGE), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(hsm_slab_create(SIZE_MAX, TEST_OBJECTS_PER_PAGE), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(hsm_slab_create(TEST_OBJECT_SIZE, 0), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(hsm_slab_create(TEST_OBJECT_SIZE, SIZE_MAX), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(hsm_slab_create_secure(0, TEST_OBJECTS_PER_PAGE), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(hsm_slab_create_secure(TEST_OBJECT_SIZE, 0), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(hsm_slab_alloc(NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 0, hsm_slab_count(NULL), "Line:" TOSTRING(__LINE__));
+        hsm_slab_free(NULL, NULL);
+        hsm_slab_destroy(NULL);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_slab_alloc_allocates_one_page_per_objects_per_page)
+    {
+        // arrange
+        size_t idx;
+        void *objects[TEST_NUM_OBJECTS];
+        HSM_SLAB_HANDLE slab = hsm_slab_create(TEST_OBJECT_SIZE, TEST_OBJECTS_PER_PAGE);
+        ASSERT_IS_NOT_NULL(slab, "Line:" TOSTRING(__LINE__));
+        umock_c_reset_all_calls();
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+        // act
+        for (idx = 0; idx < TEST_NUM_OBJECTS; idx++)
+        {
+            objects[idx] = hsm_slab_alloc(slab);
+            ASSERT_IS_NOT_NULL(objects[idx], "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, 0, ((size_t)objects[idx]) % 16, "Line:" TOSTRING(__LINE__));
+            memset(objects[idx], (int)idx, TEST_OBJECT_SIZE);
+        }
+
+        // assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, TEST_NUM_OBJECTS, hsm_slab_count(slab), "Line:" TOSTRING(__LINE__));
+        for (idx = 0; idx < TEST_NUM_OBJECTS; idx++)
+        {
+            // objects must not overlap
+            ASSERT_ARE_EQUAL(int, (int)idx, (int)((unsigned char*)objects[idx])[TEST_OBJECT_SIZE - 1], "Line:" TOSTRING(__LINE__));
+        }
+
+        // cleanup
+        hsm_slab_destroy(slab);
+    }
+
+    TEST_FUNCTION(hsm_slab_free_reuses_objects)
+    {
+        // arrange
+        void *object_1;
+        void *object_2;
+        HSM_SLAB_HANDLE slab = hsm_slab_create(TEST_OBJECT_SIZE, TEST_OBJECTS_PER_PAGE);
+        ASSERT_IS_NOT_NULL(slab, "Line:" TOSTRING(__LINE__));
+        object_1 = hsm_slab_alloc(slab);
+        ASSERT_IS_NOT_NULL(object_1, "Line:" TOSTRING(__LINE__));
+        umock_c_reset_all_calls();
+
+        // act
+        hsm_slab_free(slab, object_1);
+        object_2 = hsm_slab_alloc(slab);
+
+        // assert
+        ASSERT_ARE_EQUAL(void_ptr, object_1, object_2, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, hsm_slab_count(slab), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_slab_destroy(slab);
+    }
+
+    TEST_FUNCTION(hsm_slab_alloc_page_failure_returns_null)
+    {
+        // arrange
+        void *object;
+        HSM_SLAB_HANDLE slab = hsm_slab_create(TEST_OBJECT_SIZE, TEST_OBJECTS_PER_PAGE);
+        ASSERT_IS_NOT_NULL(slab, "Line:" TOSTRING(__LINE__));
+        umock_c_reset_all_calls();
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)).SetReturn(NULL);
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+        // act, assert
+        ASSERT_IS_NULL(hsm_slab_alloc(slab), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 0, hsm_slab_count(slab), "Line:" TOSTRING(__LINE__));
+        object = hsm_slab_alloc(slab);
+        ASSERT_IS_NOT_NULL(object, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_slab_destroy(slab);
+    }
+
+    TEST_FUNCTION(hsm_slab_create_secure_fills_system_pages)
+    {
+        // arrange
+        size_t idx;
+        void *objects[TEST_NUM_OBJECTS];
+        HSM_SLAB_HANDLE slab;
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+        // act
+        slab = hsm_slab_create_secure(TEST_OBJECT_SIZE, TEST_OBJECTS_PER_PAGE);
+        ASSERT_IS_NOT_NULL(slab, "Line:" TOSTRING(__LINE__));
+        for (idx = 0; idx < TEST_NUM_OBJECTS; idx++)
+        {
+            objects[idx] = hsm_slab_alloc(slab);
+            ASSERT_IS_NOT_NULL(objects[idx], "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, 0, ((size_t)objects[idx]) % 16, "Line:" TOSTRING(__LINE__));
+        }
+
+        // assert
+        // secure pages are not taken from the heap and a single system page
+        // holds more objects than requested per page
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, TEST_NUM_OBJECTS, hsm_slab_count(slab), "Line:" TOSTRING(__LINE__));
+        for (idx = 1; idx < TEST_NUM_OBJECTS; idx++)
+        {
+            ASSERT_ARE_EQUAL(size_t, 16 * ((TEST_OBJECT_SIZE + 15) / 16),
+                             (size_t)((unsigned char*)objects[idx] - (unsigned char*)objects[idx - 1]),
+                             "Line:" TOSTRING(__LINE__));
+        }
+
+        // cleanup
+        hsm_slab_destroy(slab);
+    }
+
+    TEST_FUNCTION(hsm_slab_free_secure_zeroizes_objects)
+    {
+        // arrange
+        size_t idx;
+        unsigned char *object_1;
+        unsigned char *object_2;
+        HSM_SLAB_HANDLE slab = hsm_slab_create_secure(TEST_OBJECT_SIZE, TEST_OBJECTS_PER_PAGE);
+        ASSERT_IS_NOT_NULL(slab, "Line:" TOSTRING(__LINE__));
+        object_1 = (unsigned char*)hsm_slab_alloc(slab);
+        ASSERT_IS_NOT_NULL(object_1, "Line:" TOSTRING(__LINE__));
+        memset(object_1, 0xA5, TEST_OBJECT_SIZE);
+        umock_c_reset_all_calls();
+
+        // act
+        hsm_slab_free(slab, object_1);
+        object_2 = (unsigned char*)hsm_slab_alloc(slab);
+
+        // assert
+        ASSERT_ARE_EQUAL(void_ptr, object_1, object_2, "Line:" TOSTRING(__LINE__));
+        for (idx = 0; idx < TEST_OBJECT_SIZE; idx++)
+        {
+            ASSERT_ARE_EQUAL(int, 0, (int)object_2[idx], "Line:" TOSTRING(__LINE__));
+        }
+        ASSERT_ARE_EQUAL(size_t, 1, hsm_slab_count(slab), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        hsm_slab_destroy(slab);
+    }
+
+END_TEST_SUITE(hsm_slab_ut)
@@ -0,0 +1,417 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//#############################################################################
+// Memory allocator test hooks
+//#############################################################################
+
+static void* test_hook_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void* test_hook_gballoc_calloc(size_t num, size_t size)
+{
+    return calloc(num, size);
+}
+
+static void* test_hook_gballoc_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void test_hook_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umock_c_negative_tests.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+//#############################################################################
+// Declare and enable MOCK definitions
+//#############################################################################
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+
+#include "hsm_store_index.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+
+#define TEST_NUM_KEYS 200
+#define TEST_KEY_SIZE 32
+#define TEST_VALUE_1 (void*)0x1001
+#define TEST_VALUE_2 (void*)0x1002
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static size_t g_destroyed_values = 0;
+
+//#############################################################################
+// Mocked functions test hooks
+//#############################################################################
+
+static void test_hook_on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s",
+                   ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+//#############################################################################
+// Test helpers
+//#############################################################################
+
+static void test_helper_destroy_value(void *value)
+{
+    (void)value;
+    g_destroyed_values++;
+}
+
+static int test_helper_visit_value(void *value, void *context)
+{
+    size_t *visited = (size_t*)context;
+    (void)value;
+    (*visited)++;
+    return (*visited == 2) ? __LINE__ : 0;
+}
+
+static char* test_helper_make_keys(size_t num_keys)
+{
+    size_t idx;
+    char *result = (char*)malloc(num_keys * TEST_KEY_SIZE);
+    ASSERT_IS_NOT_NULL(result, "Line:" TOSTRING(__LINE__));
+    for (idx = 0; idx < num_keys; idx++)
+    {
+        (void)snprintf(result + (idx * TEST_KEY_SIZE), TEST_KEY_SIZE, "test_alias_%zu", idx);
+    }
+    return result;
+}
+
+//#############################################################################
+// Test cases
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_store_index_ut)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(test_hook_on_umock_c_error);
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_charptr_register_types());
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_stdint_register_types());
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, test_hook_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_calloc, test_hook_gballoc_calloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_calloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, test_hook_gballoc_realloc);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_realloc, NULL);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, test_hook_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+        }
+
+        umock_c_reset_all_calls();
+        g_destroyed_values = 0;
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(store_index_create_success)
+    {
+        // arrange
+        STORE_INDEX_HANDLE index;
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
+
+        // act
+        index = store_index_create();
+
+        // assert
+        ASSERT_IS_NOT_NULL(index, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 0, store_index_count(index), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        store_index_destroy(index, NULL);
+    }
+
+    TEST_FUNCTION(store_index_create_negative)
+    {
+        // arrange
+        int test_result = umock_c_negative_tests_init();
+        ASSERT_ARE_EQUAL(int, 0, test_result);
+        size_t i;
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
+        umock_c_negative_tests_snapshot();
+
+        for (i = 0; i < umock_c_negative_tests_call_count(); i++)
+        {
+            umock_c_negative_tests_reset();
+            umock_c_negative_tests_fail_call(i);
+
+            // act
+            STORE_INDEX_HANDLE index = store_index_create();
+
+            // assert
+            ASSERT_IS_NULL(index, "Line:" TOSTRING(__LINE__));
+        }
+
+        // cleanup
+        umock_c_negative_tests_deinit();
+    }
+
+    TEST_FUNCTION(store_index_invalid_params)
+    {
+        // arrange
+        STORE_INDEX_HANDLE index = store_index_create();
+        ASSERT_IS_NOT_NULL(index, "Line:" TOSTRING(__LINE__));
+
+        // act, assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, store_index_put(NULL, "a", TEST_VALUE_1, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, store_index_put(index, NULL, TEST_VALUE_1, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, store_index_put(index, "a", NULL, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(store_index_find(NULL, "a"), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(store_index_find(index, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(store_index_remove(NULL, "a"), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(store_index_remove(index, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 0, store_index_count(NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 0, store_index_count(index), "Line:" TOSTRING(__LINE__));
+        store_index_destroy(NULL, NULL);
+
+        // cleanup
+        store_index_destroy(index, NULL);
+    }
+
+    TEST_FUNCTION(store_index_put_find_remove_success)
+    {
+        // arrange
+        int result;
+        void *replaced = TEST_VALUE_2;
+        char lookup_key[] = "test_alias";
+        STORE_INDEX_HANDLE index = store_index_create();
+        ASSERT_IS_NOT_NULL(index, "Line:" TOSTRING(__LINE__));
+        umock_c_reset_all_calls();
+
+        // act
+        result = store_index_put(index, "test_alias", TEST_VALUE_1, &replaced);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(replaced, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, store_index_count(index), "Line:" TOSTRING(__LINE__));
+        // keys are compared by contents and not by address
+        ASSERT_ARE_EQUAL(void_ptr, TEST_VALUE_1, store_index_find(index, lookup_key), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(store_index_find(index, "test_alias_2"), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(void_ptr, TEST_VALUE_1, store_index_remove(index, lookup_key), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(store_index_find(index, "test_alias"), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(store_index_remove(index, "test_alias"), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 0, store_index_count(index), "Line:" TOSTRING(__LINE__));
+        // lookups and updates that fit the index never allocate
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        store_index_destroy(index, NULL);
+    }
+
+    TEST_FUNCTION(store_index_put_replaces_existing_value)
+    {
+        // arrange
+        int result;
+        void *replaced = NULL;
+        STORE_INDEX_HANDLE index = store_index_create();
+        ASSERT_IS_NOT_NULL(index, "Line:" TOSTRING(__LINE__));
+        result = store_index_put(index, "test_alias", TEST_VALUE_1, NULL);
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+
+        // act
+        result = store_index_put(index, "test_alias", TEST_VALUE_2, &replaced);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(void_ptr, TEST_VALUE_1, replaced, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(void_ptr, TEST_VALUE_2, store_index_find(index, "test_alias"), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, store_index_count(index), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        store_index_destroy(index, NULL);
+    }
+
+    TEST_FUNCTION(store_index_grows_and_keeps_entries)
+    {
+        // arrange
+        size_t idx;
+        char *keys = test_helper_make_keys(TEST_NUM_KEYS);
+        STORE_INDEX_HANDLE index = store_index_create();
+        ASSERT_IS_NOT_NULL(index, "Line:" TOSTRING(__LINE__));
+
+        // act
+        for (idx = 0; idx < TEST_NUM_KEYS; idx++)
+        {
+            int result = store_index_put(index, keys + (idx * TEST_KEY_SIZE), (void*)(keys + (idx * TEST_KEY_SIZE)), NULL);
+            ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        }
+        for (idx = 0; idx < TEST_NUM_KEYS; idx += 2)
+        {
+            void *value = store_index_remove(index, keys + (idx * TEST_KEY_SIZE));
+            ASSERT_ARE_EQUAL(void_ptr, (void*)(keys + (idx * TEST_KEY_SIZE)), value, "Line:" TOSTRING(__LINE__));
+        }
+
+        // assert
+        ASSERT_ARE_EQUAL(size_t, TEST_NUM_KEYS / 2, store_index_count(index), "Line:" TOSTRING(__LINE__));
+        for (idx = 0; idx < TEST_NUM_KEYS; idx++)
+        {
+            void *expected = (idx % 2 == 0) ? NULL : (void*)(keys + (idx * TEST_KEY_SIZE));
+            ASSERT_ARE_EQUAL(void_ptr, expected, store_index_find(index, keys + (idx * TEST_KEY_SIZE)), "Line:" TOSTRING(__LINE__));
+        }
+
+        // cleanup
+        store_index_destroy(index, NULL);
+        free(keys);
+    }
+
+    TEST_FUNCTION(store_index_put_grow_failure_keeps_entries)
+    {
+        // arrange
+        size_t idx;
+        int result = 0;
+        char *keys = test_helper_make_keys(TEST_NUM_KEYS);
+        STORE_INDEX_HANDLE index = store_index_create();
+        ASSERT_IS_NOT_NULL(index, "Line:" TOSTRING(__LINE__));
+        umock_c_reset_all_calls();
+        EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG)).SetReturn(NULL);
+
+        // act
+        for (idx = 0; (idx < TEST_NUM_KEYS) && (result == 0); idx++)
+        {
+            result = store_index_put(index, keys + (idx * TEST_KEY_SIZE), TEST_VALUE_1, NULL);
+        }
+
+        // assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, idx - 1, store_index_count(index), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(store_index_find(index, keys + ((idx - 1) * TEST_KEY_SIZE)), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(void_ptr, TEST_VALUE_1, store_index_find(index, keys), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls(), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        store_index_destroy(index, NULL);
+        free(keys);
+    }
+
+    TEST_FUNCTION(store_index_destroy_releases_values)
+    {
+        // arrange
+        STORE_INDEX_HANDLE index = store_index_create();
+        ASSERT_IS_NOT_NULL(index, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, store_index_put(index, "test_alias_1", TEST_VALUE_1, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, store_index_put(index, "test_alias_2", TEST_VALUE_2, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, store_index_put(index, "test_alias_3", TEST_VALUE_2, NULL), "Line:" TOSTRING(__LINE__));
+        (void)store_index_remove(index, "test_alias_3");
+
+        // act
+        store_index_destroy(index, test_helper_destroy_value);
+
+        // assert
+        ASSERT_ARE_EQUAL(size_t, 2, g_destroyed_values, "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+    }
+
+    TEST_FUNCTION(store_index_foreach_visits_entries_until_stopped)
+    {
+        // arrange
+        int result;
+        size_t visited = 0;
+        STORE_INDEX_HANDLE index = store_index_create();
+        ASSERT_IS_NOT_NULL(index, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, store_index_put(index, "test_alias_1", TEST_VALUE_1, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, store_index_put(index, "test_alias_2", TEST_VALUE_2, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, store_index_put(index, "test_alias_3", TEST_VALUE_2, NULL), "Line:" TOSTRING(__LINE__));
+
+        // act
+        result = store_index_foreach(index, test_helper_visit_value, &visited);
+
+        // assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 2, visited, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, store_index_foreach(NULL, test_helper_visit_value, &visited), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, store_index_foreach(index, NULL, &visited), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        store_index_destroy(index, NULL);
+    }
+
+    TEST_FUNCTION(store_index_clone_is_independent_of_original)
+    {
+        // arrange
+        STORE_INDEX_HANDLE clone;
+        STORE_INDEX_HANDLE index = store_index_create();
+        ASSERT_IS_NOT_NULL(index, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, store_index_put(index, "test_alias_1", TEST_VALUE_1, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, store_index_put(index, "test_alias_2", TEST_VALUE_2, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(void_ptr, TEST_VALUE_2, store_index_remove(index, "test_alias_2"), "Line:" TOSTRING(__LINE__));
+
+        // act
+        clone = store_index_clone(index);
+        ASSERT_IS_NOT_NULL(clone, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, store_index_put(clone, "test_alias_2", TEST_VALUE_2, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(void_ptr, TEST_VALUE_1, store_index_remove(clone, "test_alias_1"), "Line:" TOSTRING(__LINE__));
+
+        // assert
+        ASSERT_ARE_EQUAL(size_t, 1, store_index_count(index), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(void_ptr, TEST_VALUE_1, store_index_find(index, "test_alias_1"), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(store_index_find(index, "test_alias_2"), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, 1, store_index_count(clone), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(void_ptr, TEST_VALUE_2, store_index_find(clone, "test_alias_2"), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(store_index_find(clone, "test_alias_1"), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(store_index_clone(NULL), "Line:" TOSTRING(__LINE__));
+
+        // cleanup
+        store_index_destroy(clone, NULL);
+        store_index_destroy(index, NULL);
+    }
+
+END_TEST_SUITE(hsm_store_index_ut)
@@ -0,0 +1,388 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "test_utils.h"
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "hsm_key_mem.h"
+#include "hsm_log.h"
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+
+#include "hsm_store_log.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+
+#define TEST_LOG_FILE_NAME "test_store.log"
+static char *TEST_LOG_FILE = NULL;
+
+#define TEST_KEY_1 "key-1"
+#define TEST_KEY_2 "key-2"
+
+static unsigned char TEST_VALUE_1[] = { 'A', 'B', 'C', 'D' };
+static unsigned char TEST_VALUE_2[] = { '1', '2', '3', '4', '5', '6' };
+
+#define TEST_NUM_THREADS 4
+#define TEST_KEYS_PER_THREAD 50
+
+typedef struct PUT_THREAD_CONTEXT_TAG
+{
+    HSM_STORE_LOG_HANDLE log;
+    int thread_id;
+} PUT_THREAD_CONTEXT;
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static char* TEST_TEMP_DIR = NULL;
+static char* TEST_TEMP_DIR_GUID = NULL;
+
+//#############################################################################
+// Test helpers
+//#############################################################################
+
+static void test_helper_setup_testdir(void)
+{
+    TEST_TEMP_DIR = hsm_test_util_create_temp_dir(&TEST_TEMP_DIR_GUID);
+    ASSERT_IS_NOT_NULL(TEST_TEMP_DIR_GUID, "Line:" TOSTRING(__LINE__));
+    ASSERT_IS_NOT_NULL(TEST_TEMP_DIR, "Line:" TOSTRING(__LINE__));
+    printf("Temp dir created: [%s]\r\n", TEST_TEMP_DIR);
+}
+
+static void test_helper_teardown_testdir(void)
+{
+    if ((TEST_TEMP_DIR != NULL) && (TEST_TEMP_DIR_GUID != NULL))
+    {
+        hsm_test_util_delete_dir(TEST_TEMP_DIR_GUID);
+        free(TEST_TEMP_DIR);
+        TEST_TEMP_DIR = NULL;
+        free(TEST_TEMP_DIR_GUID);
+        TEST_TEMP_DIR_GUID = NULL;
+    }
+}
+
+static char* prepare_file_path(const char* base_dir, const char* file_name)
+{
+    size_t path_size = get_max_file_path_size();
+    char *file_path = calloc(path_size, 1);
+    ASSERT_IS_NOT_NULL(file_path, "Line:" TOSTRING(__LINE__));
+    int status = snprintf(file_path, path_size, "%s%s", base_dir, file_name);
+    ASSERT_IS_TRUE(((status > 0) || (status < (int)path_size)), "Line:" TOSTRING(__LINE__));
+
+    return file_path;
+}
+
+static long test_helper_get_file_size(const char *file_name)
+{
+    FILE *file_handle = fopen(file_name, "rb");
+    ASSERT_IS_NOT_NULL(file_handle, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, fseek(file_handle, 0, SEEK_END), "Line:" TOSTRING(__LINE__));
+    long result = ftell(file_handle);
+    fclose(file_handle);
+
+    return result;
+}
+
+static void test_helper_append_to_file(const char *file_name, const unsigned char *data, size_t data_size)
+{
+    FILE *file_handle = fopen(file_name, "ab");
+    ASSERT_IS_NOT_NULL(file_handle, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(size_t, data_size, fwrite(data, 1, data_size, file_handle), "Line:" TOSTRING(__LINE__));
+    fclose(file_handle);
+}
+
+static void test_helper_flip_byte(const char *file_name, long offset)
+{
+    FILE *file_handle = fopen(file_name, "r+b");
+    ASSERT_IS_NOT_NULL(file_handle, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, fseek(file_handle, offset, SEEK_SET), "Line:" TOSTRING(__LINE__));
+    int value = fgetc(file_handle);
+    ASSERT_ARE_NOT_EQUAL(int, EOF, value, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, fseek(file_handle, offset, SEEK_SET), "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_NOT_EQUAL(int, EOF, fputc(value ^ 0xFF, file_handle), "Line:" TOSTRING(__LINE__));
+    fclose(file_handle);
+}
+
+static void test_helper_assert_value
+(
+    HSM_STORE_LOG_HANDLE log,
+    const char *key,
+    const unsigned char *expected_value,
+    size_t expected_value_size
+)
+{
+    size_t value_size = 0;
+    unsigned char *value = hsm_store_log_get(log, key, &value_size);
+    ASSERT_IS_NOT_NULL(value, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(size_t, expected_value_size, value_size, "Line:" TOSTRING(__LINE__));
+    ASSERT_ARE_EQUAL(int, 0, memcmp(expected_value, value, value_size), "Line:" TOSTRING(__LINE__));
+    hsm_key_mem_free(value, value_size);
+}
+
+static int test_helper_put_thread(void *context)
+{
+    PUT_THREAD_CONTEXT *put_context = (PUT_THREAD_CONTEXT*)context;
+    int result = 0;
+    int idx;
+    char key[32];
+
+    for (idx = 0; (result == 0) && (idx < TEST_KEYS_PER_THREAD); idx++)
+    {
+        (void)snprintf(key, sizeof(key), "key-%d-%d", put_context->thread_id, idx);
+        result = hsm_store_log_put(put_context->log, key, TEST_VALUE_1, sizeof(TEST_VALUE_1));
+    }
+
+    return result;
+}
+
+//#############################################################################
+// Test cases
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_store_log_int_tests)
+
+        TEST_SUITE_INITIALIZE(TestClassInitialize)
+        {
+            TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+            g_testByTest = TEST_MUTEX_CREATE();
+            ASSERT_IS_NOT_NULL(g_testByTest);
+
+            test_helper_setup_testdir();
+            TEST_LOG_FILE = prepare_file_path(TEST_TEMP_DIR, TEST_LOG_FILE_NAME);
+        }
+
+        TEST_SUITE_CLEANUP(TestClassCleanup)
+        {
+            free(TEST_LOG_FILE); TEST_LOG_FILE = NULL;
+            test_helper_teardown_testdir();
+            TEST_MUTEX_DESTROY(g_testByTest);
+            TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        }
+
+        TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+        {
+            if (TEST_MUTEX_ACQUIRE(g_testByTest))
+            {
+                ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+            }
+            (void)remove(TEST_LOG_FILE);
+        }
+
+        TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+        {
+            (void)remove(TEST_LOG_FILE);
+            TEST_MUTEX_RELEASE(g_testByTest);
+        }
+
+        TEST_FUNCTION(hsm_store_log_invalid_params)
+        {
+            // arrange
+            size_t value_size = 0;
+            HSM_STORE_LOG_HANDLE log = hsm_store_log_open(TEST_LOG_FILE);
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+
+            // act, assert
+            ASSERT_IS_NULL(hsm_store_log_open(NULL), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(hsm_store_log_open(""), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_NOT_EQUAL(int, 0, hsm_store_log_put(NULL, TEST_KEY_1, TEST_VALUE_1, sizeof(TEST_VALUE_1)), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_NOT_EQUAL(int, 0, hsm_store_log_put(log, NULL, TEST_VALUE_1, sizeof(TEST_VALUE_1)), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_NOT_EQUAL(int, 0, hsm_store_log_put(log, "", TEST_VALUE_1, sizeof(TEST_VALUE_1)), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_NOT_EQUAL(int, 0, hsm_store_log_put(log, TEST_KEY_1, NULL, sizeof(TEST_VALUE_1)), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_NOT_EQUAL(int, 0, hsm_store_log_put(log, TEST_KEY_1, TEST_VALUE_1, 0), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_NOT_EQUAL(int, 0, hsm_store_log_remove(log, TEST_KEY_1), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(hsm_store_log_get(log, TEST_KEY_1, &value_size), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(hsm_store_log_get(log, TEST_KEY_1, NULL), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_FALSE(hsm_store_log_contains(NULL, TEST_KEY_1), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_FALSE(hsm_store_log_contains(log, NULL), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_NOT_EQUAL(int, 0, hsm_store_log_compact(NULL), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, 0, hsm_store_log_count(log), "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            hsm_store_log_close(log);
+        }
+
+        TEST_FUNCTION(hsm_store_log_put_remove_persist_across_open)
+        {
+            // arrange
+            HSM_STORE_LOG_HANDLE log = hsm_store_log_open(TEST_LOG_FILE);
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+
+            // act
+            ASSERT_ARE_EQUAL(int, 0, hsm_store_log_put(log, TEST_KEY_1, TEST_VALUE_2, sizeof(TEST_VALUE_2)), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, hsm_store_log_put(log, TEST_KEY_2, TEST_VALUE_2, sizeof(TEST_VALUE_2)), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, hsm_store_log_put(log, TEST_KEY_1, TEST_VALUE_1, sizeof(TEST_VALUE_1)), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, hsm_store_log_remove(log, TEST_KEY_2), "Line:" TOSTRING(__LINE__));
+            hsm_store_log_close(log);
+            log = hsm_store_log_open(TEST_LOG_FILE);
+
+            // assert
+            size_t value_size = 0;
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, 1, hsm_store_log_count(log), "Line:" TOSTRING(__LINE__));
+            test_helper_assert_value(log, TEST_KEY_1, TEST_VALUE_1, sizeof(TEST_VALUE_1));
+            ASSERT_IS_NULL(hsm_store_log_get(log, TEST_KEY_2, &value_size), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_TRUE(hsm_store_log_contains(log, TEST_KEY_1), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_FALSE(hsm_store_log_contains(log, TEST_KEY_2), "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            hsm_store_log_close(log);
+        }
+
+        TEST_FUNCTION(hsm_store_log_open_truncates_torn_record)
+        {
+            // arrange
+            static const unsigned char torn_record[] = { 0x4C, 0x53, 0x53, 0x52, 0x01, 0x00 };
+            HSM_STORE_LOG_HANDLE log = hsm_store_log_open(TEST_LOG_FILE);
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, hsm_store_log_put(log, TEST_KEY_1, TEST_VALUE_1, sizeof(TEST_VALUE_1)), "Line:" TOSTRING(__LINE__));
+            hsm_store_log_close(log);
+            long valid_size = test_helper_get_file_size(TEST_LOG_FILE);
+            test_helper_append_to_file(TEST_LOG_FILE, torn_record, sizeof(torn_record));
+
+            // act
+            log = hsm_store_log_open(TEST_LOG_FILE);
+
+            // assert
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(long, valid_size, test_helper_get_file_size(TEST_LOG_FILE), "Line:" TOSTRING(__LINE__));
+            test_helper_assert_value(log, TEST_KEY_1, TEST_VALUE_1, sizeof(TEST_VALUE_1));
+            ASSERT_ARE_EQUAL(int, 0, hsm_store_log_put(log, TEST_KEY_2, TEST_VALUE_2, sizeof(TEST_VALUE_2)), "Line:" TOSTRING(__LINE__));
+            hsm_store_log_close(log);
+            log = hsm_store_log_open(TEST_LOG_FILE);
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, 2, hsm_store_log_count(log), "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            hsm_store_log_close(log);
+        }
+
+        TEST_FUNCTION(hsm_store_log_open_keeps_log_corrupt_in_the_middle)
+        {
+            // arrange
+            HSM_STORE_LOG_HANDLE log = hsm_store_log_open(TEST_LOG_FILE);
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, hsm_store_log_put(log, TEST_KEY_1, TEST_VALUE_1, sizeof(TEST_VALUE_1)), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, hsm_store_log_put(log, TEST_KEY_2, TEST_VALUE_2, sizeof(TEST_VALUE_2)), "Line:" TOSTRING(__LINE__));
+            hsm_store_log_close(log);
+            long file_size = test_helper_get_file_size(TEST_LOG_FILE);
+            // first byte of the key of the first record, after the 8 byte
+            // file header and the 16 byte record header
+            test_helper_flip_byte(TEST_LOG_FILE, 24);
+
+            // act
+            log = hsm_store_log_open(TEST_LOG_FILE);
+
+            // assert
+            ASSERT_IS_NULL(log, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(long, file_size, test_helper_get_file_size(TEST_LOG_FILE), "Line:" TOSTRING(__LINE__));
+        }
+
+        TEST_FUNCTION(hsm_store_log_open_rejects_invalid_header)
+        {
+            // arrange
+            static const unsigned char bad_header[] = { 'N', 'O', 'T', 'A', 'L', 'O', 'G', '!' };
+            test_helper_append_to_file(TEST_LOG_FILE, bad_header, sizeof(bad_header));
+
+            // act
+            HSM_STORE_LOG_HANDLE log = hsm_store_log_open(TEST_LOG_FILE);
+
+            // assert
+            ASSERT_IS_NULL(log, "Line:" TOSTRING(__LINE__));
+        }
+
+        TEST_FUNCTION(hsm_store_log_compact_drops_superseded_records)
+        {
+            // arrange
+            int idx;
+            HSM_STORE_LOG_HANDLE log = hsm_store_log_open(TEST_LOG_FILE);
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, hsm_store_log_put(log, TEST_KEY_2, TEST_VALUE_2, sizeof(TEST_VALUE_2)), "Line:" TOSTRING(__LINE__));
+            for (idx = 0; idx < 100; idx++)
+            {
+                ASSERT_ARE_EQUAL(int, 0, hsm_store_log_put(log, TEST_KEY_1, TEST_VALUE_1, sizeof(TEST_VALUE_1)), "Line:" TOSTRING(__LINE__));
+            }
+            long uncompacted_size = test_helper_get_file_size(TEST_LOG_FILE);
+
+            // act
+            int result = hsm_store_log_compact(log);
+
+            // assert
+            ASSERT_ARE_EQUAL(int, 0, result, "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_TRUE((test_helper_get_file_size(TEST_LOG_FILE) < uncompacted_size / 10), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, hsm_store_log_put(log, TEST_KEY_1, TEST_VALUE_2, sizeof(TEST_VALUE_2)), "Line:" TOSTRING(__LINE__));
+            hsm_store_log_close(log);
+            log = hsm_store_log_open(TEST_LOG_FILE);
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, 2, hsm_store_log_count(log), "Line:" TOSTRING(__LINE__));
+            test_helper_assert_value(log, TEST_KEY_1, TEST_VALUE_2, sizeof(TEST_VALUE_2));
+            test_helper_assert_value(log, TEST_KEY_2, TEST_VALUE_2, sizeof(TEST_VALUE_2));
+
+            // cleanup
+            hsm_store_log_close(log);
+        }
+
+#if !(defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows)
+        TEST_FUNCTION(hsm_store_log_open_fails_while_log_is_open)
+        {
+            // arrange
+            HSM_STORE_LOG_HANDLE log = hsm_store_log_open(TEST_LOG_FILE);
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+
+            // act, assert
+            ASSERT_IS_NULL(hsm_store_log_open(TEST_LOG_FILE), "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(int, 0, hsm_store_log_compact(log), "Line:" TOSTRING(__LINE__));
+            ASSERT_IS_NULL(hsm_store_log_open(TEST_LOG_FILE), "Line:" TOSTRING(__LINE__));
+            hsm_store_log_close(log);
+            log = hsm_store_log_open(TEST_LOG_FILE);
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            hsm_store_log_close(log);
+        }
+#endif
+
+        TEST_FUNCTION(hsm_store_log_concurrent_puts_all_persisted)
+        {
+            // arrange
+            THREAD_HANDLE threads[TEST_NUM_THREADS];
+            PUT_THREAD_CONTEXT contexts[TEST_NUM_THREADS];
+            int idx;
+            HSM_STORE_LOG_HANDLE log = hsm_store_log_open(TEST_LOG_FILE);
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+
+            // act
+            for (idx = 0; idx < TEST_NUM_THREADS; idx++)
+            {
+                contexts[idx].log = log;
+                contexts[idx].thread_id = idx;
+                ASSERT_ARE_EQUAL(int, THREADAPI_OK, ThreadAPI_Create(&threads[idx], test_helper_put_thread, &contexts[idx]), "Line:" TOSTRING(__LINE__));
+            }
+            for (idx = 0; idx < TEST_NUM_THREADS; idx++)
+            {
+                int thread_result = -1;
+                ASSERT_ARE_EQUAL(int, THREADAPI_OK, ThreadAPI_Join(threads[idx], &thread_result), "Line:" TOSTRING(__LINE__));
+                ASSERT_ARE_EQUAL(int, 0, thread_result, "Line:" TOSTRING(__LINE__));
+            }
+
+            // assert
+            ASSERT_ARE_EQUAL(size_t, TEST_NUM_THREADS * TEST_KEYS_PER_THREAD, hsm_store_log_count(log), "Line:" TOSTRING(__LINE__));
+            hsm_store_log_close(log);
+            log = hsm_store_log_open(TEST_LOG_FILE);
+            ASSERT_IS_NOT_NULL(log, "Line:" TOSTRING(__LINE__));
+            ASSERT_ARE_EQUAL(size_t, TEST_NUM_THREADS * TEST_KEYS_PER_THREAD, hsm_store_log_count(log), "Line:" TOSTRING(__LINE__));
+
+            // cleanup
+            hsm_store_log_close(log);
+        }
+
+END_TEST_SUITE(hsm_store_log_int_tests)
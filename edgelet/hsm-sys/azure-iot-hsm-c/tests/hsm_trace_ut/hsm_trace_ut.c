@@ -0,0 +1,246 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+
+//#############################################################################
+// Interface(s) under test
+//#############################################################################
+
+#include "hsm_client_data.h"
+#include "hsm_trace.h"
+
+//#############################################################################
+// Test defines and data
+//#############################################################################
+
+#define TEST_MAX_EVENTS 16
+#define TEST_INPUT_SIZE 32
+#define TEST_OUTPUT_SIZE 64
+#define TEST_RESULT_FAILURE 5
+
+struct TEST_EVENT_TAG
+{
+    int is_begin;
+    HSM_TRACE_SPAN span;
+    char target[64];
+    void *context;
+};
+typedef struct TEST_EVENT_TAG TEST_EVENT;
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static void *TEST_CONTEXT = (void*)0x1000;
+static const unsigned char TEST_IDENTITY[] = { 'm', 'o', 'd', 'u', 'l', 'e', '1' };
+static int g_num_events = 0;
+static TEST_EVENT g_events[TEST_MAX_EVENTS];
+
+//#############################################################################
+// Mocked functions test hooks
+//#############################################################################
+
+static void test_hook_on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s",
+                   ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+static void record_event(int is_begin, const HSM_TRACE_SPAN *span, void *context)
+{
+    if (g_num_events < TEST_MAX_EVENTS)
+    {
+        TEST_EVENT *event = &g_events[g_num_events++];
+        event->is_begin = is_begin;
+        event->span = *span;
+        (void)snprintf(event->target, sizeof(event->target), "%s", (span->target != NULL) ? span->target : "");
+        event->context = context;
+    }
+}
+
+static void test_hook_on_begin(const HSM_TRACE_SPAN *span, void *context)
+{
+    record_event(1, span, context);
+}
+
+static void test_hook_on_end(const HSM_TRACE_SPAN *span, void *context)
+{
+    record_event(0, span, context);
+}
+
+//#############################################################################
+// Test cases
+//#############################################################################
+
+BEGIN_TEST_SUITE(hsm_trace_ut)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(test_hook_on_umock_c_error);
+        ASSERT_ARE_EQUAL(int, 0, umocktypes_charptr_register_types());
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        umock_c_deinit();
+
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest))
+        {
+            ASSERT_FAIL("Mutex is ABANDONED. Failure in test framework.");
+        }
+
+        umock_c_reset_all_calls();
+        g_num_events = 0;
+        memset(g_events, 0, sizeof(g_events));
+        ASSERT_ARE_EQUAL(int, 0, hsm_set_trace_callbacks(test_hook_on_begin, test_hook_on_end, TEST_CONTEXT), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        (void)hsm_set_trace_callbacks(NULL, NULL, NULL);
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    TEST_FUNCTION(hsm_set_trace_callbacks_requires_both_callbacks)
+    {
+        // act, assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, hsm_set_trace_callbacks(test_hook_on_begin, NULL, NULL), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_NOT_EQUAL(int, 0, hsm_set_trace_callbacks(NULL, test_hook_on_end, NULL), "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_trace_without_callbacks_reports_nothing)
+    {
+        // arrange
+        HSM_TRACE_SCOPE trace;
+        ASSERT_ARE_EQUAL(int, 0, hsm_set_trace_callbacks(NULL, NULL, NULL), "Line:" TOSTRING(__LINE__));
+
+        // act
+        HSM_TRACE_BEGIN(&trace, "test.operation", "alias", TEST_INPUT_SIZE);
+        HSM_TRACE_END(&trace, TEST_OUTPUT_SIZE, 0);
+
+        // assert
+        ASSERT_IS_FALSE(trace.active, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, g_num_events, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_trace_reports_begin_and_end)
+    {
+        // arrange
+        HSM_TRACE_SCOPE trace;
+
+        // act
+        HSM_TRACE_BEGIN(&trace, "test.operation", "alias", TEST_INPUT_SIZE);
+        HSM_TRACE_END(&trace, TEST_OUTPUT_SIZE, TEST_RESULT_FAILURE);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 2, g_num_events, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 1, g_events[0].is_begin, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, "test.operation", g_events[0].span.name, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, "alias", g_events[0].target, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, TEST_INPUT_SIZE, g_events[0].span.input_size, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(g_events[0].span.id != 0, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(g_events[0].span.parent_id == 0, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(void_ptr, TEST_CONTEXT, g_events[0].context, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, g_events[1].is_begin, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(g_events[1].span.id == g_events[0].span.id, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, TEST_OUTPUT_SIZE, g_events[1].span.output_size, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, TEST_RESULT_FAILURE, g_events[1].span.result, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(void_ptr, TEST_CONTEXT, g_events[1].context, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(hsm_trace_current_span() == 0, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_trace_nested_operations_report_parent)
+    {
+        // arrange
+        HSM_TRACE_SCOPE outer, inner, next;
+
+        // act
+        HSM_TRACE_BEGIN(&outer, "test.outer", NULL, 0);
+        HSM_TRACE_BEGIN(&inner, "test.inner", NULL, 0);
+        HSM_TRACE_END(&inner, 0, 0);
+        HSM_TRACE_BEGIN(&next, "test.next", NULL, 0);
+        HSM_TRACE_END(&next, 0, 0);
+        HSM_TRACE_END(&outer, 0, 0);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 6, g_num_events, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(g_events[0].span.parent_id == 0, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(g_events[1].span.parent_id == g_events[0].span.id, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(g_events[1].span.id != g_events[0].span.id, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(g_events[3].span.parent_id == g_events[0].span.id, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(g_events[5].span.id == g_events[0].span.id, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(hsm_trace_current_span() == 0, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_trace_child_reports_given_parent)
+    {
+        // arrange
+        HSM_TRACE_SCOPE outer, child;
+
+        // act
+        HSM_TRACE_BEGIN(&outer, "test.outer", NULL, 0);
+        HSM_TRACE_BEGIN_CHILD(&child, 12345, "test.child", NULL, 0);
+        HSM_TRACE_END(&child, 0, 0);
+        HSM_TRACE_END(&outer, 0, 0);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 4, g_num_events, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(g_events[1].span.parent_id == 12345, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_trace_identity_reported_as_hash)
+    {
+        // arrange
+        HSM_TRACE_SCOPE first, second;
+
+        // act
+        HSM_TRACE_BEGIN_IDENTITY(&first, "test.identity", TEST_IDENTITY, sizeof(TEST_IDENTITY), TEST_INPUT_SIZE);
+        HSM_TRACE_END(&first, 0, 0);
+        HSM_TRACE_BEGIN_IDENTITY(&second, "test.identity", TEST_IDENTITY, sizeof(TEST_IDENTITY), TEST_INPUT_SIZE);
+        HSM_TRACE_END(&second, 0, 0);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 4, g_num_events, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, HSM_TRACE_TARGET_SIZE - 1, strlen(g_events[0].target), "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_NULL(strstr(g_events[0].target, "module1"), "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(char_ptr, g_events[0].target, g_events[2].target, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(size_t, TEST_INPUT_SIZE, g_events[0].span.input_size, "Line:" TOSTRING(__LINE__));
+    }
+
+    TEST_FUNCTION(hsm_trace_end_goes_to_callbacks_of_begin)
+    {
+        // arrange
+        HSM_TRACE_SCOPE trace;
+        HSM_TRACE_BEGIN(&trace, "test.operation", NULL, 0);
+
+        // act
+        ASSERT_ARE_EQUAL(int, 0, hsm_set_trace_callbacks(NULL, NULL, NULL), "Line:" TOSTRING(__LINE__));
+        HSM_TRACE_END(&trace, 0, 0);
+
+        // assert
+        ASSERT_ARE_EQUAL(int, 2, g_num_events, "Line:" TOSTRING(__LINE__));
+        ASSERT_ARE_EQUAL(int, 0, g_events[1].is_begin, "Line:" TOSTRING(__LINE__));
+        ASSERT_IS_TRUE(hsm_trace_current_span() == 0, "Line:" TOSTRING(__LINE__));
+    }
+
+END_TEST_SUITE(hsm_trace_ut)
@@ -0,0 +1,54 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef BENCH_CASES_H
+#define BENCH_CASES_H
+
+#include "bench_utils.h"
+
+/**
+ * Each group initializes the interfaces it measures, runs its selected cases
+ * and de-initializes them again. Groups whose cases are all filtered out do
+ * no setup at all.
+ */
+extern void bench_store_open(const BENCH_OPTIONS* options, BENCH_REPORT* report, const char* home_dir);
+extern void bench_crypto(const BENCH_OPTIONS* options, BENCH_REPORT* report);
+
+/**
+ * Provisions an ECC device CA through the env variables used for externally
+ * provided certificates so that issued certificates get ECC keys as well.
+ */
+extern void bench_crypto_ec(const BENCH_OPTIONS* options, BENCH_REPORT* report, const char* work_dir);
+extern void bench_tpm(const BENCH_OPTIONS* options, BENCH_REPORT* report);
+
+typedef enum BENCH_MIX_OPERATION_TAG
+{
+    BENCH_MIX_SIGN,
+    BENCH_MIX_ENCRYPT,
+    BENCH_MIX_CERT,
+    BENCH_MIX_NUM_OPERATIONS
+} BENCH_MIX_OPERATION;
+
+typedef struct BENCH_SCALING_OPTIONS_TAG
+{
+    // the mixed workload is not run when 0
+    size_t max_threads;
+    double duration_secs;
+    // relative share of each operation in the workload
+    unsigned int weights[BENCH_MIX_NUM_OPERATIONS];
+} BENCH_SCALING_OPTIONS;
+
+/**
+ * Parses a mix such as "sign:70,encrypt:25,cert:5" into scaling->weights,
+ * operations left out get no share.
+ */
+extern int bench_parse_mix(const char* mix, BENCH_SCALING_OPTIONS* scaling);
+
+/**
+ * Runs the mixed workload from one thread up to scaling->max_threads,
+ * doubling the threads each time, and reports the throughput and latencies
+ * of each run along with the time spent waiting for the locks of the HSM.
+ */
+extern void bench_scaling(const BENCH_OPTIONS* options, const BENCH_SCALING_OPTIONS* scaling, BENCH_REPORT* report);
+
+#endif // BENCH_CASES_H
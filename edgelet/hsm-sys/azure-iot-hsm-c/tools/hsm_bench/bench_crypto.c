@@ -0,0 +1,461 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/asn1.h>
+#include <openssl/bio.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/obj_mac.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#include "bench_cases.h"
+#include "certificate_info.h"
+#include "hsm_certificate_props.h"
+#include "hsm_client_data.h"
+
+#define PAYLOAD_SIZE_COUNT (sizeof(PAYLOAD_SIZES) / sizeof(PAYLOAD_SIZES[0]))
+#define CERT_VALIDITY_SECS 3600
+#define EC_CA_VALIDITY_SECS (24 * 3600)
+#define EC_CA_COMMON_NAME "hsm_bench ECC device CA"
+
+static const size_t PAYLOAD_SIZES[] = { 64, 1024, 16384, 65536 };
+static unsigned char IDENTITY[] = "hsm_bench";
+static unsigned char INIT_VECTOR[] = "hsm_bench_iv_123";
+
+static const char* const ENV_DEVICE_CA_PATH = "IOTEDGE_DEVICE_CA_CERT";
+static const char* const ENV_DEVICE_PK_PATH = "IOTEDGE_DEVICE_CA_PK";
+static const char* const ENV_TRUSTED_CA_CERTS_PATH = "IOTEDGE_TRUSTED_CA_CERTS";
+
+typedef struct CRYPTO_CLIENT_TAG
+{
+    const HSM_CLIENT_CRYPTO_INTERFACE* crypto;
+    HSM_CLIENT_HANDLE handle;
+    SIZED_BUFFER identity;
+    SIZED_BUFFER iv;
+} CRYPTO_CLIENT;
+
+typedef struct PAYLOAD_CONTEXT_TAG
+{
+    CRYPTO_CLIENT* client;
+    char encrypt_name[BENCH_NAME_SIZE];
+    char decrypt_name[BENCH_NAME_SIZE];
+    SIZED_BUFFER plaintext;
+    SIZED_BUFFER ciphertext;
+} PAYLOAD_CONTEXT;
+
+typedef struct CERT_CONTEXT_TAG
+{
+    CRYPTO_CLIENT* client;
+    const char* alias;
+    CERTIFICATE_TYPE type;
+    size_t iterations;
+    CERT_PROPS_HANDLE props;
+} CERT_CONTEXT;
+
+//##############################################################################
+// Operations
+//##############################################################################
+static int crypto_init(void* context)
+{
+    (void)context;
+    return hsm_client_crypto_init();
+}
+
+static int crypto_deinit(void* context)
+{
+    (void)context;
+    hsm_client_crypto_deinit();
+    return 0;
+}
+
+static int clear_home_dir(void* context)
+{
+    return bench_clear_dir((const char*)context);
+}
+
+static int crypto_deinit_and_clear(void* context)
+{
+    hsm_client_crypto_deinit();
+    return clear_home_dir(context);
+}
+
+static int encrypt_payload(void* context)
+{
+    PAYLOAD_CONTEXT* payload = (PAYLOAD_CONTEXT*)context;
+    CRYPTO_CLIENT* client = payload->client;
+    SIZED_BUFFER ciphertext = { NULL, 0 };
+    int result = client->crypto->hsm_client_encrypt_data(client->handle, &client->identity,
+                                                         &payload->plaintext, &client->iv, &ciphertext);
+    client->crypto->hsm_client_free_buffer(ciphertext.buffer);
+    return result;
+}
+
+static int decrypt_payload(void* context)
+{
+    PAYLOAD_CONTEXT* payload = (PAYLOAD_CONTEXT*)context;
+    CRYPTO_CLIENT* client = payload->client;
+    SIZED_BUFFER plaintext = { NULL, 0 };
+    int result = client->crypto->hsm_client_decrypt_data(client->handle, &client->identity,
+                                                         &payload->ciphertext, &client->iv, &plaintext);
+    client->crypto->hsm_client_free_buffer(plaintext.buffer);
+    return result;
+}
+
+static int create_certificate(void* context)
+{
+    CERT_CONTEXT* cert = (CERT_CONTEXT*)context;
+    CRYPTO_CLIENT* client = cert->client;
+    CERT_INFO_HANDLE cert_info = client->crypto->hsm_client_create_certificate(client->handle, cert->props);
+    certificate_info_destroy(cert_info);
+    return (cert_info != NULL) ? 0 : 1;
+}
+
+static int destroy_certificate(void* context)
+{
+    CERT_CONTEXT* cert = (CERT_CONTEXT*)context;
+    CRYPTO_CLIENT* client = cert->client;
+    client->crypto->hsm_client_destroy_certificate(client->handle, cert->alias);
+    return 0;
+}
+
+static int get_trust_bundle(void* context)
+{
+    CRYPTO_CLIENT* client = (CRYPTO_CLIENT*)context;
+    CERT_INFO_HANDLE cert_info = client->crypto->hsm_client_get_trust_bundle(client->handle);
+    certificate_info_destroy(cert_info);
+    return (cert_info != NULL) ? 0 : 1;
+}
+
+//##############################################################################
+// Setup helpers
+//##############################################################################
+static int open_client(CRYPTO_CLIENT* client)
+{
+    int result;
+
+    client->identity.buffer = IDENTITY;
+    client->identity.size = sizeof(IDENTITY) - 1;
+    client->iv.buffer = INIT_VECTOR;
+    client->iv.size = sizeof(INIT_VECTOR) - 1;
+    if (hsm_client_crypto_init() != 0)
+    {
+        result = 1;
+    }
+    else if (((client->crypto = hsm_client_crypto_interface()) == NULL) ||
+             ((client->handle = client->crypto->hsm_client_crypto_create()) == NULL))
+    {
+        hsm_client_crypto_deinit();
+        result = 1;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static void close_client(CRYPTO_CLIENT* client)
+{
+    client->crypto->hsm_client_crypto_destroy(client->handle);
+    hsm_client_crypto_deinit();
+}
+
+static int prepare_cert_context(CERT_CONTEXT* cert)
+{
+    int result;
+
+    if ((cert->props = cert_properties_create()) == NULL)
+    {
+        result = 1;
+    }
+    else if ((set_common_name(cert->props, cert->alias) != 0) ||
+             (set_validity_seconds(cert->props, CERT_VALIDITY_SECS) != 0) ||
+             (set_alias(cert->props, cert->alias) != 0) ||
+             (set_issuer_alias(cert->props, hsm_get_device_ca_alias()) != 0) ||
+             (set_certificate_type(cert->props, cert->type) != 0))
+    {
+        cert_properties_destroy(cert->props);
+        cert->props = NULL;
+        result = 1;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static void run_cert_cases(const BENCH_OPTIONS* options, BENCH_REPORT* report, CERT_CONTEXT* certs, const char* const* names, size_t count)
+{
+    size_t idx;
+
+    for (idx = 0; idx < count; idx++)
+    {
+        BENCH_CASE bench_case = { names[idx], certs[idx].iterations, create_certificate, destroy_certificate, &certs[idx] };
+        if (!bench_is_selected(options, names[idx]))
+        {
+            continue;
+        }
+        else if (prepare_cert_context(&certs[idx]) != 0)
+        {
+            bench_fail(report, names[idx]);
+        }
+        else
+        {
+            (void)bench_run_case(&bench_case, options, report);
+            cert_properties_destroy(certs[idx].props);
+        }
+    }
+}
+
+static bool any_selected(const BENCH_OPTIONS* options, const char* const* names, size_t count)
+{
+    size_t idx;
+    bool result = false;
+
+    for (idx = 0; (idx < count) && !result; idx++)
+    {
+        result = bench_is_selected(options, names[idx]);
+    }
+
+    return result;
+}
+
+static int add_extension(X509* cert, int nid, const char* value)
+{
+    int result;
+    X509V3_CTX ctx;
+    X509_EXTENSION* extension;
+
+    X509V3_set_ctx_nodb(&ctx);
+    X509V3_set_ctx(&ctx, cert, cert, NULL, NULL, 0);
+    if ((extension = X509V3_EXT_conf_nid(NULL, &ctx, nid, (char*)value)) == NULL)
+    {
+        result = 1;
+    }
+    else
+    {
+        result = (X509_add_ext(cert, extension, -1) == 1) ? 0 : 1;
+        X509_EXTENSION_free(extension);
+    }
+
+    return result;
+}
+
+static int write_ec_device_ca(const char* cert_file_name, const char* key_file_name)
+{
+    int result;
+    EC_KEY* ec_key = NULL;
+    EVP_PKEY* key = NULL;
+    X509* cert = NULL;
+    X509_NAME* name;
+    BIO* cert_file = NULL;
+    BIO* key_file = NULL;
+
+    if (((ec_key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1)) == NULL) ||
+        (EC_KEY_generate_key(ec_key) != 1) ||
+        ((key = EVP_PKEY_new()) == NULL) ||
+        (EVP_PKEY_set1_EC_KEY(key, ec_key) != 1) ||
+        ((cert = X509_new()) == NULL) ||
+        (X509_set_version(cert, 2) != 1) ||
+        (ASN1_INTEGER_set(X509_get_serialNumber(cert), 1) != 1) ||
+        (X509_gmtime_adj(X509_get_notBefore(cert), 0) == NULL) ||
+        (X509_gmtime_adj(X509_get_notAfter(cert), EC_CA_VALIDITY_SECS) == NULL) ||
+        (X509_set_pubkey(cert, key) != 1) ||
+        ((name = X509_get_subject_name(cert)) == NULL) ||
+        (X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)EC_CA_COMMON_NAME, -1, -1, 0) != 1) ||
+        (X509_set_issuer_name(cert, name) != 1) ||
+        (add_extension(cert, NID_basic_constraints, "critical,CA:TRUE") != 0) ||
+        (add_extension(cert, NID_key_usage, "critical,digitalSignature,keyCertSign,cRLSign") != 0) ||
+        (add_extension(cert, NID_subject_key_identifier, "hash") != 0) ||
+        (X509_sign(cert, key, EVP_sha256()) == 0) ||
+        ((cert_file = BIO_new_file(cert_file_name, "w")) == NULL) ||
+        (PEM_write_bio_X509(cert_file, cert) != 1) ||
+        ((key_file = BIO_new_file(key_file_name, "w")) == NULL) ||
+        (PEM_write_bio_PrivateKey(key_file, key, NULL, NULL, 0, NULL, NULL) != 1))
+    {
+        (void)printf("Could not write ECC device CA to %s\n", cert_file_name);
+        result = 1;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    if (key_file != NULL)
+    {
+        BIO_free_all(key_file);
+    }
+    if (cert_file != NULL)
+    {
+        BIO_free_all(cert_file);
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    EC_KEY_free(ec_key);
+
+    return result;
+}
+
+//##############################################################################
+// Groups
+//##############################################################################
+void bench_store_open(const BENCH_OPTIONS* options, BENCH_REPORT* report, const char* home_dir)
+{
+    // a cold open provisions an empty home dir, a warm one loads what is stored
+    BENCH_CASE cold = { "store_open/cold", 3, crypto_init, crypto_deinit_and_clear, (void*)home_dir };
+    BENCH_CASE warm = { "store_open/warm", 50, crypto_init, crypto_deinit, NULL };
+
+    if (bench_is_selected(options, cold.name))
+    {
+        if (clear_home_dir((void*)home_dir) != 0)
+        {
+            bench_fail(report, cold.name);
+        }
+        else
+        {
+            (void)bench_run_case(&cold, options, report);
+        }
+    }
+    (void)bench_run_case(&warm, options, report);
+}
+
+void bench_crypto(const BENCH_OPTIONS* options, BENCH_REPORT* report)
+{
+    static const char* const cert_names[] = {
+        "create_certificate/rsa4096_ca",
+        "create_certificate/rsa2048_server",
+        "create_certificate/rsa2048_client"
+    };
+    // RSA keys of CA certificates are twice as long and take far longer to generate
+    CERT_CONTEXT certs[] = {
+        { NULL, "hsm_bench_ca", CERTIFICATE_TYPE_CA, 3, NULL },
+        { NULL, "hsm_bench_server", CERTIFICATE_TYPE_SERVER, 20, NULL },
+        { NULL, "hsm_bench_client", CERTIFICATE_TYPE_CLIENT, 20, NULL }
+    };
+    PAYLOAD_CONTEXT payloads[PAYLOAD_SIZE_COUNT];
+    CRYPTO_CLIENT client;
+    bool selected = bench_is_selected(options, "get_trust_bundle") ||
+                    any_selected(options, cert_names, sizeof(cert_names) / sizeof(cert_names[0]));
+    size_t idx;
+
+    memset(payloads, 0, sizeof(payloads));
+    for (idx = 0; idx < PAYLOAD_SIZE_COUNT; idx++)
+    {
+        (void)snprintf(payloads[idx].encrypt_name, BENCH_NAME_SIZE, "encrypt/%zu", PAYLOAD_SIZES[idx]);
+        (void)snprintf(payloads[idx].decrypt_name, BENCH_NAME_SIZE, "decrypt/%zu", PAYLOAD_SIZES[idx]);
+        selected = selected ||
+                   bench_is_selected(options, payloads[idx].encrypt_name) ||
+                   bench_is_selected(options, payloads[idx].decrypt_name);
+    }
+
+    if (!selected)
+    {
+        return;
+    }
+    else if (open_client(&client) != 0)
+    {
+        bench_fail(report, "crypto init");
+    }
+    else if (client.crypto->hsm_client_create_master_encryption_key(client.handle) != 0)
+    {
+        bench_fail(report, "create master encryption key");
+        close_client(&client);
+    }
+    else
+    {
+        BENCH_CASE trust_bundle = { "get_trust_bundle", 2000, get_trust_bundle, NULL, &client };
+
+        for (idx = 0; idx < PAYLOAD_SIZE_COUNT; idx++)
+        {
+            PAYLOAD_CONTEXT* payload = &payloads[idx];
+            BENCH_CASE encrypt = { payload->encrypt_name, 2000, encrypt_payload, NULL, payload };
+            BENCH_CASE decrypt = { payload->decrypt_name, 2000, decrypt_payload, NULL, payload };
+
+            payload->client = &client;
+            payload->plaintext.size = PAYLOAD_SIZES[idx];
+            if (((payload->plaintext.buffer = (unsigned char*)malloc(payload->plaintext.size)) == NULL) ||
+                (client.crypto->hsm_client_get_random_bytes(client.handle, payload->plaintext.buffer, payload->plaintext.size) != 0) ||
+                (client.crypto->hsm_client_encrypt_data(client.handle, &client.identity, &payload->plaintext,
+                                                        &client.iv, &payload->ciphertext) != 0))
+            {
+                bench_fail(report, payload->encrypt_name);
+            }
+            else
+            {
+                (void)bench_run_case(&encrypt, options, report);
+                (void)bench_run_case(&decrypt, options, report);
+            }
+            free(payload->plaintext.buffer);
+            client.crypto->hsm_client_free_buffer(payload->ciphertext.buffer);
+        }
+
+        for (idx = 0; idx < sizeof(certs) / sizeof(certs[0]); idx++)
+        {
+            certs[idx].client = &client;
+        }
+        run_cert_cases(options, report, certs, cert_names, sizeof(certs) / sizeof(certs[0]));
+        (void)bench_run_case(&trust_bundle, options, report);
+
+        close_client(&client);
+    }
+}
+
+void bench_crypto_ec(const BENCH_OPTIONS* options, BENCH_REPORT* report, const char* work_dir)
+{
+    static const char* const cert_names[] = {
+        "create_certificate/ec_p256_ca",
+        "create_certificate/ec_p256_server",
+        "create_certificate/ec_p256_client"
+    };
+    CERT_CONTEXT certs[] = {
+        { NULL, "hsm_bench_ec_ca", CERTIFICATE_TYPE_CA, 200, NULL },
+        { NULL, "hsm_bench_ec_server", CERTIFICATE_TYPE_SERVER, 200, NULL },
+        { NULL, "hsm_bench_ec_client", CERTIFICATE_TYPE_CLIENT, 200, NULL }
+    };
+    char cert_path[BENCH_PATH_SIZE];
+    char key_path[BENCH_PATH_SIZE];
+    CRYPTO_CLIENT client;
+
+    if (!any_selected(options, cert_names, sizeof(cert_names) / sizeof(cert_names[0])))
+    {
+        return;
+    }
+    else if ((bench_make_path(cert_path, work_dir, "ec_device_ca_cert.pem") != 0) ||
+             (bench_make_path(key_path, work_dir, "ec_device_ca_pk.pem") != 0) ||
+             (write_ec_device_ca(cert_path, key_path) != 0) ||
+             (bench_setenv(ENV_DEVICE_CA_PATH, cert_path) != 0) ||
+             (bench_setenv(ENV_DEVICE_PK_PATH, key_path) != 0) ||
+             // the device CA is self signed so it is its own trust bundle
+             (bench_setenv(ENV_TRUSTED_CA_CERTS_PATH, cert_path) != 0))
+    {
+        bench_fail(report, "ECC device CA");
+    }
+    else if (open_client(&client) != 0)
+    {
+        bench_fail(report, "crypto init with ECC device CA");
+    }
+    else
+    {
+        size_t idx;
+
+        for (idx = 0; idx < sizeof(certs) / sizeof(certs[0]); idx++)
+        {
+            certs[idx].client = &client;
+        }
+        run_cert_cases(options, report, certs, cert_names, sizeof(certs) / sizeof(certs[0]));
+
+        close_client(&client);
+    }
+    (void)bench_unsetenv(ENV_DEVICE_CA_PATH);
+    (void)bench_unsetenv(ENV_DEVICE_PK_PATH);
+    (void)bench_unsetenv(ENV_TRUSTED_CA_CERTS_PATH);
+}
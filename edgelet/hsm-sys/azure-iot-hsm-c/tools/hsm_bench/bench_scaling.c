@@ -0,0 +1,636 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/threadapi.h"
+#include "bench_cases.h"
+#include "certificate_info.h"
+#include "hsm_certificate_props.h"
+#include "hsm_client_data.h"
+
+#define PAYLOAD_SIZE 1024
+#define DATA_TO_SIGN_SIZE 128
+#define CERT_VALIDITY_SECS 3600
+#define INITIAL_SAMPLES 4096
+// every worker is created before this delay has passed
+#define START_DELAY_NS 200000000ULL
+#define NS_PER_SEC 1000000000.0
+
+static const char* const MIX_NAMES[BENCH_MIX_NUM_OPERATIONS] = { "sign", "encrypt", "cert" };
+static const unsigned char IDENTITY_KEY[] = "a5551d09-82eb-42ec-8df5-56c244ea3ad0";
+static unsigned char IDENTITY[] = "hsm_bench";
+static unsigned char INIT_VECTOR[] = "hsm_bench_iv_123";
+
+typedef struct SAMPLES_TAG
+{
+    uint64_t* values;
+    size_t count;
+    size_t capacity;
+} SAMPLES;
+
+// shared by the workers of a run, which only read it
+typedef struct SCALING_RUN_TAG
+{
+    const BENCH_SCALING_OPTIONS* scaling;
+    const HSM_CLIENT_CRYPTO_INTERFACE* crypto;
+    const HSM_CLIENT_TPM_INTERFACE* tpm;
+    SIZED_BUFFER identity;
+    SIZED_BUFFER iv;
+    SIZED_BUFFER payload;
+    unsigned char data[DATA_TO_SIGN_SIZE];
+    uint64_t start_ns;
+    uint64_t measure_ns;
+    uint64_t end_ns;
+} SCALING_RUN;
+
+typedef struct WORKER_TAG
+{
+    const SCALING_RUN* run;
+    uint32_t random_state;
+    HSM_CLIENT_HANDLE crypto_handle;
+    HSM_CLIENT_HANDLE tpm_handle;
+    char alias[BENCH_NAME_SIZE];
+    CERT_PROPS_HANDLE cert_props;
+    SAMPLES samples[BENCH_MIX_NUM_OPERATIONS];
+    int result;
+} WORKER;
+
+// a run of the mixed workload with a number of threads
+typedef struct SCALING_RESULT_TAG
+{
+    size_t threads;
+    size_t operations;
+    double seconds;
+    double ops_per_sec;
+} SCALING_RESULT;
+
+//##############################################################################
+// Mix
+//##############################################################################
+int bench_parse_mix(const char* mix, BENCH_SCALING_OPTIONS* scaling)
+{
+    int result = 0;
+    unsigned int weights[BENCH_MIX_NUM_OPERATIONS] = { 0 };
+    unsigned int total = 0;
+    const char* entry = mix;
+    size_t idx;
+
+    while ((result == 0) && (*entry != '\0'))
+    {
+        const char* separator = strchr(entry, ':');
+        size_t name_size = (separator != NULL) ? (size_t)(separator - entry) : 0;
+        unsigned long weight = 0;
+        char* end = NULL;
+
+        for (idx = 0; idx < BENCH_MIX_NUM_OPERATIONS; idx++)
+        {
+            if ((strlen(MIX_NAMES[idx]) == name_size) && (strncmp(entry, MIX_NAMES[idx], name_size) == 0))
+            {
+                break;
+            }
+        }
+        if ((idx == BENCH_MIX_NUM_OPERATIONS) ||
+            ((weight = strtoul(separator + 1, &end, 10)) > 100) ||
+            (end == separator + 1) ||
+            ((*end != ',') && (*end != '\0')))
+        {
+            (void)printf("Invalid mix entry '%s', expected name:weight with name one of sign, encrypt, cert\n", entry);
+            result = 1;
+        }
+        else
+        {
+            weights[idx] = (unsigned int)weight;
+            entry = (*end == ',') ? end + 1 : end;
+        }
+    }
+
+    for (idx = 0; idx < BENCH_MIX_NUM_OPERATIONS; idx++)
+    {
+        total += weights[idx];
+    }
+    if ((result == 0) && (total == 0))
+    {
+        (void)printf("The mix needs at least one operation with a weight\n");
+        result = 1;
+    }
+    else if (result == 0)
+    {
+        memcpy(scaling->weights, weights, sizeof(weights));
+    }
+
+    return result;
+}
+
+// xorshift, the sequence of operations of each worker is the same on every run
+static uint32_t next_random(uint32_t* state)
+{
+    uint32_t value = *state;
+    value ^= value << 13;
+    value ^= value >> 17;
+    value ^= value << 5;
+    *state = value;
+    return value;
+}
+
+static BENCH_MIX_OPERATION pick_operation(const BENCH_SCALING_OPTIONS* scaling, uint32_t* random_state)
+{
+    unsigned int total = 0;
+    unsigned int value;
+    size_t idx;
+
+    for (idx = 0; idx < BENCH_MIX_NUM_OPERATIONS; idx++)
+    {
+        total += scaling->weights[idx];
+    }
+    value = next_random(random_state) % total;
+    for (idx = 0; value >= scaling->weights[idx]; idx++)
+    {
+        value -= scaling->weights[idx];
+    }
+
+    return (BENCH_MIX_OPERATION)idx;
+}
+
+//##############################################################################
+// Workers
+//##############################################################################
+static int add_sample(SAMPLES* samples, uint64_t value)
+{
+    int result;
+
+    if (samples->count == samples->capacity)
+    {
+        size_t capacity = (samples->capacity == 0) ? INITIAL_SAMPLES : samples->capacity * 2;
+        uint64_t* values = (uint64_t*)realloc(samples->values, capacity * sizeof(uint64_t));
+        if (values == NULL)
+        {
+            result = 1;
+        }
+        else
+        {
+            samples->values = values;
+            samples->capacity = capacity;
+            result = 0;
+        }
+    }
+    else
+    {
+        result = 0;
+    }
+
+    if (result == 0)
+    {
+        samples->values[samples->count++] = value;
+    }
+
+    return result;
+}
+
+static int run_operation(WORKER* worker, BENCH_MIX_OPERATION operation, uint64_t* elapsed)
+{
+    int result;
+    const SCALING_RUN* run = worker->run;
+    uint64_t start = bench_now_ns();
+
+    if (operation == BENCH_MIX_SIGN)
+    {
+        unsigned char* digest = NULL;
+        size_t digest_size;
+        result = run->tpm->hsm_client_sign_with_identity(worker->tpm_handle, run->data, sizeof(run->data),
+                                                         &digest, &digest_size);
+        *elapsed = bench_now_ns() - start;
+        run->tpm->hsm_client_free_buffer(digest);
+    }
+    else if (operation == BENCH_MIX_ENCRYPT)
+    {
+        SIZED_BUFFER ciphertext = { NULL, 0 };
+        result = run->crypto->hsm_client_encrypt_data(worker->crypto_handle, &run->identity, &run->payload,
+                                                      &run->iv, &ciphertext);
+        *elapsed = bench_now_ns() - start;
+        run->crypto->hsm_client_free_buffer(ciphertext.buffer);
+    }
+    else
+    {
+        CERT_INFO_HANDLE cert_info = run->crypto->hsm_client_create_certificate(worker->crypto_handle, worker->cert_props);
+        *elapsed = bench_now_ns() - start;
+        result = (cert_info != NULL) ? 0 : 1;
+        certificate_info_destroy(cert_info);
+        // only the creation is timed, removing it keeps the next one from
+        // returning the stored certificate
+        run->crypto->hsm_client_destroy_certificate(worker->crypto_handle, worker->alias);
+    }
+
+    return result;
+}
+
+static int mixed_worker(void* context)
+{
+    WORKER* worker = (WORKER*)context;
+    const SCALING_RUN* run = worker->run;
+    uint64_t now;
+
+    // all workers start together once every one of them is created
+    while (bench_now_ns() < run->start_ns)
+    {
+        ThreadAPI_Sleep(1);
+    }
+
+    worker->result = 0;
+    while ((worker->result == 0) && ((now = bench_now_ns()) < run->end_ns))
+    {
+        BENCH_MIX_OPERATION operation = pick_operation(run->scaling, &worker->random_state);
+        uint64_t elapsed = 0;
+
+        worker->result = run_operation(worker, operation, &elapsed);
+        // operations started before the warmup ended or completed after the
+        // run ended are not counted
+        if ((worker->result == 0) && (now >= run->measure_ns) && (now + elapsed <= run->end_ns))
+        {
+            worker->result = add_sample(&worker->samples[operation], elapsed);
+        }
+    }
+
+    return worker->result;
+}
+
+static int create_worker(WORKER* worker, const SCALING_RUN* run, size_t index)
+{
+    int result;
+
+    memset(worker, 0, sizeof(*worker));
+    worker->run = run;
+    worker->random_state = 2463534242U + (uint32_t)index;
+    (void)snprintf(worker->alias, sizeof(worker->alias), "hsm_bench_mixed_%zu", index);
+    if ((worker->crypto_handle = run->crypto->hsm_client_crypto_create()) == NULL)
+    {
+        result = 1;
+    }
+    else if ((worker->tpm_handle = run->tpm->hsm_client_tpm_create()) == NULL)
+    {
+        run->crypto->hsm_client_crypto_destroy(worker->crypto_handle);
+        result = 1;
+    }
+    else if (((worker->cert_props = cert_properties_create()) == NULL) ||
+             (set_common_name(worker->cert_props, worker->alias) != 0) ||
+             (set_validity_seconds(worker->cert_props, CERT_VALIDITY_SECS) != 0) ||
+             (set_alias(worker->cert_props, worker->alias) != 0) ||
+             (set_issuer_alias(worker->cert_props, hsm_get_device_ca_alias()) != 0) ||
+             (set_certificate_type(worker->cert_props, CERTIFICATE_TYPE_SERVER) != 0))
+    {
+        cert_properties_destroy(worker->cert_props);
+        run->tpm->hsm_client_tpm_destroy(worker->tpm_handle);
+        run->crypto->hsm_client_crypto_destroy(worker->crypto_handle);
+        result = 1;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static void destroy_worker(WORKER* worker)
+{
+    size_t idx;
+
+    for (idx = 0; idx < BENCH_MIX_NUM_OPERATIONS; idx++)
+    {
+        free(worker->samples[idx].values);
+    }
+    cert_properties_destroy(worker->cert_props);
+    worker->run->tpm->hsm_client_tpm_destroy(worker->tpm_handle);
+    worker->run->crypto->hsm_client_crypto_destroy(worker->crypto_handle);
+}
+
+//##############################################################################
+// Results
+//##############################################################################
+static int add_mixed_result(BENCH_REPORT* report, const char* name, WORKER* workers, size_t num_workers,
+                            size_t first_operation, size_t last_operation, double seconds)
+{
+    int result;
+    size_t count = 0;
+    size_t idx, operation;
+    uint64_t* samples;
+
+    for (idx = 0; idx < num_workers; idx++)
+    {
+        for (operation = first_operation; operation <= last_operation; operation++)
+        {
+            count += workers[idx].samples[operation].count;
+        }
+    }
+
+    if (count == 0)
+    {
+        // nothing to report for operations left out of the mix
+        result = 0;
+    }
+    else if ((samples = (uint64_t*)malloc(count * sizeof(uint64_t))) == NULL)
+    {
+        bench_fail(report, name);
+        result = 1;
+    }
+    else
+    {
+        count = 0;
+        for (idx = 0; idx < num_workers; idx++)
+        {
+            for (operation = first_operation; operation <= last_operation; operation++)
+            {
+                const SAMPLES* worker_samples = &workers[idx].samples[operation];
+                memcpy(samples + count, worker_samples->values, worker_samples->count * sizeof(uint64_t));
+                count += worker_samples->count;
+            }
+        }
+        result = bench_add_result(report, name, samples, count, seconds);
+        free(samples);
+    }
+
+    return result;
+}
+
+static void print_lock_waits(const HSM_METRICS* before, const HSM_METRICS* after, size_t operations)
+{
+    bool recorded = false;
+    size_t idx, bucket;
+
+    for (idx = 0; (before != NULL) && (after != NULL) && (idx < after->num_locks); idx++)
+    {
+        HSM_LOCK_METRICS delta;
+        const HSM_LOCK_METRICS* lock = &after->locks[idx];
+        const HSM_LOCK_METRICS* previous = &before->locks[idx];
+
+        memset(&delta, 0, sizeof(delta));
+        delta.acquisitions = lock->acquisitions - previous->acquisitions;
+        delta.contended = lock->contended - previous->contended;
+        delta.total_wait_ns = lock->total_wait_ns - previous->total_wait_ns;
+        // the largest wait is only known since the library was loaded
+        delta.max_wait_ns = lock->max_wait_ns;
+        for (bucket = 0; bucket < HSM_METRICS_NUM_BUCKETS; bucket++)
+        {
+            delta.buckets[bucket] = lock->buckets[bucket] - previous->buckets[bucket];
+        }
+
+        if (delta.acquisitions != 0)
+        {
+            if (!recorded)
+            {
+                (void)printf("  %-34s %10s %10s %12s %10s %10s\n", "lock", "acquired", "contended",
+                             "wait ms", "wait/op us", "p99 us");
+                recorded = true;
+            }
+            (void)printf("  %-34s %10llu %9.1f%% %12.2f %10.2f %10.1f\n", lock->name,
+                         (unsigned long long)delta.acquisitions,
+                         ((double)delta.contended * 100.0) / (double)delta.acquisitions,
+                         (double)delta.total_wait_ns / 1000000.0,
+                         (operations != 0) ? ((double)delta.total_wait_ns / 1000.0) / (double)operations : 0.0,
+                         (double)hsm_metrics_lock_percentile(&delta, 99.0) / 1000.0);
+        }
+    }
+
+    if (!recorded)
+    {
+        (void)printf("  lock waits are only recorded when the HSM is built with hsm_lock_profiling\n");
+    }
+}
+
+//##############################################################################
+// Runs
+//##############################################################################
+static int run_threads(SCALING_RUN* run, size_t num_threads, BENCH_REPORT* report, SCALING_RESULT* scaling_result)
+{
+    int result = 0;
+    WORKER* workers;
+    THREAD_HANDLE* threads;
+    char name[BENCH_NAME_SIZE];
+    size_t num_workers = 0, num_started = 0;
+    size_t idx;
+
+    (void)snprintf(name, sizeof(name), "mixed/threads_%zu", num_threads);
+    if (((workers = (WORKER*)calloc(num_threads, sizeof(WORKER))) == NULL) ||
+        ((threads = (THREAD_HANDLE*)calloc(num_threads, sizeof(THREAD_HANDLE))) == NULL))
+    {
+        free(workers);
+        bench_fail(report, name);
+        result = 1;
+    }
+    else
+    {
+        HSM_METRICS* before;
+        HSM_METRICS* after;
+        uint64_t duration_ns = (uint64_t)(run->scaling->duration_secs * NS_PER_SEC);
+
+        while ((num_workers < num_threads) && (create_worker(&workers[num_workers], run, num_workers) == 0))
+        {
+            num_workers++;
+        }
+
+        before = hsm_get_metrics();
+        run->start_ns = bench_now_ns() + START_DELAY_NS;
+        // the first tenth of the run fills caches and is not counted
+        run->measure_ns = run->start_ns + (duration_ns / 10);
+        run->end_ns = run->start_ns + duration_ns;
+        while ((num_workers == num_threads) && (num_started < num_workers) &&
+               (ThreadAPI_Create(&threads[num_started], mixed_worker, &workers[num_started]) == THREADAPI_OK))
+        {
+            num_started++;
+        }
+        for (idx = 0; idx < num_started; idx++)
+        {
+            int thread_result;
+            if ((ThreadAPI_Join(threads[idx], &thread_result) != THREADAPI_OK) || (thread_result != 0))
+            {
+                result = 1;
+            }
+        }
+        after = hsm_get_metrics();
+
+        if ((result != 0) || (num_started != num_threads) || (bench_now_ns() < run->end_ns))
+        {
+            bench_fail(report, name);
+            result = 1;
+        }
+        else
+        {
+            double seconds = (double)(run->end_ns - run->measure_ns) / NS_PER_SEC;
+            size_t operation;
+
+            result = add_mixed_result(report, name, workers, num_workers, 0, BENCH_MIX_NUM_OPERATIONS - 1, seconds);
+            scaling_result->threads = num_threads;
+            scaling_result->operations = report->results[report->count - 1].iterations;
+            scaling_result->seconds = seconds;
+            scaling_result->ops_per_sec = report->results[report->count - 1].ops_per_sec;
+            for (operation = 0; (result == 0) && (operation < BENCH_MIX_NUM_OPERATIONS); operation++)
+            {
+                char operation_name[BENCH_NAME_SIZE];
+                (void)snprintf(operation_name, sizeof(operation_name), "mixed/threads_%zu/%s", num_threads, MIX_NAMES[operation]);
+                result = add_mixed_result(report, operation_name, workers, num_workers, operation, operation, seconds);
+            }
+            print_lock_waits(before, after, scaling_result->operations);
+        }
+
+        hsm_free_metrics(after);
+        hsm_free_metrics(before);
+        for (idx = 0; idx < num_workers; idx++)
+        {
+            destroy_worker(&workers[idx]);
+        }
+        free(threads);
+        free(workers);
+    }
+
+    return result;
+}
+
+static size_t next_thread_count(size_t threads, size_t max_threads)
+{
+    size_t result;
+
+    if (threads >= max_threads)
+    {
+        result = 0;
+    }
+    else
+    {
+        // powers of two up to the maximum, which is always run
+        result = (threads * 2 > max_threads) ? max_threads : threads * 2;
+    }
+
+    return result;
+}
+
+static bool any_run_selected(const BENCH_OPTIONS* options, const BENCH_SCALING_OPTIONS* scaling)
+{
+    bool result = false;
+    size_t threads;
+
+    for (threads = 1; (threads != 0) && !result; threads = next_thread_count(threads, scaling->max_threads))
+    {
+        char name[BENCH_NAME_SIZE];
+        (void)snprintf(name, sizeof(name), "mixed/threads_%zu", threads);
+        result = bench_is_selected(options, name);
+    }
+
+    return result;
+}
+
+static void run_scaling(SCALING_RUN* run, const BENCH_OPTIONS* options, BENCH_REPORT* report)
+{
+    SCALING_RESULT* results;
+    size_t num_results = 0;
+    size_t threads, idx;
+
+    if ((results = (SCALING_RESULT*)calloc(run->scaling->max_threads, sizeof(SCALING_RESULT))) == NULL)
+    {
+        bench_fail(report, "mixed");
+        return;
+    }
+
+    (void)printf("\nmixed workload");
+    for (idx = 0; idx < BENCH_MIX_NUM_OPERATIONS; idx++)
+    {
+        (void)printf("%s%s:%u", (idx == 0) ? " " : ",", MIX_NAMES[idx], run->scaling->weights[idx]);
+    }
+    (void)printf(", %.1f seconds per run\n", run->scaling->duration_secs);
+
+    for (threads = 1; threads != 0; threads = next_thread_count(threads, run->scaling->max_threads))
+    {
+        char name[BENCH_NAME_SIZE];
+        (void)snprintf(name, sizeof(name), "mixed/threads_%zu", threads);
+        if (bench_is_selected(options, name) && (run_threads(run, threads, report, &results[num_results]) == 0))
+        {
+            num_results++;
+        }
+    }
+
+    if (num_results != 0)
+    {
+        // efficiency is the throughput per thread relative to the smallest run
+        double base_per_thread = results[0].ops_per_sec / (double)results[0].threads;
+
+        (void)printf("\n%-36s %8s %12s %10s\n", "scaling", "threads", "ops/s", "efficiency");
+        for (idx = 0; idx < num_results; idx++)
+        {
+            double per_thread = results[idx].ops_per_sec / (double)results[idx].threads;
+            (void)printf("%-36s %8zu %12.1f %9.1f%%\n", "mixed", results[idx].threads, results[idx].ops_per_sec,
+                         (base_per_thread > 0.0) ? (per_thread * 100.0) / base_per_thread : 0.0);
+        }
+        (void)printf("\n");
+    }
+    free(results);
+}
+
+//##############################################################################
+// Group
+//##############################################################################
+void bench_scaling(const BENCH_OPTIONS* options, const BENCH_SCALING_OPTIONS* scaling, BENCH_REPORT* report)
+{
+    SCALING_RUN run;
+    HSM_CLIENT_HANDLE crypto_handle;
+    HSM_CLIENT_HANDLE tpm_handle;
+
+    memset(&run, 0, sizeof(run));
+    run.scaling = scaling;
+    run.identity.buffer = IDENTITY;
+    run.identity.size = sizeof(IDENTITY) - 1;
+    run.iv.buffer = INIT_VECTOR;
+    run.iv.size = sizeof(INIT_VECTOR) - 1;
+    memset(run.data, 'x', sizeof(run.data));
+
+    if ((scaling->max_threads == 0) || !any_run_selected(options, scaling))
+    {
+        return;
+    }
+    else if (hsm_client_crypto_init() != 0)
+    {
+        bench_fail(report, "crypto init");
+    }
+    else
+    {
+        if (hsm_client_tpm_init() != 0)
+        {
+            bench_fail(report, "tpm init");
+        }
+        else
+        {
+            if (((run.crypto = hsm_client_crypto_interface()) == NULL) ||
+                ((run.tpm = hsm_client_tpm_interface()) == NULL) ||
+                ((crypto_handle = run.crypto->hsm_client_crypto_create()) == NULL))
+            {
+                bench_fail(report, "mixed setup");
+            }
+            else
+            {
+                if ((tpm_handle = run.tpm->hsm_client_tpm_create()) == NULL)
+                {
+                    bench_fail(report, "tpm create");
+                }
+                else
+                {
+                    run.payload.size = PAYLOAD_SIZE;
+                    if (((run.payload.buffer = (unsigned char*)malloc(PAYLOAD_SIZE)) == NULL) ||
+                        (run.crypto->hsm_client_get_random_bytes(crypto_handle, run.payload.buffer, PAYLOAD_SIZE) != 0) ||
+                        (run.crypto->hsm_client_create_master_encryption_key(crypto_handle) != 0) ||
+                        (run.tpm->hsm_client_activate_identity_key(tpm_handle, IDENTITY_KEY, sizeof(IDENTITY_KEY) - 1) != 0))
+                    {
+                        bench_fail(report, "mixed keys");
+                    }
+                    else
+                    {
+                        run_scaling(&run, options, report);
+                    }
+                    free(run.payload.buffer);
+                    run.tpm->hsm_client_tpm_destroy(tpm_handle);
+                }
+                run.crypto->hsm_client_crypto_destroy(crypto_handle);
+            }
+            hsm_client_tpm_deinit();
+        }
+        hsm_client_crypto_deinit();
+    }
+}
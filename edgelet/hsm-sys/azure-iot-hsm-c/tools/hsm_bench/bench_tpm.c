@@ -0,0 +1,82 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <string.h>
+
+#include "bench_cases.h"
+#include "hsm_client_data.h"
+
+#define DATA_TO_SIGN_SIZE 128
+
+static const unsigned char IDENTITY_KEY[] = "a5551d09-82eb-42ec-8df5-56c244ea3ad0";
+static const unsigned char DERIVED_IDENTITY[] = "hsm_bench/module";
+
+typedef struct TPM_CONTEXT_TAG
+{
+    const HSM_CLIENT_TPM_INTERFACE* tpm;
+    HSM_CLIENT_HANDLE handle;
+    unsigned char data[DATA_TO_SIGN_SIZE];
+} TPM_CONTEXT;
+
+static int sign_with_identity(void* context)
+{
+    TPM_CONTEXT* tpm_context = (TPM_CONTEXT*)context;
+    unsigned char* digest = NULL;
+    size_t digest_size;
+    int result = tpm_context->tpm->hsm_client_sign_with_identity(tpm_context->handle, tpm_context->data,
+                                                                 sizeof(tpm_context->data), &digest, &digest_size);
+    tpm_context->tpm->hsm_client_free_buffer(digest);
+    return result;
+}
+
+static int derive_and_sign_with_identity(void* context)
+{
+    TPM_CONTEXT* tpm_context = (TPM_CONTEXT*)context;
+    unsigned char* digest = NULL;
+    size_t digest_size;
+    int result = tpm_context->tpm->hsm_client_derive_and_sign_with_identity(tpm_context->handle, tpm_context->data,
+                                                                            sizeof(tpm_context->data), DERIVED_IDENTITY,
+                                                                            sizeof(DERIVED_IDENTITY) - 1, &digest, &digest_size);
+    tpm_context->tpm->hsm_client_free_buffer(digest);
+    return result;
+}
+
+void bench_tpm(const BENCH_OPTIONS* options, BENCH_REPORT* report)
+{
+    TPM_CONTEXT tpm_context;
+    BENCH_CASE sign = { "sign", 5000, sign_with_identity, NULL, &tpm_context };
+    BENCH_CASE derive_and_sign = { "derive_and_sign", 5000, derive_and_sign_with_identity, NULL, &tpm_context };
+
+    memset(tpm_context.data, 'x', sizeof(tpm_context.data));
+    if (!bench_is_selected(options, sign.name) && !bench_is_selected(options, derive_and_sign.name))
+    {
+        return;
+    }
+    else if (hsm_client_tpm_init() != 0)
+    {
+        bench_fail(report, "tpm init");
+    }
+    else
+    {
+        if (((tpm_context.tpm = hsm_client_tpm_interface()) == NULL) ||
+            ((tpm_context.handle = tpm_context.tpm->hsm_client_tpm_create()) == NULL))
+        {
+            bench_fail(report, "tpm create");
+        }
+        else
+        {
+            if (tpm_context.tpm->hsm_client_activate_identity_key(tpm_context.handle, IDENTITY_KEY,
+                                                                   sizeof(IDENTITY_KEY) - 1) != 0)
+            {
+                bench_fail(report, "activate identity key");
+            }
+            else
+            {
+                (void)bench_run_case(&sign, options, report);
+                (void)bench_run_case(&derive_and_sign, options, report);
+            }
+            tpm_context.tpm->hsm_client_tpm_destroy(tpm_context.handle);
+        }
+        hsm_client_tpm_deinit();
+    }
+}
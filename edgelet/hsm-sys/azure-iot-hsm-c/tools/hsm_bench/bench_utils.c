@@ -0,0 +1,438 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#if defined __linux__ && !defined _GNU_SOURCE
+    // for clock_gettime and setenv with strict C standard flags
+    #define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/uniqueid.h"
+#include "bench_utils.h"
+
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    #include <direct.h>
+    #include <windows.h>
+
+    #define SLASH "\\"
+#else
+    #include <sys/stat.h>
+    #include <sys/types.h>
+    #include <time.h>
+    #include <unistd.h>
+
+    #define SLASH "/"
+#endif
+
+#define UID_SIZE 37
+#define JSON_LINE_SIZE 512
+
+//##############################################################################
+// Measurements
+//##############################################################################
+uint64_t bench_now_ns(void)
+{
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+    if (frequency.QuadPart == 0)
+    {
+        (void)QueryPerformanceFrequency(&frequency);
+    }
+    (void)QueryPerformanceCounter(&now);
+    return (uint64_t)((now.QuadPart / frequency.QuadPart) * 1000000000) +
+           (uint64_t)(((now.QuadPart % frequency.QuadPart) * 1000000000) / frequency.QuadPart);
+#else
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000) + (uint64_t)now.tv_nsec;
+#endif
+}
+
+bool bench_is_selected(const BENCH_OPTIONS* options, const char* name)
+{
+    return (options->filter == NULL) || (strstr(name, options->filter) != NULL);
+}
+
+static int compare_samples(const void* lhs, const void* rhs)
+{
+    uint64_t left = *(const uint64_t*)lhs;
+    uint64_t right = *(const uint64_t*)rhs;
+    return (left > right) - (left < right);
+}
+
+// nearest rank percentile of sorted samples, in microseconds
+static double get_percentile_us(const uint64_t* samples, size_t count, size_t per_mille)
+{
+    size_t rank = ((count * per_mille) + 999) / 1000;
+    return (double)samples[(rank == 0) ? 0 : rank - 1] / 1000.0;
+}
+
+static void print_result(const BENCH_RESULT* result)
+{
+    (void)printf("%-36s %8zu %12.1f %10.1f %10.1f %10.1f\n", result->name, result->iterations,
+                 result->ops_per_sec, result->p50_us, result->p99_us, result->p999_us);
+}
+
+void bench_fail(BENCH_REPORT* report, const char* what)
+{
+    (void)printf("%-36s FAILED\n", what);
+    report->failed++;
+}
+
+int bench_add_result(BENCH_REPORT* report, const char* name, uint64_t* samples, size_t count, double seconds)
+{
+    int result;
+
+    if ((report->count == BENCH_MAX_RESULTS) || (count == 0))
+    {
+        bench_fail(report, name);
+        result = 1;
+    }
+    else
+    {
+        BENCH_RESULT* bench_result = &report->results[report->count++];
+        qsort(samples, count, sizeof(uint64_t), compare_samples);
+        (void)snprintf(bench_result->name, sizeof(bench_result->name), "%s", name);
+        bench_result->iterations = count;
+        bench_result->seconds = seconds;
+        bench_result->ops_per_sec = (seconds > 0.0) ? (double)count / seconds : 0.0;
+        bench_result->p50_us = get_percentile_us(samples, count, 500);
+        bench_result->p99_us = get_percentile_us(samples, count, 990);
+        bench_result->p999_us = get_percentile_us(samples, count, 999);
+        print_result(bench_result);
+        result = 0;
+    }
+
+    return result;
+}
+
+int bench_run_case(const BENCH_CASE* bench_case, const BENCH_OPTIONS* options, BENCH_REPORT* report)
+{
+    int result;
+    size_t iterations = (options->iterations != 0) ? options->iterations : bench_case->iterations;
+    // the first runs fill caches and are not part of the result
+    size_t warmup = (iterations / 10 < 100) ? iterations / 10 : 100;
+    uint64_t* samples;
+
+    if (!bench_is_selected(options, bench_case->name))
+    {
+        result = 0;
+    }
+    else if ((samples = (uint64_t*)malloc(iterations * sizeof(uint64_t))) == NULL)
+    {
+        bench_fail(report, bench_case->name);
+        result = 1;
+    }
+    else
+    {
+        size_t idx;
+        uint64_t total = 0;
+
+        result = 0;
+        for (idx = 0; (result == 0) && (idx < warmup + iterations); idx++)
+        {
+            uint64_t start = bench_now_ns();
+            result = bench_case->run(bench_case->context);
+            uint64_t elapsed = bench_now_ns() - start;
+            if (idx >= warmup)
+            {
+                samples[idx - warmup] = elapsed;
+                total += elapsed;
+            }
+            if ((result == 0) && (bench_case->reset != NULL))
+            {
+                result = bench_case->reset(bench_case->context);
+            }
+        }
+
+        if (result != 0)
+        {
+            bench_fail(report, bench_case->name);
+        }
+        else
+        {
+            result = bench_add_result(report, bench_case->name, samples, iterations, (double)total / 1000000000.0);
+        }
+        free(samples);
+    }
+
+    return result;
+}
+
+//##############################################################################
+// Results
+//##############################################################################
+int bench_write_json(const BENCH_REPORT* report, const char* version, const char* file_name)
+{
+    int result;
+    FILE* file;
+
+    if ((file = fopen(file_name, "w")) == NULL)
+    {
+        (void)printf("Could not open %s for writing\n", file_name);
+        result = 1;
+    }
+    else
+    {
+        size_t idx;
+
+        // one result per line so that bench_read_json does not need a full parser
+        (void)fprintf(file, "{\n  \"version\": \"%s\",\n  \"results\": [\n", version);
+        for (idx = 0; idx < report->count; idx++)
+        {
+            const BENCH_RESULT* bench_result = &report->results[idx];
+            (void)fprintf(file, "    {\"name\": \"%s\", \"iterations\": %zu, \"seconds\": %.6f, "
+                          "\"ops_per_sec\": %.3f, \"p50_us\": %.3f, \"p99_us\": %.3f, \"p999_us\": %.3f}%s\n",
+                          bench_result->name, bench_result->iterations, bench_result->seconds,
+                          bench_result->ops_per_sec, bench_result->p50_us, bench_result->p99_us,
+                          bench_result->p999_us, (idx + 1 < report->count) ? "," : "");
+        }
+        (void)fprintf(file, "  ]\n}\n");
+        result = (fclose(file) == 0) ? 0 : 1;
+    }
+
+    return result;
+}
+
+int bench_read_json(const char* file_name, BENCH_REPORT* report)
+{
+    int result;
+    FILE* file;
+
+    memset(report, 0, sizeof(*report));
+    if ((file = fopen(file_name, "r")) == NULL)
+    {
+        (void)printf("Could not open baseline %s\n", file_name);
+        result = 1;
+    }
+    else
+    {
+        char line[JSON_LINE_SIZE];
+
+        result = 0;
+        while ((result == 0) && (fgets(line, sizeof(line), file) != NULL))
+        {
+            BENCH_RESULT* bench_result = &report->results[report->count];
+            if (strstr(line, "\"name\"") == NULL)
+            {
+                continue;
+            }
+            else if (report->count == BENCH_MAX_RESULTS)
+            {
+                (void)printf("Too many results in baseline %s\n", file_name);
+                result = 1;
+            }
+            else if (sscanf(line, " {\"name\": \"%63[^\"]\", \"iterations\": %zu, \"seconds\": %lf, "
+                            "\"ops_per_sec\": %lf, \"p50_us\": %lf, \"p99_us\": %lf, \"p999_us\": %lf}",
+                            bench_result->name, &bench_result->iterations, &bench_result->seconds,
+                            &bench_result->ops_per_sec, &bench_result->p50_us, &bench_result->p99_us,
+                            &bench_result->p999_us) != 7)
+            {
+                (void)printf("Could not parse baseline %s line: %s", file_name, line);
+                result = 1;
+            }
+            else
+            {
+                report->count++;
+            }
+        }
+        (void)fclose(file);
+    }
+
+    return result;
+}
+
+static double get_change_pct(double baseline, double current)
+{
+    return (baseline > 0.0) ? ((current - baseline) * 100.0) / baseline : 0.0;
+}
+
+size_t bench_compare(const BENCH_REPORT* report, const BENCH_REPORT* baseline, double threshold_pct)
+{
+    size_t regressions = 0;
+    size_t idx;
+
+    (void)printf("\n%-36s %10s %10s %10s\n", "change from baseline", "ops/s", "p50", "p99");
+    for (idx = 0; idx < report->count; idx++)
+    {
+        const BENCH_RESULT* current = &report->results[idx];
+        const BENCH_RESULT* previous = NULL;
+        size_t base_idx;
+
+        for (base_idx = 0; base_idx < baseline->count; base_idx++)
+        {
+            if (strcmp(baseline->results[base_idx].name, current->name) == 0)
+            {
+                previous = &baseline->results[base_idx];
+                break;
+            }
+        }
+
+        if (previous == NULL)
+        {
+            (void)printf("%-36s not in baseline\n", current->name);
+        }
+        else
+        {
+            double ops_change = get_change_pct(previous->ops_per_sec, current->ops_per_sec);
+            double p50_change = get_change_pct(previous->p50_us, current->p50_us);
+            double p99_change = get_change_pct(previous->p99_us, current->p99_us);
+            bool regressed = (ops_change < -threshold_pct) ||
+                             (p50_change > threshold_pct) ||
+                             (p99_change > threshold_pct);
+            if (regressed)
+            {
+                regressions++;
+            }
+            (void)printf("%-36s %+9.1f%% %+9.1f%% %+9.1f%%%s\n", current->name,
+                         ops_change, p50_change, p99_change, regressed ? "  REGRESSED" : "");
+        }
+    }
+
+    return regressions;
+}
+
+//##############################################################################
+// Files and environment
+//##############################################################################
+int bench_make_dir(const char* dir_path)
+{
+    int status;
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    status = _mkdir(dir_path);
+#else
+    status = mkdir(dir_path, S_IRWXU);
+#endif
+    if (status != 0)
+    {
+        (void)printf("Directory create failed for '%s'. Errno: %s.\n", dir_path, strerror(errno));
+    }
+    return status;
+}
+
+int bench_make_path(char* path, const char* dir_path, const char* file_name)
+{
+    int status = snprintf(path, BENCH_PATH_SIZE, "%s" SLASH "%s", dir_path, file_name);
+    return ((status > 0) && (status < BENCH_PATH_SIZE)) ? 0 : 1;
+}
+
+char* bench_create_temp_dir(void)
+{
+    char* result;
+    char guid[UID_SIZE];
+
+    if ((result = (char*)calloc(BENCH_PATH_SIZE, 1)) == NULL)
+    {
+        (void)printf("Could not allocate temp dir path\n");
+    }
+    else if (UniqueId_Generate(guid, sizeof(guid)) != UNIQUEID_OK)
+    {
+        (void)printf("Could not generate temp dir name\n");
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        char base_dir[BENCH_PATH_SIZE];
+        int status;
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+        DWORD count = GetTempPathA(sizeof(base_dir), base_dir);
+        status = ((count == 0) || (count >= sizeof(base_dir))) ? 1 : 0;
+#else
+        (void)snprintf(base_dir, sizeof(base_dir), "/tmp/");
+        status = 0;
+#endif
+        if ((status != 0) ||
+            (snprintf(result, BENCH_PATH_SIZE, "%shsm_bench_%s", base_dir, guid) >= BENCH_PATH_SIZE) ||
+            (bench_make_dir(result) != 0))
+        {
+            free(result);
+            result = NULL;
+        }
+    }
+
+    return result;
+}
+
+int bench_delete_dir(const char* dir_path)
+{
+    int status;
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    // SHFileOperationA expects a double null terminated list of paths
+    char from[BENCH_PATH_SIZE + 1] = { 0 };
+    SHFILEOPSTRUCTA shfo = {
+        NULL,
+        FO_DELETE,
+        from,
+        NULL,
+        FOF_SILENT | FOF_NOERRORUI | FOF_NOCONFIRMATION,
+        FALSE,
+        NULL,
+        NULL };
+    (void)snprintf(from, BENCH_PATH_SIZE, "%s", dir_path);
+    status = SHFileOperationA(&shfo);
+#else
+    char cmd[BENCH_PATH_SIZE + 16];
+    if (snprintf(cmd, sizeof(cmd), "rm -fr '%s'", dir_path) >= (int)sizeof(cmd))
+    {
+        status = 1;
+    }
+    else
+    {
+        status = system(cmd);
+    }
+#endif
+    if (status != 0)
+    {
+        (void)printf("Could not delete directory '%s'\n", dir_path);
+    }
+    return status;
+}
+
+int bench_clear_dir(const char* dir_path)
+{
+    int status;
+    char cmd[BENCH_PATH_SIZE + 32];
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    int count = snprintf(cmd, sizeof(cmd), "del /s /q \"%s\\*\" > nul", dir_path);
+#else
+    int count = snprintf(cmd, sizeof(cmd), "find '%s' -type f -exec rm -f {} +", dir_path);
+#endif
+    if ((count < 0) || (count >= (int)sizeof(cmd)))
+    {
+        status = 1;
+    }
+    else
+    {
+        status = system(cmd);
+    }
+    if (status != 0)
+    {
+        (void)printf("Could not clear directory '%s'\n", dir_path);
+    }
+    return status;
+}
+
+int bench_setenv(const char* key, const char* value)
+{
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    return (_putenv_s(key, value) == 0) ? 0 : 1;
+#else
+    return setenv(key, value, 1);
+#endif
+}
+
+int bench_unsetenv(const char* key)
+{
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    // an empty value removes the variable
+    return (_putenv_s(key, "") == 0) ? 0 : 1;
+#else
+    return unsetenv(key);
+#endif
+}
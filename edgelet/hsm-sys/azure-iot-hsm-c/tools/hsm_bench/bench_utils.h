@@ -0,0 +1,100 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_NAME_SIZE 64
+#define BENCH_PATH_SIZE 256
+#define BENCH_MAX_RESULTS 64
+
+typedef struct BENCH_OPTIONS_TAG
+{
+    // overrides the iterations of every case when not 0
+    size_t iterations;
+    // only cases whose name contains it are run when not NULL
+    const char* filter;
+} BENCH_OPTIONS;
+
+typedef struct BENCH_RESULT_TAG
+{
+    char name[BENCH_NAME_SIZE];
+    size_t iterations;
+    // time spent in the measured operation, excluding resets
+    double seconds;
+    double ops_per_sec;
+    double p50_us;
+    double p99_us;
+    double p999_us;
+} BENCH_RESULT;
+
+typedef struct BENCH_REPORT_TAG
+{
+    BENCH_RESULT results[BENCH_MAX_RESULTS];
+    size_t count;
+    size_t failed;
+} BENCH_REPORT;
+
+typedef int (*BENCH_OPERATION)(void* context);
+
+/**
+ * A measured operation. run is timed on every iteration, reset is called
+ * after it without being timed and may be NULL.
+ */
+typedef struct BENCH_CASE_TAG
+{
+    const char* name;
+    size_t iterations;
+    BENCH_OPERATION run;
+    BENCH_OPERATION reset;
+    void* context;
+} BENCH_CASE;
+
+extern uint64_t bench_now_ns(void);
+extern bool bench_is_selected(const BENCH_OPTIONS* options, const char* name);
+
+/**
+ * Runs the case unless it is filtered out and adds its result to the report.
+ * A failing iteration stops the case and is counted in report->failed.
+ */
+extern int bench_run_case(const BENCH_CASE* bench_case, const BENCH_OPTIONS* options, BENCH_REPORT* report);
+extern void bench_fail(BENCH_REPORT* report, const char* what);
+
+/**
+ * Sorts the latency samples in nanoseconds of count operations that took
+ * seconds in total, adds their result to the report and prints it.
+ */
+extern int bench_add_result(BENCH_REPORT* report, const char* name, uint64_t* samples, size_t count, double seconds);
+
+extern int bench_write_json(const BENCH_REPORT* report, const char* version, const char* file_name);
+
+/**
+ * Reads the results of a file written by bench_write_json.
+ */
+extern int bench_read_json(const char* file_name, BENCH_REPORT* report);
+
+/**
+ * Prints how the results moved from the baseline and returns the number of
+ * cases whose p50 or p99 latency grew, or throughput dropped, by more than
+ * threshold_pct percent.
+ */
+extern size_t bench_compare(const BENCH_REPORT* report, const BENCH_REPORT* baseline, double threshold_pct);
+
+extern char* bench_create_temp_dir(void);
+extern int bench_make_dir(const char* dir_path);
+extern int bench_delete_dir(const char* dir_path);
+
+/**
+ * Deletes the files under dir_path but keeps its directories, which the HSM
+ * only creates once per process.
+ */
+extern int bench_clear_dir(const char* dir_path);
+extern int bench_make_path(char* path, const char* dir_path, const char* file_name);
+extern int bench_setenv(const char* key, const char* value);
+extern int bench_unsetenv(const char* key);
+
+#endif // BENCH_UTILS_H
@@ -0,0 +1,188 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_cases.h"
+#include "bench_utils.h"
+#include "hsm_client_data.h"
+
+#define DEFAULT_THRESHOLD_PCT 10.0
+#define DEFAULT_DURATION_SECS 5.0
+#define DEFAULT_MIX "sign:70,encrypt:25,cert:5"
+#define MAX_THREADS 256
+
+static const char* const ENV_EDGE_HOME_DIR = "IOTEDGE_HOMEDIR";
+// externally provided certificates would change what is measured
+static const char* const ENV_CERTIFICATES[] = {
+    "IOTEDGE_DEVICE_CA_CERT",
+    "IOTEDGE_DEVICE_CA_PK",
+    "IOTEDGE_TRUSTED_CA_CERTS"
+};
+
+typedef struct BENCH_ARGS_TAG
+{
+    BENCH_OPTIONS options;
+    BENCH_SCALING_OPTIONS scaling;
+    const char* json_file;
+    const char* baseline_file;
+    double threshold_pct;
+} BENCH_ARGS;
+
+// results are kept out of the stack, they hold every case
+static BENCH_REPORT g_report;
+static BENCH_REPORT g_baseline;
+
+static void print_usage(const char* program)
+{
+    (void)printf("Usage: %s [options]\n"
+                 "  --iterations N       run every case N times instead of its default\n"
+                 "  --filter TEXT        only run cases whose name contains TEXT\n"
+                 "  --json FILE          write the results to FILE\n"
+                 "  --baseline FILE      compare the results to a FILE written with --json\n"
+                 "  --threshold PERCENT  change from the baseline reported as a regression (default %.0f)\n"
+                 "  --threads N          run a mixed workload from 1 up to N threads\n"
+                 "  --duration SECONDS   length of each mixed workload run (default %.0f)\n"
+                 "  --mix MIX            share of each operation of the mixed workload (default %s)\n",
+                 program, DEFAULT_THRESHOLD_PCT, DEFAULT_DURATION_SECS, DEFAULT_MIX);
+}
+
+static int parse_args(int argc, char* argv[], BENCH_ARGS* args)
+{
+    int result = 0;
+    int idx;
+
+    memset(args, 0, sizeof(*args));
+    args->threshold_pct = DEFAULT_THRESHOLD_PCT;
+    args->scaling.duration_secs = DEFAULT_DURATION_SECS;
+    (void)bench_parse_mix(DEFAULT_MIX, &args->scaling);
+    for (idx = 1; (result == 0) && (idx < argc); idx++)
+    {
+        const char* value = (idx + 1 < argc) ? argv[idx + 1] : NULL;
+        char* end = NULL;
+
+        if (value == NULL)
+        {
+            result = 1;
+        }
+        else if (strcmp(argv[idx], "--iterations") == 0)
+        {
+            args->options.iterations = (size_t)strtoul(value, &end, 10);
+            result = ((*end != '\0') || (args->options.iterations == 0)) ? 1 : 0;
+        }
+        else if (strcmp(argv[idx], "--filter") == 0)
+        {
+            args->options.filter = value;
+        }
+        else if (strcmp(argv[idx], "--json") == 0)
+        {
+            args->json_file = value;
+        }
+        else if (strcmp(argv[idx], "--baseline") == 0)
+        {
+            args->baseline_file = value;
+        }
+        else if (strcmp(argv[idx], "--threshold") == 0)
+        {
+            args->threshold_pct = strtod(value, &end);
+            result = ((*end != '\0') || (args->threshold_pct < 0.0)) ? 1 : 0;
+        }
+        else if (strcmp(argv[idx], "--threads") == 0)
+        {
+            args->scaling.max_threads = (size_t)strtoul(value, &end, 10);
+            result = ((*end != '\0') || (args->scaling.max_threads == 0) || (args->scaling.max_threads > MAX_THREADS)) ? 1 : 0;
+        }
+        else if (strcmp(argv[idx], "--duration") == 0)
+        {
+            args->scaling.duration_secs = strtod(value, &end);
+            result = ((*end != '\0') || (args->scaling.duration_secs <= 0.0)) ? 1 : 0;
+        }
+        else if (strcmp(argv[idx], "--mix") == 0)
+        {
+            result = bench_parse_mix(value, &args->scaling);
+        }
+        else
+        {
+            result = 1;
+        }
+        idx++;
+    }
+
+    return result;
+}
+
+static void run_benchmarks(const BENCH_ARGS* args, BENCH_REPORT* report, const char* work_dir)
+{
+    char home_dir[BENCH_PATH_SIZE];
+    size_t idx;
+
+    for (idx = 0; idx < sizeof(ENV_CERTIFICATES) / sizeof(ENV_CERTIFICATES[0]); idx++)
+    {
+        (void)bench_unsetenv(ENV_CERTIFICATES[idx]);
+    }
+
+    // the HSM reads its home dir once per process, every group shares it
+    if ((bench_make_path(home_dir, work_dir, "home") != 0) ||
+        (bench_make_dir(home_dir) != 0) ||
+        (bench_setenv(ENV_EDGE_HOME_DIR, home_dir) != 0))
+    {
+        bench_fail(report, "home dir");
+    }
+    else
+    {
+        (void)printf("HSM %s benchmark, home dir %s\n\n", hsm_get_version(), home_dir);
+        (void)printf("%-36s %8s %12s %10s %10s %10s\n", "case", "iters", "ops/s", "p50 us", "p99 us", "p999 us");
+        bench_store_open(&args->options, report, home_dir);
+        bench_crypto(&args->options, report);
+        // after the RSA cases as it replaces the device CA of the home dir
+        bench_crypto_ec(&args->options, report, work_dir);
+        // last as hsm_client_tpm_deinit leaves the store open, so later
+        // groups would not provision it again
+        bench_tpm(&args->options, report);
+        bench_scaling(&args->options, &args->scaling, report);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int result;
+    BENCH_ARGS args;
+    char* work_dir = NULL;
+
+    if (parse_args(argc, argv, &args) != 0)
+    {
+        print_usage(argv[0]);
+        result = 1;
+    }
+    else if ((args.baseline_file != NULL) && (bench_read_json(args.baseline_file, &g_baseline) != 0))
+    {
+        result = 1;
+    }
+    else if ((work_dir = bench_create_temp_dir()) == NULL)
+    {
+        result = 1;
+    }
+    else
+    {
+        run_benchmarks(&args, &g_report, work_dir);
+
+        if ((args.json_file != NULL) &&
+            (bench_write_json(&g_report, hsm_get_version(), args.json_file) != 0))
+        {
+            bench_fail(&g_report, "json output");
+        }
+        result = (int)g_report.failed;
+        if (args.baseline_file != NULL)
+        {
+            result += (int)bench_compare(&g_report, &g_baseline, args.threshold_pct);
+        }
+
+        (void)bench_delete_dir(work_dir);
+        free(work_dir);
+        (void)printf("\nHSM benchmark %s\n", (result == 0 ? "passed" : "encountered failures or regressions"));
+    }
+
+    return result;
+}
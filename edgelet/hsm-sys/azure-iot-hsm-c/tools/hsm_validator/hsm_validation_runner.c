@@ -2,9 +2,11 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "v0_0_1/hsm_v0_0_1_validation.h"
 #include "v0_0_2/hsm_v0_0_2_validation.h"
+#include "perf/hsm_perf_validation.h"
 
 typedef int (*HSM_CLIENT_VALIDATE_ENTRY_POINT)(void);
 typedef struct VALIDATE_INFO
@@ -21,19 +23,61 @@ const VALIDATE_INFO validation_list[] =
 };
 
 
-int main(void)
+static void print_usage(const char* program)
+{
+    (void)printf("Usage: %s [--perf] [--sla FILE]\n"
+                 "  --perf      also time every interface function against its SLA\n"
+                 "  --sla FILE  change the SLAs with the limits in FILE, implies --perf\n",
+                 program);
+}
+
+int main(int argc, char* argv[])
 {
     int failed_count = 0;
+    int perf = 0;
+    int usage_error = 0;
+    const char* sla_file = NULL;
 
     size_t index;
     size_t list_len = sizeof(validation_list) / sizeof(validation_list[0]);
 
-    for (index = 0; index < list_len; index++)
+    for (index = 1; (index < (size_t)argc) && !usage_error; index++)
     {
-        (void)printf("\n%s\n", validation_list[index].name);
-        failed_count += validation_list[index].entrypoint();
+        if (strcmp(argv[index], "--perf") == 0)
+        {
+            perf = 1;
+        }
+        else if ((strcmp(argv[index], "--sla") == 0) && (index + 1 < (size_t)argc))
+        {
+            perf = 1;
+            sla_file = argv[++index];
+        }
+        else
+        {
+            usage_error = 1;
+        }
     }
 
-    (void)printf("\nHSM validation %s\n", (failed_count == 0 ? "passed" : "encountered failures"));
+    if (usage_error)
+    {
+        print_usage(argv[0]);
+        failed_count = 1;
+    }
+    else
+    {
+        for (index = 0; index < list_len; index++)
+        {
+            (void)printf("\n%s\n", validation_list[index].name);
+            failed_count += validation_list[index].entrypoint();
+        }
+
+        if (perf)
+        {
+            (void)printf("\nHSM performance validation\n");
+            failed_count += hsm_perf_validation(sla_file);
+        }
+
+        (void)printf("\nHSM validation %s\n", (failed_count == 0 ? "passed" : "encountered failures"));
+    }
     return failed_count;
 }
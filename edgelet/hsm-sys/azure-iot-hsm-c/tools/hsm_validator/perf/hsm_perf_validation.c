@@ -0,0 +1,511 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#if defined __linux__ && !defined _GNU_SOURCE
+    // for clock_gettime with strict C standard flags
+    #define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hsm_client_data.h"
+#include "hsm_perf_validation.h"
+#include "perf_sla.h"
+
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+#define RANDOM_BYTES_SIZE 32
+#define CERT_VALIDITY_SECS 3600
+#define CERT_ALIAS "hsm_perf_validation_cert"
+#define MAX_MISSES_SIZE 256
+
+typedef int (*PERF_CALL)(void* context);
+
+typedef struct PERF_CASE_TAG
+{
+    const char* function;
+    PERF_CALL call;
+    // undoes what call did, not timed, may be NULL
+    PERF_CALL cleanup;
+    void* context;
+} PERF_CASE;
+
+typedef struct CRYPTO_CONTEXT_TAG
+{
+    const HSM_CLIENT_CRYPTO_INTERFACE* crypto;
+    HSM_CLIENT_HANDLE handle;
+    SIZED_BUFFER identity;
+    SIZED_BUFFER iv;
+    SIZED_BUFFER plaintext;
+    SIZED_BUFFER ciphertext;
+    CERT_PROPS_HANDLE cert_props;
+} CRYPTO_CONTEXT;
+
+static unsigned char identity[] = "hsm_perf_validation";
+static unsigned char init_vector[] = "0123456789abcdef";
+// about the size of the module keys the security daemon encrypts
+static unsigned char plaintext[] =
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit. Nam elementum "
+    "magna tristique justo dignissim aliquam. Aliquam ornare quam a pulvinar.";
+
+static uint64_t now_ns(void)
+{
+#if defined __WINDOWS__ || defined _WIN32 || defined _WIN64 || defined _Windows
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+    if (frequency.QuadPart == 0)
+    {
+        (void)QueryPerformanceFrequency(&frequency);
+    }
+    (void)QueryPerformanceCounter(&now);
+    return (uint64_t)((now.QuadPart / frequency.QuadPart) * 1000000000) +
+           (uint64_t)(((now.QuadPart % frequency.QuadPart) * 1000000000) / frequency.QuadPart);
+#else
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000) + (uint64_t)now.tv_nsec;
+#endif
+}
+
+static int compare_samples(const void* lhs, const void* rhs)
+{
+    uint64_t left = *(const uint64_t*)lhs;
+    uint64_t right = *(const uint64_t*)rhs;
+    return (left > right) - (left < right);
+}
+
+// nearest rank of sorted samples
+static double get_percentile_ms(const uint64_t* samples, size_t count, double percentile)
+{
+    size_t rank = (size_t)((percentile / 100.0) * (double)count + 0.999999);
+    rank = (rank == 0) ? 1 : ((rank > count) ? count : rank);
+    return (double)samples[rank - 1] / 1000000.0;
+}
+
+static void add_miss(char* misses, const char* format, double value, double limit)
+{
+    size_t used = strlen(misses);
+    (void)snprintf(misses + used, MAX_MISSES_SIZE - used, format, (used == 0) ? "" : ", ", value, limit);
+}
+
+// returns 0 when every call succeeded within the SLA of the function
+static int run_case(const PERF_CASE* perf_case)
+{
+    int result = 0;
+    const PERF_SLA* sla = perf_sla_find(perf_case->function);
+    uint64_t* samples = NULL;
+    size_t index;
+
+    if ((sla == NULL) || ((samples = (uint64_t*)malloc(sla->iterations * sizeof(uint64_t))) == NULL))
+    {
+        (void)printf("%-36s could not be measured\n", perf_case->function);
+        result = 1;
+    }
+    else
+    {
+        uint64_t total_ns = 0;
+
+        // the first call may fill caches or open the device, it is not timed
+        result = perf_case->call(perf_case->context);
+        if ((result == 0) && (perf_case->cleanup != NULL))
+        {
+            result = perf_case->cleanup(perf_case->context);
+        }
+        for (index = 0; (index < sla->iterations) && (result == 0); index++)
+        {
+            uint64_t start = now_ns();
+            result = perf_case->call(perf_case->context);
+            samples[index] = now_ns() - start;
+            total_ns += samples[index];
+            if ((result == 0) && (perf_case->cleanup != NULL))
+            {
+                result = perf_case->cleanup(perf_case->context);
+            }
+        }
+
+        if (result != 0)
+        {
+            (void)printf("%-36s call failed\n", perf_case->function);
+            result = 1;
+        }
+        else
+        {
+            char misses[MAX_MISSES_SIZE] = "";
+            double p50_ms, p99_ms, ops_per_sec;
+
+            qsort(samples, sla->iterations, sizeof(uint64_t), compare_samples);
+            p50_ms = get_percentile_ms(samples, sla->iterations, 50.0);
+            p99_ms = get_percentile_ms(samples, sla->iterations, 99.0);
+            ops_per_sec = (total_ns == 0) ? 0.0 : (double)sla->iterations * 1000000000.0 / (double)total_ns;
+
+            if ((sla->max_p50_ms > 0.0) && (p50_ms > sla->max_p50_ms))
+            {
+                add_miss(misses, "%sp50 %.3f ms > %g ms", p50_ms, sla->max_p50_ms);
+            }
+            if ((sla->max_p99_ms > 0.0) && (p99_ms > sla->max_p99_ms))
+            {
+                add_miss(misses, "%sp99 %.3f ms > %g ms", p99_ms, sla->max_p99_ms);
+            }
+            if ((sla->min_ops_per_sec > 0.0) && (ops_per_sec < sla->min_ops_per_sec))
+            {
+                add_miss(misses, "%s%.1f ops/s < %g ops/s", ops_per_sec, sla->min_ops_per_sec);
+            }
+            result = (misses[0] == '\0') ? 0 : 1;
+            (void)printf("%-36s %6zu %10.1f %10.3f %10.3f  %s\n", perf_case->function, sla->iterations,
+                         ops_per_sec, p50_ms, p99_ms, (result == 0) ? "ok" : misses);
+        }
+    }
+
+    free(samples);
+    return result;
+}
+
+static int run_cases(const PERF_CASE* cases, size_t count)
+{
+    int failed_count = 0;
+    size_t index;
+
+    for (index = 0; index < count; index++)
+    {
+        failed_count += run_case(&cases[index]);
+    }
+
+    return failed_count;
+}
+
+//##############################################################################
+// Crypto interface
+//##############################################################################
+static int get_random_bytes(void* context)
+{
+    CRYPTO_CONTEXT* client = (CRYPTO_CONTEXT*)context;
+    unsigned char buffer[RANDOM_BYTES_SIZE];
+    return client->crypto->hsm_client_get_random_bytes(client->handle, buffer, sizeof(buffer));
+}
+
+static int encrypt_data(void* context)
+{
+    CRYPTO_CONTEXT* client = (CRYPTO_CONTEXT*)context;
+    SIZED_BUFFER ciphertext = { NULL, 0 };
+    int result = client->crypto->hsm_client_encrypt_data(client->handle, &client->identity,
+                                                         &client->plaintext, &client->iv, &ciphertext);
+    client->crypto->hsm_client_free_buffer(ciphertext.buffer);
+    return result;
+}
+
+static int decrypt_data(void* context)
+{
+    CRYPTO_CONTEXT* client = (CRYPTO_CONTEXT*)context;
+    SIZED_BUFFER decrypted = { NULL, 0 };
+    int result = client->crypto->hsm_client_decrypt_data(client->handle, &client->identity,
+                                                         &client->ciphertext, &client->iv, &decrypted);
+    client->crypto->hsm_client_free_buffer(decrypted.buffer);
+    return result;
+}
+
+static int create_certificate(void* context)
+{
+    CRYPTO_CONTEXT* client = (CRYPTO_CONTEXT*)context;
+    CERT_INFO_HANDLE cert_info = client->crypto->hsm_client_create_certificate(client->handle, client->cert_props);
+    certificate_info_destroy(cert_info);
+    return (cert_info != NULL) ? 0 : 1;
+}
+
+static int destroy_certificate(void* context)
+{
+    CRYPTO_CONTEXT* client = (CRYPTO_CONTEXT*)context;
+    client->crypto->hsm_client_destroy_certificate(client->handle, CERT_ALIAS);
+    return 0;
+}
+
+static int get_trust_bundle(void* context)
+{
+    CRYPTO_CONTEXT* client = (CRYPTO_CONTEXT*)context;
+    CERT_INFO_HANDLE cert_info = client->crypto->hsm_client_get_trust_bundle(client->handle);
+    certificate_info_destroy(cert_info);
+    return (cert_info != NULL) ? 0 : 1;
+}
+
+static int open_crypto(CRYPTO_CONTEXT* client)
+{
+    int result;
+
+    memset(client, 0, sizeof(*client));
+    client->identity.buffer = identity;
+    client->identity.size = sizeof(identity) - 1;
+    client->iv.buffer = init_vector;
+    client->iv.size = sizeof(init_vector) - 1;
+    client->plaintext.buffer = plaintext;
+    client->plaintext.size = sizeof(plaintext) - 1;
+    if (hsm_client_crypto_init() != 0)
+    {
+        result = 1;
+    }
+    else if (((client->crypto = hsm_client_crypto_interface()) == NULL) ||
+             ((client->handle = client->crypto->hsm_client_crypto_create()) == NULL))
+    {
+        hsm_client_crypto_deinit();
+        result = 1;
+    }
+    else if ((client->crypto->hsm_client_create_master_encryption_key(client->handle) != 0) ||
+             (client->crypto->hsm_client_encrypt_data(client->handle, &client->identity, &client->plaintext,
+                                                      &client->iv, &client->ciphertext) != 0) ||
+             ((client->cert_props = cert_properties_create()) == NULL) ||
+             (set_common_name(client->cert_props, CERT_ALIAS) != 0) ||
+             (set_validity_seconds(client->cert_props, CERT_VALIDITY_SECS) != 0) ||
+             (set_alias(client->cert_props, CERT_ALIAS) != 0) ||
+             (set_issuer_alias(client->cert_props, hsm_get_device_ca_alias()) != 0) ||
+             (set_certificate_type(client->cert_props, CERTIFICATE_TYPE_SERVER) != 0))
+    {
+        cert_properties_destroy(client->cert_props);
+        client->crypto->hsm_client_free_buffer(client->ciphertext.buffer);
+        client->crypto->hsm_client_crypto_destroy(client->handle);
+        hsm_client_crypto_deinit();
+        result = 1;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static void close_crypto(CRYPTO_CONTEXT* client)
+{
+    cert_properties_destroy(client->cert_props);
+    client->crypto->hsm_client_free_buffer(client->ciphertext.buffer);
+    client->crypto->hsm_client_crypto_destroy(client->handle);
+    hsm_client_crypto_deinit();
+}
+
+static int crypto_perf_validation(void)
+{
+    int result;
+    CRYPTO_CONTEXT client;
+
+    if (open_crypto(&client) != 0)
+    {
+        (void)printf("%-36s could not open the crypto interface\n", "crypto");
+        result = 1;
+    }
+    else
+    {
+        const PERF_CASE cases[] =
+        {
+            { "crypto.get_random_bytes", get_random_bytes, NULL, &client },
+            { "crypto.encrypt_data", encrypt_data, NULL, &client },
+            { "crypto.decrypt_data", decrypt_data, NULL, &client },
+            { "crypto.create_certificate", create_certificate, destroy_certificate, &client },
+            { "crypto.get_trust_bundle", get_trust_bundle, NULL, &client }
+        };
+        result = run_cases(cases, sizeof(cases) / sizeof(cases[0]));
+        close_crypto(&client);
+    }
+
+    return result;
+}
+
+//##############################################################################
+// TPM interface
+//##############################################################################
+#ifdef USE_TPM_INTERFACE
+typedef struct TPM_CONTEXT_TAG
+{
+    const HSM_CLIENT_TPM_INTERFACE* tpm;
+    HSM_CLIENT_HANDLE handle;
+} TPM_CONTEXT;
+
+static const unsigned char identity_key[] = "a5551d09-82eb-42ec-8df5-56c244ea3ad0";
+// the module identities the security daemon derives keys for look like this
+static const unsigned char derived_identity[] = "hub.azure-devices.net/devices/device/modules/module/primary/1";
+
+static int get_ek(void* context)
+{
+    TPM_CONTEXT* client = (TPM_CONTEXT*)context;
+    unsigned char* key = NULL;
+    size_t key_size = 0;
+    int result = client->tpm->hsm_client_get_ek(client->handle, &key, &key_size);
+    client->tpm->hsm_client_free_buffer(key);
+    return result;
+}
+
+static int get_srk(void* context)
+{
+    TPM_CONTEXT* client = (TPM_CONTEXT*)context;
+    unsigned char* key = NULL;
+    size_t key_size = 0;
+    int result = client->tpm->hsm_client_get_srk(client->handle, &key, &key_size);
+    client->tpm->hsm_client_free_buffer(key);
+    return result;
+}
+
+static int sign_with_identity(void* context)
+{
+    TPM_CONTEXT* client = (TPM_CONTEXT*)context;
+    unsigned char* digest = NULL;
+    size_t digest_size = 0;
+    int result = client->tpm->hsm_client_sign_with_identity(client->handle, plaintext, sizeof(plaintext) - 1,
+                                                            &digest, &digest_size);
+    client->tpm->hsm_client_free_buffer(digest);
+    return result;
+}
+
+static int derive_and_sign_with_identity(void* context)
+{
+    TPM_CONTEXT* client = (TPM_CONTEXT*)context;
+    unsigned char* digest = NULL;
+    size_t digest_size = 0;
+    int result = client->tpm->hsm_client_derive_and_sign_with_identity(client->handle,
+                                                                       plaintext, sizeof(plaintext) - 1,
+                                                                       derived_identity, sizeof(derived_identity) - 1,
+                                                                       &digest, &digest_size);
+    client->tpm->hsm_client_free_buffer(digest);
+    return result;
+}
+
+static int tpm_perf_validation(void)
+{
+    int result;
+    TPM_CONTEXT client;
+
+    if (hsm_client_tpm_init() != 0)
+    {
+        (void)printf("%-36s could not open the TPM interface\n", "tpm");
+        result = 1;
+    }
+    else
+    {
+        if (((client.tpm = hsm_client_tpm_interface()) == NULL) ||
+            ((client.handle = client.tpm->hsm_client_tpm_create()) == NULL))
+        {
+            (void)printf("%-36s could not open the TPM interface\n", "tpm");
+            result = 1;
+        }
+        else
+        {
+            if (client.tpm->hsm_client_activate_identity_key(client.handle, identity_key, sizeof(identity_key) - 1) != 0)
+            {
+                (void)printf("%-36s could not activate the identity key\n", "tpm");
+                result = 1;
+            }
+            else
+            {
+                const PERF_CASE cases[] =
+                {
+                    { "tpm.get_ek", get_ek, NULL, &client },
+                    { "tpm.get_srk", get_srk, NULL, &client },
+                    { "tpm.sign_with_identity", sign_with_identity, NULL, &client },
+                    { "tpm.derive_and_sign_with_identity", derive_and_sign_with_identity, NULL, &client }
+                };
+                result = run_cases(cases, sizeof(cases) / sizeof(cases[0]));
+            }
+            client.tpm->hsm_client_tpm_destroy(client.handle);
+        }
+        hsm_client_tpm_deinit();
+    }
+
+    return result;
+}
+#endif
+
+//##############################################################################
+// x509 interface
+//##############################################################################
+#ifdef USE_X509_INTERFACE
+typedef struct X509_CONTEXT_TAG
+{
+    const HSM_CLIENT_X509_INTERFACE* x509;
+    HSM_CLIENT_HANDLE handle;
+} X509_CONTEXT;
+
+static int x509_get_cert(void* context)
+{
+    X509_CONTEXT* client = (X509_CONTEXT*)context;
+    char* cert = client->x509->hsm_client_get_cert(client->handle);
+    client->x509->hsm_client_free_buffer(cert);
+    return (cert != NULL) ? 0 : 1;
+}
+
+static int x509_get_key(void* context)
+{
+    X509_CONTEXT* client = (X509_CONTEXT*)context;
+    char* key = client->x509->hsm_client_get_key(client->handle);
+    client->x509->hsm_client_free_buffer(key);
+    return (key != NULL) ? 0 : 1;
+}
+
+static int x509_get_common_name(void* context)
+{
+    X509_CONTEXT* client = (X509_CONTEXT*)context;
+    char* name = client->x509->hsm_client_get_common_name(client->handle);
+    client->x509->hsm_client_free_buffer(name);
+    return (name != NULL) ? 0 : 1;
+}
+
+static int x509_perf_validation(void)
+{
+    int result;
+    X509_CONTEXT client;
+
+    if (hsm_client_x509_init() != 0)
+    {
+        (void)printf("%-36s could not open the x509 interface\n", "x509");
+        result = 1;
+    }
+    else
+    {
+        if (((client.x509 = hsm_client_x509_interface()) == NULL) ||
+            ((client.handle = client.x509->hsm_client_x509_create()) == NULL))
+        {
+            (void)printf("%-36s could not open the x509 interface\n", "x509");
+            result = 1;
+        }
+        else
+        {
+            const PERF_CASE cases[] =
+            {
+                { "x509.get_cert", x509_get_cert, NULL, &client },
+                { "x509.get_key", x509_get_key, NULL, &client },
+                { "x509.get_common_name", x509_get_common_name, NULL, &client }
+            };
+            result = run_cases(cases, sizeof(cases) / sizeof(cases[0]));
+            client.x509->hsm_client_x509_destroy(client.handle);
+        }
+        hsm_client_x509_deinit();
+    }
+
+    return result;
+}
+#endif
+
+int hsm_perf_validation(const char* sla_file)
+{
+    int failed_count = 0;
+
+    if ((sla_file != NULL) && (perf_sla_load(sla_file) != 0))
+    {
+        failed_count = 1;
+    }
+    else
+    {
+        (void)printf("%-36s %6s %10s %10s %10s  %s\n", "function", "iters", "ops/s", "p50 ms", "p99 ms", "SLA");
+        failed_count += crypto_perf_validation();
+#ifdef USE_TPM_INTERFACE
+        failed_count += tpm_perf_validation();
+#endif
+#ifdef USE_X509_INTERFACE
+        failed_count += x509_perf_validation();
+#endif
+        (void)printf("%d functions missed their SLA or failed\n", failed_count);
+    }
+
+    return failed_count;
+}
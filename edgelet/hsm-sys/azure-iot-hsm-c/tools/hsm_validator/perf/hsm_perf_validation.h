@@ -0,0 +1,14 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef HSM_PERF_VALIDATION_H
+#define HSM_PERF_VALIDATION_H
+
+/**
+* Times the functions of the HSM interfaces and reports those that miss their
+* SLA. The SLAs are the defaults of perf_sla.c, changed by sla_file when it is
+* not NULL. Returns the number of functions that missed their SLA or failed.
+*/
+extern int hsm_perf_validation(const char* sla_file);
+
+#endif // HSM_PERF_VALIDATION_H
@@ -0,0 +1,128 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "perf_sla.h"
+
+#define DEFAULT_ITERATIONS 100
+// every certificate is a new key pair, which takes seconds on some devices
+#define CERTIFICATE_ITERATIONS 10
+#define MAX_LINE_SIZE 256
+
+// defaults are what the IoT Edge security daemon needs to serve its modules
+static PERF_SLA g_slas[] =
+{
+    // function                             p50 ms  p99 ms   ops/s  iterations
+    { "crypto.get_random_bytes",               0.0,   10.0,    0.0, DEFAULT_ITERATIONS },
+    { "crypto.encrypt_data",                   0.0,   20.0,    0.0, DEFAULT_ITERATIONS },
+    { "crypto.decrypt_data",                   0.0,   20.0,    0.0, DEFAULT_ITERATIONS },
+    { "crypto.create_certificate",             0.0, 5000.0,    0.0, CERTIFICATE_ITERATIONS },
+    { "crypto.get_trust_bundle",               0.0,   50.0,    0.0, DEFAULT_ITERATIONS },
+    { "tpm.get_ek",                            0.0,  100.0,    0.0, DEFAULT_ITERATIONS },
+    { "tpm.get_srk",                           0.0,  100.0,    0.0, DEFAULT_ITERATIONS },
+    { "tpm.sign_with_identity",                0.0,   50.0,   50.0, DEFAULT_ITERATIONS },
+    { "tpm.derive_and_sign_with_identity",     0.0,   50.0,   25.0, DEFAULT_ITERATIONS },
+    { "x509.get_cert",                         0.0,   20.0,    0.0, DEFAULT_ITERATIONS },
+    { "x509.get_key",                          0.0,   20.0,    0.0, DEFAULT_ITERATIONS },
+    { "x509.get_common_name",                  0.0,   20.0,    0.0, DEFAULT_ITERATIONS }
+};
+
+PERF_SLA* perf_sla_find(const char* function)
+{
+    PERF_SLA* result = NULL;
+    size_t index;
+
+    for (index = 0; (index < sizeof(g_slas) / sizeof(g_slas[0])) && (result == NULL); index++)
+    {
+        if (strcmp(g_slas[index].function, function) == 0)
+        {
+            result = &g_slas[index];
+        }
+    }
+
+    return result;
+}
+
+static int apply_limit(PERF_SLA* sla, const char* limit, double value)
+{
+    int result = 0;
+
+    if (value < 0.0)
+    {
+        result = 1;
+    }
+    else if (strcmp(limit, "p50_ms") == 0)
+    {
+        sla->max_p50_ms = value;
+    }
+    else if (strcmp(limit, "p99_ms") == 0)
+    {
+        sla->max_p99_ms = value;
+    }
+    else if (strcmp(limit, "ops_per_sec") == 0)
+    {
+        sla->min_ops_per_sec = value;
+    }
+    else if ((strcmp(limit, "iterations") == 0) && (value >= 1.0))
+    {
+        sla->iterations = (size_t)value;
+    }
+    else
+    {
+        result = 1;
+    }
+
+    return result;
+}
+
+int perf_sla_load(const char* file_name)
+{
+    int result = 0;
+    FILE* file;
+
+    if ((file = fopen(file_name, "r")) == NULL)
+    {
+        (void)printf("Could not open SLA file %s\n", file_name);
+        result = 1;
+    }
+    else
+    {
+        char line[MAX_LINE_SIZE];
+        size_t line_number = 0;
+
+        while (fgets(line, sizeof(line), file) != NULL)
+        {
+            char function[MAX_LINE_SIZE], limit[MAX_LINE_SIZE], extra[MAX_LINE_SIZE];
+            double value;
+            int fields = sscanf(line, "%255s %255s %lf %255s", function, limit, &value, extra);
+            PERF_SLA* sla;
+
+            line_number++;
+            if ((fields == EOF) || ((fields >= 1) && (function[0] == '#')))
+            {
+                continue;
+            }
+            else if (fields != 3)
+            {
+                (void)printf("%s:%zu: expected \"<function> <limit> <value>\"\n", file_name, line_number);
+                result = 1;
+            }
+            else if ((sla = perf_sla_find(function)) == NULL)
+            {
+                (void)printf("%s:%zu: unknown function %s\n", file_name, line_number, function);
+                result = 1;
+            }
+            else if (apply_limit(sla, limit, value) != 0)
+            {
+                (void)printf("%s:%zu: invalid limit %s %g\n", file_name, line_number, limit, value);
+                result = 1;
+            }
+        }
+        (void)fclose(file);
+    }
+
+    return result;
+}
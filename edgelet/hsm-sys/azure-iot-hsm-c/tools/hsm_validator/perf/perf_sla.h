@@ -0,0 +1,35 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef PERF_SLA_H
+#define PERF_SLA_H
+
+#include <stddef.h>
+
+/**
+* Latency and throughput a function of an HSM interface must meet. A limit of
+* 0 is not checked. Throughput is that of back to back calls on one thread.
+*/
+typedef struct PERF_SLA_TAG
+{
+    const char* function;
+    double max_p50_ms;
+    double max_p99_ms;
+    double min_ops_per_sec;
+    size_t iterations;
+} PERF_SLA;
+
+/**
+* Returns the SLA of function, NULL when it has none. SLAs start at their
+* defaults and can be changed with perf_sla_load.
+*/
+extern PERF_SLA* perf_sla_find(const char* function);
+
+/**
+* Changes SLAs from a file whose lines are "<function> <limit> <value>", where
+* limit is one of p50_ms, p99_ms, ops_per_sec and iterations. Blank lines and
+* lines starting with # are skipped. Returns 0 when every line was applied.
+*/
+extern int perf_sla_load(const char* file_name);
+
+#endif // PERF_SLA_H
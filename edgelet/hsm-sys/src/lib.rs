@@ -153,6 +153,60 @@ pub type HSM_CLIENT_DERIVE_AND_SIGN_WITH_IDENTITY = Option<
     ) -> c_int,
 >;
 
+/// API to import a named SAS key, such as the key of a downstream device or
+/// module. Importing under an existing name replaces the previous key.
+///
+/// handle[in] -- A valid HSM client handle
+/// key_name[in] -- Name of the key, the identity key name is reserved
+/// key[in] -- Key to be imported
+/// key_size[in] -- Length of the key
+///
+/// Return
+/// 0  -- On success
+/// Non 0 -- otherwise
+pub type HSM_CLIENT_IMPORT_SAS_KEY = Option<
+    unsafe extern "C" fn(
+        handle: HSM_CLIENT_HANDLE,
+        key_name: *const c_char,
+        key: *const c_uchar,
+        key_size: usize,
+    ) -> c_int,
+>;
+
+/// API to remove a named SAS key imported with HSM_CLIENT_IMPORT_SAS_KEY.
+///
+/// handle[in] -- A valid HSM client handle
+/// key_name[in] -- Name of the key
+///
+/// Return
+/// 0  -- On success
+/// Non 0 -- otherwise
+pub type HSM_CLIENT_REMOVE_SAS_KEY =
+    Option<unsafe extern "C" fn(handle: HSM_CLIENT_HANDLE, key_name: *const c_char) -> c_int>;
+
+/// API to sign data with a named SAS key. The key should never leave the HSM.
+///
+/// handle[in] -- A valid HSM client handle
+/// key_name[in] -- Name of a key imported with HSM_CLIENT_IMPORT_SAS_KEY
+/// data_to_be_signed[in] -- Data to be signed
+/// data_to_be_signed_size[in] -- Length of the data to be signed
+/// digest[out]  -- Pointer to a buffer to be filled with the signed digest
+/// digest_size[out]  -- Length of signed digest
+///
+/// Return
+/// 0  -- On success
+/// Non 0 -- otherwise
+pub type HSM_CLIENT_SIGN_WITH_SAS_KEY = Option<
+    unsafe extern "C" fn(
+        handle: HSM_CLIENT_HANDLE,
+        key_name: *const c_char,
+        data_to_be_signed: *const c_uchar,
+        data_to_be_signed_size: usize,
+        digest: *mut *mut c_uchar,
+        digest_size: *mut usize,
+    ) -> c_int,
+>;
+
 // x509
 
 pub type HSM_CLIENT_GET_CERTIFICATE =
@@ -485,6 +539,36 @@ extern "C" {
     pub fn certificate_info_get_valid_to(handle: CERT_INFO_HANDLE) -> i64;
 }
 
+extern "C" {
+    /// Obtain the DER encoding of the leaf certificate associated with the
+    /// supplied CERT_INFO_HANDLE. The buffer is owned by the handle.
+    ///
+    /// handle[in]   -- Valid handle to certificate
+    /// der_len[out] -- Return parameter containing the size of the buffer
+    ///
+    /// Return
+    /// Pointer to the DER bytes on success, NULL otherwise
+    pub fn certificate_info_get_der(
+        handle: CERT_INFO_HANDLE,
+        der_len: *mut usize,
+    ) -> *const c_uchar;
+}
+
+extern "C" {
+    /// Obtain the SHA-256 thumbprint of the leaf certificate associated with
+    /// the supplied CERT_INFO_HANDLE. The buffer is owned by the handle.
+    ///
+    /// handle[in]          -- Valid handle to certificate
+    /// thumbprint_len[out] -- Return parameter containing the size of the buffer
+    ///
+    /// Return
+    /// Pointer to the thumbprint bytes on success, NULL otherwise
+    pub fn certificate_info_get_thumbprint_sha256(
+        handle: CERT_INFO_HANDLE,
+        thumbprint_len: *mut usize,
+    ) -> *const c_uchar;
+}
+
 extern "C" {
     pub fn certificate_info_private_key_type(handle: CERT_INFO_HANDLE) -> PRIVATE_KEY_TYPE;
 }
@@ -641,6 +725,99 @@ fn bindgen_test_layout_HSM_CLIENT_TPM_INTERFACE_TAG() {
     );
 }
 
+pub const HSM_CLIENT_TPM_SAS_KEY_INTERFACE_VERSION: u32 = 1;
+
+/// Optional extension of the TPM interface to manage named SAS keys. Fields
+/// are only ever appended, check that version is at least the one that
+/// introduced the fields in use.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG {
+    pub version: u32,
+    pub hsm_client_import_sas_key: HSM_CLIENT_IMPORT_SAS_KEY,
+    pub hsm_client_remove_sas_key: HSM_CLIENT_REMOVE_SAS_KEY,
+    pub hsm_client_sign_with_sas_key: HSM_CLIENT_SIGN_WITH_SAS_KEY,
+}
+
+pub type HSM_CLIENT_TPM_SAS_KEY_INTERFACE = HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG;
+
+impl Default for HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG {
+    fn default() -> HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG {
+        HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG {
+            version: HSM_CLIENT_TPM_SAS_KEY_INTERFACE_VERSION,
+            hsm_client_import_sas_key: None,
+            hsm_client_remove_sas_key: None,
+            hsm_client_sign_with_sas_key: None,
+        }
+    }
+}
+
+#[test]
+fn bindgen_test_layout_HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG() {
+    assert_eq!(
+        ::std::mem::size_of::<HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG>(),
+        4_usize * ::std::mem::size_of::<usize>(),
+        concat!("Size of: ", stringify!(HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG))
+    );
+    assert_eq!(
+        ::std::mem::align_of::<HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG>(),
+        ::std::mem::size_of::<usize>(),
+        concat!("Alignment of ", stringify!(HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG))
+    );
+    assert_eq!(
+        unsafe {
+            &(*(::std::ptr::null::<HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG>())).version
+                as *const _ as usize
+        },
+        0_usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG),
+            "::",
+            stringify!(version)
+        )
+    );
+    assert_eq!(
+        unsafe {
+            &(*(::std::ptr::null::<HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG>())).hsm_client_import_sas_key
+                as *const _ as usize
+        },
+        ::std::mem::size_of::<usize>(),
+        concat!(
+            "Offset of field: ",
+            stringify!(HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG),
+            "::",
+            stringify!(hsm_client_import_sas_key)
+        )
+    );
+    assert_eq!(
+        unsafe {
+            &(*(::std::ptr::null::<HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG>())).hsm_client_remove_sas_key
+                as *const _ as usize
+        },
+        2_usize * ::std::mem::size_of::<usize>(),
+        concat!(
+            "Offset of field: ",
+            stringify!(HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG),
+            "::",
+            stringify!(hsm_client_remove_sas_key)
+        )
+    );
+    assert_eq!(
+        unsafe {
+            &(*(::std::ptr::null::<HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG>())).hsm_client_sign_with_sas_key
+                as *const _ as usize
+        },
+        3_usize * ::std::mem::size_of::<usize>(),
+        concat!(
+            "Offset of field: ",
+            stringify!(HSM_CLIENT_TPM_SAS_KEY_INTERFACE_TAG),
+            "::",
+            stringify!(hsm_client_sign_with_sas_key)
+        )
+    );
+}
+
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
 pub struct HSM_CLIENT_X509_INTERFACE_TAG {
@@ -951,9 +1128,365 @@ fn bindgen_test_layout_HSM_CLIENT_CRYPTO_INTERFACE_TAG() {
     );
 }
 
+pub const HSM_METRICS_NUM_BUCKETS: usize = 140;
+
+/// Counts and latency histogram of the calls to an operation. Latencies in
+/// nanoseconds fall in the first bucket whose upper bound, given by
+/// hsm_metrics_bucket_upper_bound, is not below them.
+/// Allocations are only counted when the library is built with allocation
+/// accounting.
+#[repr(C)]
+pub struct HSM_OPERATION_METRICS_TAG {
+    pub name: *const c_char,
+    pub count: u64,
+    pub errors: u64,
+    pub total_ns: u64,
+    pub max_ns: u64,
+    pub buckets: [u64; HSM_METRICS_NUM_BUCKETS],
+    pub allocations: u64,
+    pub allocated_bytes: u64,
+    pub max_peak_bytes: u64,
+}
+pub type HSM_OPERATION_METRICS = HSM_OPERATION_METRICS_TAG;
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct HSM_CACHE_METRICS_TAG {
+    pub name: *const c_char,
+    pub hits: u64,
+    pub misses: u64,
+}
+pub type HSM_CACHE_METRICS = HSM_CACHE_METRICS_TAG;
+
+/// Waits for an internal lock, only counted when the library is built with
+/// lock profiling.
+#[repr(C)]
+pub struct HSM_LOCK_METRICS_TAG {
+    pub name: *const c_char,
+    pub acquisitions: u64,
+    pub contended: u64,
+    pub total_wait_ns: u64,
+    pub max_wait_ns: u64,
+    pub buckets: [u64; HSM_METRICS_NUM_BUCKETS],
+}
+pub type HSM_LOCK_METRICS = HSM_LOCK_METRICS_TAG;
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct HSM_METRICS_TAG {
+    pub num_operations: usize,
+    pub operations: *mut HSM_OPERATION_METRICS,
+    pub num_caches: usize,
+    pub caches: *mut HSM_CACHE_METRICS,
+    pub num_locks: usize,
+    pub locks: *mut HSM_LOCK_METRICS,
+}
+pub type HSM_METRICS = HSM_METRICS_TAG;
+
+#[test]
+fn bindgen_test_layout_HSM_OPERATION_METRICS_TAG() {
+    assert_eq!(
+        ::std::mem::size_of::<HSM_OPERATION_METRICS_TAG>(),
+        ::std::mem::size_of::<usize>() + (4 + HSM_METRICS_NUM_BUCKETS + 3) * 8_usize,
+        concat!("Size of: ", stringify!(HSM_OPERATION_METRICS_TAG))
+    );
+    assert_eq!(
+        unsafe {
+            &(*(::std::ptr::null::<HSM_OPERATION_METRICS_TAG>())).buckets as *const _ as usize
+        },
+        ::std::mem::size_of::<usize>() + 4 * 8_usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(HSM_OPERATION_METRICS_TAG),
+            "::",
+            stringify!(buckets)
+        )
+    );
+    assert_eq!(
+        unsafe {
+            &(*(::std::ptr::null::<HSM_OPERATION_METRICS_TAG>())).allocations as *const _ as usize
+        },
+        ::std::mem::size_of::<usize>() + (4 + HSM_METRICS_NUM_BUCKETS) * 8_usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(HSM_OPERATION_METRICS_TAG),
+            "::",
+            stringify!(allocations)
+        )
+    );
+}
+
+#[test]
+fn bindgen_test_layout_HSM_METRICS_TAG() {
+    assert_eq!(
+        ::std::mem::size_of::<HSM_METRICS_TAG>(),
+        6_usize * ::std::mem::size_of::<usize>(),
+        concat!("Size of: ", stringify!(HSM_METRICS_TAG))
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<HSM_METRICS_TAG>())).caches as *const _ as usize },
+        3_usize * ::std::mem::size_of::<usize>(),
+        concat!(
+            "Offset of field: ",
+            stringify!(HSM_METRICS_TAG),
+            "::",
+            stringify!(caches)
+        )
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<HSM_METRICS_TAG>())).locks as *const _ as usize },
+        5_usize * ::std::mem::size_of::<usize>(),
+        concat!(
+            "Offset of field: ",
+            stringify!(HSM_METRICS_TAG),
+            "::",
+            stringify!(locks)
+        )
+    );
+}
+
+#[test]
+fn bindgen_test_layout_HSM_LOCK_METRICS_TAG() {
+    assert_eq!(
+        ::std::mem::size_of::<HSM_LOCK_METRICS_TAG>(),
+        ::std::mem::size_of::<usize>() + (4 + HSM_METRICS_NUM_BUCKETS) * 8_usize,
+        concat!("Size of: ", stringify!(HSM_LOCK_METRICS_TAG))
+    );
+}
+
+extern "C" {
+    /// Returns a snapshot of the metrics of every thread, to be released
+    /// with hsm_free_metrics.
+    pub fn hsm_get_metrics() -> *mut HSM_METRICS;
+}
+extern "C" {
+    pub fn hsm_free_metrics(metrics: *mut HSM_METRICS);
+}
+extern "C" {
+    pub fn hsm_metrics_bucket_upper_bound(bucket: usize) -> u64;
+}
+extern "C" {
+    pub fn hsm_metrics_percentile(
+        operation: *const HSM_OPERATION_METRICS,
+        percentile: f64,
+    ) -> u64;
+}
+extern "C" {
+    pub fn hsm_metrics_lock_percentile(lock: *const HSM_LOCK_METRICS, percentile: f64) -> u64;
+}
+
+#[test]
+fn bindgen_test_get_metrics() {
+    unsafe {
+        let metrics = hsm_get_metrics();
+        assert!(!metrics.is_null());
+        assert_ne!(0, (*metrics).num_operations);
+        let operation = &*(*metrics).operations;
+        assert!(!operation.name.is_null());
+        assert!(hsm_metrics_percentile(operation, 99.0) <= operation.max_ns);
+        assert_ne!(0, (*metrics).num_locks);
+        let lock = &*(*metrics).locks;
+        assert!(hsm_metrics_lock_percentile(lock, 99.0) <= lock.max_wait_ns);
+        assert_eq!(
+            u64::max_value(),
+            hsm_metrics_bucket_upper_bound(HSM_METRICS_NUM_BUCKETS - 1)
+        );
+        hsm_free_metrics(metrics);
+    }
+}
+
+/// An operation reported to the callbacks set with hsm_set_trace_callbacks.
+/// Operations made on behalf of another one have that one as their parent.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct HSM_TRACE_SPAN_TAG {
+    pub id: u64,
+    pub parent_id: u64,
+    pub name: *const c_char,
+    pub target: *const c_char,
+    pub input_size: usize,
+    pub output_size: usize,
+    pub result: c_int,
+}
+pub type HSM_TRACE_SPAN = HSM_TRACE_SPAN_TAG;
+
+pub type HSM_TRACE_CALLBACK =
+    Option<unsafe extern "C" fn(span: *const HSM_TRACE_SPAN, context: *mut c_void)>;
+
+#[test]
+fn bindgen_test_layout_HSM_TRACE_SPAN_TAG() {
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<HSM_TRACE_SPAN_TAG>())).result as *const _ as usize },
+        16_usize + 4_usize * ::std::mem::size_of::<usize>(),
+        concat!(
+            "Offset of field: ",
+            stringify!(HSM_TRACE_SPAN_TAG),
+            "::",
+            stringify!(result)
+        )
+    );
+}
+
+extern "C" {
+    /// Sets the callbacks invoked when a traced operation begins and ends,
+    /// both must be set or cleared together.
+    pub fn hsm_set_trace_callbacks(
+        on_begin: HSM_TRACE_CALLBACK,
+        on_end: HSM_TRACE_CALLBACK,
+        context: *mut c_void,
+    ) -> c_int;
+}
+
+#[cfg(test)]
+unsafe extern "C" fn test_trace_callback(_span: *const HSM_TRACE_SPAN, _context: *mut c_void) {}
+
+#[test]
+fn bindgen_test_set_trace_callbacks() {
+    unsafe {
+        assert_ne!(
+            0,
+            hsm_set_trace_callbacks(Some(test_trace_callback), None, ::std::ptr::null_mut())
+        );
+        assert_eq!(
+            0,
+            hsm_set_trace_callbacks(None, None, ::std::ptr::null_mut())
+        );
+    }
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct HSM_ASYNC_TICKET_TAG {
+    _unused: [u8; 0],
+}
+/// A slow operation submitted to the asynchronous API, to be passed once to
+/// either hsm_async_get_result or hsm_async_cancel.
+pub type HSM_ASYNC_TICKET = *mut HSM_ASYNC_TICKET_TAG;
+
+/// Outcome of an operation submitted to the asynchronous API.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct HSM_ASYNC_RESULT_TAG {
+    pub result: c_int,
+    pub output: SIZED_BUFFER,
+    pub certificate: CERT_INFO_HANDLE,
+}
+pub type HSM_ASYNC_RESULT = HSM_ASYNC_RESULT_TAG;
+
+pub type HSM_ASYNC_CALLBACK =
+    Option<unsafe extern "C" fn(ticket: HSM_ASYNC_TICKET, context: *mut c_void)>;
+
+#[test]
+fn bindgen_test_layout_HSM_ASYNC_RESULT_TAG() {
+    assert_eq!(
+        ::std::mem::size_of::<HSM_ASYNC_RESULT_TAG>(),
+        4_usize * ::std::mem::size_of::<usize>(),
+        concat!("Size of: ", stringify!(HSM_ASYNC_RESULT_TAG))
+    );
+    assert_eq!(
+        unsafe { &(*(::std::ptr::null::<HSM_ASYNC_RESULT_TAG>())).output as *const _ as usize },
+        ::std::mem::size_of::<usize>(),
+        concat!(
+            "Offset of field: ",
+            stringify!(HSM_ASYNC_RESULT_TAG),
+            "::",
+            stringify!(output)
+        )
+    );
+    assert_eq!(
+        unsafe {
+            &(*(::std::ptr::null::<HSM_ASYNC_RESULT_TAG>())).certificate as *const _ as usize
+        },
+        3_usize * ::std::mem::size_of::<usize>(),
+        concat!(
+            "Offset of field: ",
+            stringify!(HSM_ASYNC_RESULT_TAG),
+            "::",
+            stringify!(certificate)
+        )
+    );
+}
+
+extern "C" {
+    /// Starts the threads that run asynchronous operations, 0 for the default
+    /// number of threads.
+    pub fn hsm_async_init(num_threads: usize) -> c_int;
+}
+extern "C" {
+    pub fn hsm_async_deinit();
+}
+extern "C" {
+    /// Returns an eventfd incremented on every completion, -1 where eventfd is
+    /// not available.
+    pub fn hsm_async_get_event_fd() -> c_int;
+}
+extern "C" {
+    pub fn hsm_async_create_certificate(
+        handle: HSM_CLIENT_HANDLE,
+        certificate_props: CERT_PROPS_HANDLE,
+        callback: HSM_ASYNC_CALLBACK,
+        context: *mut c_void,
+    ) -> HSM_ASYNC_TICKET;
+}
+extern "C" {
+    pub fn hsm_async_encrypt_data(
+        handle: HSM_CLIENT_HANDLE,
+        identity: *const SIZED_BUFFER,
+        plaintext: *const SIZED_BUFFER,
+        init_vector: *const SIZED_BUFFER,
+        callback: HSM_ASYNC_CALLBACK,
+        context: *mut c_void,
+    ) -> HSM_ASYNC_TICKET;
+}
+extern "C" {
+    pub fn hsm_async_decrypt_data(
+        handle: HSM_CLIENT_HANDLE,
+        identity: *const SIZED_BUFFER,
+        ciphertext: *const SIZED_BUFFER,
+        init_vector: *const SIZED_BUFFER,
+        callback: HSM_ASYNC_CALLBACK,
+        context: *mut c_void,
+    ) -> HSM_ASYNC_TICKET;
+}
+extern "C" {
+    pub fn hsm_async_sign_with_identity(
+        handle: HSM_CLIENT_HANDLE,
+        data: *const c_uchar,
+        data_size: usize,
+        callback: HSM_ASYNC_CALLBACK,
+        context: *mut c_void,
+    ) -> HSM_ASYNC_TICKET;
+}
+extern "C" {
+    pub fn hsm_async_derive_and_sign_with_identity(
+        handle: HSM_CLIENT_HANDLE,
+        data: *const c_uchar,
+        data_size: usize,
+        identity: *const c_uchar,
+        identity_size: usize,
+        callback: HSM_ASYNC_CALLBACK,
+        context: *mut c_void,
+    ) -> HSM_ASYNC_TICKET;
+}
+extern "C" {
+    pub fn hsm_async_is_complete(ticket: HSM_ASYNC_TICKET) -> c_int;
+}
+extern "C" {
+    /// Waits for the operation, moves its outcome to result and releases the
+    /// ticket.
+    pub fn hsm_async_get_result(ticket: HSM_ASYNC_TICKET, result: *mut HSM_ASYNC_RESULT) -> c_int;
+}
+extern "C" {
+    pub fn hsm_async_cancel(ticket: HSM_ASYNC_TICKET);
+}
+
 extern "C" {
     pub fn hsm_client_tpm_interface() -> *const HSM_CLIENT_TPM_INTERFACE;
 }
+extern "C" {
+    /// Returns NULL when the TPM does not support named SAS keys.
+    pub fn hsm_client_tpm_sas_key_interface() -> *const HSM_CLIENT_TPM_SAS_KEY_INTERFACE;
+}
 extern "C" {
     pub fn hsm_client_x509_interface() -> *const HSM_CLIENT_X509_INTERFACE;
 }